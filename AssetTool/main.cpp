@@ -0,0 +1,6999 @@
+// offline asset cooking
+//
+// AssetTool texture <input image> <output.dds> [bc1|bc3|bc4|bc5|bc7]
+//     generates the mip chain and block compresses every level, the renderer picks up
+//     the .dds when it sits next to the image it was made from
+// AssetTool bench [bc1|bc3|bc4|bc5|bc7] [input.dds]
+//     encoder speed and quality, on an uncompressed rgba dds or a generated test image
+// AssetTool mipbench [seed]
+//     checks box and triangle mips of small known images, srgb round trips and that transparent pixels do not bleed,
+//     random images of odd sizes against a double precision reference, and that the sse2 and scalar paths and the
+//     thread count give the same pixels, then measures the chain of the generated bench image on 1, 2 and every
+//     hardware thread
+// AssetTool profilebench [trace.json]
+//     cost of a PROFILE_SCOPE on one and on every hardware thread, optionally writes the recorded trace
+// AssetTool uploadbench [seed]
+//     checks wrapping, failed requests, out of order releases and the stats of the upload arena with fixed cases,
+//     then measures its speed and fragmentation under a simulated streaming load and checks that live staging
+//     ranges never overlap
+// AssetTool frameallocbench [seed]
+//     checks the frame allocator's page reuse, alignment and dedicated pages with fixed cases and random frames
+//     against a simulated gpu, then measures allocations per second
+// AssetTool heapbench [seed]
+//     checks and fuzzes the tlsf allocator behind the gpu heaps, then measures its speed and fragmentation
+//     under a mix of texture and buffer sized allocations
+// AssetTool descriptorbench [seed]
+//     checks and fuzzes the descriptor free list and the per frame descriptor ring against a simulated gpu,
+//     then measures how fast descriptors are handed out
+// AssetTool barrierbench [seed]
+//     checks the barriers the resource state tracker emits against a recording command list, fuzzes it against
+//     a simulated gpu that applies them, then measures the cost of a transition
+// AssetTool framegraphbench [seed]
+//     checks culling, ordering, aliasing and barriers of compiled frame graphs, fuzzes random graphs, then
+//     measures how long a graph of hundreds of passes takes to compile
+// AssetTool mesh <input.obj|cube> <output.mesh> [float|snorm16|unorm16]
+//     welds the vertices, orders the triangles for the vertex cache and overdraw and the vertices for fetching,
+//     then quantizes them, positions to snorm16 unless asked otherwise. "cube" is the renderer's built in cube
+// AssetTool meshbench [seed]
+//     optimizes a shuffled sphere of about 100k triangles, checks nothing was lost and that the file reads back
+// AssetTool quantizebench [seed]
+//     checks the half float and octahedral conversions and that quantized vertices stay within the error bounds
+//     of their formats, then measures quantization speed and the vertex bytes saved on the bench sphere
+// AssetTool meshletbench [seed]
+//     checks the meshlets of the bench sphere and their bounds, checks culling against brute force from random
+//     views, then measures how fast meshlets are built and culled and how many are culled
+// AssetTool transformbench [seed]
+//     checks world and wvp matrices of the transform hierarchy against multiplying every node's ancestors, after
+//     building it and after moving nodes, then measures updates of flat and deep hierarchies of 10k to 1M nodes
+//     with 1%, 10% and every node moved, and writing their wvp matrices
+// AssetTool cullbench [seed]
+//     checks the scene culling hierarchy and what it culls against testing every box, after building and after
+//     refitting moved objects, then measures building, refitting and culling 100k and 1M objects
+// AssetTool indirectbench [seed]
+//     checks the cpu reference of the gpu culling shader, the draw commands it appends and the layouts it shares
+//     with the gpu, with its threads in any order, then measures it on 100k and 1M objects
+// AssetTool devicebench [seed]
+//     checks the null render device and that the command lists it records replay to the same commands, then
+//     measures building the renderer's frame with 10k to 100k draws on one and on several record threads
+// AssetTool pipelinebench [seed]
+//     checks that pipeline hashes do not depend on padding or on where the descs live but change with every field
+//     that makes another pipeline, that cache files read back and that files of another adapter or driver, cut off
+//     or damaged ones are refused, then measures hashing. needs the directx headers, ENABLE_DIRECTX_HEADERS
+//     outside windows
+// AssetTool render <output.dds> [reference.dds]
+//     draws the renderer's starting scene on the software render device into an rgba dds, with the generated
+//     bench image as its texture, and fails if more than 0.1% of the pixels differ from the reference,
+//     render_reference.dds next to AssetTool unless another one is given
+// AssetTool rasterbench [seed]
+//     checks the software rasterizer's coverage against a brute force top left rule and that the thread count
+//     changes nothing, then measures Mtri/s and Mpix/s of the renderer's scene and of large spheres on 1 thread
+//     up to every hardware thread
+// AssetTool capture <output.rcap>
+//     draws the renderer's starting scene on a capture device in front of the software device and writes the
+//     captured frame, then checks that it reads back and replays to the same image
+// AssetTool replay <capture.rcap> [count] [null|software]
+//     decodes the captured lists into null device lists count times and reports the decode rate, or executes them
+//     count times on the software device
+// AssetTool imagebench [files...]
+//     checks that the jpeg and png decoder gives the same pixels on its sse2 and scalar paths and on every hardware
+//     thread at once, compares them to a reference decoder, then measures MB/s per core of decoded pixels against
+//     it. the reference is libjpeg and libpng when built with ENABLE_REFERENCE_DECODERS, otherwise wic on windows.
+//     without files it encodes variants of a generated image with libjpeg and libpng, so that needs them too
+//
+// jpeg and png images are decoded on every platform, on windows anything else wic can read is accepted as well,
+// elsewhere other inputs have to be uncompressed rgba dds files
+
+#include <algorithm>
+#include <cctype>
+#include <cfloat>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <initializer_list>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include "ImageLoader.h"
+#endif
+
+#ifdef ENABLE_REFERENCE_DECODERS
+#include <csetjmp>
+
+#include <jpeglib.h>
+#include <png.h>
+#include <zlib.h>
+#endif
+
+#if defined(_WIN32) || defined(ENABLE_DIRECTX_HEADERS)
+#include "PipelineHash.h"
+#include "d3dx12.h"
+#endif
+
+#include "BlockCompression.h"
+#include "CullingBvh.h"
+#include "DdsFile.h"
+#include "DescriptorAllocator.h"
+#include "FrameAllocator.h"
+#include "FrameGraph.h"
+#include "GpuCulling.h"
+#include "ImageDecoder.h"
+#include "MeshFile.h"
+#include "MeshOptimizer.h"
+#include "Meshlet.h"
+#include "MipGenerator.h"
+#include "NullRenderDevice.h"
+#include "Profiler.h"
+#include "RenderCapture.h"
+#include "ResourceStateTracker.h"
+#include "SoftwareRasterizer.h"
+#include "SoftwareRenderDevice.h"
+#include "SoftwareShaders.h"
+#include "TlsfAllocator.h"
+#include "TransformHierarchy.h"
+#include "UploadArena.h"
+#include "VertexLayout.h"
+
+// size of the generated image of the benchmark
+const uint32_t benchImageSize = 1024;
+
+// the mip generator's 8 bit results against the double precision reference
+const int mipCheckTolerance = 1;
+const int mipBenchRunCount = 10;
+
+// scopes per thread of the profiler benchmark, a few times the ring buffer so wrapping is part of the cost
+const int profileBenchScopeCount = 1 << 18;
+
+// same size as the renderer's arena
+const uint64_t uploadBenchArenaSize = 64 * 1024 * 1024;
+const int uploadBenchSubmissionCount = 20000;
+// submissions the simulated gpu lags behind
+const int uploadBenchFenceLatency = 3;
+// the smallest arena there is, so the checks wrap around after a few allocations
+const uint64_t uploadCheckArenaSize = 4 * UploadArenaCapacityGranularity;
+
+// same as the renderer's maxFramesInFlight, the simulated gpu finishes frames this far behind at the latest
+const uint64_t frameAllocBenchFramesInFlight = 2;
+// small pages for the checks so frames span several of them
+const uint64_t frameAllocCheckPageSize = 64 * 1024;
+const int frameAllocFuzzFrameCount = 20000;
+const int frameAllocBenchFrameCount = 2000;
+// draws of a large scene, one constant buffer each
+const int frameAllocBenchAllocationCount = 10000;
+
+const int heapFuzzOperationCount = 200000;
+// one gpu heap block
+const uint64_t heapBenchHeapSize = 256 * 1024 * 1024;
+const int heapBenchOperationCount = 1000000;
+
+// same sizes as the renderer's shader visible heap
+const uint32_t descriptorBenchBindlessCount = 4096;
+const uint32_t descriptorBenchRingCount = 1024;
+const int descriptorFuzzFrameCount = 20000;
+// frames the simulated gpu lags behind
+const int descriptorBenchFenceLatency = 2;
+const int descriptorBenchOperationCount = 10000000;
+
+const int barrierFuzzOperationCount = 200000;
+const uint32_t barrierFuzzResourceCount = 16;
+// a frame of the benchmark, a back buffer, a depth buffer and this many textures
+const uint32_t barrierBenchTextureCount = 64;
+const int barrierBenchFrameCount = 200000;
+
+// the D3D12_RESOURCE_STATES bits the checks use
+const uint32_t stateCommon = 0x0;
+const uint32_t stateRenderTarget = 0x4;
+const uint32_t stateUnorderedAccess = 0x8;
+const uint32_t stateDepthWrite = 0x10;
+const uint32_t stateDepthRead = 0x20;
+const uint32_t stateNonPixelShaderResource = 0x40;
+const uint32_t statePixelShaderResource = 0x80;
+const uint32_t stateCopyDest = 0x400;
+const uint32_t stateCopySource = 0x800;
+const uint32_t stateReads = stateDepthRead | stateNonPixelShaderResource | statePixelShaderResource | stateCopySource;
+
+const int frameGraphFuzzGraphCount = 5000;
+const uint32_t frameGraphBenchPassCount = 500;
+const uint32_t frameGraphBenchTransientCount = 200;
+const int frameGraphBenchCompileCount = 200;
+
+// quads around the bench sphere and from pole to pole, two triangles each
+const uint32_t meshBenchSegmentCount = 224;
+
+const int quantizeFuzzVertexCount = 1000000;
+// distance between unit vectors, 16 bit octahedral encoding measures about 4.3e-5 at worst
+const float octahedralMaxError = 5e-5f;
+// floats the dequantization itself is off by, relative to the size of the bounds
+const float dequantizeRelativeError = 4e-7f;
+const int quantizeBenchRunCount = 20;
+
+const int meshletCheckViewCount = 200;
+const int meshletBenchRunCount = 20;
+const int meshletBenchViewCount = 1000;
+// how far in front of a triangle or inside the frustum a vertex has to be before the checks count it as seen,
+// so float rounding right on a plane is not taken for a culling bug
+const float meshletCheckMargin = 1e-4f;
+
+const int transformCheckNodeCount = 2000;
+const int transformCheckMoveCount = 5;
+// the check hierarchy has one chain this deep, scales multiply along it so the error grows with it
+const int transformCheckChainLength = 200;
+const float transformCheckTolerance = 1e-4f;
+// nodes per chain of the deep benchmark hierarchies
+const size_t transformBenchChainLength = 100;
+// node updates per measurement, spread over as many updates as it takes
+const size_t transformBenchNodeUpdates = 10000000;
+
+const int cullCheckViewCount = 50;
+const int cullCheckTransformCount = 1000;
+// the world grows with the object count so the density, and how much of it a view sees, stays the same
+const float cullBenchVolumePerObject = 8.0f;
+const int cullBenchBuildCount = 3;
+const uint32_t cullBenchMovedPercent = 10;
+const int cullBenchViewCount = 50;
+
+const int indirectCheckViewCount = 20;
+// any index count, the kernel only copies it into the commands
+const uint32_t indirectCheckIndexCount = 36;
+const int indirectBenchViewCount = 20;
+
+const int deviceCheckRunCount = 200;
+const int deviceCheckCommandCount = 500;
+const int deviceBenchFrameCount = 20;
+const int deviceBenchFramesInFlight = 3;
+const int deviceBenchThreadCount = 4;
+// D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST and DXGI_FORMAT_R32_UINT
+const uint32_t deviceBenchTriangleList = 4;
+const uint32_t deviceBenchIndexFormat = 42;
+
+const int pipelineBenchHashCount = 100000;
+// a cache file of a few hundred pipelines
+const size_t pipelineBenchCacheSize = 16 * 1024 * 1024;
+
+// the renderer's back buffer and scene, see InitD3D
+const uint32_t renderWidth = 800;
+const uint32_t renderHeight = 600;
+const int renderPropGridWidth = 100;
+const float renderPropSpacing = 0.5f;
+// ConstantBufferPerObjectAlignedSize
+const uint64_t renderConstantBufferSize = 256;
+// how far a channel can be off before a pixel counts as different from the reference, and how many may be
+const int renderChannelTolerance = 2;
+const double renderMaxDifferentFraction = 0.001;
+// the committed golden image of the starting scene, relative to the AssetTool directory the tool runs in
+const char* const renderReferencePath = "render_reference.dds";
+
+// not a multiple of the tile or quad size, so partial tiles and quads get covered too
+const uint32_t rasterCheckTargetWidth = 253;
+const uint32_t rasterCheckTargetHeight = 251;
+const uint32_t rasterCheckViewportSize = 256;
+// pixels between the corners of the grid, jittered by less than a quarter so quads stay convex
+const int32_t rasterCheckGridSpacing = 8;
+const int32_t rasterCheckSubpixels = 16;
+const int rasterCheckTriangleCount = 20000;
+const int rasterCheckThreadCount = 4;
+const int rasterBenchFrameCount = 10;
+const int rasterBenchSphereRows = 4;
+
+// times a capture is replayed unless told otherwise
+const int replayDefaultCount = 100;
+
+// decodes of every image per path
+const int imageBenchRunCount = 5;
+// jpeg decoders round the idct and the color conversion their own way, a mean past this is a real difference
+const double imageBenchMaxJpegMeanDifference = 0.5;
+const int imageBenchJpegQuality = 90;
+
+struct RgbaImage {
+	uint32_t width;
+	uint32_t height;
+	std::vector<uint8_t> pixels;
+};
+
+static bool ReadFile(const char* filename, std::vector<uint8_t>& contents) {
+	FILE* file = fopen(filename, "rb");
+	if (file == NULL)
+		return false;
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	contents.resize(size > 0 ? size : 0);
+	bool succeeded = size > 0 && fread(&contents[0], 1, size, file) == (size_t)size;
+
+	fclose(file);
+	return succeeded;
+}
+
+static bool WriteFile(const char* filename, const std::vector<uint8_t>& contents) {
+	FILE* file = fopen(filename, "wb");
+	if (file == NULL)
+		return false;
+
+	bool succeeded = fwrite(&contents[0], 1, contents.size(), file) == contents.size();
+
+	fclose(file);
+	return succeeded;
+}
+
+static bool HasExtension(const char* filename, const char* extension) {
+	size_t length = strlen(filename);
+	size_t extensionLength = strlen(extension);
+	if (length < extensionLength)
+		return false;
+
+	for (size_t i = 0; i < extensionLength; ++i) {
+		if (tolower(filename[length - extensionLength + i]) != extension[i])
+			return false;
+	}
+	return true;
+}
+
+// top level of an uncompressed dds, as rgba
+static bool LoadDdsImage(const char* filename, RgbaImage& image) {
+	std::vector<uint8_t> contents;
+	DdsImage dds;
+	if (!ReadFile(filename, contents) || !ReadDds(&contents[0], contents.size(), dds))
+		return false;
+
+	if (dds.format != DDS_FORMAT_R8G8B8A8_UNORM && dds.format != DDS_FORMAT_B8G8R8A8_UNORM)
+		return false;
+
+	image.width = dds.width;
+	image.height = dds.height;
+	image.pixels.assign(dds.data.begin(), dds.data.begin() + (size_t)dds.width * dds.height * 4);
+
+	if (dds.format == DDS_FORMAT_B8G8R8A8_UNORM) {
+		for (size_t i = 0; i < image.pixels.size(); i += 4) {
+			uint8_t swap = image.pixels[i];
+			image.pixels[i] = image.pixels[i + 2];
+			image.pixels[i + 2] = swap;
+		}
+	}
+
+	return true;
+}
+
+// what the image decoder made of a jpeg or png, rows are tight
+struct DecodedImage {
+	DecodedImageFormat format;
+	uint32_t width;
+	uint32_t height;
+	std::vector<uint8_t> pixels;
+};
+
+static bool DecodeImageFile(const std::vector<uint8_t>& file, ImageDecodePath path, DecodedImage& image) {
+	ImageInfo info;
+	if (file.empty() || !GetImageInfo(&file[0], file.size(), info))
+		return false;
+
+	image.format = info.format;
+	image.width = info.width;
+	image.height = info.height;
+	size_t rowPitch = (size_t)info.width * GetDecodedImageBytesPerPixel(info.format);
+	image.pixels.resize(rowPitch * info.height);
+	return DecodeImage(&file[0], file.size(), path, &image.pixels[0], rowPitch);
+}
+
+// 16 bit channels are rounded to 8, gray goes into red, green and blue
+static void ConvertDecodedImageToRgba(const DecodedImage& decoded, RgbaImage& image) {
+	image.width = decoded.width;
+	image.height = decoded.height;
+	image.pixels.resize((size_t)decoded.width * decoded.height * 4);
+
+	size_t pixelCount = (size_t)decoded.width * decoded.height;
+	const uint8_t* src = &decoded.pixels[0];
+	for (size_t i = 0; i < pixelCount; ++i) {
+		uint8_t* dst = &image.pixels[i * 4];
+		switch (decoded.format) {
+		case DECODED_IMAGE_FORMAT_R8_UNORM:
+			dst[0] = dst[1] = dst[2] = src[i];
+			dst[3] = 255;
+			break;
+		case DECODED_IMAGE_FORMAT_R16_UNORM:
+			dst[0] = dst[1] = dst[2] = (uint8_t)(((src[i * 2] | src[i * 2 + 1] << 8) * 255 + 32767) / 65535);
+			dst[3] = 255;
+			break;
+		case DECODED_IMAGE_FORMAT_R16G16B16A16_UNORM:
+			for (int c = 0; c < 4; ++c)
+				dst[c] = (uint8_t)(((src[i * 8 + c * 2] | src[i * 8 + c * 2 + 1] << 8) * 255 + 32767) / 65535);
+			break;
+		case DECODED_IMAGE_FORMAT_B8G8R8A8_UNORM:
+			dst[0] = src[i * 4 + 2];
+			dst[1] = src[i * 4 + 1];
+			dst[2] = src[i * 4];
+			dst[3] = src[i * 4 + 3];
+			break;
+		default:
+			memcpy(dst, src + i * 4, 4);
+			break;
+		}
+	}
+}
+
+static bool LoadImage(const char* filename, RgbaImage& image) {
+	if (HasExtension(filename, ".dds"))
+		return LoadDdsImage(filename, image);
+
+	std::vector<uint8_t> contents;
+	DecodedImage decoded;
+	if (ReadFile(filename, contents) && DecodeImageFile(contents, IMAGE_DECODE_SIMD, decoded)) {
+		ConvertDecodedImageToRgba(decoded, image);
+		return true;
+	}
+
+#ifdef _WIN32
+	wchar_t wideFilename[MAX_PATH];
+	if (MultiByteToWideChar(CP_UTF8, 0, filename, -1, wideFilename, MAX_PATH) == 0)
+		return false;
+
+	// the decoder already had its go at it
+	BYTE* imageData = NULL;
+	D3D12_RESOURCE_DESC desc;
+	int bytesPerRow;
+	if (LoadImageDataFromFileWithWIC(&imageData, desc, wideFilename, bytesPerRow) <= 0)
+		return false;
+
+	bool bgra = desc.Format == DXGI_FORMAT_B8G8R8A8_UNORM;
+	if (desc.Format != DXGI_FORMAT_R8G8B8A8_UNORM && !bgra) {
+		free(imageData);
+		return false;
+	}
+
+	image.width = (uint32_t)desc.Width;
+	image.height = desc.Height;
+	image.pixels.resize((size_t)image.width * image.height * 4);
+
+	for (uint32_t y = 0; y < image.height; ++y) {
+		const BYTE* src = imageData + y * bytesPerRow;
+		uint8_t* dst = &image.pixels[(size_t)y * image.width * 4];
+
+		for (uint32_t x = 0; x < image.width; ++x) {
+			dst[0] = src[bgra ? 2 : 0];
+			dst[1] = src[1];
+			dst[2] = src[bgra ? 0 : 2];
+			dst[3] = src[3];
+			src += 4;
+			dst += 4;
+		}
+	}
+
+	free(imageData);
+	return true;
+#else
+	return false;
+#endif
+}
+
+static bool ParseBlockFormat(const char* name, BlockFormat& format) {
+	static const char* names[] = { "bc1", "bc3", "bc4", "bc5", "bc7" };
+	static const BlockFormat formats[] = { BLOCK_FORMAT_BC1, BLOCK_FORMAT_BC3, BLOCK_FORMAT_BC4, BLOCK_FORMAT_BC5, BLOCK_FORMAT_BC7 };
+
+	for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+		if (strcmp(name, names[i]) == 0) {
+			format = formats[i];
+			return true;
+		}
+	}
+	return false;
+}
+
+// compresses bands of block rows on every core
+static void CompressImageParallel(BlockFormat format, const uint8_t* pixels, uint32_t width, uint32_t height, size_t rowPitch, uint8_t* blocks, size_t blockRowPitch) {
+	uint32_t blockRowCount = (height + blockDimension - 1) / blockDimension;
+	uint32_t threadCount = std::thread::hardware_concurrency();
+	if (threadCount > blockRowCount)
+		threadCount = blockRowCount;
+
+	if (threadCount <= 1) {
+		CompressImage(format, pixels, width, height, rowPitch, blocks, blockRowPitch);
+		return;
+	}
+
+	std::vector<std::thread> threads;
+	for (uint32_t t = 0; t < threadCount; ++t) {
+		uint32_t firstBlockRow = blockRowCount * t / threadCount;
+		uint32_t lastBlockRow = blockRowCount * (t + 1) / threadCount;
+
+		uint32_t firstRow = firstBlockRow * blockDimension;
+		uint32_t lastRow = lastBlockRow * blockDimension < height ? lastBlockRow * blockDimension : height;
+
+		threads.push_back(std::thread(CompressImage, format, pixels + firstRow * rowPitch, width, lastRow - firstRow, rowPitch,
+			blocks + firstBlockRow * blockRowPitch, blockRowPitch));
+	}
+
+	for (size_t t = 0; t < threads.size(); ++t)
+		threads[t].join();
+}
+
+// channels the format stores, so psnr does not count what it drops on purpose
+static int GetBlockFormatChannelCount(BlockFormat format) {
+	switch (format) {
+	case BLOCK_FORMAT_BC1: return 3;
+	case BLOCK_FORMAT_BC4: return 1;
+	case BLOCK_FORMAT_BC5: return 2;
+	default: return 4;
+	}
+}
+
+// bc1 punches out pixels below half alpha, their color does not count
+static double ComputePsnr(const RgbaImage& reference, const std::vector<uint8_t>& decoded, int channelCount, bool skipTransparent) {
+	double squaredError = 0.0;
+	double valueCount = 0.0;
+	for (size_t i = 0; i < reference.pixels.size(); i += 4) {
+		if (skipTransparent && reference.pixels[i + 3] < 128)
+			continue;
+
+		valueCount += channelCount;
+		for (int c = 0; c < channelCount; ++c) {
+			double delta = (double)reference.pixels[i + c] - decoded[i + c];
+			squaredError += delta * delta;
+		}
+	}
+
+	double meanSquaredError = valueCount > 0.0 ? squaredError / valueCount : 0.0;
+	if (meanSquaredError <= 0.0)
+		return INFINITY;
+
+	return 10.0 * log10(255.0 * 255.0 / meanSquaredError);
+}
+
+static int CookTexture(const char* input, const char* output, BlockFormat format) {
+	RgbaImage image;
+	if (!LoadImage(input, image)) {
+		fprintf(stderr, "could not load %s\n", input);
+		return 1;
+	}
+
+	MipChain mips;
+	GenerateMipChain(&image.pixels[0], image.width, image.height, (size_t)image.width * 4, MIP_FILTER_TRIANGLE, true, (int)std::thread::hardware_concurrency(),
+		MIP_GENERATE_SIMD, mips);
+
+	DdsImage dds;
+	DdsImageInit(dds, GetDdsFormatFromBlockFormat(format), image.width, image.height, (uint32_t)mips.levels.size());
+
+	for (size_t i = 0; i < mips.levels.size(); ++i) {
+		const MipLevel& mip = mips.levels[i];
+		const DdsLevel& level = dds.levels[i];
+		CompressImageParallel(format, &mips.data[mip.offset], mip.width, mip.height, mip.rowPitch, &dds.data[level.offset], level.rowPitch);
+	}
+
+	std::vector<uint8_t> file;
+	WriteDds(dds, file);
+	if (!WriteFile(output, file)) {
+		fprintf(stderr, "could not write %s\n", output);
+		return 1;
+	}
+
+	printf("%s: %ux%u, %zu mips, %zu bytes (%zu uncompressed)\n", output, image.width, image.height, mips.levels.size(), dds.data.size(), mips.data.size());
+	return 0;
+}
+
+// smooth gradients, hard edges and a transparent border, so every mode of the encoders gets used
+static void GenerateBenchImage(RgbaImage& image) {
+	image.width = benchImageSize;
+	image.height = benchImageSize;
+	image.pixels.resize((size_t)benchImageSize * benchImageSize * 4);
+
+	for (uint32_t y = 0; y < benchImageSize; ++y) {
+		for (uint32_t x = 0; x < benchImageSize; ++x) {
+			uint8_t* pixel = &image.pixels[((size_t)y * benchImageSize + x) * 4];
+			pixel[0] = (uint8_t)(127.5 + 127.5 * sin(x * 0.02));
+			pixel[1] = (uint8_t)(y * 255 / benchImageSize);
+			pixel[2] = ((x / 64 + y / 64) & 1) ? 220 : 30;
+			pixel[3] = (x < 32 || y < 32) ? 0 : (uint8_t)(255 - (x + y) % 128);
+		}
+	}
+}
+
+static int Bench(int formatCount, const BlockFormat* formats, const char* input) {
+	RgbaImage image;
+	if (input != NULL) {
+		if (!LoadImage(input, image)) {
+			fprintf(stderr, "could not load %s\n", input);
+			return 1;
+		}
+	}
+	else {
+		GenerateBenchImage(image);
+	}
+
+	static const char* formatNames[] = { "bc1", "bc3", "bc4", "bc5", "bc7" };
+	std::vector<uint8_t> decoded(image.pixels.size());
+
+	for (int f = 0; f < formatCount; ++f) {
+		BlockFormat format = formats[f];
+
+		size_t blockRowPitch;
+		uint32_t blockRowCount;
+		GetBlockSurfaceInfo(format, image.width, image.height, blockRowPitch, blockRowCount);
+		std::vector<uint8_t> blocks(blockRowPitch * blockRowCount);
+
+		// single threaded, so the numbers compare across machines
+		auto start = std::chrono::steady_clock::now();
+		CompressImage(format, &image.pixels[0], image.width, image.height, (size_t)image.width * 4, &blocks[0], blockRowPitch);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		DecompressImage(format, &blocks[0], image.width, image.height, blockRowPitch, &decoded[0], (size_t)image.width * 4);
+
+		double megapixels = (double)image.width * image.height / 1000000.0;
+		printf("%s: %.2f mpix/s, psnr %.2f db, %.1f:1\n", formatNames[format], megapixels / seconds,
+			ComputePsnr(image, decoded, GetBlockFormatChannelCount(format), format == BLOCK_FORMAT_BC1), (double)image.pixels.size() / blocks.size());
+	}
+
+	return 0;
+}
+
+// volatile so the loop is not removed when the scopes compile to nothing
+static volatile uint32_t profileBenchSink;
+
+static void ProfileBenchThread(double* nanosecondsPerScope) {
+	PROFILE_THREAD_NAME("Bench Thread");
+
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < profileBenchScopeCount; ++i) {
+		PROFILE_SCOPE("BenchScope");
+		profileBenchSink = profileBenchSink + 1;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	*nanosecondsPerScope = seconds * 1000000000.0 / profileBenchScopeCount;
+}
+
+static int ProfileBench(const char* traceFilename) {
+#ifdef ENABLE_PROFILING
+	printf("profiling enabled\n");
+#else
+	printf("profiling compiled out\n");
+#endif
+
+	int threadCounts[] = { 1, (int)std::thread::hardware_concurrency() };
+	for (int i = 0; i < 2; ++i) {
+		int threadCount = threadCounts[i];
+		// hardware_concurrency can be unknown, or there is nothing to compare against
+		if (i == 1 && threadCount <= 1)
+			break;
+
+		std::vector<double> results(threadCount);
+		std::vector<std::thread> threads;
+		for (int t = 0; t < threadCount; ++t)
+			threads.push_back(std::thread(ProfileBenchThread, &results[t]));
+
+		double worst = 0.0;
+		for (int t = 0; t < threadCount; ++t) {
+			threads[t].join();
+			if (results[t] > worst)
+				worst = results[t];
+		}
+
+		printf("%d thread(s): %.1f ns per scope (slowest thread)\n", threadCount, worst);
+	}
+
+	if (traceFilename != NULL) {
+		auto start = std::chrono::steady_clock::now();
+		if (!ProfilerWriteChromeTrace(traceFilename)) {
+			fprintf(stderr, "could not write %s\n", traceFilename);
+			return 1;
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		printf("wrote %s in %.1f ms\n", traceFilename, seconds * 1000.0);
+	}
+
+	return 0;
+}
+
+// fence of the simulated queue
+static uint64_t GetBenchFenceValue(void* fence) {
+	return *static_cast<uint64_t*>(fence);
+}
+
+// xorshift, so runs are repeatable
+static uint32_t NextRandom(uint32_t& state) {
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+static void SetMipCheckPixel(std::vector<uint8_t>& pixels, uint32_t width, uint32_t x, uint32_t y, int r, int g, int b, int a) {
+	uint8_t* pixel = &pixels[((size_t)y * width + x) * 4];
+	pixel[0] = (uint8_t)r;
+	pixel[1] = (uint8_t)g;
+	pixel[2] = (uint8_t)b;
+	pixel[3] = (uint8_t)a;
+}
+
+static bool IsMipPixelNear(const MipChain& chain, uint32_t level, uint32_t x, uint32_t y, int r, int g, int b, int a) {
+	const MipLevel& mip = chain.levels[level];
+	const uint8_t* pixel = &chain.data[mip.offset + y * mip.rowPitch + x * 4];
+	return abs(pixel[0] - r) <= mipCheckTolerance && abs(pixel[1] - g) <= mipCheckTolerance && abs(pixel[2] - b) <= mipCheckTolerance &&
+		abs(pixel[3] - a) <= mipCheckTolerance;
+}
+
+// small images worked out by hand, level sizes included
+static bool CheckMipFilters() {
+	MipChain chain;
+
+	// a column, box averages pairs: 0 64 | 128 255, then the two averages
+	std::vector<uint8_t> column(4 * 4);
+	for (uint32_t y = 0; y < 4; ++y)
+		SetMipCheckPixel(column, 1, 0, y, y == 3 ? 255 : (int)y * 64, 0, 0, 255);
+	GenerateMipChain(&column[0], 1, 4, 4, MIP_FILTER_BOX, false, 1, MIP_GENERATE_SIMD, chain);
+	if (chain.levels.size() != 3 || chain.levels[1].width != 1 || chain.levels[1].height != 2 || chain.levels[2].height != 1)
+		return false;
+	if (!IsMipPixelNear(chain, 1, 0, 0, 32, 0, 0, 255) || !IsMipPixelNear(chain, 1, 0, 1, 192, 0, 0, 255) || !IsMipPixelNear(chain, 2, 0, 0, 112, 0, 0, 255))
+		return false;
+
+	// a row, the 1 3 3 1 tent repeats the edge pixels: 0 0 255 255 gives 255/8 and 255 - 255/8, then their average
+	std::vector<uint8_t> row(4 * 4);
+	for (uint32_t x = 0; x < 4; ++x)
+		SetMipCheckPixel(row, 4, x, 0, 0, x < 2 ? 0 : 255, 0, 255);
+	GenerateMipChain(&row[0], 4, 1, 16, MIP_FILTER_TRIANGLE, false, 1, MIP_GENERATE_SIMD, chain);
+	if (chain.levels.size() != 3 || chain.levels[1].width != 2 || chain.levels[1].height != 1)
+		return false;
+	if (!IsMipPixelNear(chain, 1, 0, 0, 0, 32, 0, 255) || !IsMipPixelNear(chain, 1, 1, 0, 0, 223, 0, 255) || !IsMipPixelNear(chain, 2, 0, 0, 0, 128, 0, 255))
+		return false;
+
+	// odd sizes round down, the box under the 1x1 level of a 3x3 image is its top left 2x2
+	std::vector<uint8_t> odd(3 * 3 * 4);
+	for (uint32_t y = 0; y < 3; ++y) {
+		for (uint32_t x = 0; x < 3; ++x)
+			SetMipCheckPixel(odd, 3, x, y, x < 2 && y < 2 ? 40 + (int)(y * 2 + x) * 40 : 255, 10, 20, 255);
+	}
+	GenerateMipChain(&odd[0], 3, 3, 12, MIP_FILTER_BOX, false, 1, MIP_GENERATE_SIMD, chain);
+	if (chain.levels.size() != 2 || !IsMipPixelNear(chain, 1, 0, 0, 100, 10, 20, 255))
+		return false;
+
+	// a single pixel is its own chain, copied as is
+	uint8_t single[4] = { 1, 2, 3, 4 };
+	GenerateMipChain(single, 1, 1, 4, MIP_FILTER_TRIANGLE, true, 1, MIP_GENERATE_SIMD, chain);
+	return chain.levels.size() == 1 && memcmp(&chain.data[0], single, 4) == 0;
+}
+
+// 2x2 blocks of one color have to come back unchanged through linear space, black and white average to linear gray
+// and transparent pixels must not give their color to visible ones
+static bool CheckMipSrgbAndAlpha() {
+	MipChain chain;
+
+	// every value in every channel, each in a 2x2 block of a 2 wide column
+	std::vector<uint8_t> ramp(2 * 512 * 4);
+	for (uint32_t y = 0; y < 512; ++y) {
+		int value = (int)y / 2;
+		for (uint32_t x = 0; x < 2; ++x)
+			SetMipCheckPixel(ramp, 2, x, y, value, 255 - value, (value * 7) & 255, 255);
+	}
+	for (bool srgb : { false, true }) {
+		for (MipFilter filter : { MIP_FILTER_BOX, MIP_FILTER_TRIANGLE }) {
+			GenerateMipChain(&ramp[0], 2, 512, 8, filter, srgb, 1, MIP_GENERATE_SIMD, chain);
+			const uint8_t* level = &chain.data[chain.levels[1].offset];
+			for (int value = 0; value < 256 && filter == MIP_FILTER_BOX; ++value) {
+				if (level[value * 4] != value || level[value * 4 + 1] != 255 - value || level[value * 4 + 2] != ((value * 7) & 255) || level[value * 4 + 3] != 255)
+					return false;
+			}
+			// the tent reaches into the neighbouring blocks, but a ramp stays a ramp
+			for (int value = 1; value < 255 && filter == MIP_FILTER_TRIANGLE; ++value) {
+				if (level[value * 4] < level[(value - 1) * 4] || level[value * 4] > level[(value + 1) * 4])
+					return false;
+			}
+		}
+	}
+
+	// black and white average to half the light, which is 188 in srgb and 128 without
+	uint8_t checker[16];
+	for (int i = 0; i < 4; ++i) {
+		int value = (i == 0 || i == 3) ? 255 : 0;
+		checker[i * 4] = checker[i * 4 + 1] = checker[i * 4 + 2] = (uint8_t)value;
+		checker[i * 4 + 3] = 255;
+	}
+	GenerateMipChain(checker, 2, 2, 8, MIP_FILTER_BOX, true, 1, MIP_GENERATE_SIMD, chain);
+	if (!IsMipPixelNear(chain, 1, 0, 0, 188, 188, 188, 255))
+		return false;
+	GenerateMipChain(checker, 2, 2, 8, MIP_FILTER_BOX, false, 1, MIP_GENERATE_SIMD, chain);
+	if (!IsMipPixelNear(chain, 1, 0, 0, 128, 128, 128, 255))
+		return false;
+
+	// one opaque red pixel among transparent green ones: a quarter covered and still pure red, with either filter
+	for (MipFilter filter : { MIP_FILTER_BOX, MIP_FILTER_TRIANGLE }) {
+		std::vector<uint8_t> sprite(4 * 4 * 4);
+		for (uint32_t y = 0; y < 4; ++y) {
+			for (uint32_t x = 0; x < 4; ++x)
+				SetMipCheckPixel(sprite, 4, x, y, 0, 255, 0, 0);
+		}
+		SetMipCheckPixel(sprite, 4, 1, 1, 255, 0, 0, 255);
+
+		for (bool srgb : { false, true }) {
+			GenerateMipChain(&sprite[0], 4, 4, 16, filter, srgb, 1, MIP_GENERATE_SIMD, chain);
+			for (uint32_t level = 1; level < chain.levels.size(); ++level) {
+				const MipLevel& mip = chain.levels[level];
+				for (uint32_t i = 0; i < mip.width * mip.height; ++i) {
+					const uint8_t* pixel = &chain.data[mip.offset + i * 4];
+					// fully transparent pixels end up black, covered ones keep the red
+					if (pixel[1] != 0 || pixel[2] != 0 || pixel[0] != (pixel[3] == 0 ? 0 : 255))
+						return false;
+				}
+			}
+			if (filter == MIP_FILTER_BOX && !IsMipPixelNear(chain, 1, 0, 0, 255, 0, 0, 64))
+				return false;
+		}
+	}
+	return true;
+}
+
+// the filters straight from their definitions in doubles: premultiplied linear color, clamped edges, weights
+// multiplied out per tap, every level from the unrounded level above. same layout as MipChain::data
+static void GenerateReferenceMipChain(const uint8_t* pixels, uint32_t width, uint32_t height, MipFilter filter, bool srgb, std::vector<uint8_t>& data) {
+	static const int boxOffsets[2] = { 0, 1 };
+	static const double boxWeights[2] = { 0.5, 0.5 };
+	static const int triangleOffsets[4] = { -1, 0, 1, 2 };
+	static const double triangleWeights[4] = { 1.0 / 8.0, 3.0 / 8.0, 3.0 / 8.0, 1.0 / 8.0 };
+
+	int tapCount = filter == MIP_FILTER_BOX ? 2 : 4;
+	const int* offsets = filter == MIP_FILTER_BOX ? boxOffsets : triangleOffsets;
+	const double* weights = filter == MIP_FILTER_BOX ? boxWeights : triangleWeights;
+
+	std::vector<double> source((size_t)width * height * 4);
+	for (size_t i = 0; i < (size_t)width * height; ++i) {
+		double alpha = pixels[i * 4 + 3] / 255.0;
+		for (int c = 0; c < 3; ++c) {
+			double value = pixels[i * 4 + c] / 255.0;
+			if (srgb)
+				value = value <= 0.04045 ? value / 12.92 : pow((value + 0.055) / 1.055, 2.4);
+			source[i * 4 + c] = value * alpha;
+		}
+		source[i * 4 + 3] = alpha;
+	}
+	data.assign(pixels, pixels + (size_t)width * height * 4);
+
+	std::vector<double> destination;
+	while (width > 1 || height > 1) {
+		uint32_t dstWidth = width > 1 ? width / 2 : 1;
+		uint32_t dstHeight = height > 1 ? height / 2 : 1;
+		destination.assign((size_t)dstWidth * dstHeight * 4, 0.0);
+
+		for (uint32_t y = 0; y < dstHeight; ++y) {
+			for (uint32_t x = 0; x < dstWidth; ++x) {
+				double* output = &destination[((size_t)y * dstWidth + x) * 4];
+				for (int j = 0; j < tapCount; ++j) {
+					int sy = std::min(std::max((int)y * 2 + offsets[j], 0), (int)height - 1);
+					for (int i = 0; i < tapCount; ++i) {
+						int sx = std::min(std::max((int)x * 2 + offsets[i], 0), (int)width - 1);
+						for (int c = 0; c < 4; ++c)
+							output[c] += source[((size_t)sy * width + sx) * 4 + c] * weights[i] * weights[j];
+					}
+				}
+
+				double alpha = output[3];
+				for (int c = 0; c < 3; ++c) {
+					double value = alpha > 0.0 ? std::min(std::max(output[c] / alpha, 0.0), 1.0) : 0.0;
+					if (srgb)
+						value = value <= 0.0031308 ? value * 12.92 : 1.055 * pow(value, 1.0 / 2.4) - 0.055;
+					data.push_back((uint8_t)(value * 255.0 + 0.5));
+				}
+				data.push_back((uint8_t)(std::min(std::max(alpha, 0.0), 1.0) * 255.0 + 0.5));
+			}
+		}
+
+		source.swap(destination);
+		width = dstWidth;
+		height = dstHeight;
+	}
+}
+
+// random images of odd and thin sizes against the reference, with alpha that is often fully transparent or opaque.
+// the scalar path and more threads have to give exactly the same pixels as the sse2 path on one thread
+static bool CheckMipChains(uint32_t seed) {
+	static const uint32_t sizes[][2] = { { 1, 2 }, { 2, 1 }, { 1, 7 }, { 9, 1 }, { 1, 33 }, { 3, 3 }, { 5, 3 }, { 13, 6 }, { 64, 64 }, { 37, 91 }, { 257, 190 } };
+
+	uint32_t random = seed;
+	std::vector<uint8_t> pixels;
+	std::vector<uint8_t> reference;
+	MipChain chain;
+	MipChain other;
+
+	for (const uint32_t* size : sizes) {
+		uint32_t width = size[0];
+		uint32_t height = size[1];
+
+		// padded rows, the chain itself is always tight
+		size_t rowPitch = (size_t)width * 4 + 12;
+		pixels.resize(rowPitch * height);
+		for (uint8_t& value : pixels)
+			value = (uint8_t)NextRandom(random);
+		for (uint32_t y = 0; y < height; ++y) {
+			for (uint32_t x = 0; x < width; ++x) {
+				uint32_t kind = NextRandom(random) % 4;
+				if (kind < 2)
+					pixels[y * rowPitch + x * 4 + 3] = kind == 0 ? 0 : 255;
+			}
+		}
+
+		std::vector<uint8_t> tight((size_t)width * height * 4);
+		for (uint32_t y = 0; y < height; ++y)
+			memcpy(&tight[(size_t)y * width * 4], &pixels[y * rowPitch], (size_t)width * 4);
+
+		for (MipFilter filter : { MIP_FILTER_BOX, MIP_FILTER_TRIANGLE }) {
+			for (bool srgb : { false, true }) {
+				GenerateMipChain(&pixels[0], width, height, rowPitch, filter, srgb, 1, MIP_GENERATE_SIMD, chain);
+				if (chain.levels.size() != GetMipLevelCount(width, height))
+					return false;
+
+				GenerateReferenceMipChain(&tight[0], width, height, filter, srgb, reference);
+				if (reference.size() != chain.data.size())
+					return false;
+				for (size_t i = 0; i < reference.size(); ++i) {
+					if (abs((int)chain.data[i] - (int)reference[i]) > mipCheckTolerance)
+						return false;
+				}
+
+				GenerateMipChain(&pixels[0], width, height, rowPitch, filter, srgb, 1, MIP_GENERATE_SCALAR, other);
+				if (other.data != chain.data)
+					return false;
+				GenerateMipChain(&pixels[0], width, height, rowPitch, filter, srgb, 4, MIP_GENERATE_SIMD, other);
+				if (other.data != chain.data)
+					return false;
+			}
+		}
+	}
+	return true;
+}
+
+static double TimeMipChain(const RgbaImage& image, MipFilter filter, int threadCount, MipGeneratePath path) {
+	// once first so the chain's memory is there
+	MipChain chain;
+	GenerateMipChain(&image.pixels[0], image.width, image.height, (size_t)image.width * 4, filter, true, threadCount, path, chain);
+
+	auto start = std::chrono::steady_clock::now();
+	for (int run = 0; run < mipBenchRunCount; ++run)
+		GenerateMipChain(&image.pixels[0], image.width, image.height, (size_t)image.width * 4, filter, true, threadCount, path, chain);
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / mipBenchRunCount;
+}
+
+static int MipBench(uint32_t seed) {
+	if (!CheckMipFilters()) {
+		fprintf(stderr, "mip filter checks failed\n");
+		return 1;
+	}
+	if (!CheckMipSrgbAndAlpha()) {
+		fprintf(stderr, "mip srgb and alpha checks failed\n");
+		return 1;
+	}
+	if (!CheckMipChains(seed)) {
+		fprintf(stderr, "mip chains differ from the reference or between paths and thread counts with seed %u\n", seed);
+		return 1;
+	}
+	printf("mip checks passed, sse2 and scalar paths and thread counts give the same pixels\n");
+
+	RgbaImage image;
+	GenerateBenchImage(image);
+	double megapixels = (double)image.width * image.height / 1000000.0;
+	std::vector<int> threadCounts = { 1, 2 };
+	if (std::thread::hardware_concurrency() > 2)
+		threadCounts.push_back((int)std::thread::hardware_concurrency());
+
+	for (MipFilter filter : { MIP_FILTER_BOX, MIP_FILTER_TRIANGLE }) {
+		const char* name = filter == MIP_FILTER_BOX ? "box" : "triangle";
+
+		double scalarSeconds = TimeMipChain(image, filter, 1, MIP_GENERATE_SCALAR);
+		printf("%s, scalar, 1 thread: %.2f ms, %.1f mpix/s\n", name, scalarSeconds * 1000.0, megapixels / scalarSeconds);
+
+		for (int threadCount : threadCounts) {
+			double seconds = TimeMipChain(image, filter, threadCount, MIP_GENERATE_SIMD);
+			printf("%s, sse2, %d thread%s: %.2f ms, %.1f mpix/s, %.2fx scalar\n", name, threadCount, threadCount == 1 ? "" : "s", seconds * 1000.0,
+				megapixels / seconds, scalarSeconds / seconds);
+		}
+	}
+	return 0;
+}
+
+// fixed cases of the upload arena on a small buffer, each returns false on the first thing that is off
+static bool CheckUploadArena() {
+	const uint64_t capacity = uploadCheckArenaSize;
+	std::vector<uint8_t> memory((size_t)capacity);
+
+	// two queues, so releases can finish out of order
+	uint64_t firstFenceValue = 0;
+	uint64_t secondFenceValue = 0;
+	UploadArena arena;
+	if (!UploadArenaInit(arena, &memory[0], capacity, NULL, GetBenchFenceValue))
+		return false;
+
+	// a buffer, then a texture that is pushed up to its alignment
+	UploadArenaAllocation a;
+	UploadArenaAllocation b;
+	if (!UploadArenaAllocate(arena, 100, UploadArenaBufferAlignment, a) || a.offset != 0 || a.cpuAddress != &memory[0])
+		return false;
+	if (!UploadArenaAllocate(arena, 1000, UploadArenaTextureAlignment, b) || b.offset != 512 || b.cpuAddress != &memory[512])
+		return false;
+
+	UploadArenaStats stats = UploadArenaGetStats(arena);
+	if (stats.usedBytes != 1512 || stats.paddingBytes != 412 || stats.peakUsedBytes != 1512 || stats.blockedBytes != 0)
+		return false;
+
+	// the second copy finishes first, but its space stays taken until the first one does
+	UploadArenaRelease(arena, b, &secondFenceValue, 1);
+	UploadArenaRelease(arena, a, &firstFenceValue, 1);
+	secondFenceValue = 1;
+	UploadArenaReclaim(arena);
+	stats = UploadArenaGetStats(arena);
+	if (stats.usedBytes != 1512 || stats.paddingBytes != 412 || stats.blockedBytes != 1000)
+		return false;
+
+	// with both done the arena is empty and starts over at the front
+	firstFenceValue = 1;
+	UploadArenaReclaim(arena);
+	stats = UploadArenaGetStats(arena);
+	if (stats.usedBytes != 0 || stats.paddingBytes != 0 || stats.blockedBytes != 0 || stats.peakUsedBytes != 1512)
+		return false;
+
+	// half and a quarter of the buffer, then the first half is done
+	UploadArenaAllocation c;
+	UploadArenaAllocation d;
+	UploadArenaAllocation e;
+	if (!UploadArenaAllocate(arena, capacity / 2, UploadArenaBufferAlignment, c) || c.offset != 0)
+		return false;
+	if (!UploadArenaAllocate(arena, capacity / 4, UploadArenaBufferAlignment, d) || d.offset != capacity / 2)
+		return false;
+	UploadArenaRelease(arena, c, NULL, 0);
+
+	// another half does not fit the last quarter, so it wraps around to the front and the quarter is padding
+	if (!UploadArenaAllocate(arena, capacity / 2, UploadArenaTextureAlignment, e) || e.offset != 0)
+		return false;
+	stats = UploadArenaGetStats(arena);
+	if (stats.usedBytes != capacity || stats.paddingBytes != capacity / 4 || stats.peakUsedBytes != capacity || stats.fragmentation != 0.25)
+		return false;
+
+	// too large, not a power of two, larger than the capacity granularity, nothing at all, and no room left
+	// none of them may change the arena
+	UploadArenaAllocation failed;
+	if (UploadArenaAllocate(arena, capacity + 1, UploadArenaBufferAlignment, failed))
+		return false;
+	if (UploadArenaAllocate(arena, 16, 384, failed) || UploadArenaAllocate(arena, 16, 2 * UploadArenaCapacityGranularity, failed))
+		return false;
+	if (UploadArenaAllocate(arena, 0, UploadArenaBufferAlignment, failed) || UploadArenaAllocate(arena, 16, UploadArenaBufferAlignment, failed))
+		return false;
+	stats = UploadArenaGetStats(arena);
+	if (stats.failedAllocationCount != 5 || stats.allocationCount != 5 || stats.usedBytes != capacity || stats.paddingBytes != capacity / 4)
+		return false;
+	if (stats.allocatedBytes != 1100 + capacity / 2 + capacity / 4 + capacity / 2)
+		return false;
+
+	// the padding goes with the allocation after it
+	UploadArenaRelease(arena, d, NULL, 0);
+	UploadArenaReclaim(arena);
+	stats = UploadArenaGetStats(arena);
+	if (stats.usedBytes != capacity / 2 + capacity / 4 || stats.paddingBytes != capacity / 4)
+		return false;
+
+	UploadArenaRelease(arena, e, &firstFenceValue, 2);
+	UploadArenaReclaim(arena);
+	if (UploadArenaGetStats(arena).usedBytes == 0)
+		return false;
+	firstFenceValue = 2;
+	UploadArenaReclaim(arena);
+	stats = UploadArenaGetStats(arena);
+	if (stats.usedBytes != 0 || stats.paddingBytes != 0)
+		return false;
+
+	UploadArenaDestroy(arena);
+	return true;
+}
+
+// every submission stages a few buffers and textures of random size, the fence trails the submissions like a gpu
+// each allocation is stamped with its id at both ends and checked when its fence passes, so any overlap between
+// live allocations shows up as a broken stamp
+static int UploadBench(uint32_t seed) {
+	if (!CheckUploadArena()) {
+		fprintf(stderr, "upload arena checks failed\n");
+		return 1;
+	}
+	printf("upload arena checks passed\n");
+
+	std::vector<uint8_t> memory((size_t)uploadBenchArenaSize);
+
+	uint64_t completedFenceValue = 0;
+	UploadArena arena;
+	if (!UploadArenaInit(arena, &memory[0], uploadBenchArenaSize, NULL, GetBenchFenceValue)) {
+		fprintf(stderr, "could not create the arena\n");
+		return 1;
+	}
+
+	struct InFlight {
+		UploadArenaAllocation allocation;
+		uint64_t fenceValue;
+	};
+	std::deque<InFlight> inFlight;
+	std::vector<UploadArenaAllocation> submission;
+
+	uint32_t random = seed;
+	uint64_t brokenStamps = 0;
+	uint64_t misaligned = 0;
+	double worstFragmentation = 0.0;
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (uint64_t fenceValue = 1; fenceValue <= uploadBenchSubmissionCount; ++fenceValue) {
+		submission.clear();
+
+		int uploadCount = 1 + NextRandom(random) % 8;
+		for (int i = 0; i < uploadCount; ++i) {
+			// mostly small buffers, now and then a texture of up to 4 MB
+			bool texture = NextRandom(random) % 4 == 0;
+			uint64_t size = texture ? 4096 + NextRandom(random) % (4 * 1024 * 1024) : 16 + NextRandom(random) % 16384;
+			uint64_t alignment = texture ? UploadArenaTextureAlignment : UploadArenaBufferAlignment;
+
+			UploadArenaAllocation allocation;
+			if (!UploadArenaAllocate(arena, size, alignment, allocation))
+				continue;
+
+			if (allocation.offset % alignment != 0)
+				++misaligned;
+
+			memcpy(allocation.cpuAddress, &allocation.id, sizeof(allocation.id));
+			memcpy(allocation.cpuAddress + allocation.size - sizeof(allocation.id), &allocation.id, sizeof(allocation.id));
+			submission.push_back(allocation);
+		}
+
+		for (size_t i = 0; i < submission.size(); ++i) {
+			UploadArenaRelease(arena, submission[i], &completedFenceValue, fenceValue);
+
+			InFlight entry = { submission[i], fenceValue };
+			inFlight.push_back(entry);
+		}
+
+		// the gpu finishes an older submission
+		if (fenceValue > uploadBenchFenceLatency)
+			completedFenceValue = fenceValue - uploadBenchFenceLatency;
+
+		while (!inFlight.empty() && inFlight.front().fenceValue <= completedFenceValue) {
+			const UploadArenaAllocation& allocation = inFlight.front().allocation;
+
+			uint64_t head;
+			uint64_t tail;
+			memcpy(&head, allocation.cpuAddress, sizeof(head));
+			memcpy(&tail, allocation.cpuAddress + allocation.size - sizeof(tail), sizeof(tail));
+			if (head != allocation.id || tail != allocation.id)
+				++brokenStamps;
+
+			inFlight.pop_front();
+		}
+
+		if (fenceValue % 64 == 0) {
+			double fragmentation = UploadArenaGetStats(arena).fragmentation;
+			if (fragmentation > worstFragmentation)
+				worstFragmentation = fragmentation;
+		}
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	UploadArenaStats stats = UploadArenaGetStats(arena);
+	printf("%llu allocations, %llu failed, %.1f ns per allocation\n", (unsigned long long)stats.allocationCount,
+		(unsigned long long)stats.failedAllocationCount, seconds * 1000000000.0 / (double)(stats.allocationCount + stats.failedAllocationCount));
+	printf("%.1f GB staged, peak %.1f of %.1f MB, worst fragmentation %.1f%%\n", stats.allocatedBytes / (1024.0 * 1024.0 * 1024.0),
+		stats.peakUsedBytes / (1024.0 * 1024.0), stats.capacity / (1024.0 * 1024.0), worstFragmentation * 100.0);
+
+	UploadArenaDestroy(arena);
+
+	if (brokenStamps != 0 || misaligned != 0) {
+		fprintf(stderr, "%llu overlapping and %llu misaligned allocations with seed %u\n", (unsigned long long)brokenStamps, (unsigned long long)misaligned, seed);
+		return 1;
+	}
+
+	return 0;
+}
+
+// a page of the frame allocator checks, userData of the allocator's page points at it
+struct FrameAllocBenchPage {
+	std::vector<uint8_t> memory;
+	// frame that last allocated from it
+	uint64_t fenceValue;
+};
+
+struct FrameAllocBenchPages {
+	uint64_t createdCount;
+	uint64_t destroyedCount;
+	// made up, pages start on 64k boundaries like placed resources
+	uint64_t nextGpuAddress;
+};
+
+static bool CreateFrameAllocBenchPage(uint64_t size, FrameAllocatorPage& page, void* context) {
+	FrameAllocBenchPages* pages = static_cast<FrameAllocBenchPages*>(context);
+	FrameAllocBenchPage* benchPage = new FrameAllocBenchPage;
+	benchPage->memory.resize((size_t)size);
+	benchPage->fenceValue = 0;
+
+	page.cpuAddress = &benchPage->memory[0];
+	page.gpuAddress = pages->nextGpuAddress;
+	page.userData = benchPage;
+
+	pages->nextGpuAddress += (size + 65535) & ~65535ull;
+	pages->createdCount++;
+	return true;
+}
+
+static void DestroyFrameAllocBenchPage(FrameAllocatorPage& page, void* context) {
+	static_cast<FrameAllocBenchPages*>(context)->destroyedCount++;
+	delete static_cast<FrameAllocBenchPage*>(page.userData);
+}
+
+static void InitFrameAllocBench(FrameAllocator& allocator, FrameAllocBenchPages& pages, uint64_t pageSize) {
+	pages = {};
+	pages.nextGpuAddress = 65536;
+	FrameAllocatorInit(allocator, pageSize, CreateFrameAllocBenchPage, DestroyFrameAllocBenchPage, &pages);
+}
+
+// allocates for the frame that finishes at fenceValue, false if the allocation is misaligned, does not fit its page
+// or is on a page a frame the gpu has not finished with yet wrote to
+static bool CheckFrameAllocation(FrameAllocator& allocator, uint64_t size, uint64_t alignment, uint64_t fenceValue, uint64_t completedFenceValue,
+	FrameAllocation& allocation) {
+	if (!FrameAllocatorAllocate(allocator, size, alignment, allocation))
+		return false;
+
+	uint64_t requiredAlignment = alignment > FrameAllocatorDefaultAlignment ? alignment : FrameAllocatorDefaultAlignment;
+	if (allocation.offset % requiredAlignment != 0 || allocation.gpuAddress % requiredAlignment != 0)
+		return false;
+
+	FrameAllocBenchPage* page = static_cast<FrameAllocBenchPage*>(allocation.userData);
+	if (allocation.offset + size > page->memory.size() || static_cast<uint8_t*>(allocation.cpuAddress) != &page->memory[0] + allocation.offset)
+		return false;
+
+	if (page->fenceValue != fenceValue && page->fenceValue > completedFenceValue)
+		return false;
+	page->fenceValue = fenceValue;
+	return true;
+}
+
+// fixed cases of the frame allocator on 64k pages, each returns false on the first thing that is off
+static bool CheckFrameAllocator() {
+	FrameAllocator allocator;
+	FrameAllocBenchPages pages;
+	InitFrameAllocBench(allocator, pages, frameAllocCheckPageSize);
+	FrameAllocation a;
+	FrameAllocation b;
+
+	// frame 1: alignments below 256 are raised to it, larger ones are kept
+	if (!CheckFrameAllocation(allocator, 100, 1, 1, 0, a) || a.offset != 0)
+		return false;
+	if (!CheckFrameAllocation(allocator, 100, 16, 1, 0, a) || a.offset != 256)
+		return false;
+	if (!CheckFrameAllocation(allocator, 1, 4096, 1, 0, a) || a.offset != 4096)
+		return false;
+
+	// what does not fit the rest of the page starts a new one
+	if (!CheckFrameAllocation(allocator, frameAllocCheckPageSize - 4096, 256, 1, 0, b) || b.offset != 0 || b.userData == a.userData || pages.createdCount != 2)
+		return false;
+	void* firstFramePage = b.userData;
+	FrameAllocatorFinishFrame(allocator, 1);
+
+	// frame 2: frame 1 is still in flight, so nothing can be reused
+	FrameAllocatorReclaim(allocator, 0);
+	if (!CheckFrameAllocation(allocator, 256, 256, 2, 0, a) || pages.createdCount != 3)
+		return false;
+	FrameAllocatorFinishFrame(allocator, 2);
+
+	// frame 3: frame 1 is done, its pages come back, frame 2's page does not
+	FrameAllocatorReclaim(allocator, 1);
+	if (allocator.freePages.size() != 2 || allocator.retiredPages.size() != 1)
+		return false;
+	if (!CheckFrameAllocation(allocator, frameAllocCheckPageSize, 256, 3, 1, a) || pages.createdCount != 3)
+		return false;
+	if (!CheckFrameAllocation(allocator, 256, 256, 3, 1, b) || b.offset != 0 || pages.createdCount != 3 || a.userData == b.userData)
+		return false;
+	if (a.userData != firstFramePage && b.userData != firstFramePage)
+		return false;
+	void* currentPage = b.userData;
+
+	// a page of its own for more than a page, rounded up to whole pages
+	if (!CheckFrameAllocation(allocator, 3 * frameAllocCheckPageSize + 1, 256, 3, 1, a) || a.offset != 0 || pages.createdCount != 4)
+		return false;
+	void* dedicatedPage = a.userData;
+	if (static_cast<FrameAllocBenchPage*>(dedicatedPage)->memory.size() != 4 * frameAllocCheckPageSize)
+		return false;
+
+	// the page that was being filled is still filled after it
+	if (!CheckFrameAllocation(allocator, 256, 256, 3, 1, b) || b.userData != currentPage || b.offset != 256 || pages.createdCount != 4)
+		return false;
+	FrameAllocatorFinishFrame(allocator, 3);
+
+	// frame 4: the dedicated page is in flight, another one is made. frame 2's page comes back for a normal allocation
+	FrameAllocatorReclaim(allocator, 2);
+	if (!CheckFrameAllocation(allocator, 3 * frameAllocCheckPageSize + 1, 256, 4, 2, a) || a.userData == dedicatedPage || pages.createdCount != 5)
+		return false;
+	if (!CheckFrameAllocation(allocator, 256, 256, 4, 2, b) || pages.createdCount != 5)
+		return false;
+	FrameAllocatorFinishFrame(allocator, 4);
+
+	// frame 5: everything is done, the dedicated pages are kept apart from the normal ones
+	FrameAllocatorReclaim(allocator, 4);
+	if (!allocator.retiredPages.empty() || allocator.freePages.size() != 3 || allocator.freeDedicatedPages.size() != 2)
+		return false;
+
+	// normal allocations never take a dedicated page, a fourth page is made instead
+	for (int i = 0; i < 4; ++i) {
+		if (!CheckFrameAllocation(allocator, frameAllocCheckPageSize, 256, 5, 4, a) || static_cast<FrameAllocBenchPage*>(a.userData)->memory.size() != frameAllocCheckPageSize)
+			return false;
+	}
+	if (pages.createdCount != 6)
+		return false;
+
+	// the large allocation gets a dedicated page back instead of a new one
+	if (!CheckFrameAllocation(allocator, 3 * frameAllocCheckPageSize + 1, 256, 5, 4, a) || pages.createdCount != 6)
+		return false;
+	if (static_cast<FrameAllocBenchPage*>(a.userData)->memory.size() != 4 * frameAllocCheckPageSize)
+		return false;
+
+	// the other dedicated page was not needed, so it is released
+	FrameAllocatorFinishFrame(allocator, 5);
+	if (pages.destroyedCount != 1 || !allocator.freeDedicatedPages.empty())
+		return false;
+
+	if (allocator.stats.pageCount != 5 || allocator.stats.reservedBytes != 8 * frameAllocCheckPageSize)
+		return false;
+	if (allocator.stats.lastFrameAllocations != 5 || allocator.stats.highWaterAllocations != 5)
+		return false;
+
+	FrameAllocatorDestroy(allocator);
+	return pages.destroyedCount == pages.createdCount;
+}
+
+// random frames of random sizes and alignments, some larger than a page, with the gpu finishing frames anywhere
+// between right away and frameAllocBenchFramesInFlight behind. every allocation is checked
+static bool FuzzFrameAllocator(uint32_t seed) {
+	FrameAllocator allocator;
+	FrameAllocBenchPages pages;
+	InitFrameAllocBench(allocator, pages, frameAllocCheckPageSize);
+
+	uint32_t random = seed;
+	uint64_t completedFenceValue = 0;
+	bool passed = true;
+
+	for (uint64_t fenceValue = 1; fenceValue <= frameAllocFuzzFrameCount && passed; ++fenceValue) {
+		// the renderer waits for the frame that used its frame context before recording into it again
+		if (fenceValue > frameAllocBenchFramesInFlight && completedFenceValue < fenceValue - frameAllocBenchFramesInFlight)
+			completedFenceValue = fenceValue - frameAllocBenchFramesInFlight;
+		if (completedFenceValue + 1 < fenceValue && NextRandom(random) % 4 == 0)
+			completedFenceValue++;
+		FrameAllocatorReclaim(allocator, completedFenceValue);
+
+		int allocationCount = NextRandom(random) % 200;
+		for (int i = 0; i < allocationCount && passed; ++i) {
+			uint64_t size = NextRandom(random) % 64 == 0 ? frameAllocCheckPageSize + NextRandom(random) % (2 * frameAllocCheckPageSize) : 1 + NextRandom(random) % 2048;
+			uint64_t alignment = 1ull << (NextRandom(random) % 17);
+
+			FrameAllocation allocation;
+			passed = CheckFrameAllocation(allocator, size, alignment, fenceValue, completedFenceValue, allocation);
+		}
+
+		FrameAllocatorFinishFrame(allocator, fenceValue);
+	}
+
+	FrameAllocatorDestroy(allocator);
+	return passed && pages.destroyedCount == pages.createdCount;
+}
+
+// the same load every frame, frameAllocBenchFramesInFlight frames in flight and one more being recorded can never
+// need more than that many frames' worth of pages
+static bool CheckFrameAllocatorBounded() {
+	FrameAllocator allocator;
+	FrameAllocBenchPages pages;
+	InitFrameAllocBench(allocator, pages, frameAllocCheckPageSize);
+
+	// 1000 constant buffers are four pages, plus a dedicated page
+	const uint64_t pagesPerFrame = 5;
+	uint64_t completedFenceValue = 0;
+	bool passed = true;
+
+	for (uint64_t fenceValue = 1; fenceValue <= 1000 && passed; ++fenceValue) {
+		if (fenceValue > frameAllocBenchFramesInFlight)
+			completedFenceValue = fenceValue - frameAllocBenchFramesInFlight;
+		FrameAllocatorReclaim(allocator, completedFenceValue);
+
+		FrameAllocation allocation;
+		for (int i = 0; i < 1000 && passed; ++i)
+			passed = CheckFrameAllocation(allocator, 200, 256, fenceValue, completedFenceValue, allocation);
+		if (passed)
+			passed = CheckFrameAllocation(allocator, 2 * frameAllocCheckPageSize, 256, fenceValue, completedFenceValue, allocation);
+
+		FrameAllocatorFinishFrame(allocator, fenceValue);
+
+		if (allocator.stats.pageCount > (frameAllocBenchFramesInFlight + 1) * pagesPerFrame)
+			passed = false;
+	}
+
+	FrameAllocatorDestroy(allocator);
+	return passed;
+}
+
+// frames of frameAllocBenchAllocationCount constant buffer sized allocations on the renderer's page size
+static void BenchFrameAllocator(uint32_t seed) {
+	FrameAllocator allocator;
+	FrameAllocBenchPages pages;
+	InitFrameAllocBench(allocator, pages, FrameAllocatorDefaultPageSize);
+
+	std::vector<uint64_t> sizes(frameAllocBenchAllocationCount);
+	uint32_t random = seed;
+	for (size_t i = 0; i < sizes.size(); ++i)
+		sizes[i] = 64 + NextRandom(random) % 1024;
+
+	uint64_t failedCount = 0;
+	auto start = std::chrono::steady_clock::now();
+
+	for (uint64_t fenceValue = 1; fenceValue <= frameAllocBenchFrameCount; ++fenceValue) {
+		if (fenceValue > frameAllocBenchFramesInFlight)
+			FrameAllocatorReclaim(allocator, fenceValue - frameAllocBenchFramesInFlight);
+
+		for (size_t i = 0; i < sizes.size(); ++i) {
+			FrameAllocation allocation;
+			if (!FrameAllocatorAllocate(allocator, sizes[i], FrameAllocatorDefaultAlignment, allocation))
+				++failedCount;
+		}
+
+		FrameAllocatorFinishFrame(allocator, fenceValue);
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	uint64_t allocationCount = (uint64_t)frameAllocBenchFrameCount * frameAllocBenchAllocationCount;
+	printf("%llu allocations, %llu failed, %.1f M per second, %.1f ns each\n", (unsigned long long)allocationCount, (unsigned long long)failedCount,
+		allocationCount / seconds / 1000000.0, seconds * 1000000000.0 / (double)allocationCount);
+	printf("%.1f mb a frame, %llu pages of %.1f mb\n", allocator.stats.highWaterBytes / (1024.0 * 1024.0),
+		(unsigned long long)allocator.stats.pageCount, FrameAllocatorDefaultPageSize / (1024.0 * 1024.0));
+
+	FrameAllocatorDestroy(allocator);
+}
+
+static int FrameAllocBench(uint32_t seed) {
+	if (!CheckFrameAllocator()) {
+		fprintf(stderr, "frame allocator checks failed\n");
+		return 1;
+	}
+	if (!FuzzFrameAllocator(seed)) {
+		fprintf(stderr, "frame allocator fuzzing failed with seed %u\n", seed);
+		return 1;
+	}
+	if (!CheckFrameAllocatorBounded()) {
+		fprintf(stderr, "frame allocator made more pages than the frames in flight need\n");
+		return 1;
+	}
+	printf("frame allocator checks passed\n");
+
+	BenchFrameAllocator(seed);
+	return 0;
+}
+
+// fixed cases of the allocator, each returns false on the first thing that is off
+static bool CheckTlsf() {
+	TlsfAllocator allocator;
+	TlsfAllocation a;
+	TlsfAllocation b;
+	TlsfAllocation c;
+
+	// the whole range in one piece, and nothing more
+	TlsfInit(allocator, 1024);
+	if (!TlsfAllocate(allocator, 1024, 1, a) || a.offset != 0 || TlsfAllocate(allocator, 1, 1, b) || !TlsfValidate(allocator))
+		return false;
+	TlsfFree(allocator, a.block);
+	if (!TlsfIsEmpty(allocator) || !TlsfValidate(allocator))
+		return false;
+
+	// freeing the middle block and then its neighbours leaves one free block again
+	if (!TlsfAllocate(allocator, 100, 1, a) || !TlsfAllocate(allocator, 200, 1, b) || !TlsfAllocate(allocator, 300, 1, c))
+		return false;
+	if (a.offset != 0 || b.offset != 100 || c.offset != 300)
+		return false;
+	TlsfFree(allocator, b.block);
+	TlsfFree(allocator, a.block);
+	TlsfFree(allocator, c.block);
+	TlsfStats stats = TlsfGetStats(allocator);
+	if (stats.freeBlockCount != 1 || stats.freeBytes != 1024 || !TlsfValidate(allocator))
+		return false;
+
+	// alignment padding is given back as a free block
+	if (!TlsfAllocate(allocator, 10, 1, a) || !TlsfAllocate(allocator, 256, 256, b) || b.offset != 256 || !TlsfValidate(allocator))
+		return false;
+	if (!TlsfAllocate(allocator, 200, 1, c) || c.offset != 10 || !TlsfValidate(allocator))
+		return false;
+
+	// bad arguments
+	if (TlsfAllocate(allocator, 0, 1, a) || TlsfAllocate(allocator, 16, 3, a) || TlsfAllocate(allocator, 4096, 1, a))
+		return false;
+
+	// a 64k aligned heap, like the gpu heaps use
+	TlsfInit(allocator, 64 * 65536);
+	for (int i = 0; i < 64; ++i) {
+		if (!TlsfAllocate(allocator, 65536, 65536, a) || a.offset != (uint64_t)i * 65536)
+			return false;
+	}
+	return !TlsfAllocate(allocator, 1, 1, a) && TlsfValidate(allocator);
+}
+
+struct HeapBenchAllocation {
+	TlsfAllocation allocation;
+	uint64_t alignment;
+};
+
+// random sizes and alignments, freed in random order, validated as it goes
+// live allocations are checked for overlap with each other every time the allocator is validated
+static bool FuzzTlsf(uint32_t seed) {
+	const uint64_t size = 1 << 20;
+
+	TlsfAllocator allocator;
+	TlsfInit(allocator, size);
+
+	std::vector<HeapBenchAllocation> live;
+	std::vector<uint8_t> owner(size);
+	uint32_t random = seed;
+
+	for (int i = 0; i < heapFuzzOperationCount; ++i) {
+		if (live.empty() || NextRandom(random) % 100 < 55) {
+			HeapBenchAllocation entry;
+			entry.alignment = 1ull << (NextRandom(random) % 13);
+			uint64_t allocationSize = 1 + NextRandom(random) % ((NextRandom(random) % 4 == 0) ? 65536 : 2048);
+
+			if (TlsfAllocate(allocator, allocationSize, entry.alignment, entry.allocation)) {
+				if (entry.allocation.offset % entry.alignment != 0 || entry.allocation.offset + allocationSize > size)
+					return false;
+				live.push_back(entry);
+			}
+		}
+		else {
+			size_t index = NextRandom(random) % live.size();
+			TlsfFree(allocator, live[index].allocation.block);
+			live[index] = live.back();
+			live.pop_back();
+		}
+
+		if (i % 1000 == 0) {
+			if (!TlsfValidate(allocator))
+				return false;
+
+			std::fill(owner.begin(), owner.end(), 0);
+			for (size_t j = 0; j < live.size(); ++j) {
+				for (uint64_t k = 0; k < live[j].allocation.size; ++k) {
+					if (owner[live[j].allocation.offset + k]++ != 0)
+						return false;
+				}
+			}
+		}
+	}
+
+	for (size_t i = 0; i < live.size(); ++i)
+		TlsfFree(allocator, live[i].allocation.block);
+
+	return TlsfIsEmpty(allocator) && TlsfValidate(allocator) && TlsfGetStats(allocator).freeBlockCount == 1;
+}
+
+// a heap kept around 80% full with placed resource sized allocations: mostly 64k buffers and small textures,
+// some large textures of up to 16 mb, all on 64k boundaries
+static void BenchTlsf(uint32_t seed) {
+	TlsfAllocator allocator;
+	TlsfInit(allocator, heapBenchHeapSize);
+
+	const uint64_t placementAlignment = 65536;
+	const uint64_t targetBytes = heapBenchHeapSize / 10 * 8;
+
+	std::vector<TlsfAllocation> live;
+	uint32_t random = seed;
+	int failedCount = 0;
+	double worstFragmentation = 0.0;
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < heapBenchOperationCount; ++i) {
+		if (allocator.usedBytes < targetBytes || live.empty()) {
+			uint32_t kind = NextRandom(random) % 16;
+			uint64_t blocks = kind < 10 ? 1 : kind < 15 ? 1 + NextRandom(random) % 16 : 16 + NextRandom(random) % 240;
+
+			TlsfAllocation allocation;
+			if (TlsfAllocate(allocator, blocks * placementAlignment, placementAlignment, allocation))
+				live.push_back(allocation);
+			else
+				++failedCount;
+		}
+		else {
+			size_t index = NextRandom(random) % live.size();
+			TlsfFree(allocator, live[index].block);
+			live[index] = live.back();
+			live.pop_back();
+		}
+
+		if (i % 10000 == 0) {
+			TlsfStats stats = TlsfGetStats(allocator);
+			if (stats.fragmentation > worstFragmentation)
+				worstFragmentation = stats.fragmentation;
+		}
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	TlsfStats stats = TlsfGetStats(allocator);
+	printf("%d operations, %.1f ns each, %d failed\n", heapBenchOperationCount, seconds * 1000000000.0 / heapBenchOperationCount, failedCount);
+	printf("%.1f of %.1f mb used, %u free blocks, largest %.1f mb, fragmentation %.1f%% (worst %.1f%%)\n",
+		stats.usedBytes / (1024.0 * 1024.0), stats.size / (1024.0 * 1024.0), stats.freeBlockCount,
+		stats.largestFreeBlock / (1024.0 * 1024.0), stats.fragmentation * 100.0, worstFragmentation * 100.0);
+}
+
+static int HeapBench(uint32_t seed) {
+	if (!CheckTlsf()) {
+		fprintf(stderr, "allocator checks failed\n");
+		return 1;
+	}
+	printf("allocator checks passed\n");
+
+	if (!FuzzTlsf(seed)) {
+		fprintf(stderr, "fuzzing failed with seed %u\n", seed);
+		return 1;
+	}
+	printf("%d fuzzed operations passed\n", heapFuzzOperationCount);
+
+	BenchTlsf(seed);
+	return 0;
+}
+
+// fixed cases of the free list and the ring, each returns false on the first thing that is off
+static bool CheckDescriptorAllocators() {
+	DescriptorFreeList list;
+	uint32_t a;
+	uint32_t b;
+
+	// hands out 0, 1, ... and nothing more than its capacity
+	DescriptorFreeListInit(list, 4);
+	for (uint32_t i = 0; i < 4; ++i) {
+		if (!DescriptorFreeListAllocate(list, a) || a != i)
+			return false;
+	}
+	if (DescriptorFreeListAllocate(list, a))
+		return false;
+
+	// freed right away, reused right away
+	DescriptorFreeListFree(list, 2, 0);
+	if (!DescriptorFreeListAllocate(list, a) || a != 2)
+		return false;
+
+	// held back until its fence value, and in order
+	DescriptorFreeListFree(list, 1, 5);
+	DescriptorFreeListFree(list, 3, 6);
+	DescriptorFreeListReclaim(list, 4);
+	if (DescriptorFreeListAllocate(list, a))
+		return false;
+	DescriptorFreeListReclaim(list, 5);
+	if (!DescriptorFreeListAllocate(list, a) || a != 1 || DescriptorFreeListAllocate(list, b))
+		return false;
+	DescriptorFreeListReclaim(list, 6);
+	if (!DescriptorFreeListAllocate(list, a) || a != 3 || list.allocatedCount != 4 || list.peakAllocatedCount != 4)
+		return false;
+
+	DescriptorRing ring;
+	DescriptorRingInit(ring, 16);
+
+	// tables are contiguous and follow each other
+	if (!DescriptorRingAllocate(ring, 4, a) || a != 0 || !DescriptorRingAllocate(ring, 6, b) || b != 4)
+		return false;
+	DescriptorRingFinishFrame(ring, 1);
+
+	// a table that does not fit before the end starts over at 0, which is still in use
+	if (DescriptorRingAllocate(ring, 8, a))
+		return false;
+	if (!DescriptorRingAllocate(ring, 6, a) || a != 10 || DescriptorRingAllocate(ring, 1, a))
+		return false;
+	DescriptorRingFinishFrame(ring, 2);
+
+	DescriptorRingReclaim(ring, 1);
+	if (!DescriptorRingAllocate(ring, 8, a) || a != 0 || DescriptorRingAllocate(ring, 3, a))
+		return false;
+	DescriptorRingFinishFrame(ring, 3);
+
+	// an empty frame adds nothing to wait for
+	DescriptorRingFinishFrame(ring, 4);
+	if (ring.frames.size() != 2)
+		return false;
+
+	DescriptorRingReclaim(ring, 4);
+	if (!DescriptorRingAllocate(ring, 16, a) || a != 0)
+		return false;
+
+	// bad arguments
+	return !DescriptorRingAllocate(ring, 0, a) && !DescriptorRingAllocate(ring, 17, a);
+}
+
+struct DescriptorBenchTable {
+	uint32_t first;
+	uint32_t count;
+	uint64_t fenceValue;
+};
+
+// frames of random bindless allocations and frees and transient tables, with a gpu that finishes frames a few
+// frames late. every descriptor the gpu could still read must stay out of the allocators' hands
+static bool FuzzDescriptorAllocators(uint32_t seed) {
+	DescriptorFreeList list;
+	DescriptorFreeListInit(list, descriptorBenchBindlessCount);
+	DescriptorRing ring;
+	DescriptorRingInit(ring, descriptorBenchRingCount);
+
+	// 0 free, 1 allocated, 2 freed but maybe still read by the gpu
+	std::vector<uint8_t> bindlessStates(descriptorBenchBindlessCount);
+	std::vector<uint64_t> bindlessFenceValues(descriptorBenchBindlessCount);
+	std::vector<uint32_t> allocated;
+	std::deque<DescriptorBenchTable> tables;
+	std::vector<uint8_t> ringOwners(descriptorBenchRingCount);
+	uint32_t random = seed;
+
+	for (int frame = 1; frame <= descriptorFuzzFrameCount; ++frame) {
+		uint64_t fenceValue = (uint64_t)frame;
+		uint64_t completedValue = frame > descriptorBenchFenceLatency ? fenceValue - descriptorBenchFenceLatency : 0;
+
+		DescriptorFreeListReclaim(list, completedValue);
+		DescriptorRingReclaim(ring, completedValue);
+
+		for (uint32_t i = 0; i < descriptorBenchBindlessCount; ++i) {
+			if (bindlessStates[i] == 2 && bindlessFenceValues[i] <= completedValue)
+				bindlessStates[i] = 0;
+		}
+		while (!tables.empty() && tables.front().fenceValue <= completedValue) {
+			for (uint32_t i = 0; i < tables.front().count; ++i)
+				ringOwners[tables.front().first + i] = 0;
+			tables.pop_front();
+		}
+
+		int operationCount = (int)(NextRandom(random) % 64);
+		for (int i = 0; i < operationCount; ++i) {
+			if (allocated.empty() || NextRandom(random) % 100 < 52) {
+				uint32_t index;
+				if (!DescriptorFreeListAllocate(list, index))
+					continue;
+				if (index >= descriptorBenchBindlessCount || bindlessStates[index] != 0)
+					return false;
+				bindlessStates[index] = 1;
+				allocated.push_back(index);
+			}
+			else {
+				size_t slot = NextRandom(random) % allocated.size();
+				uint32_t index = allocated[slot];
+				allocated[slot] = allocated.back();
+				allocated.pop_back();
+
+				// some are freed while the gpu is known to be idle
+				bool idle = NextRandom(random) % 8 == 0;
+				DescriptorFreeListFree(list, index, idle ? 0 : fenceValue);
+				bindlessStates[index] = idle ? 0 : 2;
+				bindlessFenceValues[index] = fenceValue;
+			}
+		}
+
+		int tableCount = (int)(NextRandom(random) % 8);
+		for (int i = 0; i < tableCount; ++i) {
+			DescriptorBenchTable table;
+			table.count = 1 + NextRandom(random) % 64;
+			table.fenceValue = fenceValue;
+			if (!DescriptorRingAllocate(ring, table.count, table.first))
+				continue;
+
+			if (table.first + table.count > descriptorBenchRingCount)
+				return false;
+			for (uint32_t j = 0; j < table.count; ++j) {
+				if (ringOwners[table.first + j]++ != 0)
+					return false;
+			}
+			tables.push_back(table);
+		}
+
+		DescriptorRingFinishFrame(ring, fenceValue);
+
+		if (list.allocatedCount != allocated.size())
+			return false;
+	}
+
+	return true;
+}
+
+static int DescriptorBench(uint32_t seed) {
+	if (!CheckDescriptorAllocators()) {
+		fprintf(stderr, "descriptor allocator checks failed\n");
+		return 1;
+	}
+	printf("descriptor allocator checks passed\n");
+
+	if (!FuzzDescriptorAllocators(seed)) {
+		fprintf(stderr, "fuzzing failed with seed %u\n", seed);
+		return 1;
+	}
+	printf("%d fuzzed frames passed\n", descriptorFuzzFrameCount);
+
+	// a texture view allocated and freed again per operation, with a short tail of retired descriptors
+	DescriptorFreeList list;
+	DescriptorFreeListInit(list, descriptorBenchBindlessCount);
+	uint32_t index = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < descriptorBenchOperationCount; ++i) {
+		DescriptorFreeListAllocate(list, index);
+		DescriptorFreeListFree(list, index, (uint64_t)i + 1);
+		DescriptorFreeListReclaim(list, (uint64_t)i);
+	}
+	double freeListSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// four small tables per frame
+	DescriptorRing ring;
+	DescriptorRingInit(ring, descriptorBenchRingCount);
+
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < descriptorBenchOperationCount / 4; ++i) {
+		for (int j = 0; j < 4; ++j)
+			DescriptorRingAllocate(ring, 8, index);
+		DescriptorRingFinishFrame(ring, (uint64_t)i + 1);
+		DescriptorRingReclaim(ring, (uint64_t)i);
+	}
+	double ringSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	printf("free list: %.1f ns per allocate, free and reclaim\n", freeListSeconds * 1000000000.0 / descriptorBenchOperationCount);
+	printf("ring: %.1f ns per table\n", ringSeconds * 1000000000.0 / descriptorBenchOperationCount);
+	return 0;
+}
+
+// stands in for a command list, keeps every barrier and counts the ResourceBarrier calls
+struct BarrierRecording {
+	std::vector<ResourceStateBarrier> barriers;
+	int callCount;
+};
+
+static void RecordBarriers(const ResourceStateBarrier* barriers, uint32_t count, void* context) {
+	BarrierRecording* recording = static_cast<BarrierRecording*>(context);
+	recording->barriers.insert(recording->barriers.end(), barriers, barriers + count);
+	++recording->callCount;
+}
+
+static bool IsBarrier(const ResourceStateBarrier& barrier, void* resource, uint32_t subresource, uint32_t stateBefore, uint32_t stateAfter, ResourceBarrierFlag flag) {
+	return barrier.resource == resource && barrier.subresource == subresource && barrier.stateBefore == stateBefore &&
+		barrier.stateAfter == stateAfter && barrier.flag == flag;
+}
+
+// fixed cases, each returns false on the first barrier that is off
+static bool CheckResourceStateTracker() {
+	int resources[3];
+	void* a = &resources[0];
+	void* b = &resources[1];
+	void* texture = &resources[2];
+	const uint32_t all = resourceStateAllSubresources;
+
+	ResourceStateTracker tracker;
+	ResourceStateTrackerInit(tracker, stateReads);
+	ResourceStateTrackerRegister(tracker, a, 1, stateCommon);
+	ResourceStateTrackerRegister(tracker, b, 1, stateRenderTarget);
+	ResourceStateTrackerRegister(tracker, texture, 4, stateCopyDest);
+
+	BarrierRecording recording;
+	recording.callCount = 0;
+
+	// nothing queued, nothing recorded, and unknown resources are refused
+	ResourceStateTrackerFlush(tracker, RecordBarriers, &recording);
+	int unknown;
+	if (recording.callCount != 0 || ResourceStateTrackerTransition(tracker, &unknown, all, stateCommon))
+		return false;
+
+	// A to B then B to C is one barrier, and everything goes out in one call
+	ResourceStateTrackerTransition(tracker, a, all, stateCopyDest);
+	ResourceStateTrackerTransition(tracker, b, all, stateCommon);
+	ResourceStateTrackerTransition(tracker, a, all, stateUnorderedAccess);
+	ResourceStateTrackerFlush(tracker, RecordBarriers, &recording);
+	if (recording.callCount != 1 || recording.barriers.size() != 2 ||
+		!IsBarrier(recording.barriers[0], a, all, stateCommon, stateUnorderedAccess, RESOURCE_BARRIER_FLAG_NONE) ||
+		!IsBarrier(recording.barriers[1], b, all, stateRenderTarget, stateCommon, RESOURCE_BARRIER_FLAG_NONE))
+		return false;
+
+	// A to B to A is nothing, and so is going to the state it is already in
+	recording.barriers.clear();
+	ResourceStateTrackerTransition(tracker, a, all, stateRenderTarget);
+	ResourceStateTrackerTransition(tracker, a, all, stateUnorderedAccess);
+	ResourceStateTrackerTransition(tracker, b, all, stateCommon);
+	ResourceStateTrackerFlush(tracker, RecordBarriers, &recording);
+	if (recording.callCount != 1 || !recording.barriers.empty())
+		return false;
+
+	// reads combine, and a read that is already covered needs no barrier
+	ResourceStateTrackerTransition(tracker, a, all, statePixelShaderResource);
+	ResourceStateTrackerFlush(tracker, RecordBarriers, &recording);
+	ResourceStateTrackerTransition(tracker, a, all, stateNonPixelShaderResource);
+	ResourceStateTrackerFlush(tracker, RecordBarriers, &recording);
+	ResourceStateTrackerTransition(tracker, a, all, statePixelShaderResource);
+	ResourceStateTrackerFlush(tracker, RecordBarriers, &recording);
+	if (recording.callCount != 3 || recording.barriers.size() != 2 ||
+		!IsBarrier(recording.barriers[1], a, all, statePixelShaderResource, statePixelShaderResource | stateNonPixelShaderResource, RESOURCE_BARRIER_FLAG_NONE) ||
+		ResourceStateTrackerGetState(tracker, a, all) != (statePixelShaderResource | stateNonPixelShaderResource))
+		return false;
+
+	// restoring asks for exactly the state, even if a combined read covers it
+	recording.barriers.clear();
+	ResourceStateTrackerRestore(tracker, a, statePixelShaderResource);
+	ResourceStateTrackerFlush(tracker, RecordBarriers, &recording);
+	if (recording.barriers.size() != 1 || recording.barriers[0].stateAfter != statePixelShaderResource)
+		return false;
+
+	// a write is never combined
+	recording.barriers.clear();
+	ResourceStateTrackerTransition(tracker, a, all, stateCopyDest);
+	ResourceStateTrackerFlush(tracker, RecordBarriers, &recording);
+	if (recording.barriers.size() != 1 || recording.barriers[0].stateAfter != stateCopyDest)
+		return false;
+
+	// one mip on its own splits the states, all of them again only moves the ones that differ and collapses
+	recording.barriers.clear();
+	ResourceStateTrackerTransition(tracker, texture, 2, stateCopySource);
+	if (ResourceStateTrackerGetState(tracker, texture, 2) != stateCopySource || ResourceStateTrackerGetState(tracker, texture, 1) != stateCopyDest)
+		return false;
+	ResourceStateTrackerFlush(tracker, RecordBarriers, &recording);
+	ResourceStateTrackerTransition(tracker, texture, all, stateCopySource);
+	ResourceStateTrackerFlush(tracker, RecordBarriers, &recording);
+	if (recording.barriers.size() != 4 ||
+		!IsBarrier(recording.barriers[0], texture, 2, stateCopyDest, stateCopySource, RESOURCE_BARRIER_FLAG_NONE) ||
+		!IsBarrier(recording.barriers[1], texture, 0, stateCopyDest, stateCopySource, RESOURCE_BARRIER_FLAG_NONE) ||
+		!IsBarrier(recording.barriers[3], texture, 3, stateCopyDest, stateCopySource, RESOURCE_BARRIER_FLAG_NONE) ||
+		!tracker.resources[texture].uniform)
+		return false;
+
+	// a split barrier begins and ends as two halves with the same states
+	recording.barriers.clear();
+	ResourceStateTrackerBeginTransition(tracker, texture, all, stateUnorderedAccess);
+	ResourceStateTrackerFlush(tracker, RecordBarriers, &recording);
+	ResourceStateTrackerEndTransitions(tracker);
+	ResourceStateTrackerFlush(tracker, RecordBarriers, &recording);
+	if (recording.barriers.size() != 2 ||
+		!IsBarrier(recording.barriers[0], texture, all, stateCopySource, stateUnorderedAccess, RESOURCE_BARRIER_FLAG_BEGIN_ONLY) ||
+		!IsBarrier(recording.barriers[1], texture, all, stateCopySource, stateUnorderedAccess, RESOURCE_BARRIER_FLAG_END_ONLY))
+		return false;
+
+	// using the resource before it was ended ends it first, and the end is never merged away
+	recording.barriers.clear();
+	ResourceStateTrackerBeginTransition(tracker, texture, all, stateCopyDest);
+	ResourceStateTrackerTransition(tracker, texture, all, statePixelShaderResource);
+	ResourceStateTrackerFlush(tracker, RecordBarriers, &recording);
+	if (recording.barriers.size() != 3 || !tracker.splitTransitions.empty() ||
+		recording.barriers[0].flag != RESOURCE_BARRIER_FLAG_BEGIN_ONLY || recording.barriers[1].flag != RESOURCE_BARRIER_FLAG_END_ONLY ||
+		!IsBarrier(recording.barriers[2], texture, all, stateCopyDest, statePixelShaderResource, RESOURCE_BARRIER_FLAG_NONE))
+		return false;
+
+	// unregistering drops whatever was queued for the resource
+	recording.barriers.clear();
+	ResourceStateTrackerTransition(tracker, a, all, stateRenderTarget);
+	ResourceStateTrackerBeginTransition(tracker, texture, all, stateCopySource);
+	ResourceStateTrackerUnregister(tracker, texture);
+	ResourceStateTrackerEndTransitions(tracker);
+	ResourceStateTrackerFlush(tracker, RecordBarriers, &recording);
+	return recording.barriers.size() == 1 && recording.barriers[0].resource == a;
+}
+
+// the state every subresource is in on the simulated gpu, and the state a begun split barrier goes to
+struct BarrierFuzzResource {
+	std::vector<uint32_t> states;
+	std::vector<uint32_t> splitStates;
+	std::vector<bool> splitting;
+};
+
+// applies one recorded barrier the way the gpu would, false if it starts from a state the subresource is not in
+static bool ApplyFuzzBarrier(BarrierFuzzResource& resource, const ResourceStateBarrier& barrier) {
+	uint32_t first = barrier.subresource == resourceStateAllSubresources ? 0 : barrier.subresource;
+	uint32_t last = barrier.subresource == resourceStateAllSubresources ? (uint32_t)resource.states.size() : first + 1;
+	if (last > resource.states.size())
+		return false;
+
+	for (uint32_t i = first; i < last; ++i) {
+		if (resource.states[i] != barrier.stateBefore || barrier.stateBefore == barrier.stateAfter)
+			return false;
+
+		if (barrier.flag == RESOURCE_BARRIER_FLAG_BEGIN_ONLY) {
+			if (resource.splitting[i])
+				return false;
+			resource.splitting[i] = true;
+			resource.splitStates[i] = barrier.stateAfter;
+		}
+		else if (barrier.flag == RESOURCE_BARRIER_FLAG_END_ONLY) {
+			if (!resource.splitting[i] || resource.splitStates[i] != barrier.stateAfter)
+				return false;
+			resource.splitting[i] = false;
+			resource.states[i] = barrier.stateAfter;
+		}
+		else {
+			if (resource.splitting[i])
+				return false;
+			resource.states[i] = barrier.stateAfter;
+		}
+	}
+
+	return true;
+}
+
+// random transitions, split or not, on whole resources and single subresources, flushed at random points
+// applying every flushed barrier has to leave the simulated gpu in the states the tracker reports
+static bool FuzzResourceStateTracker(uint32_t seed) {
+	static const uint32_t states[] = {
+		stateCommon, stateRenderTarget, stateUnorderedAccess, stateDepthWrite, stateDepthRead,
+		stateNonPixelShaderResource, statePixelShaderResource, stateCopyDest, stateCopySource
+	};
+	const uint32_t stateCount = sizeof(states) / sizeof(states[0]);
+
+	ResourceStateTracker tracker;
+	ResourceStateTrackerInit(tracker, stateReads);
+
+	std::vector<BarrierFuzzResource> resources(barrierFuzzResourceCount);
+	uint32_t random = seed;
+	for (uint32_t i = 0; i < barrierFuzzResourceCount; ++i) {
+		uint32_t subresourceCount = 1 + NextRandom(random) % 6;
+		uint32_t initialState = states[NextRandom(random) % stateCount];
+		resources[i].states.assign(subresourceCount, initialState);
+		resources[i].splitStates.assign(subresourceCount, 0);
+		resources[i].splitting.assign(subresourceCount, false);
+		ResourceStateTrackerRegister(tracker, &resources[i], subresourceCount, initialState);
+	}
+
+	BarrierRecording recording;
+	recording.callCount = 0;
+
+	for (int operation = 0; operation < barrierFuzzOperationCount; ++operation) {
+		uint32_t index = NextRandom(random) % barrierFuzzResourceCount;
+		BarrierFuzzResource& resource = resources[index];
+		uint32_t subresourceCount = (uint32_t)resource.states.size();
+		uint32_t subresource = NextRandom(random) % 2 == 0 ? resourceStateAllSubresources : NextRandom(random) % subresourceCount;
+		uint32_t state = states[NextRandom(random) % stateCount];
+
+		bool split = NextRandom(random) % 4 == 0;
+		if (split)
+			ResourceStateTrackerBeginTransition(tracker, &resource, subresource, state);
+		else
+			ResourceStateTrackerTransition(tracker, &resource, subresource, state);
+
+		// what was asked for is there, or covered by a combined read state
+		uint32_t first = subresource == resourceStateAllSubresources ? 0 : subresource;
+		uint32_t last = subresource == resourceStateAllSubresources ? subresourceCount : subresource + 1;
+		for (uint32_t i = first; i < last; ++i) {
+			uint32_t tracked = ResourceStateTrackerGetState(tracker, &resource, i);
+			if (tracked != state && (state == stateCommon || (tracked & state) != state || (tracked & ~stateReads) != 0))
+				return false;
+		}
+
+		uint32_t flushRoll = NextRandom(random) % 16;
+		if (flushRoll > 1)
+			continue;
+
+		// now and then everything begun is ended, so the gpu has to match the tracker exactly
+		bool settle = flushRoll == 0;
+		if (settle)
+			ResourceStateTrackerEndTransitions(tracker);
+
+		recording.barriers.clear();
+		ResourceStateTrackerFlush(tracker, RecordBarriers, &recording);
+
+		for (size_t i = 0; i < recording.barriers.size(); ++i) {
+			BarrierFuzzResource* target = static_cast<BarrierFuzzResource*>(recording.barriers[i].resource);
+			if (!ApplyFuzzBarrier(*target, recording.barriers[i]))
+				return false;
+		}
+
+		if (!settle)
+			continue;
+
+		for (uint32_t i = 0; i < barrierFuzzResourceCount; ++i) {
+			for (uint32_t j = 0; j < resources[i].states.size(); ++j) {
+				if (resources[i].splitting[j] || resources[i].states[j] != ResourceStateTrackerGetState(tracker, &resources[i], j))
+					return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+static void RecordNoBarriers(const ResourceStateBarrier*, uint32_t count, void* context) {
+	*static_cast<uint32_t*>(context) += count;
+}
+
+static int BarrierBench(uint32_t seed) {
+	if (!CheckResourceStateTracker()) {
+		fprintf(stderr, "resource state tracker checks failed\n");
+		return 1;
+	}
+	printf("resource state tracker checks passed\n");
+
+	if (!FuzzResourceStateTracker(seed)) {
+		fprintf(stderr, "fuzzing failed with seed %u\n", seed);
+		return 1;
+	}
+	printf("%d fuzzed transitions passed\n", barrierFuzzOperationCount);
+
+	// a frame like the renderer's: back buffer to render target, a few textures streamed in with split barriers,
+	// every texture asked for as a shader resource before the draws, and the back buffer back to present
+	ResourceStateTracker tracker;
+	ResourceStateTrackerInit(tracker, stateReads | stateDepthRead);
+
+	std::vector<int> resources(barrierBenchTextureCount + 2);
+	void* backBuffer = &resources[0];
+	void* depthBuffer = &resources[1];
+	ResourceStateTrackerRegister(tracker, backBuffer, 1, stateCommon);
+	ResourceStateTrackerRegister(tracker, depthBuffer, 1, stateDepthWrite);
+	for (uint32_t i = 0; i < barrierBenchTextureCount; ++i)
+		ResourceStateTrackerRegister(tracker, &resources[i + 2], 10, stateCopyDest);
+
+	uint32_t barrierCount = 0;
+	uint32_t random = seed;
+	int transitionCount = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < barrierBenchFrameCount; ++frame) {
+		// a texture was reloaded
+		void* reloaded = &resources[2 + NextRandom(random) % barrierBenchTextureCount];
+		ResourceStateTrackerTransition(tracker, reloaded, resourceStateAllSubresources, stateCopyDest);
+		ResourceStateTrackerBeginTransition(tracker, reloaded, resourceStateAllSubresources, statePixelShaderResource);
+
+		ResourceStateTrackerTransition(tracker, backBuffer, resourceStateAllSubresources, stateRenderTarget);
+		ResourceStateTrackerFlush(tracker, RecordNoBarriers, &barrierCount);
+
+		ResourceStateTrackerEndTransitions(tracker);
+		for (uint32_t i = 0; i < barrierBenchTextureCount; ++i)
+			ResourceStateTrackerTransition(tracker, &resources[i + 2], resourceStateAllSubresources, statePixelShaderResource);
+		ResourceStateTrackerFlush(tracker, RecordNoBarriers, &barrierCount);
+
+		ResourceStateTrackerTransition(tracker, backBuffer, resourceStateAllSubresources, stateCommon);
+		ResourceStateTrackerFlush(tracker, RecordNoBarriers, &barrierCount);
+
+		transitionCount += barrierBenchTextureCount + 4;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	ResourceStateTrackerStats stats = tracker.stats;
+	printf("%.1f ns per requested transition, %.1f barriers and %.1f ResourceBarrier calls per frame\n",
+		seconds * 1000000000.0 / transitionCount, (double)stats.barrierCount / barrierBenchFrameCount, (double)stats.flushCount / barrierBenchFrameCount);
+	printf("%llu of %llu requests needed no barrier, %llu barriers merged away\n",
+		(unsigned long long)stats.skippedTransitionCount, (unsigned long long)stats.requestedTransitionCount, (unsigned long long)stats.mergedBarrierCount);
+	return barrierCount == stats.barrierCount ? 0 : 1;
+}
+
+// a graph of passCount passes over random transients and imported resources, declared in a shuffled order
+// every pass reads up to two resources that have contents and writes one or two it has not touched yet
+static void BuildRandomFrameGraph(FrameGraph& graph, uint32_t& random, uint32_t passCount, uint32_t transientCount, uint32_t importedCount) {
+	static const uint32_t readStates[] = { statePixelShaderResource, stateNonPixelShaderResource, stateCopySource, stateDepthRead };
+	static const uint32_t writeStates[] = { stateRenderTarget, stateUnorderedAccess, stateDepthWrite, stateCopyDest };
+	static const uint32_t importStates[] = { stateCommon, statePixelShaderResource, stateCopyDest };
+
+	FrameGraphReset(graph);
+
+	uint32_t resourceCount = importedCount + transientCount;
+	std::vector<uint32_t> handles(resourceCount);
+	std::vector<bool> written(resourceCount);
+	for (uint32_t i = 0; i < resourceCount; ++i) {
+		if (i < importedCount) {
+			handles[i] = FrameGraphImport(graph, "imported", nullptr, importStates[NextRandom(random) % 3], importStates[NextRandom(random) % 3]);
+			written[i] = true;
+			continue;
+		}
+
+		FrameGraphResourceDesc desc = {};
+		desc.alignment = NextRandom(random) % 4 == 0 ? 4096 : 65536;
+		desc.size = desc.alignment * (1 + NextRandom(random) % 16);
+		handles[i] = FrameGraphCreate(graph, "transient", desc);
+	}
+
+	std::vector<uint32_t> passes(passCount);
+	for (uint32_t i = 0; i < passCount; ++i) {
+		passes[i] = FrameGraphAddPass(graph, "pass", NextRandom(random) % 16 == 0 ? FRAME_GRAPH_PASS_FLAG_NEVER_CULL : FRAME_GRAPH_PASS_FLAG_NONE, nullptr, nullptr);
+
+		uint32_t swap = NextRandom(random) % (i + 1);
+		std::swap(passes[i], passes[swap]);
+	}
+
+	std::vector<uint32_t> accessed;
+	for (uint32_t i = 0; i < passCount; ++i) {
+		uint32_t pass = passes[i];
+		accessed.clear();
+
+		uint32_t readCount = NextRandom(random) % 3;
+		for (uint32_t j = 0; j < readCount; ++j) {
+			uint32_t resource = NextRandom(random) % resourceCount;
+			if (!written[resource] || std::find(accessed.begin(), accessed.end(), resource) != accessed.end())
+				continue;
+			FrameGraphRead(graph, pass, handles[resource], readStates[NextRandom(random) % 4]);
+			accessed.push_back(resource);
+		}
+
+		uint32_t writeCount = 1 + NextRandom(random) % 2;
+		for (uint32_t j = 0; j < writeCount; ++j) {
+			uint32_t resource = NextRandom(random) % resourceCount;
+			if (std::find(accessed.begin(), accessed.end(), resource) != accessed.end())
+				continue;
+			handles[resource] = FrameGraphWrite(graph, pass, handles[resource], writeStates[NextRandom(random) % 4]);
+			written[resource] = true;
+			accessed.push_back(resource);
+		}
+	}
+}
+
+// what compile produced against what the declarations ask for
+// the order respects every dependency, only needed passes run, live transients never share memory, and the
+// barriers take every resource from the state it is in to the one each pass uses and back at the end
+static bool CheckCompiledFrameGraph(const FrameGraph& graph, uint32_t readStates) {
+	if (!graph.compiled)
+		return false;
+
+	std::vector<uint32_t> positions(graph.passes.size(), frameGraphInvalid);
+	for (uint32_t i = 0; i < graph.order.size(); ++i) {
+		if (graph.passes[graph.order[i]].culled || positions[graph.order[i]] != frameGraphInvalid)
+			return false;
+		positions[graph.order[i]] = i;
+	}
+
+	// passes whose output something that runs needs
+	std::vector<bool> needed(graph.passes.size());
+	for (uint32_t i = 0; i < graph.passes.size(); ++i) {
+		const FrameGraphPass& pass = graph.passes[i];
+		if (pass.culled != (positions[i] == frameGraphInvalid))
+			return false;
+		if (pass.flags & FRAME_GRAPH_PASS_FLAG_NEVER_CULL)
+			needed[i] = true;
+
+		for (size_t j = 0; j < pass.accesses.size(); ++j) {
+			const FrameGraphAccess& access = pass.accesses[j];
+			const FrameGraphVersion& version = graph.versions[access.version];
+			if (access.write && graph.resources[version.resource].imported)
+				needed[i] = true;
+			if (pass.culled)
+				continue;
+
+			uint32_t writer = access.write ? graph.versions[version.previous].writer : version.writer;
+			if (writer != frameGraphInvalid) {
+				if (positions[writer] == frameGraphInvalid || positions[writer] >= positions[i])
+					return false;
+				needed[writer] = true;
+			}
+
+			// readers of what this pass overwrites have to be done with it
+			if (!access.write)
+				continue;
+			for (uint32_t k = 0; k < graph.passes.size(); ++k) {
+				const FrameGraphPass& other = graph.passes[k];
+				for (size_t l = 0; l < other.accesses.size() && !other.culled && k != i; ++l) {
+					if (!other.accesses[l].write && other.accesses[l].version == version.previous && positions[k] >= positions[i])
+						return false;
+				}
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < graph.passes.size(); ++i) {
+		if (needed[i] == graph.passes[i].culled)
+			return false;
+	}
+
+	for (uint32_t i = 0; i < graph.resources.size(); ++i) {
+		const FrameGraphResource& a = graph.resources[i];
+		if (a.imported || a.firstUse == frameGraphInvalid)
+			continue;
+		if (a.heapOffset % a.desc.alignment != 0 || a.heapOffset + a.desc.size > graph.transientHeapSize)
+			return false;
+
+		for (uint32_t j = i + 1; j < graph.resources.size(); ++j) {
+			const FrameGraphResource& b = graph.resources[j];
+			if (b.imported || b.firstUse == frameGraphInvalid)
+				continue;
+			bool alive = a.firstUse <= b.lastUse && b.firstUse <= a.lastUse;
+			bool shared = a.heapOffset < b.heapOffset + b.desc.size && b.heapOffset < a.heapOffset + a.desc.size;
+			if (alive && shared)
+				return false;
+		}
+	}
+
+	std::vector<uint32_t> states(graph.resources.size());
+	for (uint32_t i = 0; i < graph.resources.size(); ++i)
+		states[i] = graph.resources[i].initialState;
+
+	for (uint32_t i = 0; i <= graph.order.size(); ++i) {
+		bool final = i == graph.order.size();
+		uint32_t first = final ? graph.firstFinalBarrier : graph.passes[graph.order[i]].firstBarrier;
+		uint32_t count = final ? graph.finalBarrierCount : graph.passes[graph.order[i]].barrierCount;
+
+		for (uint32_t j = first; j < first + count; ++j) {
+			const FrameGraphBarrier& barrier = graph.barriers[j];
+			if (barrier.type == FRAME_GRAPH_BARRIER_ALIASING)
+				continue;
+			if (states[barrier.resource] != barrier.stateBefore || barrier.flag != RESOURCE_BARRIER_FLAG_NONE)
+				return false;
+			states[barrier.resource] = barrier.stateAfter;
+		}
+
+		if (final)
+			break;
+
+		const FrameGraphPass& pass = graph.passes[graph.order[i]];
+		for (size_t j = 0; j < pass.accesses.size(); ++j) {
+			uint32_t requested = pass.accesses[j].state;
+			uint32_t current = states[graph.versions[pass.accesses[j].version].resource];
+			bool covered = (current & ~readStates) == 0 && (requested & ~readStates) == 0 && (current & requested) == requested;
+			if (current != requested && !covered)
+				return false;
+		}
+	}
+
+	for (uint32_t i = 0; i < graph.resources.size(); ++i) {
+		if (states[i] != graph.resources[i].finalState)
+			return false;
+	}
+
+	return true;
+}
+
+static bool IsFrameGraphOrder(const FrameGraph& graph, std::initializer_list<uint32_t> order) {
+	return graph.order.size() == order.size() && std::equal(order.begin(), order.end(), graph.order.begin());
+}
+
+// fixed cases, each returns false on the first result that is off
+static bool CheckFrameGraph() {
+	FrameGraph graph;
+	FrameGraphResourceDesc desc = {};
+	desc.size = 65536;
+	desc.alignment = 65536;
+
+	// a pass nothing reads from goes, and so does the transient only it uses
+	FrameGraphReset(graph);
+	uint32_t backBuffer = FrameGraphImport(graph, "back buffer", nullptr, stateCommon, stateCommon);
+	uint32_t a = FrameGraphCreate(graph, "a", desc);
+	uint32_t b = FrameGraphCreate(graph, "b", desc);
+	uint32_t pass0 = FrameGraphAddPass(graph, "write a", FRAME_GRAPH_PASS_FLAG_NONE, nullptr, nullptr);
+	uint32_t pass1 = FrameGraphAddPass(graph, "write b", FRAME_GRAPH_PASS_FLAG_NONE, nullptr, nullptr);
+	uint32_t pass2 = FrameGraphAddPass(graph, "present", FRAME_GRAPH_PASS_FLAG_NONE, nullptr, nullptr);
+	a = FrameGraphWrite(graph, pass0, a, stateRenderTarget);
+	FrameGraphWrite(graph, pass1, b, stateRenderTarget);
+	FrameGraphRead(graph, pass2, a, statePixelShaderResource);
+	FrameGraphWrite(graph, pass2, backBuffer, stateRenderTarget);
+	if (!FrameGraphCompile(graph, stateReads) || !IsFrameGraphOrder(graph, { 0, 2 }) || !graph.passes[1].culled ||
+		graph.resources[2].firstUse != frameGraphInvalid || graph.stats.culledPassCount != 1 || !CheckCompiledFrameGraph(graph, stateReads))
+		return false;
+
+	// back buffer to render target before the pass that writes it and back at the end, a from render target to read
+	if (graph.passes[pass2].barrierCount != 2 || graph.finalBarrierCount != 2 ||
+		graph.barriers[graph.passes[pass2].firstBarrier].stateAfter != statePixelShaderResource ||
+		graph.barriers[graph.passes[pass2].firstBarrier + 1].stateAfter != stateRenderTarget)
+		return false;
+
+	// passes run in dependency order, whatever order they were added in
+	FrameGraphReset(graph);
+	backBuffer = FrameGraphImport(graph, "back buffer", nullptr, stateCommon, stateCommon);
+	a = FrameGraphCreate(graph, "a", desc);
+	uint32_t consumer = FrameGraphAddPass(graph, "consumer", FRAME_GRAPH_PASS_FLAG_NONE, nullptr, nullptr);
+	uint32_t producer = FrameGraphAddPass(graph, "producer", FRAME_GRAPH_PASS_FLAG_NONE, nullptr, nullptr);
+	a = FrameGraphWrite(graph, producer, a, stateRenderTarget);
+	FrameGraphRead(graph, consumer, a, statePixelShaderResource);
+	FrameGraphWrite(graph, consumer, backBuffer, stateRenderTarget);
+	if (!FrameGraphCompile(graph, stateReads) || !IsFrameGraphOrder(graph, { producer, consumer }))
+		return false;
+
+	// a chain of transients: the first and the third never live at the same time, so they share memory
+	FrameGraphReset(graph);
+	backBuffer = FrameGraphImport(graph, "back buffer", nullptr, stateCommon, stateCommon);
+	uint32_t chain[3];
+	for (int i = 0; i < 3; ++i)
+		chain[i] = FrameGraphCreate(graph, "chain", desc);
+	for (int i = 0; i < 4; ++i) {
+		uint32_t pass = FrameGraphAddPass(graph, "link", FRAME_GRAPH_PASS_FLAG_NONE, nullptr, nullptr);
+		if (i > 0)
+			FrameGraphRead(graph, pass, chain[i - 1], statePixelShaderResource);
+		if (i < 3)
+			chain[i] = FrameGraphWrite(graph, pass, chain[i], stateRenderTarget);
+		else
+			FrameGraphWrite(graph, pass, backBuffer, stateRenderTarget);
+	}
+	if (!FrameGraphCompile(graph, stateReads) || !CheckCompiledFrameGraph(graph, stateReads) ||
+		graph.transientHeapSize != 2 * desc.size || graph.resources[1].heapOffset != graph.resources[3].heapOffset ||
+		graph.stats.aliasingBarrierCount != 2)
+		return false;
+
+	// the third takes the memory over from the first
+	const FrameGraphBarrier& aliasing = graph.barriers[graph.passes[2].firstBarrier];
+	if (aliasing.type != FRAME_GRAPH_BARRIER_ALIASING || aliasing.resource != 3 || aliasing.resourceBefore != 1)
+		return false;
+
+	// overwriting waits for the readers of what was there
+	FrameGraphReset(graph);
+	backBuffer = FrameGraphImport(graph, "back buffer", nullptr, stateCommon, stateCommon);
+	a = FrameGraphCreate(graph, "a", desc);
+	uint32_t overwrite = FrameGraphAddPass(graph, "overwrite", FRAME_GRAPH_PASS_FLAG_NEVER_CULL, nullptr, nullptr);
+	uint32_t reader = FrameGraphAddPass(graph, "reader", FRAME_GRAPH_PASS_FLAG_NONE, nullptr, nullptr);
+	uint32_t writer = FrameGraphAddPass(graph, "writer", FRAME_GRAPH_PASS_FLAG_NONE, nullptr, nullptr);
+	a = FrameGraphWrite(graph, writer, a, stateRenderTarget);
+	FrameGraphRead(graph, reader, a, statePixelShaderResource);
+	FrameGraphWrite(graph, reader, backBuffer, stateRenderTarget);
+	FrameGraphWrite(graph, overwrite, a, stateUnorderedAccess);
+	if (!FrameGraphCompile(graph, stateReads) || !IsFrameGraphOrder(graph, { writer, reader, overwrite }) || !CheckCompiledFrameGraph(graph, stateReads))
+		return false;
+
+	// passes that need each other's output cannot be ordered
+	FrameGraphReset(graph);
+	a = FrameGraphCreate(graph, "a", desc);
+	b = FrameGraphCreate(graph, "b", desc);
+	pass0 = FrameGraphAddPass(graph, "0", FRAME_GRAPH_PASS_FLAG_NEVER_CULL, nullptr, nullptr);
+	pass1 = FrameGraphAddPass(graph, "1", FRAME_GRAPH_PASS_FLAG_NONE, nullptr, nullptr);
+	a = FrameGraphWrite(graph, pass0, a, stateRenderTarget);
+	b = FrameGraphWrite(graph, pass1, b, stateRenderTarget);
+	FrameGraphRead(graph, pass0, b, statePixelShaderResource);
+	FrameGraphRead(graph, pass1, a, statePixelShaderResource);
+	if (FrameGraphCompile(graph, stateReads))
+		return false;
+
+	// a transient nothing wrote cannot be read, and an old version cannot be written
+	FrameGraphReset(graph);
+	a = FrameGraphCreate(graph, "a", desc);
+	pass0 = FrameGraphAddPass(graph, "0", FRAME_GRAPH_PASS_FLAG_NEVER_CULL, nullptr, nullptr);
+	FrameGraphRead(graph, pass0, a, statePixelShaderResource);
+	if (FrameGraphCompile(graph, stateReads))
+		return false;
+
+	FrameGraphReset(graph);
+	a = FrameGraphCreate(graph, "a", desc);
+	pass0 = FrameGraphAddPass(graph, "0", FRAME_GRAPH_PASS_FLAG_NEVER_CULL, nullptr, nullptr);
+	pass1 = FrameGraphAddPass(graph, "1", FRAME_GRAPH_PASS_FLAG_NEVER_CULL, nullptr, nullptr);
+	FrameGraphWrite(graph, pass0, a, stateRenderTarget);
+	FrameGraphWrite(graph, pass1, a, stateRenderTarget);
+	return !FrameGraphCompile(graph, stateReads);
+}
+
+static bool FuzzFrameGraph(uint32_t seed) {
+	FrameGraph graph;
+	uint32_t random = seed;
+
+	for (int i = 0; i < frameGraphFuzzGraphCount; ++i) {
+		uint32_t passCount = 1 + NextRandom(random) % 40;
+		uint32_t transientCount = 1 + NextRandom(random) % 24;
+		uint32_t importedCount = 1 + NextRandom(random) % 3;
+		BuildRandomFrameGraph(graph, random, passCount, transientCount, importedCount);
+
+		if (!FrameGraphCompile(graph, stateReads) || !CheckCompiledFrameGraph(graph, stateReads))
+			return false;
+	}
+
+	return true;
+}
+
+static int FrameGraphBench(uint32_t seed) {
+	if (!CheckFrameGraph()) {
+		fprintf(stderr, "frame graph checks failed\n");
+		return 1;
+	}
+	printf("frame graph checks passed\n");
+
+	if (!FuzzFrameGraph(seed)) {
+		fprintf(stderr, "fuzzing failed with seed %u\n", seed);
+		return 1;
+	}
+	printf("%d fuzzed graphs passed\n", frameGraphFuzzGraphCount);
+
+	// the graph is rebuilt every time, as if something changed every frame
+	FrameGraph graph;
+	uint32_t random = seed;
+	double buildSeconds = 0.0;
+	double compileSeconds = 0.0;
+
+	for (int i = 0; i < frameGraphBenchCompileCount; ++i) {
+		auto start = std::chrono::steady_clock::now();
+		BuildRandomFrameGraph(graph, random, frameGraphBenchPassCount, frameGraphBenchTransientCount, 4);
+		auto built = std::chrono::steady_clock::now();
+
+		if (!FrameGraphCompile(graph, stateReads)) {
+			fprintf(stderr, "compile failed\n");
+			return 1;
+		}
+		auto compiled = std::chrono::steady_clock::now();
+
+		buildSeconds += std::chrono::duration<double>(built - start).count();
+		compileSeconds += std::chrono::duration<double>(compiled - built).count();
+	}
+
+	const FrameGraphStats& stats = graph.stats;
+	printf("%u passes, %u transients: %.3f ms to declare, %.3f ms to compile\n", frameGraphBenchPassCount, frameGraphBenchTransientCount,
+		buildSeconds * 1000.0 / frameGraphBenchCompileCount, compileSeconds * 1000.0 / frameGraphBenchCompileCount);
+	printf("last graph: %u of %u passes culled, %u transients in %.1f MB instead of %.1f MB, %u transitions, %u aliasing barriers\n",
+		stats.culledPassCount, stats.passCount, stats.transientCount, stats.transientHeapSize / (1024.0 * 1024.0), stats.transientBytes / (1024.0 * 1024.0),
+		stats.transitionBarrierCount, stats.aliasingBarrierCount);
+	return 0;
+}
+
+// what the cooker works on, quantized only when the file is written
+struct MeshVertex {
+	float position[3];
+	float texCoord[2];
+};
+
+// the cube the renderer used to have in its source, four vertices per face so every face gets the whole texture
+static void GenerateCubeMesh(std::vector<MeshVertex>& vertices, std::vector<uint32_t>& indices) {
+	const MeshVertex cubeVertices[] = {
+		// front face
+		{ { -0.5f,  0.5f, -0.5f }, { 0.0f, 0.0f } },
+		{ {  0.5f, -0.5f, -0.5f }, { 1.0f, 1.0f } },
+		{ { -0.5f, -0.5f, -0.5f }, { 0.0f, 1.0f } },
+		{ {  0.5f,  0.5f, -0.5f }, { 1.0f, 0.0f } },
+
+		// right side face
+		{ {  0.5f, -0.5f, -0.5f }, { 0.0f, 1.0f } },
+		{ {  0.5f,  0.5f,  0.5f }, { 1.0f, 0.0f } },
+		{ {  0.5f, -0.5f,  0.5f }, { 1.0f, 1.0f } },
+		{ {  0.5f,  0.5f, -0.5f }, { 0.0f, 0.0f } },
+
+		// left side face
+		{ { -0.5f,  0.5f,  0.5f }, { 0.0f, 0.0f } },
+		{ { -0.5f, -0.5f, -0.5f }, { 1.0f, 1.0f } },
+		{ { -0.5f, -0.5f,  0.5f }, { 0.0f, 1.0f } },
+		{ { -0.5f,  0.5f, -0.5f }, { 1.0f, 0.0f } },
+
+		// back face
+		{ {  0.5f,  0.5f,  0.5f }, { 0.0f, 0.0f } },
+		{ { -0.5f, -0.5f,  0.5f }, { 1.0f, 1.0f } },
+		{ {  0.5f, -0.5f,  0.5f }, { 0.0f, 1.0f } },
+		{ { -0.5f,  0.5f,  0.5f }, { 1.0f, 0.0f } },
+
+		// top face
+		{ { -0.5f,  0.5f, -0.5f }, { 0.0f, 1.0f } },
+		{ {  0.5f,  0.5f,  0.5f }, { 1.0f, 0.0f } },
+		{ {  0.5f,  0.5f, -0.5f }, { 1.0f, 1.0f } },
+		{ { -0.5f,  0.5f,  0.5f }, { 0.0f, 0.0f } },
+
+		// bottom face
+		{ {  0.5f, -0.5f,  0.5f }, { 0.0f, 0.0f } },
+		{ { -0.5f, -0.5f, -0.5f }, { 1.0f, 1.0f } },
+		{ {  0.5f, -0.5f, -0.5f }, { 0.0f, 1.0f } },
+		{ { -0.5f, -0.5f,  0.5f }, { 1.0f, 0.0f } },
+	};
+
+	vertices.assign(cubeVertices, cubeVertices + sizeof(cubeVertices) / sizeof(cubeVertices[0]));
+	indices.clear();
+	for (uint32_t face = 0; face < 6; ++face) {
+		uint32_t first = face * 4;
+		for (uint32_t index : { 0, 1, 2, 0, 3, 1 })
+			indices.push_back(first + index);
+	}
+}
+
+// 1 based, negative counts back from the last one read so far, 0 if there is none
+static uint32_t ResolveObjIndex(long index, size_t count) {
+	if (index > 0 && (size_t)index <= count)
+		return (uint32_t)index;
+	if (index < 0 && (size_t)-index <= count)
+		return (uint32_t)(count + index + 1);
+	return 0;
+}
+
+// positions and texture coordinates of v, vt and f lines, polygons are split into fans
+// every face corner becomes a vertex of its own, welding merges them again
+// obj is right handed with texture coordinates from the bottom, so z, the winding and v are flipped
+static bool LoadObjMesh(const char* filename, std::vector<MeshVertex>& vertices, std::vector<uint32_t>& indices) {
+	std::vector<uint8_t> contents;
+	if (!ReadFile(filename, contents))
+		return false;
+	contents.push_back('\0');
+
+	std::vector<float> positions;
+	std::vector<float> texCoords;
+	vertices.clear();
+	indices.clear();
+
+	const char* line = reinterpret_cast<const char*>(&contents[0]);
+	while (*line != '\0') {
+		const char* end = line;
+		while (*end != '\0' && *end != '\n')
+			++end;
+		std::string text(line, end);
+		line = *end == '\n' ? end + 1 : end;
+
+		const char* cursor = text.c_str();
+		while (*cursor == ' ' || *cursor == '\t')
+			++cursor;
+
+		if (cursor[0] == 'v' && cursor[1] == ' ') {
+			float x = 0.0f, y = 0.0f, z = 0.0f;
+			if (sscanf(cursor + 2, "%f %f %f", &x, &y, &z) != 3)
+				return false;
+			positions.insert(positions.end(), { x, y, -z });
+		}
+		else if (cursor[0] == 'v' && cursor[1] == 't' && cursor[2] == ' ') {
+			float u = 0.0f, v = 0.0f;
+			if (sscanf(cursor + 3, "%f %f", &u, &v) < 1)
+				return false;
+			texCoords.insert(texCoords.end(), { u, 1.0f - v });
+		}
+		else if (cursor[0] == 'f' && cursor[1] == ' ') {
+			uint32_t firstVertex = (uint32_t)vertices.size();
+			cursor += 2;
+
+			for (;;) {
+				char* next;
+				long positionIndex = strtol(cursor, &next, 10);
+				if (next == cursor)
+					break;
+				cursor = next;
+
+				long texCoordIndex = 0;
+				if (*cursor == '/') {
+					texCoordIndex = strtol(cursor + 1, &next, 10);
+					cursor = next;
+					// the normal, if any
+					if (*cursor == '/')
+						strtol(cursor + 1, &next, 10);
+					cursor = next;
+				}
+
+				uint32_t position = ResolveObjIndex(positionIndex, positions.size() / 3);
+				uint32_t texCoord = ResolveObjIndex(texCoordIndex, texCoords.size() / 2);
+				if (position == 0)
+					return false;
+
+				MeshVertex vertex = {};
+				memcpy(vertex.position, &positions[(position - 1) * 3], sizeof(vertex.position));
+				if (texCoord != 0)
+					memcpy(vertex.texCoord, &texCoords[(texCoord - 1) * 2], sizeof(vertex.texCoord));
+				vertices.push_back(vertex);
+			}
+
+			uint32_t cornerCount = (uint32_t)vertices.size() - firstVertex;
+			if (cornerCount < 3)
+				return false;
+
+			for (uint32_t i = 1; i + 1 < cornerCount; ++i)
+				indices.insert(indices.end(), { firstVertex, firstVertex + i + 1, firstVertex + i });
+		}
+	}
+
+	return !indices.empty();
+}
+
+// seconds every step took, in the order they run
+struct MeshOptimizeTimings {
+	double weld;
+	double vertexCache;
+	double overdraw;
+	double vertexFetch;
+};
+
+// the cooker's pipeline, in place
+static void OptimizeMesh(std::vector<MeshVertex>& vertices, std::vector<uint32_t>& indices, MeshOptimizeTimings& timings) {
+	const uint32_t stride = sizeof(MeshVertex);
+	uint32_t indexCount = (uint32_t)indices.size();
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<uint32_t> remap;
+	uint32_t vertexCount = MeshWeldVertices(&vertices[0], (uint32_t)vertices.size(), stride, remap);
+	std::vector<MeshVertex> welded(vertexCount);
+	MeshRemapVertices(&welded[0], &vertices[0], (uint32_t)vertices.size(), stride, &remap[0]);
+	MeshRemapIndices(&indices[0], indexCount, &remap[0]);
+	auto weldEnd = std::chrono::steady_clock::now();
+
+	std::vector<uint32_t> reordered(indexCount);
+	MeshOptimizeVertexCache(&reordered[0], &indices[0], indexCount, vertexCount);
+	auto vertexCacheEnd = std::chrono::steady_clock::now();
+
+	MeshOptimizeOverdraw(&indices[0], &reordered[0], indexCount, &welded[0], vertexCount, stride, meshOverdrawThreshold);
+	auto overdrawEnd = std::chrono::steady_clock::now();
+
+	vertices.resize(vertexCount);
+	vertices.resize(MeshOptimizeVertexFetch(&vertices[0], &indices[0], indexCount, &welded[0], vertexCount, stride));
+	auto vertexFetchEnd = std::chrono::steady_clock::now();
+
+	timings.weld = std::chrono::duration<double>(weldEnd - start).count();
+	timings.vertexCache = std::chrono::duration<double>(vertexCacheEnd - weldEnd).count();
+	timings.overdraw = std::chrono::duration<double>(overdrawEnd - vertexCacheEnd).count();
+	timings.vertexFetch = std::chrono::duration<double>(vertexFetchEnd - overdrawEnd).count();
+}
+
+static VertexSource GetMeshVertexSource(const std::vector<MeshVertex>& vertices) {
+	VertexSource source;
+	source.data = &vertices[0];
+	source.vertexCount = (uint32_t)vertices.size();
+	source.stride = sizeof(MeshVertex);
+	source.positionOffset = offsetof(MeshVertex, position);
+	source.texCoordOffset = offsetof(MeshVertex, texCoord);
+	source.normalOffset = vertexAttributeMissing;
+	source.tangentOffset = vertexAttributeMissing;
+	return source;
+}
+
+static bool ParsePositionFormat(const char* name, VertexPositionFormat& format) {
+	if (strcmp(name, "float") == 0) format = VERTEX_POSITION_FORMAT_FLOAT3;
+	else if (strcmp(name, "snorm16") == 0) format = VERTEX_POSITION_FORMAT_SNORM16;
+	else if (strcmp(name, "unorm16") == 0) format = VERTEX_POSITION_FORMAT_UNORM16;
+	else return false;
+	return true;
+}
+
+static void PrintMeshCacheStats(const char* label, const std::vector<uint32_t>& indices, uint32_t vertexCount) {
+	MeshCacheStats stats = MeshAnalyzeVertexCache(&indices[0], (uint32_t)indices.size(), vertexCount, meshVertexCacheSize);
+	printf("%s: acmr %.3f, atvr %.3f\n", label, stats.acmr, stats.atvr);
+}
+
+// from the float vertices, with spheres grown by how far quantization can move a vertex
+static void BuildMeshMeshlets(const std::vector<MeshVertex>& vertices, const std::vector<uint32_t>& indices, const QuantizedVertices& quantized, MeshletSet& meshlets) {
+	BuildMeshlets(&indices[0], (uint32_t)indices.size(), &vertices[0], (uint32_t)vertices.size(), sizeof(MeshVertex), meshletMaxVertices, meshletMaxTriangles, meshlets);
+
+	float bound[3];
+	GetPositionErrorBound(quantized, bound);
+	float error = sqrtf(bound[0] * bound[0] + bound[1] * bound[1] + bound[2] * bound[2]);
+	for (MeshletBounds& bounds : meshlets.bounds)
+		bounds.radius += error;
+}
+
+static int CookMesh(const char* input, const char* output, VertexPositionFormat positionFormat) {
+	std::vector<MeshVertex> vertices;
+	std::vector<uint32_t> indices;
+	if (strcmp(input, "cube") == 0) {
+		GenerateCubeMesh(vertices, indices);
+	}
+	else if (!LoadObjMesh(input, vertices, indices)) {
+		fprintf(stderr, "could not load %s\n", input);
+		return 1;
+	}
+
+	// before is the imported order over welded vertices, so only the reordering is measured
+	std::vector<uint32_t> remap;
+	uint32_t weldedCount = MeshWeldVertices(&vertices[0], (uint32_t)vertices.size(), sizeof(MeshVertex), remap);
+	std::vector<uint32_t> weldedIndices(indices);
+	MeshRemapIndices(&weldedIndices[0], (uint32_t)weldedIndices.size(), &remap[0]);
+	printf("%s: %zu triangles, %zu vertices welded to %u\n", input, indices.size() / 3, vertices.size(), weldedCount);
+	PrintMeshCacheStats("before", weldedIndices, weldedCount);
+
+	MeshOptimizeTimings timings;
+	OptimizeMesh(vertices, indices, timings);
+	PrintMeshCacheStats("after", indices, (uint32_t)vertices.size());
+
+	VertexSource source = GetMeshVertexSource(vertices);
+	QuantizedVertices quantized;
+	if (!QuantizeVertices(source, ChooseVertexLayout(source, positionFormat), quantized)) {
+		fprintf(stderr, "could not quantize %s\n", input);
+		return 1;
+	}
+
+	MeshletSet meshlets;
+	BuildMeshMeshlets(vertices, indices, quantized, meshlets);
+
+	std::vector<uint8_t> file;
+	WriteMeshFile(quantized, &indices[0], (uint32_t)indices.size(), meshlets, file);
+	if (!WriteFile(output, file)) {
+		fprintf(stderr, "could not write %s\n", output);
+		return 1;
+	}
+
+	printf("%s: %zu bytes, %u bytes per vertex instead of %zu, %zu meshlets\n", output, file.size(), quantized.stride, sizeof(MeshVertex), meshlets.meshlets.size());
+	return 0;
+}
+
+// a uv sphere with every triangle's corners stored separately and the triangles shuffled, like a bad exporter would
+static void GenerateBenchMesh(uint32_t seed, std::vector<MeshVertex>& vertices, std::vector<uint32_t>& indices) {
+	const float pi = 3.14159265f;
+	std::vector<MeshVertex> grid((meshBenchSegmentCount + 1) * (meshBenchSegmentCount + 1));
+	for (uint32_t y = 0; y <= meshBenchSegmentCount; ++y) {
+		for (uint32_t x = 0; x <= meshBenchSegmentCount; ++x) {
+			float u = (float)x / meshBenchSegmentCount;
+			float v = (float)y / meshBenchSegmentCount;
+			MeshVertex& vertex = grid[y * (meshBenchSegmentCount + 1) + x];
+			vertex.position[0] = sinf(v * pi) * cosf(u * 2.0f * pi);
+			vertex.position[1] = cosf(v * pi);
+			vertex.position[2] = sinf(v * pi) * sinf(u * 2.0f * pi);
+			vertex.texCoord[0] = u;
+			vertex.texCoord[1] = v;
+		}
+	}
+
+	std::vector<uint32_t> quads(meshBenchSegmentCount * meshBenchSegmentCount);
+	for (uint32_t i = 0; i < quads.size(); ++i)
+		quads[i] = i;
+
+	uint32_t random = seed;
+	for (size_t i = quads.size() - 1; i > 0; --i)
+		std::swap(quads[i], quads[NextRandom(random) % (i + 1)]);
+
+	vertices.clear();
+	indices.clear();
+	for (uint32_t quad : quads) {
+		uint32_t x = quad % meshBenchSegmentCount;
+		uint32_t y = quad / meshBenchSegmentCount;
+		uint32_t topLeft = y * (meshBenchSegmentCount + 1) + x;
+		uint32_t bottomLeft = topLeft + meshBenchSegmentCount + 1;
+
+		for (uint32_t corner : { topLeft, topLeft + 1, bottomLeft, topLeft + 1, bottomLeft + 1, bottomLeft }) {
+			indices.push_back((uint32_t)vertices.size());
+			vertices.push_back(grid[corner]);
+		}
+	}
+}
+
+struct MeshBenchTriangle {
+	MeshVertex corners[3];
+};
+
+// by vertex contents, rotated so the smallest corner comes first, which keeps the winding
+static void GetSortedTriangles(const std::vector<MeshVertex>& vertices, const std::vector<uint32_t>& indices, std::vector<MeshBenchTriangle>& triangles) {
+	triangles.resize(indices.size() / 3);
+	for (size_t i = 0; i < triangles.size(); ++i) {
+		int first = 0;
+		for (int j = 1; j < 3; ++j) {
+			if (memcmp(&vertices[indices[i * 3 + j]], &vertices[indices[i * 3 + first]], sizeof(MeshVertex)) < 0)
+				first = j;
+		}
+		for (int j = 0; j < 3; ++j)
+			triangles[i].corners[j] = vertices[indices[i * 3 + (first + j) % 3]];
+	}
+
+	std::sort(triangles.begin(), triangles.end(), [](const MeshBenchTriangle& a, const MeshBenchTriangle& b) {
+		return memcmp(&a, &b, sizeof(MeshBenchTriangle)) < 0;
+	});
+}
+
+static bool CheckMeshFile(const std::vector<MeshVertex>& vertices, const std::vector<uint32_t>& indices) {
+	// float, so the vertices come back as they went in
+	VertexSource source = GetMeshVertexSource(vertices);
+	VertexLayout layout = { VERTEX_POSITION_FORMAT_FLOAT3, VERTEX_TEXCOORD_FORMAT_FLOAT2, VERTEX_DIRECTION_FORMAT_NONE, VERTEX_DIRECTION_FORMAT_NONE };
+	QuantizedVertices quantized;
+	if (!QuantizeVertices(source, layout, quantized))
+		return false;
+
+	MeshletSet meshlets;
+	BuildMeshMeshlets(vertices, indices, quantized, meshlets);
+
+	std::vector<uint8_t> file;
+	WriteMeshFile(quantized, &indices[0], (uint32_t)indices.size(), meshlets, file);
+
+	MeshView view;
+	if (!ReadMeshFile(&file[0], file.size(), view))
+		return false;
+
+	const MeshFileHeader& header = *view.header;
+	if (header.vertexCount != vertices.size() || header.indexCount != indices.size() || view.vertexDataSize != vertices.size() * sizeof(MeshVertex))
+		return false;
+	if (memcmp(view.vertices, &vertices[0], (size_t)view.vertexDataSize) != 0)
+		return false;
+
+	for (uint32_t i = 0; i < header.indexCount; ++i) {
+		uint32_t index;
+		if (header.indexFormat == MESH_INDEX_FORMAT_UINT16)
+			index = static_cast<const uint16_t*>(view.indices)[i];
+		else
+			index = static_cast<const uint32_t*>(view.indices)[i];
+		if (index != indices[i])
+			return false;
+	}
+
+	if (header.meshletCount != meshlets.meshlets.size() || header.meshletVertexCount != meshlets.vertices.size() || header.meshletTriangleCount != meshlets.triangles.size() ||
+		memcmp(view.meshlets, &meshlets.meshlets[0], meshlets.meshlets.size() * sizeof(Meshlet)) != 0 ||
+		memcmp(view.meshletBounds, &meshlets.bounds[0], meshlets.bounds.size() * sizeof(MeshletBounds)) != 0 ||
+		memcmp(view.meshletVertices, &meshlets.vertices[0], meshlets.vertices.size() * sizeof(uint32_t)) != 0 ||
+		memcmp(view.meshletTriangles, &meshlets.triangles[0], meshlets.triangles.size() * sizeof(uint32_t)) != 0)
+		return false;
+
+	for (uint32_t i = 0; i < header.vertexCount; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			if (vertices[i].position[j] < header.boundsMin[j] || vertices[i].position[j] > header.boundsMax[j])
+				return false;
+		}
+	}
+
+	// cut short, from a newer version, and pointing past the end
+	MeshView rejected;
+	if (ReadMeshFile(&file[0], file.size() - 1, rejected))
+		return false;
+
+	std::vector<uint8_t> broken(file);
+	reinterpret_cast<MeshFileHeader*>(&broken[0])->version = meshFileVersion + 1;
+	if (ReadMeshFile(&broken[0], broken.size(), rejected))
+		return false;
+
+	broken = file;
+	reinterpret_cast<MeshFileHeader*>(&broken[0])->indexOffset = header.fileSize;
+	if (ReadMeshFile(&broken[0], broken.size(), rejected))
+		return false;
+
+	broken = file;
+	reinterpret_cast<MeshFileHeader*>(&broken[0])->meshletTriangleCount += 1;
+	if (ReadMeshFile(&broken[0], broken.size(), rejected))
+		return false;
+
+	return true;
+}
+
+static int MeshBench(uint32_t seed) {
+	std::vector<MeshVertex> vertices;
+	std::vector<uint32_t> indices;
+	GenerateBenchMesh(seed, vertices, indices);
+
+	std::vector<MeshBenchTriangle> inputTriangles;
+	GetSortedTriangles(vertices, indices, inputTriangles);
+
+	std::vector<uint32_t> remap;
+	uint32_t weldedCount = MeshWeldVertices(&vertices[0], (uint32_t)vertices.size(), sizeof(MeshVertex), remap);
+	std::vector<uint32_t> weldedIndices(indices);
+	MeshRemapIndices(&weldedIndices[0], (uint32_t)weldedIndices.size(), &remap[0]);
+	printf("%zu triangles, %zu vertices welded to %u\n", indices.size() / 3, vertices.size(), weldedCount);
+	PrintMeshCacheStats("shuffled", weldedIndices, weldedCount);
+
+	MeshOptimizeTimings timings;
+	OptimizeMesh(vertices, indices, timings);
+	PrintMeshCacheStats("optimized", indices, (uint32_t)vertices.size());
+
+	double triangleCount = (double)(indices.size() / 3);
+	printf("weld %.2f ms, vertex cache %.2f ms (%.1f M triangles/s), overdraw %.2f ms, vertex fetch %.2f ms\n",
+		timings.weld * 1000.0, timings.vertexCache * 1000.0, triangleCount / timings.vertexCache / 1e6, timings.overdraw * 1000.0, timings.vertexFetch * 1000.0);
+
+	if (vertices.size() != weldedCount) {
+		fprintf(stderr, "%zu vertices after optimizing, %u expected\n", vertices.size(), weldedCount);
+		return 1;
+	}
+
+	std::vector<MeshBenchTriangle> outputTriangles;
+	GetSortedTriangles(vertices, indices, outputTriangles);
+	if (inputTriangles.size() != outputTriangles.size() || memcmp(&inputTriangles[0], &outputTriangles[0], inputTriangles.size() * sizeof(MeshBenchTriangle)) != 0) {
+		fprintf(stderr, "optimizing changed the triangles\n");
+		return 1;
+	}
+
+	if (!CheckMeshFile(vertices, indices)) {
+		fprintf(stderr, "mesh file checks failed\n");
+		return 1;
+	}
+
+	printf("same triangles after optimizing, mesh file checks passed\n");
+	return 0;
+}
+
+static bool CheckHalfConversion() {
+	// every half goes to a float and back unchanged, nans aside
+	for (uint32_t i = 0; i < 0x10000; ++i) {
+		uint16_t half = (uint16_t)i;
+		bool nan = (half & 0x7c00) == 0x7c00 && (half & 0x3ff) != 0;
+		if (!nan && FloatToHalf(HalfToFloat(half)) != half)
+			return false;
+	}
+
+	struct HalfCase {
+		float value;
+		uint16_t half;
+	};
+	const HalfCase cases[] = {
+		{ 1.0f, 0x3c00 }, { -2.0f, 0xc000 }, { -0.0f, 0x8000 }, { 65504.0f, 0x7bff }, { 65520.0f, 0x7c00 },
+		// ties go to even, in normals and in subnormals
+		{ 1.0f + 1.0f / 2048.0f, 0x3c00 }, { 1.0f + 3.0f / 2048.0f, 0x3c02 },
+		{ ldexpf(1.0f, -25), 0x0000 }, { ldexpf(3.0f, -25), 0x0002 }, { ldexpf(1.0f, -14), 0x0400 },
+	};
+	for (const HalfCase& test : cases) {
+		if (FloatToHalf(test.value) != test.half)
+			return false;
+	}
+
+	// every float in range goes to the nearest half
+	uint32_t random = 1;
+	for (int i = 0; i < quantizeFuzzVertexCount; ++i) {
+		float value = ldexpf((float)NextRandom(random) / 4294967296.0f, (int)(NextRandom(random) % 40) - 24);
+		uint16_t half = FloatToHalf(value);
+		float error = fabsf(HalfToFloat(half) - value);
+		if ((half & 0x7fff) < 0x7bff && fabsf(HalfToFloat(half + 1) - value) < error)
+			return false;
+		if ((half & 0x7fff) > 0 && fabsf(HalfToFloat(half - 1) - value) < error)
+			return false;
+	}
+	return true;
+}
+
+static void RandomDirection(uint32_t& random, float direction[3]) {
+	float length;
+	do {
+		for (int i = 0; i < 3; ++i)
+			direction[i] = (float)NextRandom(random) / 2147483648.0f - 1.0f;
+		length = sqrtf(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+	} while (length < 0.01f || length > 1.0f);
+
+	for (int i = 0; i < 3; ++i)
+		direction[i] /= length;
+}
+
+static float GetDirectionError(const float expected[3], const float actual[3]) {
+	float squared = 0.0f;
+	for (int i = 0; i < 3; ++i)
+		squared += (expected[i] - actual[i]) * (expected[i] - actual[i]);
+	return sqrtf(squared);
+}
+
+static bool CheckOctahedral(uint32_t seed, float& maxError) {
+	// the axes, the folds and the corners of the octahedron are where encodings go wrong first
+	const float s = 0.70710678f;
+	const float t = 0.57735027f;
+	const float special[][3] = {
+		{ 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
+		{ s, s, 0 }, { -s, s, 0 }, { s, -s, 0 }, { -s, -s, 0 }, { s, 0, -s }, { 0, -s, -s }, { t, t, -t }, { -t, -t, -t },
+	};
+
+	maxError = 0.0f;
+	uint32_t random = seed;
+	for (int i = 0; i < quantizeFuzzVertexCount; ++i) {
+		float direction[3];
+		if (i < (int)(sizeof(special) / sizeof(special[0])))
+			memcpy(direction, special[i], sizeof(direction));
+		else
+			RandomDirection(random, direction);
+
+		int16_t encoded[2];
+		float decoded[3];
+		EncodeOctahedral(direction, encoded);
+		DecodeOctahedral(encoded, decoded);
+
+		float error = GetDirectionError(direction, decoded);
+		maxError = std::max(maxError, error);
+		if (error > octahedralMaxError)
+			return false;
+	}
+	return true;
+}
+
+// all of the attributes a vertex can have, as floats
+struct QuantizeFuzzVertex {
+	float position[3];
+	float texCoord[2];
+	float normal[3];
+	float tangent[4];
+};
+
+// the most a texture coordinate can be off in the format
+static float GetTexCoordErrorBound(uint32_t format, float value) {
+	switch (format) {
+	case VERTEX_TEXCOORD_FORMAT_UNORM16: return 0.5f / 65535.0f + 1e-7f;
+	// half of the spacing of halves around the value
+	case VERTEX_TEXCOORD_FORMAT_HALF2: return std::max(ldexpf(1.0f, -25), ldexpf(1.0f, (int)floorf(log2f(fabsf(value))) - 11));
+	default: return 0.0f;
+	}
+}
+
+static bool CheckQuantizedVertices(const std::vector<QuantizeFuzzVertex>& vertices, const VertexLayout& layout) {
+	VertexSource source;
+	source.data = &vertices[0];
+	source.vertexCount = (uint32_t)vertices.size();
+	source.stride = sizeof(QuantizeFuzzVertex);
+	source.positionOffset = offsetof(QuantizeFuzzVertex, position);
+	source.texCoordOffset = offsetof(QuantizeFuzzVertex, texCoord);
+	source.normalOffset = offsetof(QuantizeFuzzVertex, normal);
+	source.tangentOffset = offsetof(QuantizeFuzzVertex, tangent);
+
+	QuantizedVertices quantized;
+	if (!QuantizeVertices(source, layout, quantized) || quantized.data.size() != vertices.size() * GetVertexLayoutStride(layout))
+		return false;
+
+	float bound[3];
+	GetPositionErrorBound(quantized, bound);
+	for (int j = 0; j < 3; ++j) {
+		float magnitude = std::max(fabsf(quantized.boundsMin[j]), fabsf(quantized.boundsMax[j]));
+		bound[j] += magnitude * dequantizeRelativeError;
+	}
+
+	for (uint32_t i = 0; i < vertices.size(); ++i) {
+		const QuantizeFuzzVertex& expected = vertices[i];
+		QuantizeFuzzVertex actual;
+		DequantizeVertex(quantized, i, actual.position, actual.texCoord, actual.normal, actual.tangent);
+
+		for (int j = 0; j < 3; ++j) {
+			if (fabsf(actual.position[j] - expected.position[j]) > bound[j])
+				return false;
+		}
+		for (int j = 0; j < 2; ++j) {
+			if (fabsf(actual.texCoord[j] - expected.texCoord[j]) > GetTexCoordErrorBound(layout.texCoord, expected.texCoord[j]))
+				return false;
+		}
+
+		float directionBound = layout.normal == VERTEX_DIRECTION_FORMAT_FLOAT ? 0.0f : octahedralMaxError;
+		if (layout.normal != VERTEX_DIRECTION_FORMAT_NONE && GetDirectionError(expected.normal, actual.normal) > directionBound)
+			return false;
+
+		directionBound = layout.tangent == VERTEX_DIRECTION_FORMAT_FLOAT ? 0.0f : octahedralMaxError;
+		if (layout.tangent != VERTEX_DIRECTION_FORMAT_NONE &&
+			(GetDirectionError(expected.tangent, actual.tangent) > directionBound || (expected.tangent[3] < 0.0f) != (actual.tangent[3] < 0.0f)))
+			return false;
+	}
+	return true;
+}
+
+static bool CheckVertexLayouts() {
+	// the elements have to add up to the stride, in the order of the layout
+	for (uint8_t position = 0; position < VERTEX_POSITION_FORMAT_COUNT; ++position) {
+		for (uint8_t texCoord = 0; texCoord < VERTEX_TEXCOORD_FORMAT_COUNT; ++texCoord) {
+			for (uint8_t normal = 0; normal < VERTEX_DIRECTION_FORMAT_COUNT; ++normal) {
+				for (uint8_t tangent = 0; tangent < VERTEX_DIRECTION_FORMAT_COUNT; ++tangent) {
+					VertexLayout layout = { position, texCoord, normal, tangent };
+					VertexLayoutElement elements[vertexLayoutMaxElements];
+					uint32_t count = GetVertexLayoutElements(layout, elements);
+					if (count != 2u + (normal != VERTEX_DIRECTION_FORMAT_NONE) + (tangent != VERTEX_DIRECTION_FORMAT_NONE) || elements[0].offset != 0)
+						return false;
+
+					VertexLayoutDefine defines[vertexLayoutDefineCount];
+					GetVertexLayoutDefines(layout, defines);
+					if (strcmp(defines[0].value, position == VERTEX_POSITION_FORMAT_FLOAT3 ? "0" : "1") != 0 ||
+						defines[3].value[0] - '0' != position || defines[4].value[0] - '0' != texCoord)
+						return false;
+				}
+			}
+		}
+	}
+
+	VertexLayout full = { VERTEX_POSITION_FORMAT_FLOAT3, VERTEX_TEXCOORD_FORMAT_FLOAT2, VERTEX_DIRECTION_FORMAT_FLOAT, VERTEX_DIRECTION_FORMAT_FLOAT };
+	VertexLayout compressed = { VERTEX_POSITION_FORMAT_SNORM16, VERTEX_TEXCOORD_FORMAT_HALF2, VERTEX_DIRECTION_FORMAT_OCTAHEDRAL_SNORM16, VERTEX_DIRECTION_FORMAT_OCTAHEDRAL_SNORM16 };
+	VertexLayout unknown = { VERTEX_POSITION_FORMAT_COUNT, VERTEX_TEXCOORD_FORMAT_FLOAT2, VERTEX_DIRECTION_FORMAT_NONE, VERTEX_DIRECTION_FORMAT_NONE };
+	return GetVertexLayoutStride(full) == 48 && GetVertexLayoutStride(compressed) == 24 && GetVertexLayoutStride(unknown) == 0;
+}
+
+static void GenerateQuantizeFuzzVertices(uint32_t& random, float texCoordMin, float texCoordMax, std::vector<QuantizeFuzzVertex>& vertices) {
+	// bounds from a millimeter to kilometers, away from the origin, with a flat axis now and then
+	float extent[3];
+	float center[3];
+	for (int j = 0; j < 3; ++j) {
+		extent[j] = ldexpf(1.0f, (int)(NextRandom(random) % 24) - 10);
+		center[j] = ((float)NextRandom(random) / 2147483648.0f - 1.0f) * extent[j] * 4.0f;
+	}
+	if (NextRandom(random) % 4 == 0)
+		extent[NextRandom(random) % 3] = 0.0f;
+
+	vertices.resize(1 + NextRandom(random) % 1000);
+	for (QuantizeFuzzVertex& vertex : vertices) {
+		for (int j = 0; j < 3; ++j)
+			vertex.position[j] = center[j] + ((float)NextRandom(random) / 2147483648.0f - 1.0f) * extent[j];
+		for (int j = 0; j < 2; ++j)
+			vertex.texCoord[j] = texCoordMin + (float)NextRandom(random) / 4294967296.0f * (texCoordMax - texCoordMin);
+		RandomDirection(random, vertex.normal);
+		RandomDirection(random, vertex.tangent);
+		vertex.tangent[3] = NextRandom(random) % 2 ? 1.0f : -1.0f;
+	}
+}
+
+static bool FuzzQuantizedVertices(uint32_t seed) {
+	uint32_t random = seed;
+	std::vector<QuantizeFuzzVertex> vertices;
+
+	for (int vertexCount = 0; vertexCount < quantizeFuzzVertexCount; vertexCount += (int)vertices.size()) {
+		// every position format against every texture coordinate and direction format
+		uint8_t texCoord = (uint8_t)(NextRandom(random) % VERTEX_TEXCOORD_FORMAT_COUNT);
+		float texCoordMin = texCoord == VERTEX_TEXCOORD_FORMAT_UNORM16 ? 0.0f : -8.0f;
+		float texCoordMax = texCoord == VERTEX_TEXCOORD_FORMAT_UNORM16 ? 1.0f : 8.0f;
+		GenerateQuantizeFuzzVertices(random, texCoordMin, texCoordMax, vertices);
+
+		VertexLayout layout;
+		layout.position = (uint8_t)(NextRandom(random) % VERTEX_POSITION_FORMAT_COUNT);
+		layout.texCoord = texCoord;
+		layout.normal = (uint8_t)(1 + NextRandom(random) % (VERTEX_DIRECTION_FORMAT_COUNT - 1));
+		layout.tangent = (uint8_t)(1 + NextRandom(random) % (VERTEX_DIRECTION_FORMAT_COUNT - 1));
+		if (!CheckQuantizedVertices(vertices, layout)) {
+			fprintf(stderr, "layout %u %u %u %u out of bounds\n", layout.position, layout.texCoord, layout.normal, layout.tangent);
+			return false;
+		}
+	}
+
+	// the chosen texture coordinate format follows the range, and wrong layouts are refused
+	VertexSource source;
+	source.data = &vertices[0];
+	source.vertexCount = (uint32_t)vertices.size();
+	source.stride = sizeof(QuantizeFuzzVertex);
+	source.positionOffset = offsetof(QuantizeFuzzVertex, position);
+	source.texCoordOffset = offsetof(QuantizeFuzzVertex, texCoord);
+	source.normalOffset = vertexAttributeMissing;
+	source.tangentOffset = vertexAttributeMissing;
+
+	struct ChooseCase {
+		float texCoordMin;
+		float texCoordMax;
+		uint8_t texCoord;
+	};
+	const ChooseCase cases[] = {
+		{ 0.0f, 1.0f, VERTEX_TEXCOORD_FORMAT_UNORM16 },
+		{ -1.9f, 1.9f, VERTEX_TEXCOORD_FORMAT_HALF2 },
+		{ -64.0f, 64.0f, VERTEX_TEXCOORD_FORMAT_FLOAT2 },
+	};
+	for (const ChooseCase& test : cases) {
+		GenerateQuantizeFuzzVertices(random, test.texCoordMin, test.texCoordMax, vertices);
+		source.data = &vertices[0];
+		source.vertexCount = (uint32_t)vertices.size();
+
+		VertexLayout layout = ChooseVertexLayout(source, VERTEX_POSITION_FORMAT_SNORM16);
+		if (layout.texCoord != test.texCoord || layout.normal != VERTEX_DIRECTION_FORMAT_NONE || layout.tangent != VERTEX_DIRECTION_FORMAT_NONE) {
+			fprintf(stderr, "texture coordinates in [%g, %g] got format %u\n", test.texCoordMin, test.texCoordMax, layout.texCoord);
+			return false;
+		}
+	}
+
+	QuantizedVertices quantized;
+	VertexLayout unorm = { VERTEX_POSITION_FORMAT_FLOAT3, VERTEX_TEXCOORD_FORMAT_UNORM16, VERTEX_DIRECTION_FORMAT_NONE, VERTEX_DIRECTION_FORMAT_NONE };
+	VertexLayout normals = { VERTEX_POSITION_FORMAT_FLOAT3, VERTEX_TEXCOORD_FORMAT_FLOAT2, VERTEX_DIRECTION_FORMAT_OCTAHEDRAL_SNORM16, VERTEX_DIRECTION_FORMAT_NONE };
+	if (QuantizeVertices(source, unorm, quantized) || QuantizeVertices(source, normals, quantized)) {
+		fprintf(stderr, "a layout the vertices do not fit was accepted\n");
+		return false;
+	}
+	return true;
+}
+
+static int QuantizeBench(uint32_t seed) {
+	if (!CheckHalfConversion()) {
+		fprintf(stderr, "half float checks failed\n");
+		return 1;
+	}
+
+	float octahedralError;
+	if (!CheckOctahedral(seed, octahedralError)) {
+		fprintf(stderr, "octahedral error above %g\n", octahedralMaxError);
+		return 1;
+	}
+
+	if (!CheckVertexLayouts()) {
+		fprintf(stderr, "vertex layout checks failed\n");
+		return 1;
+	}
+
+	if (!FuzzQuantizedVertices(seed)) {
+		fprintf(stderr, "fuzzing failed with seed %u\n", seed);
+		return 1;
+	}
+	printf("half float, octahedral (at most %.2g off) and layout checks passed, %d fuzzed vertices within bounds\n", octahedralError, quantizeFuzzVertexCount);
+
+	// the bench sphere, with the normals and tangents a lit mesh would have
+	std::vector<MeshVertex> meshVertices;
+	std::vector<uint32_t> indices;
+	GenerateBenchMesh(seed, meshVertices, indices);
+	MeshOptimizeTimings timings;
+	OptimizeMesh(meshVertices, indices, timings);
+
+	std::vector<QuantizeFuzzVertex> vertices(meshVertices.size());
+	for (size_t i = 0; i < vertices.size(); ++i) {
+		QuantizeFuzzVertex& vertex = vertices[i];
+		memcpy(vertex.position, meshVertices[i].position, sizeof(vertex.position));
+		memcpy(vertex.texCoord, meshVertices[i].texCoord, sizeof(vertex.texCoord));
+		memcpy(vertex.normal, vertex.position, sizeof(vertex.normal));
+
+		float length = sqrtf(vertex.position[0] * vertex.position[0] + vertex.position[2] * vertex.position[2]);
+		vertex.tangent[0] = length > 0.0f ? -vertex.position[2] / length : 1.0f;
+		vertex.tangent[1] = 0.0f;
+		vertex.tangent[2] = length > 0.0f ? vertex.position[0] / length : 0.0f;
+		vertex.tangent[3] = 1.0f;
+	}
+
+	VertexSource source;
+	source.data = &vertices[0];
+	source.vertexCount = (uint32_t)vertices.size();
+	source.stride = sizeof(QuantizeFuzzVertex);
+	source.positionOffset = offsetof(QuantizeFuzzVertex, position);
+	source.texCoordOffset = offsetof(QuantizeFuzzVertex, texCoord);
+	source.normalOffset = vertexAttributeMissing;
+	source.tangentOffset = vertexAttributeMissing;
+
+	const char* names[] = { "position, texcoord", "position, texcoord, normal, tangent" };
+	for (int lit = 0; lit < 2; ++lit) {
+		if (lit) {
+			source.normalOffset = offsetof(QuantizeFuzzVertex, normal);
+			source.tangentOffset = offsetof(QuantizeFuzzVertex, tangent);
+		}
+
+		VertexLayout full = { VERTEX_POSITION_FORMAT_FLOAT3, VERTEX_TEXCOORD_FORMAT_FLOAT2, VERTEX_DIRECTION_FORMAT_NONE, VERTEX_DIRECTION_FORMAT_NONE };
+		if (lit)
+			full.normal = full.tangent = VERTEX_DIRECTION_FORMAT_FLOAT;
+		VertexLayout layout = ChooseVertexLayout(source, VERTEX_POSITION_FORMAT_SNORM16);
+
+		QuantizedVertices quantized;
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < quantizeBenchRunCount; ++i)
+			QuantizeVertices(source, layout, quantized);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / quantizeBenchRunCount;
+
+		if (!CheckQuantizedVertices(vertices, layout)) {
+			fprintf(stderr, "bench mesh out of bounds\n");
+			return 1;
+		}
+
+		uint32_t fullStride = GetVertexLayoutStride(full);
+		printf("%s: %u bytes per vertex instead of %u, %.0f%% less to fetch, %.1f M vertices/s\n", names[lit], quantized.stride, fullStride,
+			100.0 * (1.0 - (double)quantized.stride / fullStride), vertices.size() / seconds / 1e6);
+	}
+	return 0;
+}
+
+// a = a * b, row major with column vectors like MeshletCullContextInit takes them
+static void MultiplyMatrix(float a[16], const float b[16]) {
+	float result[16];
+	for (int row = 0; row < 4; ++row) {
+		for (int column = 0; column < 4; ++column) {
+			result[row * 4 + column] = 0.0f;
+			for (int k = 0; k < 4; ++k)
+				result[row * 4 + column] += a[row * 4 + k] * b[k * 4 + column];
+		}
+	}
+	memcpy(a, result, sizeof(result));
+}
+
+static float RandomRange(uint32_t& random, float minimum, float maximum) {
+	return minimum + (float)NextRandom(random) / 4294967296.0f * (maximum - minimum);
+}
+
+// left handed like the renderer, z forward
+static void GetCameraFromWorld(const float eye[3], const float target[3], float cameraFromWorld[16]) {
+	float forward[3] = { target[0] - eye[0], target[1] - eye[1], target[2] - eye[2] };
+	float forwardLength = sqrtf(forward[0] * forward[0] + forward[1] * forward[1] + forward[2] * forward[2]);
+	for (int j = 0; j < 3; ++j)
+		forward[j] /= forwardLength;
+	float up[3] = { 0.0f, 1.0f, 0.0f };
+	if (fabsf(forward[1]) > 0.99f) {
+		up[1] = 0.0f;
+		up[2] = 1.0f;
+	}
+	float right[3] = { up[1] * forward[2] - up[2] * forward[1], up[2] * forward[0] - up[0] * forward[2], up[0] * forward[1] - up[1] * forward[0] };
+	float rightLength = sqrtf(right[0] * right[0] + right[1] * right[1] + right[2] * right[2]);
+	for (int j = 0; j < 3; ++j)
+		right[j] /= rightLength;
+	float cameraUp[3] = { forward[1] * right[2] - forward[2] * right[1], forward[2] * right[0] - forward[0] * right[2], forward[0] * right[1] - forward[1] * right[0] };
+
+	float result[16] = {
+		right[0], right[1], right[2], -(right[0] * eye[0] + right[1] * eye[1] + right[2] * eye[2]),
+		cameraUp[0], cameraUp[1], cameraUp[2], -(cameraUp[0] * eye[0] + cameraUp[1] * eye[1] + cameraUp[2] * eye[2]),
+		forward[0], forward[1], forward[2], -(forward[0] * eye[0] + forward[1] * eye[1] + forward[2] * eye[2]),
+		0.0f, 0.0f, 0.0f, 1.0f,
+	};
+	memcpy(cameraFromWorld, result, sizeof(result));
+}
+
+// depth in [0, 1] like d3d
+static void GetProjection(bool orthographic, float height, float yScale, float nearZ, float farZ, float projection[16]) {
+	memset(projection, 0, 16 * sizeof(float));
+	if (orthographic) {
+		projection[0] = 2.0f / height;
+		projection[5] = 2.0f / height;
+		projection[10] = 1.0f / (farZ - nearZ);
+		projection[11] = -nearZ / (farZ - nearZ);
+		projection[15] = 1.0f;
+	}
+	else {
+		projection[0] = yScale;
+		projection[5] = yScale;
+		projection[10] = farZ / (farZ - nearZ);
+		projection[11] = -nearZ * farZ / (farZ - nearZ);
+		projection[14] = 1.0f;
+	}
+}
+
+struct MeshletBenchView {
+	float clipFromObject[16];
+	// the viewer in object space, worked out from the transforms and not from the matrix
+	float eye[3];
+	bool orthographic;
+};
+
+// the mesh somewhere in the world, rotated and scaled, seen from outside its bounding sphere looking at or past it
+static void GenerateMeshletBenchView(uint32_t& random, bool orthographic, MeshletBenchView& view) {
+	float axis[3];
+	RandomDirection(random, axis);
+	float angle = RandomRange(random, 0.0f, 6.2831853f);
+	float scale = RandomRange(random, 0.5f, 2.0f);
+	float translation[3];
+	for (int j = 0; j < 3; ++j)
+		translation[j] = RandomRange(random, -1.0f, 1.0f);
+
+	// rodrigues
+	float c = cosf(angle), s = sinf(angle), t = 1.0f - c;
+	float rotation[9] = {
+		t * axis[0] * axis[0] + c, t * axis[0] * axis[1] - s * axis[2], t * axis[0] * axis[2] + s * axis[1],
+		t * axis[0] * axis[1] + s * axis[2], t * axis[1] * axis[1] + c, t * axis[1] * axis[2] - s * axis[0],
+		t * axis[0] * axis[2] - s * axis[1], t * axis[1] * axis[2] + s * axis[0], t * axis[2] * axis[2] + c,
+	};
+
+	float direction[3];
+	RandomDirection(random, direction);
+	float distance = scale * RandomRange(random, 1.2f, 5.0f);
+	float eye[3], target[3];
+	for (int j = 0; j < 3; ++j) {
+		eye[j] = translation[j] + direction[j] * distance;
+		target[j] = translation[j] + RandomRange(random, -1.0f, 1.0f) * scale;
+	}
+
+	float cameraFromWorld[16];
+	GetCameraFromWorld(eye, target, cameraFromWorld);
+
+	float nearZ = 0.05f;
+	float farZ = distance + scale * RandomRange(random, -0.5f, 2.0f);
+	float projection[16];
+	if (orthographic)
+		GetProjection(true, scale * RandomRange(random, 0.5f, 3.0f), 0.0f, nearZ, farZ, projection);
+	else
+		GetProjection(false, 0.0f, 1.0f / tanf(RandomRange(random, 0.25f, 0.9f)), nearZ, farZ, projection);
+	float worldFromObject[16] = {
+		rotation[0] * scale, rotation[1] * scale, rotation[2] * scale, translation[0],
+		rotation[3] * scale, rotation[4] * scale, rotation[5] * scale, translation[1],
+		rotation[6] * scale, rotation[7] * scale, rotation[8] * scale, translation[2],
+		0.0f, 0.0f, 0.0f, 1.0f,
+	};
+
+	memcpy(view.clipFromObject, projection, sizeof(projection));
+	MultiplyMatrix(view.clipFromObject, cameraFromWorld);
+	MultiplyMatrix(view.clipFromObject, worldFromObject);
+
+	// the inverse of the world transform, transposed rotation over the scale
+	for (int i = 0; i < 3; ++i) {
+		view.eye[i] = 0.0f;
+		for (int j = 0; j < 3; ++j)
+			view.eye[i] += rotation[j * 3 + i] * (eye[j] - translation[j]) / scale;
+	}
+	view.orthographic = orthographic;
+}
+
+// limits, every triangle once and in index buffer order, local indices pointing at the right vertices, spheres
+// around their vertices
+static bool CheckMeshlets(const std::vector<MeshVertex>& vertices, const std::vector<uint32_t>& indices, const MeshletSet& meshlets) {
+	if (meshlets.meshlets.size() != meshlets.bounds.size())
+		return false;
+
+	uint32_t vertexOffset = 0;
+	uint32_t triangleOffset = 0;
+	for (size_t i = 0; i < meshlets.meshlets.size(); ++i) {
+		const Meshlet& meshlet = meshlets.meshlets[i];
+		const MeshletBounds& bounds = meshlets.bounds[i];
+		if (meshlet.vertexOffset != vertexOffset || meshlet.triangleOffset != triangleOffset || meshlet.triangleCount == 0 ||
+			meshlet.vertexCount > meshletMaxVertices || meshlet.triangleCount > meshletMaxTriangles)
+			return false;
+
+		for (uint32_t j = 0; j < meshlet.triangleCount; ++j) {
+			uint32_t triangle = meshlets.triangles[meshlet.triangleOffset + j];
+			if (triangle >> 24 != 0)
+				return false;
+			for (int k = 0; k < 3; ++k) {
+				uint32_t local = (triangle >> (k * 8)) & 0xff;
+				if (local >= meshlet.vertexCount || meshlets.vertices[meshlet.vertexOffset + local] != indices[(meshlet.triangleOffset + j) * 3 + k])
+					return false;
+			}
+		}
+
+		for (uint32_t j = 0; j < meshlet.vertexCount; ++j) {
+			const float* position = vertices[meshlets.vertices[meshlet.vertexOffset + j]].position;
+			float squared = 0.0f;
+			for (int k = 0; k < 3; ++k)
+				squared += (position[k] - bounds.center[k]) * (position[k] - bounds.center[k]);
+			if (sqrtf(squared) > bounds.radius)
+				return false;
+		}
+
+		vertexOffset += meshlet.vertexCount;
+		triangleOffset += meshlet.triangleCount;
+	}
+
+	return vertexOffset == meshlets.vertices.size() && triangleOffset == meshlets.triangles.size() && triangleOffset * 3 == indices.size();
+}
+
+// a culled meshlet must not have a triangle facing the viewer with a corner in the frustum, and with the planes
+// out of the way, the cone alone must not cull a meshlet with any triangle facing the viewer
+// the draws have to cover the triangles of the visible meshlets and nothing else
+static bool CheckMeshletCulling(uint32_t seed, const std::vector<MeshVertex>& vertices, const std::vector<uint32_t>& indices, const MeshletSet& meshlets) {
+	uint32_t meshletCount = (uint32_t)meshlets.meshlets.size();
+	uint32_t triangleCount = (uint32_t)(indices.size() / 3);
+	std::vector<float> clip(vertices.size() * 4);
+	std::vector<uint8_t> facing(triangleCount);
+	std::vector<uint32_t> visible(meshletCount);
+	std::vector<uint8_t> drawn(triangleCount);
+	std::vector<MeshletDrawArguments> draws((meshletCount + 1) / 2);
+
+	uint32_t random = seed;
+	for (int v = 0; v < meshletCheckViewCount; ++v) {
+		MeshletBenchView view;
+		GenerateMeshletBenchView(random, v % 4 == 3, view);
+		MeshletCullContext context;
+		MeshletCullContextInit(context, view.clipFromObject);
+
+		if (context.coneCulling == view.orthographic) {
+			fprintf(stderr, "view %d: cone culling %s for a%s projection\n", v, context.coneCulling ? "on" : "off", view.orthographic ? "n orthographic" : " perspective");
+			return false;
+		}
+
+		if (context.coneCulling) {
+			float distance = sqrtf(view.eye[0] * view.eye[0] + view.eye[1] * view.eye[1] + view.eye[2] * view.eye[2]);
+			if (GetDirectionError(view.eye, context.eye) > 1e-4f * std::max(distance, 1.0f)) {
+				fprintf(stderr, "view %d: eye at %g %g %g, %g %g %g expected\n", v, context.eye[0], context.eye[1], context.eye[2], view.eye[0], view.eye[1], view.eye[2]);
+				return false;
+			}
+		}
+
+		for (size_t i = 0; i < vertices.size(); ++i) {
+			for (int row = 0; row < 4; ++row) {
+				const float* m = &view.clipFromObject[row * 4];
+				clip[i * 4 + row] = m[0] * vertices[i].position[0] + m[1] * vertices[i].position[1] + m[2] * vertices[i].position[2] + m[3];
+			}
+		}
+
+		// orthographic views do not cull by cone, so every triangle counts as facing them
+		for (uint32_t i = 0; i < triangleCount; ++i) {
+			const float* p0 = vertices[indices[i * 3]].position;
+			const float* p1 = vertices[indices[i * 3 + 1]].position;
+			const float* p2 = vertices[indices[i * 3 + 2]].position;
+			float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			float toEye = (view.eye[0] - p0[0]) * n[0] + (view.eye[1] - p0[1]) * n[1] + (view.eye[2] - p0[2]) * n[2];
+			facing[i] = view.orthographic || toEye > meshletCheckMargin * length;
+		}
+
+		uint32_t visibleCount = CullMeshlets(context, &meshlets.bounds[0], meshletCount, &visible[0]);
+		MeshletCullContext coneContext = context;
+		for (int i = 0; i < 6; ++i) {
+			coneContext.planes[i][0] = coneContext.planes[i][1] = coneContext.planes[i][2] = 0.0f;
+			coneContext.planes[i][3] = 1.0f;
+		}
+
+		uint32_t next = 0;
+		for (uint32_t m = 0; m < meshletCount; ++m) {
+			bool culled = next >= visibleCount || visible[next] != m;
+			if (!culled)
+				++next;
+
+			const Meshlet& meshlet = meshlets.meshlets[m];
+			bool coneCulled = !IsMeshletVisible(coneContext, meshlets.bounds[m]);
+			for (uint32_t t = meshlet.triangleOffset; t < meshlet.triangleOffset + meshlet.triangleCount; ++t) {
+				if (!facing[t])
+					continue;
+				if (coneCulled) {
+					fprintf(stderr, "view %d: meshlet %u culled by its cone with triangle %u facing the viewer\n", v, m, t);
+					return false;
+				}
+				if (!culled)
+					continue;
+
+				for (int k = 0; k < 3; ++k) {
+					const float* p = &clip[indices[t * 3 + k] * 4];
+					float inner = p[3] * (1.0f - meshletCheckMargin);
+					if (p[0] > -inner && p[0] < inner && p[1] > -inner && p[1] < inner && p[2] > p[3] * meshletCheckMargin && p[2] < inner) {
+						fprintf(stderr, "view %d: meshlet %u culled with triangle %u in view\n", v, m, t);
+						return false;
+					}
+				}
+			}
+		}
+
+		uint32_t drawCount = CullMeshletsToDrawArguments(context, &meshlets.meshlets[0], &meshlets.bounds[0], meshletCount, &draws[0]);
+		if (drawCount > draws.size())
+			return false;
+		std::fill(drawn.begin(), drawn.end(), 0);
+		for (uint32_t i = 0; i < drawCount; ++i) {
+			const MeshletDrawArguments& draw = draws[i];
+			if (draw.instanceCount != 1 || draw.baseVertexLocation != 0 || draw.startInstanceLocation != 0 ||
+				draw.startIndexLocation % 3 != 0 || draw.indexCountPerInstance % 3 != 0 || draw.startIndexLocation + draw.indexCountPerInstance > indices.size())
+				return false;
+			for (uint32_t t = draw.startIndexLocation / 3; t < (draw.startIndexLocation + draw.indexCountPerInstance) / 3; ++t)
+				drawn[t] += 1;
+		}
+
+		next = 0;
+		for (uint32_t m = 0; m < meshletCount; ++m) {
+			uint8_t expected = next < visibleCount && visible[next] == m;
+			next += expected;
+			const Meshlet& meshlet = meshlets.meshlets[m];
+			for (uint32_t t = meshlet.triangleOffset; t < meshlet.triangleOffset + meshlet.triangleCount; ++t) {
+				if (drawn[t] != expected) {
+					fprintf(stderr, "view %d: triangle %u drawn %u times, meshlet %u is %s\n", v, t, drawn[t], m, expected ? "visible" : "culled");
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+static int MeshletBench(uint32_t seed) {
+	std::vector<MeshVertex> vertices;
+	std::vector<uint32_t> indices;
+	GenerateBenchMesh(seed, vertices, indices);
+	MeshOptimizeTimings timings;
+	OptimizeMesh(vertices, indices, timings);
+
+	uint32_t indexCount = (uint32_t)indices.size();
+	MeshletSet meshlets;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < meshletBenchRunCount; ++i)
+		BuildMeshlets(&indices[0], indexCount, &vertices[0], (uint32_t)vertices.size(), sizeof(MeshVertex), meshletMaxVertices, meshletMaxTriangles, meshlets);
+	double buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / meshletBenchRunCount;
+
+	uint32_t meshletCount = (uint32_t)meshlets.meshlets.size();
+	uint32_t coneCount = 0;
+	for (const MeshletBounds& bounds : meshlets.bounds)
+		coneCount += bounds.coneCutoff < 1.0f;
+	printf("%u triangles in %u meshlets, %.1f vertices and %.1f triangles each, %u with a cone, built in %.2f ms (%.1f M triangles/s)\n",
+		indexCount / 3, meshletCount, (double)meshlets.vertices.size() / meshletCount, (double)meshlets.triangles.size() / meshletCount, coneCount,
+		buildSeconds * 1000.0, indexCount / 3 / buildSeconds / 1e6);
+
+	if (!CheckMeshlets(vertices, indices, meshlets)) {
+		fprintf(stderr, "meshlet checks failed\n");
+		return 1;
+	}
+
+	if (!CheckMeshletCulling(seed, vertices, indices, meshlets)) {
+		fprintf(stderr, "culling checks failed with seed %u\n", seed);
+		return 1;
+	}
+	printf("meshlet and bounds checks passed, culling matches brute force from %d views\n", meshletCheckViewCount);
+
+	// the sphere filling the view from 3 units straight ahead with a 60 degree field of view, where only the cones cull
+	MeshletCullContext orbit;
+	float orbitClipFromObject[16] = {
+		1.7320508f, 0.0f, 0.0f, 0.0f,
+		0.0f, 1.7320508f, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.001f, 3.0f * 1.001f - 0.1f * 1.001f,
+		0.0f, 0.0f, 1.0f, 3.0f,
+	};
+	MeshletCullContextInit(orbit, orbitClipFromObject);
+	std::vector<uint32_t> visible(meshletCount);
+	uint32_t orbitVisible = CullMeshlets(orbit, &meshlets.bounds[0], meshletCount, &visible[0]);
+
+	uint32_t random = seed;
+	std::vector<MeshletCullContext> contexts(meshletBenchViewCount);
+	for (MeshletCullContext& context : contexts) {
+		MeshletBenchView view;
+		GenerateMeshletBenchView(random, false, view);
+		MeshletCullContextInit(context, view.clipFromObject);
+	}
+
+	uint64_t visibleTotal = 0;
+	start = std::chrono::steady_clock::now();
+	for (const MeshletCullContext& context : contexts)
+		visibleTotal += CullMeshlets(context, &meshlets.bounds[0], meshletCount, &visible[0]);
+	double cullSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	printf("culling %.1f ns per meshlet, cones cull %.0f%% seen from the front, frustum and cones %.0f%% from random views\n",
+		cullSeconds * 1e9 / ((double)meshletCount * meshletBenchViewCount), 100.0 * (1.0 - (double)orbitVisible / meshletCount),
+		100.0 * (1.0 - (double)visibleTotal / ((double)meshletCount * meshletBenchViewCount)));
+	return 0;
+}
+
+// local transform of a node of the transform checks, kept to compute the world matrix again the slow way
+struct TransformCheckNode {
+	int parent;
+	DirectX::XMFLOAT3 position;
+	DirectX::XMFLOAT4 rotation;
+	DirectX::XMFLOAT3 scale;
+};
+
+static void RandomizeTransformCheckNode(uint32_t& random, TransformCheckNode& node) {
+	node.position = DirectX::XMFLOAT3(RandomRange(random, -2.0f, 2.0f), RandomRange(random, -2.0f, 2.0f), RandomRange(random, -2.0f, 2.0f));
+
+	DirectX::XMVECTOR rotation = DirectX::XMVectorSet(RandomRange(random, -1.0f, 1.0f), RandomRange(random, -1.0f, 1.0f),
+		RandomRange(random, -1.0f, 1.0f), RandomRange(random, 0.1f, 1.0f));
+	DirectX::XMStoreFloat4(&node.rotation, DirectX::XMQuaternionNormalize(rotation));
+
+	node.scale = DirectX::XMFLOAT3(RandomRange(random, 0.9f, 1.1f), RandomRange(random, 0.9f, 1.1f), RandomRange(random, 0.9f, 1.1f));
+}
+
+// scale, rotation and translation one matrix at a time, times the parent's world matrix found the same way
+static DirectX::XMMATRIX GetNaiveWorldMatrix(const std::vector<TransformCheckNode>& nodes, int node) {
+	const TransformCheckNode& checkNode = nodes[node];
+	DirectX::XMMATRIX localMat = DirectX::XMMatrixScaling(checkNode.scale.x, checkNode.scale.y, checkNode.scale.z) *
+		DirectX::XMMatrixRotationQuaternion(DirectX::XMLoadFloat4(&checkNode.rotation)) *
+		DirectX::XMMatrixTranslation(checkNode.position.x, checkNode.position.y, checkNode.position.z);
+
+	if (checkNode.parent < 0)
+		return localMat;
+	return localMat * GetNaiveWorldMatrix(nodes, checkNode.parent);
+}
+
+static bool IsMatrixNear(const DirectX::XMFLOAT4X4& actual, DirectX::FXMMATRIX expectedMat) {
+	DirectX::XMFLOAT4X4 expected;
+	DirectX::XMStoreFloat4x4(&expected, expectedMat);
+
+	for (int row = 0; row < 4; ++row) {
+		for (int column = 0; column < 4; ++column) {
+			if (fabsf(actual.m[row][column] - expected.m[row][column]) > transformCheckTolerance * (1.0f + fabsf(expected.m[row][column])))
+				return false;
+		}
+	}
+	return true;
+}
+
+// every world matrix, the wvp matrices of every node in order and of a few in a list
+static bool CheckTransformHierarchyMatrices(uint32_t& random, const TransformHierarchy& hierarchy, const std::vector<TransformCheckNode>& nodes) {
+	DirectX::XMMATRIX viewProjMat = DirectX::XMMatrixTranslation(0.0f, 0.0f, 5.0f) *
+		DirectX::XMMatrixPerspectiveFovLH(DirectX::XM_PIDIV4, 4.0f / 3.0f, 0.1f, 1000.0f);
+
+	std::vector<DirectX::XMFLOAT4X4> wvpMats(nodes.size());
+	TransformHierarchyWriteWVP(hierarchy, 0, nodes.size(), viewProjMat, &wvpMats[0], sizeof(DirectX::XMFLOAT4X4));
+
+	for (size_t i = 0; i < nodes.size(); ++i) {
+		DirectX::XMMATRIX worldMat = GetNaiveWorldMatrix(nodes, (int)i);
+		if (!IsMatrixNear(hierarchy.worldMats[i], worldMat))
+			return false;
+		if (!IsMatrixNear(wvpMats[i], DirectX::XMMatrixTranspose(worldMat * viewProjMat)))
+			return false;
+	}
+
+	std::vector<uint32_t> list(64);
+	for (uint32_t& node : list)
+		node = NextRandom(random) % (uint32_t)nodes.size();
+	TransformHierarchyWriteWVPList(hierarchy, &list[0], list.size(), viewProjMat, &wvpMats[0], sizeof(DirectX::XMFLOAT4X4));
+
+	for (size_t i = 0; i < list.size(); ++i) {
+		if (!IsMatrixNear(wvpMats[i], DirectX::XMMatrixTranspose(GetNaiveWorldMatrix(nodes, (int)list[i]) * viewProjMat)))
+			return false;
+	}
+	return true;
+}
+
+// a random forest with one long chain in it, checked after building it and after moving a few percent of the nodes
+// a few times, which also has to update exactly the moved nodes and everything below them
+static bool CheckTransformHierarchy(uint32_t seed) {
+	uint32_t random = seed;
+
+	std::vector<TransformCheckNode> nodes(transformCheckNodeCount);
+	TransformHierarchy hierarchy;
+	TransformHierarchyInit(hierarchy, nodes.size());
+
+	const int chainStart = transformCheckNodeCount / 2;
+	for (int i = 0; i < transformCheckNodeCount; ++i) {
+		TransformCheckNode& node = nodes[i];
+		if (i > chainStart && i < chainStart + transformCheckChainLength)
+			node.parent = i - 1;
+		else
+			node.parent = i == 0 || NextRandom(random) % 10 == 0 ? -1 : (int)(NextRandom(random) % i);
+		RandomizeTransformCheckNode(random, node);
+
+		int added = TransformHierarchyAddNode(hierarchy, node.parent, DirectX::XMLoadFloat3(&node.position), DirectX::XMLoadFloat4(&node.rotation),
+			DirectX::XMLoadFloat3(&node.scale));
+		if (added != i)
+			return false;
+	}
+
+	// children have to come after their parents
+	if (TransformHierarchyAddNode(hierarchy, transformCheckNodeCount, DirectX::XMVectorZero(), DirectX::XMVectorZero(), DirectX::XMVectorZero()) != -1)
+		return false;
+
+	TransformHierarchyUpdate(hierarchy);
+	if (hierarchy.lastUpdatedCount != nodes.size() || !CheckTransformHierarchyMatrices(random, hierarchy, nodes))
+		return false;
+
+	std::vector<uint8_t> moved(nodes.size());
+	for (int round = 0; round < transformCheckMoveCount; ++round) {
+		std::fill(moved.begin(), moved.end(), 0);
+
+		for (size_t i = 0; i < nodes.size() / 20; ++i) {
+			int node = (int)(NextRandom(random) % nodes.size());
+			RandomizeTransformCheckNode(random, nodes[node]);
+			moved[node] = 1;
+
+			// one part at a time, like the renderer moves things
+			uint32_t parts = NextRandom(random) % 8;
+			if (parts == 0 || (parts & 1))
+				TransformHierarchySetPosition(hierarchy, node, DirectX::XMLoadFloat3(&nodes[node].position));
+			if (parts == 0 || (parts & 2))
+				TransformHierarchySetRotation(hierarchy, node, DirectX::XMLoadFloat4(&nodes[node].rotation));
+			if (parts == 0 || (parts & 4))
+				TransformHierarchySetScale(hierarchy, node, DirectX::XMLoadFloat3(&nodes[node].scale));
+
+			// whatever was not set keeps what the hierarchy has
+			DirectX::XMFLOAT4 rotation;
+			DirectX::XMStoreFloat4(&rotation, TransformHierarchyGetRotation(hierarchy, node));
+			nodes[node].rotation = rotation;
+			nodes[node].position = DirectX::XMFLOAT3(hierarchy.positionX[node], hierarchy.positionY[node], hierarchy.positionZ[node]);
+			nodes[node].scale = DirectX::XMFLOAT3(hierarchy.scaleX[node], hierarchy.scaleY[node], hierarchy.scaleZ[node]);
+		}
+
+		size_t expectedUpdatedCount = 0;
+		for (size_t i = 0; i < nodes.size(); ++i) {
+			if (nodes[i].parent >= 0)
+				moved[i] |= moved[nodes[i].parent];
+			expectedUpdatedCount += moved[i];
+		}
+
+		TransformHierarchyUpdate(hierarchy);
+		if (hierarchy.lastUpdatedCount != expectedUpdatedCount || !CheckTransformHierarchyMatrices(random, hierarchy, nodes))
+			return false;
+	}
+	return true;
+}
+
+// flat: one root with every other node under it, deep: chains of transformBenchChainLength nodes, each under the one
+// before it
+static void BuildTransformBenchHierarchy(uint32_t& random, size_t count, bool deep, TransformHierarchy& hierarchy) {
+	TransformHierarchyInit(hierarchy, count);
+
+	TransformCheckNode node;
+	for (size_t i = 0; i < count; ++i) {
+		RandomizeTransformCheckNode(random, node);
+
+		int parent = deep ? (i % transformBenchChainLength == 0 ? -1 : (int)i - 1) : (i == 0 ? -1 : 0);
+		TransformHierarchyAddNode(hierarchy, parent, DirectX::XMLoadFloat3(&node.position), DirectX::XMLoadFloat4(&node.rotation),
+			DirectX::XMLoadFloat3(&node.scale));
+	}
+	TransformHierarchyUpdate(hierarchy);
+}
+
+static int TransformBench(uint32_t seed) {
+	if (!CheckTransformHierarchy(seed)) {
+		fprintf(stderr, "transform hierarchy checks failed with seed %u\n", seed);
+		return 1;
+	}
+	printf("world and wvp matrices match multiplying every node's ancestors, after building and after %d moves\n", transformCheckMoveCount);
+
+	DirectX::XMMATRIX viewProjMat = DirectX::XMMatrixTranslation(0.0f, 0.0f, 5.0f) *
+		DirectX::XMMatrixPerspectiveFovLH(DirectX::XM_PIDIV4, 4.0f / 3.0f, 0.1f, 1000.0f);
+
+	uint32_t random = seed;
+	for (size_t count : { (size_t)10000, (size_t)100000, (size_t)1000000 }) {
+		size_t runCount = std::max(transformBenchNodeUpdates / count, (size_t)3);
+		std::vector<DirectX::XMFLOAT4X4> wvpMats(count);
+
+		for (bool deep : { false, true }) {
+			const char* shape = deep ? "deep" : "flat";
+
+			TransformHierarchy hierarchy;
+			BuildTransformBenchHierarchy(random, count, deep, hierarchy);
+
+			for (uint32_t movedPercent : { 1u, 10u, 100u }) {
+				// the moves are picked up front and set between the updates, so only the updates are measured
+				std::vector<uint32_t> moved(count * movedPercent / 100);
+				for (size_t i = 0; i < moved.size(); ++i)
+					moved[i] = movedPercent == 100 ? (uint32_t)i : NextRandom(random) % (uint32_t)count;
+				DirectX::XMVECTOR rotation = DirectX::XMQuaternionNormalize(DirectX::XMVectorSet(0.1f, 0.2f, 0.3f, 1.0f));
+
+				double seconds = 0.0;
+				uint64_t updatedCount = 0;
+				for (size_t run = 0; run < runCount; ++run) {
+					for (uint32_t node : moved)
+						TransformHierarchySetRotation(hierarchy, node, rotation);
+
+					auto start = std::chrono::steady_clock::now();
+					TransformHierarchyUpdate(hierarchy);
+					seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+					updatedCount += hierarchy.lastUpdatedCount;
+				}
+
+				printf("%s, %zu nodes, %u%% moved: %.0f updated in %.3f ms, %.1f M transforms per second\n", shape, count, movedPercent,
+					(double)updatedCount / runCount, seconds * 1000.0 / runCount, updatedCount / seconds / 1000000.0);
+			}
+
+			auto start = std::chrono::steady_clock::now();
+			for (size_t run = 0; run < runCount; ++run)
+				TransformHierarchyWriteWVP(hierarchy, 0, count, viewProjMat, &wvpMats[0], sizeof(DirectX::XMFLOAT4X4));
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			printf("%s, %zu nodes: wvp of every node written in %.3f ms, %.1f M matrices per second\n", shape, count, seconds * 1000.0 / runCount,
+				(double)count * runCount / seconds / 1000000.0);
+		}
+	}
+	return 0;
+}
+
+// boxes of about the size of the renderer's props scattered through a cube that grows with the count
+static void GenerateCullBenchBoxes(uint32_t& random, uint32_t count, std::vector<float>& boundsMin, std::vector<float>& boundsMax, float& worldSize) {
+	worldSize = cbrtf(count * cullBenchVolumePerObject);
+	boundsMin.resize(count * 3);
+	boundsMax.resize(count * 3);
+	for (uint32_t i = 0; i < count; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			float center = RandomRange(random, 0.0f, worldSize);
+			float extent = RandomRange(random, 0.1f, 1.0f);
+			boundsMin[i * 3 + j] = center - extent;
+			boundsMax[i * 3 + j] = center + extent;
+		}
+	}
+}
+
+// moves a box by up to distance on every axis
+static void MoveCullBenchBox(uint32_t& random, float distance, float boundsMin[3], float boundsMax[3]) {
+	for (int j = 0; j < 3; ++j) {
+		float offset = RandomRange(random, -distance, distance);
+		boundsMin[j] += offset;
+		boundsMax[j] += offset;
+	}
+}
+
+// a camera somewhere in the world looking somewhere else in it, or from outside at all of it
+static void GenerateCullBenchFrustum(uint32_t& random, float worldSize, bool orthographic, CullingFrustum& frustum) {
+	float eye[3], target[3];
+	for (int j = 0; j < 3; ++j) {
+		eye[j] = RandomRange(random, -0.2f, 1.2f) * worldSize;
+		target[j] = RandomRange(random, 0.0f, 1.0f) * worldSize;
+	}
+
+	float cameraFromWorld[16];
+	GetCameraFromWorld(eye, target, cameraFromWorld);
+
+	float projection[16];
+	float farZ = worldSize * RandomRange(random, 0.2f, 1.0f);
+	if (orthographic)
+		GetProjection(true, worldSize * RandomRange(random, 0.1f, 1.0f), 0.0f, 0.1f, farZ, projection);
+	else
+		GetProjection(false, 0.0f, 1.0f / tanf(RandomRange(random, 0.3f, 0.8f)), 0.1f, farZ, projection);
+
+	MultiplyMatrix(projection, cameraFromWorld);
+	CullingFrustumInit(frustum, projection);
+}
+
+static bool IsBoundsEqual(const CullingBounds4& bounds, uint32_t lane, const float boundsMin[3], const float boundsMax[3]) {
+	return bounds.minX[lane] == boundsMin[0] && bounds.minY[lane] == boundsMin[1] && bounds.minZ[lane] == boundsMin[2] &&
+		bounds.maxX[lane] == boundsMax[0] && bounds.maxY[lane] == boundsMax[1] && bounds.maxZ[lane] == boundsMax[2];
+}
+
+// every box of a node is the union of what is below it, every object is below exactly one leaf lane and the
+// parent references lead back up
+static bool CheckCullingBvhChild(const CullingBvh& bvh, uint32_t child, uint32_t parent, const float* boundsMin, const float* boundsMax, std::vector<uint8_t>& seen, float childMin[3], float childMax[3]) {
+	childMin[0] = childMin[1] = childMin[2] = FLT_MAX;
+	childMax[0] = childMax[1] = childMax[2] = -FLT_MAX;
+
+	const CullingBounds4* bounds;
+	const uint32_t* children;
+	if (child & cullingBvhLeafFlag) {
+		uint32_t leaf = child & ~cullingBvhLeafFlag;
+		if (leaf >= bvh.leafBounds.size() || bvh.leafParents[leaf] != parent)
+			return false;
+		bounds = &bvh.leafBounds[leaf];
+		children = &bvh.leafObjects[leaf * cullingBvhWidth];
+	}
+	else {
+		if (child >= bvh.nodes.size() || bvh.nodeParents[child] != parent)
+			return false;
+		bounds = &bvh.nodes[child].bounds;
+		children = bvh.nodes[child].children;
+	}
+
+	for (uint32_t lane = 0; lane < cullingBvhWidth; ++lane) {
+		// empty lanes are left as an empty box
+		float laneMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float laneMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		if (children[lane] != cullingBvhEmpty && (child & cullingBvhLeafFlag)) {
+			uint32_t object = children[lane];
+			if (object >= bvh.objectCount || seen[object] || bvh.objectSlots[object] != (child & ~cullingBvhLeafFlag) * cullingBvhWidth + lane)
+				return false;
+			seen[object] = 1;
+			memcpy(laneMin, &boundsMin[object * 3], sizeof(laneMin));
+			memcpy(laneMax, &boundsMax[object * 3], sizeof(laneMax));
+		}
+		else if (children[lane] != cullingBvhEmpty) {
+			if (!CheckCullingBvhChild(bvh, children[lane], child * cullingBvhWidth + lane, boundsMin, boundsMax, seen, laneMin, laneMax))
+				return false;
+		}
+
+		if (!IsBoundsEqual(*bounds, lane, laneMin, laneMax))
+			return false;
+
+		for (int j = 0; j < 3; ++j) {
+			childMin[j] = std::min(childMin[j], laneMin[j]);
+			childMax[j] = std::max(childMax[j], laneMax[j]);
+		}
+	}
+	return true;
+}
+
+static bool CheckCullingBvhTree(const CullingBvh& bvh, const float* boundsMin, const float* boundsMax) {
+	if (bvh.objectCount == 0)
+		return true;
+
+	std::vector<uint8_t> seen(bvh.objectCount, 0);
+	float rootMin[3], rootMax[3];
+	if (!CheckCullingBvhChild(bvh, bvh.root, cullingBvhEmpty, boundsMin, boundsMax, seen, rootMin, rootMax))
+		return false;
+	return std::find(seen.begin(), seen.end(), 0) == seen.end();
+}
+
+// the same objects as testing every box on its own
+static bool CheckCullingBvhViews(uint32_t& random, const CullingBvh& bvh, const float* boundsMin, const float* boundsMax, float worldSize) {
+	std::vector<uint32_t> visible(bvh.objectCount + 1);
+	std::vector<uint32_t> expected;
+	for (int view = 0; view < cullCheckViewCount; ++view) {
+		CullingFrustum frustum;
+		GenerateCullBenchFrustum(random, worldSize, view % 4 == 0, frustum);
+
+		expected.clear();
+		for (uint32_t i = 0; i < bvh.objectCount; ++i) {
+			if (CullingFrustumTestBox(frustum, &boundsMin[i * 3], &boundsMax[i * 3]))
+				expected.push_back(i);
+		}
+
+		uint32_t visibleCount = CullingBvhCull(bvh, frustum, &visible[0]);
+		std::sort(visible.begin(), visible.begin() + visibleCount);
+		if (visibleCount != expected.size() || !std::equal(expected.begin(), expected.end(), visible.begin()))
+			return false;
+	}
+	return true;
+}
+
+// a single leaf, partly filled leaves and nodes, and enough objects for a few levels, built, then refitted after
+// small moves that keep the tree's shape useful and large ones across the world that do not
+static bool CheckCullingBvh(uint32_t seed) {
+	uint32_t random = seed;
+	for (uint32_t count : { 0u, 1u, 3u, 4u, 5u, 16u, 17u, 70u, 1000u, 20000u }) {
+		std::vector<float> boundsMin, boundsMax;
+		float worldSize;
+		GenerateCullBenchBoxes(random, count, boundsMin, boundsMax, worldSize);
+
+		CullingBvh bvh;
+		CullingBvhBuild(bvh, boundsMin.data(), boundsMax.data(), count);
+		if (!CheckCullingBvhTree(bvh, boundsMin.data(), boundsMax.data()) || !CheckCullingBvhViews(random, bvh, boundsMin.data(), boundsMax.data(), worldSize)) {
+			fprintf(stderr, "culling hierarchy of %u objects is wrong after building\n", count);
+			return false;
+		}
+
+		for (int refit = 0; refit < 3 && count > 0; ++refit) {
+			for (uint32_t i = 0; i < count / 10 + 1; ++i) {
+				uint32_t object = NextRandom(random) % count;
+				float distance = refit == 2 ? worldSize : 1.0f;
+				MoveCullBenchBox(random, distance, &boundsMin[object * 3], &boundsMax[object * 3]);
+				CullingBvhSetBounds(bvh, object, &boundsMin[object * 3], &boundsMax[object * 3]);
+			}
+			CullingBvhRefit(bvh);
+
+			if (!CheckCullingBvhTree(bvh, boundsMin.data(), boundsMax.data()) || !CheckCullingBvhViews(random, bvh, boundsMin.data(), boundsMax.data(), worldSize)) {
+				fprintf(stderr, "culling hierarchy of %u objects is wrong after refit %d\n", count, refit);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// object space box of a unit cube rotated and scaled, against its corners transformed one by one
+static bool CheckTransformBounds(uint32_t seed) {
+	uint32_t random = seed;
+	for (int i = 0; i < cullCheckTransformCount; ++i) {
+		float axis[3];
+		RandomDirection(random, axis);
+		float angle = RandomRange(random, 0.0f, 6.2831853f);
+		float c = cosf(angle), s = sinf(angle), t = 1.0f - c;
+		float scale = RandomRange(random, 0.1f, 3.0f);
+		// rows are the transformed axes and the last row the translation, like DirectXMath
+		float matrix[16] = {
+			(t * axis[0] * axis[0] + c) * scale, (t * axis[0] * axis[1] + s * axis[2]) * scale, (t * axis[0] * axis[2] - s * axis[1]) * scale, 0.0f,
+			(t * axis[0] * axis[1] - s * axis[2]) * scale, (t * axis[1] * axis[1] + c) * scale, (t * axis[1] * axis[2] + s * axis[0]) * scale, 0.0f,
+			(t * axis[0] * axis[2] + s * axis[1]) * scale, (t * axis[1] * axis[2] - s * axis[0]) * scale, (t * axis[2] * axis[2] + c) * scale, 0.0f,
+			RandomRange(random, -10.0f, 10.0f), RandomRange(random, -10.0f, 10.0f), RandomRange(random, -10.0f, 10.0f), 1.0f,
+		};
+
+		float boundsMin[3] = { -1.0f, -1.0f, -1.0f };
+		float boundsMax[3] = { 1.0f, 1.0f, 1.0f };
+		float transformedMin[3], transformedMax[3];
+		TransformBounds(matrix, boundsMin, boundsMax, transformedMin, transformedMax);
+
+		float expectedMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float expectedMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (int corner = 0; corner < 8; ++corner) {
+			float position[3] = { corner & 1 ? 1.0f : -1.0f, corner & 2 ? 1.0f : -1.0f, corner & 4 ? 1.0f : -1.0f };
+			for (int j = 0; j < 3; ++j) {
+				float value = matrix[12 + j] + position[0] * matrix[j] + position[1] * matrix[4 + j] + position[2] * matrix[8 + j];
+				expectedMin[j] = std::min(expectedMin[j], value);
+				expectedMax[j] = std::max(expectedMax[j], value);
+			}
+		}
+
+		for (int j = 0; j < 3; ++j) {
+			if (fabsf(transformedMin[j] - expectedMin[j]) > 1e-4f || fabsf(transformedMax[j] - expectedMax[j]) > 1e-4f)
+				return false;
+		}
+	}
+	return true;
+}
+
+static volatile uint32_t cullBenchSink;
+
+static int CullBench(uint32_t seed) {
+	if (!CheckTransformBounds(seed)) {
+		fprintf(stderr, "transformed bounds checks failed with seed %u\n", seed);
+		return 1;
+	}
+
+	if (!CheckCullingBvh(seed)) {
+		fprintf(stderr, "culling checks failed with seed %u\n", seed);
+		return 1;
+	}
+	printf("hierarchy checks passed, culling matches brute force from %d views after building and refitting\n", cullCheckViewCount);
+
+	uint32_t random = seed;
+	for (uint32_t count : { 100000u, 1000000u }) {
+		std::vector<float> boundsMin, boundsMax;
+		float worldSize;
+		GenerateCullBenchBoxes(random, count, boundsMin, boundsMax, worldSize);
+
+		CullingBvh bvh;
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < cullBenchBuildCount; ++i)
+			CullingBvhBuild(bvh, &boundsMin[0], &boundsMax[0], count);
+		double buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / cullBenchBuildCount;
+
+		// the moves are picked up front so the refit is all that is measured
+		uint32_t movedCount = count * cullBenchMovedPercent / 100;
+		std::vector<uint32_t> moved(movedCount);
+		for (uint32_t& object : moved) {
+			object = NextRandom(random) % count;
+			MoveCullBenchBox(random, 0.5f, &boundsMin[object * 3], &boundsMax[object * 3]);
+		}
+
+		start = std::chrono::steady_clock::now();
+		for (uint32_t object : moved)
+			CullingBvhSetBounds(bvh, object, &boundsMin[object * 3], &boundsMax[object * 3]);
+		CullingBvhRefit(bvh);
+		double refitSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		std::vector<CullingFrustum> frustums(cullBenchViewCount);
+		for (CullingFrustum& frustum : frustums)
+			GenerateCullBenchFrustum(random, worldSize, false, frustum);
+
+		std::vector<uint32_t> visible(count);
+		uint64_t visibleTotal = 0;
+		start = std::chrono::steady_clock::now();
+		for (const CullingFrustum& frustum : frustums)
+			visibleTotal += CullingBvhCull(bvh, frustum, &visible[0]);
+		double cullSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / cullBenchViewCount;
+
+		uint64_t bruteForceTotal = 0;
+		start = std::chrono::steady_clock::now();
+		for (const CullingFrustum& frustum : frustums) {
+			uint32_t visibleCount = 0;
+			for (uint32_t i = 0; i < count; ++i) {
+				if (CullingFrustumTestBox(frustum, &boundsMin[i * 3], &boundsMax[i * 3]))
+					visible[visibleCount++] = i;
+			}
+			bruteForceTotal += visibleCount;
+		}
+		double bruteForceSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / cullBenchViewCount;
+		cullBenchSink = visible[0];
+
+		if (bruteForceTotal != visibleTotal) {
+			fprintf(stderr, "%u objects: %llu visible in total, brute force says %llu\n", count, (unsigned long long)visibleTotal, (unsigned long long)bruteForceTotal);
+			return 1;
+		}
+
+		printf("%u objects, %u nodes, %u leaves, %u deep, built in %.1f ms, %u moved and refitted in %.2f ms (%u leaves)\n",
+			count, bvh.stats.nodeCount, bvh.stats.leafCount, bvh.stats.depth, buildSeconds * 1000.0, movedCount, refitSeconds * 1000.0,
+			bvh.stats.lastRefitLeafCount);
+		printf("%u objects, %.1f%% visible, culled in %.3f ms, testing every box takes %.3f ms, %.1fx faster\n",
+			count, 100.0 * visibleTotal / ((double)count * cullBenchViewCount), cullSeconds * 1000.0, bruteForceSeconds * 1000.0,
+			bruteForceSeconds / cullSeconds);
+	}
+	return 0;
+}
+
+// scene objects from the boxes of the culling benchmark, each box is the unit cube moved and scaled into place
+static void GenerateGpuSceneObjects(uint32_t& random, uint32_t count, std::vector<GpuSceneObject>& objects, float& worldSize) {
+	std::vector<float> boundsMin, boundsMax;
+	GenerateCullBenchBoxes(random, count, boundsMin, boundsMax, worldSize);
+
+	const float unitMin[3] = { -1.0f, -1.0f, -1.0f };
+	const float unitMax[3] = { 1.0f, 1.0f, 1.0f };
+	objects.resize(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		float worldMat[16] = {};
+		for (int j = 0; j < 3; ++j) {
+			worldMat[j * 5] = (boundsMax[i * 3 + j] - boundsMin[i * 3 + j]) * 0.5f;
+			worldMat[12 + j] = (boundsMax[i * 3 + j] + boundsMin[i * 3 + j]) * 0.5f;
+		}
+		worldMat[15] = 1.0f;
+		GpuSceneObjectInit(objects[i], worldMat, unitMin, unitMax);
+	}
+}
+
+// the layouts the shader and the command signature expect, and the transposed matrix and world box of an object
+static bool CheckGpuSceneLayouts() {
+	// root constant and D3D12_DRAW_INDEXED_ARGUMENTS, float4x4 and two float4, six float4 and two uints padded to a float4
+	if (sizeof(GpuDrawCommand) != 24 || sizeof(GpuSceneObject) != 96 || sizeof(GpuCullConstants) != 112)
+		return false;
+
+	float worldMat[16];
+	for (int i = 0; i < 16; ++i)
+		worldMat[i] = (float)(i + 1);
+	const float boundsMin[3] = { -1.0f, -2.0f, -3.0f };
+	const float boundsMax[3] = { 3.0f, 2.0f, 1.0f };
+
+	GpuSceneObject object;
+	GpuSceneObjectInit(object, worldMat, boundsMin, boundsMax);
+
+	float expectedMin[3], expectedMax[3];
+	TransformBounds(worldMat, boundsMin, boundsMax, expectedMin, expectedMax);
+	for (int row = 0; row < 4; ++row) {
+		for (int column = 0; column < 4; ++column) {
+			if (object.worldMat[row * 4 + column] != worldMat[column * 4 + row])
+				return false;
+		}
+	}
+	return memcmp(object.boundsMin, expectedMin, sizeof(expectedMin)) == 0 && memcmp(object.boundsMax, expectedMax, sizeof(expectedMax)) == 0;
+}
+
+// runs the threads of every group in a random order like the gpu may, and checks that the commands are a draw of
+// the mesh for each object the frustum test keeps, once, whatever the order
+static bool CheckGpuCulling(uint32_t seed) {
+	uint32_t random = seed;
+	for (uint32_t count : { 0u, 1u, 63u, 64u, 65u, 1000u, 20000u }) {
+		std::vector<GpuSceneObject> objects;
+		float worldSize;
+		GenerateGpuSceneObjects(random, count, objects, worldSize);
+
+		uint32_t groupCount = (count + gpuCullGroupSize - 1) / gpuCullGroupSize;
+		std::vector<uint32_t> threads(groupCount * gpuCullGroupSize);
+		std::vector<GpuDrawCommand> commands(count + 1);
+		std::vector<uint8_t> drawn(count);
+
+		for (int view = 0; view < indirectCheckViewCount; ++view) {
+			CullingFrustum frustum;
+			GenerateCullBenchFrustum(random, worldSize, view % 4 == 0, frustum);
+
+			GpuCullConstants constants;
+			GpuCullConstantsInit(constants, frustum, count, indirectCheckIndexCount);
+
+			for (uint32_t i = 0; i < threads.size(); ++i)
+				threads[i] = i;
+			for (uint32_t i = (uint32_t)threads.size(); i > 1; --i)
+				std::swap(threads[i - 1], threads[NextRandom(random) % i]);
+
+			uint32_t visibleCount = 0;
+			for (uint32_t thread : threads)
+				GpuCullObject(constants, objects.data(), thread, commands.data(), visibleCount);
+
+			std::fill(drawn.begin(), drawn.end(), 0);
+			for (uint32_t i = 0; i < visibleCount; ++i) {
+				const GpuDrawCommand& command = commands[i];
+				if (command.objectIndex >= count || drawn[command.objectIndex] || command.indexCountPerInstance != indirectCheckIndexCount ||
+					command.instanceCount != 1 || command.startIndexLocation != 0 || command.baseVertexLocation != 0 || command.startInstanceLocation != 0)
+					return false;
+				drawn[command.objectIndex] = 1;
+			}
+
+			for (uint32_t i = 0; i < count; ++i) {
+				bool visible = CullingFrustumTestBox(frustum, objects[i].boundsMin, objects[i].boundsMax);
+				if (visible != (drawn[i] != 0))
+					return false;
+			}
+
+			// the whole dispatch in order comes to the same count
+			if (GpuCullObjects(constants, objects.data(), commands.data()) != visibleCount)
+				return false;
+		}
+	}
+	return true;
+}
+
+static int IndirectBench(uint32_t seed) {
+	if (!CheckGpuSceneLayouts()) {
+		fprintf(stderr, "scene object or draw command layout checks failed\n");
+		return 1;
+	}
+
+	if (!CheckGpuCulling(seed)) {
+		fprintf(stderr, "culling kernel checks failed with seed %u\n", seed);
+		return 1;
+	}
+	printf("layout checks passed, culling kernel matches the frustum test from %d views in any thread order\n", indirectCheckViewCount);
+
+	uint32_t random = seed;
+	for (uint32_t count : { 100000u, 1000000u }) {
+		std::vector<GpuSceneObject> objects;
+		float worldSize;
+		GenerateGpuSceneObjects(random, count, objects, worldSize);
+
+		std::vector<GpuCullConstants> constants(indirectBenchViewCount);
+		for (GpuCullConstants& viewConstants : constants) {
+			CullingFrustum frustum;
+			GenerateCullBenchFrustum(random, worldSize, false, frustum);
+			GpuCullConstantsInit(viewConstants, frustum, count, indirectCheckIndexCount);
+		}
+
+		std::vector<GpuDrawCommand> commands(count);
+		uint64_t visibleTotal = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (const GpuCullConstants& viewConstants : constants)
+			visibleTotal += GpuCullObjects(viewConstants, objects.data(), commands.data());
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / indirectBenchViewCount;
+
+		printf("%u objects, %.1f%% visible, %.1f MB of objects and up to %.1f MB of commands, reference kernel takes %.2f ms (%.1f ns per object)\n",
+			count, 100.0 * visibleTotal / ((double)count * indirectBenchViewCount), count * sizeof(GpuSceneObject) / 1048576.0,
+			(count * sizeof(GpuDrawCommand) + sizeof(uint32_t)) / 1048576.0, seconds * 1000.0, seconds * 1e9 / count);
+	}
+	return 0;
+}
+
+// a command of every kind with random arguments, counted in expected
+static void RecordRandomRenderCommand(uint32_t& random, RenderCommandList& list, uint64_t expected[NULL_RENDER_COMMAND_COUNT]) {
+	uint32_t command = NextRandom(random) % NULL_RENDER_COMMAND_COUNT;
+	expected[command]++;
+
+	RenderBindPoint bindPoint = (RenderBindPoint)(NextRandom(random) % 2);
+	uint32_t index = NextRandom(random) % 64;
+	uint64_t address = ((uint64_t)NextRandom(random) << 32) | NextRandom(random);
+	void* pointer = (void*)(uintptr_t)(address & ~(uint64_t)7);
+
+	switch (command) {
+	case NULL_RENDER_SET_PIPELINE_STATE:
+		RenderCommandListSetPipelineState(list, pointer);
+		break;
+	case NULL_RENDER_SET_ROOT_SIGNATURE:
+		RenderCommandListSetRootSignature(list, bindPoint, pointer);
+		break;
+	case NULL_RENDER_SET_ROOT_CONSTANT_BUFFER:
+		RenderCommandListSetRootConstantBuffer(list, bindPoint, index, address);
+		break;
+	case NULL_RENDER_SET_ROOT_SHADER_RESOURCE:
+		RenderCommandListSetRootShaderResource(list, bindPoint, index, address);
+		break;
+	case NULL_RENDER_SET_ROOT_UNORDERED_ACCESS:
+		RenderCommandListSetRootUnorderedAccess(list, bindPoint, index, address);
+		break;
+	case NULL_RENDER_SET_ROOT_CONSTANTS: {
+		uint32_t values[64];
+		uint32_t count = 1 + NextRandom(random) % 64;
+		for (uint32_t i = 0; i < count; ++i)
+			values[i] = NextRandom(random);
+		RenderCommandListSetRootConstants(list, bindPoint, index, count, values, NextRandom(random) % (65 - count));
+		break;
+	}
+	case NULL_RENDER_SET_ROOT_DESCRIPTOR_TABLE: {
+		RenderDescriptor table = { 0, address };
+		RenderCommandListSetRootDescriptorTable(list, bindPoint, index, table);
+		break;
+	}
+	case NULL_RENDER_SET_DESCRIPTOR_HEAP:
+		RenderCommandListSetDescriptorHeap(list, pointer);
+		break;
+	case NULL_RENDER_SET_RENDER_TARGET: {
+		RenderDescriptor renderTarget = { address, 0 };
+		RenderDescriptor depthStencil = { NextRandom(random) % 2 ? address + 64 : 0, 0 };
+		RenderCommandListSetRenderTarget(list, renderTarget, depthStencil);
+		break;
+	}
+	case NULL_RENDER_SET_VIEWPORT: {
+		RenderViewport viewport = { RandomRange(random, 0, 100), RandomRange(random, 0, 100), RandomRange(random, 1, 4096), RandomRange(random, 1, 4096), 0.0f, 1.0f };
+		RenderCommandListSetViewport(list, viewport);
+		break;
+	}
+	case NULL_RENDER_SET_SCISSOR_RECT: {
+		RenderRect rect = { (int32_t)(NextRandom(random) % 100), (int32_t)(NextRandom(random) % 100), (int32_t)(NextRandom(random) % 4096), (int32_t)(NextRandom(random) % 4096) };
+		RenderCommandListSetScissorRect(list, rect);
+		break;
+	}
+	case NULL_RENDER_SET_PRIMITIVE_TOPOLOGY:
+		RenderCommandListSetPrimitiveTopology(list, NextRandom(random) % 64);
+		break;
+	case NULL_RENDER_SET_VERTEX_BUFFER: {
+		RenderVertexBufferView view = { address, NextRandom(random), NextRandom(random) % 256 };
+		RenderCommandListSetVertexBuffer(list, view);
+		break;
+	}
+	case NULL_RENDER_SET_INDEX_BUFFER: {
+		RenderIndexBufferView view = { address, NextRandom(random), NextRandom(random) % 2 ? 42u : 57u };
+		RenderCommandListSetIndexBuffer(list, view);
+		break;
+	}
+	case NULL_RENDER_CLEAR_RENDER_TARGET: {
+		RenderDescriptor renderTarget = { address, 0 };
+		const float color[4] = { RandomRange(random, 0, 1), RandomRange(random, 0, 1), RandomRange(random, 0, 1), 1.0f };
+		RenderCommandListClearRenderTarget(list, renderTarget, color);
+		break;
+	}
+	case NULL_RENDER_CLEAR_DEPTH: {
+		RenderDescriptor depthStencil = { address, 0 };
+		RenderCommandListClearDepth(list, depthStencil, RandomRange(random, 0, 1));
+		break;
+	}
+	case NULL_RENDER_DRAW_INDEXED_INSTANCED:
+		RenderCommandListDrawIndexedInstanced(list, NextRandom(random), NextRandom(random), NextRandom(random), (int32_t)NextRandom(random), NextRandom(random));
+		break;
+	case NULL_RENDER_DISPATCH:
+		RenderCommandListDispatch(list, NextRandom(random), NextRandom(random), NextRandom(random));
+		break;
+	case NULL_RENDER_DISPATCH_MESH:
+		RenderCommandListDispatchMesh(list, NextRandom(random), NextRandom(random), NextRandom(random));
+		break;
+	case NULL_RENDER_EXECUTE_INDIRECT:
+		RenderCommandListExecuteIndirect(list, pointer, NextRandom(random), (void*)(uintptr_t)(address + 8), NextRandom(random), NextRandom(random) % 2 ? pointer : nullptr, NextRandom(random));
+		break;
+	case NULL_RENDER_COPY_BUFFER_REGION:
+		RenderCommandListCopyBufferRegion(list, pointer, NextRandom(random), (void*)(uintptr_t)(address + 8), NextRandom(random), NextRandom(random));
+		break;
+	case NULL_RENDER_BARRIERS: {
+		RenderBarrier barriers[16];
+		uint32_t count = NextRandom(random) % 17;
+		for (uint32_t i = 0; i < count; ++i) {
+			RenderBarrier& barrier = barriers[i];
+			memset(&barrier, 0, sizeof(barrier));
+			barrier.type = NextRandom(random) % 4 == 0 ? RENDER_BARRIER_ALIASING : RENDER_BARRIER_TRANSITION;
+			barrier.resource = (void*)(uintptr_t)(NextRandom(random) * 8ull);
+			if (barrier.type == RENDER_BARRIER_ALIASING) {
+				barrier.resourceBefore = NextRandom(random) % 2 ? (void*)(uintptr_t)(NextRandom(random) * 8ull) : nullptr;
+				continue;
+			}
+			barrier.subresource = NextRandom(random) % 3 == 0 ? resourceStateAllSubresources : NextRandom(random) % 16;
+			barrier.stateBefore = NextRandom(random);
+			barrier.stateAfter = NextRandom(random);
+			barrier.flag = (ResourceBarrierFlag)(NextRandom(random) % 3);
+		}
+		RenderCommandListBarriers(list, barriers, count);
+		break;
+	}
+	}
+}
+
+static bool IsStreamEqual(const NullRenderCommandList& a, const NullRenderCommandList& b) {
+	return a.streamSize == b.streamSize && memcmp(a.stream.data(), b.stream.data(), a.streamSize) == 0;
+}
+
+// objects, fences and the byte layout of a command, then random commands have to come back the same from a replay,
+// and streams cut off in the middle of a command have to be refused
+static bool CheckNullRenderDevice(uint32_t seed) {
+	NullRenderDevice nullDevice;
+	NullRenderDeviceInit(nullDevice);
+	RenderDevice& device = nullDevice.device;
+
+	// buffers follow each other without overlapping, only the ones the cpu writes have memory
+	RenderBuffer uploadBuffer, defaultBuffer;
+	if (!RenderDeviceCreateBuffer(device, RENDER_HEAP_UPLOAD, 100000, 0, uploadBuffer) || !RenderDeviceCreateBuffer(device, RENDER_HEAP_DEFAULT, 256, 0, defaultBuffer))
+		return false;
+	if (uploadBuffer.cpuAddress == nullptr || defaultBuffer.cpuAddress != nullptr || uploadBuffer.gpuAddress == 0 ||
+		defaultBuffer.gpuAddress < uploadBuffer.gpuAddress + uploadBuffer.size || defaultBuffer.gpuAddress % (64 * 1024) != 0)
+		return false;
+	memset(uploadBuffer.cpuAddress, 0xcd, (size_t)uploadBuffer.size);
+	if (nullDevice.stats.bufferCount != 2 || nullDevice.stats.bufferBytes != 100256)
+		return false;
+	RenderDeviceDestroyBuffer(device, uploadBuffer);
+	RenderDeviceDestroyBuffer(device, defaultBuffer);
+	if (nullDevice.stats.bufferCount != 0 || nullDevice.stats.bufferBytes != 0 || uploadBuffer.resource != nullptr)
+		return false;
+
+	// signaled values are reached right away, values nobody signaled never are
+	RenderQueue queue;
+	RenderFence fence;
+	if (!RenderDeviceCreateQueue(device, RENDER_COMMAND_LIST_DIRECT, queue) || !RenderDeviceCreateFence(device, 3, fence))
+		return false;
+	if (RenderFenceGetCompletedValue(fence) != 3 || !RenderQueueSignal(queue, fence, 7) || RenderFenceGetCompletedValue(fence) != 7 ||
+		!RenderFenceWait(fence, 7) || RenderFenceWait(fence, 8) || !RenderQueueWait(queue, fence, 8))
+		return false;
+
+	RenderCommandList list, replayList;
+	if (!RenderDeviceCreateCommandList(device, RENDER_COMMAND_LIST_DIRECT, 2, list) || !RenderDeviceCreateCommandList(device, RENDER_COMMAND_LIST_DIRECT, 2, replayList))
+		return false;
+	NullRenderCommandList* nullList = NullRenderGetCommandList(list);
+	NullRenderCommandList* nullReplayList = NullRenderGetCommandList(replayList);
+
+	// created closed, only allocators the list has, no reset while recording
+	if (RenderCommandListClose(list) || RenderCommandListReset(list, 2, nullptr) || !RenderCommandListReset(list, 1, nullptr) || RenderCommandListReset(list, 0, nullptr))
+		return false;
+
+	// the command, then the arguments in order without padding
+	RenderCommandListDrawIndexedInstanced(list, 36, 2, 3, -4, 5);
+	const uint8_t drawBytes[] = { NULL_RENDER_DRAW_INDEXED_INSTANCED, 36, 0, 0, 0, 2, 0, 0, 0, 3, 0, 0, 0, 0xfc, 0xff, 0xff, 0xff, 5, 0, 0, 0 };
+	if (nullList->streamSize != sizeof(drawBytes) || memcmp(nullList->stream.data(), drawBytes, sizeof(drawBytes)) != 0 || !RenderCommandListClose(list))
+		return false;
+
+	// the pipeline a reset starts with is recorded
+	if (!RenderCommandListReset(list, 0, (void*)(uintptr_t)0x1234) || nullList->streamSize != 9 || nullList->commandCounts[NULL_RENDER_SET_PIPELINE_STATE] != 1 || !RenderCommandListClose(list))
+		return false;
+
+	uint32_t random = seed;
+	for (int run = 0; run < deviceCheckRunCount; ++run) {
+		uint64_t expected[NULL_RENDER_COMMAND_COUNT] = {};
+		int commandCount = run == 0 ? 0 : 1 + (int)(NextRandom(random) % deviceCheckCommandCount);
+
+		if (!RenderCommandListReset(list, run % 2, nullptr))
+			return false;
+		for (int i = 0; i < commandCount; ++i)
+			RecordRandomRenderCommand(random, list, expected);
+		if (!RenderCommandListClose(list))
+			return false;
+
+		for (uint32_t command = 0; command < NULL_RENDER_COMMAND_COUNT; ++command) {
+			if (nullList->commandCounts[command] != expected[command])
+				return false;
+		}
+
+		if (!RenderCommandListReset(replayList, 0, nullptr) || !NullRenderReplay(nullList->stream.data(), nullList->streamSize, replayList) || !RenderCommandListClose(replayList))
+			return false;
+		if (!IsStreamEqual(*nullList, *nullReplayList) || memcmp(nullList->commandCounts, nullReplayList->commandCounts, sizeof(nullList->commandCounts)) != 0)
+			return false;
+
+		// whatever executes is counted
+		NullRenderStats before = nullDevice.stats;
+		RenderQueueExecute(queue, &list, 1);
+		if (nullDevice.stats.executeCount != before.executeCount + 1 || nullDevice.stats.commandBytes != before.commandBytes + nullList->streamSize ||
+			nullDevice.stats.commandCounts[NULL_RENDER_BARRIERS] != before.commandCounts[NULL_RENDER_BARRIERS] + expected[NULL_RENDER_BARRIERS])
+			return false;
+
+		if (nullList->streamSize == 0)
+			continue;
+
+		// a stream that ends inside its last command
+		if (!RenderCommandListReset(replayList, 0, nullptr) || NullRenderReplay(nullList->stream.data(), nullList->streamSize - 1, replayList) || !RenderCommandListClose(replayList))
+			return false;
+
+		// and one that starts with a command that does not exist
+		uint8_t unknown = NULL_RENDER_COMMAND_COUNT;
+		if (!RenderCommandListReset(replayList, 0, nullptr) || NullRenderReplay(&unknown, 1, replayList) || !RenderCommandListClose(replayList))
+			return false;
+	}
+
+	RenderDeviceDestroyCommandList(list);
+	RenderDeviceDestroyCommandList(replayList);
+	RenderDeviceDestroyFence(fence);
+	RenderDeviceDestroyQueue(queue);
+	return nullDevice.stats.commandListCount == 0;
+}
+
+static bool CreateDeviceBenchPage(uint64_t size, FrameAllocatorPage& page, void* context) {
+	RenderDevice* device = static_cast<RenderDevice*>(context);
+	RenderBuffer* buffer = new RenderBuffer;
+
+	if (!RenderDeviceCreateBuffer(*device, RENDER_HEAP_UPLOAD, size, 0, *buffer)) {
+		delete buffer;
+		return false;
+	}
+
+	page.cpuAddress = buffer->cpuAddress;
+	page.gpuAddress = buffer->gpuAddress;
+	page.userData = buffer;
+	return true;
+}
+
+static void DestroyDeviceBenchPage(FrameAllocatorPage& page, void* context) {
+	RenderBuffer* buffer = static_cast<RenderBuffer*>(page.userData);
+	RenderDeviceDestroyBuffer(*static_cast<RenderDevice*>(context), *buffer);
+	delete buffer;
+}
+
+// made up objects the frame binds, the null device never looks at them
+struct DeviceBenchScene {
+	void* pipelineState;
+	void* rootSignature;
+	void* descriptorHeap;
+	void* backBuffer;
+	RenderDescriptor renderTarget;
+	RenderDescriptor depthStencil;
+	RenderDescriptor textures;
+	float dequantization[8];
+	RenderViewport viewport;
+	RenderRect scissorRect;
+	RenderVertexBufferView vertexBuffer;
+	RenderIndexBufferView indexBuffer;
+};
+
+// what the renderer's RecordDrawState binds
+static void RecordDeviceBenchDrawState(RenderCommandList& list, const DeviceBenchScene& scene) {
+	RenderCommandListSetRenderTarget(list, scene.renderTarget, scene.depthStencil);
+	RenderCommandListSetRootSignature(list, RENDER_BIND_GRAPHICS, scene.rootSignature);
+	RenderCommandListSetDescriptorHeap(list, scene.descriptorHeap);
+	RenderCommandListSetRootDescriptorTable(list, RENDER_BIND_GRAPHICS, 1, scene.textures);
+	uint32_t textureIndex = 0;
+	RenderCommandListSetRootConstants(list, RENDER_BIND_GRAPHICS, 3, 1, &textureIndex, 0);
+	RenderCommandListSetRootConstants(list, RENDER_BIND_GRAPHICS, 4, 8, scene.dequantization, 0);
+	RenderCommandListSetViewport(list, scene.viewport);
+	RenderCommandListSetScissorRect(list, scene.scissorRect);
+	RenderCommandListSetPrimitiveTopology(list, deviceBenchTriangleList);
+	RenderCommandListSetVertexBuffer(list, scene.vertexBuffer);
+	RenderCommandListSetIndexBuffer(list, scene.indexBuffer);
+}
+
+static void RecordDeviceBenchDraws(RenderCommandList& list, const DeviceBenchScene& scene, const uint64_t* constantBuffers, size_t first, size_t last) {
+	RecordDeviceBenchDrawState(list, scene);
+	for (size_t i = first; i < last; ++i) {
+		RenderCommandListSetRootConstantBuffer(list, RENDER_BIND_GRAPHICS, 0, constantBuffers[i]);
+		RenderCommandListDrawIndexedInstanced(list, indirectCheckIndexCount, 1, 0, 0, 0);
+	}
+}
+
+static void RecordDeviceBenchWorker(RenderCommandList* list, const DeviceBenchScene* scene, const uint64_t* constantBuffers, size_t first, size_t last, int frameContext) {
+	RenderCommandListReset(*list, frameContext, scene->pipelineState);
+	RecordDeviceBenchDraws(*list, *scene, constantBuffers, first, last);
+	RenderCommandListClose(*list);
+}
+
+static RenderBarrier GetDeviceBenchTransition(void* resource, uint32_t stateBefore, uint32_t stateAfter) {
+	RenderBarrier barrier = {};
+	barrier.type = RENDER_BARRIER_TRANSITION;
+	barrier.resource = resource;
+	barrier.subresource = resourceStateAllSubresources;
+	barrier.stateBefore = stateBefore;
+	barrier.stateAfter = stateAfter;
+	return barrier;
+}
+
+struct DeviceBenchFrameTimes {
+	double constantSeconds;
+	double recordSeconds;
+	double submitSeconds;
+};
+
+// the renderer's frame with drawCount cubes: wait for the frame context, write a matrix per draw into the frame
+// allocator, clear, draw, and go back to present, with the draws split over threadCount lists like the record threads
+static bool BuildDeviceBenchFrame(RenderQueue& queue, RenderFence& fence, std::vector<RenderCommandList>& lists,
+	FrameAllocator& frameAllocator, const DeviceBenchScene& scene, const std::vector<float>& worldMats, uint64_t frameFenceValues[], uint64_t& fenceValue,
+	int frame, int threadCount, std::vector<uint64_t>& constantBuffers, DeviceBenchFrameTimes& times) {
+	auto start = std::chrono::steady_clock::now();
+	int frameContext = frame % deviceBenchFramesInFlight;
+	size_t drawCount = constantBuffers.size();
+
+	if (!RenderFenceWait(fence, frameFenceValues[frameContext]))
+		return false;
+	FrameAllocatorReclaim(frameAllocator, RenderFenceGetCompletedValue(fence));
+
+	float viewProj[16] = {};
+	for (int i = 0; i < 4; ++i)
+		viewProj[i * 5] = 1.0f + frame * 0.001f;
+
+	for (size_t i = 0; i < drawCount; ++i) {
+		FrameAllocation allocation;
+		if (!FrameAllocatorAllocate(frameAllocator, 64, FrameAllocatorDefaultAlignment, allocation))
+			return false;
+
+		float wvp[16];
+		memcpy(wvp, &worldMats[i * 16], sizeof(wvp));
+		MultiplyMatrix(wvp, viewProj);
+		memcpy(allocation.cpuAddress, wvp, sizeof(wvp));
+		constantBuffers[i] = allocation.gpuAddress;
+	}
+
+	auto constantsDone = std::chrono::steady_clock::now();
+
+	// main list, the workers' lists, then the list that goes back to present
+	RenderCommandList& mainList = lists[0];
+	RenderCommandList& presentList = lists.back();
+	if (!RenderCommandListReset(mainList, frameContext, scene.pipelineState))
+		return false;
+
+	RenderBarrier toRenderTarget = GetDeviceBenchTransition(scene.backBuffer, stateCommon, stateRenderTarget);
+	RenderCommandListBarriers(mainList, &toRenderTarget, 1);
+
+	const float clearColor[] = { 0.0f, 0.2f, 0.4f, 1.0f };
+	RenderCommandListClearRenderTarget(mainList, scene.renderTarget, clearColor);
+	RenderCommandListClearDepth(mainList, scene.depthStencil, 1.0f);
+
+	RenderBarrier toPresent = GetDeviceBenchTransition(scene.backBuffer, stateRenderTarget, stateCommon);
+	uint32_t submitCount;
+	if (threadCount <= 1) {
+		RecordDeviceBenchDraws(mainList, scene, constantBuffers.data(), 0, drawCount);
+		RenderCommandListBarriers(mainList, &toPresent, 1);
+		if (!RenderCommandListClose(mainList))
+			return false;
+		submitCount = 1;
+	}
+	else {
+		if (!RenderCommandListClose(mainList))
+			return false;
+
+		std::vector<std::thread> threads;
+		for (int t = 0; t < threadCount; ++t) {
+			size_t first = drawCount * t / threadCount;
+			size_t last = drawCount * (t + 1) / threadCount;
+			threads.push_back(std::thread(RecordDeviceBenchWorker, &lists[1 + t], &scene, constantBuffers.data(), first, last, frameContext));
+		}
+
+		if (!RenderCommandListReset(presentList, frameContext, nullptr))
+			return false;
+		RenderCommandListBarriers(presentList, &toPresent, 1);
+		if (!RenderCommandListClose(presentList))
+			return false;
+
+		for (std::thread& thread : threads)
+			thread.join();
+		submitCount = threadCount + 2;
+	}
+
+	auto recordDone = std::chrono::steady_clock::now();
+
+	RenderQueueExecute(queue, lists.data(), submitCount);
+
+	fenceValue++;
+	if (!RenderQueueSignal(queue, fence, fenceValue))
+		return false;
+	frameFenceValues[frameContext] = fenceValue;
+	FrameAllocatorFinishFrame(frameAllocator, fenceValue);
+
+	auto end = std::chrono::steady_clock::now();
+	times.constantSeconds += std::chrono::duration<double>(constantsDone - start).count();
+	times.recordSeconds += std::chrono::duration<double>(recordDone - constantsDone).count();
+	times.submitSeconds += std::chrono::duration<double>(end - recordDone).count();
+	return true;
+}
+
+static int DeviceBench(uint32_t seed) {
+	if (!CheckNullRenderDevice(seed)) {
+		fprintf(stderr, "null render device checks failed with seed %u\n", seed);
+		return 1;
+	}
+	printf("null render device checks passed, %d random command lists replay to the same bytes\n", deviceCheckRunCount);
+
+	NullRenderDevice nullDevice;
+	NullRenderDeviceInit(nullDevice);
+	RenderDevice& device = nullDevice.device;
+
+	RenderQueue queue;
+	RenderFence fence;
+	if (!RenderDeviceCreateQueue(device, RENDER_COMMAND_LIST_DIRECT, queue) || !RenderDeviceCreateFence(device, 0, fence)) {
+		fprintf(stderr, "could not create the queue and fence\n");
+		return 1;
+	}
+
+	// main list, a list per record thread and the present list
+	std::vector<RenderCommandList> lists(deviceBenchThreadCount + 2);
+	for (RenderCommandList& list : lists) {
+		if (!RenderDeviceCreateCommandList(device, RENDER_COMMAND_LIST_DIRECT, deviceBenchFramesInFlight, list)) {
+			fprintf(stderr, "could not create the command lists\n");
+			return 1;
+		}
+	}
+
+	FrameAllocator frameAllocator;
+	FrameAllocatorInit(frameAllocator, FrameAllocatorDefaultPageSize, CreateDeviceBenchPage, DestroyDeviceBenchPage, &device);
+
+	DeviceBenchScene scene = {};
+	scene.pipelineState = (void*)(uintptr_t)0x1000;
+	scene.rootSignature = (void*)(uintptr_t)0x2000;
+	scene.descriptorHeap = (void*)(uintptr_t)0x3000;
+	scene.backBuffer = (void*)(uintptr_t)0x4000;
+	scene.renderTarget.cpuHandle = 0x100000;
+	scene.depthStencil.cpuHandle = 0x200000;
+	scene.textures.gpuHandle = 0x300000;
+	scene.viewport = { 0.0f, 0.0f, 1920.0f, 1080.0f, 0.0f, 1.0f };
+	scene.scissorRect = { 0, 0, 1920, 1080 };
+	scene.vertexBuffer = { 0x10000, 24 * 32, 32 };
+	scene.indexBuffer = { 0x20000, indirectCheckIndexCount * 4, deviceBenchIndexFormat };
+
+	uint32_t random = seed;
+	uint64_t frameFenceValues[deviceBenchFramesInFlight] = {};
+	uint64_t fenceValue = 0;
+	int frame = 0;
+
+	for (uint32_t drawCount : { 10000u, 30000u, 100000u }) {
+		std::vector<float> worldMats(drawCount * 16);
+		for (float& value : worldMats)
+			value = RandomRange(random, -1.0f, 1.0f);
+		std::vector<uint64_t> constantBuffers(drawCount);
+
+		for (int threadCount : { 1, deviceBenchThreadCount }) {
+			NullRenderStats before = nullDevice.stats;
+			DeviceBenchFrameTimes times = {};
+
+			for (int i = 0; i < deviceBenchFrameCount; ++i, ++frame) {
+				if (!BuildDeviceBenchFrame(queue, fence, lists, frameAllocator, scene, worldMats, frameFenceValues, fenceValue, frame, threadCount, constantBuffers, times)) {
+					fprintf(stderr, "frame %d with %u draws failed\n", frame, drawCount);
+					return 1;
+				}
+			}
+
+			// every draw with its constant buffer made it to the queue, and nothing else did
+			const NullRenderStats& stats = nullDevice.stats;
+			uint64_t draws = stats.commandCounts[NULL_RENDER_DRAW_INDEXED_INSTANCED] - before.commandCounts[NULL_RENDER_DRAW_INDEXED_INSTANCED];
+			uint64_t constantBufferViews = stats.commandCounts[NULL_RENDER_SET_ROOT_CONSTANT_BUFFER] - before.commandCounts[NULL_RENDER_SET_ROOT_CONSTANT_BUFFER];
+			uint64_t expectedDraws = (uint64_t)drawCount * deviceBenchFrameCount;
+			if (draws != expectedDraws || constantBufferViews != expectedDraws) {
+				fprintf(stderr, "%u draws on %d threads executed %llu draws and %llu constant buffers\n", drawCount, threadCount,
+					(unsigned long long)draws, (unsigned long long)constantBufferViews);
+				return 1;
+			}
+
+			uint64_t commands = 0;
+			for (uint32_t command = 0; command < NULL_RENDER_COMMAND_COUNT; ++command)
+				commands += stats.commandCounts[command] - before.commandCounts[command];
+			uint64_t bytes = stats.commandBytes - before.commandBytes;
+
+			double drawsTotal = (double)expectedDraws;
+			printf("%u draws on %d thread%s: constants %.1f ns, recording %.1f ns per draw, submit %.3f ms per frame, %.1f command bytes per draw, %llu commands per frame\n",
+				drawCount, threadCount, threadCount == 1 ? "" : "s", times.constantSeconds * 1e9 / drawsTotal, times.recordSeconds * 1e9 / drawsTotal,
+				times.submitSeconds * 1000.0 / deviceBenchFrameCount, bytes / drawsTotal, (unsigned long long)(commands / deviceBenchFrameCount));
+		}
+	}
+
+	printf("frame allocator: %llu pages, %.1f MB reserved\n", (unsigned long long)frameAllocator.stats.pageCount, frameAllocator.stats.reservedBytes / 1048576.0);
+
+	RenderFenceWait(fence, fenceValue);
+	FrameAllocatorDestroy(frameAllocator);
+	for (RenderCommandList& list : lists)
+		RenderDeviceDestroyCommandList(list);
+	RenderDeviceDestroyFence(fence);
+	RenderDeviceDestroyQueue(queue);
+	return 0;
+}
+
+#if defined(_WIN32) || defined(ENABLE_DIRECTX_HEADERS)
+// pipeline hashes and the pipeline cache file
+
+// fnv-1a 64 of "", "a" and "foobar" from the reference implementation, pins the hash across builds
+static bool CheckHashBytes() {
+	return HashBytes(pipelineHashSeed, "", 0) == 0xcbf29ce484222325ull &&
+		HashBytes(pipelineHashSeed, "a", 1) == 0xaf63dc4c8601ec8cull &&
+		HashBytes(pipelineHashSeed, "foobar", 6) == 0x85944171f73967e8ull;
+}
+
+// a graphics pipeline desc and everything it points to, filled in over garbage so that the padding differs
+// between copies the way it does between runs of the renderer
+struct PipelineCheckDesc {
+	uint8_t vs[64];
+	uint8_t ps[64];
+	uint8_t ds[32];
+	uint8_t hs[32];
+	uint8_t gs[32];
+	char semanticNames[2][16];
+	char streamOutNames[2][16];
+	D3D12_INPUT_ELEMENT_DESC elements[2];
+	D3D12_SO_DECLARATION_ENTRY streamOutEntries[2];
+	UINT streamOutStrides[2];
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC desc;
+};
+
+static void FillPipelineCheckShader(uint8_t* bytecode, size_t size, uint8_t stage) {
+	for (size_t i = 0; i < size; ++i)
+		bytecode[i] = (uint8_t)(i * 7 + stage);
+}
+
+static void InitPipelineCheckDesc(PipelineCheckDesc& check, uint8_t garbage) {
+	memset(&check, garbage, sizeof(check));
+
+	FillPipelineCheckShader(check.vs, sizeof(check.vs), 1);
+	FillPipelineCheckShader(check.ps, sizeof(check.ps), 2);
+	FillPipelineCheckShader(check.ds, sizeof(check.ds), 3);
+	FillPipelineCheckShader(check.hs, sizeof(check.hs), 4);
+	FillPipelineCheckShader(check.gs, sizeof(check.gs), 5);
+
+	strcpy(check.semanticNames[0], "POSITION");
+	strcpy(check.semanticNames[1], "TEXCOORD");
+	strcpy(check.streamOutNames[0], "SV_POSITION");
+	strcpy(check.streamOutNames[1], "TEXCOORD");
+
+	check.elements[0] = { check.semanticNames[0], 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 };
+	check.elements[1] = { check.semanticNames[1], 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 };
+	check.streamOutEntries[0] = { 0, check.streamOutNames[0], 0, 0, 4, 0 };
+	check.streamOutEntries[1] = { 0, check.streamOutNames[1], 0, 0, 2, 0 };
+	check.streamOutStrides[0] = 16;
+	check.streamOutStrides[1] = 8;
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc = check.desc;
+	desc.pRootSignature = nullptr;
+	desc.VS = { check.vs, sizeof(check.vs) };
+	desc.PS = { check.ps, sizeof(check.ps) };
+	desc.DS = { check.ds, sizeof(check.ds) };
+	desc.HS = { check.hs, sizeof(check.hs) };
+	desc.GS = { check.gs, sizeof(check.gs) };
+	desc.StreamOutput = { check.streamOutEntries, 2, check.streamOutStrides, 2, 0 };
+
+	desc.BlendState.AlphaToCoverageEnable = FALSE;
+	desc.BlendState.IndependentBlendEnable = FALSE;
+	for (int i = 0; i < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i) {
+		D3D12_RENDER_TARGET_BLEND_DESC& target = desc.BlendState.RenderTarget[i];
+		target.BlendEnable = FALSE;
+		target.LogicOpEnable = FALSE;
+		target.SrcBlend = D3D12_BLEND_ONE;
+		target.DestBlend = D3D12_BLEND_ZERO;
+		target.BlendOp = D3D12_BLEND_OP_ADD;
+		target.SrcBlendAlpha = D3D12_BLEND_ONE;
+		target.DestBlendAlpha = D3D12_BLEND_ZERO;
+		target.BlendOpAlpha = D3D12_BLEND_OP_ADD;
+		target.LogicOp = D3D12_LOGIC_OP_NOOP;
+		target.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+	}
+	desc.SampleMask = UINT_MAX;
+
+	desc.RasterizerState.FillMode = D3D12_FILL_MODE_SOLID;
+	desc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
+	desc.RasterizerState.FrontCounterClockwise = FALSE;
+	desc.RasterizerState.DepthBias = 0;
+	desc.RasterizerState.DepthBiasClamp = 0.0f;
+	desc.RasterizerState.SlopeScaledDepthBias = 0.0f;
+	desc.RasterizerState.DepthClipEnable = TRUE;
+	desc.RasterizerState.MultisampleEnable = FALSE;
+	desc.RasterizerState.AntialiasedLineEnable = FALSE;
+	desc.RasterizerState.ForcedSampleCount = 0;
+	desc.RasterizerState.ConservativeRaster = D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF;
+
+	desc.DepthStencilState.DepthEnable = TRUE;
+	desc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
+	desc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
+	desc.DepthStencilState.StencilEnable = FALSE;
+	desc.DepthStencilState.StencilReadMask = D3D12_DEFAULT_STENCIL_READ_MASK;
+	desc.DepthStencilState.StencilWriteMask = D3D12_DEFAULT_STENCIL_WRITE_MASK;
+	desc.DepthStencilState.FrontFace = { D3D12_STENCIL_OP_KEEP, D3D12_STENCIL_OP_KEEP, D3D12_STENCIL_OP_KEEP, D3D12_COMPARISON_FUNC_ALWAYS };
+	desc.DepthStencilState.BackFace = desc.DepthStencilState.FrontFace;
+
+	desc.InputLayout = { check.elements, 2 };
+	desc.IBStripCutValue = D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_DISABLED;
+	desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+	desc.NumRenderTargets = 2;
+	for (int i = 0; i < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i)
+		desc.RTVFormats[i] = DXGI_FORMAT_UNKNOWN;
+	desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.RTVFormats[1] = DXGI_FORMAT_R16G16B16A16_FLOAT;
+	desc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+	desc.SampleDesc = { 1, 0 };
+	desc.NodeMask = 0;
+	desc.CachedPSO = { nullptr, 0 };
+	desc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
+}
+
+// changes one thing that makes a different pipeline, false past the last one
+static bool ChangePipelineCheckDesc(PipelineCheckDesc& check, int change) {
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc = check.desc;
+	D3D12_RENDER_TARGET_BLEND_DESC& target = desc.BlendState.RenderTarget[0];
+	D3D12_RASTERIZER_DESC& rasterizer = desc.RasterizerState;
+	D3D12_DEPTH_STENCIL_DESC& depthStencil = desc.DepthStencilState;
+
+	switch (change) {
+	case 0: check.vs[10] ^= 1; break;
+	case 1: desc.VS.BytecodeLength--; break;
+	case 2: check.ps[0] ^= 1; break;
+	case 3: check.ds[31] ^= 1; break;
+	case 4: check.hs[5] ^= 1; break;
+	case 5: check.gs[5] ^= 1; break;
+	case 6: desc.GS = { nullptr, 0 }; break;
+	case 7: check.streamOutEntries[1].Stream = 1; break;
+	case 8: check.streamOutNames[1][0] = 'X'; break;
+	case 9: check.streamOutEntries[1].SemanticIndex = 1; break;
+	case 10: check.streamOutEntries[1].StartComponent = 1; break;
+	case 11: check.streamOutEntries[1].ComponentCount = 1; break;
+	case 12: check.streamOutEntries[1].OutputSlot = 1; break;
+	case 13: desc.StreamOutput.NumEntries = 1; break;
+	case 14: check.streamOutStrides[1] = 12; break;
+	case 15: desc.StreamOutput.NumStrides = 1; break;
+	case 16: desc.StreamOutput.RasterizedStream = D3D12_SO_NO_RASTERIZED_STREAM; break;
+	case 17: desc.BlendState.AlphaToCoverageEnable = TRUE; break;
+	case 18: desc.BlendState.IndependentBlendEnable = TRUE; break;
+	case 19: target.BlendEnable = TRUE; break;
+	case 20: target.LogicOpEnable = TRUE; break;
+	case 21: target.SrcBlend = D3D12_BLEND_SRC_ALPHA; break;
+	case 22: target.DestBlend = D3D12_BLEND_INV_SRC_ALPHA; break;
+	case 23: target.BlendOp = D3D12_BLEND_OP_SUBTRACT; break;
+	case 24: target.SrcBlendAlpha = D3D12_BLEND_ZERO; break;
+	case 25: target.DestBlendAlpha = D3D12_BLEND_ONE; break;
+	case 26: target.BlendOpAlpha = D3D12_BLEND_OP_MAX; break;
+	case 27: target.LogicOp = D3D12_LOGIC_OP_CLEAR; break;
+	case 28: target.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_RED; break;
+	case 29: desc.BlendState.RenderTarget[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT - 1].BlendEnable = TRUE; break;
+	case 30: desc.SampleMask = 1; break;
+	case 31: rasterizer.FillMode = D3D12_FILL_MODE_WIREFRAME; break;
+	case 32: rasterizer.CullMode = D3D12_CULL_MODE_NONE; break;
+	case 33: rasterizer.FrontCounterClockwise = TRUE; break;
+	case 34: rasterizer.DepthBias = 1; break;
+	case 35: rasterizer.DepthBiasClamp = 1.0f; break;
+	case 36: rasterizer.SlopeScaledDepthBias = 1.0f; break;
+	case 37: rasterizer.DepthClipEnable = FALSE; break;
+	case 38: rasterizer.MultisampleEnable = TRUE; break;
+	case 39: rasterizer.AntialiasedLineEnable = TRUE; break;
+	case 40: rasterizer.ForcedSampleCount = 4; break;
+	case 41: rasterizer.ConservativeRaster = D3D12_CONSERVATIVE_RASTERIZATION_MODE_ON; break;
+	case 42: depthStencil.DepthEnable = FALSE; break;
+	case 43: depthStencil.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO; break;
+	case 44: depthStencil.DepthFunc = D3D12_COMPARISON_FUNC_GREATER; break;
+	case 45: depthStencil.StencilEnable = TRUE; break;
+	case 46: depthStencil.StencilReadMask = 0x0f; break;
+	case 47: depthStencil.StencilWriteMask = 0x0f; break;
+	case 48: depthStencil.FrontFace.StencilFailOp = D3D12_STENCIL_OP_ZERO; break;
+	case 49: depthStencil.FrontFace.StencilDepthFailOp = D3D12_STENCIL_OP_ZERO; break;
+	case 50: depthStencil.FrontFace.StencilPassOp = D3D12_STENCIL_OP_REPLACE; break;
+	case 51: depthStencil.FrontFace.StencilFunc = D3D12_COMPARISON_FUNC_EQUAL; break;
+	case 52: depthStencil.BackFace.StencilFailOp = D3D12_STENCIL_OP_ZERO; break;
+	case 53: depthStencil.BackFace.StencilDepthFailOp = D3D12_STENCIL_OP_ZERO; break;
+	case 54: depthStencil.BackFace.StencilPassOp = D3D12_STENCIL_OP_REPLACE; break;
+	case 55: depthStencil.BackFace.StencilFunc = D3D12_COMPARISON_FUNC_EQUAL; break;
+	case 56: desc.InputLayout.NumElements = 1; break;
+	case 57: check.semanticNames[1][0] = 'X'; break;
+	case 58: check.elements[1].SemanticIndex = 1; break;
+	case 59: check.elements[1].Format = DXGI_FORMAT_R16G16_FLOAT; break;
+	case 60: check.elements[1].InputSlot = 1; break;
+	case 61: check.elements[1].AlignedByteOffset = 16; break;
+	case 62: check.elements[1].InputSlotClass = D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA; break;
+	case 63: check.elements[1].InstanceDataStepRate = 1; break;
+	case 64: desc.IBStripCutValue = D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_0xFFFF; break;
+	case 65: desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE; break;
+	case 66: desc.NumRenderTargets = 1; break;
+	case 67: desc.RTVFormats[0] = DXGI_FORMAT_B8G8R8A8_UNORM; break;
+	case 68: desc.RTVFormats[1] = DXGI_FORMAT_R11G11B10_FLOAT; break;
+	case 69: desc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT; break;
+	case 70: desc.SampleDesc.Count = 4; break;
+	case 71: desc.SampleDesc.Quality = 1; break;
+	case 72: desc.NodeMask = 1; break;
+	case 73: desc.Flags = D3D12_PIPELINE_STATE_FLAG_TOOL_DEBUG; break;
+	default: return false;
+	}
+	return true;
+}
+
+// changes one thing the runtime ignores or that is not part of the key, false past the last one
+static bool ChangeIgnoredPipelineCheckDesc(PipelineCheckDesc& check, int change) {
+	switch (change) {
+	case 0: check.desc.RTVFormats[check.desc.NumRenderTargets] = DXGI_FORMAT_R8G8B8A8_UNORM; break;
+	case 1: check.desc.pRootSignature = reinterpret_cast<ID3D12RootSignature*>(&check); break;
+	case 2: check.desc.CachedPSO = { check.vs, sizeof(check.vs) }; break;
+	default: return false;
+	}
+	return true;
+}
+
+// what the renderer does, the root signature is hashed from its serialized blob
+static uint64_t GetPipelineCheckRootSignatureHash(const char* name) {
+	return HashBytes(pipelineHashSeed, name, strlen(name));
+}
+
+static bool CheckGraphicsPipelineHashes() {
+	uint64_t rootSignatureHash = GetPipelineCheckRootSignatureHash("graphics");
+
+	// heap copies, so that the descs and what they point to live at different addresses
+	std::vector<PipelineCheckDesc> checks(2);
+	InitPipelineCheckDesc(checks[0], 0x00);
+	InitPipelineCheckDesc(checks[1], 0xff);
+	uint64_t hash = HashGraphicsPipelineDesc(checks[0].desc, rootSignatureHash);
+	if (hash != HashGraphicsPipelineDesc(checks[1].desc, rootSignatureHash))
+		return false;
+
+	if (HashGraphicsPipelineDesc(checks[0].desc, GetPipelineCheckRootSignatureHash("other")) == hash)
+		return false;
+
+	std::vector<uint64_t> hashes(1, hash);
+	for (int change = 0;; ++change) {
+		InitPipelineCheckDesc(checks[0], 0x00);
+		if (!ChangePipelineCheckDesc(checks[0], change))
+			break;
+		hashes.push_back(HashGraphicsPipelineDesc(checks[0].desc, rootSignatureHash));
+	}
+
+	// every change gives its own hash, not only one that differs from the unchanged desc
+	std::sort(hashes.begin(), hashes.end());
+	if (std::adjacent_find(hashes.begin(), hashes.end()) != hashes.end())
+		return false;
+
+	for (int change = 0;; ++change) {
+		InitPipelineCheckDesc(checks[0], 0x00);
+		if (!ChangeIgnoredPipelineCheckDesc(checks[0], change))
+			break;
+		if (HashGraphicsPipelineDesc(checks[0].desc, rootSignatureHash) != hash)
+			return false;
+	}
+
+	return true;
+}
+
+static bool CheckComputePipelineHashes() {
+	uint64_t rootSignatureHash = GetPipelineCheckRootSignatureHash("compute");
+
+	uint8_t cs[64];
+	FillPipelineCheckShader(cs, sizeof(cs), 6);
+
+	D3D12_COMPUTE_PIPELINE_STATE_DESC desc = {};
+	desc.CS = { cs, sizeof(cs) };
+	uint64_t hash = HashComputePipelineDesc(desc, rootSignatureHash);
+
+	std::vector<uint64_t> hashes(1, hash);
+	hashes.push_back(HashComputePipelineDesc(desc, GetPipelineCheckRootSignatureHash("other")));
+
+	D3D12_COMPUTE_PIPELINE_STATE_DESC changed = desc;
+	changed.CS.BytecodeLength--;
+	hashes.push_back(HashComputePipelineDesc(changed, rootSignatureHash));
+
+	changed = desc;
+	changed.NodeMask = 1;
+	hashes.push_back(HashComputePipelineDesc(changed, rootSignatureHash));
+
+	changed = desc;
+	changed.Flags = D3D12_PIPELINE_STATE_FLAG_TOOL_DEBUG;
+	hashes.push_back(HashComputePipelineDesc(changed, rootSignatureHash));
+
+	cs[63] ^= 1;
+	hashes.push_back(HashComputePipelineDesc(desc, rootSignatureHash));
+	cs[63] ^= 1;
+
+	std::sort(hashes.begin(), hashes.end());
+	if (std::adjacent_find(hashes.begin(), hashes.end()) != hashes.end())
+		return false;
+
+	// not part of the key
+	changed = desc;
+	changed.pRootSignature = reinterpret_cast<ID3D12RootSignature*>(cs);
+	changed.CachedPSO = { cs, sizeof(cs) };
+	return HashComputePipelineDesc(changed, rootSignatureHash) == hash;
+}
+
+// a mesh shader pipeline like the renderer's and the shaders it points to
+struct PipelineCheckMeshDesc {
+	uint8_t as[64];
+	uint8_t ms[64];
+	uint8_t ps[64];
+	D3DX12_MESH_SHADER_PIPELINE_STATE_DESC desc;
+};
+
+static void InitPipelineCheckMeshDesc(PipelineCheckMeshDesc& check) {
+	// the fixed function state of the graphics check
+	PipelineCheckDesc graphics;
+	InitPipelineCheckDesc(graphics, 0x00);
+
+	FillPipelineCheckShader(check.as, sizeof(check.as), 7);
+	FillPipelineCheckShader(check.ms, sizeof(check.ms), 8);
+	FillPipelineCheckShader(check.ps, sizeof(check.ps), 2);
+
+	D3DX12_MESH_SHADER_PIPELINE_STATE_DESC& desc = check.desc;
+	desc.pRootSignature = nullptr;
+	desc.AS = { check.as, sizeof(check.as) };
+	desc.MS = { check.ms, sizeof(check.ms) };
+	desc.PS = { check.ps, sizeof(check.ps) };
+	desc.BlendState = graphics.desc.BlendState;
+	desc.SampleMask = graphics.desc.SampleMask;
+	desc.RasterizerState = graphics.desc.RasterizerState;
+	desc.DepthStencilState = graphics.desc.DepthStencilState;
+	desc.PrimitiveTopologyType = graphics.desc.PrimitiveTopologyType;
+	desc.NumRenderTargets = graphics.desc.NumRenderTargets;
+	memcpy(desc.RTVFormats, graphics.desc.RTVFormats, sizeof(desc.RTVFormats));
+	desc.DSVFormat = graphics.desc.DSVFormat;
+	desc.SampleDesc = graphics.desc.SampleDesc;
+	desc.NodeMask = 0;
+	desc.CachedPSO = { nullptr, 0 };
+	desc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
+}
+
+// the stream is built over garbage, its subobjects are padded to pointer size
+static uint64_t HashPipelineCheckMeshStream(const D3DX12_MESH_SHADER_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash, uint8_t garbage) {
+	std::vector<uint8_t> storage(sizeof(CD3DX12_PIPELINE_MESH_STATE_STREAM), garbage);
+	CD3DX12_PIPELINE_MESH_STATE_STREAM* stream = new (&storage[0]) CD3DX12_PIPELINE_MESH_STATE_STREAM(desc);
+
+	D3D12_PIPELINE_STATE_STREAM_DESC streamDesc = { sizeof(*stream), stream };
+	return HashPipelineStateStream(streamDesc, rootSignatureHash);
+}
+
+static bool ChangePipelineCheckMeshDesc(PipelineCheckMeshDesc& check, int change) {
+	D3DX12_MESH_SHADER_PIPELINE_STATE_DESC& desc = check.desc;
+
+	switch (change) {
+	case 0: check.as[0] ^= 1; break;
+	case 1: desc.AS = { nullptr, 0 }; break;
+	case 2: check.ms[63] ^= 1; break;
+	case 3: desc.MS.BytecodeLength--; break;
+	case 4: check.ps[10] ^= 1; break;
+	case 5: desc.BlendState.RenderTarget[0].SrcBlend = D3D12_BLEND_SRC_ALPHA; break;
+	case 6: desc.SampleMask = 1; break;
+	case 7: desc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE; break;
+	case 8: desc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_GREATER; break;
+	case 9: desc.NumRenderTargets = 1; break;
+	case 10: desc.RTVFormats[1] = DXGI_FORMAT_R11G11B10_FLOAT; break;
+	case 11: desc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT; break;
+	case 12: desc.SampleDesc.Count = 4; break;
+	case 13: desc.NodeMask = 1; break;
+	case 14: desc.Flags = D3D12_PIPELINE_STATE_FLAG_TOOL_DEBUG; break;
+	default: return false;
+	}
+	return true;
+}
+
+static bool CheckStreamPipelineHashes() {
+	uint64_t rootSignatureHash = GetPipelineCheckRootSignatureHash("mesh");
+
+	std::vector<PipelineCheckMeshDesc> checks(1);
+	InitPipelineCheckMeshDesc(checks[0]);
+	uint64_t hash = HashPipelineCheckMeshStream(checks[0].desc, rootSignatureHash, 0x00);
+	if (hash == 0 || hash != HashPipelineCheckMeshStream(checks[0].desc, rootSignatureHash, 0xff))
+		return false;
+
+	std::vector<uint64_t> hashes(1, hash);
+	hashes.push_back(HashPipelineCheckMeshStream(checks[0].desc, GetPipelineCheckRootSignatureHash("other"), 0x00));
+	for (int change = 0;; ++change) {
+		InitPipelineCheckMeshDesc(checks[0]);
+		if (!ChangePipelineCheckMeshDesc(checks[0], change))
+			break;
+		hashes.push_back(HashPipelineCheckMeshStream(checks[0].desc, rootSignatureHash, 0x00));
+	}
+
+	std::sort(hashes.begin(), hashes.end());
+	if (std::adjacent_find(hashes.begin(), hashes.end()) != hashes.end())
+		return false;
+
+	// not part of the key
+	InitPipelineCheckMeshDesc(checks[0]);
+	checks[0].desc.pRootSignature = reinterpret_cast<ID3D12RootSignature*>(&checks[0]);
+	checks[0].desc.CachedPSO = { checks[0].ms, sizeof(checks[0].ms) };
+	checks[0].desc.RTVFormats[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT - 1] = DXGI_FORMAT_R8G8B8A8_UNORM;
+	if (HashPipelineCheckMeshStream(checks[0].desc, rootSignatureHash, 0x00) != hash)
+		return false;
+
+	// streams the runtime would refuse come back as 0, so the cache leaves them alone
+	D3D12_PIPELINE_STATE_STREAM_DESC emptyDesc = { 0, nullptr };
+	if (HashPipelineStateStream(emptyDesc, rootSignatureHash) != 0)
+		return false;
+
+	struct {
+		CD3DX12_PIPELINE_STATE_STREAM_NODE_MASK first;
+		CD3DX12_PIPELINE_STATE_STREAM_NODE_MASK second;
+	} duplicateStream;
+	duplicateStream.first = 0u;
+	duplicateStream.second = 1u;
+	D3D12_PIPELINE_STATE_STREAM_DESC duplicateDesc = { sizeof(duplicateStream), &duplicateStream };
+	if (HashPipelineStateStream(duplicateDesc, rootSignatureHash) != 0)
+		return false;
+
+	struct {
+		D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type;
+		UINT value;
+	} unknownStream = { D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_MAX_VALID, 0 };
+	D3D12_PIPELINE_STATE_STREAM_DESC unknownDesc = { sizeof(unknownStream), &unknownStream };
+	return HashPipelineStateStream(unknownDesc, rootSignatureHash) == 0;
+}
+
+static bool CheckPipelineCacheFile(uint32_t seed) {
+	uint32_t random = seed;
+
+	PipelineCacheHeader header;
+	header.vendorId = 0x10de;
+	header.deviceId = 0x2684;
+	header.subSysId = NextRandom(random);
+	header.revision = 0xa1;
+	header.driverVersion = ((uint64_t)NextRandom(random) << 32) | NextRandom(random);
+
+	std::vector<uint8_t> blob(1 + NextRandom(random) % 4096);
+	for (uint8_t& value : blob)
+		value = (uint8_t)NextRandom(random);
+
+	std::vector<uint8_t> file;
+	WritePipelineCacheFile(header, &blob[0], blob.size(), file);
+
+	const uint8_t* readBlob = nullptr;
+	size_t readBlobSize = 0;
+	if (!ReadPipelineCacheFile(&file[0], file.size(), header, readBlob, readBlobSize))
+		return false;
+	if (readBlobSize != blob.size() || readBlob != &file[file.size() - blob.size()] || memcmp(readBlob, &blob[0], blob.size()) != 0)
+		return false;
+
+	// a new library has nothing to store yet
+	std::vector<uint8_t> emptyFile;
+	WritePipelineCacheFile(header, nullptr, 0, emptyFile);
+	if (!ReadPipelineCacheFile(&emptyFile[0], emptyFile.size(), header, readBlob, readBlobSize) || readBlobSize != 0)
+		return false;
+
+	// another adapter or driver
+	for (int field = 0; field < 5; ++field) {
+		PipelineCacheHeader other = header;
+		switch (field) {
+		case 0: other.vendorId = 0x1002; break;
+		case 1: other.deviceId++; break;
+		case 2: other.subSysId++; break;
+		case 3: other.revision++; break;
+		case 4: other.driverVersion++; break;
+		}
+		if (ReadPipelineCacheFile(&file[0], file.size(), other, readBlob, readBlobSize))
+			return false;
+	}
+
+	// cut off anywhere, down to nothing at all, or with something after the blob
+	for (size_t size = 0; size < file.size(); ++size) {
+		if (ReadPipelineCacheFile(&file[0], size, header, readBlob, readBlobSize))
+			return false;
+	}
+
+	std::vector<uint8_t> longerFile(file);
+	longerFile.push_back(0);
+	if (ReadPipelineCacheFile(&longerFile[0], longerFile.size(), header, readBlob, readBlobSize))
+		return false;
+
+	// a flipped bit anywhere, in the magic, version, ids, sizes, the stored blob hash or the blob itself.
+	// fnv-1a changes with any one changed byte, so none of them gets through
+	std::vector<uint8_t> damagedFile(file);
+	for (size_t i = 0; i < damagedFile.size(); ++i) {
+		uint8_t bit = (uint8_t)(1 << (NextRandom(random) % 8));
+		damagedFile[i] ^= bit;
+		if (ReadPipelineCacheFile(&damagedFile[0], damagedFile.size(), header, readBlob, readBlobSize))
+			return false;
+		damagedFile[i] ^= bit;
+	}
+
+	return true;
+}
+
+// volatile so the hashing is not removed
+static volatile uint64_t pipelineBenchSink;
+
+static void BenchPipelineHashes(uint32_t seed) {
+	PipelineCheckDesc check;
+	InitPipelineCheckDesc(check, 0x00);
+	uint64_t rootSignatureHash = GetPipelineCheckRootSignatureHash("graphics");
+
+	// shaders of the size the renderer's are, a few kb each
+	std::vector<uint8_t> vs(4096);
+	std::vector<uint8_t> ps(8192);
+	FillPipelineCheckShader(&vs[0], vs.size(), 1);
+	FillPipelineCheckShader(&ps[0], ps.size(), 2);
+	check.desc.VS = { &vs[0], vs.size() };
+	check.desc.PS = { &ps[0], ps.size() };
+	check.desc.DS = { nullptr, 0 };
+	check.desc.HS = { nullptr, 0 };
+	check.desc.GS = { nullptr, 0 };
+	check.desc.StreamOutput = { nullptr, 0, nullptr, 0, 0 };
+
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < pipelineBenchHashCount; ++i) {
+		check.desc.SampleMask = (UINT)i;
+		pipelineBenchSink ^= HashGraphicsPipelineDesc(check.desc, rootSignatureHash);
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("graphics pipeline with %.0f kb of shaders: %.2f us a hash, %.0f mb/s\n", (vs.size() + ps.size()) / 1024.0,
+		seconds * 1000000.0 / pipelineBenchHashCount, (vs.size() + ps.size()) * (double)pipelineBenchHashCount / seconds / (1024.0 * 1024.0));
+
+	PipelineCheckMeshDesc mesh;
+	InitPipelineCheckMeshDesc(mesh);
+	mesh.desc.MS = { &vs[0], vs.size() };
+	mesh.desc.PS = { &ps[0], ps.size() };
+	CD3DX12_PIPELINE_MESH_STATE_STREAM stream(mesh.desc);
+	D3D12_PIPELINE_STATE_STREAM_DESC streamDesc = { sizeof(stream), &stream };
+
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < pipelineBenchHashCount; ++i) {
+		stream.SampleMask = (UINT)i;
+		pipelineBenchSink ^= HashPipelineStateStream(streamDesc, rootSignatureHash);
+	}
+	seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("mesh pipeline stream: %.2f us a hash\n", seconds * 1000000.0 / pipelineBenchHashCount);
+
+	// what checking the cache file costs at startup
+	uint32_t random = seed;
+	std::vector<uint8_t> blob(pipelineBenchCacheSize);
+	for (uint8_t& value : blob)
+		value = (uint8_t)NextRandom(random);
+
+	PipelineCacheHeader header = {};
+	std::vector<uint8_t> file;
+	WritePipelineCacheFile(header, &blob[0], blob.size(), file);
+
+	start = std::chrono::steady_clock::now();
+	const uint8_t* readBlob = nullptr;
+	size_t readBlobSize = 0;
+	bool read = ReadPipelineCacheFile(&file[0], file.size(), header, readBlob, readBlobSize);
+	seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("reading a %.0f mb cache file: %.1f ms%s\n", blob.size() / (1024.0 * 1024.0), seconds * 1000.0, read ? "" : ", refused");
+}
+
+static int PipelineBench(uint32_t seed) {
+	if (!CheckHashBytes()) {
+		fprintf(stderr, "pipeline hash does not match fnv-1a\n");
+		return 1;
+	}
+	if (!CheckGraphicsPipelineHashes()) {
+		fprintf(stderr, "graphics pipeline hash checks failed\n");
+		return 1;
+	}
+	if (!CheckComputePipelineHashes()) {
+		fprintf(stderr, "compute pipeline hash checks failed\n");
+		return 1;
+	}
+	if (!CheckStreamPipelineHashes()) {
+		fprintf(stderr, "pipeline stream hash checks failed\n");
+		return 1;
+	}
+	if (!CheckPipelineCacheFile(seed)) {
+		fprintf(stderr, "pipeline cache file checks failed with seed %u\n", seed);
+		return 1;
+	}
+	printf("pipeline hash and cache file checks passed\n");
+
+	BenchPipelineHashes(seed);
+	return 0;
+}
+#endif
+
+// software rasterizer
+
+// a vertex of the rasterizer checks, clip space and what the pixel shaders make a color of
+struct RasterCheckVertex {
+	float position[4];
+	float varyings[3];
+};
+
+static void RasterCheckVertexShader(const uint8_t* vertex, uint32_t instance, const void* shaderData, const void* bindings, float position[4], float varyings[softwareMaxVaryings]) {
+	(void)instance;
+	(void)shaderData;
+	(void)bindings;
+
+	RasterCheckVertex checkVertex;
+	memcpy(&checkVertex, vertex, sizeof(checkVertex));
+	memcpy(position, checkVertex.position, sizeof(checkVertex.position));
+	memcpy(varyings, checkVertex.varyings, sizeof(checkVertex.varyings));
+}
+
+// the first varying is the same at every corner, so it comes out exactly
+static void RasterCheckIdShader(const SoftwarePixelQuad& quad, const void* shaderData, const void* bindings, uint32_t colors[4]) {
+	(void)shaderData;
+	(void)bindings;
+	for (int lane = 0; lane < 4; ++lane)
+		colors[lane] = (uint32_t)(quad.varyings[0][lane] + 0.5f);
+}
+
+static void RasterCheckColorShader(const SoftwarePixelQuad& quad, const void* shaderData, const void* bindings, uint32_t colors[4]) {
+	(void)shaderData;
+	(void)bindings;
+	for (int lane = 0; lane < 4; ++lane) {
+		float color[4] = { quad.varyings[0][lane], quad.varyings[1][lane], quad.varyings[2][lane], 1.0f };
+		colors[lane] = SoftwarePackColor(color);
+	}
+}
+
+static void InitRasterCheckPipeline(SoftwarePipeline& pipeline, SoftwarePixelShaderFn pixelShader, SoftwareCullMode cullMode, bool depth) {
+	pipeline.vertexShader = RasterCheckVertexShader;
+	pipeline.pixelShader = pixelShader;
+	pipeline.shaderData = nullptr;
+	pipeline.varyingCount = 3;
+	pipeline.cullMode = cullMode;
+	pipeline.depthTest = depth;
+	pipeline.depthWrite = depth;
+}
+
+// one instance of every vertex in order
+static void DrawRasterCheckVertices(SoftwareRasterizer& rasterizer, const SoftwarePipeline& pipeline, const std::vector<RasterCheckVertex>& vertices, const std::vector<uint32_t>& indices, const RenderViewport& viewport, const RenderRect& scissorRect) {
+	SoftwareDraw draw;
+	draw.pipeline = &pipeline;
+	draw.bindings = nullptr;
+	draw.vertices = reinterpret_cast<const uint8_t*>(vertices.data());
+	draw.vertexStride = sizeof(RasterCheckVertex);
+	draw.vertexCount = (uint32_t)vertices.size();
+	draw.indices = reinterpret_cast<const uint8_t*>(indices.data());
+	draw.indexSize = 4;
+	draw.indexCount = (uint32_t)indices.size();
+	draw.baseVertex = 0;
+	draw.instanceCount = 1;
+	draw.startInstance = 0;
+	draw.viewport = viewport;
+	draw.scissorRect = scissorRect;
+	SoftwareRasterizerDraw(rasterizer, draw);
+	SoftwareRasterizerFlush(rasterizer);
+}
+
+static bool IsTopLeftEdge(int64_t dx, int64_t dy) {
+	return dy < 0 || (dy == 0 && dx > 0);
+}
+
+// the pixel centers a triangle of 1/16 pixel coordinates covers, tested one by one with 64 bit edge functions
+static void CoverRasterCheckTriangle(const int32_t x[3], const int32_t y[3], uint32_t id, uint32_t width, uint32_t height, std::vector<uint32_t>& coverCounts, std::vector<uint32_t>& ids) {
+	int64_t area = (int64_t)(x[1] - x[0]) * (y[2] - y[0]) - (int64_t)(y[1] - y[0]) * (x[2] - x[0]);
+	if (area == 0)
+		return;
+
+	int order[3] = { 0, 1, 2 };
+	if (area < 0) {
+		order[1] = 2;
+		order[2] = 1;
+	}
+
+	for (uint32_t py = 0; py < height; ++py) {
+		for (uint32_t px = 0; px < width; ++px) {
+			int64_t centerX = px * rasterCheckSubpixels + rasterCheckSubpixels / 2;
+			int64_t centerY = py * rasterCheckSubpixels + rasterCheckSubpixels / 2;
+
+			bool inside = true;
+			for (int i = 0; i < 3 && inside; ++i) {
+				int a = order[i];
+				int b = order[(i + 1) % 3];
+				int64_t dx = x[b] - x[a];
+				int64_t dy = y[b] - y[a];
+				int64_t edge = dx * (centerY - y[a]) - dy * (centerX - x[a]);
+				inside = edge > 0 || (edge == 0 && IsTopLeftEdge(dx, dy));
+			}
+
+			if (inside) {
+				coverCounts[py * width + px]++;
+				ids[py * width + px] = id;
+			}
+		}
+	}
+}
+
+// a grid of quads with jittered corners on 1/16 pixels over the whole target, split into triangles of either
+// winding. every pixel center belongs to exactly one triangle, the one the top left rule picks
+static bool CheckRasterizerCoverage(uint32_t seed) {
+	uint32_t random = seed;
+	const uint32_t width = rasterCheckTargetWidth;
+	const uint32_t height = rasterCheckTargetHeight;
+	const int32_t spacing = rasterCheckGridSpacing * rasterCheckSubpixels;
+	const int32_t pointCount = (int32_t)(rasterCheckViewportSize + 2 * rasterCheckGridSpacing) / rasterCheckGridSpacing + 1;
+
+	// lines through pixel centers where nothing is jittered
+	std::vector<int32_t> pointX(pointCount * pointCount), pointY(pointCount * pointCount);
+	for (int32_t j = 0; j < pointCount; ++j) {
+		for (int32_t i = 0; i < pointCount; ++i) {
+			int32_t jitter = spacing / 4 - 1;
+			bool jittered = NextRandom(random) % 2 == 0;
+			pointX[j * pointCount + i] = (i - 1) * spacing + rasterCheckSubpixels / 2 + (jittered ? (int32_t)(NextRandom(random) % (2 * jitter + 1)) - jitter : 0);
+			pointY[j * pointCount + i] = (j - 1) * spacing + rasterCheckSubpixels / 2 + (jittered ? (int32_t)(NextRandom(random) % (2 * jitter + 1)) - jitter : 0);
+		}
+	}
+
+	std::vector<RasterCheckVertex> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<uint32_t> coverCounts(width * height, 0), ids(width * height, 0);
+	for (int32_t j = 0; j + 1 < pointCount; ++j) {
+		for (int32_t i = 0; i + 1 < pointCount; ++i) {
+			int32_t corners[4] = { j * pointCount + i, j * pointCount + i + 1, (j + 1) * pointCount + i + 1, (j + 1) * pointCount + i };
+			int32_t diagonal = NextRandom(random) % 2;
+			int32_t triangles[2][3] = {
+				{ corners[diagonal], corners[diagonal + 1], corners[(diagonal + 2) % 4] },
+				{ corners[(diagonal + 2) % 4], corners[(diagonal + 3) % 4], corners[diagonal] },
+			};
+
+			for (int t = 0; t < 2; ++t) {
+				if (NextRandom(random) % 2 == 0)
+					std::swap(triangles[t][1], triangles[t][2]);
+
+				uint32_t id = (uint32_t)(indices.size() / 3) + 1;
+				int32_t x[3], y[3];
+				for (int k = 0; k < 3; ++k) {
+					x[k] = pointX[triangles[t][k]];
+					y[k] = pointY[triangles[t][k]];
+
+					// exact in floats, the viewport maps them back to the same 1/16 pixel
+					RasterCheckVertex vertex;
+					float scale = 2.0f / (rasterCheckViewportSize * rasterCheckSubpixels);
+					vertex.position[0] = x[k] * scale - 1.0f;
+					vertex.position[1] = 1.0f - y[k] * scale;
+					vertex.position[2] = 0.5f;
+					vertex.position[3] = 1.0f;
+					vertex.varyings[0] = (float)id;
+					vertex.varyings[1] = 0.0f;
+					vertex.varyings[2] = 0.0f;
+					indices.push_back((uint32_t)vertices.size());
+					vertices.push_back(vertex);
+				}
+
+				CoverRasterCheckTriangle(x, y, id, width, height, coverCounts, ids);
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < width * height; ++i) {
+		if (coverCounts[i] != 1) {
+			fprintf(stderr, "pixel %u, %u of the coverage check has %u triangles in the reference\n", i % width, i / width, coverCounts[i]);
+			return false;
+		}
+	}
+
+	SoftwarePipeline pipeline;
+	InitRasterCheckPipeline(pipeline, RasterCheckIdShader, SOFTWARE_CULL_NONE, false);
+	RenderViewport viewport = { 0.0f, 0.0f, (float)rasterCheckViewportSize, (float)rasterCheckViewportSize, 0.0f, 1.0f };
+	RenderRect scissorRect = { 0, 0, (int32_t)width, (int32_t)height };
+
+	for (int threadCount : { 1, rasterCheckThreadCount }) {
+		SoftwareRasterizer rasterizer;
+		SoftwareRasterizerInit(rasterizer, threadCount);
+		SoftwareTexture image;
+		SoftwareTextureInit(image, width, height);
+		SoftwareRasterizerSetTargets(rasterizer, &image, nullptr);
+		DrawRasterCheckVertices(rasterizer, pipeline, vertices, indices, viewport, scissorRect);
+
+		for (uint32_t i = 0; i < width * height; ++i) {
+			if (image.pixels[i] != ids[i]) {
+				fprintf(stderr, "pixel %u, %u of the coverage check on %d threads is triangle %u instead of %u\n", i % width, i / width, threadCount, image.pixels[i], ids[i]);
+				return false;
+			}
+		}
+
+		// and none of them twice
+		if (rasterizer.stats.pixelCount != (uint64_t)width * height) {
+			fprintf(stderr, "the coverage check on %d threads shaded %llu pixels for %u\n", threadCount, (unsigned long long)rasterizer.stats.pixelCount, width * height);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// random triangles in front of, across and behind the near plane and far outside of the view, drawn with depth on
+// one and on several threads. the thread count must not change a bit of the result
+static bool CheckRasterizerDeterminism(uint32_t seed) {
+	uint32_t random = seed;
+	std::vector<RasterCheckVertex> vertices(rasterCheckTriangleCount * 3);
+	std::vector<uint32_t> indices(vertices.size());
+	for (size_t i = 0; i < vertices.size(); ++i) {
+		RasterCheckVertex& vertex = vertices[i];
+		float w = RandomRange(random, -0.5f, 4.0f);
+		vertex.position[0] = RandomRange(random, -3.0f, 3.0f) * fabsf(w);
+		vertex.position[1] = RandomRange(random, -3.0f, 3.0f) * fabsf(w);
+		vertex.position[2] = RandomRange(random, -0.2f, 1.2f) * fabsf(w);
+		vertex.position[3] = w;
+		for (int j = 0; j < 3; ++j)
+			vertex.varyings[j] = RandomRange(random, 0.0f, 1.0f);
+		indices[i] = (uint32_t)i;
+	}
+
+	SoftwarePipeline pipeline;
+	InitRasterCheckPipeline(pipeline, RasterCheckColorShader, SOFTWARE_CULL_BACK, true);
+	RenderViewport viewport = { 0.0f, 0.0f, (float)renderWidth, (float)renderHeight, 0.0f, 1.0f };
+	RenderRect scissorRect = { 0, 0, (int32_t)renderWidth, (int32_t)renderHeight };
+
+	SoftwareTexture images[2];
+	SoftwareDepthBuffer depthBuffers[2];
+	SoftwareRasterizerStats stats[2];
+	int threadCounts[2] = { 1, rasterCheckThreadCount };
+	for (int i = 0; i < 2; ++i) {
+		SoftwareRasterizer rasterizer;
+		SoftwareRasterizerInit(rasterizer, threadCounts[i]);
+		SoftwareTextureInit(images[i], renderWidth, renderHeight);
+		SoftwareDepthBufferInit(depthBuffers[i], renderWidth, renderHeight);
+		SoftwareRasterizerSetTargets(rasterizer, &images[i], &depthBuffers[i]);
+		DrawRasterCheckVertices(rasterizer, pipeline, vertices, indices, viewport, scissorRect);
+		stats[i] = rasterizer.stats;
+	}
+
+	if (stats[0].clippedTriangleCount == 0 || stats[0].pixelCount == 0) {
+		fprintf(stderr, "the determinism check clipped %llu triangles and shaded %llu pixels\n", (unsigned long long)stats[0].clippedTriangleCount, (unsigned long long)stats[0].pixelCount);
+		return false;
+	}
+
+	if (images[0].pixels != images[1].pixels || memcmp(depthBuffers[0].depth.data(), depthBuffers[1].depth.data(), depthBuffers[0].depth.size() * sizeof(float)) != 0 ||
+		stats[0].setupTriangleCount != stats[1].setupTriangleCount || stats[0].pixelCount != stats[1].pixelCount) {
+		fprintf(stderr, "random triangles on %d threads differ from one thread\n", rasterCheckThreadCount);
+		return false;
+	}
+
+	return true;
+}
+
+// a mesh, a texture and objects in front of the renderer's camera, ready to be drawn like the renderer draws
+struct RasterScene {
+	QuantizedVertices vertices;
+	std::vector<uint8_t> indexData;
+	uint32_t indexCount;
+	uint32_t indexFormat;
+	float dequantization[8];
+
+	SoftwareTexture texture;
+	const SoftwareTexture* textures[1];
+	// the shaders get the layout of vertices, so the scene cannot move once it has a pipeline
+	SoftwarePipeline pipeline;
+
+	float clipFromWorld[16];
+	// clip from object of every object in view, rows are what the constant buffers hold
+	std::vector<float> objectMatrices;
+};
+
+// the renderer's camera, see InitD3D
+static void GetRenderClipFromWorld(float clipFromWorld[16]) {
+	const float eye[3] = { 0.0f, 2.0f, -4.0f };
+	const float target[3] = { 0.0f, 0.0f, 0.0f };
+	float cameraFromWorld[16];
+	GetCameraFromWorld(eye, target, cameraFromWorld);
+
+	float yScale = 1.0f / tanf(45.0f * (3.14f / 180.0f) * 0.5f);
+	GetProjection(false, 0.0f, yScale, 0.1f, 1000.0f, clipFromWorld);
+	clipFromWorld[0] = yScale / ((float)renderWidth / (float)renderHeight);
+	MultiplyMatrix(clipFromWorld, cameraFromWorld);
+}
+
+// cooks the mesh like the mesh command, with 16 bit indices if they fit
+static bool InitRasterScene(RasterScene& scene, std::vector<MeshVertex>& vertices, std::vector<uint32_t>& indices) {
+	MeshOptimizeTimings timings;
+	OptimizeMesh(vertices, indices, timings);
+
+	VertexSource source = GetMeshVertexSource(vertices);
+	if (!QuantizeVertices(source, ChooseVertexLayout(source, VERTEX_POSITION_FORMAT_SNORM16), scene.vertices))
+		return false;
+
+	bool shortIndices = vertices.size() <= 65536;
+	scene.indexCount = (uint32_t)indices.size();
+	scene.indexFormat = shortIndices ? softwareIndexFormat16 : softwareIndexFormat32;
+	scene.indexData.resize(indices.size() * (shortIndices ? 2 : 4));
+	for (size_t i = 0; i < indices.size(); ++i) {
+		if (shortIndices) {
+			uint16_t index = (uint16_t)indices[i];
+			memcpy(&scene.indexData[i * 2], &index, 2);
+		}
+		else {
+			memcpy(&scene.indexData[i * 4], &indices[i], 4);
+		}
+	}
+
+	memset(scene.dequantization, 0, sizeof(scene.dequantization));
+	for (int i = 0; i < 3; ++i) {
+		scene.dequantization[i] = scene.vertices.positionScale[i];
+		scene.dequantization[4 + i] = scene.vertices.positionOffset[i];
+	}
+
+	RgbaImage image;
+	GenerateBenchImage(image);
+	SoftwareTextureInit(scene.texture, image.width, image.height);
+	memcpy(scene.texture.pixels.data(), image.pixels.data(), image.pixels.size());
+	scene.textures[0] = &scene.texture;
+
+	SoftwareScenePipelineInit(scene.pipeline, &scene.vertices.layout);
+	GetRenderClipFromWorld(scene.clipFromWorld);
+	scene.objectMatrices.clear();
+	return true;
+}
+
+// an unrotated object, dropped if its box is outside of the view like CullScene drops it
+static void AddRasterSceneObject(RasterScene& scene, const CullingFrustum& frustum, const float position[3], float scale) {
+	float boundsMin[3], boundsMax[3];
+	for (int j = 0; j < 3; ++j) {
+		boundsMin[j] = position[j] + scene.vertices.boundsMin[j] * scale;
+		boundsMax[j] = position[j] + scene.vertices.boundsMax[j] * scale;
+	}
+	if (!CullingFrustumTestBox(frustum, boundsMin, boundsMax))
+		return;
+
+	const float worldFromObject[16] = {
+		scale, 0.0f, 0.0f, position[0],
+		0.0f, scale, 0.0f, position[1],
+		0.0f, 0.0f, scale, position[2],
+		0.0f, 0.0f, 0.0f, 1.0f,
+	};
+	float clipFromObject[16];
+	memcpy(clipFromObject, scene.clipFromWorld, sizeof(clipFromObject));
+	MultiplyMatrix(clipFromObject, worldFromObject);
+	scene.objectMatrices.insert(scene.objectMatrices.end(), clipFromObject, clipFromObject + 16);
+}
+
+// the scene the renderer starts with, before cube 1 turned: the two cubes and the grid of props below them
+static bool InitRendererRasterScene(RasterScene& scene) {
+	std::vector<MeshVertex> vertices;
+	std::vector<uint32_t> indices;
+	GenerateCubeMesh(vertices, indices);
+	if (!InitRasterScene(scene, vertices, indices))
+		return false;
+
+	CullingFrustum frustum;
+	CullingFrustumInit(frustum, scene.clipFromWorld);
+
+	const float cube1[3] = { 0.0f, 0.0f, 0.0f };
+	AddRasterSceneObject(scene, frustum, cube1, 1.0f);
+	// a child of cube 1 at (1, 0, 0) with half its size
+	const float cube2[3] = { 1.0f, 0.0f, 0.0f };
+	AddRasterSceneObject(scene, frustum, cube2, 0.5f);
+
+	for (int z = 0; z < renderPropGridWidth; ++z) {
+		for (int x = 0; x < renderPropGridWidth; ++x) {
+			const float prop[3] = { (x - renderPropGridWidth * 0.5f) * renderPropSpacing, -1.0f, z * renderPropSpacing };
+			AddRasterSceneObject(scene, frustum, prop, 0.2f);
+		}
+	}
+	return true;
+}
+
+// a few bench spheres in front of the camera, large and finely tessellated where the renderer's scene is small cubes
+static bool InitSphereRasterScene(RasterScene& scene, uint32_t seed) {
+	std::vector<MeshVertex> vertices;
+	std::vector<uint32_t> indices;
+	GenerateBenchMesh(seed, vertices, indices);
+	if (!InitRasterScene(scene, vertices, indices))
+		return false;
+
+	CullingFrustum frustum;
+	CullingFrustumInit(frustum, scene.clipFromWorld);
+
+	for (int z = 0; z < rasterBenchSphereRows; ++z) {
+		for (int x = 0; x < rasterBenchSphereRows; ++x) {
+			const float position[3] = { (x - (rasterBenchSphereRows - 1) * 0.5f) * 1.2f, 0.0f, z * 1.2f };
+			AddRasterSceneObject(scene, frustum, position, 0.5f);
+		}
+	}
+	return true;
+}
+
+struct RasterSceneResult {
+	double seconds;
+	SoftwareRenderStats deviceStats;
+	SoftwareRasterizerStats rasterizerStats;
+};
+
+// records the renderer's frame for the scene the way UpdatePipeline does, into a single list, and executes it
+// frameCount times. image is the renderer's back buffer, it and depthBuffer are what the render target and depth
+// stencil handles point at, so device has to draw like the software device in the end
+static bool DrawRasterScene(const RasterScene& scene, RenderDevice& device, int frameCount, SoftwareTexture& image, SoftwareDepthBuffer& depthBuffer, double& seconds) {
+	SoftwareTextureInit(image, renderWidth, renderHeight);
+	SoftwareDepthBufferInit(depthBuffer, renderWidth, renderHeight);
+
+	RenderQueue queue;
+	RenderFence fence;
+	RenderCommandList list;
+	if (!RenderDeviceCreateQueue(device, RENDER_COMMAND_LIST_DIRECT, queue) || !RenderDeviceCreateFence(device, 0, fence) ||
+		!RenderDeviceCreateCommandList(device, RENDER_COMMAND_LIST_DIRECT, 1, list))
+		return false;
+
+	// the mesh goes through an upload buffer into default heap buffers, constant buffers stay in the upload heap
+	uint64_t vertexBytes = scene.vertices.data.size();
+	uint64_t indexBytes = scene.indexData.size();
+	size_t objectCount = scene.objectMatrices.size() / 16;
+	RenderBuffer upload, vertexBuffer, indexBuffer, constantBuffers;
+	if (!RenderDeviceCreateBuffer(device, RENDER_HEAP_UPLOAD, vertexBytes + indexBytes, stateCommon, upload) ||
+		!RenderDeviceCreateBuffer(device, RENDER_HEAP_DEFAULT, vertexBytes, stateCommon, vertexBuffer) ||
+		!RenderDeviceCreateBuffer(device, RENDER_HEAP_DEFAULT, indexBytes, stateCommon, indexBuffer) ||
+		!RenderDeviceCreateBuffer(device, RENDER_HEAP_UPLOAD, std::max<uint64_t>(objectCount, 1) * renderConstantBufferSize, stateCommon, constantBuffers))
+		return false;
+
+	memcpy(upload.cpuAddress, scene.vertices.data.data(), (size_t)vertexBytes);
+	memcpy(upload.cpuAddress + vertexBytes, scene.indexData.data(), (size_t)indexBytes);
+	for (size_t i = 0; i < objectCount; ++i)
+		memcpy(constantBuffers.cpuAddress + i * renderConstantBufferSize, &scene.objectMatrices[i * 16], 16 * sizeof(float));
+
+	RenderCommandListReset(list, 0, const_cast<SoftwarePipeline*>(&scene.pipeline));
+	RenderCommandListCopyBufferRegion(list, vertexBuffer.resource, 0, upload.resource, 0, vertexBytes);
+	RenderCommandListCopyBufferRegion(list, indexBuffer.resource, 0, upload.resource, vertexBytes, indexBytes);
+
+	RenderDescriptor renderTarget = { (uint64_t)(uintptr_t)&image, 0 };
+	RenderDescriptor depthStencil = { (uint64_t)(uintptr_t)&depthBuffer, 0 };
+	RenderCommandListSetRenderTarget(list, renderTarget, depthStencil);
+	const float clearColor[] = { 0.0f, 0.2f, 0.4f, 1.0f };
+	RenderCommandListClearRenderTarget(list, renderTarget, clearColor);
+	RenderCommandListClearDepth(list, depthStencil, 1.0f);
+
+	// RecordDrawState, the software device has no root signature object, the shaders know the root parameters
+	RenderCommandListSetRootSignature(list, RENDER_BIND_GRAPHICS, nullptr);
+	RenderDescriptor textures = { 0, (uint64_t)(uintptr_t)scene.textures };
+	RenderCommandListSetRootDescriptorTable(list, RENDER_BIND_GRAPHICS, softwareSceneTextureTableParameter, textures);
+	uint32_t textureIndex = 0;
+	RenderCommandListSetRootConstants(list, RENDER_BIND_GRAPHICS, softwareSceneTextureIndexParameter, 1, &textureIndex, 0);
+	RenderCommandListSetRootConstants(list, RENDER_BIND_GRAPHICS, softwareSceneDequantizationParameter, 8, scene.dequantization, 0);
+
+	RenderViewport viewport = { 0.0f, 0.0f, (float)renderWidth, (float)renderHeight, 0.0f, 1.0f };
+	RenderRect scissorRect = { 0, 0, (int32_t)renderWidth, (int32_t)renderHeight };
+	RenderCommandListSetViewport(list, viewport);
+	RenderCommandListSetScissorRect(list, scissorRect);
+	RenderCommandListSetPrimitiveTopology(list, softwareTopologyTriangleList);
+	RenderVertexBufferView vertexBufferView = { vertexBuffer.gpuAddress, (uint32_t)vertexBytes, scene.vertices.stride };
+	RenderIndexBufferView indexBufferView = { indexBuffer.gpuAddress, (uint32_t)indexBytes, scene.indexFormat };
+	RenderCommandListSetVertexBuffer(list, vertexBufferView);
+	RenderCommandListSetIndexBuffer(list, indexBufferView);
+
+	// RecordDraws
+	for (size_t i = 0; i < objectCount; ++i) {
+		RenderCommandListSetRootConstantBuffer(list, RENDER_BIND_GRAPHICS, softwareSceneConstantBufferParameter, constantBuffers.gpuAddress + i * renderConstantBufferSize);
+		RenderCommandListDrawIndexedInstanced(list, scene.indexCount, 1, 0, 0, 0);
+	}
+
+	if (!RenderCommandListClose(list))
+		return false;
+
+	// a closed list can be executed again, every frame is the same
+	auto start = std::chrono::steady_clock::now();
+	bool succeeded = true;
+	for (int frame = 0; frame < frameCount && succeeded; ++frame) {
+		RenderQueueExecute(queue, &list, 1);
+		succeeded = RenderQueueSignal(queue, fence, frame + 1) && RenderFenceWait(fence, frame + 1);
+	}
+	seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	RenderDeviceDestroyBuffer(device, constantBuffers);
+	RenderDeviceDestroyBuffer(device, indexBuffer);
+	RenderDeviceDestroyBuffer(device, vertexBuffer);
+	RenderDeviceDestroyBuffer(device, upload);
+	RenderDeviceDestroyCommandList(list);
+	RenderDeviceDestroyFence(fence);
+	RenderDeviceDestroyQueue(queue);
+	return succeeded;
+}
+
+// the scene on a software device with threadCount threads
+static bool RenderRasterScene(const RasterScene& scene, int threadCount, int frameCount, SoftwareTexture& image, RasterSceneResult& result) {
+	SoftwareRenderDevice softwareDevice;
+	SoftwareRenderDeviceInit(softwareDevice, threadCount);
+
+	SoftwareDepthBuffer depthBuffer;
+	bool succeeded = DrawRasterScene(scene, softwareDevice.device, frameCount, image, depthBuffer, result.seconds);
+	result.deviceStats = softwareDevice.stats;
+	result.rasterizerStats = softwareDevice.rasterizer.stats;
+	return succeeded;
+}
+
+static bool IsRasterSceneResultClean(const RasterSceneResult& result) {
+	const SoftwareRenderStats& stats = result.deviceStats;
+	return stats.unsupportedCommandCount == 0 && stats.invalidDrawCount == 0 && stats.failedReplayCount == 0 && result.rasterizerStats.pixelCount > 0;
+}
+
+static int Render(const char* output, const char* reference) {
+	RasterScene scene;
+	if (!InitRendererRasterScene(scene)) {
+		fprintf(stderr, "could not cook the cube\n");
+		return 1;
+	}
+
+	SoftwareTexture image;
+	RasterSceneResult result;
+	int threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+	if (!RenderRasterScene(scene, threadCount, 1, image, result) || !IsRasterSceneResultClean(result)) {
+		fprintf(stderr, "could not render the scene\n");
+		return 1;
+	}
+
+	DdsImage dds;
+	DdsImageInit(dds, DDS_FORMAT_R8G8B8A8_UNORM, image.width, image.height, 1);
+	memcpy(dds.data.data(), image.pixels.data(), image.pixels.size() * 4);
+	std::vector<uint8_t> file;
+	WriteDds(dds, file);
+	if (!WriteFile(output, file)) {
+		fprintf(stderr, "could not write %s\n", output);
+		return 1;
+	}
+
+	const SoftwareRasterizerStats& stats = result.rasterizerStats;
+	printf("%s: %ux%u, %zu objects in view, %llu triangles, %llu set up, %llu pixels shaded, %.1f ms on %d threads\n", output, image.width, image.height,
+		scene.objectMatrices.size() / 16, (unsigned long long)stats.triangleCount, (unsigned long long)stats.setupTriangleCount,
+		(unsigned long long)stats.pixelCount, result.seconds * 1000.0, threadCount);
+
+	RgbaImage expected;
+	if (!LoadDdsImage(reference, expected) || expected.width != image.width || expected.height != image.height) {
+		fprintf(stderr, "could not load %s, or it is not %ux%u\n", reference, image.width, image.height);
+		return 1;
+	}
+
+	// another compiler can move an edge by a pixel or round a coordinate the other way, but not more
+	size_t differentCount = 0;
+	const uint8_t* actual = reinterpret_cast<const uint8_t*>(image.pixels.data());
+	for (size_t i = 0; i < image.pixels.size(); ++i) {
+		for (int c = 0; c < 4; ++c) {
+			if (abs((int)actual[i * 4 + c] - (int)expected.pixels[i * 4 + c]) > renderChannelTolerance) {
+				differentCount++;
+				break;
+			}
+		}
+	}
+
+	double differentFraction = (double)differentCount / image.pixels.size();
+	printf("%zu pixels differ from %s (%.3f%%)\n", differentCount, reference, differentFraction * 100.0);
+	if (differentFraction > renderMaxDifferentFraction) {
+		fprintf(stderr, "more than %.3f%% of the pixels differ\n", renderMaxDifferentFraction * 100.0);
+		return 1;
+	}
+	return 0;
+}
+
+static int RasterBench(uint32_t seed) {
+	if (!CheckRasterizerCoverage(seed)) {
+		fprintf(stderr, "rasterizer coverage check failed with seed %u\n", seed);
+		return 1;
+	}
+	printf("rasterizer coverage check passed, a %ux%u grid of triangles covers every pixel once with the top left rule\n", rasterCheckTargetWidth, rasterCheckTargetHeight);
+
+	if (!CheckRasterizerDeterminism(seed)) {
+		fprintf(stderr, "rasterizer determinism check failed with seed %u\n", seed);
+		return 1;
+	}
+	printf("rasterizer determinism check passed, %d random triangles give the same image and depth on 1 and %d threads\n", rasterCheckTriangleCount, rasterCheckThreadCount);
+
+	RasterScene scenes[2];
+	const char* sceneNames[2] = { "renderer scene", "spheres" };
+	if (!InitRendererRasterScene(scenes[0]) || !InitSphereRasterScene(scenes[1], seed)) {
+		fprintf(stderr, "could not cook the bench meshes\n");
+		return 1;
+	}
+
+	// the renderer's frame has to be the same whatever the thread count as well
+	SoftwareTexture images[2];
+	RasterSceneResult results[2];
+	if (!RenderRasterScene(scenes[0], 1, 1, images[0], results[0]) || !RenderRasterScene(scenes[0], rasterCheckThreadCount, 1, images[1], results[1]) ||
+		!IsRasterSceneResultClean(results[0]) || !IsRasterSceneResultClean(results[1]) || images[0].pixels != images[1].pixels) {
+		fprintf(stderr, "the renderer's scene differs on 1 and %d threads, or not every command ran\n", rasterCheckThreadCount);
+		return 1;
+	}
+	printf("renderer scene check passed, the same image on 1 and %d threads\n", rasterCheckThreadCount);
+
+	std::vector<int> threadCounts;
+	int hardwareThreads = std::max(1, (int)std::thread::hardware_concurrency());
+	for (int threadCount = 1; threadCount < hardwareThreads; threadCount *= 2)
+		threadCounts.push_back(threadCount);
+	threadCounts.push_back(hardwareThreads);
+
+	for (int s = 0; s < 2; ++s) {
+		const RasterScene& scene = scenes[s];
+		printf("%s: %zu objects of %u triangles\n", sceneNames[s], scene.objectMatrices.size() / 16, scene.indexCount / 3);
+
+		for (int threadCount : threadCounts) {
+			SoftwareTexture image;
+			RasterSceneResult result;
+			if (!RenderRasterScene(scene, threadCount, rasterBenchFrameCount, image, result)) {
+				fprintf(stderr, "could not render %s\n", sceneNames[s]);
+				return 1;
+			}
+
+			const SoftwareRasterizerStats& stats = result.rasterizerStats;
+			printf("  %2d thread%s: %7.2f ms per frame, %7.1f Mtri/s, %7.1f Mpix/s, %.1f%% of the triangles set up\n", threadCount, threadCount == 1 ? " " : "s",
+				result.seconds * 1000.0 / rasterBenchFrameCount, stats.triangleCount / result.seconds / 1e6, stats.pixelCount / result.seconds / 1e6,
+				stats.setupTriangleCount * 100.0 / std::max<uint64_t>(stats.triangleCount, 1));
+		}
+	}
+
+	return 0;
+}
+
+// frame capture
+
+// what a software replay draws with instead of the captured objects, only captures of the capture command's scene
+// have pipelines, targets and tables that mean something to it
+struct RasterReplayBindings {
+	const RasterScene* scene;
+	SoftwareTexture* image;
+	SoftwareDepthBuffer* depthBuffer;
+};
+
+static uint64_t MapRasterReplayObject(void* context, RenderCaptureObject object, uint64_t value) {
+	const RasterReplayBindings* bindings = static_cast<const RasterReplayBindings*>(context);
+	switch (object) {
+	case RENDER_CAPTURE_PIPELINE_STATE:
+		return (uint64_t)(uintptr_t)&bindings->scene->pipeline;
+	case RENDER_CAPTURE_RENDER_TARGET_VIEW:
+		return (uint64_t)(uintptr_t)bindings->image;
+	case RENDER_CAPTURE_DEPTH_STENCIL_VIEW:
+		return (uint64_t)(uintptr_t)bindings->depthBuffer;
+	case RENDER_CAPTURE_DESCRIPTOR_TABLE:
+		return (uint64_t)(uintptr_t)bindings->scene->textures;
+	default:
+		return value;
+	}
+}
+
+// executes a capture of the scene frameCount times on a software device with threadCount threads
+static bool ReplayRasterCapture(const RenderCapture& capture, const RasterScene& scene, int threadCount, int frameCount, SoftwareTexture& image, RasterSceneResult& result) {
+	SoftwareRenderDevice softwareDevice;
+	SoftwareRenderDeviceInit(softwareDevice, threadCount);
+	RenderDevice& device = softwareDevice.device;
+
+	SoftwareDepthBuffer depthBuffer;
+	SoftwareTextureInit(image, renderWidth, renderHeight);
+	SoftwareDepthBufferInit(depthBuffer, renderWidth, renderHeight);
+	RasterReplayBindings bindings = { &scene, &image, &depthBuffer };
+
+	RenderQueue queue;
+	RenderFence fence;
+	if (!RenderDeviceCreateQueue(device, RENDER_COMMAND_LIST_DIRECT, queue) || !RenderDeviceCreateFence(device, 0, fence))
+		return false;
+
+	RenderCaptureReplay replay;
+	bool succeeded = RenderCaptureReplayInit(replay, capture, device, queue, fence, MapRasterReplayObject, &bindings);
+
+	uint64_t value = RenderFenceGetCompletedValue(fence);
+	auto start = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < frameCount && succeeded; ++frame) {
+		RenderCaptureReplayExecute(replay, queue);
+		value++;
+		succeeded = RenderQueueSignal(queue, fence, value) && RenderFenceWait(fence, value);
+	}
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	result.deviceStats = softwareDevice.stats;
+	result.rasterizerStats = softwareDevice.rasterizer.stats;
+
+	RenderCaptureReplayDestroy(replay);
+	RenderDeviceDestroyFence(fence);
+	RenderDeviceDestroyQueue(queue);
+	return succeeded;
+}
+
+static uint64_t GetCaptureStreamBytes(const RenderCapture& capture) {
+	uint64_t bytes = 0;
+	for (const RenderCaptureList& list : capture.lists)
+		bytes += list.stream.size();
+	return bytes;
+}
+
+// draws the renderer's scene through a capture device in front of a software device and writes what it captured.
+// the file has to read back to the same bytes, and replaying it on another software device has to draw the same image
+static int Capture(const char* output) {
+	RasterScene scene;
+	if (!InitRendererRasterScene(scene)) {
+		fprintf(stderr, "could not cook the cube\n");
+		return 1;
+	}
+
+	int threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+	SoftwareRenderDevice softwareDevice;
+	SoftwareRenderDeviceInit(softwareDevice, threadCount);
+	RenderCaptureDevice captureDevice;
+	RenderCaptureDeviceInit(captureDevice, softwareDevice.device);
+
+	SoftwareTexture image;
+	SoftwareDepthBuffer depthBuffer;
+	double seconds = 0.0;
+	RenderCapture capture;
+	RenderCaptureBegin(captureDevice);
+	bool drawn = DrawRasterScene(scene, captureDevice.device, 1, image, depthBuffer, seconds);
+	RenderCaptureEnd(captureDevice, capture);
+
+	const SoftwareRenderStats& deviceStats = softwareDevice.stats;
+	if (!drawn || deviceStats.unsupportedCommandCount != 0 || deviceStats.invalidDrawCount != 0 || deviceStats.failedReplayCount != 0 || capture.lists.empty()) {
+		fprintf(stderr, "could not draw and capture the scene\n");
+		return 1;
+	}
+
+	std::vector<uint8_t> file;
+	RenderCaptureWrite(capture, file);
+	if (!WriteFile(output, file)) {
+		fprintf(stderr, "could not write %s\n", output);
+		return 1;
+	}
+
+	RenderCapture loaded;
+	std::vector<uint8_t> rewritten;
+	bool loadedCapture = RenderCaptureRead(file.data(), file.size(), loaded);
+	if (loadedCapture)
+		RenderCaptureWrite(loaded, rewritten);
+	if (!loadedCapture || rewritten != file) {
+		fprintf(stderr, "%s does not read back to the same capture\n", output);
+		return 1;
+	}
+
+	SoftwareTexture replayImage;
+	RasterSceneResult result;
+	if (!ReplayRasterCapture(loaded, scene, threadCount, 1, replayImage, result) || !IsRasterSceneResultClean(result) || replayImage.pixels != image.pixels) {
+		fprintf(stderr, "replaying %s does not draw the same image\n", output);
+		return 1;
+	}
+
+	uint64_t contentBytes = 0;
+	for (const RenderCaptureBuffer& buffer : capture.buffers)
+		contentBytes += buffer.contents.size();
+
+	printf("%s: %zu lists in %zu submits, %llu bytes of commands, %zu buffers with %llu bytes of contents, %zu bytes\n", output,
+		capture.lists.size(), capture.submitListCounts.size(), (unsigned long long)GetCaptureStreamBytes(capture), capture.buffers.size(),
+		(unsigned long long)contentBytes, file.size());
+	printf("replay draws the same image\n");
+	return 0;
+}
+
+// null decodes the captured lists and records them into null device lists again, as often as it can in count
+// rounds. software executes the recorded lists count times, which only draws something for captures of the
+// capture command
+static int Replay(const char* filename, int count, const char* mode) {
+	std::vector<uint8_t> file;
+	RenderCapture capture;
+	if (!ReadFile(filename, file) || !RenderCaptureRead(file.data(), file.size(), capture)) {
+		fprintf(stderr, "could not read %s, or it is not a capture of this version\n", filename);
+		return 1;
+	}
+
+	uint64_t streamBytes = GetCaptureStreamBytes(capture);
+	printf("%s: %zu lists, %llu bytes of commands, %zu buffers\n", filename, capture.lists.size(), (unsigned long long)streamBytes, capture.buffers.size());
+
+	if (strcmp(mode, "software") == 0) {
+		RasterScene scene;
+		if (!InitRendererRasterScene(scene)) {
+			fprintf(stderr, "could not cook the cube\n");
+			return 1;
+		}
+
+		int threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+		SoftwareTexture image;
+		RasterSceneResult result;
+		if (!ReplayRasterCapture(capture, scene, threadCount, count, image, result) || !IsRasterSceneResultClean(result)) {
+			fprintf(stderr, "could not replay %s on the software device\n", filename);
+			return 1;
+		}
+
+		const SoftwareRasterizerStats& stats = result.rasterizerStats;
+		printf("software, %d threads: %d frames, %.2f ms per frame, %.1f Mtri/s, %.1f Mpix/s\n", threadCount, count,
+			result.seconds * 1000.0 / count, stats.triangleCount / result.seconds / 1e6, stats.pixelCount / result.seconds / 1e6);
+		return 0;
+	}
+
+	if (strcmp(mode, "null") != 0) {
+		fprintf(stderr, "unknown replay target %s\n", mode);
+		return 1;
+	}
+
+	NullRenderDevice nullDevice;
+	NullRenderDeviceInit(nullDevice);
+	RenderDevice& device = nullDevice.device;
+
+	RenderQueue queue;
+	RenderFence fence;
+	RenderCaptureReplay replay;
+	if (!RenderDeviceCreateQueue(device, RENDER_COMMAND_LIST_DIRECT, queue) || !RenderDeviceCreateFence(device, 0, fence) ||
+		!RenderCaptureReplayInit(replay, capture, device, queue, fence, nullptr, nullptr)) {
+		fprintf(stderr, "could not replay %s on the null device\n", filename);
+		return 1;
+	}
+
+	// every command records into as many bytes as it was captured in, whatever its addresses turned into
+	uint64_t commandCount = 0;
+	for (size_t i = 0; i < replay.lists.size(); ++i) {
+		const NullRenderCommandList* nullList = NullRenderGetCommandList(replay.lists[i]);
+		if (nullList->streamSize != capture.lists[i].stream.size()) {
+			fprintf(stderr, "list %zu records into %zu bytes instead of %zu\n", i, nullList->streamSize, capture.lists[i].stream.size());
+			return 1;
+		}
+		for (uint32_t command = 0; command < NULL_RENDER_COMMAND_COUNT; ++command)
+			commandCount += nullList->commandCounts[command];
+	}
+
+	bool succeeded = true;
+	auto start = std::chrono::steady_clock::now();
+	for (int round = 0; round < count && succeeded; ++round) {
+		succeeded = RenderCaptureReplayRecord(replay);
+		RenderCaptureReplayExecute(replay, queue);
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	RenderCaptureReplayDestroy(replay);
+	RenderDeviceDestroyFence(fence);
+	RenderDeviceDestroyQueue(queue);
+	if (!succeeded) {
+		fprintf(stderr, "%s does not decode\n", filename);
+		return 1;
+	}
+
+	printf("null: %d rounds, %.3f ms per round, %.1f MB/s of commands and %.1f M commands/s decoded and recorded\n", count,
+		seconds * 1000.0 / count, streamBytes * (double)count / seconds / 1e6, commandCount * (double)count / seconds / 1e6);
+	return 0;
+}
+
+// image decoding
+
+struct ImageBenchInput {
+	std::string name;
+	// null for generated images
+	const char* filename;
+	std::vector<uint8_t> file;
+	// what the decoder has to give for generated pngs, worked out from how they were encoded
+	DecodedImageFormat expectedFormat;
+};
+
+static const char* GetDecodedImageFormatName(DecodedImageFormat format) {
+	switch (format) {
+	case DECODED_IMAGE_FORMAT_R16G16B16A16_UNORM: return "r16g16b16a16";
+	case DECODED_IMAGE_FORMAT_R8G8B8A8_UNORM: return "r8g8b8a8";
+	case DECODED_IMAGE_FORMAT_R16_UNORM: return "r16";
+	case DECODED_IMAGE_FORMAT_R8_UNORM: return "r8";
+	case DECODED_IMAGE_FORMAT_B8G8R8A8_UNORM: return "b8g8r8a8";
+	default: return "unknown";
+	}
+}
+
+#ifdef ENABLE_REFERENCE_DECODERS
+struct LibjpegError {
+	jpeg_error_mgr manager;
+	jmp_buf jump;
+};
+
+static void ExitLibjpeg(j_common_ptr info) {
+	longjmp(reinterpret_cast<LibjpegError*>(info->err)->jump, 1);
+}
+
+static void IgnoreLibjpegMessage(j_common_ptr) {
+}
+
+static bool DecodeImageWithLibjpeg(const std::vector<uint8_t>& file, DecodedImage& image) {
+	jpeg_decompress_struct info;
+	LibjpegError error;
+	info.err = jpeg_std_error(&error.manager);
+	error.manager.error_exit = ExitLibjpeg;
+	error.manager.output_message = IgnoreLibjpegMessage;
+	if (setjmp(error.jump)) {
+		jpeg_destroy_decompress(&info);
+		return false;
+	}
+
+	jpeg_create_decompress(&info);
+	jpeg_mem_src(&info, &file[0], (unsigned long)file.size());
+	jpeg_read_header(&info, TRUE);
+
+	bool gray = info.num_components == 1;
+	int outputComponents = gray ? 1 : 4;
+#ifdef JCS_EXTENSIONS
+	info.out_color_space = gray ? JCS_GRAYSCALE : JCS_EXT_RGBA;
+#else
+	info.out_color_space = gray ? JCS_GRAYSCALE : JCS_RGB;
+#endif
+	jpeg_start_decompress(&info);
+
+	image.format = gray ? DECODED_IMAGE_FORMAT_R8_UNORM : DECODED_IMAGE_FORMAT_R8G8B8A8_UNORM;
+	image.width = info.output_width;
+	image.height = info.output_height;
+	image.pixels.resize((size_t)image.width * image.height * outputComponents);
+
+	size_t rowPitch = (size_t)image.width * outputComponents;
+	while (info.output_scanline < info.output_height) {
+		JSAMPROW row = &image.pixels[info.output_scanline * rowPitch];
+		jpeg_read_scanlines(&info, &row, 1);
+	}
+
+#ifndef JCS_EXTENSIONS
+	// rgb to rgba in place, from the back
+	for (size_t i = (size_t)image.width * image.height; i-- > 0;) {
+		uint8_t* pixel = &image.pixels[i * 4];
+		const uint8_t* rgb = &image.pixels[i * 3];
+		pixel[2] = rgb[2];
+		pixel[1] = rgb[1];
+		pixel[0] = rgb[0];
+		pixel[3] = 255;
+	}
+#endif
+
+	jpeg_finish_decompress(&info);
+	jpeg_destroy_decompress(&info);
+	return true;
+}
+
+struct LibpngReader {
+	const uint8_t* data;
+	size_t size;
+	size_t position;
+};
+
+static void ReadLibpngData(png_structp png, png_bytep out, png_size_t size) {
+	LibpngReader* reader = static_cast<LibpngReader*>(png_get_io_ptr(png));
+	if (size > reader->size - reader->position)
+		png_error(png, "truncated");
+	memcpy(out, reader->data + reader->position, size);
+	reader->position += size;
+}
+
+// the format the decoder documents for the file, from its header alone
+static DecodedImageFormat GetExpectedPngFormat(int colorType, int bitDepth, bool hasColorKey) {
+	bool wide = bitDepth == 16;
+	switch (colorType) {
+	case PNG_COLOR_TYPE_GRAY:
+		if (hasColorKey)
+			return wide ? DECODED_IMAGE_FORMAT_R16G16B16A16_UNORM : DECODED_IMAGE_FORMAT_B8G8R8A8_UNORM;
+		return wide ? DECODED_IMAGE_FORMAT_R16_UNORM : DECODED_IMAGE_FORMAT_R8_UNORM;
+	case PNG_COLOR_TYPE_RGB:
+		if (wide)
+			return DECODED_IMAGE_FORMAT_R16G16B16A16_UNORM;
+		return hasColorKey ? DECODED_IMAGE_FORMAT_B8G8R8A8_UNORM : DECODED_IMAGE_FORMAT_R8G8B8A8_UNORM;
+	case PNG_COLOR_TYPE_PALETTE:
+		return DECODED_IMAGE_FORMAT_R8G8B8A8_UNORM;
+	default:
+		return wide ? DECODED_IMAGE_FORMAT_R16G16B16A16_UNORM : DECODED_IMAGE_FORMAT_B8G8R8A8_UNORM;
+	}
+}
+
+// libpng's transforms turn the file into the same layout
+static bool DecodeImageWithLibpng(const std::vector<uint8_t>& file, DecodedImage& image) {
+	png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	png_infop info = png_create_info_struct(png);
+	std::vector<png_bytep> rows;
+	if (setjmp(png_jmpbuf(png))) {
+		png_destroy_read_struct(&png, &info, NULL);
+		return false;
+	}
+
+	LibpngReader reader = { &file[0], file.size(), 0 };
+	png_set_read_fn(png, &reader, ReadLibpngData);
+	png_read_info(png, info);
+
+	int colorType = png_get_color_type(png, info);
+	int bitDepth = png_get_bit_depth(png, info);
+	bool hasTransparency = png_get_valid(png, info, PNG_INFO_tRNS) != 0;
+	image.format = GetExpectedPngFormat(colorType, bitDepth, hasTransparency && colorType != PNG_COLOR_TYPE_PALETTE);
+	image.width = png_get_image_width(png, info);
+	image.height = png_get_image_height(png, info);
+
+	if (colorType == PNG_COLOR_TYPE_PALETTE)
+		png_set_palette_to_rgb(png);
+	if (colorType == PNG_COLOR_TYPE_GRAY && bitDepth < 8)
+		png_set_expand_gray_1_2_4_to_8(png);
+	if (hasTransparency)
+		png_set_tRNS_to_alpha(png);
+
+	bool singleChannel = image.format == DECODED_IMAGE_FORMAT_R8_UNORM || image.format == DECODED_IMAGE_FORMAT_R16_UNORM;
+	if (!singleChannel) {
+		if (colorType == PNG_COLOR_TYPE_GRAY || colorType == PNG_COLOR_TYPE_GRAY_ALPHA)
+			png_set_gray_to_rgb(png);
+		if (!hasTransparency && (colorType == PNG_COLOR_TYPE_GRAY || colorType == PNG_COLOR_TYPE_RGB || colorType == PNG_COLOR_TYPE_PALETTE))
+			png_set_filler(png, bitDepth == 16 ? 0xffff : 0xff, PNG_FILLER_AFTER);
+	}
+	if (image.format == DECODED_IMAGE_FORMAT_B8G8R8A8_UNORM)
+		png_set_bgr(png);
+	if (bitDepth == 16)
+		png_set_swap(png);
+	png_set_interlace_handling(png);
+	png_read_update_info(png, info);
+
+	size_t rowPitch = (size_t)image.width * GetDecodedImageBytesPerPixel(image.format);
+	if (png_get_rowbytes(png, info) != rowPitch)
+		png_error(png, "unexpected layout");
+
+	image.pixels.resize(rowPitch * image.height);
+	rows.resize(image.height);
+	for (uint32_t y = 0; y < image.height; ++y)
+		rows[y] = &image.pixels[y * rowPitch];
+	png_read_image(png, &rows[0]);
+	png_read_end(png, NULL);
+
+	png_destroy_read_struct(&png, &info, NULL);
+	return true;
+}
+
+// bench jpeg encodings, sampling of the first component against the other two
+struct JpegBenchVariant {
+	const char* name;
+	int hSampling;
+	int vSampling;
+	bool gray;
+	// rgb without a color transform, which gets an adobe marker
+	bool rgb;
+	bool progressive;
+	// in mcus
+	unsigned int restartInterval;
+	// cropped from the generated image
+	uint32_t width;
+	uint32_t height;
+};
+
+static bool EncodeJpegWithLibjpeg(const RgbaImage& image, const JpegBenchVariant& variant, std::vector<uint8_t>& file) {
+	jpeg_compress_struct info;
+	LibjpegError error;
+	unsigned char* buffer = NULL;
+	unsigned long bufferSize = 0;
+	std::vector<uint8_t> row;
+	info.err = jpeg_std_error(&error.manager);
+	error.manager.error_exit = ExitLibjpeg;
+	if (setjmp(error.jump)) {
+		jpeg_destroy_compress(&info);
+		free(buffer);
+		return false;
+	}
+
+	jpeg_create_compress(&info);
+	jpeg_mem_dest(&info, &buffer, &bufferSize);
+	info.image_width = variant.width;
+	info.image_height = variant.height;
+	info.input_components = variant.gray ? 1 : 3;
+	info.in_color_space = variant.gray ? JCS_GRAYSCALE : JCS_RGB;
+	jpeg_set_defaults(&info);
+	jpeg_set_quality(&info, imageBenchJpegQuality, TRUE);
+
+	if (variant.rgb)
+		jpeg_set_colorspace(&info, JCS_RGB);
+	if (!variant.gray) {
+		info.comp_info[0].h_samp_factor = variant.hSampling;
+		info.comp_info[0].v_samp_factor = variant.vSampling;
+	}
+	if (variant.progressive)
+		jpeg_simple_progression(&info);
+	info.restart_interval = variant.restartInterval;
+
+	jpeg_start_compress(&info, TRUE);
+	row.resize((size_t)variant.width * 3);
+	while (info.next_scanline < info.image_height) {
+		const uint8_t* pixels = &image.pixels[(size_t)info.next_scanline * image.width * 4];
+		for (uint32_t x = 0; x < variant.width; ++x) {
+			if (variant.gray) {
+				row[x] = pixels[x * 4 + 1];
+				continue;
+			}
+			memcpy(&row[x * 3], &pixels[x * 4], 3);
+		}
+
+		JSAMPROW rowPointer = &row[0];
+		jpeg_write_scanlines(&info, &rowPointer, 1);
+	}
+	jpeg_finish_compress(&info);
+	jpeg_destroy_compress(&info);
+
+	file.assign(buffer, buffer + bufferSize);
+	free(buffer);
+	return true;
+}
+
+struct PngBenchVariant {
+	const char* name;
+	int colorType;
+	int bitDepth;
+	bool interlaced;
+	// pixels of the generated image's transparent border get a tRNS color, palettes get tRNS alphas
+	bool transparency;
+	int compressionLevel;
+	int strategy;
+};
+
+static void WriteLibpngData(png_structp png, png_bytep data, png_size_t size) {
+	std::vector<uint8_t>* file = static_cast<std::vector<uint8_t>*>(png_get_io_ptr(png));
+	file->insert(file->end(), data, data + size);
+}
+
+static void FlushLibpngData(png_structp) {
+}
+
+// a palette index of 3 bits of red and green and 2 of blue, scaled down for lower bit depths
+static uint32_t GetPngBenchPaletteIndex(const uint8_t* pixel, int bitDepth) {
+	uint32_t index = (pixel[0] >> 5) << 5 | (pixel[1] >> 5) << 2 | pixel[2] >> 6;
+	return index >> (8 - bitDepth);
+}
+
+static bool EncodePngWithLibpng(const RgbaImage& image, const PngBenchVariant& variant, std::vector<uint8_t>& file) {
+	png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	png_infop info = png_create_info_struct(png);
+	std::vector<uint8_t> row;
+	if (setjmp(png_jmpbuf(png))) {
+		png_destroy_write_struct(&png, &info);
+		return false;
+	}
+
+	png_set_write_fn(png, &file, WriteLibpngData, FlushLibpngData);
+	png_set_compression_level(png, variant.compressionLevel);
+	png_set_compression_strategy(png, variant.strategy);
+	png_set_IHDR(png, info, image.width, image.height, variant.bitDepth, variant.colorType,
+		variant.interlaced ? PNG_INTERLACE_ADAM7 : PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+
+	bool wide = variant.bitDepth == 16;
+	int maxSample = (1 << variant.bitDepth) - 1;
+	// the key is a value no opaque pixel gets
+	png_color_16 colorKey = {};
+	colorKey.gray = (png_uint_16)(wide ? 0x1234 : maxSample > 1 ? 1 : 0);
+	colorKey.red = (png_uint_16)(wide ? 0x1234 : 1);
+	colorKey.green = (png_uint_16)(wide ? 0x5678 : 2);
+	colorKey.blue = (png_uint_16)(wide ? 0x9abc : 3);
+
+	if (variant.colorType == PNG_COLOR_TYPE_PALETTE) {
+		int paletteSize = 1 << variant.bitDepth;
+		png_color palette[256];
+		png_byte alphas[256];
+		for (int i = 0; i < paletteSize; ++i) {
+			uint32_t index = (uint32_t)i << (8 - variant.bitDepth);
+			palette[i].red = (png_byte)((index >> 5) * 255 / 7);
+			palette[i].green = (png_byte)(((index >> 2) & 7) * 255 / 7);
+			palette[i].blue = (png_byte)((index & 3) * 255 / 3);
+			alphas[i] = (png_byte)(255 - i * 3);
+		}
+		png_set_PLTE(png, info, palette, paletteSize);
+		if (variant.transparency)
+			png_set_tRNS(png, info, alphas, paletteSize / 2, NULL);
+	}
+	else if (variant.transparency) {
+		png_set_tRNS(png, info, NULL, 0, &colorKey);
+	}
+
+	png_write_info(png, info);
+	if (wide)
+		png_set_swap(png);
+
+	int channelCount = variant.colorType == PNG_COLOR_TYPE_GRAY || variant.colorType == PNG_COLOR_TYPE_PALETTE ? 1 :
+		variant.colorType == PNG_COLOR_TYPE_GRAY_ALPHA ? 2 : variant.colorType == PNG_COLOR_TYPE_RGB ? 3 : 4;
+	row.resize(((size_t)image.width * channelCount * variant.bitDepth + 7) / 8 + 8);
+
+	int passCount = variant.interlaced ? png_set_interlace_handling(png) : 1;
+	for (int pass = 0; pass < passCount; ++pass) {
+		for (uint32_t y = 0; y < image.height; ++y) {
+			memset(&row[0], 0, row.size());
+			for (uint32_t x = 0; x < image.width; ++x) {
+				const uint8_t* pixel = &image.pixels[((size_t)y * image.width + x) * 4];
+				bool keyed = variant.transparency && pixel[3] == 0;
+
+				// 16 bit samples get low bits that are not just a copy of the high ones
+				uint32_t samples[4];
+				int count = 0;
+				if (variant.colorType == PNG_COLOR_TYPE_PALETTE) {
+					samples[count++] = GetPngBenchPaletteIndex(pixel, variant.bitDepth);
+				}
+				else if (variant.colorType == PNG_COLOR_TYPE_GRAY || variant.colorType == PNG_COLOR_TYPE_GRAY_ALPHA) {
+					uint32_t gray = wide ? pixel[1] << 8 | pixel[0] : pixel[1] >> (8 - variant.bitDepth);
+					// opaque pixels stay off the key
+					if (variant.transparency && gray == colorKey.gray)
+						gray ^= 1;
+					samples[count++] = keyed ? colorKey.gray : gray;
+				}
+				else {
+					for (int c = 0; c < 3; ++c) {
+						uint32_t value = wide ? pixel[c] << 8 | pixel[(c + 1) % 3] : pixel[c];
+						samples[count++] = value;
+					}
+					if (keyed) {
+						samples[0] = colorKey.red;
+						samples[1] = colorKey.green;
+						samples[2] = colorKey.blue;
+					}
+					else if (variant.transparency && samples[0] == colorKey.red && samples[1] == colorKey.green && samples[2] == colorKey.blue) {
+						samples[0] ^= 1;
+					}
+				}
+				if (variant.colorType & PNG_COLOR_MASK_ALPHA)
+					samples[count++] = wide ? pixel[3] << 8 | pixel[0] : pixel[3];
+
+				for (int c = 0; c < count; ++c) {
+					size_t bit = ((size_t)x * channelCount + c) * variant.bitDepth;
+					if (wide) {
+						row[bit / 8] = (uint8_t)samples[c];
+						row[bit / 8 + 1] = (uint8_t)(samples[c] >> 8);
+					}
+					else {
+						row[bit / 8] |= (uint8_t)(samples[c] << (8 - variant.bitDepth - bit % 8));
+					}
+				}
+			}
+			png_write_row(png, &row[0]);
+		}
+	}
+
+	png_write_end(png, info);
+	png_destroy_write_struct(&png, &info);
+	return true;
+}
+
+// the bench image with noise on top, so the entropy coders have something to do
+static void GenerateImageBenchImage(RgbaImage& image) {
+	GenerateBenchImage(image);
+
+	uint32_t random = 12345;
+	for (size_t i = 0; i < image.pixels.size(); i += 4) {
+		for (int c = 0; c < 3; ++c) {
+			int value = image.pixels[i + c] + (int)(NextRandom(random) % 17) - 8;
+			image.pixels[i + c] = (uint8_t)std::min(std::max(value, 0), 255);
+		}
+	}
+}
+
+static bool GenerateImageBenchInputs(std::vector<ImageBenchInput>& inputs) {
+	RgbaImage image;
+	GenerateImageBenchImage(image);
+
+	// odd sizes leave partial mcus and blocks
+	const uint32_t oddWidth = benchImageSize - 3;
+	const uint32_t oddHeight = benchImageSize - 5;
+	const JpegBenchVariant jpegVariants[] = {
+		{ "jpeg 444", 1, 1, false, false, false, 0, benchImageSize, benchImageSize },
+		{ "jpeg 422", 2, 1, false, false, false, 0, benchImageSize, benchImageSize },
+		{ "jpeg 420", 2, 2, false, false, false, 0, benchImageSize, benchImageSize },
+		{ "jpeg 440", 1, 2, false, false, false, 0, benchImageSize, benchImageSize },
+		{ "jpeg 411", 4, 1, false, false, false, 0, benchImageSize, benchImageSize },
+		{ "jpeg 420 odd size", 2, 2, false, false, false, 0, oddWidth, oddHeight },
+		{ "jpeg 420 restarts", 2, 2, false, false, false, 7, oddWidth, oddHeight },
+		{ "jpeg 420 progressive", 2, 2, false, false, true, 0, benchImageSize, benchImageSize },
+		{ "jpeg 444 progressive restarts", 1, 1, false, false, true, 5, oddWidth, oddHeight },
+		{ "jpeg rgb", 1, 1, false, true, false, 0, benchImageSize, benchImageSize },
+		{ "jpeg gray", 1, 1, true, false, false, 0, oddWidth, oddHeight },
+		{ "jpeg gray progressive", 1, 1, true, false, true, 0, benchImageSize, benchImageSize },
+	};
+	const PngBenchVariant pngVariants[] = {
+		{ "png rgba8", PNG_COLOR_TYPE_RGBA, 8, false, false, Z_DEFAULT_COMPRESSION, Z_DEFAULT_STRATEGY },
+		{ "png rgb8", PNG_COLOR_TYPE_RGB, 8, false, false, Z_DEFAULT_COMPRESSION, Z_DEFAULT_STRATEGY },
+		{ "png rgb8 color key", PNG_COLOR_TYPE_RGB, 8, false, true, Z_DEFAULT_COMPRESSION, Z_DEFAULT_STRATEGY },
+		{ "png gray8", PNG_COLOR_TYPE_GRAY, 8, false, false, Z_DEFAULT_COMPRESSION, Z_DEFAULT_STRATEGY },
+		{ "png gray8 color key", PNG_COLOR_TYPE_GRAY, 8, false, true, Z_DEFAULT_COMPRESSION, Z_DEFAULT_STRATEGY },
+		{ "png gray4 color key", PNG_COLOR_TYPE_GRAY, 4, false, true, Z_DEFAULT_COMPRESSION, Z_DEFAULT_STRATEGY },
+		{ "png gray1", PNG_COLOR_TYPE_GRAY, 1, false, false, Z_DEFAULT_COMPRESSION, Z_DEFAULT_STRATEGY },
+		{ "png gray16", PNG_COLOR_TYPE_GRAY, 16, false, false, Z_DEFAULT_COMPRESSION, Z_DEFAULT_STRATEGY },
+		{ "png gray16 color key", PNG_COLOR_TYPE_GRAY, 16, false, true, Z_DEFAULT_COMPRESSION, Z_DEFAULT_STRATEGY },
+		{ "png gray alpha8", PNG_COLOR_TYPE_GRAY_ALPHA, 8, false, false, Z_DEFAULT_COMPRESSION, Z_DEFAULT_STRATEGY },
+		{ "png gray alpha16", PNG_COLOR_TYPE_GRAY_ALPHA, 16, false, false, Z_DEFAULT_COMPRESSION, Z_DEFAULT_STRATEGY },
+		{ "png rgb16", PNG_COLOR_TYPE_RGB, 16, false, false, Z_DEFAULT_COMPRESSION, Z_DEFAULT_STRATEGY },
+		{ "png rgba16", PNG_COLOR_TYPE_RGBA, 16, false, false, Z_DEFAULT_COMPRESSION, Z_DEFAULT_STRATEGY },
+		{ "png palette8 transparency", PNG_COLOR_TYPE_PALETTE, 8, false, true, Z_DEFAULT_COMPRESSION, Z_DEFAULT_STRATEGY },
+		{ "png palette2", PNG_COLOR_TYPE_PALETTE, 2, false, false, Z_DEFAULT_COMPRESSION, Z_DEFAULT_STRATEGY },
+		{ "png rgba8 interlaced", PNG_COLOR_TYPE_RGBA, 8, true, false, Z_DEFAULT_COMPRESSION, Z_DEFAULT_STRATEGY },
+		{ "png gray2 interlaced", PNG_COLOR_TYPE_GRAY, 2, true, false, Z_DEFAULT_COMPRESSION, Z_DEFAULT_STRATEGY },
+		{ "png rgb16 color key interlaced", PNG_COLOR_TYPE_RGB, 16, true, true, Z_DEFAULT_COMPRESSION, Z_DEFAULT_STRATEGY },
+		{ "png rgba8 stored", PNG_COLOR_TYPE_RGBA, 8, false, false, 0, Z_DEFAULT_STRATEGY },
+		{ "png rgb8 fixed huffman", PNG_COLOR_TYPE_RGB, 8, false, false, Z_DEFAULT_COMPRESSION, Z_FIXED },
+		{ "png rgba8 run length", PNG_COLOR_TYPE_RGBA, 8, false, false, Z_DEFAULT_COMPRESSION, Z_RLE },
+	};
+
+	for (const JpegBenchVariant& variant : jpegVariants) {
+		ImageBenchInput input;
+		input.name = variant.name;
+		input.filename = NULL;
+		input.expectedFormat = variant.gray ? DECODED_IMAGE_FORMAT_R8_UNORM : DECODED_IMAGE_FORMAT_R8G8B8A8_UNORM;
+		if (!EncodeJpegWithLibjpeg(image, variant, input.file))
+			return false;
+		inputs.push_back(input);
+	}
+
+	for (const PngBenchVariant& variant : pngVariants) {
+		ImageBenchInput input;
+		input.name = variant.name;
+		input.filename = NULL;
+		input.expectedFormat = GetExpectedPngFormat(variant.colorType, variant.bitDepth, variant.transparency && variant.colorType != PNG_COLOR_TYPE_PALETTE);
+		if (!EncodePngWithLibpng(image, variant, input.file))
+			return false;
+		inputs.push_back(input);
+	}
+
+	return true;
+}
+#endif
+
+#ifdef _WIN32
+static bool DecodeImageWithWIC(const char* filename, DecodedImage& image) {
+	wchar_t wideFilename[MAX_PATH];
+	if (MultiByteToWideChar(CP_UTF8, 0, filename, -1, wideFilename, MAX_PATH) == 0)
+		return false;
+
+	BYTE* imageData = NULL;
+	D3D12_RESOURCE_DESC desc;
+	int bytesPerRow;
+	int imageSize = LoadImageDataFromFileWithWIC(&imageData, desc, wideFilename, bytesPerRow);
+	if (imageSize <= 0)
+		return false;
+
+	// formats the decoder does not have never compare equal
+	image.format = (DecodedImageFormat)desc.Format;
+	image.width = (uint32_t)desc.Width;
+	image.height = desc.Height;
+	image.pixels.assign(imageData, imageData + imageSize);
+	free(imageData);
+	return true;
+}
+#endif
+
+// libjpeg and libpng when built with them, otherwise wic for files on windows. null when there is none
+static const char* GetImageBenchReferenceName(const ImageBenchInput& input) {
+#ifdef ENABLE_REFERENCE_DECODERS
+	(void)input;
+	return "libjpeg and libpng";
+#elif defined(_WIN32)
+	return input.filename != NULL ? "wic" : NULL;
+#else
+	(void)input;
+	return NULL;
+#endif
+}
+
+static bool DecodeReferenceImage(const ImageBenchInput& input, DecodedImage& image) {
+#ifdef ENABLE_REFERENCE_DECODERS
+	ImageFileType type = GetImageFileType(&input.file[0], input.file.size());
+	if (type == IMAGE_FILE_JPEG)
+		return DecodeImageWithLibjpeg(input.file, image);
+	if (type == IMAGE_FILE_PNG)
+		return DecodeImageWithLibpng(input.file, image);
+	return false;
+#elif defined(_WIN32)
+	return input.filename != NULL && DecodeImageWithWIC(input.filename, image);
+#else
+	(void)input;
+	(void)image;
+	return false;
+#endif
+}
+
+static void DecodeImageBenchThread(const std::vector<uint8_t>* file, const DecodedImage* expected, bool* matched) {
+	*matched = true;
+	for (int run = 0; run < imageBenchRunCount; ++run) {
+		DecodedImage image;
+		if (!DecodeImageFile(*file, IMAGE_DECODE_SIMD, image) || image.pixels != expected->pixels)
+			*matched = false;
+	}
+}
+
+// seconds of imageBenchRunCount decodes, negative if one failed
+static double TimeImageDecodes(const ImageBenchInput& input, int path, DecodedImage& image) {
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int run = 0; run < imageBenchRunCount; ++run) {
+		bool decoded = path < 0 ? DecodeReferenceImage(input, image) : DecodeImageFile(input.file, (ImageDecodePath)path, image);
+		if (!decoded)
+			return -1.0;
+	}
+	return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// largest and mean absolute difference of the channels
+static void CompareDecodedImages(const DecodedImage& a, const DecodedImage& b, int& maxDifference, double& meanDifference) {
+	maxDifference = 0;
+	uint64_t totalDifference = 0;
+	for (size_t i = 0; i < a.pixels.size(); ++i) {
+		int difference = abs((int)a.pixels[i] - (int)b.pixels[i]);
+		maxDifference = std::max(maxDifference, difference);
+		totalDifference += difference;
+	}
+	meanDifference = a.pixels.empty() ? 0.0 : (double)totalDifference / a.pixels.size();
+}
+
+static int ImageBench(int fileCount, char** filenames) {
+	std::vector<ImageBenchInput> inputs;
+	for (int i = 0; i < fileCount; ++i) {
+		ImageBenchInput input;
+		input.name = filenames[i];
+		input.filename = filenames[i];
+		input.expectedFormat = DECODED_IMAGE_FORMAT_UNKNOWN;
+		if (!ReadFile(filenames[i], input.file)) {
+			fprintf(stderr, "could not read %s\n", filenames[i]);
+			return 1;
+		}
+		inputs.push_back(input);
+	}
+
+	if (inputs.empty()) {
+#ifdef ENABLE_REFERENCE_DECODERS
+		if (!GenerateImageBenchInputs(inputs)) {
+			fprintf(stderr, "could not encode the bench images\n");
+			return 1;
+		}
+#else
+		fprintf(stderr, "imagebench needs files unless it is built with ENABLE_REFERENCE_DECODERS\n");
+		return 1;
+#endif
+	}
+
+	int hardwareThreads = std::max(1, (int)std::thread::hardware_concurrency());
+	const char* referenceName = GetImageBenchReferenceName(inputs[0]);
+	printf("%zu images, %d decodes per path, reference %s\n", inputs.size(), imageBenchRunCount, referenceName != NULL ? referenceName : "none");
+
+	bool failed = false;
+	for (const ImageBenchInput& input : inputs) {
+		DecodedImage simd;
+		DecodedImage scalar;
+		double simdSeconds = TimeImageDecodes(input, IMAGE_DECODE_SIMD, simd);
+		double scalarSeconds = TimeImageDecodes(input, IMAGE_DECODE_SCALAR, scalar);
+		if (simdSeconds < 0.0 || scalarSeconds < 0.0) {
+			fprintf(stderr, "%s: could not decode\n", input.name.c_str());
+			failed = true;
+			continue;
+		}
+
+		if (simd.pixels != scalar.pixels) {
+			fprintf(stderr, "%s: the sse2 and scalar paths give different pixels\n", input.name.c_str());
+			failed = true;
+		}
+		if (input.expectedFormat != DECODED_IMAGE_FORMAT_UNKNOWN && simd.format != input.expectedFormat) {
+			fprintf(stderr, "%s: decoded to %s instead of %s\n", input.name.c_str(), GetDecodedImageFormatName(simd.format), GetDecodedImageFormatName(input.expectedFormat));
+			failed = true;
+		}
+
+		// every thread decodes the same file at once and has to get the same pixels
+		std::vector<std::thread> threads;
+		std::deque<bool> matched(hardwareThreads);
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int t = 0; t < hardwareThreads; ++t)
+			threads.push_back(std::thread(DecodeImageBenchThread, &input.file, &simd, &matched[t]));
+		for (std::thread& thread : threads)
+			thread.join();
+		double threadSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		if (std::find(matched.begin(), matched.end(), false) != matched.end()) {
+			fprintf(stderr, "%s: concurrent decodes give different pixels\n", input.name.c_str());
+			failed = true;
+		}
+
+		double megabytes = simd.pixels.size() * (double)imageBenchRunCount / 1e6;
+		double megapixels = (double)simd.width * simd.height * imageBenchRunCount / 1e6;
+		printf("%s: %ux%u %s, %zu KB\n", input.name.c_str(), simd.width, simd.height, GetDecodedImageFormatName(simd.format), input.file.size() / 1024);
+		printf("  sse2   %8.1f MB/s %7.1f Mpix/s\n", megabytes / simdSeconds, megapixels / simdSeconds);
+		printf("  scalar %8.1f MB/s %7.1f Mpix/s\n", megabytes / scalarSeconds, megapixels / scalarSeconds);
+		printf("  %d thread%s at once %5.1f MB/s per core\n", hardwareThreads, hardwareThreads == 1 ? "" : "s", megabytes / threadSeconds);
+
+		if (GetImageBenchReferenceName(input) == NULL)
+			continue;
+
+		DecodedImage reference;
+		double referenceSeconds = TimeImageDecodes(input, -1, reference);
+		if (referenceSeconds < 0.0) {
+			printf("  the reference could not decode it\n");
+			continue;
+		}
+		printf("  reference %5.1f MB/s %7.1f Mpix/s, sse2 is %.2fx as fast\n", megabytes / referenceSeconds, megapixels / referenceSeconds, referenceSeconds / simdSeconds);
+
+		if (reference.format != simd.format || reference.width != simd.width || reference.height != simd.height) {
+			fprintf(stderr, "%s: the reference decodes to %ux%u %s\n", input.name.c_str(), reference.width, reference.height, GetDecodedImageFormatName(reference.format));
+			failed = true;
+			continue;
+		}
+
+		// png is lossless and has to match exactly, jpeg decoders only have to agree closely
+		int maxDifference;
+		double meanDifference;
+		CompareDecodedImages(reference, simd, maxDifference, meanDifference);
+		bool jpeg = GetImageFileType(&input.file[0], input.file.size()) == IMAGE_FILE_JPEG;
+		printf("  difference to the reference: max %d, mean %.4f\n", maxDifference, meanDifference);
+		if ((!jpeg && maxDifference != 0) || (jpeg && meanDifference > imageBenchMaxJpegMeanDifference)) {
+			fprintf(stderr, "%s: differs from the reference\n", input.name.c_str());
+			failed = true;
+		}
+	}
+
+	if (failed)
+		return 1;
+
+	printf("image decoder checks passed\n");
+	return 0;
+}
+
+static void PrintUsage() {
+	printf("usage:\n");
+	printf("  AssetTool texture <input image> <output.dds> [bc1|bc3|bc4|bc5|bc7]\n");
+	printf("  AssetTool bench [bc1|bc3|bc4|bc5|bc7] [input.dds]\n");
+	printf("  AssetTool mipbench [seed]\n");
+	printf("  AssetTool profilebench [trace.json]\n");
+	printf("  AssetTool uploadbench [seed]\n");
+	printf("  AssetTool frameallocbench [seed]\n");
+	printf("  AssetTool heapbench [seed]\n");
+	printf("  AssetTool descriptorbench [seed]\n");
+	printf("  AssetTool barrierbench [seed]\n");
+	printf("  AssetTool framegraphbench [seed]\n");
+	printf("  AssetTool mesh <input.obj|cube> <output.mesh> [float|snorm16|unorm16]\n");
+	printf("  AssetTool meshbench [seed]\n");
+	printf("  AssetTool quantizebench [seed]\n");
+	printf("  AssetTool meshletbench [seed]\n");
+	printf("  AssetTool transformbench [seed]\n");
+	printf("  AssetTool cullbench [seed]\n");
+	printf("  AssetTool indirectbench [seed]\n");
+	printf("  AssetTool devicebench [seed]\n");
+#if defined(_WIN32) || defined(ENABLE_DIRECTX_HEADERS)
+	printf("  AssetTool pipelinebench [seed]\n");
+#endif
+	printf("  AssetTool render <output.dds> [reference.dds]\n");
+	printf("  AssetTool rasterbench [seed]\n");
+	printf("  AssetTool capture <output.rcap>\n");
+	printf("  AssetTool replay <capture.rcap> [count] [null|software]\n");
+	printf("  AssetTool imagebench [files...]\n");
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 2) {
+		PrintUsage();
+		return 1;
+	}
+
+	if (strcmp(argv[1], "texture") == 0 && (argc == 4 || argc == 5)) {
+		// bc7 unless asked otherwise, it is the best quality for color textures
+		BlockFormat format = BLOCK_FORMAT_BC7;
+		if (argc == 5 && !ParseBlockFormat(argv[4], format)) {
+			PrintUsage();
+			return 1;
+		}
+		return CookTexture(argv[2], argv[3], format);
+	}
+
+	if (strcmp(argv[1], "bench") == 0) {
+		BlockFormat formats[] = { BLOCK_FORMAT_BC1, BLOCK_FORMAT_BC3, BLOCK_FORMAT_BC4, BLOCK_FORMAT_BC5, BLOCK_FORMAT_BC7 };
+		int formatCount = sizeof(formats) / sizeof(formats[0]);
+		const char* input = NULL;
+
+		for (int i = 2; i < argc; ++i) {
+			BlockFormat format;
+			if (ParseBlockFormat(argv[i], format)) {
+				formats[0] = format;
+				formatCount = 1;
+			}
+			else {
+				input = argv[i];
+			}
+		}
+
+		return Bench(formatCount, formats, input);
+	}
+
+	if (strcmp(argv[1], "mipbench") == 0 && argc <= 3)
+		return MipBench(argc == 3 ? (uint32_t)strtoul(argv[2], NULL, 10) : 12345);
+
+	if (strcmp(argv[1], "profilebench") == 0 && argc <= 3)
+		return ProfileBench(argc == 3 ? argv[2] : NULL);
+
+	if (strcmp(argv[1], "uploadbench") == 0 && argc <= 3)
+		return UploadBench(argc == 3 ? (uint32_t)strtoul(argv[2], NULL, 10) : 12345);
+
+	if (strcmp(argv[1], "frameallocbench") == 0 && argc <= 3)
+		return FrameAllocBench(argc == 3 ? (uint32_t)strtoul(argv[2], NULL, 10) : 12345);
+
+	if (strcmp(argv[1], "heapbench") == 0 && argc <= 3)
+		return HeapBench(argc == 3 ? (uint32_t)strtoul(argv[2], NULL, 10) : 12345);
+
+	if (strcmp(argv[1], "descriptorbench") == 0 && argc <= 3)
+		return DescriptorBench(argc == 3 ? (uint32_t)strtoul(argv[2], NULL, 10) : 12345);
+
+	if (strcmp(argv[1], "barrierbench") == 0 && argc <= 3)
+		return BarrierBench(argc == 3 ? (uint32_t)strtoul(argv[2], NULL, 10) : 12345);
+
+	if (strcmp(argv[1], "framegraphbench") == 0 && argc <= 3)
+		return FrameGraphBench(argc == 3 ? (uint32_t)strtoul(argv[2], NULL, 10) : 12345);
+
+	if (strcmp(argv[1], "mesh") == 0 && (argc == 4 || argc == 5)) {
+		VertexPositionFormat positionFormat = VERTEX_POSITION_FORMAT_SNORM16;
+		if (argc == 5 && !ParsePositionFormat(argv[4], positionFormat)) {
+			PrintUsage();
+			return 1;
+		}
+		return CookMesh(argv[2], argv[3], positionFormat);
+	}
+
+	if (strcmp(argv[1], "meshbench") == 0 && argc <= 3)
+		return MeshBench(argc == 3 ? (uint32_t)strtoul(argv[2], NULL, 10) : 12345);
+
+	if (strcmp(argv[1], "quantizebench") == 0 && argc <= 3)
+		return QuantizeBench(argc == 3 ? (uint32_t)strtoul(argv[2], NULL, 10) : 12345);
+
+	if (strcmp(argv[1], "meshletbench") == 0 && argc <= 3)
+		return MeshletBench(argc == 3 ? (uint32_t)strtoul(argv[2], NULL, 10) : 12345);
+
+	if (strcmp(argv[1], "transformbench") == 0 && argc <= 3)
+		return TransformBench(argc == 3 ? (uint32_t)strtoul(argv[2], NULL, 10) : 12345);
+
+	if (strcmp(argv[1], "cullbench") == 0 && argc <= 3)
+		return CullBench(argc == 3 ? (uint32_t)strtoul(argv[2], NULL, 10) : 12345);
+
+	if (strcmp(argv[1], "indirectbench") == 0 && argc <= 3)
+		return IndirectBench(argc == 3 ? (uint32_t)strtoul(argv[2], NULL, 10) : 12345);
+
+	if (strcmp(argv[1], "devicebench") == 0 && argc <= 3)
+		return DeviceBench(argc == 3 ? (uint32_t)strtoul(argv[2], NULL, 10) : 12345);
+#if defined(_WIN32) || defined(ENABLE_DIRECTX_HEADERS)
+	if (strcmp(argv[1], "pipelinebench") == 0 && argc <= 3)
+		return PipelineBench(argc == 3 ? (uint32_t)strtoul(argv[2], NULL, 10) : 12345);
+#endif
+
+	if (strcmp(argv[1], "render") == 0 && (argc == 3 || argc == 4))
+		return Render(argv[2], argc == 4 ? argv[3] : renderReferencePath);
+
+	if (strcmp(argv[1], "rasterbench") == 0 && argc <= 3)
+		return RasterBench(argc == 3 ? (uint32_t)strtoul(argv[2], NULL, 10) : 12345);
+
+	if (strcmp(argv[1], "capture") == 0 && argc == 3)
+		return Capture(argv[2]);
+
+	if (strcmp(argv[1], "replay") == 0 && argc >= 3 && argc <= 5) {
+		int count = argc >= 4 ? atoi(argv[3]) : replayDefaultCount;
+		if (count < 1)
+			count = 1;
+		return Replay(argv[2], count, argc == 5 ? argv[4] : "null");
+	}
+
+	if (strcmp(argv[1], "imagebench") == 0)
+		return ImageBench(argc - 2, argv + 2);
+
+	PrintUsage();
+	return 1;
+}
@@ -0,0 +1,725 @@
+#include "BlockCompression.h"
+
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+// bc7 interpolation weights of the 16 index values, out of 64
+static const int bc7IndexWeights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// power iterations when looking for the main axis of a block's colors
+const int principalAxisIterations = 8;
+
+static inline int ClampInt(int value, int low, int high) {
+	return value < low ? low : (value > high ? high : value);
+}
+
+uint32_t GetBlockFormatBytesPerBlock(BlockFormat format) {
+	if (format == BLOCK_FORMAT_BC1 || format == BLOCK_FORMAT_BC4)
+		return 8;
+	return 16;
+}
+
+void GetBlockSurfaceInfo(BlockFormat format, uint32_t width, uint32_t height, size_t& rowPitch, uint32_t& rowCount) {
+	uint32_t blocksWide = (width + blockDimension - 1) / blockDimension;
+	uint32_t blocksHigh = (height + blockDimension - 1) / blockDimension;
+
+	rowPitch = (size_t)(blocksWide > 0 ? blocksWide : 1) * GetBlockFormatBytesPerBlock(format);
+	rowCount = blocksHigh > 0 ? blocksHigh : 1;
+}
+
+// mean and main axis of the first channelCount channels of the points
+// the axis is zero if all points are the same
+static void ComputePrincipalAxis(const float points[][4], int count, int channelCount, float mean[4], float axis[4]) {
+	float covariance[4][4] = {};
+
+	for (int c = 0; c < 4; ++c) {
+		mean[c] = 0.0f;
+		axis[c] = 0.0f;
+	}
+
+	for (int i = 0; i < count; ++i) {
+		for (int c = 0; c < channelCount; ++c)
+			mean[c] += points[i][c];
+	}
+	for (int c = 0; c < channelCount; ++c)
+		mean[c] /= count;
+
+	for (int i = 0; i < count; ++i) {
+		float delta[4];
+		for (int c = 0; c < channelCount; ++c)
+			delta[c] = points[i][c] - mean[c];
+
+		for (int a = 0; a < channelCount; ++a) {
+			for (int b = 0; b < channelCount; ++b)
+				covariance[a][b] += delta[a] * delta[b];
+		}
+	}
+
+	// start from the channel that varies the most
+	int largest = 0;
+	for (int c = 1; c < channelCount; ++c) {
+		if (covariance[c][c] > covariance[largest][largest])
+			largest = c;
+	}
+	for (int c = 0; c < channelCount; ++c)
+		axis[c] = covariance[largest][c];
+
+	for (int iteration = 0; iteration < principalAxisIterations; ++iteration) {
+		float next[4] = {};
+		float maxComponent = 0.0f;
+
+		for (int a = 0; a < channelCount; ++a) {
+			for (int b = 0; b < channelCount; ++b)
+				next[a] += covariance[a][b] * axis[b];
+			maxComponent = fmaxf(maxComponent, fabsf(next[a]));
+		}
+
+		if (maxComponent <= 0.0f) {
+			for (int c = 0; c < channelCount; ++c)
+				axis[c] = 0.0f;
+			return;
+		}
+
+		for (int c = 0; c < channelCount; ++c)
+			axis[c] = next[c] / maxComponent;
+	}
+
+	float length = 0.0f;
+	for (int c = 0; c < channelCount; ++c)
+		length += axis[c] * axis[c];
+	length = sqrtf(length);
+
+	for (int c = 0; c < channelCount; ++c)
+		axis[c] /= length;
+}
+
+// smallest and largest position of the points along the axis, relative to the mean
+static void ProjectOntoAxis(const float points[][4], int count, int channelCount, const float mean[4], const float axis[4], float& minT, float& maxT) {
+	minT = FLT_MAX;
+	maxT = -FLT_MAX;
+
+	for (int i = 0; i < count; ++i) {
+		float t = 0.0f;
+		for (int c = 0; c < channelCount; ++c)
+			t += (points[i][c] - mean[c]) * axis[c];
+
+		minT = fminf(minT, t);
+		maxT = fmaxf(maxT, t);
+	}
+}
+
+// least squares endpoints for fixed indices, weights[i] is how much of endpoint 0 pixel i gets
+static bool SolveEndpoints(const uint8_t* pixels, const float* weights, int channelCount, float endpoints[2][4]) {
+	float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+	float ax[4] = {}, bx[4] = {};
+
+	for (uint32_t i = 0; i < pixelsPerBlock; ++i) {
+		float a = weights[i];
+		float b = 1.0f - a;
+
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+
+		for (int c = 0; c < channelCount; ++c) {
+			ax[c] += a * pixels[i * 4 + c];
+			bx[c] += b * pixels[i * 4 + c];
+		}
+	}
+
+	// every pixel uses the same index
+	float determinant = aa * bb - ab * ab;
+	if (fabsf(determinant) < 1e-6f)
+		return false;
+
+	for (int c = 0; c < channelCount; ++c) {
+		endpoints[0][c] = (ax[c] * bb - bx[c] * ab) / determinant;
+		endpoints[1][c] = (bx[c] * aa - ax[c] * ab) / determinant;
+	}
+	return true;
+}
+
+// bc1 color block
+
+static uint16_t PackColor565(const float color[3]) {
+	int r = ClampInt((int)(color[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+	int g = ClampInt((int)(color[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+	int b = ClampInt((int)(color[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void UnpackColor565(uint16_t color, int rgb[3]) {
+	int r = (color >> 11) & 31;
+	int g = (color >> 5) & 63;
+	int b = color & 31;
+
+	rgb[0] = (r << 3) | (r >> 2);
+	rgb[1] = (g << 2) | (g >> 4);
+	rgb[2] = (b << 3) | (b >> 2);
+}
+
+// color0 > color1 selects 4 colors, otherwise 3 colors and transparent black
+// the color block of bc3 always has 4 colors
+static bool HasFourColors(uint16_t color0, uint16_t color1, bool forceFourColors) {
+	return forceFourColors || color0 > color1;
+}
+
+static void BuildColorPalette(uint16_t color0, uint16_t color1, bool forceFourColors, int palette[4][4]) {
+	UnpackColor565(color0, palette[0]);
+	UnpackColor565(color1, palette[1]);
+	palette[0][3] = 255;
+	palette[1][3] = 255;
+	palette[2][3] = 255;
+
+	if (HasFourColors(color0, color1, forceFourColors)) {
+		for (int c = 0; c < 3; ++c) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+		}
+		palette[3][3] = 255;
+	}
+	else {
+		for (int c = 0; c < 3; ++c) {
+			palette[2][c] = (palette[0][c] + palette[1][c] + 1) / 2;
+			palette[3][c] = 0;
+		}
+		palette[3][3] = 0;
+	}
+}
+
+// swaps the endpoints into the order that selects the wanted mode
+static void OrderColorEndpoints(uint16_t& color0, uint16_t& color1, bool threeColors) {
+	if (threeColors ? color0 > color1 : color0 < color1) {
+		uint16_t swap = color0;
+		color0 = color1;
+		color1 = swap;
+	}
+}
+
+// nearest palette entry for every pixel, returns the squared rgb error
+static int FitColorIndices(const uint8_t* pixels, const bool* transparent, uint16_t color0, uint16_t color1, bool forceFourColors, uint32_t& indices) {
+	int palette[4][4];
+	BuildColorPalette(color0, color1, forceFourColors, palette);
+
+	// entry 3 is only for transparent pixels in 3 color mode
+	int entryCount = HasFourColors(color0, color1, forceFourColors) ? 4 : 3;
+
+	indices = 0;
+	int error = 0;
+
+	for (uint32_t i = 0; i < pixelsPerBlock; ++i) {
+		if (transparent[i]) {
+			indices |= 3u << (i * 2);
+			continue;
+		}
+
+		const uint8_t* pixel = pixels + i * 4;
+		int bestError = INT_MAX;
+		uint32_t bestIndex = 0;
+
+		for (int e = 0; e < entryCount; ++e) {
+			int dr = pixel[0] - palette[e][0];
+			int dg = pixel[1] - palette[e][1];
+			int db = pixel[2] - palette[e][2];
+			int entryError = dr * dr + dg * dg + db * db;
+
+			if (entryError < bestError) {
+				bestError = entryError;
+				bestIndex = e;
+			}
+		}
+
+		indices |= bestIndex << (i * 2);
+		error += bestError;
+	}
+
+	return error;
+}
+
+static void EncodeColorBlock(const uint8_t* pixels, bool allowTransparent, bool forceFourColors, uint8_t* block) {
+	float points[pixelsPerBlock][4];
+	bool transparent[pixelsPerBlock];
+	int count = 0;
+	bool anyTransparent = false;
+
+	for (uint32_t i = 0; i < pixelsPerBlock; ++i) {
+		const uint8_t* pixel = pixels + i * 4;
+
+		transparent[i] = allowTransparent && pixel[3] < 128;
+		if (transparent[i]) {
+			anyTransparent = true;
+			continue;
+		}
+
+		points[count][0] = pixel[0];
+		points[count][1] = pixel[1];
+		points[count][2] = pixel[2];
+		points[count][3] = 0.0f;
+		++count;
+	}
+
+	uint16_t color0 = 0;
+	uint16_t color1 = 0;
+	uint32_t indices = 0;
+
+	if (count == 0) {
+		// equal endpoints select 3 color mode, every pixel takes the transparent entry
+		indices = 0xffffffff;
+	}
+	else {
+		float mean[4], axis[4], minT, maxT;
+		ComputePrincipalAxis(points, count, 3, mean, axis);
+		ProjectOntoAxis(points, count, 3, mean, axis, minT, maxT);
+
+		float endpoints[2][3];
+		for (int c = 0; c < 3; ++c) {
+			endpoints[0][c] = mean[c] + axis[c] * maxT;
+			endpoints[1][c] = mean[c] + axis[c] * minT;
+		}
+
+		// pull the endpoints in a little, the extremes tend to be outliers
+		for (int c = 0; c < 3; ++c) {
+			float inset = (endpoints[0][c] - endpoints[1][c]) / 16.0f;
+			endpoints[0][c] -= inset;
+			endpoints[1][c] += inset;
+		}
+
+		color0 = PackColor565(endpoints[0]);
+		color1 = PackColor565(endpoints[1]);
+		OrderColorEndpoints(color0, color1, anyTransparent && !forceFourColors);
+
+		int error = FitColorIndices(pixels, transparent, color0, color1, forceFourColors, indices);
+
+		// refit the endpoints to the chosen indices, only worth it for the 4 color palette
+		if (error > 0 && !anyTransparent && HasFourColors(color0, color1, forceFourColors)) {
+			static const float paletteWeights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+			float weights[pixelsPerBlock];
+			for (uint32_t i = 0; i < pixelsPerBlock; ++i)
+				weights[i] = paletteWeights[(indices >> (i * 2)) & 3];
+
+			float refit[2][4];
+			if (SolveEndpoints(pixels, weights, 3, refit)) {
+				uint16_t refitColor0 = PackColor565(refit[0]);
+				uint16_t refitColor1 = PackColor565(refit[1]);
+				OrderColorEndpoints(refitColor0, refitColor1, false);
+
+				uint32_t refitIndices;
+				int refitError = FitColorIndices(pixels, transparent, refitColor0, refitColor1, forceFourColors, refitIndices);
+				if (refitError < error) {
+					color0 = refitColor0;
+					color1 = refitColor1;
+					indices = refitIndices;
+				}
+			}
+		}
+	}
+
+	block[0] = (uint8_t)(color0 & 0xff);
+	block[1] = (uint8_t)(color0 >> 8);
+	block[2] = (uint8_t)(color1 & 0xff);
+	block[3] = (uint8_t)(color1 >> 8);
+	for (int b = 0; b < 4; ++b)
+		block[4 + b] = (uint8_t)(indices >> (b * 8));
+}
+
+static void DecodeColorBlock(const uint8_t* block, bool forceFourColors, uint8_t* pixels) {
+	uint16_t color0 = (uint16_t)(block[0] | (block[1] << 8));
+	uint16_t color1 = (uint16_t)(block[2] | (block[3] << 8));
+	uint32_t indices = (uint32_t)block[4] | ((uint32_t)block[5] << 8) | ((uint32_t)block[6] << 16) | ((uint32_t)block[7] << 24);
+
+	int palette[4][4];
+	BuildColorPalette(color0, color1, forceFourColors, palette);
+
+	for (uint32_t i = 0; i < pixelsPerBlock; ++i) {
+		const int* entry = palette[(indices >> (i * 2)) & 3];
+		for (int c = 0; c < 4; ++c)
+			pixels[i * 4 + c] = (uint8_t)entry[c];
+	}
+}
+
+// bc4 single channel block, also the alpha of bc3 and both halves of bc5
+
+// value0 > value1 selects 8 interpolated values, otherwise 6 plus exact 0 and 255
+static void BuildSingleChannelPalette(int value0, int value1, int palette[8]) {
+	palette[0] = value0;
+	palette[1] = value1;
+
+	if (value0 > value1) {
+		for (int i = 1; i < 7; ++i)
+			palette[i + 1] = ((7 - i) * value0 + i * value1 + 3) / 7;
+	}
+	else {
+		for (int i = 1; i < 5; ++i)
+			palette[i + 1] = ((5 - i) * value0 + i * value1 + 2) / 5;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+static int FitSingleChannelIndices(const uint8_t* pixels, int channel, int value0, int value1, uint64_t& indices) {
+	int palette[8];
+	BuildSingleChannelPalette(value0, value1, palette);
+
+	indices = 0;
+	int error = 0;
+
+	for (uint32_t i = 0; i < pixelsPerBlock; ++i) {
+		int value = pixels[i * 4 + channel];
+		int bestError = INT_MAX;
+		uint64_t bestIndex = 0;
+
+		for (int e = 0; e < 8; ++e) {
+			int entryError = (value - palette[e]) * (value - palette[e]);
+			if (entryError < bestError) {
+				bestError = entryError;
+				bestIndex = e;
+			}
+		}
+
+		indices |= bestIndex << (i * 3);
+		error += bestError;
+	}
+
+	return error;
+}
+
+static void EncodeSingleChannelBlock(const uint8_t* pixels, int channel, uint8_t* block) {
+	int minValue = 255, maxValue = 0;
+	// range without the values the 6 value mode has for free
+	int minInner = 255, maxInner = 0;
+
+	for (uint32_t i = 0; i < pixelsPerBlock; ++i) {
+		int value = pixels[i * 4 + channel];
+		minValue = value < minValue ? value : minValue;
+		maxValue = value > maxValue ? value : maxValue;
+
+		if (value != 0 && value != 255) {
+			minInner = value < minInner ? value : minInner;
+			maxInner = value > maxInner ? value : maxInner;
+		}
+	}
+
+	int value0 = maxValue;
+	int value1 = minValue;
+	uint64_t indices = 0;
+	int error = 0;
+
+	if (maxValue != minValue)
+		error = FitSingleChannelIndices(pixels, channel, value0, value1, indices);
+
+	if (error > 0 && minInner <= maxInner) {
+		uint64_t innerIndices;
+		int innerError = FitSingleChannelIndices(pixels, channel, minInner, maxInner, innerIndices);
+		if (innerError < error) {
+			value0 = minInner;
+			value1 = maxInner;
+			indices = innerIndices;
+		}
+	}
+
+	block[0] = (uint8_t)value0;
+	block[1] = (uint8_t)value1;
+	for (int b = 0; b < 6; ++b)
+		block[2 + b] = (uint8_t)(indices >> (b * 8));
+}
+
+static void DecodeSingleChannelBlock(const uint8_t* block, int channel, uint8_t* pixels) {
+	int palette[8];
+	BuildSingleChannelPalette(block[0], block[1], palette);
+
+	uint64_t indices = 0;
+	for (int b = 0; b < 6; ++b)
+		indices |= (uint64_t)block[2 + b] << (b * 8);
+
+	for (uint32_t i = 0; i < pixelsPerBlock; ++i)
+		pixels[i * 4 + channel] = (uint8_t)palette[(indices >> (i * 3)) & 7];
+}
+
+// bc7 mode 6 block
+
+// bits are stored from the lowest bit of the first byte up, block has to be zeroed first
+static void WriteBits(uint8_t* block, int& position, uint32_t value, int count) {
+	for (int i = 0; i < count; ++i, ++position) {
+		if ((value >> i) & 1)
+			block[position >> 3] |= (uint8_t)(1 << (position & 7));
+	}
+}
+
+static uint32_t ReadBits(const uint8_t* block, int& position, int count) {
+	uint32_t value = 0;
+	for (int i = 0; i < count; ++i, ++position)
+		value |= (uint32_t)((block[position >> 3] >> (position & 7)) & 1) << i;
+	return value;
+}
+
+// 7 bits per channel, the p bit is the lowest bit of all four channels of an endpoint
+struct BC7Endpoints {
+	int values[2][4];
+	int pBits[2];
+};
+
+static void QuantizeBC7Endpoint(const float endpoint[4], int values[4], int& pBit) {
+	int bestError = INT_MAX;
+
+	for (int p = 0; p < 2; ++p) {
+		int quantized[4];
+		int error = 0;
+
+		for (int c = 0; c < 4; ++c) {
+			float value = fminf(fmaxf(endpoint[c], 0.0f), 255.0f);
+			quantized[c] = ClampInt((int)((value - p) / 2.0f + 0.5f), 0, 127);
+
+			int delta = ((quantized[c] << 1) | p) - (int)(value + 0.5f);
+			error += delta * delta;
+		}
+
+		if (error < bestError) {
+			bestError = error;
+			pBit = p;
+			for (int c = 0; c < 4; ++c)
+				values[c] = quantized[c];
+		}
+	}
+}
+
+static void BuildBC7Palette(const BC7Endpoints& endpoints, int palette[16][4]) {
+	for (int c = 0; c < 4; ++c) {
+		int value0 = (endpoints.values[0][c] << 1) | endpoints.pBits[0];
+		int value1 = (endpoints.values[1][c] << 1) | endpoints.pBits[1];
+
+		for (int i = 0; i < 16; ++i)
+			palette[i][c] = ((64 - bc7IndexWeights[i]) * value0 + bc7IndexWeights[i] * value1 + 32) >> 6;
+	}
+}
+
+static int QuantizeAndFitBC7(const uint8_t* pixels, const float endpoints[2][4], BC7Endpoints& quantized, uint8_t indices[16]) {
+	QuantizeBC7Endpoint(endpoints[0], quantized.values[0], quantized.pBits[0]);
+	QuantizeBC7Endpoint(endpoints[1], quantized.values[1], quantized.pBits[1]);
+
+	int palette[16][4];
+	BuildBC7Palette(quantized, palette);
+
+	int error = 0;
+	for (uint32_t i = 0; i < pixelsPerBlock; ++i) {
+		const uint8_t* pixel = pixels + i * 4;
+		int bestError = INT_MAX;
+
+		for (int e = 0; e < 16; ++e) {
+			int entryError = 0;
+			for (int c = 0; c < 4; ++c)
+				entryError += (pixel[c] - palette[e][c]) * (pixel[c] - palette[e][c]);
+
+			if (entryError < bestError) {
+				bestError = entryError;
+				indices[i] = (uint8_t)e;
+			}
+		}
+
+		error += bestError;
+	}
+
+	return error;
+}
+
+static void EncodeBC7Block(const uint8_t* pixels, uint8_t* block) {
+	float points[pixelsPerBlock][4];
+	for (uint32_t i = 0; i < pixelsPerBlock; ++i) {
+		for (int c = 0; c < 4; ++c)
+			points[i][c] = pixels[i * 4 + c];
+	}
+
+	float mean[4], axis[4], minT, maxT;
+	ComputePrincipalAxis(points, pixelsPerBlock, 4, mean, axis);
+	ProjectOntoAxis(points, pixelsPerBlock, 4, mean, axis, minT, maxT);
+
+	float endpoints[2][4];
+	for (int c = 0; c < 4; ++c) {
+		endpoints[0][c] = mean[c] + axis[c] * minT;
+		endpoints[1][c] = mean[c] + axis[c] * maxT;
+	}
+
+	BC7Endpoints quantized;
+	uint8_t indices[pixelsPerBlock];
+	int error = QuantizeAndFitBC7(pixels, endpoints, quantized, indices);
+
+	if (error > 0) {
+		float weights[pixelsPerBlock];
+		for (uint32_t i = 0; i < pixelsPerBlock; ++i)
+			weights[i] = 1.0f - bc7IndexWeights[indices[i]] / 64.0f;
+
+		float refit[2][4];
+		if (SolveEndpoints(pixels, weights, 4, refit)) {
+			BC7Endpoints refitQuantized;
+			uint8_t refitIndices[pixelsPerBlock];
+			int refitError = QuantizeAndFitBC7(pixels, refit, refitQuantized, refitIndices);
+			if (refitError < error) {
+				quantized = refitQuantized;
+				memcpy(indices, refitIndices, sizeof(indices));
+			}
+		}
+	}
+
+	// the first index is stored without its top bit, so it has to be 0
+	// the weights are symmetric, swapping the endpoints and mirroring the indices gives the same colors
+	if (indices[0] & 8) {
+		for (int c = 0; c < 4; ++c) {
+			int swap = quantized.values[0][c];
+			quantized.values[0][c] = quantized.values[1][c];
+			quantized.values[1][c] = swap;
+		}
+
+		int swap = quantized.pBits[0];
+		quantized.pBits[0] = quantized.pBits[1];
+		quantized.pBits[1] = swap;
+
+		for (uint32_t i = 0; i < pixelsPerBlock; ++i)
+			indices[i] = (uint8_t)(15 - indices[i]);
+	}
+
+	memset(block, 0, 16);
+	int position = 0;
+
+	// mode 6 is six 0 bits and a 1
+	WriteBits(block, position, 1 << 6, 7);
+
+	for (int c = 0; c < 4; ++c) {
+		WriteBits(block, position, quantized.values[0][c], 7);
+		WriteBits(block, position, quantized.values[1][c], 7);
+	}
+
+	WriteBits(block, position, quantized.pBits[0], 1);
+	WriteBits(block, position, quantized.pBits[1], 1);
+
+	WriteBits(block, position, indices[0], 3);
+	for (uint32_t i = 1; i < pixelsPerBlock; ++i)
+		WriteBits(block, position, indices[i], 4);
+}
+
+static bool DecodeBC7Block(const uint8_t* block, uint8_t* pixels) {
+	int position = 0;
+
+	int mode = 0;
+	while (mode < 8 && ReadBits(block, position, 1) == 0)
+		++mode;
+
+	if (mode != 6) {
+		// not written by the encoder, show it as magenta
+		for (uint32_t i = 0; i < pixelsPerBlock; ++i) {
+			pixels[i * 4 + 0] = 255;
+			pixels[i * 4 + 1] = 0;
+			pixels[i * 4 + 2] = 255;
+			pixels[i * 4 + 3] = 255;
+		}
+		return false;
+	}
+
+	BC7Endpoints endpoints;
+	for (int c = 0; c < 4; ++c) {
+		endpoints.values[0][c] = (int)ReadBits(block, position, 7);
+		endpoints.values[1][c] = (int)ReadBits(block, position, 7);
+	}
+	endpoints.pBits[0] = (int)ReadBits(block, position, 1);
+	endpoints.pBits[1] = (int)ReadBits(block, position, 1);
+
+	int palette[16][4];
+	BuildBC7Palette(endpoints, palette);
+
+	for (uint32_t i = 0; i < pixelsPerBlock; ++i) {
+		uint32_t index = ReadBits(block, position, i == 0 ? 3 : 4);
+		for (int c = 0; c < 4; ++c)
+			pixels[i * 4 + c] = (uint8_t)palette[index][c];
+	}
+
+	return true;
+}
+
+void EncodeBlock(BlockFormat format, const uint8_t* pixels, uint8_t* block) {
+	switch (format) {
+	case BLOCK_FORMAT_BC1:
+		EncodeColorBlock(pixels, true, false, block);
+		break;
+	case BLOCK_FORMAT_BC3:
+		EncodeSingleChannelBlock(pixels, 3, block);
+		EncodeColorBlock(pixels, false, true, block + 8);
+		break;
+	case BLOCK_FORMAT_BC4:
+		EncodeSingleChannelBlock(pixels, 0, block);
+		break;
+	case BLOCK_FORMAT_BC5:
+		EncodeSingleChannelBlock(pixels, 0, block);
+		EncodeSingleChannelBlock(pixels, 1, block + 8);
+		break;
+	case BLOCK_FORMAT_BC7:
+		EncodeBC7Block(pixels, block);
+		break;
+	}
+}
+
+bool DecodeBlock(BlockFormat format, const uint8_t* block, uint8_t* pixels) {
+	switch (format) {
+	case BLOCK_FORMAT_BC1:
+		DecodeColorBlock(block, false, pixels);
+		return true;
+	case BLOCK_FORMAT_BC3:
+		DecodeColorBlock(block + 8, true, pixels);
+		DecodeSingleChannelBlock(block, 3, pixels);
+		return true;
+	case BLOCK_FORMAT_BC4:
+	case BLOCK_FORMAT_BC5:
+		for (uint32_t i = 0; i < pixelsPerBlock; ++i) {
+			pixels[i * 4 + 0] = 0;
+			pixels[i * 4 + 1] = 0;
+			pixels[i * 4 + 2] = 0;
+			pixels[i * 4 + 3] = 255;
+		}
+		DecodeSingleChannelBlock(block, 0, pixels);
+		if (format == BLOCK_FORMAT_BC5)
+			DecodeSingleChannelBlock(block + 8, 1, pixels);
+		return true;
+	case BLOCK_FORMAT_BC7:
+		return DecodeBC7Block(block, pixels);
+	}
+	return false;
+}
+
+void CompressImage(BlockFormat format, const uint8_t* pixels, uint32_t width, uint32_t height, size_t rowPitch, uint8_t* blocks, size_t blockRowPitch) {
+	uint32_t bytesPerBlock = GetBlockFormatBytesPerBlock(format);
+	uint8_t blockPixels[pixelsPerBlock * 4];
+
+	for (uint32_t by = 0; by * blockDimension < height; ++by) {
+		for (uint32_t bx = 0; bx * blockDimension < width; ++bx) {
+			for (uint32_t y = 0; y < blockDimension; ++y) {
+				uint32_t sourceY = by * blockDimension + y;
+				sourceY = sourceY < height ? sourceY : height - 1;
+
+				for (uint32_t x = 0; x < blockDimension; ++x) {
+					uint32_t sourceX = bx * blockDimension + x;
+					sourceX = sourceX < width ? sourceX : width - 1;
+
+					memcpy(&blockPixels[(y * blockDimension + x) * 4], pixels + sourceY * rowPitch + sourceX * 4, 4);
+				}
+			}
+
+			EncodeBlock(format, blockPixels, blocks + by * blockRowPitch + bx * bytesPerBlock);
+		}
+	}
+}
+
+void DecompressImage(BlockFormat format, const uint8_t* blocks, uint32_t width, uint32_t height, size_t blockRowPitch, uint8_t* pixels, size_t rowPitch) {
+	uint32_t bytesPerBlock = GetBlockFormatBytesPerBlock(format);
+	uint8_t blockPixels[pixelsPerBlock * 4];
+
+	for (uint32_t by = 0; by * blockDimension < height; ++by) {
+		for (uint32_t bx = 0; bx * blockDimension < width; ++bx) {
+			DecodeBlock(format, blocks + by * blockRowPitch + bx * bytesPerBlock, blockPixels);
+
+			for (uint32_t y = 0; y < blockDimension && by * blockDimension + y < height; ++y) {
+				for (uint32_t x = 0; x < blockDimension && bx * blockDimension + x < width; ++x)
+					memcpy(pixels + (by * blockDimension + y) * rowPitch + (bx * blockDimension + x) * 4, &blockPixels[(y * blockDimension + x) * 4], 4);
+			}
+		}
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+// bc1, bc3, bc4, bc5 and bc7 block compression on the cpu
+// every 4x4 pixel block becomes 8 or 16 bytes the gpu samples directly
+// input and output pixels are 8 bit rgba, no wic or d3d12 dependency so the encoder also runs on linux
+
+#include <cstddef>
+#include <cstdint>
+
+enum BlockFormat {
+	// rgb, 1 bit alpha, 8 bytes per block
+	BLOCK_FORMAT_BC1,
+	// bc1 color plus interpolated alpha, 16 bytes per block
+	BLOCK_FORMAT_BC3,
+	// one channel (r), 8 bytes per block
+	BLOCK_FORMAT_BC4,
+	// two channels (r, g), for normal maps, 16 bytes per block
+	BLOCK_FORMAT_BC5,
+	// rgba, 16 bytes per block, only mode 6 (one subset, 7777 endpoints with p bits, 4 bit indices) is written
+	BLOCK_FORMAT_BC7,
+};
+
+const uint32_t blockDimension = 4;
+const uint32_t pixelsPerBlock = blockDimension * blockDimension;
+
+uint32_t GetBlockFormatBytesPerBlock(BlockFormat format);
+
+// bytes per row of blocks and number of block rows, every surface has at least one block
+void GetBlockSurfaceInfo(BlockFormat format, uint32_t width, uint32_t height, size_t& rowPitch, uint32_t& rowCount);
+
+// pixels is 16 rgba pixels in row order
+void EncodeBlock(BlockFormat format, const uint8_t* pixels, uint8_t* block);
+
+// bc4 decodes to (r, 0, 0, 255), bc5 to (r, g, 0, 255)
+// returns false for bc7 modes the encoder does not write
+bool DecodeBlock(BlockFormat format, const uint8_t* block, uint8_t* pixels);
+
+// blocks past the right and bottom edge repeat the last column and row
+void CompressImage(BlockFormat format, const uint8_t* pixels, uint32_t width, uint32_t height, size_t rowPitch, uint8_t* blocks, size_t blockRowPitch);
+
+void DecompressImage(BlockFormat format, const uint8_t* blocks, uint32_t width, uint32_t height, size_t blockRowPitch, uint8_t* pixels, size_t rowPitch);
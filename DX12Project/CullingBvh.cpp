@@ -0,0 +1,443 @@
+#include "CullingBvh.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#define CULLING_BVH_SSE 1
+#include <xmmintrin.h>
+#else
+#define CULLING_BVH_SSE 0
+#endif
+
+// a 4 wide tree over 2^32 objects is not deeper than this, every level pushes at most three siblings
+const int cullingBvhMaxStackSize = 128;
+
+void CullingFrustumInit(CullingFrustum& frustum, const float clipFromWorld[16]) {
+	const float* row[4] = { &clipFromWorld[0], &clipFromWorld[4], &clipFromWorld[8], &clipFromWorld[12] };
+
+	// gribb and hartmann, -w <= x <= w, -w <= y <= w, 0 <= z <= w
+	for (int j = 0; j < 4; ++j) {
+		frustum.planes[0][j] = row[3][j] + row[0][j];
+		frustum.planes[1][j] = row[3][j] - row[0][j];
+		frustum.planes[2][j] = row[3][j] + row[1][j];
+		frustum.planes[3][j] = row[3][j] - row[1][j];
+		frustum.planes[4][j] = row[2][j];
+		frustum.planes[5][j] = row[3][j] - row[2][j];
+	}
+
+	for (int i = 0; i < 6; ++i) {
+		float* plane = frustum.planes[i];
+		float length = sqrtf(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		float inverseLength = length > 0.0f ? 1.0f / length : 0.0f;
+		for (int j = 0; j < 4; ++j)
+			plane[j] *= inverseLength;
+	}
+}
+
+// the corner furthest along the plane normal decides if a box is outside, the nearest one if it is inside
+// sums are in the same order as the simd version so both agree to the bit
+bool CullingFrustumTestBox(const CullingFrustum& frustum, const float boundsMin[3], const float boundsMax[3]) {
+	for (int i = 0; i < 6; ++i) {
+		const float* plane = frustum.planes[i];
+		float x = plane[0] >= 0.0f ? boundsMax[0] : boundsMin[0];
+		float y = plane[1] >= 0.0f ? boundsMax[1] : boundsMin[1];
+		float z = plane[2] >= 0.0f ? boundsMax[2] : boundsMin[2];
+		if (plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+void TransformBounds(const float matrix[16], const float boundsMin[3], const float boundsMax[3], float transformedMin[3], float transformedMax[3]) {
+	// arvo, every matrix entry moves the box by its smaller or its larger product
+	for (int j = 0; j < 3; ++j) {
+		float minimum = matrix[12 + j];
+		float maximum = matrix[12 + j];
+		for (int i = 0; i < 3; ++i) {
+			float a = matrix[i * 4 + j] * boundsMin[i];
+			float b = matrix[i * 4 + j] * boundsMax[i];
+			minimum += std::min(a, b);
+			maximum += std::max(a, b);
+		}
+		transformedMin[j] = minimum;
+		transformedMax[j] = maximum;
+	}
+}
+
+static void SetEmpty(CullingBounds4& bounds, uint32_t lane) {
+	bounds.minX[lane] = bounds.minY[lane] = bounds.minZ[lane] = FLT_MAX;
+	bounds.maxX[lane] = bounds.maxY[lane] = bounds.maxZ[lane] = -FLT_MAX;
+}
+
+static void SetLane(CullingBounds4& bounds, uint32_t lane, const float boundsMin[3], const float boundsMax[3]) {
+	bounds.minX[lane] = boundsMin[0];
+	bounds.minY[lane] = boundsMin[1];
+	bounds.minZ[lane] = boundsMin[2];
+	bounds.maxX[lane] = boundsMax[0];
+	bounds.maxY[lane] = boundsMax[1];
+	bounds.maxZ[lane] = boundsMax[2];
+}
+
+// of every lane, empty lanes do not count
+static void GetUnion(const CullingBounds4& bounds, float boundsMin[3], float boundsMax[3]) {
+	boundsMin[0] = boundsMin[1] = boundsMin[2] = FLT_MAX;
+	boundsMax[0] = boundsMax[1] = boundsMax[2] = -FLT_MAX;
+	for (uint32_t lane = 0; lane < cullingBvhWidth; ++lane) {
+		boundsMin[0] = std::min(boundsMin[0], bounds.minX[lane]);
+		boundsMin[1] = std::min(boundsMin[1], bounds.minY[lane]);
+		boundsMin[2] = std::min(boundsMin[2], bounds.minZ[lane]);
+		boundsMax[0] = std::max(boundsMax[0], bounds.maxX[lane]);
+		boundsMax[1] = std::max(boundsMax[1], bounds.maxY[lane]);
+		boundsMax[2] = std::max(boundsMax[2], bounds.maxZ[lane]);
+	}
+}
+
+struct CullingBvhBuilder {
+	const float* boundsMin;
+	const float* boundsMax;
+	// object indices, partitioned in place as the tree is built
+	std::vector<uint32_t> objects;
+	std::vector<float> centers;
+};
+
+static uint32_t GetLongestCenterAxis(const CullingBvhBuilder& builder, uint32_t begin, uint32_t end) {
+	float minimum[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float maximum[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (uint32_t i = begin; i < end; ++i) {
+		const float* center = &builder.centers[builder.objects[i] * 3];
+		for (int j = 0; j < 3; ++j) {
+			minimum[j] = std::min(minimum[j], center[j]);
+			maximum[j] = std::max(maximum[j], center[j]);
+		}
+	}
+
+	uint32_t axis = 0;
+	for (uint32_t j = 1; j < 3; ++j) {
+		if (maximum[j] - minimum[j] > maximum[axis] - minimum[axis])
+			axis = j;
+	}
+	return axis;
+}
+
+// objects in [begin, middle) are below the ones in [middle, end) along the longest axis
+static void SplitAtMedian(CullingBvhBuilder& builder, uint32_t begin, uint32_t middle, uint32_t end) {
+	uint32_t axis = GetLongestCenterAxis(builder, begin, end);
+	const std::vector<float>& centers = builder.centers;
+	std::nth_element(builder.objects.begin() + begin, builder.objects.begin() + middle, builder.objects.begin() + end, [&centers, axis](uint32_t a, uint32_t b) {
+		return centers[a * 3 + axis] < centers[b * 3 + axis];
+	});
+}
+
+static uint32_t BuildLeaf(CullingBvh& bvh, const CullingBvhBuilder& builder, uint32_t begin, uint32_t end, float boundsMin[3], float boundsMax[3]) {
+	uint32_t leaf = (uint32_t)bvh.leafBounds.size();
+	bvh.leafBounds.emplace_back();
+	CullingBounds4& bounds = bvh.leafBounds.back();
+
+	for (uint32_t lane = 0; lane < cullingBvhWidth; ++lane) {
+		if (begin + lane >= end) {
+			SetEmpty(bounds, lane);
+			bvh.leafObjects.push_back(cullingBvhEmpty);
+			continue;
+		}
+
+		uint32_t object = builder.objects[begin + lane];
+		SetLane(bounds, lane, &builder.boundsMin[object * 3], &builder.boundsMax[object * 3]);
+		bvh.leafObjects.push_back(object);
+		bvh.objectSlots[object] = leaf * cullingBvhWidth + lane;
+	}
+
+	bvh.leafParents.push_back(cullingBvhEmpty);
+	GetUnion(bounds, boundsMin, boundsMax);
+	return leaf | cullingBvhLeafFlag;
+}
+
+static uint32_t RoundUpToLeaf(uint32_t count) {
+	return (count + cullingBvhWidth - 1) / cullingBvhWidth * cullingBvhWidth;
+}
+
+static uint32_t BuildNode(CullingBvh& bvh, CullingBvhBuilder& builder, uint32_t begin, uint32_t end, uint32_t depth, float boundsMin[3], float boundsMax[3]) {
+	bvh.stats.depth = std::max(bvh.stats.depth, depth);
+
+	uint32_t count = end - begin;
+	if (count <= cullingBvhWidth)
+		return BuildLeaf(bvh, builder, begin, end, boundsMin, boundsMax);
+
+	// up to four groups, small ranges go straight into full leaves and larger ones are quartered by two median splits
+	uint32_t splits[cullingBvhWidth + 1];
+	uint32_t groupCount;
+	if (count <= cullingBvhWidth * cullingBvhWidth) {
+		uint32_t axis = GetLongestCenterAxis(builder, begin, end);
+		const std::vector<float>& centers = builder.centers;
+		std::sort(builder.objects.begin() + begin, builder.objects.begin() + end, [&centers, axis](uint32_t a, uint32_t b) {
+			return centers[a * 3 + axis] < centers[b * 3 + axis];
+		});
+
+		groupCount = (count + cullingBvhWidth - 1) / cullingBvhWidth;
+		for (uint32_t i = 0; i < groupCount; ++i)
+			splits[i] = begin + i * cullingBvhWidth;
+		splits[groupCount] = end;
+	}
+	else {
+		// splits are rounded to whole leaves, otherwise most leaves come out partly filled
+		uint32_t middle = begin + RoundUpToLeaf(count / 2);
+		SplitAtMedian(builder, begin, middle, end);
+		splits[0] = begin;
+		splits[1] = begin + RoundUpToLeaf((middle - begin) / 2);
+		splits[2] = middle;
+		splits[3] = middle + RoundUpToLeaf((end - middle) / 2);
+		splits[4] = end;
+		SplitAtMedian(builder, splits[0], splits[1], splits[2]);
+		SplitAtMedian(builder, splits[2], splits[3], splits[4]);
+		groupCount = 4;
+	}
+
+	uint32_t node = (uint32_t)bvh.nodes.size();
+	bvh.nodes.emplace_back();
+	bvh.nodeParents.push_back(cullingBvhEmpty);
+
+	boundsMin[0] = boundsMin[1] = boundsMin[2] = FLT_MAX;
+	boundsMax[0] = boundsMax[1] = boundsMax[2] = -FLT_MAX;
+	for (uint32_t slot = 0; slot < cullingBvhWidth; ++slot) {
+		// nodes may move while children are built, so it is looked up again every time
+		if (slot >= groupCount) {
+			SetEmpty(bvh.nodes[node].bounds, slot);
+			bvh.nodes[node].children[slot] = cullingBvhEmpty;
+			continue;
+		}
+
+		float childMin[3], childMax[3];
+		uint32_t child = BuildNode(bvh, builder, splits[slot], splits[slot + 1], depth + 1, childMin, childMax);
+		SetLane(bvh.nodes[node].bounds, slot, childMin, childMax);
+		bvh.nodes[node].children[slot] = child;
+
+		uint32_t parent = node * cullingBvhWidth + slot;
+		if (child & cullingBvhLeafFlag)
+			bvh.leafParents[child & ~cullingBvhLeafFlag] = parent;
+		else
+			bvh.nodeParents[child] = parent;
+
+		for (int j = 0; j < 3; ++j) {
+			boundsMin[j] = std::min(boundsMin[j], childMin[j]);
+			boundsMax[j] = std::max(boundsMax[j], childMax[j]);
+		}
+	}
+
+	return node;
+}
+
+void CullingBvhBuild(CullingBvh& bvh, const float* boundsMin, const float* boundsMax, uint32_t objectCount) {
+	bvh.nodes.clear();
+	bvh.leafBounds.clear();
+	bvh.leafObjects.clear();
+	bvh.nodeParents.clear();
+	bvh.leafParents.clear();
+	bvh.dirtyLeaves.clear();
+	bvh.objectSlots.assign(objectCount, cullingBvhEmpty);
+	bvh.objectCount = objectCount;
+	bvh.stats = {};
+
+	CullingBvhBuilder builder;
+	builder.boundsMin = boundsMin;
+	builder.boundsMax = boundsMax;
+	builder.objects.resize(objectCount);
+	builder.centers.resize(objectCount * 3);
+	for (uint32_t i = 0; i < objectCount; ++i) {
+		builder.objects[i] = i;
+		for (int j = 0; j < 3; ++j)
+			builder.centers[i * 3 + j] = (boundsMin[i * 3 + j] + boundsMax[i * 3 + j]) * 0.5f;
+	}
+
+	// the 1.5 is about how much bigger than objectCount / 4 the partly filled leaves make it
+	bvh.leafBounds.reserve(objectCount / cullingBvhWidth * 3 / 2 + 1);
+	bvh.nodes.reserve(objectCount / (cullingBvhWidth * cullingBvhWidth) * 3 / 2 + 1);
+
+	float rootMin[3], rootMax[3];
+	bvh.root = BuildNode(bvh, builder, 0, objectCount, 0, rootMin, rootMax);
+	bvh.leafDirty.assign(bvh.leafBounds.size(), 0);
+
+	bvh.stats.nodeCount = (uint32_t)bvh.nodes.size();
+	bvh.stats.leafCount = (uint32_t)bvh.leafBounds.size();
+}
+
+void CullingBvhSetBounds(CullingBvh& bvh, uint32_t object, const float boundsMin[3], const float boundsMax[3]) {
+	uint32_t slot = bvh.objectSlots[object];
+	uint32_t leaf = slot / cullingBvhWidth;
+	SetLane(bvh.leafBounds[leaf], slot % cullingBvhWidth, boundsMin, boundsMax);
+
+	if (!bvh.leafDirty[leaf]) {
+		bvh.leafDirty[leaf] = 1;
+		bvh.dirtyLeaves.push_back(leaf);
+	}
+}
+
+static bool SetLaneIfChanged(CullingBounds4& bounds, uint32_t lane, const float boundsMin[3], const float boundsMax[3]) {
+	if (bounds.minX[lane] == boundsMin[0] && bounds.minY[lane] == boundsMin[1] && bounds.minZ[lane] == boundsMin[2] &&
+		bounds.maxX[lane] == boundsMax[0] && bounds.maxY[lane] == boundsMax[1] && bounds.maxZ[lane] == boundsMax[2])
+		return false;
+
+	SetLane(bounds, lane, boundsMin, boundsMax);
+	return true;
+}
+
+void CullingBvhRefit(CullingBvh& bvh) {
+	for (uint32_t leaf : bvh.dirtyLeaves) {
+		bvh.leafDirty[leaf] = 0;
+
+		float boundsMin[3], boundsMax[3];
+		GetUnion(bvh.leafBounds[leaf], boundsMin, boundsMax);
+
+		// up to the root, or until a box comes out the same, then nothing above it changes either
+		uint32_t parent = bvh.leafParents[leaf];
+		while (parent != cullingBvhEmpty) {
+			uint32_t node = parent / cullingBvhWidth;
+			CullingBvhNode& parentNode = bvh.nodes[node];
+			if (!SetLaneIfChanged(parentNode.bounds, parent % cullingBvhWidth, boundsMin, boundsMax))
+				break;
+
+			GetUnion(parentNode.bounds, boundsMin, boundsMax);
+			parent = bvh.nodeParents[node];
+		}
+	}
+
+	bvh.stats.lastRefitLeafCount = (uint32_t)bvh.dirtyLeaves.size();
+	bvh.dirtyLeaves.clear();
+}
+
+// bit per box, outside is set if a box is entirely outside a plane, inside if it is entirely inside every plane
+static void TestBounds4(const CullingBounds4& bounds, const CullingFrustum& frustum, uint32_t& outside, uint32_t& inside) {
+#if CULLING_BVH_SSE
+	__m128 minX = _mm_loadu_ps(bounds.minX);
+	__m128 minY = _mm_loadu_ps(bounds.minY);
+	__m128 minZ = _mm_loadu_ps(bounds.minZ);
+	__m128 maxX = _mm_loadu_ps(bounds.maxX);
+	__m128 maxY = _mm_loadu_ps(bounds.maxY);
+	__m128 maxZ = _mm_loadu_ps(bounds.maxZ);
+	__m128 zero = _mm_setzero_ps();
+	__m128 outsideMask = zero;
+	__m128 insideMask = _mm_cmpeq_ps(zero, zero);
+
+	for (int i = 0; i < 6; ++i) {
+		const float* plane = frustum.planes[i];
+		__m128 nx = _mm_set1_ps(plane[0]);
+		__m128 ny = _mm_set1_ps(plane[1]);
+		__m128 nz = _mm_set1_ps(plane[2]);
+		__m128 d = _mm_set1_ps(plane[3]);
+
+		// the signs are the same for all four boxes, so picking the corners is a branch and not a blend
+		__m128 farX = plane[0] >= 0.0f ? maxX : minX;
+		__m128 farY = plane[1] >= 0.0f ? maxY : minY;
+		__m128 farZ = plane[2] >= 0.0f ? maxZ : minZ;
+		__m128 nearX = plane[0] >= 0.0f ? minX : maxX;
+		__m128 nearY = plane[1] >= 0.0f ? minY : maxY;
+		__m128 nearZ = plane[2] >= 0.0f ? minZ : maxZ;
+
+		__m128 farDistance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, farX), _mm_mul_ps(ny, farY)), _mm_mul_ps(nz, farZ)), d);
+		__m128 nearDistance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nearX), _mm_mul_ps(ny, nearY)), _mm_mul_ps(nz, nearZ)), d);
+		outsideMask = _mm_or_ps(outsideMask, _mm_cmplt_ps(farDistance, zero));
+		insideMask = _mm_and_ps(insideMask, _mm_cmpge_ps(nearDistance, zero));
+	}
+
+	outside = (uint32_t)_mm_movemask_ps(outsideMask);
+	inside = (uint32_t)_mm_movemask_ps(insideMask);
+#else
+	outside = 0;
+	inside = 0;
+	for (uint32_t lane = 0; lane < cullingBvhWidth; ++lane) {
+		float boundsMin[3] = { bounds.minX[lane], bounds.minY[lane], bounds.minZ[lane] };
+		float boundsMax[3] = { bounds.maxX[lane], bounds.maxY[lane], bounds.maxZ[lane] };
+		if (!CullingFrustumTestBox(frustum, boundsMin, boundsMax)) {
+			outside |= 1u << lane;
+			continue;
+		}
+
+		bool allInside = true;
+		for (int i = 0; i < 6; ++i) {
+			const float* plane = frustum.planes[i];
+			float x = plane[0] >= 0.0f ? boundsMin[0] : boundsMax[0];
+			float y = plane[1] >= 0.0f ? boundsMin[1] : boundsMax[1];
+			float z = plane[2] >= 0.0f ? boundsMin[2] : boundsMax[2];
+			allInside = allInside && plane[0] * x + plane[1] * y + plane[2] * z + plane[3] >= 0.0f;
+		}
+		inside |= (uint32_t)allInside << lane;
+	}
+#endif
+}
+
+// everything below child, without testing
+static uint32_t AppendSubtree(const CullingBvh& bvh, uint32_t child, uint32_t* visible, uint32_t visibleCount) {
+	if (child & cullingBvhLeafFlag) {
+		const uint32_t* objects = &bvh.leafObjects[(child & ~cullingBvhLeafFlag) * cullingBvhWidth];
+		for (uint32_t lane = 0; lane < cullingBvhWidth; ++lane) {
+			if (objects[lane] != cullingBvhEmpty)
+				visible[visibleCount++] = objects[lane];
+		}
+		return visibleCount;
+	}
+
+	const CullingBvhNode& node = bvh.nodes[child];
+	for (uint32_t slot = 0; slot < cullingBvhWidth; ++slot) {
+		if (node.children[slot] != cullingBvhEmpty)
+			visibleCount = AppendSubtree(bvh, node.children[slot], visible, visibleCount);
+	}
+	return visibleCount;
+}
+
+uint32_t CullingBvhCull(const CullingBvh& bvh, const CullingFrustum& frustum, uint32_t* visible) {
+	if (bvh.objectCount == 0)
+		return 0;
+
+	uint32_t visibleCount = 0;
+
+	// a root leaf is tested like any other
+	if (bvh.root & cullingBvhLeafFlag) {
+		uint32_t leaf = bvh.root & ~cullingBvhLeafFlag;
+		uint32_t outside, inside;
+		TestBounds4(bvh.leafBounds[leaf], frustum, outside, inside);
+		for (uint32_t lane = 0; lane < cullingBvhWidth; ++lane) {
+			uint32_t object = bvh.leafObjects[leaf * cullingBvhWidth + lane];
+			if (object != cullingBvhEmpty && !(outside & (1u << lane)))
+				visible[visibleCount++] = object;
+		}
+		return visibleCount;
+	}
+
+	uint32_t stack[cullingBvhMaxStackSize];
+	int stackSize = 0;
+	stack[stackSize++] = bvh.root;
+
+	while (stackSize > 0) {
+		const CullingBvhNode& node = bvh.nodes[stack[--stackSize]];
+
+		uint32_t outside, inside;
+		TestBounds4(node.bounds, frustum, outside, inside);
+
+		for (uint32_t slot = 0; slot < cullingBvhWidth; ++slot) {
+			uint32_t child = node.children[slot];
+			if (child == cullingBvhEmpty || (outside & (1u << slot)))
+				continue;
+
+			if (inside & (1u << slot)) {
+				visibleCount = AppendSubtree(bvh, child, visible, visibleCount);
+			}
+			else if (child & cullingBvhLeafFlag) {
+				uint32_t leaf = child & ~cullingBvhLeafFlag;
+				uint32_t leafOutside, leafInside;
+				TestBounds4(bvh.leafBounds[leaf], frustum, leafOutside, leafInside);
+
+				const uint32_t* objects = &bvh.leafObjects[leaf * cullingBvhWidth];
+				for (uint32_t lane = 0; lane < cullingBvhWidth; ++lane) {
+					if (objects[lane] != cullingBvhEmpty && !(leafOutside & (1u << lane)))
+						visible[visibleCount++] = objects[lane];
+				}
+			}
+			else {
+				stack[stackSize++] = child;
+			}
+		}
+	}
+
+	return visibleCount;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+// frustum culling of the whole scene with a bounding volume hierarchy of world space boxes
+// nodes have four children and keep their boxes side by side, one array per component, so a node's children are
+// tested against a plane with one simd operation. leaves hold four objects the same way
+// children entirely inside the frustum take their whole subtree without testing it, children outside drop it
+// moving objects only refit the boxes on the way up to the root, the tree keeps the shape it was built with, so
+// it has to be built again if objects are added or move far from where they started
+// no d3d12 dependency
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// objects per leaf and children per node
+const uint32_t cullingBvhWidth = 4;
+
+// child references, a node index or a leaf index with the flag
+const uint32_t cullingBvhLeafFlag = 0x80000000;
+// unused child slots and leaf lanes
+const uint32_t cullingBvhEmpty = 0xffffffff;
+
+// four boxes, empty ones have min above max so they are always outside
+struct CullingBounds4 {
+	float minX[cullingBvhWidth];
+	float minY[cullingBvhWidth];
+	float minZ[cullingBvhWidth];
+	float maxX[cullingBvhWidth];
+	float maxY[cullingBvhWidth];
+	float maxZ[cullingBvhWidth];
+};
+
+struct CullingBvhNode {
+	CullingBounds4 bounds;
+	uint32_t children[cullingBvhWidth];
+};
+
+struct CullingBvhStats {
+	uint32_t nodeCount;
+	uint32_t leafCount;
+	uint32_t depth;
+	// leaves refitted by the last CullingBvhRefit
+	uint32_t lastRefitLeafCount;
+};
+
+struct CullingBvh {
+	// the root is node 0, unless everything fits in one leaf
+	std::vector<CullingBvhNode> nodes;
+	uint32_t root;
+
+	std::vector<CullingBounds4> leafBounds;
+	// object in every lane of every leaf
+	std::vector<uint32_t> leafObjects;
+
+	// leaf * cullingBvhWidth + lane of every object
+	std::vector<uint32_t> objectSlots;
+	// node * cullingBvhWidth + child slot that points at a node or leaf, cullingBvhEmpty for the root
+	std::vector<uint32_t> nodeParents;
+	std::vector<uint32_t> leafParents;
+
+	// leaves with a box that changed since the last refit
+	std::vector<uint32_t> dirtyLeaves;
+	std::vector<uint8_t> leafDirty;
+
+	uint32_t objectCount;
+	CullingBvhStats stats;
+};
+
+// normalized, inside is positive: left, right, bottom, top, near, far
+struct CullingFrustum {
+	float planes[6][4];
+};
+
+// clipFromWorld is row major with clip = clipFromWorld * (x, y, z, 1), the transposed view projection the shaders
+// get. depth is in [0, w] like d3d
+void CullingFrustumInit(CullingFrustum& frustum, const float clipFromWorld[16]);
+
+// false if the box is entirely outside one of the planes, the test the hierarchy does for every box
+bool CullingFrustumTestBox(const CullingFrustum& frustum, const float boundsMin[3], const float boundsMax[3]);
+
+// box of the corners of a box in object space, matrix is row major with the translation in the last row like
+// DirectXMath's
+void TransformBounds(const float matrix[16], const float boundsMin[3], const float boundsMax[3], float transformedMin[3], float transformedMax[3]);
+
+// three floats per object each, objects keep their index
+void CullingBvhBuild(CullingBvh& bvh, const float* boundsMin, const float* boundsMax, uint32_t objectCount);
+
+// the object's box moved, it takes effect at the next refit
+void CullingBvhSetBounds(CullingBvh& bvh, uint32_t object, const float boundsMin[3], const float boundsMax[3]);
+
+// grows and shrinks the boxes above every leaf that changed
+void CullingBvhRefit(CullingBvh& bvh);
+
+// writes the objects whose box is not outside the frustum, in no particular order, and returns how many
+// visible needs room for every object
+uint32_t CullingBvhCull(const CullingBvh& bvh, const CullingFrustum& frustum, uint32_t* visible);
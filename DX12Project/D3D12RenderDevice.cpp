@@ -0,0 +1,483 @@
+#include "D3D12RenderDevice.h"
+
+#include "d3dx12.h"
+
+#define SAFE_RELEASE(x) if( x ) { x->Release(); x = NULL; }
+
+static D3D12_COMMAND_LIST_TYPE GetCommandListType(RenderCommandListType type) {
+	switch (type) {
+	case RENDER_COMMAND_LIST_COMPUTE:
+		return D3D12_COMMAND_LIST_TYPE_COMPUTE;
+	case RENDER_COMMAND_LIST_COPY:
+		return D3D12_COMMAND_LIST_TYPE_COPY;
+	default:
+		return D3D12_COMMAND_LIST_TYPE_DIRECT;
+	}
+}
+
+static D3D12_HEAP_TYPE GetHeapType(RenderHeapType heapType) {
+	switch (heapType) {
+	case RENDER_HEAP_UPLOAD:
+		return D3D12_HEAP_TYPE_UPLOAD;
+	case RENDER_HEAP_READBACK:
+		return D3D12_HEAP_TYPE_READBACK;
+	default:
+		return D3D12_HEAP_TYPE_DEFAULT;
+	}
+}
+
+static D3D12_CPU_DESCRIPTOR_HANDLE GetCpuHandle(RenderDescriptor descriptor) {
+	D3D12_CPU_DESCRIPTOR_HANDLE handle;
+	handle.ptr = (SIZE_T)descriptor.cpuHandle;
+	return handle;
+}
+
+static D3D12_GPU_DESCRIPTOR_HANDLE GetGpuHandle(RenderDescriptor descriptor) {
+	D3D12_GPU_DESCRIPTOR_HANDLE handle;
+	handle.ptr = descriptor.gpuHandle;
+	return handle;
+}
+
+static ID3D12GraphicsCommandList* GetList(void* list) {
+	return static_cast<D3D12RenderCommandList*>(list)->list;
+}
+
+// device objects
+
+static bool CreateBuffer(void* context, RenderHeapType heapType, uint64_t size, uint32_t initialState, RenderBuffer& buffer) {
+	D3D12RenderDevice* d3dRenderDevice = static_cast<D3D12RenderDevice*>(context);
+
+	GpuAllocation* allocation = new GpuAllocation;
+	HRESULT hr = GpuHeapAllocatorCreateBuffer(*d3dRenderDevice->heapAllocator, GetHeapType(heapType), size, (D3D12_RESOURCE_STATES)initialState, *allocation);
+	if (FAILED(hr)) {
+		delete allocation;
+		return false;
+	}
+
+	buffer.resource = allocation->resource;
+	buffer.offset = allocation->offset;
+	buffer.gpuAddress = allocation->gpuAddress;
+	buffer.cpuAddress = nullptr;
+	buffer.size = size;
+	buffer.backendData = allocation;
+
+	if (heapType == RENDER_HEAP_DEFAULT)
+		return true;
+
+	// upload buffers are never read by the cpu, readback buffers can be read anywhere
+	CD3DX12_RANGE emptyRange(0, 0);
+	uint8_t* cpuAddress;
+	hr = allocation->resource->Map(0, heapType == RENDER_HEAP_UPLOAD ? &emptyRange : nullptr, reinterpret_cast<void**>(&cpuAddress));
+	if (FAILED(hr)) {
+		GpuHeapAllocatorFree(*d3dRenderDevice->heapAllocator, *allocation);
+		delete allocation;
+		buffer.resource = nullptr;
+		buffer.backendData = nullptr;
+		return false;
+	}
+
+	buffer.cpuAddress = cpuAddress + allocation->offset;
+	return true;
+}
+
+static void DestroyBuffer(void* context, RenderBuffer& buffer) {
+	D3D12RenderDevice* d3dRenderDevice = static_cast<D3D12RenderDevice*>(context);
+	GpuAllocation* allocation = static_cast<GpuAllocation*>(buffer.backendData);
+
+	GpuHeapAllocatorFree(*d3dRenderDevice->heapAllocator, *allocation);
+	delete allocation;
+}
+
+static void DestroyCommandList(void* context, void* list) {
+	(void)context;
+	D3D12RenderCommandList* d3dList = static_cast<D3D12RenderCommandList*>(list);
+
+	SAFE_RELEASE(d3dList->meshList);
+	SAFE_RELEASE(d3dList->list);
+	for (uint32_t i = 0; i < d3dList->allocatorCount; ++i)
+		SAFE_RELEASE(d3dList->allocators[i]);
+
+	delete d3dList;
+}
+
+static bool CreateCommandList(void* context, RenderCommandListType type, uint32_t allocatorCount, void*& list) {
+	D3D12RenderDevice* d3dRenderDevice = static_cast<D3D12RenderDevice*>(context);
+	D3D12_COMMAND_LIST_TYPE listType = GetCommandListType(type);
+	HRESULT hr;
+
+	D3D12RenderCommandList* d3dList = new D3D12RenderCommandList;
+	d3dList->list = nullptr;
+	d3dList->meshList = nullptr;
+	d3dList->allocatorCount = 0;
+
+	for (uint32_t i = 0; i < allocatorCount; ++i) {
+		hr = d3dRenderDevice->d3dDevice->CreateCommandAllocator(listType, IID_PPV_ARGS(&d3dList->allocators[i]));
+		if (FAILED(hr)) {
+			DestroyCommandList(context, d3dList);
+			return false;
+		}
+		d3dList->allocatorCount++;
+	}
+
+	hr = d3dRenderDevice->d3dDevice->CreateCommandList(0, listType, d3dList->allocators[0], nullptr, IID_PPV_ARGS(&d3dList->list));
+	if (FAILED(hr)) {
+		DestroyCommandList(context, d3dList);
+		return false;
+	}
+
+	// lists are created in the recording state
+	d3dList->list->Close();
+
+	// fails without mesh shader support, DispatchMesh is not used then
+	if (FAILED(d3dList->list->QueryInterface(IID_PPV_ARGS(&d3dList->meshList))))
+		d3dList->meshList = nullptr;
+
+	list = d3dList;
+	return true;
+}
+
+static bool CreateQueue(void* context, RenderCommandListType type, void*& queue) {
+	D3D12RenderDevice* d3dRenderDevice = static_cast<D3D12RenderDevice*>(context);
+
+	D3D12_COMMAND_QUEUE_DESC desc = {};
+	desc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+	desc.Type = GetCommandListType(type);
+
+	ID3D12CommandQueue* d3dQueue;
+	HRESULT hr = d3dRenderDevice->d3dDevice->CreateCommandQueue(&desc, IID_PPV_ARGS(&d3dQueue));
+	if (FAILED(hr))
+		return false;
+
+	D3D12RenderQueue* renderQueue = new D3D12RenderQueue;
+	renderQueue->queue = d3dQueue;
+	renderQueue->owned = true;
+
+	queue = renderQueue;
+	return true;
+}
+
+static void DestroyQueue(void* context, void* queue) {
+	(void)context;
+	D3D12RenderQueue* renderQueue = static_cast<D3D12RenderQueue*>(queue);
+
+	if (renderQueue->owned)
+		SAFE_RELEASE(renderQueue->queue);
+
+	delete renderQueue;
+}
+
+static bool CreateFence(void* context, uint64_t initialValue, void*& fence) {
+	D3D12RenderDevice* d3dRenderDevice = static_cast<D3D12RenderDevice*>(context);
+
+	ID3D12Fence* d3dFence;
+	HRESULT hr = d3dRenderDevice->d3dDevice->CreateFence(initialValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&d3dFence));
+	if (FAILED(hr))
+		return false;
+
+	HANDLE event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	if (event == nullptr) {
+		d3dFence->Release();
+		return false;
+	}
+
+	D3D12RenderFence* renderFence = new D3D12RenderFence;
+	renderFence->fence = d3dFence;
+	renderFence->owned = true;
+	renderFence->event = event;
+
+	fence = renderFence;
+	return true;
+}
+
+static void DestroyFence(void* context, void* fence) {
+	(void)context;
+	D3D12RenderFence* renderFence = static_cast<D3D12RenderFence*>(fence);
+
+	if (renderFence->owned)
+		SAFE_RELEASE(renderFence->fence);
+	CloseHandle(renderFence->event);
+
+	delete renderFence;
+}
+
+// queues and fences
+
+static void ExecuteCommandLists(void* queue, void* const* lists, uint32_t count) {
+	D3D12RenderQueue* renderQueue = static_cast<D3D12RenderQueue*>(queue);
+
+	renderQueue->lists.resize(count);
+	for (uint32_t i = 0; i < count; ++i)
+		renderQueue->lists[i] = GetList(lists[i]);
+
+	renderQueue->queue->ExecuteCommandLists(count, renderQueue->lists.data());
+}
+
+static bool Signal(void* queue, void* fence, uint64_t value) {
+	return SUCCEEDED(static_cast<D3D12RenderQueue*>(queue)->queue->Signal(static_cast<D3D12RenderFence*>(fence)->fence, value));
+}
+
+static bool Wait(void* queue, void* fence, uint64_t value) {
+	return SUCCEEDED(static_cast<D3D12RenderQueue*>(queue)->queue->Wait(static_cast<D3D12RenderFence*>(fence)->fence, value));
+}
+
+static uint64_t GetCompletedValue(void* fence) {
+	return static_cast<D3D12RenderFence*>(fence)->fence->GetCompletedValue();
+}
+
+static bool WaitForValue(void* fence, uint64_t value) {
+	D3D12RenderFence* renderFence = static_cast<D3D12RenderFence*>(fence);
+
+	if (renderFence->fence->GetCompletedValue() >= value)
+		return true;
+
+	if (FAILED(renderFence->fence->SetEventOnCompletion(value, renderFence->event)))
+		return false;
+
+	WaitForSingleObject(renderFence->event, INFINITE);
+	return true;
+}
+
+// command lists
+
+static bool Reset(void* list, uint32_t allocator, void* pipelineState) {
+	D3D12RenderCommandList* d3dList = static_cast<D3D12RenderCommandList*>(list);
+	if (allocator >= d3dList->allocatorCount)
+		return false;
+
+	if (FAILED(d3dList->allocators[allocator]->Reset()))
+		return false;
+
+	return SUCCEEDED(d3dList->list->Reset(d3dList->allocators[allocator], static_cast<ID3D12PipelineState*>(pipelineState)));
+}
+
+static bool Close(void* list) {
+	return SUCCEEDED(GetList(list)->Close());
+}
+
+static void SetPipelineState(void* list, void* pipelineState) {
+	GetList(list)->SetPipelineState(static_cast<ID3D12PipelineState*>(pipelineState));
+}
+
+static void SetRootSignature(void* list, RenderBindPoint bindPoint, void* rootSignature) {
+	ID3D12RootSignature* d3dRootSignature = static_cast<ID3D12RootSignature*>(rootSignature);
+
+	if (bindPoint == RENDER_BIND_GRAPHICS)
+		GetList(list)->SetGraphicsRootSignature(d3dRootSignature);
+	else
+		GetList(list)->SetComputeRootSignature(d3dRootSignature);
+}
+
+static void SetRootConstantBuffer(void* list, RenderBindPoint bindPoint, uint32_t index, uint64_t gpuAddress) {
+	if (bindPoint == RENDER_BIND_GRAPHICS)
+		GetList(list)->SetGraphicsRootConstantBufferView(index, gpuAddress);
+	else
+		GetList(list)->SetComputeRootConstantBufferView(index, gpuAddress);
+}
+
+static void SetRootShaderResource(void* list, RenderBindPoint bindPoint, uint32_t index, uint64_t gpuAddress) {
+	if (bindPoint == RENDER_BIND_GRAPHICS)
+		GetList(list)->SetGraphicsRootShaderResourceView(index, gpuAddress);
+	else
+		GetList(list)->SetComputeRootShaderResourceView(index, gpuAddress);
+}
+
+static void SetRootUnorderedAccess(void* list, RenderBindPoint bindPoint, uint32_t index, uint64_t gpuAddress) {
+	if (bindPoint == RENDER_BIND_GRAPHICS)
+		GetList(list)->SetGraphicsRootUnorderedAccessView(index, gpuAddress);
+	else
+		GetList(list)->SetComputeRootUnorderedAccessView(index, gpuAddress);
+}
+
+static void SetRootConstants(void* list, RenderBindPoint bindPoint, uint32_t index, uint32_t count, const void* data, uint32_t offset) {
+	if (bindPoint == RENDER_BIND_GRAPHICS)
+		GetList(list)->SetGraphicsRoot32BitConstants(index, count, data, offset);
+	else
+		GetList(list)->SetComputeRoot32BitConstants(index, count, data, offset);
+}
+
+static void SetRootDescriptorTable(void* list, RenderBindPoint bindPoint, uint32_t index, RenderDescriptor table) {
+	if (bindPoint == RENDER_BIND_GRAPHICS)
+		GetList(list)->SetGraphicsRootDescriptorTable(index, GetGpuHandle(table));
+	else
+		GetList(list)->SetComputeRootDescriptorTable(index, GetGpuHandle(table));
+}
+
+static void SetDescriptorHeap(void* list, void* heap) {
+	ID3D12DescriptorHeap* descriptorHeaps[] = { static_cast<ID3D12DescriptorHeap*>(heap) };
+	GetList(list)->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
+}
+
+static void SetRenderTarget(void* list, RenderDescriptor renderTarget, RenderDescriptor depthStencil) {
+	D3D12_CPU_DESCRIPTOR_HANDLE renderTargetHandle = GetCpuHandle(renderTarget);
+	D3D12_CPU_DESCRIPTOR_HANDLE depthStencilHandle = GetCpuHandle(depthStencil);
+
+	GetList(list)->OMSetRenderTargets(1, &renderTargetHandle, FALSE, depthStencil.cpuHandle != 0 ? &depthStencilHandle : nullptr);
+}
+
+static void SetViewport(void* list, const RenderViewport& viewport) {
+	D3D12_VIEWPORT d3dViewport = { viewport.x, viewport.y, viewport.width, viewport.height, viewport.minDepth, viewport.maxDepth };
+	GetList(list)->RSSetViewports(1, &d3dViewport);
+}
+
+static void SetScissorRect(void* list, const RenderRect& rect) {
+	D3D12_RECT d3dRect = { rect.left, rect.top, rect.right, rect.bottom };
+	GetList(list)->RSSetScissorRects(1, &d3dRect);
+}
+
+static void SetPrimitiveTopology(void* list, uint32_t topology) {
+	GetList(list)->IASetPrimitiveTopology((D3D_PRIMITIVE_TOPOLOGY)topology);
+}
+
+static void SetVertexBuffer(void* list, const RenderVertexBufferView& view) {
+	D3D12_VERTEX_BUFFER_VIEW d3dView = { view.gpuAddress, view.size, view.stride };
+	GetList(list)->IASetVertexBuffers(0, 1, &d3dView);
+}
+
+static void SetIndexBuffer(void* list, const RenderIndexBufferView& view) {
+	D3D12_INDEX_BUFFER_VIEW d3dView = { view.gpuAddress, view.size, (DXGI_FORMAT)view.format };
+	GetList(list)->IASetIndexBuffer(&d3dView);
+}
+
+static void ClearRenderTarget(void* list, RenderDescriptor renderTarget, const float color[4]) {
+	GetList(list)->ClearRenderTargetView(GetCpuHandle(renderTarget), color, 0, nullptr);
+}
+
+static void ClearDepth(void* list, RenderDescriptor depthStencil, float depth) {
+	GetList(list)->ClearDepthStencilView(GetCpuHandle(depthStencil), D3D12_CLEAR_FLAG_DEPTH, depth, 0, 0, nullptr);
+}
+
+static void DrawIndexedInstanced(void* list, uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance) {
+	GetList(list)->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+static void Dispatch(void* list, uint32_t x, uint32_t y, uint32_t z) {
+	GetList(list)->Dispatch(x, y, z);
+}
+
+static void DispatchMesh(void* list, uint32_t x, uint32_t y, uint32_t z) {
+	static_cast<D3D12RenderCommandList*>(list)->meshList->DispatchMesh(x, y, z);
+}
+
+static void ExecuteIndirect(void* list, void* commandSignature, uint32_t maxCount, void* argumentResource, uint64_t argumentOffset, void* countResource, uint64_t countOffset) {
+	GetList(list)->ExecuteIndirect(
+		static_cast<ID3D12CommandSignature*>(commandSignature),
+		maxCount,
+		static_cast<ID3D12Resource*>(argumentResource),
+		argumentOffset,
+		static_cast<ID3D12Resource*>(countResource),
+		countOffset);
+}
+
+static void CopyBufferRegion(void* list, void* destination, uint64_t destinationOffset, void* source, uint64_t sourceOffset, uint64_t size) {
+	GetList(list)->CopyBufferRegion(static_cast<ID3D12Resource*>(destination), destinationOffset, static_cast<ID3D12Resource*>(source), sourceOffset, size);
+}
+
+static void Barriers(void* list, const RenderBarrier* barriers, uint32_t count) {
+	D3D12RenderCommandList* d3dList = static_cast<D3D12RenderCommandList*>(list);
+
+	d3dList->barriers.resize(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		const RenderBarrier& barrier = barriers[i];
+		ID3D12Resource* resource = static_cast<ID3D12Resource*>(barrier.resource);
+
+		if (barrier.type == RENDER_BARRIER_ALIASING) {
+			d3dList->barriers[i] = CD3DX12_RESOURCE_BARRIER::Aliasing(static_cast<ID3D12Resource*>(barrier.resourceBefore), resource);
+			continue;
+		}
+
+		d3dList->barriers[i] = CD3DX12_RESOURCE_BARRIER::Transition(
+			resource,
+			(D3D12_RESOURCE_STATES)barrier.stateBefore,
+			(D3D12_RESOURCE_STATES)barrier.stateAfter,
+			barrier.subresource,
+			(D3D12_RESOURCE_BARRIER_FLAGS)barrier.flag);
+	}
+
+	d3dList->list->ResourceBarrier(count, d3dList->barriers.data());
+}
+
+static const RenderDeviceFunctions d3d12RenderFunctions = {
+	CreateBuffer,
+	DestroyBuffer,
+	CreateCommandList,
+	DestroyCommandList,
+	CreateQueue,
+	DestroyQueue,
+	CreateFence,
+	DestroyFence,
+
+	ExecuteCommandLists,
+	Signal,
+	Wait,
+
+	GetCompletedValue,
+	WaitForValue,
+
+	Reset,
+	Close,
+
+	SetPipelineState,
+	SetRootSignature,
+	SetRootConstantBuffer,
+	SetRootShaderResource,
+	SetRootUnorderedAccess,
+	SetRootConstants,
+	SetRootDescriptorTable,
+	SetDescriptorHeap,
+
+	SetRenderTarget,
+	SetViewport,
+	SetScissorRect,
+	SetPrimitiveTopology,
+	SetVertexBuffer,
+	SetIndexBuffer,
+
+	ClearRenderTarget,
+	ClearDepth,
+
+	DrawIndexedInstanced,
+	Dispatch,
+	DispatchMesh,
+	ExecuteIndirect,
+	CopyBufferRegion,
+	Barriers,
+};
+
+void D3D12RenderDeviceInit(D3D12RenderDevice& d3dRenderDevice, ID3D12Device* d3dDevice, GpuHeapAllocator* heapAllocator) {
+	RenderDeviceInit(d3dRenderDevice.device, &d3d12RenderFunctions, &d3dRenderDevice);
+	d3dRenderDevice.d3dDevice = d3dDevice;
+	d3dRenderDevice.heapAllocator = heapAllocator;
+}
+
+bool D3D12RenderWrapQueue(D3D12RenderDevice& d3dRenderDevice, ID3D12CommandQueue* queue, RenderQueue& renderQueue) {
+	D3D12RenderQueue* d3dQueue = new D3D12RenderQueue;
+	d3dQueue->queue = queue;
+	d3dQueue->owned = false;
+
+	renderQueue.device = &d3dRenderDevice.device;
+	renderQueue.queue = d3dQueue;
+	return true;
+}
+
+bool D3D12RenderWrapFence(D3D12RenderDevice& d3dRenderDevice, ID3D12Fence* fence, RenderFence& renderFence) {
+	HANDLE event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	if (event == nullptr)
+		return false;
+
+	D3D12RenderFence* d3dFence = new D3D12RenderFence;
+	d3dFence->fence = fence;
+	d3dFence->owned = false;
+	d3dFence->event = event;
+
+	renderFence.device = &d3dRenderDevice.device;
+	renderFence.fence = d3dFence;
+	return true;
+}
+
+ID3D12GraphicsCommandList* D3D12RenderGetCommandList(const RenderCommandList& list) {
+	return GetList(list.list);
+}
+
+ID3D12CommandQueue* D3D12RenderGetQueue(const RenderQueue& queue) {
+	return static_cast<D3D12RenderQueue*>(queue.queue)->queue;
+}
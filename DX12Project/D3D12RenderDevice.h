@@ -0,0 +1,61 @@
+#pragma once
+
+// render device backend that forwards every call to d3d12
+// buffers come from the heap allocator, command lists own an allocator per frame in flight, and queues and fences
+// made elsewhere (the swap chain needs the graphics queue before the device exists) can be wrapped
+// a list of a device with mesh shader support also keeps its ID3D12GraphicsCommandList6 for DispatchMesh
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#include <windows.h>
+#include <d3d12.h>
+
+#include <vector>
+
+#include "GpuHeapAllocator.h"
+#include "RenderDevice.h"
+
+struct D3D12RenderCommandList {
+	ID3D12GraphicsCommandList* list;
+	// null if the device has no mesh shaders
+	ID3D12GraphicsCommandList6* meshList;
+	ID3D12CommandAllocator* allocators[renderMaxAllocators];
+	uint32_t allocatorCount;
+	// converted barriers, reused by every call
+	std::vector<D3D12_RESOURCE_BARRIER> barriers;
+};
+
+struct D3D12RenderQueue {
+	ID3D12CommandQueue* queue;
+	// wrapped queues belong to whoever made them
+	bool owned;
+	// ExecuteCommandLists takes the d3d12 lists
+	std::vector<ID3D12CommandList*> lists;
+};
+
+struct D3D12RenderFence {
+	ID3D12Fence* fence;
+	bool owned;
+	// cpu waits sleep on it
+	HANDLE event;
+};
+
+struct D3D12RenderDevice {
+	// what the frame building code uses, it points back at this so this has to stay where it is
+	RenderDevice device;
+
+	ID3D12Device* d3dDevice;
+	GpuHeapAllocator* heapAllocator;
+};
+
+void D3D12RenderDeviceInit(D3D12RenderDevice& d3dRenderDevice, ID3D12Device* d3dDevice, GpuHeapAllocator* heapAllocator);
+
+// the queue and fence stay alive until RenderDeviceDestroyQueue and RenderDeviceDestroyFence, which do not release them
+bool D3D12RenderWrapQueue(D3D12RenderDevice& d3dRenderDevice, ID3D12CommandQueue* queue, RenderQueue& renderQueue);
+bool D3D12RenderWrapFence(D3D12RenderDevice& d3dRenderDevice, ID3D12Fence* fence, RenderFence& renderFence);
+
+// for what still takes d3d12 objects (gpu profiler, texture loader)
+ID3D12GraphicsCommandList* D3D12RenderGetCommandList(const RenderCommandList& list);
+ID3D12CommandQueue* D3D12RenderGetQueue(const RenderQueue& queue);
@@ -0,0 +1,237 @@
+#include "DdsFile.h"
+
+#include <cstring>
+
+const uint32_t ddsMagic = 0x20534444; // "DDS "
+const uint32_t ddsHeaderSize = 124;
+const uint32_t ddsPixelFormatSize = 32;
+const uint32_t ddsDx10HeaderSize = 20;
+
+// offsets into the header, which starts right after the magic
+const size_t ddsHeaderFlagsOffset = 4;
+const size_t ddsHeaderHeightOffset = 8;
+const size_t ddsHeaderWidthOffset = 12;
+const size_t ddsHeaderPitchOffset = 16;
+const size_t ddsHeaderMipCountOffset = 24;
+const size_t ddsPixelFormatOffset = 72;
+const size_t ddsCapsOffset = 104;
+const size_t ddsCaps2Offset = 108;
+
+// header flags
+const uint32_t ddsdCaps = 0x1;
+const uint32_t ddsdHeight = 0x2;
+const uint32_t ddsdWidth = 0x4;
+const uint32_t ddsdPitch = 0x8;
+const uint32_t ddsdPixelFormat = 0x1000;
+const uint32_t ddsdMipMapCount = 0x20000;
+const uint32_t ddsdLinearSize = 0x80000;
+
+// pixel format flags
+const uint32_t ddpfFourCC = 0x4;
+const uint32_t ddpfRgb = 0x40;
+
+const uint32_t ddsCapsComplex = 0x8;
+const uint32_t ddsCapsTexture = 0x1000;
+const uint32_t ddsCapsMipMap = 0x400000;
+
+const uint32_t ddsCaps2Cubemap = 0x200;
+const uint32_t ddsCaps2Volume = 0x200000;
+
+const uint32_t ddsDimensionTexture2D = 3;
+const uint32_t ddsMiscTextureCube = 0x4;
+
+// more levels than a 2^32 texture can have means a broken file
+const uint32_t maxDdsMipCount = 32;
+
+static uint32_t MakeFourCC(char a, char b, char c, char d) {
+	return (uint32_t)(uint8_t)a | ((uint32_t)(uint8_t)b << 8) | ((uint32_t)(uint8_t)c << 16) | ((uint32_t)(uint8_t)d << 24);
+}
+
+static uint32_t ReadU32(const uint8_t* data) {
+	return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static void WriteU32(uint8_t* data, uint32_t value) {
+	data[0] = (uint8_t)value;
+	data[1] = (uint8_t)(value >> 8);
+	data[2] = (uint8_t)(value >> 16);
+	data[3] = (uint8_t)(value >> 24);
+}
+
+bool IsDdsFormatBlockCompressed(DdsFormat format) {
+	return format == DDS_FORMAT_BC1_UNORM || format == DDS_FORMAT_BC3_UNORM || format == DDS_FORMAT_BC4_UNORM ||
+		format == DDS_FORMAT_BC5_UNORM || format == DDS_FORMAT_BC7_UNORM;
+}
+
+BlockFormat GetBlockFormatFromDdsFormat(DdsFormat format) {
+	switch (format) {
+	case DDS_FORMAT_BC3_UNORM: return BLOCK_FORMAT_BC3;
+	case DDS_FORMAT_BC4_UNORM: return BLOCK_FORMAT_BC4;
+	case DDS_FORMAT_BC5_UNORM: return BLOCK_FORMAT_BC5;
+	case DDS_FORMAT_BC7_UNORM: return BLOCK_FORMAT_BC7;
+	default: return BLOCK_FORMAT_BC1;
+	}
+}
+
+DdsFormat GetDdsFormatFromBlockFormat(BlockFormat format) {
+	switch (format) {
+	case BLOCK_FORMAT_BC1: return DDS_FORMAT_BC1_UNORM;
+	case BLOCK_FORMAT_BC3: return DDS_FORMAT_BC3_UNORM;
+	case BLOCK_FORMAT_BC4: return DDS_FORMAT_BC4_UNORM;
+	case BLOCK_FORMAT_BC5: return DDS_FORMAT_BC5_UNORM;
+	case BLOCK_FORMAT_BC7: return DDS_FORMAT_BC7_UNORM;
+	}
+	return DDS_FORMAT_UNKNOWN;
+}
+
+bool GetDdsSurfaceInfo(DdsFormat format, uint32_t width, uint32_t height, size_t& rowPitch, uint32_t& rowCount) {
+	if (IsDdsFormatBlockCompressed(format)) {
+		GetBlockSurfaceInfo(GetBlockFormatFromDdsFormat(format), width, height, rowPitch, rowCount);
+		return true;
+	}
+
+	if (format == DDS_FORMAT_R8G8B8A8_UNORM || format == DDS_FORMAT_B8G8R8A8_UNORM) {
+		rowPitch = (size_t)width * 4;
+		rowCount = height;
+		return true;
+	}
+
+	return false;
+}
+
+bool DdsImageInit(DdsImage& image, DdsFormat format, uint32_t width, uint32_t height, uint32_t mipCount) {
+	if (width == 0 || height == 0 || mipCount == 0 || mipCount > maxDdsMipCount)
+		return false;
+
+	image.format = format;
+	image.width = width;
+	image.height = height;
+	image.levels.resize(mipCount);
+
+	size_t offset = 0;
+	for (uint32_t i = 0; i < mipCount; ++i) {
+		DdsLevel& level = image.levels[i];
+		level.width = width;
+		level.height = height;
+		level.offset = offset;
+
+		if (!GetDdsSurfaceInfo(format, width, height, level.rowPitch, level.rowCount))
+			return false;
+
+		offset += level.rowPitch * level.rowCount;
+
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+
+	image.data.resize(offset);
+	return true;
+}
+
+// format of a header without the dx10 extension
+static DdsFormat GetLegacyDdsFormat(const uint8_t* pixelFormat) {
+	uint32_t flags = ReadU32(pixelFormat + 4);
+
+	if (flags & ddpfFourCC) {
+		uint32_t fourCC = ReadU32(pixelFormat + 8);
+		if (fourCC == MakeFourCC('D', 'X', 'T', '1')) return DDS_FORMAT_BC1_UNORM;
+		if (fourCC == MakeFourCC('D', 'X', 'T', '5')) return DDS_FORMAT_BC3_UNORM;
+		if (fourCC == MakeFourCC('A', 'T', 'I', '1') || fourCC == MakeFourCC('B', 'C', '4', 'U')) return DDS_FORMAT_BC4_UNORM;
+		if (fourCC == MakeFourCC('A', 'T', 'I', '2') || fourCC == MakeFourCC('B', 'C', '5', 'U')) return DDS_FORMAT_BC5_UNORM;
+		return DDS_FORMAT_UNKNOWN;
+	}
+
+	if ((flags & ddpfRgb) && ReadU32(pixelFormat + 12) == 32) {
+		uint32_t redMask = ReadU32(pixelFormat + 16);
+		if (redMask == 0x000000ff) return DDS_FORMAT_R8G8B8A8_UNORM;
+		if (redMask == 0x00ff0000) return DDS_FORMAT_B8G8R8A8_UNORM;
+	}
+
+	return DDS_FORMAT_UNKNOWN;
+}
+
+bool ReadDds(const uint8_t* file, size_t fileSize, DdsImage& image) {
+	if (fileSize < 4 + ddsHeaderSize || ReadU32(file) != ddsMagic)
+		return false;
+
+	const uint8_t* header = file + 4;
+	if (ReadU32(header) != ddsHeaderSize || ReadU32(header + ddsPixelFormatOffset) != ddsPixelFormatSize)
+		return false;
+
+	// cube maps and volumes are not supported
+	if (ReadU32(header + ddsCaps2Offset) & (ddsCaps2Cubemap | ddsCaps2Volume))
+		return false;
+
+	uint32_t flags = ReadU32(header + ddsHeaderFlagsOffset);
+	uint32_t width = ReadU32(header + ddsHeaderWidthOffset);
+	uint32_t height = ReadU32(header + ddsHeaderHeightOffset);
+	uint32_t mipCount = (flags & ddsdMipMapCount) ? ReadU32(header + ddsHeaderMipCountOffset) : 1;
+	if (mipCount == 0)
+		mipCount = 1;
+
+	const uint8_t* pixelFormat = header + ddsPixelFormatOffset;
+	size_t dataOffset = 4 + ddsHeaderSize;
+	DdsFormat format;
+
+	if ((ReadU32(pixelFormat + 4) & ddpfFourCC) && ReadU32(pixelFormat + 8) == MakeFourCC('D', 'X', '1', '0')) {
+		if (fileSize < dataOffset + ddsDx10HeaderSize)
+			return false;
+
+		const uint8_t* dx10Header = file + dataOffset;
+		format = (DdsFormat)ReadU32(dx10Header);
+
+		// one 2d texture, no arrays
+		if (ReadU32(dx10Header + 4) != ddsDimensionTexture2D || (ReadU32(dx10Header + 8) & ddsMiscTextureCube) || ReadU32(dx10Header + 12) > 1)
+			return false;
+
+		dataOffset += ddsDx10HeaderSize;
+	}
+	else {
+		format = GetLegacyDdsFormat(pixelFormat);
+	}
+
+	if (!DdsImageInit(image, format, width, height, mipCount))
+		return false;
+
+	if (fileSize - dataOffset < image.data.size())
+		return false;
+
+	memcpy(&image.data[0], file + dataOffset, image.data.size());
+	return true;
+}
+
+void WriteDds(const DdsImage& image, std::vector<uint8_t>& file) {
+	size_t dataOffset = 4 + ddsHeaderSize + ddsDx10HeaderSize;
+
+	file.assign(dataOffset + image.data.size(), 0);
+
+	WriteU32(&file[0], ddsMagic);
+
+	uint8_t* header = &file[4];
+	bool blockCompressed = IsDdsFormatBlockCompressed(image.format);
+
+	WriteU32(header, ddsHeaderSize);
+	WriteU32(header + ddsHeaderFlagsOffset, ddsdCaps | ddsdHeight | ddsdWidth | ddsdPixelFormat | ddsdMipMapCount | (blockCompressed ? ddsdLinearSize : ddsdPitch));
+	WriteU32(header + ddsHeaderHeightOffset, image.height);
+	WriteU32(header + ddsHeaderWidthOffset, image.width);
+	// size of the top level for block formats, row pitch otherwise
+	WriteU32(header + ddsHeaderPitchOffset, (uint32_t)(blockCompressed ? image.levels[0].rowPitch * image.levels[0].rowCount : image.levels[0].rowPitch));
+	WriteU32(header + ddsHeaderMipCountOffset, (uint32_t)image.levels.size());
+
+	uint8_t* pixelFormat = header + ddsPixelFormatOffset;
+	WriteU32(pixelFormat, ddsPixelFormatSize);
+	WriteU32(pixelFormat + 4, ddpfFourCC);
+	WriteU32(pixelFormat + 8, MakeFourCC('D', 'X', '1', '0'));
+
+	WriteU32(header + ddsCapsOffset, ddsCapsTexture | (image.levels.size() > 1 ? ddsCapsComplex | ddsCapsMipMap : 0));
+
+	uint8_t* dx10Header = &file[4 + ddsHeaderSize];
+	WriteU32(dx10Header, (uint32_t)image.format);
+	WriteU32(dx10Header + 4, ddsDimensionTexture2D);
+	WriteU32(dx10Header + 8, 0);
+	WriteU32(dx10Header + 12, 1);
+	WriteU32(dx10Header + 16, 0);
+
+	if (!image.data.empty())
+		memcpy(&file[dataOffset], &image.data[0], image.data.size());
+}
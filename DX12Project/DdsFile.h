@@ -0,0 +1,54 @@
+#pragma once
+
+// reading and writing dds files in memory, 2d textures with mips only
+// files are always written with the dx10 header, the older fourcc headers of bc1 to bc5 can be read as well
+// no d3d12 dependency, file io is left to the caller
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "BlockCompression.h"
+
+// same values as DXGI_FORMAT so they can be cast to it
+enum DdsFormat {
+	DDS_FORMAT_UNKNOWN = 0,
+	DDS_FORMAT_R8G8B8A8_UNORM = 28,
+	DDS_FORMAT_BC1_UNORM = 71,
+	DDS_FORMAT_BC3_UNORM = 77,
+	DDS_FORMAT_BC4_UNORM = 80,
+	DDS_FORMAT_BC5_UNORM = 83,
+	DDS_FORMAT_B8G8R8A8_UNORM = 87,
+	DDS_FORMAT_BC7_UNORM = 98,
+};
+
+struct DdsLevel {
+	uint32_t width;
+	uint32_t height;
+	// rows of blocks for block compressed formats
+	size_t rowPitch;
+	uint32_t rowCount;
+	size_t offset;
+};
+
+struct DdsImage {
+	DdsFormat format;
+	uint32_t width;
+	uint32_t height;
+	std::vector<DdsLevel> levels;
+	// every level tightly packed, largest first
+	std::vector<uint8_t> data;
+};
+
+// returns false for formats this file does not know
+bool GetDdsSurfaceInfo(DdsFormat format, uint32_t width, uint32_t height, size_t& rowPitch, uint32_t& rowCount);
+
+bool IsDdsFormatBlockCompressed(DdsFormat format);
+BlockFormat GetBlockFormatFromDdsFormat(DdsFormat format);
+DdsFormat GetDdsFormatFromBlockFormat(BlockFormat format);
+
+// lays out mipCount levels and sizes the data to fit
+bool DdsImageInit(DdsImage& image, DdsFormat format, uint32_t width, uint32_t height, uint32_t mipCount);
+
+bool ReadDds(const uint8_t* file, size_t fileSize, DdsImage& image);
+void WriteDds(const DdsImage& image, std::vector<uint8_t>& file);
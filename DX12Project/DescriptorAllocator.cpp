@@ -0,0 +1,111 @@
+#include "DescriptorAllocator.h"
+
+void DescriptorFreeListInit(DescriptorFreeList& list, uint32_t capacity) {
+	list.capacity = capacity;
+
+	list.freeIndices.resize(capacity);
+	for (uint32_t i = 0; i < capacity; ++i)
+		list.freeIndices[i] = capacity - 1 - i;
+
+	list.retired.clear();
+	list.allocatedCount = 0;
+	list.peakAllocatedCount = 0;
+}
+
+bool DescriptorFreeListAllocate(DescriptorFreeList& list, uint32_t& index) {
+	if (list.freeIndices.empty())
+		return false;
+
+	index = list.freeIndices.back();
+	list.freeIndices.pop_back();
+
+	++list.allocatedCount;
+	if (list.allocatedCount > list.peakAllocatedCount)
+		list.peakAllocatedCount = list.allocatedCount;
+
+	return true;
+}
+
+void DescriptorFreeListFree(DescriptorFreeList& list, uint32_t index, uint64_t fenceValue) {
+	if (index >= list.capacity)
+		return;
+
+	--list.allocatedCount;
+
+	if (fenceValue == 0) {
+		list.freeIndices.push_back(index);
+		return;
+	}
+
+	DescriptorRetired retired;
+	retired.index = index;
+	retired.fenceValue = fenceValue;
+	list.retired.push_back(retired);
+}
+
+void DescriptorFreeListReclaim(DescriptorFreeList& list, uint64_t completedFenceValue) {
+	while (!list.retired.empty() && list.retired.front().fenceValue <= completedFenceValue) {
+		list.freeIndices.push_back(list.retired.front().index);
+		list.retired.pop_front();
+	}
+}
+
+void DescriptorRingInit(DescriptorRing& ring, uint32_t capacity) {
+	ring.capacity = capacity;
+	ring.head = 0;
+	ring.tail = 0;
+	ring.frames.clear();
+	ring.frameDescriptorCount = 0;
+	ring.peakFrameDescriptorCount = 0;
+}
+
+bool DescriptorRingAllocate(DescriptorRing& ring, uint32_t count, uint32_t& first) {
+	if (count == 0 || count > ring.capacity)
+		return false;
+
+	uint64_t begin = ring.head;
+
+	// tables are bound as one range, so the rest of the ring is skipped instead of wrapping
+	if (begin % ring.capacity + count > ring.capacity)
+		begin += ring.capacity - begin % ring.capacity;
+
+	uint64_t end = begin + count;
+	if (end - ring.tail > ring.capacity)
+		return false;
+
+	first = (uint32_t)(begin % ring.capacity);
+	ring.frameDescriptorCount += (uint32_t)(end - ring.head);
+	ring.head = end;
+
+	if (ring.frameDescriptorCount > ring.peakFrameDescriptorCount)
+		ring.peakFrameDescriptorCount = ring.frameDescriptorCount;
+
+	return true;
+}
+
+void DescriptorRingFinishFrame(DescriptorRing& ring, uint64_t fenceValue) {
+	ring.frameDescriptorCount = 0;
+
+	// nothing allocated since the last frame, nothing to wait for
+	uint64_t lastEnd = ring.frames.empty() ? ring.tail : ring.frames.back().end;
+	if (ring.head == lastEnd)
+		return;
+
+	DescriptorRingFrame frame;
+	frame.end = ring.head;
+	frame.fenceValue = fenceValue;
+	ring.frames.push_back(frame);
+}
+
+void DescriptorRingReclaim(DescriptorRing& ring, uint64_t completedFenceValue) {
+	while (!ring.frames.empty() && ring.frames.front().fenceValue <= completedFenceValue) {
+		ring.tail = ring.frames.front().end;
+		ring.frames.pop_front();
+	}
+
+	// nothing live, start over at the front of the ring so large tables do not have to skip the end
+	if (ring.frames.empty() && ring.head == ring.tail && ring.head % ring.capacity != 0) {
+		ring.head += ring.capacity - ring.head % ring.capacity;
+		ring.tail = ring.head;
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+// bookkeeping of descriptor heaps, by index into a heap, so it has no d3d12 dependency
+// DescriptorFreeList hands out single descriptors that live for a while (texture views, render target views)
+// freed descriptors can be held back until a fence value is reached, since the gpu reads shader visible
+// descriptors when it executes, not when the command list is recorded
+// DescriptorRing hands out contiguous tables that only live for one frame, they are given back a frame at a time
+// neither is thread safe
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+struct DescriptorRetired {
+	uint32_t index;
+	uint64_t fenceValue;
+};
+
+struct DescriptorFreeList {
+	uint32_t capacity;
+	// stack, lowest index on top so a fresh list hands out 0, 1, 2, ...
+	std::vector<uint32_t> freeIndices;
+	// freed with a fence value that was not reached yet, in the order they were freed
+	std::deque<DescriptorRetired> retired;
+
+	uint32_t allocatedCount;
+	uint32_t peakAllocatedCount;
+};
+
+void DescriptorFreeListInit(DescriptorFreeList& list, uint32_t capacity);
+
+// returns false if every descriptor is allocated or waiting for its fence
+bool DescriptorFreeListAllocate(DescriptorFreeList& list, uint32_t& index);
+
+// the descriptor can be handed out again once completedFenceValue passed to Reclaim reaches fenceValue, 0 means right away
+// fence values are expected to only go up, a lower one waits for the ones freed before it
+void DescriptorFreeListFree(DescriptorFreeList& list, uint32_t index, uint64_t fenceValue);
+
+void DescriptorFreeListReclaim(DescriptorFreeList& list, uint64_t completedFenceValue);
+
+struct DescriptorRingFrame {
+	// head at the end of the frame
+	uint64_t end;
+	uint64_t fenceValue;
+};
+
+// head and tail only ever go up, the position in the ring is their value modulo capacity
+struct DescriptorRing {
+	uint32_t capacity;
+	uint64_t head;
+	uint64_t tail;
+	// finished frames the gpu might still read, ordered by fence value
+	std::deque<DescriptorRingFrame> frames;
+
+	// used by the frame being recorded, skipped descriptors at the end of the ring included
+	uint32_t frameDescriptorCount;
+	uint32_t peakFrameDescriptorCount;
+};
+
+void DescriptorRingInit(DescriptorRing& ring, uint32_t capacity);
+
+// count contiguous descriptors starting at first, a table never wraps around the end of the ring
+// returns false if the frames in flight leave no room
+bool DescriptorRingAllocate(DescriptorRing& ring, uint32_t count, uint32_t& first);
+
+// call once the frame has been submitted, fenceValue is what the fence reaches once the gpu finished it
+void DescriptorRingFinishFrame(DescriptorRing& ring, uint64_t fenceValue);
+
+// makes tables of every frame up to completedFenceValue available again
+void DescriptorRingReclaim(DescriptorRing& ring, uint64_t completedFenceValue);
@@ -0,0 +1,126 @@
+#include "DescriptorHeap.h"
+
+#include "d3dx12.h"
+
+#define SAFE_RELEASE(x) if( x ) { x->Release(); x = NULL; }
+
+static bool AddCpuDescriptorPage(CpuDescriptorHeap& heap) {
+	D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+	heapDesc.NumDescriptors = heap.descriptorsPerPage;
+	heapDesc.Type = heap.type;
+	heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+
+	CpuDescriptorPage page;
+	if (FAILED(heap.device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&page.heap))))
+		return false;
+
+	page.heap->SetName(L"Cpu Descriptor Heap Page");
+	page.cpuStart = page.heap->GetCPUDescriptorHandleForHeapStart();
+	DescriptorFreeListInit(page.freeList, heap.descriptorsPerPage);
+
+	heap.pages.push_back(page);
+	return true;
+}
+
+bool CpuDescriptorHeapInit(CpuDescriptorHeap& heap, ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t descriptorsPerPage) {
+	heap.device = device;
+	heap.type = type;
+	// descriptor sizes vary from device to device
+	heap.descriptorSize = device->GetDescriptorHandleIncrementSize(type);
+	heap.descriptorsPerPage = descriptorsPerPage;
+	heap.pages.clear();
+
+	return AddCpuDescriptorPage(heap);
+}
+
+bool CpuDescriptorHeapAllocate(CpuDescriptorHeap& heap, CpuDescriptor& descriptor) {
+	uint32_t index;
+	size_t page = 0;
+	while (page < heap.pages.size() && !DescriptorFreeListAllocate(heap.pages[page].freeList, index))
+		++page;
+
+	if (page == heap.pages.size()) {
+		if (!AddCpuDescriptorPage(heap) || !DescriptorFreeListAllocate(heap.pages[page].freeList, index))
+			return false;
+	}
+
+	descriptor.cpuHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(heap.pages[page].cpuStart, index, heap.descriptorSize);
+	descriptor.page = (uint32_t)page;
+	descriptor.index = index;
+	return true;
+}
+
+void CpuDescriptorHeapFree(CpuDescriptorHeap& heap, CpuDescriptor& descriptor) {
+	if (descriptor.cpuHandle.ptr == 0 || descriptor.page >= heap.pages.size())
+		return;
+
+	DescriptorFreeListFree(heap.pages[descriptor.page].freeList, descriptor.index, 0);
+	descriptor.cpuHandle.ptr = 0;
+}
+
+void CpuDescriptorHeapShutdown(CpuDescriptorHeap& heap) {
+	for (size_t i = 0; i < heap.pages.size(); ++i)
+		SAFE_RELEASE(heap.pages[i].heap);
+	heap.pages.clear();
+}
+
+bool GpuDescriptorHeapInit(GpuDescriptorHeap& heap, ID3D12Device* device, uint32_t bindlessCount, uint32_t ringCount) {
+	heap.device = device;
+
+	D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+	heapDesc.NumDescriptors = bindlessCount + ringCount;
+	heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+	if (FAILED(device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&heap.heap))))
+		return false;
+
+	heap.heap->SetName(L"Shader Visible Descriptor Heap");
+	heap.descriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	heap.cpuStart = heap.heap->GetCPUDescriptorHandleForHeapStart();
+	heap.gpuStart = heap.heap->GetGPUDescriptorHandleForHeapStart();
+
+	heap.bindlessCount = bindlessCount;
+	DescriptorFreeListInit(heap.bindless, bindlessCount);
+	DescriptorRingInit(heap.ring, ringCount);
+	return true;
+}
+
+bool GpuDescriptorHeapAllocateBindless(GpuDescriptorHeap& heap, uint32_t& index) {
+	return DescriptorFreeListAllocate(heap.bindless, index);
+}
+
+void GpuDescriptorHeapFreeBindless(GpuDescriptorHeap& heap, uint32_t index, uint64_t fenceValue) {
+	DescriptorFreeListFree(heap.bindless, index, fenceValue);
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE GpuDescriptorHeapGetBindlessCpuHandle(GpuDescriptorHeap& heap, uint32_t index) {
+	return CD3DX12_CPU_DESCRIPTOR_HANDLE(heap.cpuStart, index, heap.descriptorSize);
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE GpuDescriptorHeapGetBindlessTable(GpuDescriptorHeap& heap) {
+	return heap.gpuStart;
+}
+
+bool GpuDescriptorHeapAllocateTable(GpuDescriptorHeap& heap, uint32_t count, GpuDescriptorTable& table) {
+	uint32_t first;
+	if (!DescriptorRingAllocate(heap.ring, count, first))
+		return false;
+
+	table.cpuHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(heap.cpuStart, heap.bindlessCount + first, heap.descriptorSize);
+	table.gpuHandle = CD3DX12_GPU_DESCRIPTOR_HANDLE(heap.gpuStart, heap.bindlessCount + first, heap.descriptorSize);
+	table.count = count;
+	return true;
+}
+
+void GpuDescriptorHeapFinishFrame(GpuDescriptorHeap& heap, uint64_t fenceValue) {
+	DescriptorRingFinishFrame(heap.ring, fenceValue);
+}
+
+void GpuDescriptorHeapReclaim(GpuDescriptorHeap& heap, uint64_t completedFenceValue) {
+	DescriptorFreeListReclaim(heap.bindless, completedFenceValue);
+	DescriptorRingReclaim(heap.ring, completedFenceValue);
+}
+
+void GpuDescriptorHeapShutdown(GpuDescriptorHeap& heap) {
+	SAFE_RELEASE(heap.heap);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+// descriptor heaps on top of the bookkeeping in DescriptorAllocator
+// CpuDescriptorHeap is for descriptors the gpu never reads from a heap: render target and depth stencil views,
+// and views that are copied into a shader visible heap. it grows a page at a time, and a descriptor can be
+// freed as soon as no command list is being recorded with it, since they are read when commands are recorded
+// GpuDescriptorHeap is the one shader visible cbv/srv/uav heap. it cannot grow, because changing the bound heap
+// is slow, so it is split into a bindless region where every texture keeps its descriptor for its lifetime and
+// shaders index it by integer, and a ring of tables that only live for one frame
+// render thread only
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#include <windows.h>
+#include <d3d12.h>
+
+#include <vector>
+
+#include "DescriptorAllocator.h"
+
+// descriptors are small, a page of this many is a few kilobytes
+const uint32_t cpuDescriptorHeapDefaultPageSize = 256;
+
+struct CpuDescriptorPage {
+	ID3D12DescriptorHeap* heap;
+	D3D12_CPU_DESCRIPTOR_HANDLE cpuStart;
+	DescriptorFreeList freeList;
+};
+
+struct CpuDescriptor {
+	D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle;
+	uint32_t page;
+	uint32_t index;
+};
+
+struct CpuDescriptorHeap {
+	ID3D12Device* device;
+	D3D12_DESCRIPTOR_HEAP_TYPE type;
+	UINT descriptorSize;
+	uint32_t descriptorsPerPage;
+	std::vector<CpuDescriptorPage> pages;
+};
+
+struct GpuDescriptorTable {
+	D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle;
+	D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle;
+	uint32_t count;
+};
+
+struct GpuDescriptorHeap {
+	ID3D12Device* device;
+	ID3D12DescriptorHeap* heap;
+	UINT descriptorSize;
+	D3D12_CPU_DESCRIPTOR_HANDLE cpuStart;
+	D3D12_GPU_DESCRIPTOR_HANDLE gpuStart;
+
+	// descriptors [0, bindlessCount) are bindless, the ring follows them
+	uint32_t bindlessCount;
+	DescriptorFreeList bindless;
+	DescriptorRing ring;
+};
+
+bool CpuDescriptorHeapInit(CpuDescriptorHeap& heap, ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t descriptorsPerPage);
+
+// adds a page if every page is full
+bool CpuDescriptorHeapAllocate(CpuDescriptorHeap& heap, CpuDescriptor& descriptor);
+
+void CpuDescriptorHeapFree(CpuDescriptorHeap& heap, CpuDescriptor& descriptor);
+
+void CpuDescriptorHeapShutdown(CpuDescriptorHeap& heap);
+
+bool GpuDescriptorHeapInit(GpuDescriptorHeap& heap, ID3D12Device* device, uint32_t bindlessCount, uint32_t ringCount);
+
+// index is what shaders use to look the descriptor up in the bindless table
+bool GpuDescriptorHeapAllocateBindless(GpuDescriptorHeap& heap, uint32_t& index);
+
+// the gpu might still read the descriptor until the fence reaches fenceValue, 0 if it is idle
+void GpuDescriptorHeapFreeBindless(GpuDescriptorHeap& heap, uint32_t index, uint64_t fenceValue);
+
+// to create a view in, or to copy a staged one to
+D3D12_CPU_DESCRIPTOR_HANDLE GpuDescriptorHeapGetBindlessCpuHandle(GpuDescriptorHeap& heap, uint32_t index);
+
+// start of the bindless region, bound once per command list
+D3D12_GPU_DESCRIPTOR_HANDLE GpuDescriptorHeapGetBindlessTable(GpuDescriptorHeap& heap);
+
+// contiguous descriptors that are valid until the frame they were allocated in is finished on the gpu
+bool GpuDescriptorHeapAllocateTable(GpuDescriptorHeap& heap, uint32_t count, GpuDescriptorTable& table);
+
+// call once the frame has been submitted, fenceValue is what the fence reaches once the gpu finished it
+void GpuDescriptorHeapFinishFrame(GpuDescriptorHeap& heap, uint64_t fenceValue);
+
+// gives back bindless descriptors and ring tables the gpu is done with
+void GpuDescriptorHeapReclaim(GpuDescriptorHeap& heap, uint64_t completedFenceValue);
+
+// gpu has to be idle
+void GpuDescriptorHeapShutdown(GpuDescriptorHeap& heap);
@@ -0,0 +1,180 @@
+#include "FrameAllocator.h"
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+void FrameAllocatorInit(FrameAllocator& allocator, uint64_t pageSize, FrameAllocatorCreatePageFn createPage, FrameAllocatorDestroyPageFn destroyPage, void* context) {
+	allocator.pageSize = AlignUp(pageSize, FrameAllocatorDefaultAlignment);
+	allocator.createPage = createPage;
+	allocator.destroyPage = destroyPage;
+	allocator.context = context;
+
+	allocator.currentPage = {};
+	allocator.hasCurrentPage = false;
+	allocator.currentOffset = 0;
+
+	allocator.framePages.clear();
+	allocator.retiredPages.clear();
+	allocator.freePages.clear();
+	allocator.freeDedicatedPages.clear();
+
+	allocator.frameBytes = 0;
+	allocator.frameAllocations = 0;
+	allocator.stats = {};
+}
+
+// a free page of pageSize, or for more than that the smallest free dedicated page it fits, otherwise a new page
+// normal allocations never get a dedicated page, so one large allocation does not keep its memory around for good
+static bool AcquirePage(FrameAllocator& allocator, uint64_t minimumSize, FrameAllocatorPage& page) {
+	if (minimumSize <= allocator.pageSize) {
+		if (!allocator.freePages.empty()) {
+			page = allocator.freePages.back();
+			allocator.freePages.pop_back();
+			return true;
+		}
+	}
+	else {
+		size_t best = allocator.freeDedicatedPages.size();
+		for (size_t i = 0; i < allocator.freeDedicatedPages.size(); ++i) {
+			if (allocator.freeDedicatedPages[i].size >= minimumSize && (best == allocator.freeDedicatedPages.size() || allocator.freeDedicatedPages[i].size < allocator.freeDedicatedPages[best].size))
+				best = i;
+		}
+
+		if (best != allocator.freeDedicatedPages.size()) {
+			page = allocator.freeDedicatedPages[best];
+			// order of free pages does not matter
+			allocator.freeDedicatedPages[best] = allocator.freeDedicatedPages.back();
+			allocator.freeDedicatedPages.pop_back();
+			return true;
+		}
+	}
+
+	uint64_t size = minimumSize > allocator.pageSize ? AlignUp(minimumSize, allocator.pageSize) : allocator.pageSize;
+
+	page = {};
+	if (!allocator.createPage(size, page, allocator.context))
+		return false;
+
+	page.size = size;
+	allocator.stats.pageCount++;
+	allocator.stats.reservedBytes += size;
+	return true;
+}
+
+static void DestroyPage(FrameAllocator& allocator, FrameAllocatorPage& page) {
+	allocator.stats.pageCount--;
+	allocator.stats.reservedBytes -= page.size;
+	allocator.destroyPage(page, allocator.context);
+}
+
+bool FrameAllocatorAllocate(FrameAllocator& allocator, uint64_t size, uint64_t alignment, FrameAllocation& allocation) {
+	if (alignment < FrameAllocatorDefaultAlignment)
+		alignment = FrameAllocatorDefaultAlignment;
+
+	// a page of its own that goes straight to the frame, the rest of the current page is still used afterwards
+	if (size > allocator.pageSize) {
+		FrameAllocatorPage page;
+		if (!AcquirePage(allocator, size, page))
+			return false;
+		allocator.framePages.push_back(page);
+
+		allocation.cpuAddress = page.cpuAddress;
+		allocation.gpuAddress = page.gpuAddress;
+		allocation.userData = page.userData;
+		allocation.offset = 0;
+
+		allocator.frameBytes += size;
+		allocator.frameAllocations++;
+		return true;
+	}
+
+	uint64_t offset = AlignUp(allocator.currentOffset, alignment);
+
+	if (!allocator.hasCurrentPage || offset + size > allocator.currentPage.size) {
+		if (allocator.hasCurrentPage)
+			allocator.framePages.push_back(allocator.currentPage);
+
+		allocator.hasCurrentPage = AcquirePage(allocator, size, allocator.currentPage);
+		if (!allocator.hasCurrentPage)
+			return false;
+
+		offset = 0;
+	}
+
+	allocation.cpuAddress = allocator.currentPage.cpuAddress + offset;
+	allocation.gpuAddress = allocator.currentPage.gpuAddress + offset;
+	allocation.userData = allocator.currentPage.userData;
+	allocation.offset = offset;
+
+	allocator.currentOffset = offset + size;
+	allocator.frameBytes += size;
+	allocator.frameAllocations++;
+	return true;
+}
+
+void FrameAllocatorFinishFrame(FrameAllocator& allocator, uint64_t fenceValue) {
+	if (allocator.hasCurrentPage) {
+		allocator.framePages.push_back(allocator.currentPage);
+		allocator.hasCurrentPage = false;
+		allocator.currentOffset = 0;
+	}
+
+	for (size_t i = 0; i < allocator.framePages.size(); ++i) {
+		allocator.framePages[i].fenceValue = fenceValue;
+		allocator.retiredPages.push_back(allocator.framePages[i]);
+	}
+	allocator.framePages.clear();
+
+	// whatever large allocation they were made for did not come back this frame
+	for (size_t i = 0; i < allocator.freeDedicatedPages.size(); ++i)
+		DestroyPage(allocator, allocator.freeDedicatedPages[i]);
+	allocator.freeDedicatedPages.clear();
+
+	allocator.stats.lastFrameBytes = allocator.frameBytes;
+	allocator.stats.lastFrameAllocations = allocator.frameAllocations;
+	if (allocator.frameBytes > allocator.stats.highWaterBytes)
+		allocator.stats.highWaterBytes = allocator.frameBytes;
+	if (allocator.frameAllocations > allocator.stats.highWaterAllocations)
+		allocator.stats.highWaterAllocations = allocator.frameAllocations;
+
+	allocator.frameBytes = 0;
+	allocator.frameAllocations = 0;
+}
+
+void FrameAllocatorReclaim(FrameAllocator& allocator, uint64_t completedFenceValue) {
+	// frames finish in submission order, so retired pages are sorted by fence value
+	size_t count = 0;
+	while (count < allocator.retiredPages.size() && allocator.retiredPages[count].fenceValue <= completedFenceValue) {
+		if (allocator.retiredPages[count].size == allocator.pageSize)
+			allocator.freePages.push_back(allocator.retiredPages[count]);
+		else
+			allocator.freeDedicatedPages.push_back(allocator.retiredPages[count]);
+		++count;
+	}
+
+	allocator.retiredPages.erase(allocator.retiredPages.begin(), allocator.retiredPages.begin() + count);
+}
+
+void FrameAllocatorDestroy(FrameAllocator& allocator) {
+	if (allocator.hasCurrentPage)
+		allocator.framePages.push_back(allocator.currentPage);
+	allocator.hasCurrentPage = false;
+
+	for (size_t i = 0; i < allocator.framePages.size(); ++i)
+		allocator.destroyPage(allocator.framePages[i], allocator.context);
+	for (size_t i = 0; i < allocator.retiredPages.size(); ++i)
+		allocator.destroyPage(allocator.retiredPages[i], allocator.context);
+	for (size_t i = 0; i < allocator.freePages.size(); ++i)
+		allocator.destroyPage(allocator.freePages[i], allocator.context);
+	for (size_t i = 0; i < allocator.freeDedicatedPages.size(); ++i)
+		allocator.destroyPage(allocator.freeDedicatedPages[i], allocator.context);
+
+	allocator.framePages.clear();
+	allocator.retiredPages.clear();
+	allocator.freePages.clear();
+	allocator.freeDedicatedPages.clear();
+
+	allocator.stats.pageCount = 0;
+	allocator.stats.reservedBytes = 0;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+// linear allocator for data that only lives for one frame (constant buffers, instance data)
+// memory is handed out from large pages, and a page is only reused once the gpu is done with every frame that wrote to it
+// pages are created through callbacks so this file does not depend on d3d12
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// constant buffer views have to start on 256 byte boundaries
+const uint64_t FrameAllocatorDefaultAlignment = 256;
+
+// 2 MB, large enough that thousands of constant buffers fit into one page
+const uint64_t FrameAllocatorDefaultPageSize = 2 * 1024 * 1024;
+
+struct FrameAllocatorPage {
+	uint8_t* cpuAddress;
+	uint64_t gpuAddress;
+	uint64_t size;
+	// whatever owns the memory (the upload resource for d3d12)
+	void* userData;
+	// value the fence reaches when the last frame that used this page is done
+	uint64_t fenceValue;
+};
+
+// cpu pointer to write to and the matching gpu virtual address to bind
+struct FrameAllocation {
+	void* cpuAddress;
+	uint64_t gpuAddress;
+	// userData of the page and where in it the allocation starts, for calls that take a resource and an offset
+	void* userData;
+	uint64_t offset;
+};
+
+// returns false if the page could not be created
+typedef bool (*FrameAllocatorCreatePageFn)(uint64_t size, FrameAllocatorPage& page, void* context);
+typedef void (*FrameAllocatorDestroyPageFn)(FrameAllocatorPage& page, void* context);
+
+struct FrameAllocatorStats {
+	uint64_t lastFrameBytes;
+	uint64_t lastFrameAllocations;
+	// largest frame so far
+	uint64_t highWaterBytes;
+	uint64_t highWaterAllocations;
+	// pages that exist (free, in use by the cpu, or in flight on the gpu)
+	uint64_t pageCount;
+	uint64_t reservedBytes;
+};
+
+struct FrameAllocator {
+	uint64_t pageSize;
+	FrameAllocatorCreatePageFn createPage;
+	FrameAllocatorDestroyPageFn destroyPage;
+	void* context;
+
+	// page currently being filled
+	FrameAllocatorPage currentPage;
+	bool hasCurrentPage;
+	uint64_t currentOffset;
+
+	// filled pages of the frame being recorded
+	std::vector<FrameAllocatorPage> framePages;
+	// pages the gpu might still read, ordered by fence value
+	std::vector<FrameAllocatorPage> retiredPages;
+	// pages of pageSize that can be handed out again
+	std::vector<FrameAllocatorPage> freePages;
+	// pages made for a single allocation larger than pageSize, only reused for another one
+	// the ones a frame did not need are destroyed when it finishes
+	std::vector<FrameAllocatorPage> freeDedicatedPages;
+
+	uint64_t frameBytes;
+	uint64_t frameAllocations;
+	FrameAllocatorStats stats;
+};
+
+void FrameAllocatorInit(FrameAllocator& allocator, uint64_t pageSize, FrameAllocatorCreatePageFn createPage, FrameAllocatorDestroyPageFn destroyPage, void* context);
+
+// alignment has to be a power of two
+// allocations bigger than a page get a page of their own, the page being filled stays current
+bool FrameAllocatorAllocate(FrameAllocator& allocator, uint64_t size, uint64_t alignment, FrameAllocation& allocation);
+
+// call once the frame has been submitted, fenceValue is what the fence reaches once the gpu finished it
+// also destroys the free dedicated pages this frame did not reuse
+void FrameAllocatorFinishFrame(FrameAllocator& allocator, uint64_t fenceValue);
+
+// makes pages of every frame up to completedFenceValue available again
+void FrameAllocatorReclaim(FrameAllocator& allocator, uint64_t completedFenceValue);
+
+// gpu has to be idle
+void FrameAllocatorDestroy(FrameAllocator& allocator);
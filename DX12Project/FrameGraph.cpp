@@ -0,0 +1,492 @@
+#include "FrameGraph.h"
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// the tracker knows resources by pointer, the graph by index
+static void* GetStateKey(uint32_t resource) {
+	return (void*)((uintptr_t)resource + 1);
+}
+
+static void AppendTransitions(const ResourceStateBarrier* barriers, uint32_t count, void* context) {
+	FrameGraph& graph = *static_cast<FrameGraph*>(context);
+
+	for (uint32_t i = 0; i < count; ++i) {
+		FrameGraphBarrier barrier;
+		barrier.type = FRAME_GRAPH_BARRIER_TRANSITION;
+		barrier.resource = (uint32_t)((uintptr_t)barriers[i].resource - 1);
+		barrier.subresource = barriers[i].subresource;
+		barrier.stateBefore = barriers[i].stateBefore;
+		barrier.stateAfter = barriers[i].stateAfter;
+		barrier.flag = barriers[i].flag;
+		barrier.resourceBefore = frameGraphInvalid;
+		graph.barriers.push_back(barrier);
+	}
+}
+
+static bool LifetimesOverlap(const FrameGraphResource& a, const FrameGraphResource& b) {
+	return a.firstUse <= b.lastUse && b.firstUse <= a.lastUse;
+}
+
+static bool MemoryOverlaps(const FrameGraphResource& a, const FrameGraphResource& b) {
+	return a.heapOffset < b.heapOffset + b.desc.size && b.heapOffset < a.heapOffset + a.desc.size;
+}
+
+static FrameGraphAccess* FindAccess(FrameGraph& graph, uint32_t pass, uint32_t resource) {
+	std::vector<FrameGraphAccess>& accesses = graph.passes[pass].accesses;
+	for (size_t i = 0; i < accesses.size(); ++i) {
+		if (graph.versions[accesses[i].version].resource == resource)
+			return &accesses[i];
+	}
+	return nullptr;
+}
+
+static uint32_t AddResource(FrameGraph& graph, const char* name, bool imported, const FrameGraphResourceDesc& desc, void* resource, uint32_t initialState, uint32_t finalState) {
+	FrameGraphResource entry;
+	entry.name = name;
+	entry.imported = imported;
+	entry.desc = desc;
+	entry.initialState = initialState;
+	entry.finalState = finalState;
+	entry.resource = resource;
+	entry.lastVersion = (uint32_t)graph.versions.size();
+	entry.firstUse = frameGraphInvalid;
+	entry.lastUse = frameGraphInvalid;
+	entry.heapOffset = 0;
+	graph.resources.push_back(entry);
+
+	FrameGraphVersion version;
+	version.resource = (uint32_t)graph.resources.size() - 1;
+	version.previous = frameGraphInvalid;
+	version.writer = frameGraphInvalid;
+	graph.versions.push_back(version);
+
+	graph.compiled = false;
+	return entry.lastVersion;
+}
+
+void FrameGraphReset(FrameGraph& graph) {
+	graph.resources.clear();
+	graph.versions.clear();
+	graph.passes.clear();
+	graph.invalid = false;
+	graph.compiled = false;
+	graph.order.clear();
+	graph.barriers.clear();
+	graph.firstFinalBarrier = 0;
+	graph.finalBarrierCount = 0;
+	graph.transientHeapSize = 0;
+	graph.transientHeapAlignment = 1;
+	graph.stats = FrameGraphStats();
+}
+
+uint32_t FrameGraphImport(FrameGraph& graph, const char* name, void* resource, uint32_t initialState, uint32_t finalState) {
+	FrameGraphResourceDesc desc = {};
+	return AddResource(graph, name, true, desc, resource, initialState, finalState);
+}
+
+uint32_t FrameGraphCreate(FrameGraph& graph, const char* name, const FrameGraphResourceDesc& desc) {
+	return AddResource(graph, name, false, desc, nullptr, 0, 0);
+}
+
+uint32_t FrameGraphAddPass(FrameGraph& graph, const char* name, uint32_t flags, FrameGraphPassFn execute, void* context) {
+	FrameGraphPass pass;
+	pass.name = name;
+	pass.flags = flags;
+	pass.execute = execute;
+	pass.context = context;
+	pass.culled = true;
+	pass.firstBarrier = 0;
+	pass.barrierCount = 0;
+	graph.passes.push_back(pass);
+
+	graph.compiled = false;
+	return (uint32_t)graph.passes.size() - 1;
+}
+
+void FrameGraphRead(FrameGraph& graph, uint32_t pass, uint32_t handle, uint32_t state) {
+	if (pass >= graph.passes.size() || handle >= graph.versions.size()) {
+		graph.invalid = true;
+		return;
+	}
+
+	// a transient nothing wrote yet has no contents to read
+	const FrameGraphVersion& version = graph.versions[handle];
+	if (version.writer == frameGraphInvalid && !graph.resources[version.resource].imported) {
+		graph.invalid = true;
+		return;
+	}
+
+	FrameGraphAccess* existing = FindAccess(graph, pass, version.resource);
+	if (existing != nullptr) {
+		if (existing->write || existing->version != handle)
+			graph.invalid = true;
+		else
+			existing->state |= state;
+		return;
+	}
+
+	FrameGraphAccess access;
+	access.version = handle;
+	access.state = state;
+	access.write = false;
+	graph.passes[pass].accesses.push_back(access);
+	graph.compiled = false;
+}
+
+uint32_t FrameGraphWrite(FrameGraph& graph, uint32_t pass, uint32_t handle, uint32_t state) {
+	if (pass >= graph.passes.size() || handle >= graph.versions.size()) {
+		graph.invalid = true;
+		return frameGraphInvalid;
+	}
+
+	// two writers of the same version would make two different histories of one resource
+	uint32_t resource = graph.versions[handle].resource;
+	if (graph.resources[resource].lastVersion != handle || FindAccess(graph, pass, resource) != nullptr) {
+		graph.invalid = true;
+		return frameGraphInvalid;
+	}
+
+	FrameGraphVersion version;
+	version.resource = resource;
+	version.previous = handle;
+	version.writer = pass;
+	graph.versions.push_back(version);
+
+	uint32_t written = (uint32_t)graph.versions.size() - 1;
+	graph.resources[resource].lastVersion = written;
+
+	FrameGraphAccess access;
+	access.version = written;
+	access.state = state;
+	access.write = true;
+	graph.passes[pass].accesses.push_back(access);
+
+	graph.compiled = false;
+	return written;
+}
+
+// marks the passes that write an imported resource or are never culled, and everything they depend on
+static void CullPasses(FrameGraph& graph) {
+	std::vector<uint32_t>& stack = graph.scratch;
+	stack.clear();
+
+	for (uint32_t i = 0; i < graph.passes.size(); ++i) {
+		FrameGraphPass& pass = graph.passes[i];
+		pass.culled = true;
+
+		bool output = (pass.flags & FRAME_GRAPH_PASS_FLAG_NEVER_CULL) != 0;
+		for (size_t j = 0; j < pass.accesses.size() && !output; ++j)
+			output = pass.accesses[j].write && graph.resources[graph.versions[pass.accesses[j].version].resource].imported;
+
+		if (output) {
+			pass.culled = false;
+			stack.push_back(i);
+		}
+	}
+
+	while (!stack.empty()) {
+		const FrameGraphPass& pass = graph.passes[stack.back()];
+		stack.pop_back();
+
+		for (size_t i = 0; i < pass.accesses.size(); ++i) {
+			// a write keeps what was there before, so the previous writer is needed as well
+			const FrameGraphVersion& version = graph.versions[pass.accesses[i].version];
+			uint32_t writer = pass.accesses[i].write ? graph.versions[version.previous].writer : version.writer;
+
+			if (writer != frameGraphInvalid && graph.passes[writer].culled) {
+				graph.passes[writer].culled = false;
+				stack.push_back(writer);
+			}
+		}
+	}
+}
+
+// topological order of the passes that run, ties go to the pass added first
+// a pass comes after the writer of everything it reads and writes, and after every reader of what it overwrites
+static bool OrderPasses(FrameGraph& graph) {
+	size_t passCount = graph.passes.size();
+
+	graph.readers.resize(graph.versions.size());
+	for (size_t i = 0; i < graph.readers.size(); ++i)
+		graph.readers[i].clear();
+
+	for (uint32_t i = 0; i < passCount; ++i) {
+		const FrameGraphPass& pass = graph.passes[i];
+		for (size_t j = 0; j < pass.accesses.size() && !pass.culled; ++j) {
+			if (!pass.accesses[j].write)
+				graph.readers[pass.accesses[j].version].push_back(i);
+		}
+	}
+
+	// dependents of pass i are edges[edgeStart[i] .. edgeStart[i + 1])
+	std::vector<std::pair<uint32_t, uint32_t>> edges;
+	for (uint32_t i = 0; i < passCount; ++i) {
+		const FrameGraphPass& pass = graph.passes[i];
+		for (size_t j = 0; j < pass.accesses.size() && !pass.culled; ++j) {
+			const FrameGraphAccess& access = pass.accesses[j];
+			const FrameGraphVersion& version = graph.versions[access.version];
+
+			if (!access.write) {
+				if (version.writer != frameGraphInvalid)
+					edges.push_back(std::make_pair(version.writer, i));
+				continue;
+			}
+
+			uint32_t previousWriter = graph.versions[version.previous].writer;
+			if (previousWriter != frameGraphInvalid)
+				edges.push_back(std::make_pair(previousWriter, i));
+
+			const std::vector<uint32_t>& previousReaders = graph.readers[version.previous];
+			for (size_t k = 0; k < previousReaders.size(); ++k) {
+				if (previousReaders[k] != i)
+					edges.push_back(std::make_pair(previousReaders[k], i));
+			}
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+
+	std::vector<uint32_t>& dependencyCounts = graph.scratch;
+	dependencyCounts.assign(passCount, 0);
+	std::vector<uint32_t> edgeStart(passCount + 1, 0);
+	for (size_t i = 0; i < edges.size(); ++i) {
+		++dependencyCounts[edges[i].second];
+		++edgeStart[edges[i].first + 1];
+	}
+	for (size_t i = 0; i < passCount; ++i)
+		edgeStart[i + 1] += edgeStart[i];
+
+	std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> ready;
+	size_t liveCount = 0;
+	for (uint32_t i = 0; i < passCount; ++i) {
+		if (graph.passes[i].culled)
+			continue;
+		++liveCount;
+		if (dependencyCounts[i] == 0)
+			ready.push(i);
+	}
+
+	graph.order.clear();
+	while (!ready.empty()) {
+		uint32_t pass = ready.top();
+		ready.pop();
+		graph.order.push_back(pass);
+
+		for (uint32_t i = edgeStart[pass]; i < edgeStart[pass + 1]; ++i) {
+			if (--dependencyCounts[edges[i].second] == 0)
+				ready.push(edges[i].second);
+		}
+	}
+
+	// anything left depends on itself
+	return graph.order.size() == liveCount;
+}
+
+static void ComputeLifetimes(FrameGraph& graph) {
+	for (size_t i = 0; i < graph.resources.size(); ++i) {
+		graph.resources[i].firstUse = frameGraphInvalid;
+		graph.resources[i].lastUse = frameGraphInvalid;
+	}
+
+	for (uint32_t i = 0; i < graph.order.size(); ++i) {
+		const FrameGraphPass& pass = graph.passes[graph.order[i]];
+		for (size_t j = 0; j < pass.accesses.size(); ++j) {
+			FrameGraphResource& resource = graph.resources[graph.versions[pass.accesses[j].version].resource];
+			if (resource.firstUse == frameGraphInvalid) {
+				resource.firstUse = i;
+				// created in the state it is first used in, and put back in it at the end of every frame
+				if (!resource.imported) {
+					resource.initialState = pass.accesses[j].state;
+					resource.finalState = pass.accesses[j].state;
+				}
+			}
+			resource.lastUse = i;
+		}
+	}
+}
+
+// largest first, each at the lowest offset that does not overlap a placed resource alive at the same time
+static void PlaceTransients(FrameGraph& graph) {
+	std::vector<uint32_t> transients;
+	for (uint32_t i = 0; i < graph.resources.size(); ++i) {
+		if (!graph.resources[i].imported && graph.resources[i].firstUse != frameGraphInvalid)
+			transients.push_back(i);
+	}
+
+	std::sort(transients.begin(), transients.end(), [&graph](uint32_t a, uint32_t b) {
+		uint64_t sizeA = graph.resources[a].desc.size;
+		uint64_t sizeB = graph.resources[b].desc.size;
+		return sizeA != sizeB ? sizeA > sizeB : a < b;
+	});
+
+	graph.transientHeapSize = 0;
+	graph.transientHeapAlignment = 1;
+	graph.stats.transientCount = (uint32_t)transients.size();
+	graph.stats.transientBytes = 0;
+
+	std::vector<uint32_t> conflicts;
+	for (size_t i = 0; i < transients.size(); ++i) {
+		FrameGraphResource& resource = graph.resources[transients[i]];
+		uint64_t alignment = resource.desc.alignment > 0 ? resource.desc.alignment : 1;
+
+		conflicts.clear();
+		for (size_t j = 0; j < i; ++j) {
+			if (LifetimesOverlap(resource, graph.resources[transients[j]]))
+				conflicts.push_back(transients[j]);
+		}
+		std::sort(conflicts.begin(), conflicts.end(), [&graph](uint32_t a, uint32_t b) {
+			return graph.resources[a].heapOffset < graph.resources[b].heapOffset;
+		});
+
+		// first gap that fits
+		uint64_t offset = 0;
+		for (size_t j = 0; j < conflicts.size(); ++j) {
+			const FrameGraphResource& placed = graph.resources[conflicts[j]];
+			if (AlignUp(offset, alignment) + resource.desc.size <= placed.heapOffset)
+				break;
+			offset = std::max(offset, placed.heapOffset + placed.desc.size);
+		}
+
+		resource.heapOffset = AlignUp(offset, alignment);
+		graph.transientHeapSize = std::max(graph.transientHeapSize, resource.heapOffset + resource.desc.size);
+		graph.transientHeapAlignment = std::max(graph.transientHeapAlignment, alignment);
+		graph.stats.transientBytes += resource.desc.size;
+	}
+
+	graph.transientHeapSize = AlignUp(graph.transientHeapSize, graph.transientHeapAlignment);
+}
+
+// memory of a transient was used by another one before, since the previous frame at the latest
+static void AddAliasingBarrier(FrameGraph& graph, uint32_t resource) {
+	const FrameGraphResource& after = graph.resources[resource];
+
+	uint32_t before = frameGraphInvalid;
+	uint32_t overlapCount = 0;
+	for (uint32_t i = 0; i < graph.resources.size(); ++i) {
+		const FrameGraphResource& other = graph.resources[i];
+		if (i == resource || other.imported || other.firstUse == frameGraphInvalid || !MemoryOverlaps(after, other))
+			continue;
+		before = i;
+		++overlapCount;
+	}
+
+	if (overlapCount == 0)
+		return;
+
+	FrameGraphBarrier barrier;
+	barrier.type = FRAME_GRAPH_BARRIER_ALIASING;
+	barrier.resource = resource;
+	barrier.subresource = resourceStateAllSubresources;
+	barrier.stateBefore = 0;
+	barrier.stateAfter = 0;
+	barrier.flag = RESOURCE_BARRIER_FLAG_NONE;
+	barrier.resourceBefore = overlapCount == 1 ? before : frameGraphInvalid;
+	graph.barriers.push_back(barrier);
+	++graph.stats.aliasingBarrierCount;
+}
+
+static void DeriveBarriers(FrameGraph& graph, uint32_t readStates) {
+	ResourceStateTrackerInit(graph.states, readStates);
+	for (uint32_t i = 0; i < graph.resources.size(); ++i)
+		ResourceStateTrackerRegister(graph.states, GetStateKey(i), 1, graph.resources[i].initialState);
+
+	graph.barriers.clear();
+	graph.stats.aliasingBarrierCount = 0;
+
+	for (uint32_t i = 0; i < graph.passes.size(); ++i) {
+		graph.passes[i].firstBarrier = 0;
+		graph.passes[i].barrierCount = 0;
+	}
+
+	for (uint32_t i = 0; i < graph.order.size(); ++i) {
+		FrameGraphPass& pass = graph.passes[graph.order[i]];
+		pass.firstBarrier = (uint32_t)graph.barriers.size();
+
+		for (size_t j = 0; j < pass.accesses.size(); ++j) {
+			uint32_t resource = graph.versions[pass.accesses[j].version].resource;
+			if (!graph.resources[resource].imported && graph.resources[resource].firstUse == i)
+				AddAliasingBarrier(graph, resource);
+
+			ResourceStateTrackerTransition(graph.states, GetStateKey(resource), resourceStateAllSubresources, pass.accesses[j].state);
+		}
+		ResourceStateTrackerFlush(graph.states, AppendTransitions, &graph);
+
+		pass.barrierCount = (uint32_t)graph.barriers.size() - pass.firstBarrier;
+	}
+
+	graph.firstFinalBarrier = (uint32_t)graph.barriers.size();
+	for (uint32_t i = 0; i < graph.resources.size(); ++i)
+		ResourceStateTrackerRestore(graph.states, GetStateKey(i), graph.resources[i].finalState);
+	ResourceStateTrackerFlush(graph.states, AppendTransitions, &graph);
+	graph.finalBarrierCount = (uint32_t)graph.barriers.size() - graph.firstFinalBarrier;
+
+	graph.stats.transitionBarrierCount = (uint32_t)graph.barriers.size() - graph.stats.aliasingBarrierCount;
+}
+
+bool FrameGraphCompile(FrameGraph& graph, uint32_t readStates) {
+	graph.compiled = false;
+	if (graph.invalid)
+		return false;
+
+	CullPasses(graph);
+	if (!OrderPasses(graph))
+		return false;
+
+	ComputeLifetimes(graph);
+	PlaceTransients(graph);
+	DeriveBarriers(graph, readStates);
+
+	graph.stats.passCount = (uint32_t)graph.passes.size();
+	graph.stats.culledPassCount = (uint32_t)(graph.passes.size() - graph.order.size());
+	graph.stats.transientHeapSize = graph.transientHeapSize;
+
+	graph.compiled = true;
+	return true;
+}
+
+uint32_t FrameGraphGetResourceIndex(const FrameGraph& graph, uint32_t handle) {
+	return handle < graph.versions.size() ? graph.versions[handle].resource : frameGraphInvalid;
+}
+
+void* FrameGraphGetResource(const FrameGraph& graph, uint32_t handle) {
+	uint32_t resource = FrameGraphGetResourceIndex(graph, handle);
+	return resource != frameGraphInvalid ? graph.resources[resource].resource : nullptr;
+}
+
+void FrameGraphSetResource(FrameGraph& graph, uint32_t handle, void* resource) {
+	uint32_t index = FrameGraphGetResourceIndex(graph, handle);
+	if (index != frameGraphInvalid)
+		graph.resources[index].resource = resource;
+}
+
+void* FrameGraphExecute(FrameGraph& graph, FrameGraphBarrierFn recordBarriers, void* commandList) {
+	FrameGraphPassContext context;
+	context.graph = &graph;
+	context.pass = frameGraphInvalid;
+	context.passContext = nullptr;
+	context.commandList = commandList;
+
+	if (!graph.compiled)
+		return commandList;
+
+	for (size_t i = 0; i < graph.order.size(); ++i) {
+		const FrameGraphPass& pass = graph.passes[graph.order[i]];
+		if (pass.barrierCount > 0)
+			recordBarriers(graph, &graph.barriers[pass.firstBarrier], pass.barrierCount, context.commandList);
+
+		context.pass = graph.order[i];
+		context.passContext = pass.context;
+		if (pass.execute != nullptr)
+			pass.execute(context);
+	}
+
+	if (graph.finalBarrierCount > 0)
+		recordBarriers(graph, &graph.barriers[graph.firstFinalBarrier], graph.finalBarrierCount, context.commandList);
+
+	return context.commandList;
+}
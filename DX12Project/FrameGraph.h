@@ -0,0 +1,199 @@
+#pragma once
+
+// a frame described as passes that declare which resources they read and write, instead of hand written barriers
+// compiling the graph orders the passes by their dependencies, culls passes nothing needs the output of, works out
+// how long every transient resource lives, places transient resources whose lifetimes do not overlap into the same
+// memory, and derives every transition and aliasing barrier. a compiled graph is executed every frame until it
+// changes
+//
+// resources are imported (they live outside the graph, like the back buffer) or transient (the graph decides
+// where they go, the caller creates them at the offsets compile picked). writing a resource makes a new version
+// of it, reads name the version they want, so the order passes are added in does not matter
+// a pass that writes an imported resource, or is flagged never cull, is an output of the frame
+// the first writer of a transient has to initialize all of it (clear, discard or copy), since the memory was
+// last used by whatever it is aliased with
+//
+// compiling is cpu only and has no d3d12 dependency, states are the bits of D3D12_RESOURCE_STATES and the
+// barriers are handed to a callback when the graph is executed. not thread safe
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ResourceStateTracker.h"
+
+// for handles, passes and resource indices
+const uint32_t frameGraphInvalid = 0xffffffff;
+
+enum FrameGraphPassFlag {
+	FRAME_GRAPH_PASS_FLAG_NONE = 0,
+	// kept even if nothing reads what it writes, for passes with side effects outside the graph
+	FRAME_GRAPH_PASS_FLAG_NEVER_CULL = 1,
+};
+
+enum FrameGraphBarrierType {
+	FRAME_GRAPH_BARRIER_TRANSITION,
+	FRAME_GRAPH_BARRIER_ALIASING,
+};
+
+// what the caller needs to create a transient resource, the graph only looks at size and alignment
+// the rest is passed through (a DXGI_FORMAT and D3D12_RESOURCE_FLAGS for the d3d12 backend)
+struct FrameGraphResourceDesc {
+	uint32_t width;
+	uint32_t height;
+	uint32_t format;
+	uint32_t flags;
+	// from GetResourceAllocationInfo
+	uint64_t size;
+	uint64_t alignment;
+};
+
+struct FrameGraphResource {
+	const char* name;
+	bool imported;
+	FrameGraphResourceDesc desc;
+	// imported: the state it is in when the graph starts and has to be left in
+	// transient: the state of its first use, compile sets it and the resource has to be created in it
+	uint32_t initialState;
+	uint32_t finalState;
+	// set on import, for transients by the caller once compile placed them
+	void* resource;
+	// newest version, only that one can be written
+	uint32_t lastVersion;
+
+	// from compile, positions in the execution order, frameGraphInvalid if no pass that runs uses it
+	uint32_t firstUse;
+	uint32_t lastUse;
+	// transient only, into the transient heap
+	uint64_t heapOffset;
+};
+
+// the contents of a resource after a write, a handle is the index of one
+struct FrameGraphVersion {
+	uint32_t resource;
+	// version of the same resource before this one, frameGraphInvalid for the first
+	uint32_t previous;
+	// pass that wrote it, frameGraphInvalid for the contents a resource starts with
+	uint32_t writer;
+};
+
+struct FrameGraphAccess {
+	// version read, or the version written
+	uint32_t version;
+	uint32_t state;
+	bool write;
+};
+
+struct FrameGraphPassContext;
+
+typedef void (*FrameGraphPassFn)(FrameGraphPassContext& context);
+
+struct FrameGraphPass {
+	const char* name;
+	uint32_t flags;
+	FrameGraphPassFn execute;
+	void* context;
+	std::vector<FrameGraphAccess> accesses;
+
+	// from compile
+	bool culled;
+	// range in barriers recorded before the pass
+	uint32_t firstBarrier;
+	uint32_t barrierCount;
+};
+
+struct FrameGraphBarrier {
+	FrameGraphBarrierType type;
+	// index into resources
+	uint32_t resource;
+	// transitions
+	uint32_t subresource;
+	uint32_t stateBefore;
+	uint32_t stateAfter;
+	ResourceBarrierFlag flag;
+	// aliasing, resource that used the memory before, frameGraphInvalid if there are several
+	uint32_t resourceBefore;
+};
+
+struct FrameGraphStats {
+	uint32_t passCount;
+	uint32_t culledPassCount;
+	uint32_t transientCount;
+	// summed size of every transient a pass that runs uses, against the size of the heap they were placed in
+	uint64_t transientBytes;
+	uint64_t transientHeapSize;
+	uint32_t transitionBarrierCount;
+	uint32_t aliasingBarrierCount;
+};
+
+struct FrameGraph {
+	std::vector<FrameGraphResource> resources;
+	std::vector<FrameGraphVersion> versions;
+	std::vector<FrameGraphPass> passes;
+	// set when something was declared wrong, compile fails
+	bool invalid;
+
+	// from compile
+	bool compiled;
+	// passes that run, in order
+	std::vector<uint32_t> order;
+	std::vector<FrameGraphBarrier> barriers;
+	// recorded after the last pass, to leave resources the way the graph found them
+	uint32_t firstFinalBarrier;
+	uint32_t finalBarrierCount;
+	// for every transient, at least the largest alignment of any of them
+	uint64_t transientHeapSize;
+	uint64_t transientHeapAlignment;
+	FrameGraphStats stats;
+
+	// reused by every compile
+	ResourceStateTracker states;
+	std::vector<std::vector<uint32_t>> readers;
+	std::vector<uint32_t> scratch;
+};
+
+// handed to a pass while the graph executes
+struct FrameGraphPassContext {
+	FrameGraph* graph;
+	uint32_t pass;
+	// the one given to FrameGraphAddPass
+	void* passContext;
+	// where the barriers go, a pass can switch it to another command list and the barriers after it follow
+	void* commandList;
+};
+
+// called with at least one barrier, commandList is the one the current pass uses
+typedef void (*FrameGraphBarrierFn)(const FrameGraph& graph, const FrameGraphBarrier* barriers, uint32_t count, void* commandList);
+
+// drops every pass and resource
+void FrameGraphReset(FrameGraph& graph);
+
+// returns the handle of the contents it has when the graph starts
+uint32_t FrameGraphImport(FrameGraph& graph, const char* name, void* resource, uint32_t initialState, uint32_t finalState);
+
+// returns the handle of the resource before anything wrote it, which cannot be read
+uint32_t FrameGraphCreate(FrameGraph& graph, const char* name, const FrameGraphResourceDesc& desc);
+
+uint32_t FrameGraphAddPass(FrameGraph& graph, const char* name, uint32_t flags, FrameGraphPassFn execute, void* context);
+
+// a pass can read a resource in several read states, they are combined
+void FrameGraphRead(FrameGraph& graph, uint32_t pass, uint32_t handle, uint32_t state);
+
+// handle has to be the newest version of the resource, returns the handle of the version the pass writes
+// a resource written by a pass cannot be read or written by it in any other way
+uint32_t FrameGraphWrite(FrameGraph& graph, uint32_t pass, uint32_t handle, uint32_t state);
+
+// readStates are the states that can be combined, like the resource state tracker's
+// false if something was declared wrong or the passes depend on each other in a cycle
+bool FrameGraphCompile(FrameGraph& graph, uint32_t readStates);
+
+uint32_t FrameGraphGetResourceIndex(const FrameGraph& graph, uint32_t handle);
+
+void* FrameGraphGetResource(const FrameGraph& graph, uint32_t handle);
+
+// imported resources can be swapped between executions (the back buffer), as long as the states stay the same
+void FrameGraphSetResource(FrameGraph& graph, uint32_t handle, void* resource);
+
+// records the barriers of every pass that runs and calls it, in order, then the final barriers
+// returns the command list the last pass left in the context
+void* FrameGraphExecute(FrameGraph& graph, FrameGraphBarrierFn recordBarriers, void* commandList);
@@ -0,0 +1,58 @@
+#include "GpuCulling.h"
+
+#include <cstring>
+
+void GpuSceneObjectInit(GpuSceneObject& object, const float worldMat[16], const float boundsMin[3], const float boundsMax[3]) {
+	for (int row = 0; row < 4; ++row) {
+		for (int column = 0; column < 4; ++column)
+			object.worldMat[row * 4 + column] = worldMat[column * 4 + row];
+	}
+
+	TransformBounds(worldMat, boundsMin, boundsMax, object.boundsMin, object.boundsMax);
+	object.boundsMin[3] = 0.0f;
+	object.boundsMax[3] = 0.0f;
+}
+
+void GpuCullConstantsInit(GpuCullConstants& constants, const CullingFrustum& frustum, uint32_t objectCount, uint32_t indexCount) {
+	memcpy(constants.planes, frustum.planes, sizeof(constants.planes));
+	constants.objectCount = objectCount;
+	constants.indexCount = indexCount;
+	constants.padding[0] = 0;
+	constants.padding[1] = 0;
+}
+
+void GpuCullObject(const GpuCullConstants& constants, const GpuSceneObject* objects, uint32_t index, GpuDrawCommand* commands, uint32_t& count) {
+	// the last group runs past the end
+	if (index >= constants.objectCount)
+		return;
+
+	const GpuSceneObject& object = objects[index];
+	for (int i = 0; i < 6; ++i) {
+		const float* plane = constants.planes[i];
+		float x = plane[0] >= 0.0f ? object.boundsMax[0] : object.boundsMin[0];
+		float y = plane[1] >= 0.0f ? object.boundsMax[1] : object.boundsMin[1];
+		float z = plane[2] >= 0.0f ? object.boundsMax[2] : object.boundsMin[2];
+		if (plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < 0.0f)
+			return;
+	}
+
+	// InterlockedAdd
+	uint32_t slot = count++;
+
+	GpuDrawCommand& command = commands[slot];
+	command.objectIndex = index;
+	command.indexCountPerInstance = constants.indexCount;
+	command.instanceCount = 1;
+	command.startIndexLocation = 0;
+	command.baseVertexLocation = 0;
+	command.startInstanceLocation = 0;
+}
+
+uint32_t GpuCullObjects(const GpuCullConstants& constants, const GpuSceneObject* objects, GpuDrawCommand* commands) {
+	uint32_t groupCount = (constants.objectCount + gpuCullGroupSize - 1) / gpuCullGroupSize;
+
+	uint32_t count = 0;
+	for (uint32_t index = 0; index < groupCount * gpuCullGroupSize; ++index)
+		GpuCullObject(constants, objects, index, commands, count);
+	return count;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+// gpu driven drawing of the scene. every object lives in a scene buffer on the gpu, a compute shader tests each
+// against the frustum and appends an indirect draw for the visible ones with an atomic counter, and a single
+// ExecuteIndirect draws however many there are. the cpu only uploads objects that moved
+// the structs have the layouts of IndirectCullComputeShader.hlsl and the command signature, GpuCullObject does
+// what one thread of the shader does, so the kernel can be checked without a gpu
+// no d3d12 dependency
+
+#include <cstddef>
+#include <cstdint>
+
+#include "CullingBvh.h"
+
+// threads per group of the culling shader
+const uint32_t gpuCullGroupSize = 64;
+
+struct GpuSceneObject {
+	// transposed like the matrices the other shaders get
+	float worldMat[16];
+	// world space box, w is unused
+	float boundsMin[4];
+	float boundsMax[4];
+};
+
+// the culling shader's constant buffer
+struct GpuCullConstants {
+	// normalized, inside is positive, see CullingFrustum
+	float planes[6][4];
+	uint32_t objectCount;
+	// every object is drawn with the same mesh
+	uint32_t indexCount;
+	uint32_t padding[2];
+};
+
+// the object index root constant, then D3D12_DRAW_INDEXED_ARGUMENTS
+struct GpuDrawCommand {
+	uint32_t objectIndex;
+	uint32_t indexCountPerInstance;
+	uint32_t instanceCount;
+	uint32_t startIndexLocation;
+	int32_t baseVertexLocation;
+	uint32_t startInstanceLocation;
+};
+
+// worldMat is row major with the translation in the last row like DirectXMath's, the box is in object space
+void GpuSceneObjectInit(GpuSceneObject& object, const float worldMat[16], const float boundsMin[3], const float boundsMax[3]);
+
+void GpuCullConstantsInit(GpuCullConstants& constants, const CullingFrustum& frustum, uint32_t objectCount, uint32_t indexCount);
+
+// thread index of the shader, count is the counter it increments
+// threads run in any order on the gpu, so the commands come out in any order too
+void GpuCullObject(const GpuCullConstants& constants, const GpuSceneObject* objects, uint32_t index, GpuDrawCommand* commands, uint32_t& count);
+
+// every thread of the dispatch in order, returns the count, commands needs room for every object
+uint32_t GpuCullObjects(const GpuCullConstants& constants, const GpuSceneObject* objects, GpuDrawCommand* commands);
@@ -0,0 +1,286 @@
+#include "GpuHeapAllocator.h"
+
+#include "d3dx12.h"
+
+#define SAFE_RELEASE(x) if( x ) { x->Release(); x = NULL; }
+
+static UINT64 AlignUp(UINT64 value, UINT64 alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static int GetHeapTypeIndex(D3D12_HEAP_TYPE heapType) {
+	switch (heapType) {
+	case D3D12_HEAP_TYPE_DEFAULT: return 0;
+	case D3D12_HEAP_TYPE_UPLOAD: return 1;
+	case D3D12_HEAP_TYPE_READBACK: return 2;
+	default: return -1;
+	}
+}
+
+static GpuHeapCategory GetHeapCategory(const D3D12_RESOURCE_DESC& desc) {
+	if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+		return GPU_HEAP_CATEGORY_BUFFER;
+
+	if (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))
+		return GPU_HEAP_CATEGORY_RENDER_TARGET;
+
+	return GPU_HEAP_CATEGORY_TEXTURE;
+}
+
+static D3D12_HEAP_FLAGS GetHeapFlags(GpuHeapCategory category) {
+	switch (category) {
+	case GPU_HEAP_CATEGORY_BUFFER: return D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+	case GPU_HEAP_CATEGORY_TEXTURE: return D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+	default: return D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+	}
+}
+
+// mutex has to be held
+static GpuHeapBlock* CreateBlock(GpuHeapAllocator& allocator, std::vector<GpuHeapBlock*>& pool, D3D12_HEAP_TYPE heapType, D3D12_HEAP_FLAGS flags, UINT64 size, UINT64 alignment, bool dedicated) {
+	D3D12_HEAP_DESC heapDesc = {};
+	heapDesc.SizeInBytes = size;
+	heapDesc.Properties = CD3DX12_HEAP_PROPERTIES(heapType);
+	heapDesc.Alignment = alignment > D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT ? D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+	heapDesc.Flags = flags;
+
+	ID3D12Heap* heap;
+	if (FAILED(allocator.device->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap))))
+		return nullptr;
+
+	heap->SetName(dedicated ? L"Dedicated Resource Heap" : L"Shared Resource Heap");
+
+	GpuHeapBlock* block = new GpuHeapBlock;
+	block->heap = heap;
+	block->size = size;
+	block->buffer = nullptr;
+	block->dedicated = dedicated;
+	block->pool = &pool;
+	TlsfInit(block->allocator, size);
+
+	pool.push_back(block);
+	return block;
+}
+
+// mutex has to be held, the block has to be empty
+static void DestroyBlock(GpuHeapBlock* block) {
+	std::vector<GpuHeapBlock*>& pool = *block->pool;
+	for (size_t i = 0; i < pool.size(); ++i) {
+		if (pool[i] == block) {
+			pool.erase(pool.begin() + i);
+			break;
+		}
+	}
+
+	SAFE_RELEASE(block->buffer);
+	SAFE_RELEASE(block->heap);
+	delete block;
+}
+
+// first block of the pool with room, a new one if none has
+static GpuHeapBlock* AllocateFromPool(GpuHeapAllocator& allocator, std::vector<GpuHeapBlock*>& pool, D3D12_HEAP_TYPE heapType, D3D12_HEAP_FLAGS flags, UINT64 size, UINT64 alignment, TlsfAllocation& range) {
+	// large or msaa aligned resources get their own heap
+	if (size > maxPlacedInBlockSize || alignment > D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT) {
+		GpuHeapBlock* block = CreateBlock(allocator, pool, heapType, flags, AlignUp(size, alignment), alignment, true);
+		if (block == nullptr)
+			return nullptr;
+
+		TlsfAllocate(block->allocator, size, alignment, range);
+		return block;
+	}
+
+	for (size_t i = 0; i < pool.size(); ++i) {
+		if (!pool[i]->dedicated && TlsfAllocate(pool[i]->allocator, size, alignment, range))
+			return pool[i];
+	}
+
+	GpuHeapBlock* block = CreateBlock(allocator, pool, heapType, flags, gpuHeapBlockSize, alignment, false);
+	if (block == nullptr)
+		return nullptr;
+
+	TlsfAllocate(block->allocator, size, alignment, range);
+	return block;
+}
+
+void GpuHeapAllocatorInit(GpuHeapAllocator& allocator, ID3D12Device* device) {
+	allocator.device = device;
+	allocator.placedResourceCount = 0;
+	allocator.subAllocatedBufferCount = 0;
+}
+
+HRESULT GpuHeapAllocatorCreateResource(GpuHeapAllocator& allocator, D3D12_HEAP_TYPE heapType, const D3D12_RESOURCE_DESC& desc, D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue, GpuAllocation& allocation) {
+	int heapTypeIndex = GetHeapTypeIndex(heapType);
+	if (heapTypeIndex < 0)
+		return E_INVALIDARG;
+
+	GpuHeapCategory category = GetHeapCategory(desc);
+
+	// small textures can be placed on 4k instead of 64k boundaries, the device says whether this one qualifies
+	D3D12_RESOURCE_DESC placedDesc = desc;
+	D3D12_RESOURCE_ALLOCATION_INFO info;
+	if (category == GPU_HEAP_CATEGORY_TEXTURE && desc.SampleDesc.Count <= 1 && desc.Alignment == 0) {
+		placedDesc.Alignment = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+		info = allocator.device->GetResourceAllocationInfo(0, 1, &placedDesc);
+		if (info.Alignment != D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT) {
+			placedDesc.Alignment = 0;
+			info = allocator.device->GetResourceAllocationInfo(0, 1, &placedDesc);
+		}
+	}
+	else {
+		info = allocator.device->GetResourceAllocationInfo(0, 1, &placedDesc);
+	}
+
+	if (info.SizeInBytes == UINT64_MAX)
+		return E_INVALIDARG;
+
+	std::lock_guard<std::mutex> lock(allocator.mutex);
+
+	TlsfAllocation range;
+	GpuHeapBlock* block = AllocateFromPool(allocator, allocator.blocks[heapTypeIndex][category], heapType, GetHeapFlags(category), info.SizeInBytes, info.Alignment, range);
+	if (block == nullptr)
+		return E_OUTOFMEMORY;
+
+	ID3D12Resource* resource;
+	HRESULT hr = allocator.device->CreatePlacedResource(block->heap, range.offset, &placedDesc, initialState, clearValue, IID_PPV_ARGS(&resource));
+	if (FAILED(hr)) {
+		TlsfFree(block->allocator, range.block);
+		if (block->dedicated)
+			DestroyBlock(block);
+		return hr;
+	}
+
+	allocation.resource = resource;
+	allocation.offset = 0;
+	allocation.size = info.SizeInBytes;
+	allocation.gpuAddress = category == GPU_HEAP_CATEGORY_BUFFER ? resource->GetGPUVirtualAddress() : 0;
+	allocation.block = block;
+	allocation.tlsfBlock = range.block;
+
+	++allocator.placedResourceCount;
+	return S_OK;
+}
+
+HRESULT GpuHeapAllocatorCreateBuffer(GpuHeapAllocator& allocator, D3D12_HEAP_TYPE heapType, UINT64 size, D3D12_RESOURCE_STATES initialState, GpuAllocation& allocation) {
+	if (heapType != D3D12_HEAP_TYPE_DEFAULT || size >= maxSubAllocatedBufferSize)
+		return GpuHeapAllocatorCreateResource(allocator, heapType, CD3DX12_RESOURCE_DESC::Buffer(size), initialState, nullptr, allocation);
+
+	std::lock_guard<std::mutex> lock(allocator.mutex);
+
+	TlsfAllocation range;
+	GpuHeapBlock* page = nullptr;
+	for (size_t i = 0; i < allocator.bufferPages.size(); ++i) {
+		if (TlsfAllocate(allocator.bufferPages[i]->allocator, size, subAllocatedBufferAlignment, range)) {
+			page = allocator.bufferPages[i];
+			break;
+		}
+	}
+
+	if (page == nullptr) {
+		page = CreateBlock(allocator, allocator.bufferPages, D3D12_HEAP_TYPE_DEFAULT, D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS, gpuBufferPageSize, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, false);
+		if (page == nullptr)
+			return E_OUTOFMEMORY;
+
+		HRESULT hr = allocator.device->CreatePlacedResource(page->heap, 0, &CD3DX12_RESOURCE_DESC::Buffer(gpuBufferPageSize), D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&page->buffer));
+		if (FAILED(hr)) {
+			DestroyBlock(page);
+			return hr;
+		}
+		page->buffer->SetName(L"Shared Buffer Page");
+
+		TlsfAllocate(page->allocator, size, subAllocatedBufferAlignment, range);
+	}
+
+	allocation.resource = page->buffer;
+	allocation.offset = range.offset;
+	allocation.size = size;
+	allocation.gpuAddress = page->buffer->GetGPUVirtualAddress() + range.offset;
+	allocation.block = page;
+	allocation.tlsfBlock = range.block;
+
+	++allocator.subAllocatedBufferCount;
+	return S_OK;
+}
+
+HRESULT GpuHeapAllocatorAllocateMemory(GpuHeapAllocator& allocator, D3D12_HEAP_TYPE heapType, GpuHeapCategory category, UINT64 size, UINT64 alignment, GpuAllocation& allocation) {
+	int heapTypeIndex = GetHeapTypeIndex(heapType);
+	if (heapTypeIndex < 0 || size == 0)
+		return E_INVALIDARG;
+
+	if (alignment < D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT)
+		alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+
+	std::lock_guard<std::mutex> lock(allocator.mutex);
+
+	TlsfAllocation range;
+	GpuHeapBlock* block = AllocateFromPool(allocator, allocator.blocks[heapTypeIndex][category], heapType, GetHeapFlags(category), size, alignment, range);
+	if (block == nullptr)
+		return E_OUTOFMEMORY;
+
+	allocation.resource = nullptr;
+	allocation.offset = range.offset;
+	allocation.size = size;
+	allocation.gpuAddress = 0;
+	allocation.block = block;
+	allocation.tlsfBlock = range.block;
+
+	++allocator.placedResourceCount;
+	return S_OK;
+}
+
+void GpuHeapAllocatorFree(GpuHeapAllocator& allocator, GpuAllocation& allocation) {
+	GpuHeapBlock* block = allocation.block;
+	if (block == nullptr)
+		return;
+
+	std::lock_guard<std::mutex> lock(allocator.mutex);
+
+	// the page's buffer is not the caller's to release
+	if (block->buffer != nullptr) {
+		--allocator.subAllocatedBufferCount;
+	}
+	else {
+		SAFE_RELEASE(allocation.resource);
+		--allocator.placedResourceCount;
+	}
+
+	TlsfFree(block->allocator, allocation.tlsfBlock);
+	if (block->dedicated && TlsfIsEmpty(block->allocator))
+		DestroyBlock(block);
+
+	allocation.resource = nullptr;
+	allocation.block = nullptr;
+	allocation.gpuAddress = 0;
+}
+
+GpuHeapAllocatorStats GpuHeapAllocatorGetStats(GpuHeapAllocator& allocator) {
+	std::lock_guard<std::mutex> lock(allocator.mutex);
+
+	GpuHeapAllocatorStats stats = {};
+	stats.placedResourceCount = allocator.placedResourceCount;
+	stats.subAllocatedBufferCount = allocator.subAllocatedBufferCount;
+
+	for (int i = 0; i <= gpuHeapTypeCount * GPU_HEAP_CATEGORY_COUNT; ++i) {
+		const std::vector<GpuHeapBlock*>& pool = i < gpuHeapTypeCount * GPU_HEAP_CATEGORY_COUNT ? allocator.blocks[i / GPU_HEAP_CATEGORY_COUNT][i % GPU_HEAP_CATEGORY_COUNT] : allocator.bufferPages;
+
+		for (size_t j = 0; j < pool.size(); ++j) {
+			++stats.heapCount;
+			stats.reservedBytes += pool[j]->size;
+			stats.usedBytes += pool[j]->allocator.usedBytes;
+		}
+	}
+
+	return stats;
+}
+
+void GpuHeapAllocatorShutdown(GpuHeapAllocator& allocator) {
+	std::lock_guard<std::mutex> lock(allocator.mutex);
+
+	for (int i = 0; i < gpuHeapTypeCount; ++i) {
+		for (int j = 0; j < GPU_HEAP_CATEGORY_COUNT; ++j) {
+			while (!allocator.blocks[i][j].empty())
+				DestroyBlock(allocator.blocks[i][j].back());
+		}
+	}
+
+	while (!allocator.bufferPages.empty())
+		DestroyBlock(allocator.bufferPages.back());
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+// gpu memory in large ID3D12Heap blocks instead of one committed resource (and kernel allocation) per object
+// resources are placed into blocks with CreatePlacedResource, the ranges come from a TlsfAllocator per block
+// blocks are kept per heap type and per resource category, since tier 1 hardware cannot mix buffers, textures
+// and render targets in one heap
+// buffers in the default heap smaller than the 64k placement alignment would waste most of it, so they are
+// sub-allocated from shared buffer pages instead. a page is a single buffer over a whole heap block, it is
+// created in the common state and never transitioned, the buffers in it rely on implicit promotion and decay
+// thread safe
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#include <windows.h>
+#include <d3d12.h>
+
+#include <mutex>
+#include <vector>
+
+#include "TlsfAllocator.h"
+
+enum GpuHeapCategory {
+	GPU_HEAP_CATEGORY_BUFFER,
+	GPU_HEAP_CATEGORY_TEXTURE,
+	GPU_HEAP_CATEGORY_RENDER_TARGET,
+	GPU_HEAP_CATEGORY_COUNT,
+};
+
+// default, upload and readback
+const int gpuHeapTypeCount = 3;
+
+const UINT64 gpuHeapBlockSize = 64 * 1024 * 1024;
+
+// resources above half a block get a heap of their own, so one of them cannot leave most of a block unused
+const UINT64 maxPlacedInBlockSize = gpuHeapBlockSize / 2;
+
+const UINT64 gpuBufferPageSize = 4 * 1024 * 1024;
+
+// below this, default heap buffers share a page
+const UINT64 maxSubAllocatedBufferSize = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+
+// enough for constant buffer views, vertex and index buffers
+const UINT64 subAllocatedBufferAlignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+
+struct GpuHeapBlock {
+	ID3D12Heap* heap;
+	UINT64 size;
+	// only for buffer pages, spans the whole heap
+	ID3D12Resource* buffer;
+	TlsfAllocator allocator;
+	// made for a single resource, goes away with it
+	bool dedicated;
+	// list this block is in
+	std::vector<GpuHeapBlock*>* pool;
+};
+
+struct GpuAllocation {
+	// placed resource, or the shared page for sub-allocated buffers, null for memory without a resource
+	ID3D12Resource* resource;
+	// into resource, 0 unless sub-allocated. for memory without a resource, into the block's heap
+	UINT64 offset;
+	UINT64 size;
+	// buffers only, offset included
+	D3D12_GPU_VIRTUAL_ADDRESS gpuAddress;
+
+	GpuHeapBlock* block;
+	uint32_t tlsfBlock;
+};
+
+struct GpuHeapAllocatorStats {
+	UINT64 heapCount;
+	UINT64 reservedBytes;
+	UINT64 usedBytes;
+	UINT64 placedResourceCount;
+	UINT64 subAllocatedBufferCount;
+};
+
+struct GpuHeapAllocator {
+	ID3D12Device* device;
+	std::mutex mutex;
+
+	std::vector<GpuHeapBlock*> blocks[gpuHeapTypeCount][GPU_HEAP_CATEGORY_COUNT];
+	std::vector<GpuHeapBlock*> bufferPages;
+
+	UINT64 placedResourceCount;
+	UINT64 subAllocatedBufferCount;
+};
+
+void GpuHeapAllocatorInit(GpuHeapAllocator& allocator, ID3D12Device* device);
+
+// same as CreateCommittedResource, but placed into a shared heap
+HRESULT GpuHeapAllocatorCreateResource(GpuHeapAllocator& allocator, D3D12_HEAP_TYPE heapType, const D3D12_RESOURCE_DESC& desc, D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue, GpuAllocation& allocation);
+
+// small default heap buffers are sub-allocated and always in the common state, initialState only applies to
+// buffers that get a placed resource of their own
+HRESULT GpuHeapAllocatorCreateBuffer(GpuHeapAllocator& allocator, D3D12_HEAP_TYPE heapType, UINT64 size, D3D12_RESOURCE_STATES initialState, GpuAllocation& allocation);
+
+// memory the caller places resources in itself, like transient render targets that alias each other
+// the resources have to be released before the memory is freed, it counts as a placed resource
+HRESULT GpuHeapAllocatorAllocateMemory(GpuHeapAllocator& allocator, D3D12_HEAP_TYPE heapType, GpuHeapCategory category, UINT64 size, UINT64 alignment, GpuAllocation& allocation);
+
+// the gpu must be done with the allocation
+void GpuHeapAllocatorFree(GpuHeapAllocator& allocator, GpuAllocation& allocation);
+
+GpuHeapAllocatorStats GpuHeapAllocatorGetStats(GpuHeapAllocator& allocator);
+
+// every allocation has to be freed
+void GpuHeapAllocatorShutdown(GpuHeapAllocator& allocator);
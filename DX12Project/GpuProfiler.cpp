@@ -0,0 +1,156 @@
+#include "GpuProfiler.h"
+
+#include "d3dx12.h"
+
+#define SAFE_RELEASE(x) if( x ) { x->Release(); x = NULL; }
+
+static UINT GetQueryIndex(int frameIndex, UINT scope) {
+	return ((UINT)frameIndex * maxGpuProfileScopes + scope) * 2;
+}
+
+// same conversion std::chrono::steady_clock does with the performance counter, keeps both on one clock
+static uint64_t PerformanceCounterToNanoseconds(UINT64 counter) {
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+
+	UINT64 whole = (counter / frequency.QuadPart) * 1000000000ull;
+	UINT64 part = (counter % frequency.QuadPart) * 1000000000ull / frequency.QuadPart;
+	return whole + part;
+}
+
+static void Calibrate(GpuProfiler& profiler) {
+	UINT64 gpuTimestamp;
+	UINT64 cpuTimestamp;
+	if (FAILED(profiler.queue->GetClockCalibration(&gpuTimestamp, &cpuTimestamp)))
+		return;
+
+	profiler.calibrationGpuTimestamp = gpuTimestamp;
+	profiler.calibrationCpuNanoseconds = PerformanceCounterToNanoseconds(cpuTimestamp);
+}
+
+static uint64_t GpuTimestampToNanoseconds(const GpuProfiler& profiler, UINT64 timestamp) {
+	// timestamps from before the calibration are negative offsets
+	INT64 ticks = (INT64)(timestamp - profiler.calibrationGpuTimestamp);
+	return profiler.calibrationCpuNanoseconds + (INT64)((double)ticks * 1000000000.0 / (double)profiler.timestampFrequency);
+}
+
+bool GpuProfilerInit(GpuProfiler& profiler, ID3D12Device* device, ID3D12CommandQueue* queue, int frameCount) {
+	HRESULT hr;
+
+	profiler.queue = queue;
+	profiler.queryHeap = nullptr;
+	profiler.readbackBuffer = nullptr;
+	profiler.readbackData = nullptr;
+	profiler.calibrationGpuTimestamp = 0;
+	profiler.calibrationCpuNanoseconds = 0;
+	profiler.frameIndex = 0;
+
+	profiler.frames.resize(frameCount);
+	for (GpuProfileFrame& frame : profiler.frames) {
+		frame.scopeCount = 0;
+		frame.resolved = false;
+	}
+
+	hr = queue->GetTimestampFrequency(&profiler.timestampFrequency);
+	if (FAILED(hr))
+		return false;
+
+	UINT queryCount = GetQueryIndex(frameCount, 0);
+
+	D3D12_QUERY_HEAP_DESC queryHeapDesc = {};
+	queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+	queryHeapDesc.Count = queryCount;
+	hr = device->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&profiler.queryHeap));
+	if (FAILED(hr))
+		return false;
+	profiler.queryHeap->SetName(L"GPU Profiler Query Heap");
+
+	hr = device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(queryCount * sizeof(UINT64)),
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS(&profiler.readbackBuffer));
+	if (FAILED(hr))
+		return false;
+	profiler.readbackBuffer->SetName(L"GPU Profiler Readback Buffer");
+
+	// readback buffers may stay mapped, the fence wait in front of every read makes the data visible
+	void* readbackData;
+	hr = profiler.readbackBuffer->Map(0, nullptr, &readbackData);
+	if (FAILED(hr))
+		return false;
+	profiler.readbackData = (const UINT64*)readbackData;
+
+	Calibrate(profiler);
+	return true;
+}
+
+void GpuProfilerBeginFrame(GpuProfiler& profiler, int frameIndex) {
+	profiler.frameIndex = frameIndex;
+
+	GpuProfileFrame& frame = profiler.frames[frameIndex];
+
+	if (frame.resolved) {
+		// the clocks drift apart over time
+		Calibrate(profiler);
+
+		const UINT64* timestamps = profiler.readbackData + GetQueryIndex(frameIndex, 0);
+		for (UINT i = 0; i < frame.scopeCount; ++i) {
+			UINT64 begin = timestamps[i * 2];
+			UINT64 end = timestamps[i * 2 + 1];
+			if (end < begin)
+				continue;
+
+			ProfilerRecordGpu(frame.scopeNames[i], GpuTimestampToNanoseconds(profiler, begin), GpuTimestampToNanoseconds(profiler, end));
+		}
+	}
+
+	frame.scopeCount = 0;
+	frame.resolved = false;
+}
+
+int GpuProfilerBeginScope(GpuProfiler& profiler, ID3D12GraphicsCommandList* commandList, const char* name) {
+	GpuProfileFrame& frame = profiler.frames[profiler.frameIndex];
+	if (frame.scopeCount == maxGpuProfileScopes)
+		return -1;
+
+	UINT scope = frame.scopeCount++;
+	frame.scopeNames[scope] = name;
+
+	commandList->EndQuery(profiler.queryHeap, D3D12_QUERY_TYPE_TIMESTAMP, GetQueryIndex(profiler.frameIndex, scope));
+	return (int)scope;
+}
+
+void GpuProfilerEndScope(GpuProfiler& profiler, ID3D12GraphicsCommandList* commandList, int scope) {
+	if (scope < 0)
+		return;
+
+	commandList->EndQuery(profiler.queryHeap, D3D12_QUERY_TYPE_TIMESTAMP, GetQueryIndex(profiler.frameIndex, (UINT)scope) + 1);
+}
+
+void GpuProfilerEndFrame(GpuProfiler& profiler, ID3D12GraphicsCommandList* commandList) {
+	GpuProfileFrame& frame = profiler.frames[profiler.frameIndex];
+	if (frame.scopeCount == 0)
+		return;
+
+	UINT firstQuery = GetQueryIndex(profiler.frameIndex, 0);
+	commandList->ResolveQueryData(profiler.queryHeap, D3D12_QUERY_TYPE_TIMESTAMP, firstQuery, frame.scopeCount * 2,
+		profiler.readbackBuffer, firstQuery * sizeof(UINT64));
+
+	frame.resolved = true;
+}
+
+void GpuProfilerShutdown(GpuProfiler& profiler) {
+	if (profiler.readbackData != nullptr) {
+		// nothing was written by the cpu
+		D3D12_RANGE writtenRange = { 0, 0 };
+		profiler.readbackBuffer->Unmap(0, &writtenRange);
+		profiler.readbackData = nullptr;
+	}
+
+	SAFE_RELEASE(profiler.readbackBuffer);
+	SAFE_RELEASE(profiler.queryHeap);
+	profiler.frames.clear();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+// gpu timestamps around passes of a frame, handed to the cpu profiler as a separate track
+// every frame context owns a range of the query heap and of a readback buffer. a frame's timestamps are resolved
+// at the end of its last command list and read back the next time the frame context comes around, when its fence
+// has been waited on anyway, so reading them never stalls
+// scopes are only recorded on the main thread, but may begin and end in different command lists of the same queue
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#include <windows.h>
+#include <d3d12.h>
+
+#include <vector>
+
+#include "Profiler.h"
+
+// per frame, each scope takes two timestamps
+const UINT maxGpuProfileScopes = 32;
+
+struct GpuProfileFrame {
+	const char* scopeNames[maxGpuProfileScopes];
+	UINT scopeCount;
+	// the timestamps were resolved and are waiting to be read
+	bool resolved;
+};
+
+struct GpuProfiler {
+	ID3D12CommandQueue* queue;
+	ID3D12QueryHeap* queryHeap;
+	ID3D12Resource* readbackBuffer;
+	// mapped for the lifetime of the buffer
+	const UINT64* readbackData;
+
+	UINT64 timestampFrequency;
+	// gpu timestamp and ProfilerNow time taken at the same moment
+	UINT64 calibrationGpuTimestamp;
+	uint64_t calibrationCpuNanoseconds;
+
+	std::vector<GpuProfileFrame> frames;
+	int frameIndex;
+};
+
+bool GpuProfilerInit(GpuProfiler& profiler, ID3D12Device* device, ID3D12CommandQueue* queue, int frameCount);
+
+// the last frame recorded with frameIndex has to be finished on the gpu, its timestamps are passed to the profiler
+void GpuProfilerBeginFrame(GpuProfiler& profiler, int frameIndex);
+
+// returns -1 once the frame is out of scopes, ending that scope does nothing
+int GpuProfilerBeginScope(GpuProfiler& profiler, ID3D12GraphicsCommandList* commandList, const char* name);
+void GpuProfilerEndScope(GpuProfiler& profiler, ID3D12GraphicsCommandList* commandList, int scope);
+
+// copies the frame's timestamps into the readback buffer, has to be recorded after every scope has ended
+void GpuProfilerEndFrame(GpuProfiler& profiler, ID3D12GraphicsCommandList* commandList);
+
+void GpuProfilerShutdown(GpuProfiler& profiler);
+
+// like PROFILE_SCOPE these compile to nothing without ENABLE_PROFILING
+#ifdef ENABLE_PROFILING
+#define PROFILE_GPU_BEGIN_FRAME(profiler, frameIndex) GpuProfilerBeginFrame(profiler, frameIndex)
+#define PROFILE_GPU_BEGIN(profiler, commandList, scope, name) int scope = GpuProfilerBeginScope(profiler, commandList, name)
+#define PROFILE_GPU_END(profiler, commandList, scope) GpuProfilerEndScope(profiler, commandList, scope)
+#define PROFILE_GPU_END_FRAME(profiler, commandList) GpuProfilerEndFrame(profiler, commandList)
+#else
+#define PROFILE_GPU_BEGIN_FRAME(profiler, frameIndex) ((void)0)
+#define PROFILE_GPU_BEGIN(profiler, commandList, scope, name) ((void)0)
+#define PROFILE_GPU_END(profiler, commandList, scope) ((void)0)
+#define PROFILE_GPU_END_FRAME(profiler, commandList) ((void)0)
+#endif
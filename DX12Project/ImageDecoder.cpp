@@ -0,0 +1,2436 @@
+#include "ImageDecoder.h"
+
+#include <cstring>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define IMAGE_DECODER_SSE
+#endif
+
+// LoadImageDataFromFile returns the size of the image as an int
+const uint64_t maxDecodedImageBytes = 0x7fffffff;
+
+static inline uint32_t ReadBigEndian16(const uint8_t* bytes) {
+	return (uint32_t)bytes[0] << 8 | bytes[1];
+}
+
+static inline uint32_t ReadBigEndian32(const uint8_t* bytes) {
+	return (uint32_t)bytes[0] << 24 | (uint32_t)bytes[1] << 16 | (uint32_t)bytes[2] << 8 | bytes[3];
+}
+
+static inline uint32_t ReadLittleEndian32(const uint8_t* bytes) {
+	return (uint32_t)bytes[3] << 24 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[1] << 8 | bytes[0];
+}
+
+static inline uint8_t ClampByte(int value) {
+	return (uint8_t)(value < 0 ? 0 : value > 255 ? 255 : value);
+}
+
+static inline int16_t ClampShort(int value) {
+	return (int16_t)(value < -32768 ? -32768 : value > 32767 ? 32767 : value);
+}
+
+ImageFileType GetImageFileType(const uint8_t* file, size_t fileSize) {
+	static const uint8_t pngSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+	if (fileSize >= 3 && file[0] == 0xff && file[1] == 0xd8 && file[2] == 0xff)
+		return IMAGE_FILE_JPEG;
+	if (fileSize >= 8 && memcmp(file, pngSignature, 8) == 0)
+		return IMAGE_FILE_PNG;
+	return IMAGE_FILE_UNKNOWN;
+}
+
+uint32_t GetDecodedImageBytesPerPixel(DecodedImageFormat format) {
+	switch (format) {
+	case DECODED_IMAGE_FORMAT_R16G16B16A16_UNORM:
+		return 8;
+	case DECODED_IMAGE_FORMAT_R8G8B8A8_UNORM:
+	case DECODED_IMAGE_FORMAT_B8G8R8A8_UNORM:
+		return 4;
+	case DECODED_IMAGE_FORMAT_R16_UNORM:
+		return 2;
+	case DECODED_IMAGE_FORMAT_R8_UNORM:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+static bool IsDecodedImageSizeValid(uint32_t width, uint32_t height, DecodedImageFormat format) {
+	return width > 0 && height > 0 && (uint64_t)width * height * GetDecodedImageBytesPerPixel(format) <= maxDecodedImageBytes;
+}
+
+// jpeg
+
+const int jpegFastBits = 9;
+const uint32_t jpegFastMask = (1 << jpegFastBits) - 1;
+
+const int jpegMarkerSof0 = 0xc0;
+const int jpegMarkerSof1 = 0xc1;
+const int jpegMarkerSof2 = 0xc2;
+const int jpegMarkerDht = 0xc4;
+const int jpegMarkerRst0 = 0xd0;
+const int jpegMarkerRst7 = 0xd7;
+const int jpegMarkerSoi = 0xd8;
+const int jpegMarkerEoi = 0xd9;
+const int jpegMarkerSos = 0xda;
+const int jpegMarkerDqt = 0xdb;
+const int jpegMarkerDri = 0xdd;
+const int jpegMarkerApp0 = 0xe0;
+const int jpegMarkerApp14 = 0xee;
+
+// islow idct constants of libjpeg with 12 bits of fraction
+const int jpegIdctC0541 = (int)(0.5411961f * 4096 + 0.5f);
+const int jpegIdctC0765 = (int)(0.765366865f * 4096 + 0.5f);
+const int jpegIdctCm1847 = (int)(-1.847759065f * 4096 + 0.5f);
+const int jpegIdctC1175 = (int)(1.175875602f * 4096 + 0.5f);
+const int jpegIdctC0298 = (int)(0.298631336f * 4096 + 0.5f);
+const int jpegIdctC2053 = (int)(2.053119869f * 4096 + 0.5f);
+const int jpegIdctC3072 = (int)(3.072711026f * 4096 + 0.5f);
+const int jpegIdctC1501 = (int)(1.501321110f * 4096 + 0.5f);
+const int jpegIdctCm0899 = (int)(-0.899976223f * 4096 + 0.5f);
+const int jpegIdctCm2562 = (int)(-2.562915447f * 4096 + 0.5f);
+const int jpegIdctCm1961 = (int)(-1.961570560f * 4096 + 0.5f);
+const int jpegIdctCm0390 = (int)(-0.390180644f * 4096 + 0.5f);
+
+// the columns are shifted down to 2 bits of fraction, the rows to none with the level shift of 128 added
+const int jpegIdctColumnBias = 1 << 9;
+const int jpegIdctRowBias = (1 << 16) + (128 << 17);
+
+// ycbcr to rgb with 12 bits of fraction, applied to chroma shifted up by 8 bits and taking the high 16 bits
+const int jpegCrToR = (int)(1.40200f * 4096 + 0.5f);
+const int jpegCrToG = -(int)(0.71414f * 4096 + 0.5f);
+const int jpegCbToG = -(int)(0.34414f * 4096 + 0.5f);
+const int jpegCbToB = (int)(1.77200f * 4096 + 0.5f);
+
+// natural order of the zigzag order coefficients, corrupt runs past the end land on the last one
+static const uint8_t jpegNaturalOrder[64 + 16] = {
+	0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+	12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+	35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+	58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+	63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63,
+};
+
+struct JpegHuffman {
+	// index into values of the codes up to jpegFastBits long, by their bits, 255 for longer codes
+	uint8_t fast[1 << jpegFastBits];
+	// a whole ac coefficient when its code and magnitude fit in the fast bits: value << 8 | run << 4 | bit count
+	int16_t fastAc[1 << jpegFastBits];
+	uint16_t codes[256];
+	uint8_t sizes[257];
+	uint8_t values[256];
+	int valueCount;
+	// first code of each length that is too long for it, shifted up to 16 bits
+	uint32_t maxCode[18];
+	// value index minus code for each length
+	int deltas[17];
+	bool defined;
+};
+
+struct JpegComponent {
+	int id;
+	int h;
+	int v;
+	int quantTable;
+	int dcTable;
+	int acTable;
+	// samples the component has, and blocks its plane has, a whole number of mcus
+	uint32_t width;
+	uint32_t height;
+	uint32_t blocksX;
+	uint32_t blocksY;
+	// blocksX * 8 samples wide
+	std::vector<uint8_t> plane;
+	// progressive files keep every coefficient until the last scan, in natural order and not dequantized
+	std::vector<int16_t> coefficients;
+	int dcPrediction;
+};
+
+typedef void (*JpegIdctFn)(const int16_t* coefficients, uint8_t* out, size_t outStride);
+
+struct JpegDecoder {
+	const uint8_t* position;
+	const uint8_t* end;
+	JpegIdctFn idct;
+	bool simd;
+
+	// natural order
+	uint16_t quant[4][64];
+	JpegHuffman dcTables[4];
+	JpegHuffman acTables[4];
+
+	JpegComponent components[4];
+	int componentCount;
+	uint32_t width;
+	uint32_t height;
+	int hMax;
+	int vMax;
+	uint32_t mcusX;
+	uint32_t mcusY;
+	bool frameRead;
+	bool progressive;
+	bool planesAllocated;
+	bool scanDecoded;
+	int restartInterval;
+
+	// markers that tell rgb from ycbcr
+	bool jfif;
+	int adobeTransform;
+
+	// the scan being decoded
+	int scanComponents[4];
+	int scanComponentCount;
+	int spectralStart;
+	int spectralEnd;
+	int successiveHigh;
+	int successiveLow;
+	int eobRun;
+	int restartsLeft;
+
+	// entropy coded bits, the next one is the top bit
+	uint64_t bitBuffer;
+	int bitCount;
+	// the marker that ended the entropy coded data, zeros are read from there on. 0 for none
+	int marker;
+};
+
+static bool BuildJpegHuffman(JpegHuffman& huffman, const uint8_t counts[16]) {
+	int k = 0;
+	for (int i = 0; i < 16; ++i) {
+		for (int j = 0; j < counts[i]; ++j)
+			huffman.sizes[k++] = (uint8_t)(i + 1);
+	}
+	huffman.sizes[k] = 0;
+	huffman.valueCount = k;
+
+	uint32_t code = 0;
+	k = 0;
+	for (int j = 1; j <= 16; ++j) {
+		huffman.deltas[j] = k - (int)code;
+		while (huffman.sizes[k] == j)
+			huffman.codes[k++] = (uint16_t)code++;
+		if (code > (1u << j))
+			return false;
+		huffman.maxCode[j] = code << (16 - j);
+		code <<= 1;
+	}
+	huffman.maxCode[17] = 0xffffffff;
+
+	memset(huffman.fast, 255, sizeof(huffman.fast));
+	for (int i = 0; i < k; ++i) {
+		int size = huffman.sizes[i];
+		if (size <= jpegFastBits) {
+			int first = huffman.codes[i] << (jpegFastBits - size);
+			int count = 1 << (jpegFastBits - size);
+			for (int j = 0; j < count; ++j)
+				huffman.fast[first + j] = (uint8_t)i;
+		}
+	}
+
+	for (int i = 0; i < (1 << jpegFastBits); ++i) {
+		huffman.fastAc[i] = 0;
+		int index = huffman.fast[i];
+		if (index == 255)
+			continue;
+
+		int runSize = huffman.values[index];
+		int run = (runSize >> 4) & 15;
+		int magnitudeBits = runSize & 15;
+		int length = huffman.sizes[index];
+		if (magnitudeBits == 0 || length + magnitudeBits > jpegFastBits)
+			continue;
+
+		// the magnitude bits follow the code in the same lookup
+		int value = ((i << length) & jpegFastMask) >> (jpegFastBits - magnitudeBits);
+		if (value < (1 << (magnitudeBits - 1)))
+			value += 1 - (1 << magnitudeBits);
+		if (value >= -128 && value <= 127)
+			huffman.fastAc[i] = (int16_t)(value * 256 + run * 16 + length + magnitudeBits);
+	}
+
+	huffman.defined = true;
+	return true;
+}
+
+static inline bool HasByteFF(uint64_t bytes) {
+	return ((~bytes - 0x0101010101010101ull) & bytes & 0x8080808080808080ull) != 0;
+}
+
+// a byte at a time through stuffing, markers and the end of the data
+static void JpegFillBitsSlow(JpegDecoder& decoder) {
+	while (decoder.bitCount <= 56) {
+		uint64_t byte = 0;
+		if (decoder.marker == 0 && decoder.position < decoder.end) {
+			byte = *decoder.position++;
+			if (byte == 0xff) {
+				// a stuffed zero follows a 0xff of data, anything else is a marker, fill bytes can come before it
+				while (decoder.position < decoder.end && *decoder.position == 0xff)
+					decoder.position++;
+
+				if (decoder.position < decoder.end && *decoder.position == 0x00) {
+					decoder.position++;
+				}
+				else {
+					decoder.marker = decoder.position < decoder.end ? *decoder.position++ : jpegMarkerEoi;
+					byte = 0;
+				}
+			}
+		}
+
+		decoder.bitBuffer |= byte << (56 - decoder.bitCount);
+		decoder.bitCount += 8;
+	}
+}
+
+static inline void JpegFillBits(JpegDecoder& decoder) {
+	if (decoder.marker == 0 && decoder.end - decoder.position >= 8) {
+		// 8 bytes at once when none of them is a marker or stuffed, only the whole ones that fit count as read. the bits
+		// past them are the bytes that come next, so reading them again later puts the same bits there
+		const uint8_t* bytes = decoder.position;
+		uint64_t value = (uint64_t)ReadBigEndian32(bytes) << 32 | ReadBigEndian32(bytes + 4);
+		if (!HasByteFF(value)) {
+			decoder.bitBuffer |= value >> decoder.bitCount;
+			decoder.position += (63 - decoder.bitCount) >> 3;
+			decoder.bitCount |= 56;
+			return;
+		}
+	}
+
+	JpegFillBitsSlow(decoder);
+}
+
+static int JpegDecodeHuffman(JpegDecoder& decoder, const JpegHuffman& huffman) {
+	if (decoder.bitCount < 16)
+		JpegFillBits(decoder);
+
+	int index = huffman.fast[decoder.bitBuffer >> (64 - jpegFastBits)];
+	if (index < 255) {
+		int size = huffman.sizes[index];
+		decoder.bitBuffer <<= size;
+		decoder.bitCount -= size;
+		return huffman.values[index];
+	}
+
+	uint32_t top = (uint32_t)(decoder.bitBuffer >> 48);
+	int length = jpegFastBits + 1;
+	while (top >= huffman.maxCode[length])
+		length++;
+	if (length == 17)
+		return -1;
+
+	index = (int)(decoder.bitBuffer >> (64 - length)) + huffman.deltas[length];
+	if (index < 0 || index >= huffman.valueCount)
+		return -1;
+
+	decoder.bitBuffer <<= length;
+	decoder.bitCount -= length;
+	return huffman.values[index];
+}
+
+// a coefficient of bitCount bits, the ones with the top bit clear are negative
+static inline int JpegReceiveExtend(JpegDecoder& decoder, int bitCount) {
+	if (bitCount == 0)
+		return 0;
+	if (decoder.bitCount < bitCount)
+		JpegFillBits(decoder);
+
+	uint32_t bits = (uint32_t)(decoder.bitBuffer >> (64 - bitCount));
+	decoder.bitBuffer <<= bitCount;
+	decoder.bitCount -= bitCount;
+	return bits >> (bitCount - 1) ? (int)bits : (int)bits + 1 - (1 << bitCount);
+}
+
+static inline uint32_t JpegReadBits(JpegDecoder& decoder, int bitCount) {
+	if (decoder.bitCount < bitCount)
+		JpegFillBits(decoder);
+
+	uint32_t bits = (uint32_t)(decoder.bitBuffer >> (64 - bitCount));
+	decoder.bitBuffer <<= bitCount;
+	decoder.bitCount -= bitCount;
+	return bits;
+}
+
+static inline bool JpegReadBit(JpegDecoder& decoder) {
+	return JpegReadBits(decoder, 1) != 0;
+}
+
+// the next marker after the current position, anything before it is skipped. 0 at the end of the file
+static int JpegNextMarker(JpegDecoder& decoder) {
+	if (decoder.marker != 0) {
+		int marker = decoder.marker;
+		decoder.marker = 0;
+		return marker;
+	}
+
+	while (decoder.end - decoder.position >= 2) {
+		const uint8_t* bytes = decoder.position;
+		if (bytes[0] == 0xff && bytes[1] != 0x00 && bytes[1] != 0xff) {
+			decoder.position += 2;
+			return bytes[1];
+		}
+		decoder.position++;
+	}
+
+	decoder.position = decoder.end;
+	return 0;
+}
+
+static bool JpegReadSegment(JpegDecoder& decoder, const uint8_t*& data, size_t& size) {
+	if (decoder.end - decoder.position < 2)
+		return false;
+
+	size_t length = ReadBigEndian16(decoder.position);
+	if (length < 2 || length > (size_t)(decoder.end - decoder.position))
+		return false;
+
+	data = decoder.position + 2;
+	size = length - 2;
+	decoder.position += length;
+	return true;
+}
+
+static bool JpegReadQuantTables(JpegDecoder& decoder, const uint8_t* data, size_t size) {
+	while (size > 0) {
+		int precision = data[0] >> 4;
+		int table = data[0] & 15;
+		size_t tableSize = precision == 0 ? 64 : 128;
+		if (precision > 1 || table > 3 || size < 1 + tableSize)
+			return false;
+
+		for (int k = 0; k < 64; ++k)
+			decoder.quant[table][jpegNaturalOrder[k]] = (uint16_t)(precision == 0 ? data[1 + k] : ReadBigEndian16(data + 1 + k * 2));
+
+		data += 1 + tableSize;
+		size -= 1 + tableSize;
+	}
+	return true;
+}
+
+static bool JpegReadHuffmanTables(JpegDecoder& decoder, const uint8_t* data, size_t size) {
+	while (size > 0) {
+		int tableClass = data[0] >> 4;
+		int table = data[0] & 15;
+		if (tableClass > 1 || table > 3 || size < 17)
+			return false;
+
+		int valueCount = 0;
+		for (int i = 0; i < 16; ++i)
+			valueCount += data[1 + i];
+		if (valueCount > 256 || size < 17 + (size_t)valueCount)
+			return false;
+
+		JpegHuffman& huffman = tableClass == 0 ? decoder.dcTables[table] : decoder.acTables[table];
+		memcpy(huffman.values, data + 17, valueCount);
+		if (!BuildJpegHuffman(huffman, data + 1))
+			return false;
+
+		data += 17 + valueCount;
+		size -= 17 + valueCount;
+	}
+	return true;
+}
+
+static bool JpegReadFrame(JpegDecoder& decoder, int marker, const uint8_t* data, size_t size) {
+	if (decoder.frameRead || size < 6)
+		return false;
+
+	int precision = data[0];
+	decoder.height = ReadBigEndian16(data + 1);
+	decoder.width = ReadBigEndian16(data + 3);
+	decoder.componentCount = data[5];
+
+	// the height only coming with a later DNL marker is not taken
+	if (precision != 8 || decoder.width == 0 || decoder.height == 0 || (decoder.componentCount != 1 && decoder.componentCount != 3))
+		return false;
+	if (size < 6 + (size_t)decoder.componentCount * 3)
+		return false;
+
+	decoder.hMax = 1;
+	decoder.vMax = 1;
+	for (int i = 0; i < decoder.componentCount; ++i) {
+		JpegComponent& component = decoder.components[i];
+		const uint8_t* bytes = data + 6 + i * 3;
+		component.id = bytes[0];
+		component.h = bytes[1] >> 4;
+		component.v = bytes[1] & 15;
+		component.quantTable = bytes[2];
+		if (component.h < 1 || component.h > 4 || component.v < 1 || component.v > 4 || component.quantTable > 3)
+			return false;
+
+		decoder.hMax = component.h > decoder.hMax ? component.h : decoder.hMax;
+		decoder.vMax = component.v > decoder.vMax ? component.v : decoder.vMax;
+	}
+
+	uint32_t mcuWidth = decoder.hMax * 8;
+	uint32_t mcuHeight = decoder.vMax * 8;
+	decoder.mcusX = (decoder.width + mcuWidth - 1) / mcuWidth;
+	decoder.mcusY = (decoder.height + mcuHeight - 1) / mcuHeight;
+
+	for (int i = 0; i < decoder.componentCount; ++i) {
+		JpegComponent& component = decoder.components[i];
+
+		// upsampling by a fraction is not taken
+		if (decoder.hMax % component.h != 0 || decoder.vMax % component.v != 0)
+			return false;
+
+		component.width = (decoder.width * component.h + decoder.hMax - 1) / decoder.hMax;
+		component.height = (decoder.height * component.v + decoder.vMax - 1) / decoder.vMax;
+		component.blocksX = decoder.mcusX * component.h;
+		component.blocksY = decoder.mcusY * component.v;
+	}
+
+	decoder.progressive = marker == jpegMarkerSof2;
+	decoder.frameRead = true;
+	return true;
+}
+
+static void JpegReadApp(JpegDecoder& decoder, int marker, const uint8_t* data, size_t size) {
+	if (marker == jpegMarkerApp0 && size >= 5 && memcmp(data, "JFIF\0", 5) == 0)
+		decoder.jfif = true;
+	if (marker == jpegMarkerApp14 && size >= 12 && memcmp(data, "Adobe", 5) == 0)
+		decoder.adobeTransform = data[11];
+}
+
+// the same choice libjpeg makes
+static bool IsJpegRgb(const JpegDecoder& decoder) {
+	if (decoder.componentCount != 3 || decoder.jfif)
+		return false;
+	if (decoder.adobeTransform >= 0)
+		return decoder.adobeTransform == 0;
+	return decoder.components[0].id == 'R' && decoder.components[1].id == 'G' && decoder.components[2].id == 'B';
+}
+
+static bool JpegReadScanHeader(JpegDecoder& decoder, const uint8_t* data, size_t size) {
+	if (!decoder.frameRead || size < 1)
+		return false;
+
+	decoder.scanComponentCount = data[0];
+	if (decoder.scanComponentCount < 1 || decoder.scanComponentCount > decoder.componentCount || size != 4 + (size_t)decoder.scanComponentCount * 2)
+		return false;
+
+	for (int i = 0; i < decoder.scanComponentCount; ++i) {
+		const uint8_t* bytes = data + 1 + i * 2;
+		int index = 0;
+		while (index < decoder.componentCount && decoder.components[index].id != bytes[0])
+			index++;
+		if (index == decoder.componentCount)
+			return false;
+
+		JpegComponent& component = decoder.components[index];
+		component.dcTable = bytes[1] >> 4;
+		component.acTable = bytes[1] & 15;
+		if (component.dcTable > 3 || component.acTable > 3)
+			return false;
+		decoder.scanComponents[i] = index;
+	}
+
+	const uint8_t* progression = data + 1 + decoder.scanComponentCount * 2;
+	decoder.spectralStart = progression[0];
+	decoder.spectralEnd = progression[1];
+	decoder.successiveHigh = progression[2] >> 4;
+	decoder.successiveLow = progression[2] & 15;
+
+	if (decoder.progressive) {
+		if (decoder.spectralStart > decoder.spectralEnd || decoder.spectralEnd > 63 || decoder.successiveHigh > 13 || decoder.successiveLow > 13)
+			return false;
+		// dc scans do not have ac coefficients, ac scans have a single component
+		if (decoder.spectralStart == 0 && decoder.spectralEnd != 0)
+			return false;
+		if (decoder.spectralStart != 0 && decoder.scanComponentCount != 1)
+			return false;
+	}
+
+	for (int i = 0; i < decoder.scanComponentCount; ++i) {
+		const JpegComponent& component = decoder.components[decoder.scanComponents[i]];
+		bool needsDc = !decoder.progressive || (decoder.spectralStart == 0 && decoder.successiveHigh == 0);
+		bool needsAc = !decoder.progressive || decoder.spectralStart != 0;
+		if ((needsDc && !decoder.dcTables[component.dcTable].defined) || (needsAc && !decoder.acTables[component.acTable].defined))
+			return false;
+	}
+
+	return true;
+}
+
+static void JpegResetEntropy(JpegDecoder& decoder) {
+	decoder.bitBuffer = 0;
+	decoder.bitCount = 0;
+	decoder.marker = 0;
+	decoder.eobRun = 0;
+	decoder.restartsLeft = decoder.restartInterval > 0 ? decoder.restartInterval : 0x7fffffff;
+	for (int i = 0; i < decoder.componentCount; ++i)
+		decoder.components[i].dcPrediction = 0;
+}
+
+// after every restart interval. false when the marker is not a restart, the scan ends there
+static bool JpegRestart(JpegDecoder& decoder) {
+	// whatever bits are left in the interval are padding
+	if (decoder.marker == 0)
+		decoder.marker = JpegNextMarker(decoder);
+
+	if (decoder.marker < jpegMarkerRst0 || decoder.marker > jpegMarkerRst7)
+		return false;
+
+	JpegResetEntropy(decoder);
+	return true;
+}
+
+static inline int16_t JpegDequantize(int coefficient, int quant) {
+	return ClampShort(coefficient * quant);
+}
+
+static bool JpegDecodeBlock(JpegDecoder& decoder, JpegComponent& component, int16_t block[64]) {
+	const JpegHuffman& dcTable = decoder.dcTables[component.dcTable];
+	const JpegHuffman& acTable = decoder.acTables[component.acTable];
+	const uint16_t* quant = decoder.quant[component.quantTable];
+
+	int size = JpegDecodeHuffman(decoder, dcTable);
+	if (size < 0 || size > 15)
+		return false;
+
+	memset(block, 0, 64 * sizeof(int16_t));
+	int dc = ClampShort(component.dcPrediction + JpegReceiveExtend(decoder, size));
+	component.dcPrediction = dc;
+	block[0] = JpegDequantize(dc, quant[0]);
+
+	int k = 1;
+	do {
+		if (decoder.bitCount < 16)
+			JpegFillBits(decoder);
+
+		int fast = acTable.fastAc[decoder.bitBuffer >> (64 - jpegFastBits)];
+		if (fast != 0) {
+			// run, code and magnitude in one lookup
+			int bitCount = fast & 15;
+			k += (fast >> 4) & 15;
+			decoder.bitBuffer <<= bitCount;
+			decoder.bitCount -= bitCount;
+
+			int position = jpegNaturalOrder[k++];
+			block[position] = JpegDequantize(fast >> 8, quant[position]);
+			continue;
+		}
+
+		int runSize = JpegDecodeHuffman(decoder, acTable);
+		if (runSize < 0)
+			return false;
+
+		int run = runSize >> 4;
+		size = runSize & 15;
+		if (size == 0) {
+			// end of block, or 16 zeros
+			if (runSize != 0xf0)
+				break;
+			k += 16;
+		}
+		else {
+			k += run;
+			int position = jpegNaturalOrder[k++];
+			block[position] = JpegDequantize(JpegReceiveExtend(decoder, size), quant[position]);
+		}
+	} while (k < 64);
+
+	return true;
+}
+
+static bool JpegDecodeDcProgressive(JpegDecoder& decoder, JpegComponent& component, int16_t* coefficients) {
+	if (decoder.successiveHigh == 0) {
+		int size = JpegDecodeHuffman(decoder, decoder.dcTables[component.dcTable]);
+		if (size < 0 || size > 15)
+			return false;
+
+		int dc = ClampShort(component.dcPrediction + JpegReceiveExtend(decoder, size));
+		component.dcPrediction = dc;
+		coefficients[0] = ClampShort(dc * (1 << decoder.successiveLow));
+	}
+	else if (JpegReadBit(decoder)) {
+		coefficients[0] = (int16_t)(coefficients[0] | (1 << decoder.successiveLow));
+	}
+	return true;
+}
+
+static bool JpegDecodeAcProgressive(JpegDecoder& decoder, JpegComponent& component, int16_t* coefficients) {
+	const JpegHuffman& acTable = decoder.acTables[component.acTable];
+	int spectralEnd = decoder.spectralEnd;
+
+	if (decoder.successiveHigh == 0) {
+		if (decoder.eobRun > 0) {
+			decoder.eobRun--;
+			return true;
+		}
+
+		int k = decoder.spectralStart;
+		while (k <= spectralEnd) {
+			int runSize = JpegDecodeHuffman(decoder, acTable);
+			if (runSize < 0)
+				return false;
+
+			int run = runSize >> 4;
+			int size = runSize & 15;
+			if (size == 0) {
+				if (run < 15) {
+					// this block and the next ones up to the run are done
+					decoder.eobRun = (1 << run) - 1;
+					if (run > 0)
+						decoder.eobRun += JpegReadBits(decoder, run);
+					break;
+				}
+				k += 16;
+			}
+			else {
+				k += run;
+				int position = jpegNaturalOrder[k++];
+				coefficients[position] = ClampShort(JpegReceiveExtend(decoder, size) * (1 << decoder.successiveLow));
+			}
+		}
+		return true;
+	}
+
+	// refinement, coefficients that are already nonzero get a correction bit, zero ones can become +-bit
+	int bit = 1 << decoder.successiveLow;
+	int k = decoder.spectralStart;
+
+	if (decoder.eobRun > 0) {
+		decoder.eobRun--;
+		for (; k <= spectralEnd; ++k) {
+			int16_t& coefficient = coefficients[jpegNaturalOrder[k]];
+			if (coefficient != 0 && JpegReadBit(decoder) && (coefficient & bit) == 0)
+				coefficient = (int16_t)(coefficient > 0 ? coefficient + bit : coefficient - bit);
+		}
+		return true;
+	}
+
+	while (k <= spectralEnd) {
+		int runSize = JpegDecodeHuffman(decoder, acTable);
+		if (runSize < 0)
+			return false;
+
+		int run = runSize >> 4;
+		int size = runSize & 15;
+		int value = 0;
+		if (size == 0) {
+			if (run < 15) {
+				decoder.eobRun = (1 << run) - 1;
+				if (run > 0)
+					decoder.eobRun += JpegReadBits(decoder, run);
+				// the rest of this block only gets correction bits
+				run = 64;
+			}
+		}
+		else {
+			if (size != 1)
+				return false;
+			value = JpegReadBit(decoder) ? bit : -bit;
+		}
+
+		while (k <= spectralEnd) {
+			int16_t& coefficient = coefficients[jpegNaturalOrder[k++]];
+			if (coefficient != 0) {
+				if (JpegReadBit(decoder) && (coefficient & bit) == 0)
+					coefficient = (int16_t)(coefficient > 0 ? coefficient + bit : coefficient - bit);
+			}
+			else {
+				if (run == 0) {
+					coefficient = (int16_t)value;
+					break;
+				}
+				run--;
+			}
+		}
+	}
+	return true;
+}
+
+// one block of the scan at block bx, by of the component
+static bool JpegDecodeScanBlock(JpegDecoder& decoder, JpegComponent& component, uint32_t bx, uint32_t by) {
+	if (!decoder.progressive) {
+		int16_t block[64];
+		if (!JpegDecodeBlock(decoder, component, block))
+			return false;
+
+		size_t stride = (size_t)component.blocksX * 8;
+		decoder.idct(block, &component.plane[(size_t)by * 8 * stride + bx * 8], stride);
+		return true;
+	}
+
+	int16_t* coefficients = &component.coefficients[((size_t)by * component.blocksX + bx) * 64];
+	if (decoder.spectralStart == 0)
+		return JpegDecodeDcProgressive(decoder, component, coefficients);
+	return JpegDecodeAcProgressive(decoder, component, coefficients);
+}
+
+static void JpegAllocatePlanes(JpegDecoder& decoder) {
+	for (int i = 0; i < decoder.componentCount; ++i) {
+		JpegComponent& component = decoder.components[i];
+		size_t blockCount = (size_t)component.blocksX * component.blocksY;
+		if (decoder.progressive)
+			component.coefficients.assign(blockCount * 64, 0);
+		component.plane.assign(blockCount * 64, 0);
+	}
+	decoder.planesAllocated = true;
+}
+
+static bool JpegDecodeScan(JpegDecoder& decoder) {
+	if (!decoder.planesAllocated)
+		JpegAllocatePlanes(decoder);
+
+	JpegResetEntropy(decoder);
+
+	if (decoder.scanComponentCount == 1) {
+		// not interleaved, every block of the component that has samples is an mcu
+		JpegComponent& component = decoder.components[decoder.scanComponents[0]];
+		uint32_t blocksX = (component.width + 7) / 8;
+		uint32_t blocksY = (component.height + 7) / 8;
+
+		for (uint32_t by = 0; by < blocksY; ++by) {
+			for (uint32_t bx = 0; bx < blocksX; ++bx) {
+				if (!JpegDecodeScanBlock(decoder, component, bx, by))
+					return false;
+
+				if (--decoder.restartsLeft <= 0 && !JpegRestart(decoder))
+					return true;
+			}
+		}
+		return true;
+	}
+
+	for (uint32_t mcuY = 0; mcuY < decoder.mcusY; ++mcuY) {
+		for (uint32_t mcuX = 0; mcuX < decoder.mcusX; ++mcuX) {
+			for (int i = 0; i < decoder.scanComponentCount; ++i) {
+				JpegComponent& component = decoder.components[decoder.scanComponents[i]];
+				for (int y = 0; y < component.v; ++y) {
+					for (int x = 0; x < component.h; ++x) {
+						if (!JpegDecodeScanBlock(decoder, component, mcuX * component.h + x, mcuY * component.v + y))
+							return false;
+					}
+				}
+			}
+
+			if (--decoder.restartsLeft <= 0 && !JpegRestart(decoder))
+				return true;
+		}
+	}
+	return true;
+}
+
+// progressive coefficients are only complete after the last scan
+static void JpegFinishProgressive(JpegDecoder& decoder) {
+	for (int i = 0; i < decoder.componentCount; ++i) {
+		JpegComponent& component = decoder.components[i];
+		const uint16_t* quant = decoder.quant[component.quantTable];
+		size_t stride = (size_t)component.blocksX * 8;
+		uint32_t blocksX = (component.width + 7) / 8;
+		uint32_t blocksY = (component.height + 7) / 8;
+
+		for (uint32_t by = 0; by < blocksY; ++by) {
+			for (uint32_t bx = 0; bx < blocksX; ++bx) {
+				const int16_t* coefficients = &component.coefficients[((size_t)by * component.blocksX + bx) * 64];
+				int16_t block[64];
+				for (int k = 0; k < 64; ++k)
+					block[k] = JpegDequantize(coefficients[k], quant[k]);
+				decoder.idct(block, &component.plane[(size_t)by * 8 * stride + bx * 8], stride);
+			}
+		}
+	}
+}
+
+// reads segments until the frame header when headerOnly, otherwise decodes every scan up to the end of the image
+static bool JpegReadSegments(JpegDecoder& decoder, bool headerOnly) {
+	if (decoder.end - decoder.position < 2 || decoder.position[0] != 0xff || decoder.position[1] != jpegMarkerSoi)
+		return false;
+	decoder.position += 2;
+
+	for (;;) {
+		int marker = JpegNextMarker(decoder);
+		// a file that ends without EOI still has every scan it got to
+		if (marker == 0 || marker == jpegMarkerEoi)
+			return decoder.scanDecoded;
+		if (marker >= jpegMarkerRst0 && marker <= jpegMarkerRst7)
+			continue;
+
+		const uint8_t* data;
+		size_t size;
+		if (!JpegReadSegment(decoder, data, size))
+			return false;
+
+		switch (marker) {
+		case jpegMarkerSof0:
+		case jpegMarkerSof1:
+		case jpegMarkerSof2:
+			if (!JpegReadFrame(decoder, marker, data, size))
+				return false;
+			if (headerOnly)
+				return true;
+			break;
+		case jpegMarkerDht:
+			if (!JpegReadHuffmanTables(decoder, data, size))
+				return false;
+			break;
+		case jpegMarkerDqt:
+			if (!JpegReadQuantTables(decoder, data, size))
+				return false;
+			break;
+		case jpegMarkerDri:
+			if (size < 2)
+				return false;
+			decoder.restartInterval = ReadBigEndian16(data);
+			break;
+		case jpegMarkerSos:
+			if (!JpegReadScanHeader(decoder, data, size) || !JpegDecodeScan(decoder))
+				return false;
+			decoder.scanDecoded = true;
+			break;
+		default:
+			// lossless, hierarchical and arithmetic coded frames, and DNL
+			if ((marker >= 0xc3 && marker <= 0xcf) || marker == 0xdc)
+				return false;
+			if (marker >= jpegMarkerApp0 && marker <= 0xef)
+				JpegReadApp(decoder, marker, data, size);
+			break;
+		}
+	}
+}
+
+static void JpegIdctScalar(const int16_t* coefficients, uint8_t* out, size_t outStride);
+#ifdef IMAGE_DECODER_SSE
+static void JpegIdctSse2(const int16_t* coefficients, uint8_t* out, size_t outStride);
+#endif
+
+static void JpegDecoderInit(JpegDecoder& decoder, const uint8_t* file, size_t fileSize, ImageDecodePath path) {
+	decoder.position = file;
+	decoder.end = file + fileSize;
+	decoder.adobeTransform = -1;
+
+#ifdef IMAGE_DECODER_SSE
+	decoder.simd = path == IMAGE_DECODE_SIMD;
+	decoder.idct = decoder.simd ? JpegIdctSse2 : JpegIdctScalar;
+#else
+	(void)path;
+	decoder.simd = false;
+	decoder.idct = JpegIdctScalar;
+#endif
+}
+
+// idct
+
+// one 8 point idct, even inputs and odd inputs are combined at the end and the bias goes into the even part
+static inline void JpegIdct1D(int s0, int s1, int s2, int s3, int s4, int s5, int s6, int s7, int bias, int out[8]) {
+	int p1 = (s2 + s6) * jpegIdctC0541;
+	int t2 = p1 + s6 * jpegIdctCm1847;
+	int t3 = p1 + s2 * jpegIdctC0765;
+	int t0 = (s0 + s4) * 4096 + bias;
+	int t1 = (s0 - s4) * 4096 + bias;
+	int x0 = t0 + t3;
+	int x3 = t0 - t3;
+	int x1 = t1 + t2;
+	int x2 = t1 - t2;
+
+	int p3 = s7 + s3;
+	int p4 = s5 + s1;
+	int p5 = (p3 + p4) * jpegIdctC1175;
+	int q1 = p5 + (s7 + s1) * jpegIdctCm0899;
+	int q2 = p5 + (s5 + s3) * jpegIdctCm2562;
+	p3 *= jpegIdctCm1961;
+	p4 *= jpegIdctCm0390;
+	int o0 = s7 * jpegIdctC0298 + q1 + p3;
+	int o1 = s5 * jpegIdctC2053 + q2 + p4;
+	int o2 = s3 * jpegIdctC3072 + q2 + p3;
+	int o3 = s1 * jpegIdctC1501 + q1 + p4;
+
+	out[0] = x0 + o3;
+	out[7] = x0 - o3;
+	out[1] = x1 + o2;
+	out[6] = x1 - o2;
+	out[2] = x2 + o1;
+	out[5] = x2 - o1;
+	out[3] = x3 + o0;
+	out[4] = x3 - o0;
+}
+
+// the columns saturate to 16 bits between the passes like the sse2 version packs them
+static void JpegIdctScalar(const int16_t* coefficients, uint8_t* out, size_t outStride) {
+	int16_t columns[64];
+	int values[8];
+
+	for (int i = 0; i < 8; ++i) {
+		const int16_t* s = coefficients + i;
+		if (s[8] == 0 && s[16] == 0 && s[24] == 0 && s[32] == 0 && s[40] == 0 && s[48] == 0 && s[56] == 0) {
+			int16_t dc = ClampShort(s[0] * 4);
+			for (int k = 0; k < 8; ++k)
+				columns[k * 8 + i] = dc;
+			continue;
+		}
+
+		JpegIdct1D(s[0], s[8], s[16], s[24], s[32], s[40], s[48], s[56], jpegIdctColumnBias, values);
+		for (int k = 0; k < 8; ++k)
+			columns[k * 8 + i] = ClampShort(values[k] >> 10);
+	}
+
+	for (int i = 0; i < 8; ++i) {
+		const int16_t* s = columns + i * 8;
+		JpegIdct1D(s[0], s[1], s[2], s[3], s[4], s[5], s[6], s[7], jpegIdctRowBias, values);
+
+		uint8_t* row = out + i * outStride;
+		for (int k = 0; k < 8; ++k)
+			row[k] = ClampByte(values[k] >> 17);
+	}
+}
+
+#ifdef IMAGE_DECODER_SSE
+struct JpegWide {
+	__m128i lo;
+	__m128i hi;
+};
+
+// x * c0[even] + y * c0[odd] and the same with c1, in 32 bits
+static inline void JpegRotate(__m128i x, __m128i y, __m128i c0, __m128i c1, JpegWide& out0, JpegWide& out1) {
+	__m128i lo = _mm_unpacklo_epi16(x, y);
+	__m128i hi = _mm_unpackhi_epi16(x, y);
+	out0.lo = _mm_madd_epi16(lo, c0);
+	out0.hi = _mm_madd_epi16(hi, c0);
+	out1.lo = _mm_madd_epi16(lo, c1);
+	out1.hi = _mm_madd_epi16(hi, c1);
+}
+
+// x << 12 in 32 bits
+static inline JpegWide JpegWiden(__m128i x) {
+	JpegWide wide;
+	wide.lo = _mm_srai_epi32(_mm_unpacklo_epi16(_mm_setzero_si128(), x), 4);
+	wide.hi = _mm_srai_epi32(_mm_unpackhi_epi16(_mm_setzero_si128(), x), 4);
+	return wide;
+}
+
+static inline JpegWide JpegAdd(const JpegWide& a, const JpegWide& b) {
+	JpegWide sum;
+	sum.lo = _mm_add_epi32(a.lo, b.lo);
+	sum.hi = _mm_add_epi32(a.hi, b.hi);
+	return sum;
+}
+
+static inline JpegWide JpegSubtract(const JpegWide& a, const JpegWide& b) {
+	JpegWide difference;
+	difference.lo = _mm_sub_epi32(a.lo, b.lo);
+	difference.hi = _mm_sub_epi32(a.hi, b.hi);
+	return difference;
+}
+
+template <int shift>
+static inline void JpegButterfly(const JpegWide& even, const JpegWide& odd, __m128i bias, __m128i& out0, __m128i& out1) {
+	__m128i lo = _mm_add_epi32(even.lo, bias);
+	__m128i hi = _mm_add_epi32(even.hi, bias);
+	out0 = _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(lo, odd.lo), shift), _mm_srai_epi32(_mm_add_epi32(hi, odd.hi), shift));
+	out1 = _mm_packs_epi32(_mm_srai_epi32(_mm_sub_epi32(lo, odd.lo), shift), _mm_srai_epi32(_mm_sub_epi32(hi, odd.hi), shift));
+}
+
+// JpegIdct1D on the 8 lanes of the rows at once
+template <int shift>
+static inline void JpegIdctPass(__m128i rows[8], __m128i bias) {
+	const __m128i rotate0a = _mm_setr_epi16(jpegIdctC0541, jpegIdctC0541 + jpegIdctCm1847, jpegIdctC0541, jpegIdctC0541 + jpegIdctCm1847,
+		jpegIdctC0541, jpegIdctC0541 + jpegIdctCm1847, jpegIdctC0541, jpegIdctC0541 + jpegIdctCm1847);
+	const __m128i rotate0b = _mm_setr_epi16(jpegIdctC0541 + jpegIdctC0765, jpegIdctC0541, jpegIdctC0541 + jpegIdctC0765, jpegIdctC0541,
+		jpegIdctC0541 + jpegIdctC0765, jpegIdctC0541, jpegIdctC0541 + jpegIdctC0765, jpegIdctC0541);
+	const __m128i rotate1a = _mm_setr_epi16(jpegIdctC1175 + jpegIdctCm0899, jpegIdctC1175, jpegIdctC1175 + jpegIdctCm0899, jpegIdctC1175,
+		jpegIdctC1175 + jpegIdctCm0899, jpegIdctC1175, jpegIdctC1175 + jpegIdctCm0899, jpegIdctC1175);
+	const __m128i rotate1b = _mm_setr_epi16(jpegIdctC1175, jpegIdctC1175 + jpegIdctCm2562, jpegIdctC1175, jpegIdctC1175 + jpegIdctCm2562,
+		jpegIdctC1175, jpegIdctC1175 + jpegIdctCm2562, jpegIdctC1175, jpegIdctC1175 + jpegIdctCm2562);
+	const __m128i rotate2a = _mm_setr_epi16(jpegIdctCm1961 + jpegIdctC0298, jpegIdctCm1961, jpegIdctCm1961 + jpegIdctC0298, jpegIdctCm1961,
+		jpegIdctCm1961 + jpegIdctC0298, jpegIdctCm1961, jpegIdctCm1961 + jpegIdctC0298, jpegIdctCm1961);
+	const __m128i rotate2b = _mm_setr_epi16(jpegIdctCm1961, jpegIdctCm1961 + jpegIdctC3072, jpegIdctCm1961, jpegIdctCm1961 + jpegIdctC3072,
+		jpegIdctCm1961, jpegIdctCm1961 + jpegIdctC3072, jpegIdctCm1961, jpegIdctCm1961 + jpegIdctC3072);
+	const __m128i rotate3a = _mm_setr_epi16(jpegIdctCm0390 + jpegIdctC2053, jpegIdctCm0390, jpegIdctCm0390 + jpegIdctC2053, jpegIdctCm0390,
+		jpegIdctCm0390 + jpegIdctC2053, jpegIdctCm0390, jpegIdctCm0390 + jpegIdctC2053, jpegIdctCm0390);
+	const __m128i rotate3b = _mm_setr_epi16(jpegIdctCm0390, jpegIdctCm0390 + jpegIdctC1501, jpegIdctCm0390, jpegIdctCm0390 + jpegIdctC1501,
+		jpegIdctCm0390, jpegIdctCm0390 + jpegIdctC1501, jpegIdctCm0390, jpegIdctCm0390 + jpegIdctC1501);
+
+	// even part
+	JpegWide t2, t3;
+	JpegRotate(rows[2], rows[6], rotate0a, rotate0b, t2, t3);
+	JpegWide t0 = JpegWiden(_mm_add_epi16(rows[0], rows[4]));
+	JpegWide t1 = JpegWiden(_mm_sub_epi16(rows[0], rows[4]));
+	JpegWide x0 = JpegAdd(t0, t3);
+	JpegWide x3 = JpegSubtract(t0, t3);
+	JpegWide x1 = JpegAdd(t1, t2);
+	JpegWide x2 = JpegSubtract(t1, t2);
+
+	// odd part
+	JpegWide y0, y1, y2, y3, y4, y5;
+	JpegRotate(rows[7], rows[3], rotate2a, rotate2b, y0, y2);
+	JpegRotate(rows[5], rows[1], rotate3a, rotate3b, y1, y3);
+	JpegRotate(_mm_add_epi16(rows[1], rows[7]), _mm_add_epi16(rows[3], rows[5]), rotate1a, rotate1b, y4, y5);
+	JpegWide o0 = JpegAdd(y0, y4);
+	JpegWide o1 = JpegAdd(y1, y5);
+	JpegWide o2 = JpegAdd(y2, y5);
+	JpegWide o3 = JpegAdd(y3, y4);
+
+	JpegButterfly<shift>(x0, o3, bias, rows[0], rows[7]);
+	JpegButterfly<shift>(x1, o2, bias, rows[1], rows[6]);
+	JpegButterfly<shift>(x2, o1, bias, rows[2], rows[5]);
+	JpegButterfly<shift>(x3, o0, bias, rows[3], rows[4]);
+}
+
+static inline void JpegInterleave16(__m128i& a, __m128i& b) {
+	__m128i lo = _mm_unpacklo_epi16(a, b);
+	b = _mm_unpackhi_epi16(a, b);
+	a = lo;
+}
+
+static inline void JpegInterleave8(__m128i& a, __m128i& b) {
+	__m128i lo = _mm_unpacklo_epi8(a, b);
+	b = _mm_unpackhi_epi8(a, b);
+	a = lo;
+}
+
+static void JpegIdctSse2(const int16_t* coefficients, uint8_t* out, size_t outStride) {
+	__m128i rows[8];
+	for (int i = 0; i < 8; ++i)
+		rows[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(coefficients + i * 8));
+
+	// columns, then transpose so the rows go through the same pass
+	JpegIdctPass<10>(rows, _mm_set1_epi32(jpegIdctColumnBias));
+
+	JpegInterleave16(rows[0], rows[4]);
+	JpegInterleave16(rows[1], rows[5]);
+	JpegInterleave16(rows[2], rows[6]);
+	JpegInterleave16(rows[3], rows[7]);
+	JpegInterleave16(rows[0], rows[2]);
+	JpegInterleave16(rows[1], rows[3]);
+	JpegInterleave16(rows[4], rows[6]);
+	JpegInterleave16(rows[5], rows[7]);
+	JpegInterleave16(rows[0], rows[1]);
+	JpegInterleave16(rows[2], rows[3]);
+	JpegInterleave16(rows[4], rows[5]);
+	JpegInterleave16(rows[6], rows[7]);
+
+	JpegIdctPass<17>(rows, _mm_set1_epi32(jpegIdctRowBias));
+
+	// to bytes and transposed back, two rows per register
+	__m128i p0 = _mm_packus_epi16(rows[0], rows[1]);
+	__m128i p1 = _mm_packus_epi16(rows[2], rows[3]);
+	__m128i p2 = _mm_packus_epi16(rows[4], rows[5]);
+	__m128i p3 = _mm_packus_epi16(rows[6], rows[7]);
+	JpegInterleave8(p0, p2);
+	JpegInterleave8(p1, p3);
+	JpegInterleave8(p0, p1);
+	JpegInterleave8(p2, p3);
+	JpegInterleave8(p0, p2);
+	JpegInterleave8(p1, p3);
+
+	const __m128i* pairs[4] = { &p0, &p2, &p1, &p3 };
+	for (int i = 0; i < 4; ++i) {
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(out), *pairs[i]);
+		out += outStride;
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_shuffle_epi32(*pairs[i], 0x4e));
+		out += outStride;
+	}
+}
+#endif
+
+// upsampling and color conversion
+
+// triangle filter that doubles a row of sums, sums[-1] and sums[width] repeat the edges. every output pixel takes
+// 3/4 of its own sum and 1/4 of its neighbour's, biased like libjpeg so the rounding alternates
+template <int shift>
+static void JpegUpsampleTriangle(const int16_t* sums, uint32_t width, int evenBias, int oddBias, bool simd, uint8_t* out) {
+	uint32_t i = 0;
+#ifdef IMAGE_DECODER_SSE
+	if (simd) {
+		__m128i evenBias16 = _mm_set1_epi16((int16_t)evenBias);
+		__m128i oddBias16 = _mm_set1_epi16((int16_t)oddBias);
+		for (; i + 8 <= width; i += 8) {
+			__m128i previous = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sums + i - 1));
+			__m128i current = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sums + i));
+			__m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sums + i + 1));
+			__m128i current3 = _mm_add_epi16(current, _mm_add_epi16(current, current));
+
+			__m128i even = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(current3, previous), evenBias16), shift);
+			__m128i odd = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(current3, next), oddBias16), shift);
+			__m128i pixels = _mm_packus_epi16(_mm_unpacklo_epi16(even, odd), _mm_unpackhi_epi16(even, odd));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2), pixels);
+		}
+	}
+#else
+	(void)simd;
+#endif
+	for (; i < width; ++i) {
+		const int16_t* sum = sums + i;
+		int current3 = sum[0] * 3;
+		out[i * 2] = (uint8_t)((current3 + sum[-1] + evenBias) >> shift);
+		out[i * 2 + 1] = (uint8_t)((current3 + sum[1] + oddBias) >> shift);
+	}
+}
+
+// near * 3 + far, the vertical half of the 2x2 triangle filter
+static void JpegSumRows(const uint8_t* nearRow, const uint8_t* farRow, uint32_t width, bool simd, int16_t* sums) {
+	uint32_t i = 0;
+#ifdef IMAGE_DECODER_SSE
+	if (simd) {
+		__m128i zero = _mm_setzero_si128();
+		for (; i + 16 <= width; i += 16) {
+			__m128i nearBytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(nearRow + i));
+			__m128i farBytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(farRow + i));
+			__m128i nearLo = _mm_unpacklo_epi8(nearBytes, zero);
+			__m128i nearHi = _mm_unpackhi_epi8(nearBytes, zero);
+			__m128i lo = _mm_add_epi16(_mm_add_epi16(nearLo, _mm_add_epi16(nearLo, nearLo)), _mm_unpacklo_epi8(farBytes, zero));
+			__m128i hi = _mm_add_epi16(_mm_add_epi16(nearHi, _mm_add_epi16(nearHi, nearHi)), _mm_unpackhi_epi8(farBytes, zero));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(sums + i), lo);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(sums + i + 8), hi);
+		}
+	}
+#else
+	(void)simd;
+#endif
+	for (; i < width; ++i)
+		sums[i] = (int16_t)(nearRow[i] * 3 + farRow[i]);
+}
+
+// the component's row at full resolution, upsampled into row when it is subsampled
+// sums has room for the component's width and two more
+static const uint8_t* JpegGetFullRow(const JpegDecoder& decoder, const JpegComponent& component, uint32_t y, uint8_t* row, int16_t* sums) {
+	size_t stride = (size_t)component.blocksX * 8;
+	int factorX = decoder.hMax / component.h;
+	int factorY = decoder.vMax / component.v;
+	uint32_t width = component.width;
+
+	if (factorX == 1 && factorY == 1)
+		return &component.plane[y * stride];
+
+	uint32_t sourceY = y / factorY;
+	const uint8_t* nearRow = &component.plane[sourceY * stride];
+
+	if (factorY == 2) {
+		// the row above for the top output row of a pair, the one below for the bottom one, edges repeat
+		uint32_t farY = (y & 1) ? (sourceY + 1 < component.height ? sourceY + 1 : sourceY) : (sourceY > 0 ? sourceY - 1 : 0);
+		const uint8_t* farRow = &component.plane[farY * stride];
+
+		if (factorX == 2 && width > 2) {
+			JpegSumRows(nearRow, farRow, width, decoder.simd, sums + 1);
+			sums[0] = sums[1];
+			sums[width + 1] = sums[width];
+			JpegUpsampleTriangle<4>(sums + 1, width, 8, 7, decoder.simd, row);
+			return row;
+		}
+
+		if (factorX == 1) {
+			int bias = (y & 1) ? 2 : 1;
+			for (uint32_t i = 0; i < width; ++i)
+				row[i] = (uint8_t)((nearRow[i] * 3 + farRow[i] + bias) >> 2);
+			return row;
+		}
+	}
+
+	if (factorY == 1 && factorX == 2 && width > 2) {
+		for (uint32_t i = 0; i < width; ++i)
+			sums[i + 1] = nearRow[i];
+		sums[0] = sums[1];
+		sums[width + 1] = sums[width];
+		JpegUpsampleTriangle<2>(sums + 1, width, 1, 2, decoder.simd, row);
+		return row;
+	}
+
+	// any other factor repeats the samples
+	for (uint32_t i = 0; i < width; ++i) {
+		for (int j = 0; j < factorX; ++j)
+			row[i * factorX + j] = nearRow[i];
+	}
+	return row;
+}
+
+static void JpegYCbCrToRgba(const uint8_t* luma, const uint8_t* blue, const uint8_t* red, uint32_t width, bool simd, uint8_t* out) {
+	uint32_t i = 0;
+#ifdef IMAGE_DECODER_SSE
+	if (simd) {
+		__m128i zero = _mm_setzero_si128();
+		__m128i signFlip = _mm_set1_epi8(-0x80);
+		__m128i lumaBias = _mm_set1_epi8((char)0x80);
+		__m128i crToR = _mm_set1_epi16((int16_t)jpegCrToR);
+		__m128i crToG = _mm_set1_epi16((int16_t)jpegCrToG);
+		__m128i cbToG = _mm_set1_epi16((int16_t)jpegCbToG);
+		__m128i cbToB = _mm_set1_epi16((int16_t)jpegCbToB);
+		__m128i alpha = _mm_set1_epi16(255);
+
+		for (; i + 8 <= width; i += 8) {
+			// luma * 16 + 8, chroma - 128 in the high byte
+			__m128i y = _mm_srli_epi16(_mm_unpacklo_epi8(lumaBias, _mm_loadl_epi64(reinterpret_cast<const __m128i*>(luma + i))), 4);
+			__m128i cb = _mm_unpacklo_epi8(zero, _mm_xor_si128(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(blue + i)), signFlip));
+			__m128i cr = _mm_unpacklo_epi8(zero, _mm_xor_si128(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(red + i)), signFlip));
+
+			__m128i r = _mm_srai_epi16(_mm_add_epi16(y, _mm_mulhi_epi16(cr, crToR)), 4);
+			__m128i g = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(y, _mm_mulhi_epi16(cb, cbToG)), _mm_mulhi_epi16(cr, crToG)), 4);
+			__m128i b = _mm_srai_epi16(_mm_add_epi16(y, _mm_mulhi_epi16(cb, cbToB)), 4);
+
+			__m128i rb = _mm_packus_epi16(r, b);
+			__m128i ga = _mm_packus_epi16(g, alpha);
+			__m128i rgLo = _mm_unpacklo_epi8(rb, ga);
+			__m128i baLo = _mm_unpackhi_epi8(rb, ga);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 4), _mm_unpacklo_epi16(rgLo, baLo));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 4 + 16), _mm_unpackhi_epi16(rgLo, baLo));
+		}
+	}
+#else
+	(void)simd;
+#endif
+	for (; i < width; ++i) {
+		int y = luma[i] * 16 + 8;
+		int cb = (blue[i] - 128) * 256;
+		int cr = (red[i] - 128) * 256;
+		uint8_t* pixel = out + i * 4;
+		pixel[0] = ClampByte((y + ((cr * jpegCrToR) >> 16)) >> 4);
+		pixel[1] = ClampByte((y + ((cb * jpegCbToG) >> 16) + ((cr * jpegCrToG) >> 16)) >> 4);
+		pixel[2] = ClampByte((y + ((cb * jpegCbToB) >> 16)) >> 4);
+		pixel[3] = 255;
+	}
+}
+
+static void JpegWritePixels(const JpegDecoder& decoder, uint8_t* pixels, size_t rowPitch) {
+	if (decoder.componentCount == 1) {
+		const JpegComponent& component = decoder.components[0];
+		size_t stride = (size_t)component.blocksX * 8;
+		for (uint32_t y = 0; y < decoder.height; ++y)
+			memcpy(pixels + y * rowPitch, &component.plane[y * stride], decoder.width);
+		return;
+	}
+
+	// upsampled rows are written in pairs of samples and vectors, so they get some room past the image
+	size_t rowSize = (size_t)decoder.mcusX * decoder.hMax * 8 + 32;
+	std::vector<uint8_t> rows(rowSize * 3);
+	std::vector<int16_t> sums(rowSize + 2);
+	bool rgb = IsJpegRgb(decoder);
+
+	for (uint32_t y = 0; y < decoder.height; ++y) {
+		const uint8_t* channels[3];
+		for (int c = 0; c < 3; ++c)
+			channels[c] = JpegGetFullRow(decoder, decoder.components[c], y, &rows[rowSize * c], &sums[0]);
+
+		uint8_t* out = pixels + y * rowPitch;
+		if (!rgb) {
+			JpegYCbCrToRgba(channels[0], channels[1], channels[2], decoder.width, decoder.simd, out);
+			continue;
+		}
+
+		for (uint32_t x = 0; x < decoder.width; ++x) {
+			out[x * 4] = channels[0][x];
+			out[x * 4 + 1] = channels[1][x];
+			out[x * 4 + 2] = channels[2][x];
+			out[x * 4 + 3] = 255;
+		}
+	}
+}
+
+static bool GetJpegInfo(const uint8_t* file, size_t fileSize, ImageInfo& info) {
+	JpegDecoder decoder{};
+	JpegDecoderInit(decoder, file, fileSize, IMAGE_DECODE_SCALAR);
+	if (!JpegReadSegments(decoder, true))
+		return false;
+
+	info.type = IMAGE_FILE_JPEG;
+	info.format = decoder.componentCount == 1 ? DECODED_IMAGE_FORMAT_R8_UNORM : DECODED_IMAGE_FORMAT_R8G8B8A8_UNORM;
+	info.width = decoder.width;
+	info.height = decoder.height;
+	return IsDecodedImageSizeValid(info.width, info.height, info.format);
+}
+
+static bool DecodeJpeg(const uint8_t* file, size_t fileSize, ImageDecodePath path, uint8_t* pixels, size_t rowPitch) {
+	JpegDecoder decoder{};
+	JpegDecoderInit(decoder, file, fileSize, path);
+	if (!JpegReadSegments(decoder, false))
+		return false;
+
+	if (decoder.progressive)
+		JpegFinishProgressive(decoder);
+
+	JpegWritePixels(decoder, pixels, rowPitch);
+	return true;
+}
+
+// png
+
+const uint32_t pngChunkIhdr = 0x49484452;
+const uint32_t pngChunkPlte = 0x504c5445;
+const uint32_t pngChunkTrns = 0x74524e53;
+const uint32_t pngChunkIdat = 0x49444154;
+const uint32_t pngChunkIend = 0x49454e44;
+
+enum PngColorType {
+	PNG_COLOR_GRAY = 0,
+	PNG_COLOR_RGB = 2,
+	PNG_COLOR_PALETTE = 3,
+	PNG_COLOR_GRAY_ALPHA = 4,
+	PNG_COLOR_RGBA = 6,
+};
+
+// adam7 passes, first column and row and the steps between them
+static const uint32_t pngPassStartX[7] = { 0, 4, 0, 2, 0, 1, 0 };
+static const uint32_t pngPassStartY[7] = { 0, 0, 4, 0, 2, 0, 1 };
+static const uint32_t pngPassStepX[7] = { 8, 8, 4, 4, 2, 2, 1 };
+static const uint32_t pngPassStepY[7] = { 8, 8, 8, 4, 4, 2, 2 };
+
+struct PngImage {
+	uint32_t width;
+	uint32_t height;
+	int bitDepth;
+	int colorType;
+	bool interlaced;
+	int bitsPerPixel;
+	DecodedImageFormat format;
+
+	// rgba of every palette entry, entries past the palette are opaque black
+	uint8_t palette[256][4];
+	bool hasPalette;
+	// the color that is transparent for gray and rgb, in the file's bit depth
+	bool hasColorKey;
+	uint16_t colorKey[3];
+
+	// zlib stream, in place when it is in one IDAT chunk, otherwise gathered from all of them
+	const uint8_t* data;
+	size_t dataSize;
+	std::vector<uint8_t> gatheredData;
+};
+
+struct PngCrcTable {
+	// slicing by 8
+	uint32_t entries[8][256];
+
+	PngCrcTable() {
+		for (uint32_t i = 0; i < 256; ++i) {
+			uint32_t crc = i;
+			for (int bit = 0; bit < 8; ++bit)
+				crc = crc & 1 ? 0xedb88320 ^ (crc >> 1) : crc >> 1;
+			entries[0][i] = crc;
+		}
+		for (uint32_t i = 0; i < 256; ++i) {
+			for (int slice = 1; slice < 8; ++slice)
+				entries[slice][i] = (entries[slice - 1][i] >> 8) ^ entries[0][entries[slice - 1][i] & 255];
+		}
+	}
+};
+
+static uint32_t ComputeCrc32(const uint8_t* data, size_t size) {
+	// built once, thread safe since c++11
+	static const PngCrcTable table;
+
+	uint32_t crc = 0xffffffff;
+	for (; size >= 8; size -= 8, data += 8) {
+		crc ^= (uint32_t)data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+		crc = table.entries[7][crc & 255] ^ table.entries[6][(crc >> 8) & 255] ^ table.entries[5][(crc >> 16) & 255] ^ table.entries[4][crc >> 24] ^
+			table.entries[3][data[4]] ^ table.entries[2][data[5]] ^ table.entries[1][data[6]] ^ table.entries[0][data[7]];
+	}
+	for (; size > 0; --size, ++data)
+		crc = table.entries[0][(crc ^ *data) & 255] ^ (crc >> 8);
+	return crc ^ 0xffffffff;
+}
+
+static uint32_t ComputeAdler32(const uint8_t* data, size_t size) {
+	uint32_t a = 1;
+	uint32_t b = 0;
+	while (size > 0) {
+		// the largest run whose sums cannot overflow 32 bits before the modulo
+		size_t count = size < 5552 ? size : 5552;
+		size -= count;
+		for (; count >= 4; count -= 4, data += 4) {
+			a += data[0];
+			b += a;
+			a += data[1];
+			b += a;
+			a += data[2];
+			b += a;
+			a += data[3];
+			b += a;
+		}
+		for (; count > 0; --count, ++data) {
+			a += *data;
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+	}
+	return b << 16 | a;
+}
+
+static bool IsPngBitDepthValid(int colorType, int bitDepth) {
+	switch (colorType) {
+	case PNG_COLOR_GRAY:
+		return bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8 || bitDepth == 16;
+	case PNG_COLOR_PALETTE:
+		return bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8;
+	case PNG_COLOR_RGB:
+	case PNG_COLOR_GRAY_ALPHA:
+	case PNG_COLOR_RGBA:
+		return bitDepth == 8 || bitDepth == 16;
+	default:
+		return false;
+	}
+}
+
+// what wic gives for the file, after converting what dxgi does not have
+static DecodedImageFormat GetPngFormat(int colorType, int bitDepth, bool hasColorKey) {
+	switch (colorType) {
+	case PNG_COLOR_GRAY:
+		if (hasColorKey)
+			return bitDepth == 16 ? DECODED_IMAGE_FORMAT_R16G16B16A16_UNORM : DECODED_IMAGE_FORMAT_B8G8R8A8_UNORM;
+		return bitDepth == 16 ? DECODED_IMAGE_FORMAT_R16_UNORM : DECODED_IMAGE_FORMAT_R8_UNORM;
+	case PNG_COLOR_RGB:
+		if (bitDepth == 16)
+			return DECODED_IMAGE_FORMAT_R16G16B16A16_UNORM;
+		return hasColorKey ? DECODED_IMAGE_FORMAT_B8G8R8A8_UNORM : DECODED_IMAGE_FORMAT_R8G8B8A8_UNORM;
+	case PNG_COLOR_PALETTE:
+		return DECODED_IMAGE_FORMAT_R8G8B8A8_UNORM;
+	default:
+		return bitDepth == 16 ? DECODED_IMAGE_FORMAT_R16G16B16A16_UNORM : DECODED_IMAGE_FORMAT_B8G8R8A8_UNORM;
+	}
+}
+
+// walks the chunks up to the image data when headerOnly, otherwise to the end and gathers the image data
+static bool ReadPngChunks(const uint8_t* file, size_t fileSize, bool headerOnly, PngImage& png) {
+	const uint8_t* position = file + 8;
+	const uint8_t* end = file + fileSize;
+	bool headerRead = false;
+	size_t idatCount = 0;
+	png.data = NULL;
+	png.dataSize = 0;
+	png.hasPalette = false;
+	png.hasColorKey = false;
+
+	for (;;) {
+		if (end - position < 12)
+			return false;
+
+		uint32_t length = ReadBigEndian32(position);
+		uint32_t type = ReadBigEndian32(position + 4);
+		if (length > (size_t)(end - position) - 12)
+			return false;
+
+		const uint8_t* data = position + 8;
+		position += 12 + (size_t)length;
+
+		// ancillary chunks other than tRNS are skipped without looking at them
+		bool used = type == pngChunkIhdr || type == pngChunkPlte || type == pngChunkTrns || type == pngChunkIend || (type == pngChunkIdat && !headerOnly);
+		if (used && ComputeCrc32(data - 4, (size_t)length + 4) != ReadBigEndian32(data + length))
+			return false;
+
+		if (!headerRead) {
+			if (type != pngChunkIhdr || length != 13)
+				return false;
+
+			png.width = ReadBigEndian32(data);
+			png.height = ReadBigEndian32(data + 4);
+			png.bitDepth = data[8];
+			png.colorType = data[9];
+			png.interlaced = data[12] == 1;
+			if (png.width == 0 || png.height == 0 || png.width > 0x7fffffff || png.height > 0x7fffffff)
+				return false;
+			if (!IsPngBitDepthValid(png.colorType, png.bitDepth) || data[10] != 0 || data[11] != 0 || data[12] > 1)
+				return false;
+
+			static const int channelCounts[7] = { 1, 0, 3, 1, 2, 0, 4 };
+			png.bitsPerPixel = channelCounts[png.colorType] * png.bitDepth;
+			headerRead = true;
+			continue;
+		}
+
+		if (type == pngChunkPlte) {
+			if (length % 3 != 0 || length / 3 > 256 || idatCount > 0)
+				return false;
+
+			for (int i = 0; i < 256; ++i) {
+				png.palette[i][0] = 0;
+				png.palette[i][1] = 0;
+				png.palette[i][2] = 0;
+				png.palette[i][3] = 255;
+			}
+			for (uint32_t i = 0; i < length / 3; ++i)
+				memcpy(png.palette[i], data + i * 3, 3);
+			png.hasPalette = true;
+		}
+		else if (type == pngChunkTrns) {
+			if (idatCount > 0)
+				return false;
+
+			if (png.colorType == PNG_COLOR_PALETTE) {
+				if (!png.hasPalette || length > 256)
+					return false;
+				for (uint32_t i = 0; i < length; ++i)
+					png.palette[i][3] = data[i];
+			}
+			else if (png.colorType == PNG_COLOR_GRAY || png.colorType == PNG_COLOR_RGB) {
+				uint32_t channels = png.colorType == PNG_COLOR_GRAY ? 1 : 3;
+				if (length != channels * 2)
+					return false;
+				for (uint32_t i = 0; i < channels; ++i)
+					png.colorKey[i] = (uint16_t)ReadBigEndian16(data + i * 2);
+				png.hasColorKey = true;
+			}
+		}
+		else if (type == pngChunkIdat) {
+			if (png.colorType == PNG_COLOR_PALETTE && !png.hasPalette)
+				return false;
+			if (headerOnly)
+				break;
+
+			// chunks usually follow each other, the first one is used in place until there is a second
+			if (idatCount == 1)
+				png.gatheredData.assign(png.data, png.data + png.dataSize);
+			if (idatCount >= 1)
+				png.gatheredData.insert(png.gatheredData.end(), data, data + length);
+			else
+				png.data = data;
+			png.dataSize += length;
+			idatCount++;
+		}
+		else if (type == pngChunkIend) {
+			break;
+		}
+		else if ((type & 0x20000000) == 0) {
+			// unknown critical chunk
+			return false;
+		}
+	}
+
+	if (idatCount > 1)
+		png.data = &png.gatheredData[0];
+	if (!headerOnly && idatCount == 0)
+		return false;
+
+	png.format = GetPngFormat(png.colorType, png.bitDepth, png.hasColorKey);
+	return true;
+}
+
+// inflate
+
+const int inflateFastBits = 10;
+const uint32_t inflateFastMask = (1 << inflateFastBits) - 1;
+
+static const uint16_t inflateLengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t inflateLengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t inflateDistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t inflateDistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+static const uint8_t inflateCodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+struct InflateHuffman {
+	// length << 9 | symbol for the codes up to inflateFastBits long, by their reversed bits, 0 for longer codes
+	uint16_t fast[1 << inflateFastBits];
+	uint16_t firstCode[16];
+	uint16_t firstSymbol[16];
+	// first code of each length that is too long for it, shifted up to 16 bits
+	uint32_t maxCode[17];
+	// by symbol index in code order
+	uint8_t sizes[288];
+	uint16_t symbols[288];
+};
+
+struct InflateStream {
+	const uint8_t* position;
+	const uint8_t* end;
+	// deflate streams are read from the lowest bit up
+	uint64_t bitBuffer;
+	int bitCount;
+	// zero bytes fed after the end
+	int overrun;
+
+	uint8_t* out;
+	uint8_t* outStart;
+	uint8_t* outEnd;
+};
+
+static inline uint32_t ReverseBits(uint32_t bits, int count) {
+	bits = ((bits & 0xaaaa) >> 1) | ((bits & 0x5555) << 1);
+	bits = ((bits & 0xcccc) >> 2) | ((bits & 0x3333) << 2);
+	bits = ((bits & 0xf0f0) >> 4) | ((bits & 0x0f0f) << 4);
+	bits = ((bits & 0xff00) >> 8) | ((bits & 0x00ff) << 8);
+	return bits >> (16 - count);
+}
+
+static bool BuildInflateHuffman(InflateHuffman& huffman, const uint8_t* lengths, int count) {
+	int counts[16] = { 0 };
+	for (int i = 0; i < count; ++i)
+		counts[lengths[i]]++;
+	counts[0] = 0;
+
+	uint32_t nextCode[16];
+	uint32_t code = 0;
+	int symbolIndex = 0;
+	for (int i = 1; i < 16; ++i) {
+		nextCode[i] = code;
+		huffman.firstCode[i] = (uint16_t)code;
+		huffman.firstSymbol[i] = (uint16_t)symbolIndex;
+		code += counts[i];
+		if (code > (1u << i))
+			return false;
+		huffman.maxCode[i] = code << (16 - i);
+		code <<= 1;
+		symbolIndex += counts[i];
+	}
+	huffman.maxCode[16] = 0x10000;
+
+	memset(huffman.fast, 0, sizeof(huffman.fast));
+	memset(huffman.sizes, 0, sizeof(huffman.sizes));
+	for (int i = 0; i < count; ++i) {
+		int length = lengths[i];
+		if (length == 0)
+			continue;
+
+		int index = (int)(nextCode[length] - huffman.firstCode[length]) + huffman.firstSymbol[length];
+		huffman.sizes[index] = (uint8_t)length;
+		huffman.symbols[index] = (uint16_t)i;
+
+		if (length <= inflateFastBits) {
+			uint16_t entry = (uint16_t)(length << 9 | i);
+			for (uint32_t j = ReverseBits(nextCode[length], length); j < (1u << inflateFastBits); j += 1u << length)
+				huffman.fast[j] = entry;
+		}
+		nextCode[length]++;
+	}
+	return true;
+}
+
+struct InflateFixedTables {
+	InflateHuffman lengths;
+	InflateHuffman distances;
+
+	InflateFixedTables() {
+		uint8_t sizes[288];
+		memset(sizes, 8, 144);
+		memset(sizes + 144, 9, 112);
+		memset(sizes + 256, 7, 24);
+		memset(sizes + 280, 8, 8);
+		BuildInflateHuffman(lengths, sizes, 288);
+
+		memset(sizes, 5, 30);
+		BuildInflateHuffman(distances, sizes, 30);
+	}
+};
+
+// tops the bit buffer up to at least 57 bits, enough for a length and a distance with their extra bits
+static inline void InflateFill(InflateStream& stream) {
+	if (stream.end - stream.position >= 8) {
+		// 8 bytes at once, only the whole ones that fit count as read. the bits past them are the bytes that come
+		// next, so reading them again later puts the same bits there
+		const uint8_t* bytes = stream.position;
+		uint64_t value = (uint64_t)ReadLittleEndian32(bytes) | (uint64_t)ReadLittleEndian32(bytes + 4) << 32;
+		stream.bitBuffer |= value << stream.bitCount;
+		stream.position += (63 - stream.bitCount) >> 3;
+		stream.bitCount |= 56;
+		return;
+	}
+
+	while (stream.bitCount <= 56) {
+		uint64_t byte = 0;
+		if (stream.position < stream.end)
+			byte = *stream.position++;
+		else
+			stream.overrun++;
+		stream.bitBuffer |= byte << stream.bitCount;
+		stream.bitCount += 8;
+	}
+}
+
+static inline uint32_t InflateReadBits(InflateStream& stream, int count) {
+	uint32_t bits = (uint32_t)(stream.bitBuffer & ((1u << count) - 1));
+	stream.bitBuffer >>= count;
+	stream.bitCount -= count;
+	return bits;
+}
+
+// the symbol of the code at the bottom of bits and its length, -1 if there is none
+static int InflateDecodeSlow(uint64_t bits, const InflateHuffman& huffman, int& length) {
+	uint32_t code = ReverseBits((uint32_t)bits & 0xffff, 16);
+	length = inflateFastBits + 1;
+	while (length < 16 && code >= huffman.maxCode[length])
+		length++;
+	if (length == 16)
+		return -1;
+
+	int index = (int)(code >> (16 - length)) - huffman.firstCode[length] + huffman.firstSymbol[length];
+	if (index >= 288 || huffman.sizes[index] != length)
+		return -1;
+	return huffman.symbols[index];
+}
+
+// the bit buffer has to hold at least 15 bits
+static inline int InflateDecode(InflateStream& stream, const InflateHuffman& huffman) {
+	uint32_t entry = huffman.fast[stream.bitBuffer & inflateFastMask];
+	int length = entry >> 9;
+	int symbol = entry & 511;
+	if (entry == 0) {
+		symbol = InflateDecodeSlow(stream.bitBuffer, huffman, length);
+		if (symbol < 0)
+			return -1;
+	}
+
+	stream.bitBuffer >>= length;
+	stream.bitCount -= length;
+	return symbol;
+}
+
+static bool InflateBlock(InflateStream& blockStream, const InflateHuffman& lengths, const InflateHuffman& distances) {
+	// a copy the output can not alias, so the bit buffer stays in registers across the stores
+	InflateStream stream = blockStream;
+	uint8_t* out = stream.out;
+	for (;;) {
+		InflateFill(stream);
+		int symbol = InflateDecode(stream, lengths);
+		if (symbol < 256) {
+			if (symbol < 0 || out == stream.outEnd)
+				return false;
+			*out++ = (uint8_t)symbol;
+			continue;
+		}
+		if (symbol == 256)
+			break;
+
+		symbol -= 257;
+		if (symbol >= 29)
+			return false;
+		size_t length = inflateLengthBase[symbol] + InflateReadBits(stream, inflateLengthExtra[symbol]);
+
+		int distanceSymbol = InflateDecode(stream, distances);
+		if (distanceSymbol < 0 || distanceSymbol >= 30)
+			return false;
+		size_t distance = inflateDistanceBase[distanceSymbol] + InflateReadBits(stream, inflateDistanceExtra[distanceSymbol]);
+
+		if (distance > (size_t)(out - stream.outStart) || length > (size_t)(stream.outEnd - out))
+			return false;
+
+		const uint8_t* source = out - distance;
+		if (distance == 1) {
+			memset(out, *source, length);
+			out += length;
+		}
+		else if (distance >= 8 && (size_t)(stream.outEnd - out) >= length + 8) {
+			// 8 bytes at a time, the copy can run up to 7 bytes past the match
+			uint8_t* matchEnd = out + length;
+			for (; out < matchEnd; out += 8, source += 8)
+				memcpy(out, source, 8);
+			out = matchEnd;
+		}
+		else {
+			for (size_t i = 0; i < length; ++i)
+				*out++ = *source++;
+		}
+	}
+
+	stream.out = out;
+	blockStream = stream;
+	return true;
+}
+
+static bool InflateStoredBlock(InflateStream& stream) {
+	InflateReadBits(stream, stream.bitCount & 7);
+	InflateFill(stream);
+	uint32_t length = InflateReadBits(stream, 16);
+	uint32_t inverseLength = InflateReadBits(stream, 16);
+	if (length != (~inverseLength & 0xffff) || length > (size_t)(stream.outEnd - stream.out))
+		return false;
+
+	// whole bytes already in the bit buffer come first, the rest is copied past it so what it holds is stale after
+	for (; length > 0 && stream.bitCount >= 8; --length)
+		*stream.out++ = (uint8_t)InflateReadBits(stream, 8);
+	if (length > 0)
+		stream.bitBuffer = 0;
+
+	if (length > (size_t)(stream.end - stream.position))
+		return false;
+	memcpy(stream.out, stream.position, length);
+	stream.out += length;
+	stream.position += length;
+	return true;
+}
+
+static bool InflateDynamicBlock(InflateStream& stream) {
+	InflateFill(stream);
+	int lengthCount = InflateReadBits(stream, 5) + 257;
+	int distanceCount = InflateReadBits(stream, 5) + 1;
+	int codeLengthCount = InflateReadBits(stream, 4) + 4;
+	if (lengthCount > 286 || distanceCount > 30)
+		return false;
+
+	uint8_t codeLengthSizes[19] = { 0 };
+	InflateFill(stream);
+	for (int i = 0; i < codeLengthCount; ++i)
+		codeLengthSizes[inflateCodeLengthOrder[i]] = (uint8_t)InflateReadBits(stream, 3);
+
+	InflateHuffman codeLengths;
+	if (!BuildInflateHuffman(codeLengths, codeLengthSizes, 19))
+		return false;
+
+	uint8_t sizes[286 + 30];
+	int total = lengthCount + distanceCount;
+	int count = 0;
+	while (count < total) {
+		InflateFill(stream);
+		int symbol = InflateDecode(stream, codeLengths);
+		if (symbol < 0 || symbol > 18)
+			return false;
+
+		if (symbol < 16) {
+			sizes[count++] = (uint8_t)symbol;
+			continue;
+		}
+
+		int repeat;
+		uint8_t value = 0;
+		if (symbol == 16) {
+			if (count == 0)
+				return false;
+			value = sizes[count - 1];
+			repeat = 3 + InflateReadBits(stream, 2);
+		}
+		else if (symbol == 17) {
+			repeat = 3 + InflateReadBits(stream, 3);
+		}
+		else {
+			repeat = 11 + InflateReadBits(stream, 7);
+		}
+
+		if (count + repeat > total)
+			return false;
+		memset(sizes + count, value, repeat);
+		count += repeat;
+	}
+
+	// a block without an end code could not end
+	if (sizes[256] == 0)
+		return false;
+
+	InflateHuffman lengths;
+	InflateHuffman distances;
+	if (!BuildInflateHuffman(lengths, sizes, lengthCount) || !BuildInflateHuffman(distances, sizes + lengthCount, distanceCount))
+		return false;
+
+	return InflateBlock(stream, lengths, distances);
+}
+
+// a zlib stream that has to inflate to exactly outSize bytes
+static bool Inflate(const uint8_t* data, size_t size, uint8_t* out, size_t outSize) {
+	if (size < 6)
+		return false;
+
+	// deflate with a window of at most 32k, no preset dictionary
+	uint32_t method = data[0];
+	uint32_t flags = data[1];
+	if ((method & 15) != 8 || (method >> 4) > 7 || (method << 8 | flags) % 31 != 0 || (flags & 0x20) != 0)
+		return false;
+
+	// built once, thread safe since c++11
+	static const InflateFixedTables fixedTables;
+
+	InflateStream stream;
+	stream.position = data + 2;
+	stream.end = data + size;
+	stream.bitBuffer = 0;
+	stream.bitCount = 0;
+	stream.overrun = 0;
+	stream.out = out;
+	stream.outStart = out;
+	stream.outEnd = out + outSize;
+
+	bool lastBlock = false;
+	while (!lastBlock) {
+		InflateFill(stream);
+		lastBlock = InflateReadBits(stream, 1) != 0;
+		uint32_t blockType = InflateReadBits(stream, 2);
+
+		bool succeeded = false;
+		if (blockType == 0)
+			succeeded = InflateStoredBlock(stream);
+		else if (blockType == 1)
+			succeeded = InflateBlock(stream, fixedTables.lengths, fixedTables.distances);
+		else if (blockType == 2)
+			succeeded = InflateDynamicBlock(stream);
+
+		// the zeros after the end would only ever decode into more data
+		if (!succeeded || stream.overrun > 8)
+			return false;
+	}
+
+	if (stream.out != stream.outEnd)
+		return false;
+
+	// the checksum of the inflated data follows on a byte boundary, big endian
+	InflateReadBits(stream, stream.bitCount & 7);
+	InflateFill(stream);
+	uint32_t adler = 0;
+	for (int i = 0; i < 4; ++i)
+		adler = adler << 8 | InflateReadBits(stream, 8);
+
+	// the checksum was cut off when any of its bytes were zeros fed after the end
+	if (stream.overrun * 8 > stream.bitCount)
+		return false;
+	return adler == ComputeAdler32(out, outSize);
+}
+
+// unfiltering
+
+static inline int PngPaeth(int a, int b, int c) {
+	int pa = b - c;
+	int pb = a - c;
+	int pc = pa + pb;
+	pa = pa < 0 ? -pa : pa;
+	pb = pb < 0 ? -pb : pb;
+	pc = pc < 0 ? -pc : pc;
+	if (pa <= pb && pa <= pc)
+		return a;
+	return pb <= pc ? b : c;
+}
+
+static void PngUnfilterScalar(int filter, uint8_t* row, const uint8_t* prior, size_t rowBytes, size_t bytesPerPixel) {
+	size_t i = 0;
+	switch (filter) {
+	case 1:
+		for (i = bytesPerPixel; i < rowBytes; ++i)
+			row[i] = (uint8_t)(row[i] + row[i - bytesPerPixel]);
+		break;
+	case 2:
+		for (; i < rowBytes; ++i)
+			row[i] = (uint8_t)(row[i] + prior[i]);
+		break;
+	case 3:
+		for (; i < bytesPerPixel; ++i)
+			row[i] = (uint8_t)(row[i] + (prior[i] >> 1));
+		for (; i < rowBytes; ++i)
+			row[i] = (uint8_t)(row[i] + ((row[i - bytesPerPixel] + prior[i]) >> 1));
+		break;
+	case 4:
+		for (; i < bytesPerPixel; ++i)
+			row[i] = (uint8_t)(row[i] + prior[i]);
+		for (; i < rowBytes; ++i)
+			row[i] = (uint8_t)(row[i] + PngPaeth(row[i - bytesPerPixel], prior[i], prior[i - bytesPerPixel]));
+		break;
+	}
+}
+
+#ifdef IMAGE_DECODER_SSE
+static inline uint32_t LoadUnaligned16(const uint8_t* bytes) {
+	uint16_t value;
+	memcpy(&value, bytes, 2);
+	return value;
+}
+
+static inline uint32_t LoadUnaligned32(const uint8_t* bytes) {
+	uint32_t value;
+	memcpy(&value, bytes, 4);
+	return value;
+}
+
+static inline void StoreUnaligned16(uint8_t* bytes, uint32_t value) {
+	uint16_t low = (uint16_t)value;
+	memcpy(bytes, &low, 2);
+}
+
+static inline void StoreUnaligned32(uint8_t* bytes, uint32_t value) {
+	memcpy(bytes, &value, 4);
+}
+
+// pixels are moved in pieces that do not touch the next pixel, a wider store it has to load from again would stall
+template <int bytesPerPixel>
+static inline __m128i PngLoadPixel(const uint8_t* pixel) {
+	switch (bytesPerPixel) {
+	case 3:
+		return _mm_cvtsi32_si128((int)(LoadUnaligned16(pixel) | (uint32_t)pixel[2] << 16));
+	case 4:
+		return _mm_cvtsi32_si128((int)LoadUnaligned32(pixel));
+	case 6:
+		return _mm_unpacklo_epi32(_mm_cvtsi32_si128((int)LoadUnaligned32(pixel)), _mm_cvtsi32_si128((int)LoadUnaligned16(pixel + 4)));
+	default:
+		return _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pixel));
+	}
+}
+
+template <int bytesPerPixel>
+static inline void PngStorePixel(uint8_t* pixel, __m128i value) {
+	uint32_t low = (uint32_t)_mm_cvtsi128_si32(value);
+	switch (bytesPerPixel) {
+	case 3:
+		StoreUnaligned16(pixel, low);
+		pixel[2] = (uint8_t)(low >> 16);
+		break;
+	case 4:
+		StoreUnaligned32(pixel, low);
+		break;
+	case 6:
+		StoreUnaligned32(pixel, low);
+		StoreUnaligned16(pixel + 4, (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(value, 4)));
+		break;
+	default:
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(pixel), value);
+		break;
+	}
+}
+
+// sub, average and paeth depend on the pixel to the left, so they go a pixel at a time with the channels in lanes
+template <int bytesPerPixel>
+static void PngUnfilterSse2(int filter, uint8_t* row, const uint8_t* prior, size_t rowBytes) {
+	__m128i zero = _mm_setzero_si128();
+	__m128i left = zero;
+
+	if (filter == 1) {
+		for (size_t i = 0; i < rowBytes; i += bytesPerPixel) {
+			left = _mm_add_epi8(PngLoadPixel<bytesPerPixel>(row + i), left);
+			PngStorePixel<bytesPerPixel>(row + i, left);
+		}
+	}
+	else if (filter == 3) {
+		__m128i one = _mm_set1_epi8(1);
+		for (size_t i = 0; i < rowBytes; i += bytesPerPixel) {
+			__m128i above = PngLoadPixel<bytesPerPixel>(prior + i);
+			// the rounding up of avg_epu8 taken back off
+			__m128i average = _mm_sub_epi8(_mm_avg_epu8(left, above), _mm_and_si128(_mm_xor_si128(left, above), one));
+			left = _mm_add_epi8(PngLoadPixel<bytesPerPixel>(row + i), average);
+			PngStorePixel<bytesPerPixel>(row + i, left);
+		}
+	}
+	else if (filter == 4) {
+		__m128i aboveLeft = zero;
+		for (size_t i = 0; i < rowBytes; i += bytesPerPixel) {
+			__m128i above = _mm_unpacklo_epi8(PngLoadPixel<bytesPerPixel>(prior + i), zero);
+			__m128i left16 = _mm_unpacklo_epi8(left, zero);
+
+			__m128i pa = _mm_sub_epi16(above, aboveLeft);
+			__m128i pb = _mm_sub_epi16(left16, aboveLeft);
+			__m128i pc = _mm_add_epi16(pa, pb);
+			pa = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+			pb = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+			pc = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+			__m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+
+			// ties go to left, then above
+			__m128i isPa = _mm_cmpeq_epi16(smallest, pa);
+			__m128i isPb = _mm_cmpeq_epi16(smallest, pb);
+			__m128i abovePick = _mm_or_si128(_mm_and_si128(isPb, above), _mm_andnot_si128(isPb, aboveLeft));
+			__m128i predictor = _mm_or_si128(_mm_and_si128(isPa, left16), _mm_andnot_si128(isPa, abovePick));
+
+			left = _mm_add_epi8(PngLoadPixel<bytesPerPixel>(row + i), _mm_packus_epi16(predictor, predictor));
+			PngStorePixel<bytesPerPixel>(row + i, left);
+			aboveLeft = above;
+		}
+	}
+}
+#endif
+
+static bool PngUnfilterRow(int filter, uint8_t* row, const uint8_t* prior, size_t rowBytes, size_t bytesPerPixel, bool simd) {
+	if (filter > 4)
+		return false;
+	if (filter == 0)
+		return true;
+
+#ifdef IMAGE_DECODER_SSE
+	if (simd && filter == 2) {
+		size_t i = 0;
+		for (; i + 16 <= rowBytes; i += 16) {
+			__m128i sum = _mm_add_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(prior + i)));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(row + i), sum);
+		}
+		for (; i < rowBytes; ++i)
+			row[i] = (uint8_t)(row[i] + prior[i]);
+		return true;
+	}
+
+	if (simd) {
+		switch (bytesPerPixel) {
+		case 3:
+			PngUnfilterSse2<3>(filter, row, prior, rowBytes);
+			return true;
+		case 4:
+			PngUnfilterSse2<4>(filter, row, prior, rowBytes);
+			return true;
+		case 6:
+			PngUnfilterSse2<6>(filter, row, prior, rowBytes);
+			return true;
+		case 8:
+			PngUnfilterSse2<8>(filter, row, prior, rowBytes);
+			return true;
+		}
+	}
+#else
+	(void)simd;
+#endif
+
+	PngUnfilterScalar(filter, row, prior, rowBytes, bytesPerPixel);
+	return true;
+}
+
+// expanding rows into the output format
+
+static inline void StoreLittleEndian16(uint8_t* out, uint32_t value) {
+	out[0] = (uint8_t)value;
+	out[1] = (uint8_t)(value >> 8);
+}
+
+// sample x of a row of 1, 2, 4 or 8 bit samples
+static inline uint32_t PngGetSample(const uint8_t* row, uint32_t x, int bitDepth) {
+	if (bitDepth == 8)
+		return row[x];
+	uint32_t bit = x * bitDepth;
+	return (row[bit >> 3] >> (8 - bitDepth - (bit & 7))) & ((1u << bitDepth) - 1);
+}
+
+static void PngSwizzleRgbaToBgra(const uint8_t* row, uint32_t width, bool simd, uint8_t* out) {
+	uint32_t x = 0;
+#ifdef IMAGE_DECODER_SSE
+	if (simd) {
+		__m128i greenAlpha = _mm_set1_epi32((int)0xff00ff00);
+		for (; x + 4 <= width; x += 4) {
+			__m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x * 4));
+			__m128i redBlue = _mm_andnot_si128(greenAlpha, pixels);
+			__m128i swapped = _mm_or_si128(_mm_slli_epi32(redBlue, 16), _mm_srli_epi32(redBlue, 16));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4), _mm_or_si128(_mm_and_si128(pixels, greenAlpha), swapped));
+		}
+	}
+#else
+	(void)simd;
+#endif
+	for (; x < width; ++x) {
+		const uint8_t* pixel = row + x * 4;
+		out[x * 4] = pixel[2];
+		out[x * 4 + 1] = pixel[1];
+		out[x * 4 + 2] = pixel[0];
+		out[x * 4 + 3] = pixel[3];
+	}
+}
+
+// big endian 16 bit samples to little endian
+static void PngSwapBytes(const uint8_t* row, size_t size, bool simd, uint8_t* out) {
+	size_t i = 0;
+#ifdef IMAGE_DECODER_SSE
+	if (simd) {
+		for (; i + 16 <= size; i += 16) {
+			__m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_or_si128(_mm_slli_epi16(samples, 8), _mm_srli_epi16(samples, 8)));
+		}
+	}
+#else
+	(void)simd;
+#endif
+	for (; i < size; i += 2) {
+		out[i] = row[i + 1];
+		out[i + 1] = row[i];
+	}
+}
+
+// one unfiltered row of width pixels into the output format, output pixels are outStep bytes apart
+static void PngExpandRow(const PngImage& png, const uint8_t* row, uint32_t width, uint8_t* out, size_t outStep, bool simd) {
+	int bitDepth = png.bitDepth;
+	bool packed = outStep == GetDecodedImageBytesPerPixel(png.format);
+
+	switch (png.colorType) {
+	case PNG_COLOR_GRAY:
+		if (bitDepth == 16) {
+			for (uint32_t x = 0; x < width; ++x, out += outStep) {
+				uint32_t gray = ReadBigEndian16(row + x * 2);
+				if (!png.hasColorKey) {
+					StoreLittleEndian16(out, gray);
+					continue;
+				}
+				StoreLittleEndian16(out, gray);
+				StoreLittleEndian16(out + 2, gray);
+				StoreLittleEndian16(out + 4, gray);
+				StoreLittleEndian16(out + 6, gray == png.colorKey[0] ? 0 : 0xffff);
+			}
+		}
+		else if (bitDepth == 8 && packed && !png.hasColorKey) {
+			memcpy(out, row, width);
+		}
+		else {
+			// lower bit depths scale up by repeating their bits
+			static const uint8_t scales[9] = { 0, 255, 85, 0, 17, 0, 0, 0, 1 };
+			uint8_t scale = scales[bitDepth];
+			for (uint32_t x = 0; x < width; ++x, out += outStep) {
+				uint32_t sample = PngGetSample(row, x, bitDepth);
+				uint8_t gray = (uint8_t)(sample * scale);
+				if (!png.hasColorKey) {
+					out[0] = gray;
+					continue;
+				}
+				out[0] = gray;
+				out[1] = gray;
+				out[2] = gray;
+				out[3] = sample == png.colorKey[0] ? 0 : 255;
+			}
+		}
+		break;
+
+	case PNG_COLOR_RGB:
+		if (bitDepth == 16) {
+			for (uint32_t x = 0; x < width; ++x, out += outStep) {
+				const uint8_t* pixel = row + x * 6;
+				uint32_t r = ReadBigEndian16(pixel);
+				uint32_t g = ReadBigEndian16(pixel + 2);
+				uint32_t b = ReadBigEndian16(pixel + 4);
+				bool transparent = png.hasColorKey && r == png.colorKey[0] && g == png.colorKey[1] && b == png.colorKey[2];
+				StoreLittleEndian16(out, r);
+				StoreLittleEndian16(out + 2, g);
+				StoreLittleEndian16(out + 4, b);
+				StoreLittleEndian16(out + 6, transparent ? 0 : 0xffff);
+			}
+		}
+		else if (png.hasColorKey) {
+			for (uint32_t x = 0; x < width; ++x, out += outStep) {
+				const uint8_t* pixel = row + x * 3;
+				bool transparent = pixel[0] == png.colorKey[0] && pixel[1] == png.colorKey[1] && pixel[2] == png.colorKey[2];
+				out[0] = pixel[2];
+				out[1] = pixel[1];
+				out[2] = pixel[0];
+				out[3] = transparent ? 0 : 255;
+			}
+		}
+		else {
+			for (uint32_t x = 0; x < width; ++x, out += outStep) {
+				const uint8_t* pixel = row + x * 3;
+				out[0] = pixel[0];
+				out[1] = pixel[1];
+				out[2] = pixel[2];
+				out[3] = 255;
+			}
+		}
+		break;
+
+	case PNG_COLOR_PALETTE:
+		for (uint32_t x = 0; x < width; ++x, out += outStep)
+			memcpy(out, png.palette[PngGetSample(row, x, bitDepth)], 4);
+		break;
+
+	case PNG_COLOR_GRAY_ALPHA:
+		for (uint32_t x = 0; x < width; ++x, out += outStep) {
+			if (bitDepth == 16) {
+				uint32_t gray = ReadBigEndian16(row + x * 4);
+				StoreLittleEndian16(out, gray);
+				StoreLittleEndian16(out + 2, gray);
+				StoreLittleEndian16(out + 4, gray);
+				StoreLittleEndian16(out + 6, ReadBigEndian16(row + x * 4 + 2));
+				continue;
+			}
+			out[0] = row[x * 2];
+			out[1] = row[x * 2];
+			out[2] = row[x * 2];
+			out[3] = row[x * 2 + 1];
+		}
+		break;
+
+	case PNG_COLOR_RGBA:
+		if (packed) {
+			if (bitDepth == 16)
+				PngSwapBytes(row, (size_t)width * 8, simd, out);
+			else
+				PngSwizzleRgbaToBgra(row, width, simd, out);
+			break;
+		}
+
+		for (uint32_t x = 0; x < width; ++x, out += outStep) {
+			if (bitDepth == 16) {
+				PngSwapBytes(row + x * 8, 8, false, out);
+				continue;
+			}
+			const uint8_t* pixel = row + x * 4;
+			out[0] = pixel[2];
+			out[1] = pixel[1];
+			out[2] = pixel[0];
+			out[3] = pixel[3];
+		}
+		break;
+	}
+}
+
+static size_t GetPngRowBytes(const PngImage& png, uint32_t width) {
+	return ((size_t)width * png.bitsPerPixel + 7) / 8;
+}
+
+static bool GetPngInfo(const uint8_t* file, size_t fileSize, ImageInfo& info) {
+	PngImage png;
+	if (!ReadPngChunks(file, fileSize, true, png))
+		return false;
+
+	info.type = IMAGE_FILE_PNG;
+	info.format = png.format;
+	info.width = png.width;
+	info.height = png.height;
+	return IsDecodedImageSizeValid(info.width, info.height, info.format);
+}
+
+static bool DecodePng(const uint8_t* file, size_t fileSize, ImageDecodePath path, uint8_t* pixels, size_t rowPitch) {
+	PngImage png;
+	if (!ReadPngChunks(file, fileSize, false, png))
+		return false;
+
+#ifdef IMAGE_DECODER_SSE
+	bool simd = path == IMAGE_DECODE_SIMD;
+#else
+	(void)path;
+	bool simd = false;
+#endif
+
+	// every pass is a small image of its own, rows start with their filter byte
+	int passCount = png.interlaced ? 7 : 1;
+	uint32_t passWidths[7];
+	uint32_t passHeights[7];
+	uint64_t filteredSize = 0;
+	for (int pass = 0; pass < passCount; ++pass) {
+		uint32_t startX = png.interlaced ? pngPassStartX[pass] : 0;
+		uint32_t startY = png.interlaced ? pngPassStartY[pass] : 0;
+		uint32_t stepX = png.interlaced ? pngPassStepX[pass] : 1;
+		uint32_t stepY = png.interlaced ? pngPassStepY[pass] : 1;
+		passWidths[pass] = png.width > startX ? (png.width - startX + stepX - 1) / stepX : 0;
+		passHeights[pass] = png.height > startY ? (png.height - startY + stepY - 1) / stepY : 0;
+		if (passWidths[pass] > 0)
+			filteredSize += (uint64_t)passHeights[pass] * (1 + GetPngRowBytes(png, passWidths[pass]));
+	}
+	if (filteredSize > maxDecodedImageBytes * 2)
+		return false;
+
+	std::vector<uint8_t> filtered((size_t)filteredSize);
+	if (!Inflate(png.data, png.dataSize, &filtered[0], filtered.size()))
+		return false;
+
+	size_t bytesPerPixel = png.bitsPerPixel >= 8 ? png.bitsPerPixel / 8 : 1;
+	size_t outBytesPerPixel = GetDecodedImageBytesPerPixel(png.format);
+	std::vector<uint8_t> zeros(GetPngRowBytes(png, png.width), 0);
+	uint8_t* row = &filtered[0];
+
+	for (int pass = 0; pass < passCount; ++pass) {
+		uint32_t width = passWidths[pass];
+		if (width == 0)
+			continue;
+
+		uint32_t startX = png.interlaced ? pngPassStartX[pass] : 0;
+		uint32_t startY = png.interlaced ? pngPassStartY[pass] : 0;
+		uint32_t stepX = png.interlaced ? pngPassStepX[pass] : 1;
+		uint32_t stepY = png.interlaced ? pngPassStepY[pass] : 1;
+		size_t rowBytes = GetPngRowBytes(png, width);
+		const uint8_t* prior = &zeros[0];
+
+		for (uint32_t y = 0; y < passHeights[pass]; ++y) {
+			uint8_t* samples = row + 1;
+			if (!PngUnfilterRow(row[0], samples, prior, rowBytes, bytesPerPixel, simd))
+				return false;
+
+			uint8_t* out = pixels + (size_t)(startY + y * stepY) * rowPitch + startX * outBytesPerPixel;
+			PngExpandRow(png, samples, width, out, stepX * outBytesPerPixel, simd);
+
+			prior = samples;
+			row += 1 + rowBytes;
+		}
+	}
+
+	return true;
+}
+
+bool GetImageInfo(const uint8_t* file, size_t fileSize, ImageInfo& info) {
+	switch (GetImageFileType(file, fileSize)) {
+	case IMAGE_FILE_JPEG:
+		return GetJpegInfo(file, fileSize, info);
+	case IMAGE_FILE_PNG:
+		return GetPngInfo(file, fileSize, info);
+	default:
+		return false;
+	}
+}
+
+bool DecodeImage(const uint8_t* file, size_t fileSize, ImageDecodePath path, uint8_t* pixels, size_t rowPitch) {
+	switch (GetImageFileType(file, fileSize)) {
+	case IMAGE_FILE_JPEG:
+		return DecodeJpeg(file, fileSize, path, pixels, rowPitch);
+	case IMAGE_FILE_PNG:
+		return DecodePng(file, fileSize, path, pixels, rowPitch);
+	default:
+		return false;
+	}
+}
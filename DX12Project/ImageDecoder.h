@@ -0,0 +1,61 @@
+#pragma once
+
+// jpeg and png decoding into the pixel layouts the wic path hands the renderer, so the formats map to dxgi the
+// same way GetDXGIFormatFromWICFormat and the wic conversions do
+// jpeg: baseline and progressive huffman coded 8 bit files, gray, ycbcr and rgb, any sampling factors, restarts.
+// chroma is upsampled with the same triangle filters as libjpeg. cmyk, arithmetic coding and 12 bit are not taken
+// png: every color type, bit depth and interlacing, palette and color key transparency. crcs and the zlib checksum
+// are checked, gamma and color profiles are ignored like wic does
+// decodes share no state, any number can run on different threads at once
+// the idct, upsampling, color conversion and png unfiltering have sse2 versions, IMAGE_DECODE_SCALAR runs the plain
+// versions of the same arithmetic and gives the same pixels
+// no wic or d3d12 dependency, file io is left to the caller
+
+#include <cstddef>
+#include <cstdint>
+
+// same values as DXGI_FORMAT so they can be cast to it
+enum DecodedImageFormat {
+	DECODED_IMAGE_FORMAT_UNKNOWN = 0,
+	// 16 bit png with more than one channel, channels are little endian
+	DECODED_IMAGE_FORMAT_R16G16B16A16_UNORM = 11,
+	// color jpeg, rgb and palette png, alpha is 255
+	DECODED_IMAGE_FORMAT_R8G8B8A8_UNORM = 28,
+	// 16 bit gray png, little endian
+	DECODED_IMAGE_FORMAT_R16_UNORM = 56,
+	// gray jpeg and 8 bit or lower gray png, lower bit depths are scaled up to 8 bits
+	DECODED_IMAGE_FORMAT_R8_UNORM = 61,
+	// 8 bit png with alpha or color key transparency, gray is copied into all three channels
+	DECODED_IMAGE_FORMAT_B8G8R8A8_UNORM = 87,
+};
+
+enum ImageFileType {
+	IMAGE_FILE_UNKNOWN,
+	IMAGE_FILE_JPEG,
+	IMAGE_FILE_PNG,
+};
+
+enum ImageDecodePath {
+	IMAGE_DECODE_SIMD,
+	IMAGE_DECODE_SCALAR,
+};
+
+struct ImageInfo {
+	ImageFileType type;
+	DecodedImageFormat format;
+	uint32_t width;
+	uint32_t height;
+};
+
+// by the signature, does not look any further
+ImageFileType GetImageFileType(const uint8_t* file, size_t fileSize);
+
+uint32_t GetDecodedImageBytesPerPixel(DecodedImageFormat format);
+
+// reads the headers, false if the file is not a jpeg or png this decoder takes or its image is too large
+// for an int sized allocation
+bool GetImageInfo(const uint8_t* file, size_t fileSize, ImageInfo& info);
+
+// pixels holds info.height rows of rowPitch bytes in info.format, rows are written without padding past the image
+// false if the file is corrupt or truncated, the pixels are undefined then
+bool DecodeImage(const uint8_t* file, size_t fileSize, ImageDecodePath path, uint8_t* pixels, size_t rowPitch);
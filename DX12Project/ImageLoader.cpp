@@ -0,0 +1,351 @@
+#include "ImageLoader.h"
+
+#include "d3dx12.h"
+#include "ImageDecoder.h"
+#include "MappedFile.h"
+
+#define SAFE_RELEASE(x) if( x ) { x->Release(); x = NULL; }
+
+static void FillTextureDescription(D3D12_RESOURCE_DESC& resourceDescription, UINT textureWidth, UINT textureHeight, DXGI_FORMAT dxgiFormat) {
+	resourceDescription = {};
+	// type of resource
+	resourceDescription.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	// zero is automatic alignment, but should be explicitly set for better mapping to heaps
+	resourceDescription.Alignment = 0;
+	resourceDescription.Width = textureWidth;
+	resourceDescription.Height = textureHeight;
+	// one image, also not a 3d image
+	resourceDescription.DepthOrArraySize = 1;
+	// no mipmaps
+	resourceDescription.MipLevels = 1;
+	// previously converted to dxgi format
+	resourceDescription.Format = dxgiFormat;
+	resourceDescription.SampleDesc.Count = 1;
+	resourceDescription.SampleDesc.Quality = 0;
+	// driver chooses the most efficient pixel layout (linear vs swizzle)
+	resourceDescription.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+	resourceDescription.Flags = D3D12_RESOURCE_FLAG_NONE;
+}
+
+// jpeg and png files the built in decoder takes, 0 for anything else so wic can have a go at it
+static int DecodeImageWithImageDecoder(BYTE** imageData, D3D12_RESOURCE_DESC& resourceDescription, LPCWSTR filename, int& bytesPerRow) {
+	MappedFile file;
+	if (!MappedFileOpen(file, filename))
+		return 0;
+
+	ImageInfo info;
+	int imageSize = 0;
+	if (GetImageInfo(file.data, file.size, info)) {
+		bytesPerRow = (int)(info.width * GetDecodedImageBytesPerPixel(info.format));
+		imageSize = bytesPerRow * (int)info.height;
+
+		*imageData = (BYTE*)malloc(imageSize);
+		if (*imageData != NULL && DecodeImage(file.data, file.size, IMAGE_DECODE_SIMD, *imageData, bytesPerRow)) {
+			FillTextureDescription(resourceDescription, info.width, info.height, (DXGI_FORMAT)info.format);
+		}
+		else {
+			free(*imageData);
+			*imageData = NULL;
+			imageSize = 0;
+		}
+	}
+
+	MappedFileClose(file);
+	return imageSize;
+}
+
+// the wic objects are created by the caller so they can be released on every path
+static int DecodeImageWithWIC(BYTE** imageData, D3D12_RESOURCE_DESC& resourceDescription, LPCWSTR filename, int& bytesPerRow,
+	IWICBitmapDecoder*& wicDecoder, IWICBitmapFrameDecode*& wicFrame, IWICFormatConverter*& wicConverter) {
+	HRESULT hr;
+
+	// use wic factory to create bitmap decoders
+	// one per thread so images can be decoded on several threads at once
+	static thread_local IWICImagingFactory* wicFactory;
+
+	bool imageConverted = false;
+
+	if (wicFactory == NULL)
+	{
+		// initialize Com library which contains functions for creation of com applications
+		// multithreaded apartment so any loader thread can use it
+		CoInitializeEx(NULL, COINIT_MULTITHREADED);
+
+		hr = CoCreateInstance(CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&wicFactory));
+		if (FAILED(hr))
+			return 0;
+	}
+
+	hr = wicFactory->CreateDecoderFromFilename(filename, NULL, GENERIC_READ, WICDecodeMetadataCacheOnLoad, &wicDecoder); 
+	if (FAILED(hr))
+		return 0;
+
+	// get first frame since some files may be gifs
+	hr = wicDecoder->GetFrame(0, &wicFrame);
+	if (FAILED(hr))
+		return 0;
+
+	WICPixelFormatGUID pixelFormat;
+	hr = wicFrame->GetPixelFormat(&pixelFormat);
+	if (FAILED(hr))
+		return 0;
+
+	UINT textureWidth, textureHeight;
+	hr = wicFrame->GetSize(&textureWidth, &textureHeight);
+	if (FAILED(hr))
+		return 0;
+
+	// checks for DXGI format compatibility
+	DXGI_FORMAT dxgiFormat = GetDXGIFormatFromWICFormat(pixelFormat);
+
+	// if not compatible
+	if (dxgiFormat == DXGI_FORMAT_UNKNOWN)
+	{
+		// get dxgi compatible wic format
+		WICPixelFormatGUID convertToPixelFormat = GetConvertToWICFormat(pixelFormat);
+
+		// if can't then return
+		if (convertToPixelFormat == GUID_WICPixelFormatDontCare)
+			return 0;
+
+		dxgiFormat = GetDXGIFormatFromWICFormat(convertToPixelFormat);
+
+		hr = wicFactory->CreateFormatConverter(&wicConverter);
+		if (FAILED(hr))
+			return 0;
+
+		BOOL canConvert = FALSE;
+		hr = wicConverter->CanConvert(pixelFormat, convertToPixelFormat, &canConvert);
+		if (FAILED(hr))
+			return 0;
+
+		hr = wicConverter->Initialize(wicFrame, convertToPixelFormat, WICBitmapDitherTypeErrorDiffusion, 0, 0, WICBitmapPaletteTypeCustom);
+		if (FAILED(hr))
+			return 0;
+
+		imageConverted = true;
+	}
+
+	int bitsPerPixel = GetDXGIFormatBitsPerPixel(dxgiFormat);
+	bytesPerRow = (textureWidth * bitsPerPixel) / 8;
+	// image size in bytes
+	int imageSize = bytesPerRow * textureHeight;
+
+	*imageData = (BYTE*)malloc(imageSize);
+	if (*imageData == NULL)
+		return 0;
+
+	// copy image data into allocated memory
+	if (imageConverted) {
+		// if converted, then use the wic converter
+		hr = wicConverter->CopyPixels(0, bytesPerRow, imageSize, *imageData);
+	}
+	else {
+		// if not converted then copy straight from frame
+		hr = wicFrame->CopyPixels(0, bytesPerRow, imageSize, *imageData);
+	}
+
+	if (FAILED(hr)) {
+		free(*imageData);
+		*imageData = NULL;
+		return 0;
+	}
+
+	FillTextureDescription(resourceDescription, textureWidth, textureHeight, dxgiFormat);
+	return imageSize;
+}
+
+int LoadImageDataFromFile(BYTE** imageData, D3D12_RESOURCE_DESC& resourceDescription, LPCWSTR filename, int& bytesPerRow) {
+	int imageSize = DecodeImageWithImageDecoder(imageData, resourceDescription, filename, bytesPerRow);
+	if (imageSize > 0)
+		return imageSize;
+
+	return LoadImageDataFromFileWithWIC(imageData, resourceDescription, filename, bytesPerRow);
+}
+
+int LoadImageDataFromFileWithWIC(BYTE** imageData, D3D12_RESOURCE_DESC& resourceDescription, LPCWSTR filename, int& bytesPerRow) {
+	IWICBitmapDecoder* wicDecoder = NULL;
+	IWICBitmapFrameDecode* wicFrame = NULL;
+	IWICFormatConverter* wicConverter = NULL;
+
+	int imageSize = DecodeImageWithWIC(imageData, resourceDescription, filename, bytesPerRow, wicDecoder, wicFrame, wicConverter);
+
+	SAFE_RELEASE(wicConverter);
+	SAFE_RELEASE(wicFrame);
+	SAFE_RELEASE(wicDecoder);
+
+	return imageSize;
+}
+
+static bool ReadWholeFile(LPCWSTR filename, std::vector<BYTE>& contents) {
+	HANDLE file = CreateFileW(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	bool succeeded = GetFileSizeEx(file, &fileSize) && fileSize.HighPart == 0;
+
+	if (succeeded) {
+		contents.resize(fileSize.LowPart);
+
+		DWORD bytesRead = 0;
+		succeeded = fileSize.LowPart == 0 || (ReadFile(file, &contents[0], fileSize.LowPart, &bytesRead, NULL) && bytesRead == fileSize.LowPart);
+	}
+
+	CloseHandle(file);
+	return succeeded;
+}
+
+bool LoadDdsImageFromFile(DdsImage& image, D3D12_RESOURCE_DESC& resourceDescription, std::vector<D3D12_SUBRESOURCE_DATA>& subresources, LPCWSTR filename) {
+	std::vector<BYTE> contents;
+	if (!ReadWholeFile(filename, contents) || contents.empty())
+		return false;
+
+	if (!ReadDds(&contents[0], contents.size(), image))
+		return false;
+
+	DXGI_FORMAT dxgiFormat = (DXGI_FORMAT)image.format;
+
+	resourceDescription = CD3DX12_RESOURCE_DESC::Tex2D(dxgiFormat, image.width, image.height, 1, (UINT16)image.levels.size());
+
+	// the blocks are uploaded as they are, the gpu decompresses them when sampling
+	subresources.resize(image.levels.size());
+	for (size_t i = 0; i < image.levels.size(); ++i) {
+		const DdsLevel& level = image.levels[i];
+
+		UINT rowPitch, rowCount;
+		GetDXGIFormatSurfaceInfo(dxgiFormat, level.width, level.height, rowPitch, rowCount);
+
+		subresources[i].pData = &image.data[level.offset];
+		subresources[i].RowPitch = rowPitch;
+		subresources[i].SlicePitch = (LONG_PTR)rowPitch * rowCount;
+	}
+
+	return true;
+}
+
+// image conversion functions
+DXGI_FORMAT GetDXGIFormatFromWICFormat(WICPixelFormatGUID& wicFormatGUID)
+{
+	if (wicFormatGUID == GUID_WICPixelFormat128bppRGBAFloat) return DXGI_FORMAT_R32G32B32A32_FLOAT;
+	else if (wicFormatGUID == GUID_WICPixelFormat64bppRGBAHalf) return DXGI_FORMAT_R16G16B16A16_FLOAT;
+	else if (wicFormatGUID == GUID_WICPixelFormat64bppRGBA) return DXGI_FORMAT_R16G16B16A16_UNORM;
+	else if (wicFormatGUID == GUID_WICPixelFormat32bppRGBA) return DXGI_FORMAT_R8G8B8A8_UNORM;
+	else if (wicFormatGUID == GUID_WICPixelFormat32bppBGRA) return DXGI_FORMAT_B8G8R8A8_UNORM;
+	else if (wicFormatGUID == GUID_WICPixelFormat32bppBGR) return DXGI_FORMAT_B8G8R8X8_UNORM;
+	else if (wicFormatGUID == GUID_WICPixelFormat32bppRGBA1010102XR) return DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM;
+
+	else if (wicFormatGUID == GUID_WICPixelFormat32bppRGBA1010102) return DXGI_FORMAT_R10G10B10A2_UNORM;
+	else if (wicFormatGUID == GUID_WICPixelFormat16bppBGRA5551) return DXGI_FORMAT_B5G5R5A1_UNORM;
+	else if (wicFormatGUID == GUID_WICPixelFormat16bppBGR565) return DXGI_FORMAT_B5G6R5_UNORM;
+	else if (wicFormatGUID == GUID_WICPixelFormat32bppGrayFloat) return DXGI_FORMAT_R32_FLOAT;
+	else if (wicFormatGUID == GUID_WICPixelFormat16bppGrayHalf) return DXGI_FORMAT_R16_FLOAT;
+	else if (wicFormatGUID == GUID_WICPixelFormat16bppGray) return DXGI_FORMAT_R16_UNORM;
+	else if (wicFormatGUID == GUID_WICPixelFormat8bppGray) return DXGI_FORMAT_R8_UNORM;
+	else if (wicFormatGUID == GUID_WICPixelFormat8bppAlpha) return DXGI_FORMAT_A8_UNORM;
+
+	else return DXGI_FORMAT_UNKNOWN;
+}
+
+// get a dxgi compatible wic format from another wic format
+WICPixelFormatGUID GetConvertToWICFormat(WICPixelFormatGUID& wicFormatGUID)
+{
+	if (wicFormatGUID == GUID_WICPixelFormatBlackWhite) return GUID_WICPixelFormat8bppGray;
+	else if (wicFormatGUID == GUID_WICPixelFormat1bppIndexed) return GUID_WICPixelFormat32bppRGBA;
+	else if (wicFormatGUID == GUID_WICPixelFormat2bppIndexed) return GUID_WICPixelFormat32bppRGBA;
+	else if (wicFormatGUID == GUID_WICPixelFormat4bppIndexed) return GUID_WICPixelFormat32bppRGBA;
+	else if (wicFormatGUID == GUID_WICPixelFormat8bppIndexed) return GUID_WICPixelFormat32bppRGBA;
+	else if (wicFormatGUID == GUID_WICPixelFormat2bppGray) return GUID_WICPixelFormat8bppGray;
+	else if (wicFormatGUID == GUID_WICPixelFormat4bppGray) return GUID_WICPixelFormat8bppGray;
+	else if (wicFormatGUID == GUID_WICPixelFormat16bppGrayFixedPoint) return GUID_WICPixelFormat16bppGrayHalf;
+	else if (wicFormatGUID == GUID_WICPixelFormat32bppGrayFixedPoint) return GUID_WICPixelFormat32bppGrayFloat;
+	else if (wicFormatGUID == GUID_WICPixelFormat16bppBGR555) return GUID_WICPixelFormat16bppBGRA5551;
+	else if (wicFormatGUID == GUID_WICPixelFormat32bppBGR101010) return GUID_WICPixelFormat32bppRGBA1010102;
+	else if (wicFormatGUID == GUID_WICPixelFormat24bppBGR) return GUID_WICPixelFormat32bppRGBA;
+	else if (wicFormatGUID == GUID_WICPixelFormat24bppRGB) return GUID_WICPixelFormat32bppRGBA;
+	else if (wicFormatGUID == GUID_WICPixelFormat32bppPBGRA) return GUID_WICPixelFormat32bppRGBA;
+	else if (wicFormatGUID == GUID_WICPixelFormat32bppPRGBA) return GUID_WICPixelFormat32bppRGBA;
+	else if (wicFormatGUID == GUID_WICPixelFormat48bppRGB) return GUID_WICPixelFormat64bppRGBA;
+	else if (wicFormatGUID == GUID_WICPixelFormat48bppBGR) return GUID_WICPixelFormat64bppRGBA;
+	else if (wicFormatGUID == GUID_WICPixelFormat64bppBGRA) return GUID_WICPixelFormat64bppRGBA;
+	else if (wicFormatGUID == GUID_WICPixelFormat64bppPRGBA) return GUID_WICPixelFormat64bppRGBA;
+	else if (wicFormatGUID == GUID_WICPixelFormat64bppPBGRA) return GUID_WICPixelFormat64bppRGBA;
+	else if (wicFormatGUID == GUID_WICPixelFormat48bppRGBFixedPoint) return GUID_WICPixelFormat64bppRGBAHalf;
+	else if (wicFormatGUID == GUID_WICPixelFormat48bppBGRFixedPoint) return GUID_WICPixelFormat64bppRGBAHalf;
+	else if (wicFormatGUID == GUID_WICPixelFormat64bppRGBAFixedPoint) return GUID_WICPixelFormat64bppRGBAHalf;
+	else if (wicFormatGUID == GUID_WICPixelFormat64bppBGRAFixedPoint) return GUID_WICPixelFormat64bppRGBAHalf;
+	else if (wicFormatGUID == GUID_WICPixelFormat64bppRGBFixedPoint) return GUID_WICPixelFormat64bppRGBAHalf;
+	else if (wicFormatGUID == GUID_WICPixelFormat64bppRGBHalf) return GUID_WICPixelFormat64bppRGBAHalf;
+	else if (wicFormatGUID == GUID_WICPixelFormat48bppRGBHalf) return GUID_WICPixelFormat64bppRGBAHalf;
+	else if (wicFormatGUID == GUID_WICPixelFormat128bppPRGBAFloat) return GUID_WICPixelFormat128bppRGBAFloat;
+	else if (wicFormatGUID == GUID_WICPixelFormat128bppRGBFloat) return GUID_WICPixelFormat128bppRGBAFloat;
+	else if (wicFormatGUID == GUID_WICPixelFormat128bppRGBAFixedPoint) return GUID_WICPixelFormat128bppRGBAFloat;
+	else if (wicFormatGUID == GUID_WICPixelFormat128bppRGBFixedPoint) return GUID_WICPixelFormat128bppRGBAFloat;
+	else if (wicFormatGUID == GUID_WICPixelFormat32bppRGBE) return GUID_WICPixelFormat128bppRGBAFloat;
+	else if (wicFormatGUID == GUID_WICPixelFormat32bppCMYK) return GUID_WICPixelFormat32bppRGBA;
+	else if (wicFormatGUID == GUID_WICPixelFormat64bppCMYK) return GUID_WICPixelFormat64bppRGBA;
+	else if (wicFormatGUID == GUID_WICPixelFormat40bppCMYKAlpha) return GUID_WICPixelFormat64bppRGBA;
+	else if (wicFormatGUID == GUID_WICPixelFormat80bppCMYKAlpha) return GUID_WICPixelFormat64bppRGBA;
+
+#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8) || defined(_WIN7_PLATFORM_UPDATE)
+	else if (wicFormatGUID == GUID_WICPixelFormat32bppRGB) return GUID_WICPixelFormat32bppRGBA;
+	else if (wicFormatGUID == GUID_WICPixelFormat64bppRGB) return GUID_WICPixelFormat64bppRGBA;
+	else if (wicFormatGUID == GUID_WICPixelFormat64bppPRGBAHalf) return GUID_WICPixelFormat64bppRGBAHalf;
+#endif
+
+	else return GUID_WICPixelFormatDontCare;
+}
+
+// get the number of bits per pixel for a dxgi format
+int GetDXGIFormatBitsPerPixel(DXGI_FORMAT& dxgiFormat)
+{
+	if (dxgiFormat == DXGI_FORMAT_R32G32B32A32_FLOAT) return 128;
+	else if (dxgiFormat == DXGI_FORMAT_R16G16B16A16_FLOAT) return 64;
+	else if (dxgiFormat == DXGI_FORMAT_R16G16B16A16_UNORM) return 64;
+	else if (dxgiFormat == DXGI_FORMAT_R8G8B8A8_UNORM) return 32;
+	else if (dxgiFormat == DXGI_FORMAT_B8G8R8A8_UNORM) return 32;
+	else if (dxgiFormat == DXGI_FORMAT_B8G8R8X8_UNORM) return 32;
+	else if (dxgiFormat == DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM) return 32;
+
+	else if (dxgiFormat == DXGI_FORMAT_R10G10B10A2_UNORM) return 32;
+	else if (dxgiFormat == DXGI_FORMAT_B5G5R5A1_UNORM) return 16;
+	else if (dxgiFormat == DXGI_FORMAT_B5G6R5_UNORM) return 16;
+	else if (dxgiFormat == DXGI_FORMAT_R32_FLOAT) return 32;
+	else if (dxgiFormat == DXGI_FORMAT_R16_FLOAT) return 16;
+	else if (dxgiFormat == DXGI_FORMAT_R16_UNORM) return 16;
+	else if (dxgiFormat == DXGI_FORMAT_R8_UNORM) return 8;
+	else if (dxgiFormat == DXGI_FORMAT_A8_UNORM) return 8;
+
+	// average over a 4x4 block
+	else if (dxgiFormat == DXGI_FORMAT_BC1_UNORM) return 4;
+	else if (dxgiFormat == DXGI_FORMAT_BC3_UNORM) return 8;
+	else if (dxgiFormat == DXGI_FORMAT_BC4_UNORM) return 4;
+	else if (dxgiFormat == DXGI_FORMAT_BC5_UNORM) return 8;
+	else if (dxgiFormat == DXGI_FORMAT_BC7_UNORM) return 8;
+
+	else return 0;
+}
+
+bool IsBlockCompressedFormat(DXGI_FORMAT dxgiFormat)
+{
+	return dxgiFormat == DXGI_FORMAT_BC1_UNORM || dxgiFormat == DXGI_FORMAT_BC3_UNORM || dxgiFormat == DXGI_FORMAT_BC4_UNORM ||
+		dxgiFormat == DXGI_FORMAT_BC5_UNORM || dxgiFormat == DXGI_FORMAT_BC7_UNORM;
+}
+
+void GetDXGIFormatSurfaceInfo(DXGI_FORMAT dxgiFormat, UINT width, UINT height, UINT& rowPitch, UINT& rowCount)
+{
+	int bitsPerPixel = GetDXGIFormatBitsPerPixel(dxgiFormat);
+
+	if (IsBlockCompressedFormat(dxgiFormat)) {
+		// a block is 4x4 pixels, partial blocks at the edges still take a whole block
+		UINT blocksWide = width > 0 ? (width + 3) / 4 : 1;
+		UINT blocksHigh = height > 0 ? (height + 3) / 4 : 1;
+
+		rowPitch = blocksWide * bitsPerPixel * 16 / 8;
+		rowCount = blocksHigh;
+	}
+	else {
+		rowPitch = (width * bitsPerPixel + 7) / 8;
+		rowCount = height;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+// image decoding, and loading of dds files
+// jpeg and png go through the built in decoder (ImageDecoder.h), everything else and whatever it does not take
+// through the windows imaging component (wic)
+// safe to call from several threads at once, every thread gets its own wic factory
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#include <windows.h>
+#include <wincodec.h>
+
+#include <d3d12.h>
+
+#include <vector>
+
+#include "DdsFile.h"
+
+// returns the size of the image in bytes, or 0 if it could not be loaded
+// imageData is allocated with malloc and has to be freed by the caller
+int LoadImageDataFromFile(BYTE** imageData, D3D12_RESOURCE_DESC& resourceDescription, LPCWSTR filename, int& bytesPerRow);
+
+// the same through wic only, the decoder's reference
+int LoadImageDataFromFileWithWIC(BYTE** imageData, D3D12_RESOURCE_DESC& resourceDescription, LPCWSTR filename, int& bytesPerRow);
+
+// reads a dds file, the subresources point into image.data so it has to outlive them
+// returns false if the file is missing or its format is not supported
+bool LoadDdsImageFromFile(DdsImage& image, D3D12_RESOURCE_DESC& resourceDescription, std::vector<D3D12_SUBRESOURCE_DATA>& subresources, LPCWSTR filename);
+
+DXGI_FORMAT  GetDXGIFormatFromWICFormat(WICPixelFormatGUID& wicFormatGUID);
+WICPixelFormatGUID GetConvertToWICFormat(WICPixelFormatGUID& wicFormatGUID);
+int GetDXGIFormatBitsPerPixel(DXGI_FORMAT& dxgiFormat);
+
+bool IsBlockCompressedFormat(DXGI_FORMAT dxgiFormat);
+// bytes per row (of 4x4 blocks for bc formats) and number of rows of one mip level
+void GetDXGIFormatSurfaceInfo(DXGI_FORMAT dxgiFormat, UINT width, UINT height, UINT& rowPitch, UINT& rowCount);
@@ -0,0 +1,65 @@
+// tests every object of the scene against the frustum and appends an indirect draw for each visible one
+// GpuCullObject in GpuCulling.cpp is the same on the cpu
+
+// same layout as GpuSceneObject
+struct SceneObject
+{
+    float4x4 worldMat;
+    float4 boundsMin;
+    float4 boundsMax;
+};
+
+// the object index root constant, then D3D12_DRAW_INDEXED_ARGUMENTS
+struct DrawCommand
+{
+    uint objectIndex;
+    uint indexCountPerInstance;
+    uint instanceCount;
+    uint startIndexLocation;
+    int baseVertexLocation;
+    uint startInstanceLocation;
+};
+
+// same layout as GpuCullConstants
+cbuffer CullConstants : register(b0)
+{
+    float4 planes[6];
+    uint objectCount;
+    uint indexCount;
+};
+
+StructuredBuffer<SceneObject> objects : register(t0);
+RWStructuredBuffer<DrawCommand> commands : register(u0);
+// the count ExecuteIndirect reads, zeroed before the dispatch
+RWByteAddressBuffer drawCount : register(u1);
+
+[numthreads(64, 1, 1)]
+void main(uint3 dispatchThreadID : SV_DispatchThreadID)
+{
+    uint index = dispatchThreadID.x;
+    if (index >= objectCount)
+        return;
+
+    SceneObject object = objects[index];
+
+    // the corner furthest along the plane normal, if it is behind the plane the whole box is
+    for (uint i = 0; i < 6; ++i)
+    {
+        float4 plane = planes[i];
+        float3 corner = plane.xyz >= 0.0f ? object.boundsMax.xyz : object.boundsMin.xyz;
+        if (dot(plane.xyz, corner) + plane.w < 0.0f)
+            return;
+    }
+
+    uint slot;
+    drawCount.InterlockedAdd(0, 1, slot);
+
+    DrawCommand command;
+    command.objectIndex = index;
+    command.indexCountPerInstance = indexCount;
+    command.instanceCount = 1;
+    command.startIndexLocation = 0;
+    command.baseVertexLocation = 0;
+    command.startInstanceLocation = 0;
+    commands[slot] = command;
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#include "VertexInput.hlsli"
+
+struct VS_OUTPUT
+{
+    float4 pos: SV_POSITION;
+    float4 texCoord: TEXCOORD;
+};
+
+// same layout as GpuSceneObject
+struct SceneObject
+{
+    float4x4 worldMat;
+    float4 boundsMin;
+    float4 boundsMax;
+};
+
+cbuffer SceneConstants : register(b0)
+{
+    float4x4 viewProjMat;
+};
+
+// set by the command signature for every draw the culling shader wrote
+cbuffer DrawConstants : register(b3)
+{
+    uint objectIndex;
+};
+
+StructuredBuffer<SceneObject> objects : register(t1);
+
+VS_OUTPUT main(VS_INPUT input)
+{
+    VS_OUTPUT output;
+    output.pos = mul(mul(GetObjectPosition(input), objects[objectIndex].worldMat), viewProjMat);
+    output.texCoord = float4(input.texCoord, 0.0f, 0.0f);
+    return output;
+}
\ No newline at end of file
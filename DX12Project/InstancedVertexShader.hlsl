@@ -0,0 +1,23 @@
+#include "VertexInput.hlsli"
+
+struct VS_OUTPUT
+{
+    float4 pos: SV_POSITION;
+    float4 texCoord: TEXCOORD;
+};
+
+// one entry per instance, same layout as ConstantBufferPerObject
+struct InstanceData
+{
+    float4x4 wvpMat;
+};
+
+StructuredBuffer<InstanceData> instances : register(t1);
+
+VS_OUTPUT main(VS_INPUT input, uint instanceID : SV_InstanceID)
+{
+    VS_OUTPUT output;
+    output.pos = mul(GetObjectPosition(input), instances[instanceID].wvpMat);
+    output.texCoord = float4(input.texCoord, 0.0f, 0.0f);
+    return output;
+}
\ No newline at end of file
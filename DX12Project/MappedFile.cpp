@@ -0,0 +1,48 @@
+#include "MappedFile.h"
+
+bool MappedFileOpen(MappedFile& mappedFile, LPCWSTR filename) {
+	mappedFile.file = INVALID_HANDLE_VALUE;
+	mappedFile.mapping = NULL;
+	mappedFile.data = NULL;
+	mappedFile.size = 0;
+
+	mappedFile.file = CreateFileW(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (mappedFile.file == INVALID_HANDLE_VALUE)
+		return false;
+
+	// mapping an empty file fails anyway
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(mappedFile.file, &fileSize) || fileSize.QuadPart == 0 || (uint64_t)fileSize.QuadPart > SIZE_MAX) {
+		MappedFileClose(mappedFile);
+		return false;
+	}
+
+	mappedFile.mapping = CreateFileMappingW(mappedFile.file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mappedFile.mapping == NULL) {
+		MappedFileClose(mappedFile);
+		return false;
+	}
+
+	mappedFile.data = static_cast<const uint8_t*>(MapViewOfFile(mappedFile.mapping, FILE_MAP_READ, 0, 0, 0));
+	if (mappedFile.data == NULL) {
+		MappedFileClose(mappedFile);
+		return false;
+	}
+
+	mappedFile.size = (size_t)fileSize.QuadPart;
+	return true;
+}
+
+void MappedFileClose(MappedFile& mappedFile) {
+	if (mappedFile.data != NULL)
+		UnmapViewOfFile(mappedFile.data);
+	if (mappedFile.mapping != NULL)
+		CloseHandle(mappedFile.mapping);
+	if (mappedFile.file != INVALID_HANDLE_VALUE)
+		CloseHandle(mappedFile.file);
+
+	mappedFile.file = INVALID_HANDLE_VALUE;
+	mappedFile.mapping = NULL;
+	mappedFile.data = NULL;
+	mappedFile.size = 0;
+}
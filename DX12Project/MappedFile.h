@@ -0,0 +1,25 @@
+#pragma once
+
+// read only files mapped into memory, so cooked assets go from the page cache to upload memory in one copy
+// views start on the allocation granularity, which is aligned enough for every cooked format
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#include <windows.h>
+
+#include <cstdint>
+
+struct MappedFile {
+	HANDLE file;
+	HANDLE mapping;
+	const uint8_t* data;
+	size_t size;
+};
+
+// false if the file does not exist or is empty
+bool MappedFileOpen(MappedFile& mappedFile, LPCWSTR filename);
+
+// data is not valid after this
+void MappedFileClose(MappedFile& mappedFile);
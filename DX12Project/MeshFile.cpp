@@ -0,0 +1,114 @@
+#include "MeshFile.h"
+
+#include <cstring>
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// a section of count elements of size bytes at offset, after the end of the previous one
+static bool IsSectionInFile(uint64_t offset, uint64_t count, uint64_t size, uint64_t previousEnd, size_t fileSize) {
+	return offset % meshFileSectionAlignment == 0 && offset >= previousEnd && offset <= fileSize && count * size <= fileSize - offset;
+}
+
+static uint32_t GetIndexSize(uint32_t indexFormat) {
+	switch (indexFormat) {
+	case MESH_INDEX_FORMAT_UINT16: return 2;
+	case MESH_INDEX_FORMAT_UINT32: return 4;
+	default: return 0;
+	}
+}
+
+bool ReadMeshFile(const uint8_t* file, size_t fileSize, MeshView& view) {
+	if (fileSize < sizeof(MeshFileHeader))
+		return false;
+
+	const MeshFileHeader* header = reinterpret_cast<const MeshFileHeader*>(file);
+	if (header->magic != meshFileMagic || header->version != meshFileVersion || header->headerSize != sizeof(MeshFileHeader) || header->fileSize != fileSize)
+		return false;
+
+	uint32_t stride = GetVertexLayoutStride(header->vertexLayout);
+	uint32_t indexSize = GetIndexSize(header->indexFormat);
+	if (stride == 0 || stride != header->vertexStride || indexSize == 0 || header->indexCount % 3 != 0)
+		return false;
+
+	uint64_t vertexDataSize = (uint64_t)header->vertexCount * stride;
+	uint64_t indexDataSize = (uint64_t)header->indexCount * indexSize;
+	if (!IsSectionInFile(header->vertexOffset, header->vertexCount, stride, sizeof(MeshFileHeader), fileSize) ||
+		!IsSectionInFile(header->indexOffset, header->indexCount, indexSize, header->vertexOffset + vertexDataSize, fileSize))
+		return false;
+
+	if (header->meshletTriangleCount != header->indexCount / 3 ||
+		!IsSectionInFile(header->meshletOffset, header->meshletCount, sizeof(Meshlet), header->indexOffset + indexDataSize, fileSize) ||
+		!IsSectionInFile(header->meshletBoundsOffset, header->meshletCount, sizeof(MeshletBounds), header->meshletOffset + header->meshletCount * sizeof(Meshlet), fileSize) ||
+		!IsSectionInFile(header->meshletVertexOffset, header->meshletVertexCount, sizeof(uint32_t), header->meshletBoundsOffset + header->meshletCount * sizeof(MeshletBounds), fileSize) ||
+		!IsSectionInFile(header->meshletTriangleOffset, header->meshletTriangleCount, sizeof(uint32_t), header->meshletVertexOffset + header->meshletVertexCount * sizeof(uint32_t), fileSize))
+		return false;
+
+	view.header = header;
+	view.vertices = file + header->vertexOffset;
+	view.vertexDataSize = vertexDataSize;
+	view.indices = file + header->indexOffset;
+	view.indexDataSize = indexDataSize;
+	view.meshlets = reinterpret_cast<const Meshlet*>(file + header->meshletOffset);
+	view.meshletBounds = reinterpret_cast<const MeshletBounds*>(file + header->meshletBoundsOffset);
+	view.meshletVertices = reinterpret_cast<const uint32_t*>(file + header->meshletVertexOffset);
+	view.meshletTriangles = reinterpret_cast<const uint32_t*>(file + header->meshletTriangleOffset);
+	return true;
+}
+
+static void WriteSection(std::vector<uint8_t>& file, uint64_t offset, const void* data, size_t size) {
+	if (size > 0)
+		memcpy(&file[(size_t)offset], data, size);
+}
+
+void WriteMeshFile(const QuantizedVertices& vertices, const uint32_t* indices, uint32_t indexCount, const MeshletSet& meshlets, std::vector<uint8_t>& file) {
+	uint32_t stride = vertices.stride;
+	uint32_t vertexCount = vertices.vertexCount;
+	uint32_t indexFormat = vertexCount <= 0x10000 ? MESH_INDEX_FORMAT_UINT16 : MESH_INDEX_FORMAT_UINT32;
+
+	MeshFileHeader header = {};
+	header.magic = meshFileMagic;
+	header.version = meshFileVersion;
+	header.headerSize = sizeof(MeshFileHeader);
+	header.vertexLayout = vertices.layout;
+	header.vertexStride = stride;
+	header.vertexCount = vertexCount;
+	header.indexFormat = indexFormat;
+	header.indexCount = indexCount;
+	header.vertexOffset = AlignUp(sizeof(MeshFileHeader), meshFileSectionAlignment);
+	header.indexOffset = AlignUp(header.vertexOffset + (uint64_t)vertexCount * stride, meshFileSectionAlignment);
+
+	header.meshletCount = (uint32_t)meshlets.meshlets.size();
+	header.meshletVertexCount = (uint32_t)meshlets.vertices.size();
+	header.meshletTriangleCount = (uint32_t)meshlets.triangles.size();
+	header.meshletOffset = AlignUp(header.indexOffset + (uint64_t)indexCount * GetIndexSize(indexFormat), meshFileSectionAlignment);
+	header.meshletBoundsOffset = AlignUp(header.meshletOffset + header.meshletCount * sizeof(Meshlet), meshFileSectionAlignment);
+	header.meshletVertexOffset = AlignUp(header.meshletBoundsOffset + header.meshletCount * sizeof(MeshletBounds), meshFileSectionAlignment);
+	header.meshletTriangleOffset = AlignUp(header.meshletVertexOffset + header.meshletVertexCount * sizeof(uint32_t), meshFileSectionAlignment);
+	header.fileSize = AlignUp(header.meshletTriangleOffset + header.meshletTriangleCount * sizeof(uint32_t), meshFileSectionAlignment);
+
+	memcpy(header.boundsMin, vertices.boundsMin, sizeof(header.boundsMin));
+	memcpy(header.boundsMax, vertices.boundsMax, sizeof(header.boundsMax));
+	memcpy(header.positionScale, vertices.positionScale, sizeof(header.positionScale));
+	memcpy(header.positionOffset, vertices.positionOffset, sizeof(header.positionOffset));
+
+	// padding is zeroed, so cooking the same mesh twice gives the same file
+	file.assign((size_t)header.fileSize, 0);
+	memcpy(&file[0], &header, sizeof(header));
+	WriteSection(file, header.vertexOffset, vertices.data.data(), (size_t)vertexCount * stride);
+	WriteSection(file, header.meshletOffset, meshlets.meshlets.data(), meshlets.meshlets.size() * sizeof(Meshlet));
+	WriteSection(file, header.meshletBoundsOffset, meshlets.bounds.data(), meshlets.bounds.size() * sizeof(MeshletBounds));
+	WriteSection(file, header.meshletVertexOffset, meshlets.vertices.data(), meshlets.vertices.size() * sizeof(uint32_t));
+	WriteSection(file, header.meshletTriangleOffset, meshlets.triangles.data(), meshlets.triangles.size() * sizeof(uint32_t));
+
+	if (indexFormat == MESH_INDEX_FORMAT_UINT32) {
+		WriteSection(file, header.indexOffset, indices, (size_t)indexCount * sizeof(uint32_t));
+		return;
+	}
+
+	for (uint32_t i = 0; i < indexCount; ++i) {
+		uint16_t index = (uint16_t)indices[i];
+		memcpy(&file[(size_t)header.indexOffset + i * sizeof(uint16_t)], &index, sizeof(index));
+	}
+}
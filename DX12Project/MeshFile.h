@@ -0,0 +1,81 @@
+#pragma once
+
+// cooked meshes, laid out so a mapped file can be handed to the upload as is
+// a fixed size header is followed by the vertex and the index data and the meshlets, each section starting on
+// meshFileSectionAlignment
+// reading only checks the header and points into the file, nothing is parsed or copied
+// little endian only, which is everything that runs d3d12
+// no d3d12 dependency, file io is left to the caller
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Meshlet.h"
+#include "VertexLayout.h"
+
+// "MESH"
+const uint32_t meshFileMagic = 0x4853454d;
+
+// bumped whenever the layout changes, older files are rejected and have to be cooked again
+const uint32_t meshFileVersion = 3;
+
+// enough for aligned simd loads and for copies straight into upload memory
+const uint64_t meshFileSectionAlignment = 64;
+
+// same values as DXGI_FORMAT so they can be cast to it
+enum MeshIndexFormat {
+	MESH_INDEX_FORMAT_UINT32 = 42,
+	MESH_INDEX_FORMAT_UINT16 = 57,
+};
+
+struct MeshFileHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t headerSize;
+	VertexLayout vertexLayout;
+	uint32_t vertexStride;
+	uint32_t vertexCount;
+	uint32_t indexFormat;
+	uint32_t indexCount;
+	// from the start of the file
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+	uint64_t fileSize;
+	// of every position
+	float boundsMin[3];
+	float boundsMax[3];
+	// position = stored position * positionScale + positionOffset, see QuantizedVertices
+	float positionScale[3];
+	float positionOffset[3];
+	// see MeshletSet, the meshlets cover every triangle in index buffer order
+	uint32_t meshletCount;
+	uint32_t meshletVertexCount;
+	uint32_t meshletTriangleCount;
+	uint32_t padding;
+	uint64_t meshletOffset;
+	uint64_t meshletBoundsOffset;
+	uint64_t meshletVertexOffset;
+	uint64_t meshletTriangleOffset;
+};
+
+// points into the file it was made from
+struct MeshView {
+	const MeshFileHeader* header;
+	const void* vertices;
+	uint64_t vertexDataSize;
+	const void* indices;
+	uint64_t indexDataSize;
+	const Meshlet* meshlets;
+	const MeshletBounds* meshletBounds;
+	const uint32_t* meshletVertices;
+	const uint32_t* meshletTriangles;
+};
+
+// false if the file is not a mesh of this version or its sections do not fit in it
+// file has to be aligned to meshFileSectionAlignment for the sections to be, a mapped file always is
+bool ReadMeshFile(const uint8_t* file, size_t fileSize, MeshView& view);
+
+// indices are written as 16 bit if every vertex can be reached with them
+// meshlets have to be built from the same indices, over the same vertices
+void WriteMeshFile(const QuantizedVertices& vertices, const uint32_t* indices, uint32_t indexCount, const MeshletSet& meshlets, std::vector<uint8_t>& file);
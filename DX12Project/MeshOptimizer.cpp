@@ -0,0 +1,367 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+const uint32_t invalidIndex = 0xffffffff;
+
+// Forsyth's cache model and scoring constants
+const int forsythCacheSize = 32;
+const float forsythCacheDecayPower = 1.5f;
+const float forsythLastTriangleScore = 0.75f;
+const float forsythValenceBoostScale = 2.0f;
+const float forsythValenceBoostPower = 0.5f;
+
+static uint32_t HashVertex(const uint8_t* vertex, uint32_t stride) {
+	// fnv-1a
+	uint32_t hash = 2166136261u;
+	for (uint32_t i = 0; i < stride; ++i) {
+		hash ^= vertex[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+uint32_t MeshWeldVertices(const void* vertices, uint32_t vertexCount, uint32_t stride, std::vector<uint32_t>& remap) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(vertices);
+
+	// open addressing, at most half full
+	uint32_t tableSize = 1;
+	while (tableSize < vertexCount * 2)
+		tableSize *= 2;
+	std::vector<uint32_t> table(tableSize, invalidIndex);
+
+	remap.resize(vertexCount);
+	uint32_t uniqueCount = 0;
+
+	for (uint32_t i = 0; i < vertexCount; ++i) {
+		const uint8_t* vertex = bytes + (size_t)i * stride;
+		uint32_t slot = HashVertex(vertex, stride) & (tableSize - 1);
+
+		while (table[slot] != invalidIndex && memcmp(bytes + (size_t)table[slot] * stride, vertex, stride) != 0)
+			slot = (slot + 1) & (tableSize - 1);
+
+		if (table[slot] == invalidIndex) {
+			table[slot] = i;
+			remap[i] = uniqueCount++;
+		}
+		else {
+			remap[i] = remap[table[slot]];
+		}
+	}
+
+	return uniqueCount;
+}
+
+void MeshRemapVertices(void* destination, const void* vertices, uint32_t vertexCount, uint32_t stride, const uint32_t* remap) {
+	uint8_t* to = static_cast<uint8_t*>(destination);
+	const uint8_t* from = static_cast<const uint8_t*>(vertices);
+
+	for (uint32_t i = 0; i < vertexCount; ++i) {
+		if (remap[i] != invalidIndex)
+			memcpy(to + (size_t)remap[i] * stride, from + (size_t)i * stride, stride);
+	}
+}
+
+void MeshRemapIndices(uint32_t* indices, uint32_t indexCount, const uint32_t* remap) {
+	for (uint32_t i = 0; i < indexCount; ++i)
+		indices[i] = remap[indices[i]];
+}
+
+// high for vertices that were just used and for vertices with few triangles left, so lone triangles go early
+static float GetForsythVertexScore(int cachePosition, uint32_t remainingTriangles) {
+	if (remainingTriangles == 0)
+		return -1.0f;
+
+	float score = 0.0f;
+	if (cachePosition >= 0) {
+		// the last triangle's vertices get a fixed score, so the next triangle does not just reuse its edge
+		if (cachePosition < 3)
+			score = forsythLastTriangleScore;
+		else
+			score = powf(1.0f - (float)(cachePosition - 3) / (forsythCacheSize - 3), forsythCacheDecayPower);
+	}
+
+	return score + forsythValenceBoostScale * powf((float)remainingTriangles, -forsythValenceBoostPower);
+}
+
+void MeshOptimizeVertexCache(uint32_t* destination, const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount) {
+	uint32_t triangleCount = indexCount / 3;
+
+	// triangles of vertex v are adjacency[adjacencyStart[v] ..], the first remaining[v] of them not emitted yet
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	for (uint32_t i = 0; i < indexCount; ++i)
+		++remaining[indices[i]];
+
+	std::vector<uint32_t> adjacencyStart(vertexCount + 1, 0);
+	for (uint32_t i = 0; i < vertexCount; ++i)
+		adjacencyStart[i + 1] = adjacencyStart[i] + remaining[i];
+
+	std::vector<uint32_t> adjacency(indexCount);
+	std::vector<uint32_t> filled(vertexCount, 0);
+	for (uint32_t i = 0; i < indexCount; ++i) {
+		uint32_t vertex = indices[i];
+		adjacency[adjacencyStart[vertex] + filled[vertex]++] = i / 3;
+	}
+
+	std::vector<int> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; ++i)
+		vertexScores[i] = GetForsythVertexScore(-1, remaining[i]);
+
+	std::vector<bool> emitted(triangleCount, false);
+	uint32_t bestTriangle = invalidIndex;
+	float bestScore = -1.0f;
+	for (uint32_t i = 0; i < triangleCount; ++i) {
+		float score = vertexScores[indices[i * 3]] + vertexScores[indices[i * 3 + 1]] + vertexScores[indices[i * 3 + 2]];
+		if (score > bestScore) {
+			bestScore = score;
+			bestTriangle = i;
+		}
+	}
+
+	// three more than the cache, the vertices pushed out by the last triangle get their scores updated too
+	uint32_t cache[forsythCacheSize + 3];
+	uint32_t newCache[forsythCacheSize + 3];
+	int cacheCount = 0;
+	uint32_t inputCursor = 0;
+
+	for (uint32_t written = 0; written < triangleCount; ++written) {
+		// nothing in the cache has triangles left, start over with the next one in input order
+		if (bestTriangle == invalidIndex) {
+			while (emitted[inputCursor])
+				++inputCursor;
+			bestTriangle = inputCursor;
+		}
+
+		const uint32_t* triangle = &indices[bestTriangle * 3];
+		destination[written * 3] = triangle[0];
+		destination[written * 3 + 1] = triangle[1];
+		destination[written * 3 + 2] = triangle[2];
+		emitted[bestTriangle] = true;
+
+		for (int i = 0; i < 3; ++i) {
+			uint32_t vertex = triangle[i];
+			uint32_t* triangles = &adjacency[adjacencyStart[vertex]];
+			for (uint32_t j = 0; j < remaining[vertex]; ++j) {
+				if (triangles[j] == bestTriangle) {
+					std::swap(triangles[j], triangles[remaining[vertex] - 1]);
+					break;
+				}
+			}
+			--remaining[vertex];
+		}
+
+		// the triangle's vertices go to the front, the rest keep their order behind them
+		int newCount = 0;
+		for (int i = 0; i < 3; ++i) {
+			if (std::find(newCache, newCache + newCount, triangle[i]) == newCache + newCount)
+				newCache[newCount++] = triangle[i];
+		}
+		for (int i = 0; i < cacheCount; ++i) {
+			if (newCache[0] != cache[i] && (newCount < 2 || newCache[1] != cache[i]) && (newCount < 3 || newCache[2] != cache[i]))
+				newCache[newCount++] = cache[i];
+		}
+
+		for (int i = 0; i < newCount; ++i) {
+			uint32_t vertex = newCache[i];
+			cachePositions[vertex] = i < forsythCacheSize ? i : -1;
+			vertexScores[vertex] = GetForsythVertexScore(cachePositions[vertex], remaining[vertex]);
+		}
+
+		bestTriangle = invalidIndex;
+		bestScore = -1.0f;
+		for (int i = 0; i < newCount; ++i) {
+			uint32_t vertex = newCache[i];
+			const uint32_t* triangles = &adjacency[adjacencyStart[vertex]];
+			for (uint32_t j = 0; j < remaining[vertex]; ++j) {
+				uint32_t index = triangles[j];
+				const uint32_t* corners = &indices[index * 3];
+				float score = vertexScores[corners[0]] + vertexScores[corners[1]] + vertexScores[corners[2]];
+				if (score > bestScore) {
+					bestScore = score;
+					bestTriangle = index;
+				}
+			}
+		}
+
+		cacheCount = std::min(newCount, forsythCacheSize);
+		memcpy(cache, newCache, cacheCount * sizeof(uint32_t));
+	}
+}
+
+// vertices a fifo cache had to transform for the triangle, timestamps stand in for the cache contents
+static uint32_t UpdateFifoCache(const uint32_t* triangle, std::vector<uint32_t>& cacheTimestamps, uint32_t& timestamp, uint32_t cacheSize) {
+	uint32_t misses = 0;
+	for (int i = 0; i < 3; ++i) {
+		if (timestamp - cacheTimestamps[triangle[i]] > cacheSize) {
+			cacheTimestamps[triangle[i]] = timestamp++;
+			++misses;
+		}
+	}
+	return misses;
+}
+
+struct OverdrawCluster {
+	uint32_t firstTriangle;
+	uint32_t triangleCount;
+	float sortKey;
+};
+
+void MeshOptimizeOverdraw(uint32_t* destination, const uint32_t* indices, uint32_t indexCount, const void* vertices, uint32_t vertexCount, uint32_t stride, float threshold) {
+	uint32_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	// the cache starts over wherever all three vertices of a triangle miss, those are hard boundaries
+	std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+	uint32_t timestamp = meshVertexCacheSize + 1;
+
+	std::vector<uint32_t> hardBoundaries;
+	for (uint32_t i = 0; i < triangleCount; ++i) {
+		if (UpdateFifoCache(&indices[i * 3], cacheTimestamps, timestamp, meshVertexCacheSize) == 3 || i == 0)
+			hardBoundaries.push_back(i);
+	}
+	hardBoundaries.push_back(triangleCount);
+
+	// within a hard cluster, split wherever the cache did well enough so far that starting over costs little
+	std::vector<OverdrawCluster> clusters;
+	for (size_t i = 0; i + 1 < hardBoundaries.size(); ++i) {
+		uint32_t start = hardBoundaries[i];
+		uint32_t end = hardBoundaries[i + 1];
+
+		timestamp += meshVertexCacheSize + 1;
+		uint32_t clusterMisses = 0;
+		for (uint32_t j = start; j < end; ++j)
+			clusterMisses += UpdateFifoCache(&indices[j * 3], cacheTimestamps, timestamp, meshVertexCacheSize);
+		float clusterThreshold = threshold * (float)clusterMisses / (float)(end - start);
+
+		timestamp += meshVertexCacheSize + 1;
+		uint32_t clusterStart = start;
+		uint32_t runningMisses = 0;
+		for (uint32_t j = start; j < end; ++j) {
+			runningMisses += UpdateFifoCache(&indices[j * 3], cacheTimestamps, timestamp, meshVertexCacheSize);
+
+			if ((float)runningMisses <= clusterThreshold * (float)(j + 1 - clusterStart) || j + 1 == end) {
+				OverdrawCluster cluster;
+				cluster.firstTriangle = clusterStart;
+				cluster.triangleCount = j + 1 - clusterStart;
+				cluster.sortKey = 0.0f;
+				clusters.push_back(cluster);
+
+				clusterStart = j + 1;
+				runningMisses = 0;
+				timestamp += meshVertexCacheSize + 1;
+			}
+		}
+	}
+
+	// area weighted centroid and normal of every cluster, and of the whole mesh
+	const uint8_t* bytes = static_cast<const uint8_t*>(vertices);
+	std::vector<float> clusterData(clusters.size() * 6, 0.0f);
+	float meshCentroid[3] = {};
+	float meshArea = 0.0f;
+
+	for (size_t i = 0; i < clusters.size(); ++i) {
+		float* centroid = &clusterData[i * 6];
+		float* normal = &clusterData[i * 6 + 3];
+		float clusterArea = 0.0f;
+
+		for (uint32_t j = clusters[i].firstTriangle; j < clusters[i].firstTriangle + clusters[i].triangleCount; ++j) {
+			float p[3][3];
+			for (int k = 0; k < 3; ++k)
+				memcpy(p[k], bytes + (size_t)indices[j * 3 + k] * stride, sizeof(p[k]));
+
+			float e1[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+			float e2[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+			float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			float area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+			for (int k = 0; k < 3; ++k) {
+				centroid[k] += (p[0][k] + p[1][k] + p[2][k]) / 3.0f * area;
+				normal[k] += n[k];
+			}
+			clusterArea += area;
+		}
+
+		for (int k = 0; k < 3; ++k)
+			meshCentroid[k] += centroid[k];
+		meshArea += clusterArea;
+
+		float inverseArea = clusterArea > 0.0f ? 1.0f / clusterArea : 0.0f;
+		for (int k = 0; k < 3; ++k)
+			centroid[k] *= inverseArea;
+	}
+
+	float inverseMeshArea = meshArea > 0.0f ? 1.0f / meshArea : 0.0f;
+	for (int k = 0; k < 3; ++k)
+		meshCentroid[k] *= inverseMeshArea;
+
+	// clusters facing away from the center are on the outside, drawing them first lets them occlude the rest
+	for (size_t i = 0; i < clusters.size(); ++i) {
+		const float* centroid = &clusterData[i * 6];
+		const float* normal = &clusterData[i * 6 + 3];
+		float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		float inverseLength = length > 0.0f ? 1.0f / length : 0.0f;
+
+		float key = 0.0f;
+		for (int k = 0; k < 3; ++k)
+			key += (centroid[k] - meshCentroid[k]) * normal[k] * inverseLength;
+		clusters[i].sortKey = key;
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(), [](const OverdrawCluster& a, const OverdrawCluster& b) {
+		return a.sortKey > b.sortKey;
+	});
+
+	uint32_t written = 0;
+	for (size_t i = 0; i < clusters.size(); ++i) {
+		uint32_t count = clusters[i].triangleCount * 3;
+		memcpy(destination + written, indices + clusters[i].firstTriangle * 3, count * sizeof(uint32_t));
+		written += count;
+	}
+}
+
+uint32_t MeshOptimizeVertexFetch(void* destination, uint32_t* indices, uint32_t indexCount, const void* vertices, uint32_t vertexCount, uint32_t stride) {
+	uint8_t* to = static_cast<uint8_t*>(destination);
+	const uint8_t* from = static_cast<const uint8_t*>(vertices);
+
+	std::vector<uint32_t> remap(vertexCount, invalidIndex);
+	uint32_t usedCount = 0;
+
+	for (uint32_t i = 0; i < indexCount; ++i) {
+		uint32_t vertex = indices[i];
+		if (remap[vertex] == invalidIndex) {
+			memcpy(to + (size_t)usedCount * stride, from + (size_t)vertex * stride, stride);
+			remap[vertex] = usedCount++;
+		}
+		indices[i] = remap[vertex];
+	}
+
+	return usedCount;
+}
+
+MeshCacheStats MeshAnalyzeVertexCache(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize) {
+	std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+	uint32_t timestamp = cacheSize + 1;
+
+	std::vector<bool> used(vertexCount, false);
+	uint32_t usedCount = 0;
+
+	MeshCacheStats stats = {};
+	for (uint32_t i = 0; i + 2 < indexCount; i += 3) {
+		stats.transformedVertexCount += UpdateFifoCache(&indices[i], cacheTimestamps, timestamp, cacheSize);
+
+		for (int j = 0; j < 3; ++j) {
+			if (!used[indices[i + j]]) {
+				used[indices[i + j]] = true;
+				++usedCount;
+			}
+		}
+	}
+
+	stats.acmr = indexCount >= 3 ? (float)stats.transformedVertexCount / (float)(indexCount / 3) : 0.0f;
+	stats.atvr = usedCount > 0 ? (float)stats.transformedVertexCount / (float)usedCount : 0.0f;
+	return stats;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+// offline mesh optimization, run by the cooker in this order:
+// welding merges vertices that are byte for byte the same, so triangles that share a corner share the index
+// vertex cache ordering (Forsyth's linear speed algorithm) reorders triangles so the post transform cache hits
+// overdraw ordering (Sander et al.) splits that order into clusters where the cache starts over anyway, and
+// draws the clusters that face outward most first, so they occlude the rest without giving up cache hits
+// vertex fetch ordering renumbers vertices in the order the triangles first use them, for memory locality
+// triangles are index triples, vertices are opaque blocks of stride bytes
+// no d3d12 dependency
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// fifo cache the analysis and the overdraw clustering simulate, about what current hardware has
+const uint32_t meshVertexCacheSize = 16;
+
+// clusters are only split where the cache has this much of its efficiency left, from the paper
+const float meshOverdrawThreshold = 1.05f;
+
+struct MeshCacheStats {
+	// transformed vertices per triangle, 0.5 is the best a regular grid can do, 3 the worst
+	float acmr;
+	// transformed vertices per vertex, 1 is the best
+	float atvr;
+	uint32_t transformedVertexCount;
+};
+
+// remap[i] is the new index of vertex i, returns the number of unique vertices
+uint32_t MeshWeldVertices(const void* vertices, uint32_t vertexCount, uint32_t stride, std::vector<uint32_t>& remap);
+
+// moves every vertex to remap[i], several vertices going to one place are expected to be the same
+void MeshRemapVertices(void* destination, const void* vertices, uint32_t vertexCount, uint32_t stride, const uint32_t* remap);
+
+void MeshRemapIndices(uint32_t* indices, uint32_t indexCount, const uint32_t* remap);
+
+// destination and indices cannot be the same
+void MeshOptimizeVertexCache(uint32_t* destination, const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount);
+
+// indices should be in vertex cache order already, positions are three floats at the start of every vertex
+// destination and indices cannot be the same
+void MeshOptimizeOverdraw(uint32_t* destination, const uint32_t* indices, uint32_t indexCount, const void* vertices, uint32_t vertexCount, uint32_t stride, float threshold);
+
+// renumbers indices in place and writes the vertices they use to destination in first use order
+// returns how many there are, vertices no triangle uses are dropped
+uint32_t MeshOptimizeVertexFetch(void* destination, uint32_t* indices, uint32_t indexCount, const void* vertices, uint32_t vertexCount, uint32_t stride);
+
+MeshCacheStats MeshAnalyzeVertexCache(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize);
@@ -0,0 +1,284 @@
+#include "Meshlet.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// below this the normals spread over more than about 84 degrees, and the cone would hardly ever cull
+const float meshletMinConeDot = 0.1f;
+
+static void LoadPosition(const uint8_t* vertices, uint32_t stride, uint32_t index, float position[3]) {
+	memcpy(position, vertices + (size_t)index * stride, sizeof(float) * 3);
+}
+
+static float Dot(const float a[3], const float b[3]) {
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static float Distance(const float a[3], const float b[3]) {
+	float d[3] = { a[0] - b[0], a[1] - b[1], a[2] - b[2] };
+	return sqrtf(Dot(d, d));
+}
+
+// ritter's sphere, from the two vertices furthest apart along an axis, grown to take in the rest
+static void ComputeBoundingSphere(const uint8_t* vertices, uint32_t stride, const uint32_t* meshletVertices, uint32_t count, MeshletBounds& bounds) {
+	float first[3];
+	LoadPosition(vertices, stride, meshletVertices[0], first);
+
+	float minimum[3][3];
+	float maximum[3][3];
+	for (int axis = 0; axis < 3; ++axis) {
+		memcpy(minimum[axis], first, sizeof(first));
+		memcpy(maximum[axis], first, sizeof(first));
+	}
+
+	for (uint32_t i = 1; i < count; ++i) {
+		float position[3];
+		LoadPosition(vertices, stride, meshletVertices[i], position);
+		for (int axis = 0; axis < 3; ++axis) {
+			if (position[axis] < minimum[axis][axis])
+				memcpy(minimum[axis], position, sizeof(position));
+			if (position[axis] > maximum[axis][axis])
+				memcpy(maximum[axis], position, sizeof(position));
+		}
+	}
+
+	int widest = 0;
+	for (int axis = 1; axis < 3; ++axis) {
+		if (Distance(minimum[axis], maximum[axis]) > Distance(minimum[widest], maximum[widest]))
+			widest = axis;
+	}
+
+	float* center = bounds.center;
+	for (int j = 0; j < 3; ++j)
+		center[j] = (minimum[widest][j] + maximum[widest][j]) * 0.5f;
+	float radius = Distance(minimum[widest], maximum[widest]) * 0.5f;
+
+	for (uint32_t i = 0; i < count; ++i) {
+		float position[3];
+		LoadPosition(vertices, stride, meshletVertices[i], position);
+
+		float distance = Distance(position, center);
+		if (distance > radius) {
+			// moves the far side of the sphere out to the vertex, the near side stays
+			float grown = (radius + distance) * 0.5f;
+			float shift = (grown - radius) / distance;
+			for (int j = 0; j < 3; ++j)
+				center[j] += (position[j] - center[j]) * shift;
+			radius = grown;
+		}
+	}
+
+	// float rounding while growing can leave a vertex a hair outside
+	bounds.radius = radius * (1.0f + 1e-6f);
+}
+
+static void ComputeNormalCone(const uint8_t* vertices, uint32_t stride, const uint32_t* meshletVertices, const uint32_t* triangles, uint32_t triangleCount, MeshletBounds& bounds) {
+	std::vector<float> normals(triangleCount * 3);
+	std::vector<float> corners(triangleCount * 3);
+	float axis[3] = {};
+
+	uint32_t normalCount = 0;
+	for (uint32_t i = 0; i < triangleCount; ++i) {
+		float p[3][3];
+		for (int k = 0; k < 3; ++k)
+			LoadPosition(vertices, stride, meshletVertices[(triangles[i] >> (k * 8)) & 0xff], p[k]);
+
+		float e1[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+		float e2[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+		float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+		float length = sqrtf(Dot(n, n));
+
+		// degenerate triangles are never seen, whichever way they face
+		if (length == 0.0f)
+			continue;
+
+		for (int j = 0; j < 3; ++j) {
+			normals[normalCount * 3 + j] = n[j] / length;
+			corners[normalCount * 3 + j] = p[0][j];
+			axis[j] += n[j] / length;
+		}
+		++normalCount;
+	}
+
+	float axisLength = sqrtf(Dot(axis, axis));
+	float minimumDot = 1.0f;
+	if (axisLength > 0.0f) {
+		for (int j = 0; j < 3; ++j)
+			axis[j] /= axisLength;
+		for (uint32_t i = 0; i < normalCount; ++i)
+			minimumDot = std::min(minimumDot, Dot(&normals[i * 3], axis));
+	}
+
+	if (normalCount == 0 || axisLength == 0.0f || minimumDot < meshletMinConeDot) {
+		memcpy(bounds.coneApex, bounds.center, sizeof(bounds.coneApex));
+		memset(bounds.coneAxis, 0, sizeof(bounds.coneAxis));
+		bounds.coneCutoff = 1.0f;
+		return;
+	}
+
+	// the apex goes back along the axis until it is behind every triangle's plane, then a viewer in the cone
+	// sees the back of every triangle from anywhere in the meshlet
+	float back = 0.0f;
+	for (uint32_t i = 0; i < normalCount; ++i) {
+		const float* n = &normals[i * 3];
+		const float* p = &corners[i * 3];
+		float toCenter[3] = { bounds.center[0] - p[0], bounds.center[1] - p[1], bounds.center[2] - p[2] };
+		back = std::max(back, Dot(toCenter, n) / Dot(axis, n));
+	}
+
+	for (int j = 0; j < 3; ++j) {
+		bounds.coneApex[j] = bounds.center[j] - axis[j] * back;
+		bounds.coneAxis[j] = axis[j];
+	}
+
+	// every normal is within acos(minimumDot) of the axis, so views within 90 degrees minus that see only backs
+	bounds.coneCutoff = sqrtf(1.0f - minimumDot * minimumDot);
+}
+
+static void FinishMeshlet(const uint8_t* vertices, uint32_t stride, Meshlet& meshlet, MeshletSet& meshlets) {
+	MeshletBounds bounds = {};
+	ComputeBoundingSphere(vertices, stride, &meshlets.vertices[meshlet.vertexOffset], meshlet.vertexCount, bounds);
+	ComputeNormalCone(vertices, stride, &meshlets.vertices[meshlet.vertexOffset], &meshlets.triangles[meshlet.triangleOffset], meshlet.triangleCount, bounds);
+
+	meshlets.meshlets.push_back(meshlet);
+	meshlets.bounds.push_back(bounds);
+}
+
+void BuildMeshlets(const uint32_t* indices, uint32_t indexCount, const void* vertices, uint32_t vertexCount, uint32_t stride,
+	uint32_t maxVertices, uint32_t maxTriangles, MeshletSet& meshlets) {
+	const uint8_t* vertexBytes = static_cast<const uint8_t*>(vertices);
+
+	meshlets.meshlets.clear();
+	meshlets.bounds.clear();
+	meshlets.vertices.clear();
+	meshlets.triangles.clear();
+
+	// local index of every mesh vertex in the meshlet being built, 0xff if it is not in it
+	std::vector<uint8_t> localIndices(vertexCount, 0xff);
+
+	Meshlet meshlet = {};
+	for (uint32_t i = 0; i + 2 < indexCount; i += 3) {
+		const uint32_t* triangle = &indices[i];
+
+		uint32_t newVertices = 0;
+		for (int k = 0; k < 3; ++k) {
+			bool repeated = (k > 0 && triangle[k] == triangle[0]) || (k > 1 && triangle[k] == triangle[1]);
+			if (localIndices[triangle[k]] == 0xff && !repeated)
+				++newVertices;
+		}
+
+		// the triangle starts the next meshlet if it does not fit this one
+		if (meshlet.vertexCount + newVertices > maxVertices || meshlet.triangleCount + 1 > maxTriangles) {
+			for (uint32_t j = 0; j < meshlet.vertexCount; ++j)
+				localIndices[meshlets.vertices[meshlet.vertexOffset + j]] = 0xff;
+			FinishMeshlet(vertexBytes, stride, meshlet, meshlets);
+
+			meshlet.vertexOffset = (uint32_t)meshlets.vertices.size();
+			meshlet.triangleOffset = (uint32_t)meshlets.triangles.size();
+			meshlet.vertexCount = 0;
+			meshlet.triangleCount = 0;
+		}
+
+		uint32_t packed = 0;
+		for (int k = 0; k < 3; ++k) {
+			uint8_t& local = localIndices[triangle[k]];
+			if (local == 0xff) {
+				local = (uint8_t)meshlet.vertexCount++;
+				meshlets.vertices.push_back(triangle[k]);
+			}
+			packed |= (uint32_t)local << (k * 8);
+		}
+
+		meshlets.triangles.push_back(packed);
+		++meshlet.triangleCount;
+	}
+
+	if (meshlet.triangleCount > 0)
+		FinishMeshlet(vertexBytes, stride, meshlet, meshlets);
+}
+
+void MeshletCullContextInit(MeshletCullContext& context, const float clipFromObject[16]) {
+	const float* row[4] = { &clipFromObject[0], &clipFromObject[4], &clipFromObject[8], &clipFromObject[12] };
+
+	// gribb and hartmann, -w <= x <= w, -w <= y <= w, 0 <= z <= w
+	for (int j = 0; j < 4; ++j) {
+		context.planes[0][j] = row[3][j] + row[0][j];
+		context.planes[1][j] = row[3][j] - row[0][j];
+		context.planes[2][j] = row[3][j] + row[1][j];
+		context.planes[3][j] = row[3][j] - row[1][j];
+		context.planes[4][j] = row[2][j];
+		context.planes[5][j] = row[3][j] - row[2][j];
+	}
+
+	for (int i = 0; i < 6; ++i) {
+		float length = sqrtf(Dot(context.planes[i], context.planes[i]));
+		float inverseLength = length > 0.0f ? 1.0f / length : 0.0f;
+		for (int j = 0; j < 4; ++j)
+			context.planes[i][j] *= inverseLength;
+	}
+
+	// the eye is where x, y and w all project to 0, three planes through it
+	const float* a = row[0];
+	const float* b = row[1];
+	const float* c = row[3];
+	float determinant = a[0] * (b[1] * c[2] - b[2] * c[1]) - a[1] * (b[0] * c[2] - b[2] * c[0]) + a[2] * (b[0] * c[1] - b[1] * c[0]);
+
+	// w does not depend on the position for orthographic projections, so there is no such point
+	context.coneCulling = fabsf(determinant) > 1e-30f;
+	if (!context.coneCulling) {
+		memset(context.eye, 0, sizeof(context.eye));
+		return;
+	}
+
+	// cramer's rule on a x = -a[3], b x = -b[3], c x = -c[3]
+	float d[3] = { -a[3], -b[3], -c[3] };
+	context.eye[0] = (d[0] * (b[1] * c[2] - b[2] * c[1]) - a[1] * (d[1] * c[2] - b[2] * d[2]) + a[2] * (d[1] * c[1] - b[1] * d[2])) / determinant;
+	context.eye[1] = (a[0] * (d[1] * c[2] - b[2] * d[2]) - d[0] * (b[0] * c[2] - b[2] * c[0]) + a[2] * (b[0] * d[2] - d[1] * c[0])) / determinant;
+	context.eye[2] = (a[0] * (b[1] * d[2] - d[1] * c[1]) - a[1] * (b[0] * d[2] - d[1] * c[0]) + d[0] * (b[0] * c[1] - b[1] * c[0])) / determinant;
+}
+
+bool IsMeshletVisible(const MeshletCullContext& context, const MeshletBounds& bounds) {
+	for (int i = 0; i < 6; ++i) {
+		if (Dot(context.planes[i], bounds.center) + context.planes[i][3] < -bounds.radius)
+			return false;
+	}
+
+	if (!context.coneCulling)
+		return true;
+
+	float view[3] = { bounds.coneApex[0] - context.eye[0], bounds.coneApex[1] - context.eye[1], bounds.coneApex[2] - context.eye[2] };
+	float length = sqrtf(Dot(view, view));
+	return Dot(view, bounds.coneAxis) < bounds.coneCutoff * length;
+}
+
+uint32_t CullMeshlets(const MeshletCullContext& context, const MeshletBounds* bounds, uint32_t meshletCount, uint32_t* visible) {
+	uint32_t visibleCount = 0;
+	for (uint32_t i = 0; i < meshletCount; ++i) {
+		if (IsMeshletVisible(context, bounds[i]))
+			visible[visibleCount++] = i;
+	}
+	return visibleCount;
+}
+
+uint32_t CullMeshletsToDrawArguments(const MeshletCullContext& context, const Meshlet* meshlets, const MeshletBounds* bounds, uint32_t meshletCount, MeshletDrawArguments* arguments) {
+	uint32_t drawCount = 0;
+	bool previousVisible = false;
+
+	for (uint32_t i = 0; i < meshletCount; ++i) {
+		bool visible = IsMeshletVisible(context, bounds[i]);
+		if (visible && previousVisible) {
+			arguments[drawCount - 1].indexCountPerInstance += meshlets[i].triangleCount * 3;
+		}
+		else if (visible) {
+			MeshletDrawArguments& draw = arguments[drawCount++];
+			draw.indexCountPerInstance = meshlets[i].triangleCount * 3;
+			draw.instanceCount = 1;
+			draw.startIndexLocation = meshlets[i].triangleOffset * 3;
+			draw.baseVertexLocation = 0;
+			draw.startInstanceLocation = 0;
+		}
+		previousVisible = visible;
+	}
+	return drawCount;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+// meshlets, small clusters of a mesh's triangles that are culled and drawn on their own
+// a meshlet lists the mesh vertices it uses and its triangles as indices into that list, 8 bits each
+// meshlets are built from consecutive triangles, so the triangles of meshlet k are also indices
+// [triangleOffset * 3, (triangleOffset + triangleCount) * 3) of the mesh's index buffer and visible meshlets can
+// be drawn from it without mesh shaders
+// every meshlet has a bounding sphere for frustum culling and a cone of its normals for backface culling
+// no d3d12 dependency, the structs are laid out for structured buffers and indirect arguments as they are
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// what mesh shader hardware is built around, 124 leaves room for 4 more to keep primitive output in 128
+const uint32_t meshletMaxVertices = 64;
+const uint32_t meshletMaxTriangles = 124;
+
+struct Meshlet {
+	// into MeshletSet::vertices
+	uint32_t vertexOffset;
+	// into MeshletSet::triangles, and the first triangle in the index buffer
+	uint32_t triangleOffset;
+	uint32_t vertexCount;
+	uint32_t triangleCount;
+};
+
+// center and radius of a sphere around every vertex
+// culled if the viewer is in the cone dot(normalize(coneApex - eye), coneAxis) >= coneCutoff, where every
+// triangle faces away. meshlets with normals too far apart have a zero axis and a cutoff of 1, so the cone
+// never culls them
+struct MeshletBounds {
+	float center[3];
+	float radius;
+	float coneApex[3];
+	float coneCutoff;
+	float coneAxis[3];
+	float padding;
+};
+
+struct MeshletSet {
+	std::vector<Meshlet> meshlets;
+	std::vector<MeshletBounds> bounds;
+	// mesh vertex indices
+	std::vector<uint32_t> vertices;
+	// three local vertex indices, bits 0-7, 8-15 and 16-23
+	std::vector<uint32_t> triangles;
+};
+
+// same layout as D3D12_DRAW_INDEXED_ARGUMENTS
+struct MeshletDrawArguments {
+	uint32_t indexCountPerInstance;
+	uint32_t instanceCount;
+	uint32_t startIndexLocation;
+	int32_t baseVertexLocation;
+	uint32_t startInstanceLocation;
+};
+
+// everything culling needs, in the object space of the mesh
+struct MeshletCullContext {
+	// normalized, inside is positive: left, right, bottom, top, near, far
+	float planes[6][4];
+	float eye[3];
+	// false for projections without an eye point, orthographic ones
+	bool coneCulling;
+};
+
+// maxVertices at most 256, so local indices fit in 8 bits
+// positions are three floats at the start of every vertex, triangles are taken in the order of indices
+void BuildMeshlets(const uint32_t* indices, uint32_t indexCount, const void* vertices, uint32_t vertexCount, uint32_t stride,
+	uint32_t maxVertices, uint32_t maxTriangles, MeshletSet& meshlets);
+
+// clipFromObject is row major with clip = clipFromObject * (x, y, z, 1), which is the transposed world view
+// projection the shaders get. depth is in [0, w] like d3d
+void MeshletCullContextInit(MeshletCullContext& context, const float clipFromObject[16]);
+
+bool IsMeshletVisible(const MeshletCullContext& context, const MeshletBounds& bounds);
+
+// writes the indices of the meshlets that can be seen and returns how many
+uint32_t CullMeshlets(const MeshletCullContext& context, const MeshletBounds* bounds, uint32_t meshletCount, uint32_t* visible);
+
+// the same, as indexed draws of the mesh's index buffer, neighbouring visible meshlets become one draw
+// arguments needs room for (meshletCount + 1) / 2 draws, returns how many were written
+uint32_t CullMeshletsToDrawArguments(const MeshletCullContext& context, const Meshlet* meshlets, const MeshletBounds* bounds, uint32_t meshletCount, MeshletDrawArguments* arguments);
@@ -0,0 +1,55 @@
+#include "VertexInput.hlsli"
+
+// one group per visible meshlet, the cpu culled the rest and lists the survivors of this draw in visibleMeshlets
+// same as Meshlet
+struct Meshlet
+{
+    uint vertexOffset;
+    uint triangleOffset;
+    uint vertexCount;
+    uint triangleCount;
+};
+
+struct VS_OUTPUT
+{
+    float4 pos: SV_POSITION;
+    float4 texCoord: TEXCOORD;
+};
+
+cbuffer ConstantBuffer : register(b0)
+{
+    float4x4 wvpMat;
+};
+
+StructuredBuffer<Meshlet> meshlets : register(t2);
+ByteAddressBuffer vertexData : register(t3);
+StructuredBuffer<uint> meshletVertices : register(t4);
+// three 8 bit local indices each
+StructuredBuffer<uint> meshletTriangles : register(t5);
+StructuredBuffer<uint> visibleMeshlets : register(t6);
+
+// meshletMaxVertices and meshletMaxTriangles
+[outputtopology("triangle")]
+[numthreads(128, 1, 1)]
+void main(uint threadIndex : SV_GroupThreadID, uint groupIndex : SV_GroupID,
+    out vertices VS_OUTPUT outputVertices[64], out indices uint3 outputTriangles[124])
+{
+    Meshlet meshlet = meshlets[visibleMeshlets[groupIndex]];
+    SetMeshOutputCounts(meshlet.vertexCount, meshlet.triangleCount);
+
+    if (threadIndex < meshlet.vertexCount)
+    {
+        VS_INPUT input = LoadVertexInput(vertexData, meshletVertices[meshlet.vertexOffset + threadIndex]);
+
+        VS_OUTPUT output;
+        output.pos = mul(GetObjectPosition(input), wvpMat);
+        output.texCoord = float4(input.texCoord, 0.0f, 0.0f);
+        outputVertices[threadIndex] = output;
+    }
+
+    if (threadIndex < meshlet.triangleCount)
+    {
+        uint packed = meshletTriangles[meshlet.triangleOffset + threadIndex];
+        outputTriangles[threadIndex] = uint3(packed & 0xff, (packed >> 8) & 0xff, (packed >> 16) & 0xff);
+    }
+}
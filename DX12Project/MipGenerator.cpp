@@ -0,0 +1,308 @@
+#include "MipGenerator.h"
+
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MIP_GENERATOR_SSE
+#endif
+
+// rows per thread below which splitting the work is not worth starting a thread
+const uint32_t minRowsPerThread = 16;
+
+// 12 bit linear index into the srgb encode table, enough for 8 bit output
+const int linearToSrgbTableSize = 4096;
+
+struct MipConversionTables {
+	float srgbToLinear[256];
+	float unormToFloat[256];
+	uint8_t linearToSrgb[linearToSrgbTableSize];
+
+	MipConversionTables() {
+		for (int i = 0; i < 256; ++i) {
+			float c = i / 255.0f;
+			srgbToLinear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+			unormToFloat[i] = c;
+		}
+
+		for (int i = 0; i < linearToSrgbTableSize; ++i) {
+			float c = i / (float)(linearToSrgbTableSize - 1);
+			float s = c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+			linearToSrgb[i] = (uint8_t)(s * 255.0f + 0.5f);
+		}
+	}
+};
+
+static const MipConversionTables& GetConversionTables() {
+	// built once, thread safe since c++11
+	static const MipConversionTables tables;
+	return tables;
+}
+
+uint32_t GetMipLevelCount(uint32_t width, uint32_t height) {
+	uint32_t levels = 1;
+	while (width > 1 || height > 1) {
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+		++levels;
+	}
+	return levels;
+}
+
+// calls rowFunction(firstRow, lastRow) on up to threadCount threads, the calling thread takes the last range
+template <typename RowFunction>
+static void ParallelForRows(uint32_t rowCount, int threadCount, RowFunction rowFunction) {
+	uint32_t maxThreads = rowCount / minRowsPerThread;
+	if (threadCount > (int)maxThreads)
+		threadCount = (int)maxThreads;
+
+	if (threadCount <= 1) {
+		rowFunction(0u, rowCount);
+		return;
+	}
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < threadCount - 1; ++t) {
+		uint32_t first = rowCount * t / threadCount;
+		uint32_t last = rowCount * (t + 1) / threadCount;
+		threads.push_back(std::thread(rowFunction, first, last));
+	}
+
+	rowFunction(rowCount * (threadCount - 1) / threadCount, rowCount);
+
+	for (size_t t = 0; t < threads.size(); ++t)
+		threads[t].join();
+}
+
+// 8 bit pixels to linear premultiplied floats, four floats per pixel
+static void ConvertToLinear(const uint8_t* pixels, uint32_t width, size_t rowPitch, bool srgb, bool simd, uint32_t firstRow, uint32_t lastRow, float* output) {
+#ifndef MIP_GENERATOR_SSE
+	(void)simd;
+#endif
+	const MipConversionTables& tables = GetConversionTables();
+	const float* colorTable = srgb ? tables.srgbToLinear : tables.unormToFloat;
+
+	for (uint32_t y = firstRow; y < lastRow; ++y) {
+		const uint8_t* src = pixels + y * rowPitch;
+		float* dst = output + (size_t)y * width * 4;
+
+		for (uint32_t x = 0; x < width; ++x) {
+			float alpha = tables.unormToFloat[src[3]];
+#ifdef MIP_GENERATOR_SSE
+			if (simd) {
+				__m128 color = _mm_set_ps(1.0f, colorTable[src[2]], colorTable[src[1]], colorTable[src[0]]);
+				_mm_storeu_ps(dst, _mm_mul_ps(color, _mm_set1_ps(alpha)));
+				dst[3] = alpha;
+			}
+			else
+#endif
+			{
+				dst[0] = colorTable[src[0]] * alpha;
+				dst[1] = colorTable[src[1]] * alpha;
+				dst[2] = colorTable[src[2]] * alpha;
+				dst[3] = alpha;
+			}
+			src += 4;
+			dst += 4;
+		}
+	}
+}
+
+// linear premultiplied floats back to 8 bit pixels
+static void ConvertFromLinear(const float* input, uint32_t width, bool srgb, bool simd, uint32_t firstRow, uint32_t lastRow, uint8_t* pixels, size_t rowPitch) {
+#ifndef MIP_GENERATOR_SSE
+	(void)simd;
+#endif
+	const MipConversionTables& tables = GetConversionTables();
+
+	for (uint32_t y = firstRow; y < lastRow; ++y) {
+		const float* src = input + (size_t)y * width * 4;
+		uint8_t* dst = pixels + y * rowPitch;
+
+		for (uint32_t x = 0; x < width; ++x) {
+			float alpha = src[3];
+			float color[4];
+
+#ifdef MIP_GENERATOR_SSE
+			if (simd) {
+				__m128 value = _mm_loadu_ps(src);
+				// undo the premultiply, fully transparent pixels end up black
+				__m128 scale = _mm_set1_ps(alpha > 0.0f ? 1.0f / alpha : 0.0f);
+				value = _mm_mul_ps(value, scale);
+				value = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+				_mm_storeu_ps(color, value);
+			}
+			else
+#endif
+			{
+				float scale = alpha > 0.0f ? 1.0f / alpha : 0.0f;
+				for (int c = 0; c < 3; ++c) {
+					float v = src[c] * scale;
+					color[c] = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+				}
+			}
+
+			for (int c = 0; c < 3; ++c) {
+				if (srgb)
+					dst[c] = tables.linearToSrgb[(int)(color[c] * (linearToSrgbTableSize - 1) + 0.5f)];
+				else
+					dst[c] = (uint8_t)(color[c] * 255.0f + 0.5f);
+			}
+
+			alpha = alpha < 0.0f ? 0.0f : (alpha > 1.0f ? 1.0f : alpha);
+			dst[3] = (uint8_t)(alpha * 255.0f + 0.5f);
+
+			src += 4;
+			dst += 4;
+		}
+	}
+}
+
+static inline uint32_t ClampCoordinate(int value, uint32_t size) {
+	if (value < 0)
+		return 0;
+	if (value >= (int)size)
+		return size - 1;
+	return (uint32_t)value;
+}
+
+// one destination pixel from the 2x2 source pixels under it
+static void DownsampleBox(const float* src, uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, bool simd, uint32_t firstRow, uint32_t lastRow, float* dst) {
+#ifndef MIP_GENERATOR_SSE
+	(void)simd;
+#endif
+	for (uint32_t y = firstRow; y < lastRow; ++y) {
+		// a source dimension of 1 has nothing to average with
+		const float* row0 = src + (size_t)ClampCoordinate(y * 2, srcHeight) * srcWidth * 4;
+		const float* row1 = src + (size_t)ClampCoordinate(y * 2 + 1, srcHeight) * srcWidth * 4;
+		float* output = dst + (size_t)y * dstWidth * 4;
+
+		for (uint32_t x = 0; x < dstWidth; ++x) {
+			uint32_t x0 = ClampCoordinate(x * 2, srcWidth) * 4;
+			uint32_t x1 = ClampCoordinate(x * 2 + 1, srcWidth) * 4;
+
+#ifdef MIP_GENERATOR_SSE
+			if (simd) {
+				__m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(row0 + x0), _mm_loadu_ps(row0 + x1)), _mm_add_ps(_mm_loadu_ps(row1 + x0), _mm_loadu_ps(row1 + x1)));
+				_mm_storeu_ps(output, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+			}
+			else
+#endif
+			{
+				// summed in the same order as the sse2 version
+				for (int c = 0; c < 4; ++c)
+					output[c] = ((row0[x0 + c] + row0[x1 + c]) + (row1[x0 + c] + row1[x1 + c])) * 0.25f;
+			}
+			output += 4;
+		}
+	}
+}
+
+// 4x4 source pixels centered on the destination pixel, weights 1 3 3 1 in each direction
+static void DownsampleTriangle(const float* src, uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, bool simd, uint32_t firstRow, uint32_t lastRow, float* dst) {
+#ifndef MIP_GENERATOR_SSE
+	(void)simd;
+#endif
+	static const float weights[4] = { 1.0f / 8.0f, 3.0f / 8.0f, 3.0f / 8.0f, 1.0f / 8.0f };
+
+	for (uint32_t y = firstRow; y < lastRow; ++y) {
+		const float* rows[4];
+		for (int j = 0; j < 4; ++j)
+			rows[j] = src + (size_t)ClampCoordinate((int)(y * 2) - 1 + j, srcHeight) * srcWidth * 4;
+
+		float* output = dst + (size_t)y * dstWidth * 4;
+
+		for (uint32_t x = 0; x < dstWidth; ++x) {
+			uint32_t columns[4];
+			for (int i = 0; i < 4; ++i)
+				columns[i] = ClampCoordinate((int)(x * 2) - 1 + i, srcWidth) * 4;
+
+#ifdef MIP_GENERATOR_SSE
+			if (simd) {
+				__m128 sum = _mm_setzero_ps();
+				for (int j = 0; j < 4; ++j) {
+					// horizontal pass of one row, then weight the row
+					__m128 rowSum = _mm_mul_ps(_mm_loadu_ps(rows[j] + columns[0]), _mm_set1_ps(weights[0]));
+					rowSum = _mm_add_ps(rowSum, _mm_mul_ps(_mm_loadu_ps(rows[j] + columns[1]), _mm_set1_ps(weights[1])));
+					rowSum = _mm_add_ps(rowSum, _mm_mul_ps(_mm_loadu_ps(rows[j] + columns[2]), _mm_set1_ps(weights[2])));
+					rowSum = _mm_add_ps(rowSum, _mm_mul_ps(_mm_loadu_ps(rows[j] + columns[3]), _mm_set1_ps(weights[3])));
+					sum = _mm_add_ps(sum, _mm_mul_ps(rowSum, _mm_set1_ps(weights[j])));
+				}
+				_mm_storeu_ps(output, sum);
+			}
+			else
+#endif
+			{
+				for (int c = 0; c < 4; ++c) {
+					float sum = 0.0f;
+					for (int j = 0; j < 4; ++j) {
+						float rowSum = 0.0f;
+						for (int i = 0; i < 4; ++i)
+							rowSum += rows[j][columns[i] + c] * weights[i];
+						sum += rowSum * weights[j];
+					}
+					output[c] = sum;
+				}
+			}
+			output += 4;
+		}
+	}
+}
+
+void GenerateMipChain(const uint8_t* pixels, uint32_t width, uint32_t height, size_t rowPitch, MipFilter filter, bool srgb, int threadCount, MipGeneratePath path,
+	MipChain& chain) {
+	bool simd = path == MIP_GENERATE_SIMD;
+	uint32_t levelCount = GetMipLevelCount(width, height);
+
+	chain.levels.resize(levelCount);
+
+	size_t totalSize = 0;
+	uint32_t levelWidth = width;
+	uint32_t levelHeight = height;
+	for (uint32_t i = 0; i < levelCount; ++i) {
+		chain.levels[i].width = levelWidth;
+		chain.levels[i].height = levelHeight;
+		chain.levels[i].rowPitch = (size_t)levelWidth * 4;
+		chain.levels[i].offset = totalSize;
+		totalSize += chain.levels[i].rowPitch * levelHeight;
+
+		levelWidth = levelWidth > 1 ? levelWidth / 2 : 1;
+		levelHeight = levelHeight > 1 ? levelHeight / 2 : 1;
+	}
+
+	chain.data.resize(totalSize);
+
+	for (uint32_t y = 0; y < height; ++y)
+		memcpy(&chain.data[y * chain.levels[0].rowPitch], pixels + y * rowPitch, chain.levels[0].rowPitch);
+
+	if (levelCount == 1)
+		return;
+
+	// every level is filtered from the float version of the level above, so rounding errors do not add up
+	std::vector<float> source((size_t)width * height * 4);
+	std::vector<float> destination((size_t)(width / 2 > 0 ? width / 2 : 1) * (height / 2 > 0 ? height / 2 : 1) * 4);
+
+	ParallelForRows(height, threadCount, [&](uint32_t firstRow, uint32_t lastRow) {
+		ConvertToLinear(pixels, width, rowPitch, srgb, simd, firstRow, lastRow, &source[0]);
+	});
+
+	for (uint32_t i = 1; i < levelCount; ++i) {
+		const MipLevel& srcLevel = chain.levels[i - 1];
+		const MipLevel& dstLevel = chain.levels[i];
+		uint8_t* output = &chain.data[dstLevel.offset];
+
+		ParallelForRows(dstLevel.height, threadCount, [&](uint32_t firstRow, uint32_t lastRow) {
+			if (filter == MIP_FILTER_TRIANGLE)
+				DownsampleTriangle(&source[0], srcLevel.width, srcLevel.height, dstLevel.width, simd, firstRow, lastRow, &destination[0]);
+			else
+				DownsampleBox(&source[0], srcLevel.width, srcLevel.height, dstLevel.width, simd, firstRow, lastRow, &destination[0]);
+
+			ConvertFromLinear(&destination[0], dstLevel.width, srgb, simd, firstRow, lastRow, output, dstLevel.rowPitch);
+		});
+
+		// this level is the source of the next one
+		source.swap(destination);
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+// builds a full mip chain for 8 bit four channel images on the cpu
+// filtering happens on linear, premultiplied colors so srgb images do not get darker and
+// transparent pixels do not bleed their color into their neighbours
+// the conversions and filters have sse2 versions, MIP_GENERATE_SCALAR runs the plain versions of the same arithmetic
+// and gives the same pixels
+// no wic or d3d12 dependency
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum MipFilter {
+	// 2x2 average
+	MIP_FILTER_BOX,
+	// 4x4 tent (1 3 3 1), less aliasing than box at the cost of slightly softer mips
+	MIP_FILTER_TRIANGLE,
+};
+
+enum MipGeneratePath {
+	MIP_GENERATE_SIMD,
+	MIP_GENERATE_SCALAR,
+};
+
+struct MipLevel {
+	uint32_t width;
+	uint32_t height;
+	size_t rowPitch;
+	// offset of the first row in MipChain::data
+	size_t offset;
+};
+
+struct MipChain {
+	std::vector<uint8_t> data;
+	std::vector<MipLevel> levels;
+};
+
+// levels down to 1x1
+uint32_t GetMipLevelCount(uint32_t width, uint32_t height);
+
+// pixels are 4 x 8 bit with alpha last (rgba or bgra), level 0 is copied into the chain as is
+// rows of every level are split over threadCount threads, which does not change the result
+void GenerateMipChain(const uint8_t* pixels, uint32_t width, uint32_t height, size_t rowPitch, MipFilter filter, bool srgb, int threadCount, MipGeneratePath path,
+	MipChain& chain);
@@ -0,0 +1,742 @@
+#include "NullRenderDevice.h"
+
+#include <cstring>
+
+// where buffers start, so a 0 address is never valid
+const uint64_t nullRenderFirstGpuAddress = 0x10000;
+const uint64_t nullRenderBufferAlignment = 64 * 1024;
+
+const uint32_t nullRenderStreamReserve = 64 * 1024;
+
+struct NullRenderResource {
+	RenderHeapType heapType;
+	uint64_t size;
+	uint64_t gpuAddress;
+	// upload and readback buffers only
+	uint8_t* memory;
+};
+
+struct NullRenderQueue {
+	NullRenderDevice* nullDevice;
+	RenderCommandListType type;
+};
+
+struct NullRenderFence {
+	uint64_t value;
+};
+
+static const char* const commandNames[NULL_RENDER_COMMAND_COUNT] = {
+	"SetPipelineState",
+	"SetRootSignature",
+	"SetRootConstantBuffer",
+	"SetRootShaderResource",
+	"SetRootUnorderedAccess",
+	"SetRootConstants",
+	"SetRootDescriptorTable",
+	"SetDescriptorHeap",
+	"SetRenderTarget",
+	"SetViewport",
+	"SetScissorRect",
+	"SetPrimitiveTopology",
+	"SetVertexBuffer",
+	"SetIndexBuffer",
+	"ClearRenderTarget",
+	"ClearDepth",
+	"DrawIndexedInstanced",
+	"Dispatch",
+	"DispatchMesh",
+	"ExecuteIndirect",
+	"CopyBufferRegion",
+	"Barriers",
+};
+
+// recording
+
+template <typename T>
+static void Put(uint8_t*& output, T value) {
+	memcpy(output, &value, sizeof(T));
+	output += sizeof(T);
+}
+
+static void PutPointer(uint8_t*& output, const void* pointer) {
+	Put<uint64_t>(output, (uint64_t)(uintptr_t)pointer);
+}
+
+// room for the command and size bytes of arguments, returns where the arguments go
+static uint8_t* BeginCommand(void* list, NullRenderCommand command, size_t size) {
+	NullRenderCommandList* nullList = static_cast<NullRenderCommandList*>(list);
+
+	size_t required = nullList->streamSize + 1 + size;
+	if (required > nullList->stream.size()) {
+		size_t capacity = nullList->stream.size() * 2;
+		if (capacity < required)
+			capacity = required;
+		nullList->stream.resize(capacity);
+	}
+
+	uint8_t* output = &nullList->stream[nullList->streamSize];
+	nullList->streamSize = required;
+	nullList->commandCounts[command]++;
+
+	*output = (uint8_t)command;
+	return output + 1;
+}
+
+static void RecordPointer(void* list, NullRenderCommand command, const void* pointer) {
+	uint8_t* output = BeginCommand(list, command, 8);
+	PutPointer(output, pointer);
+}
+
+// root parameter indices and constant counts fit in a byte, root signatures are at most 64 dwords
+static void RecordRootAddress(void* list, NullRenderCommand command, RenderBindPoint bindPoint, uint32_t index, uint64_t gpuAddress) {
+	uint8_t* output = BeginCommand(list, command, 2 + 8);
+	Put<uint8_t>(output, (uint8_t)bindPoint);
+	Put<uint8_t>(output, (uint8_t)index);
+	Put<uint64_t>(output, gpuAddress);
+}
+
+static void RecordGroups(void* list, NullRenderCommand command, uint32_t x, uint32_t y, uint32_t z) {
+	uint8_t* output = BeginCommand(list, command, 12);
+	Put<uint32_t>(output, x);
+	Put<uint32_t>(output, y);
+	Put<uint32_t>(output, z);
+}
+
+static bool Reset(void* list, uint32_t allocator, void* pipelineState) {
+	NullRenderCommandList* nullList = static_cast<NullRenderCommandList*>(list);
+	if (nullList->recording || allocator >= nullList->allocatorCount)
+		return false;
+
+	nullList->recording = true;
+	nullList->streamSize = 0;
+	memset(nullList->commandCounts, 0, sizeof(nullList->commandCounts));
+
+	// the pipeline a reset starts with is an ordinary command for replays
+	if (pipelineState != nullptr)
+		RecordPointer(list, NULL_RENDER_SET_PIPELINE_STATE, pipelineState);
+
+	return true;
+}
+
+static bool Close(void* list) {
+	NullRenderCommandList* nullList = static_cast<NullRenderCommandList*>(list);
+	if (!nullList->recording)
+		return false;
+
+	nullList->recording = false;
+	return true;
+}
+
+static void SetPipelineState(void* list, void* pipelineState) {
+	RecordPointer(list, NULL_RENDER_SET_PIPELINE_STATE, pipelineState);
+}
+
+static void SetRootSignature(void* list, RenderBindPoint bindPoint, void* rootSignature) {
+	uint8_t* output = BeginCommand(list, NULL_RENDER_SET_ROOT_SIGNATURE, 1 + 8);
+	Put<uint8_t>(output, (uint8_t)bindPoint);
+	PutPointer(output, rootSignature);
+}
+
+static void SetRootConstantBuffer(void* list, RenderBindPoint bindPoint, uint32_t index, uint64_t gpuAddress) {
+	RecordRootAddress(list, NULL_RENDER_SET_ROOT_CONSTANT_BUFFER, bindPoint, index, gpuAddress);
+}
+
+static void SetRootShaderResource(void* list, RenderBindPoint bindPoint, uint32_t index, uint64_t gpuAddress) {
+	RecordRootAddress(list, NULL_RENDER_SET_ROOT_SHADER_RESOURCE, bindPoint, index, gpuAddress);
+}
+
+static void SetRootUnorderedAccess(void* list, RenderBindPoint bindPoint, uint32_t index, uint64_t gpuAddress) {
+	RecordRootAddress(list, NULL_RENDER_SET_ROOT_UNORDERED_ACCESS, bindPoint, index, gpuAddress);
+}
+
+static void SetRootConstants(void* list, RenderBindPoint bindPoint, uint32_t index, uint32_t count, const void* data, uint32_t offset) {
+	uint8_t* output = BeginCommand(list, NULL_RENDER_SET_ROOT_CONSTANTS, 4 + count * 4);
+	Put<uint8_t>(output, (uint8_t)bindPoint);
+	Put<uint8_t>(output, (uint8_t)index);
+	Put<uint8_t>(output, (uint8_t)count);
+	Put<uint8_t>(output, (uint8_t)offset);
+	memcpy(output, data, count * 4);
+}
+
+// shader visible tables only need the gpu handle
+static void SetRootDescriptorTable(void* list, RenderBindPoint bindPoint, uint32_t index, RenderDescriptor table) {
+	RecordRootAddress(list, NULL_RENDER_SET_ROOT_DESCRIPTOR_TABLE, bindPoint, index, table.gpuHandle);
+}
+
+static void SetDescriptorHeap(void* list, void* heap) {
+	RecordPointer(list, NULL_RENDER_SET_DESCRIPTOR_HEAP, heap);
+}
+
+static void SetRenderTarget(void* list, RenderDescriptor renderTarget, RenderDescriptor depthStencil) {
+	uint8_t* output = BeginCommand(list, NULL_RENDER_SET_RENDER_TARGET, 16);
+	Put<uint64_t>(output, renderTarget.cpuHandle);
+	Put<uint64_t>(output, depthStencil.cpuHandle);
+}
+
+static void SetViewport(void* list, const RenderViewport& viewport) {
+	uint8_t* output = BeginCommand(list, NULL_RENDER_SET_VIEWPORT, sizeof(RenderViewport));
+	memcpy(output, &viewport, sizeof(RenderViewport));
+}
+
+static void SetScissorRect(void* list, const RenderRect& rect) {
+	uint8_t* output = BeginCommand(list, NULL_RENDER_SET_SCISSOR_RECT, sizeof(RenderRect));
+	memcpy(output, &rect, sizeof(RenderRect));
+}
+
+static void SetPrimitiveTopology(void* list, uint32_t topology) {
+	uint8_t* output = BeginCommand(list, NULL_RENDER_SET_PRIMITIVE_TOPOLOGY, 1);
+	Put<uint8_t>(output, (uint8_t)topology);
+}
+
+static void SetVertexBuffer(void* list, const RenderVertexBufferView& view) {
+	uint8_t* output = BeginCommand(list, NULL_RENDER_SET_VERTEX_BUFFER, 16);
+	Put<uint64_t>(output, view.gpuAddress);
+	Put<uint32_t>(output, view.size);
+	Put<uint32_t>(output, view.stride);
+}
+
+static void SetIndexBuffer(void* list, const RenderIndexBufferView& view) {
+	uint8_t* output = BeginCommand(list, NULL_RENDER_SET_INDEX_BUFFER, 16);
+	Put<uint64_t>(output, view.gpuAddress);
+	Put<uint32_t>(output, view.size);
+	Put<uint32_t>(output, view.format);
+}
+
+static void ClearRenderTarget(void* list, RenderDescriptor renderTarget, const float color[4]) {
+	uint8_t* output = BeginCommand(list, NULL_RENDER_CLEAR_RENDER_TARGET, 8 + 16);
+	Put<uint64_t>(output, renderTarget.cpuHandle);
+	memcpy(output, color, 16);
+}
+
+static void ClearDepth(void* list, RenderDescriptor depthStencil, float depth) {
+	uint8_t* output = BeginCommand(list, NULL_RENDER_CLEAR_DEPTH, 8 + 4);
+	Put<uint64_t>(output, depthStencil.cpuHandle);
+	Put<float>(output, depth);
+}
+
+static void DrawIndexedInstanced(void* list, uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance) {
+	uint8_t* output = BeginCommand(list, NULL_RENDER_DRAW_INDEXED_INSTANCED, 20);
+	Put<uint32_t>(output, indexCount);
+	Put<uint32_t>(output, instanceCount);
+	Put<uint32_t>(output, startIndex);
+	Put<int32_t>(output, baseVertex);
+	Put<uint32_t>(output, startInstance);
+}
+
+static void Dispatch(void* list, uint32_t x, uint32_t y, uint32_t z) {
+	RecordGroups(list, NULL_RENDER_DISPATCH, x, y, z);
+}
+
+static void DispatchMesh(void* list, uint32_t x, uint32_t y, uint32_t z) {
+	RecordGroups(list, NULL_RENDER_DISPATCH_MESH, x, y, z);
+}
+
+static void ExecuteIndirect(void* list, void* commandSignature, uint32_t maxCount, void* argumentResource, uint64_t argumentOffset, void* countResource, uint64_t countOffset) {
+	uint8_t* output = BeginCommand(list, NULL_RENDER_EXECUTE_INDIRECT, 8 + 4 + 8 * 4);
+	PutPointer(output, commandSignature);
+	Put<uint32_t>(output, maxCount);
+	PutPointer(output, argumentResource);
+	Put<uint64_t>(output, argumentOffset);
+	PutPointer(output, countResource);
+	Put<uint64_t>(output, countOffset);
+}
+
+static void CopyBufferRegion(void* list, void* destination, uint64_t destinationOffset, void* source, uint64_t sourceOffset, uint64_t size) {
+	uint8_t* output = BeginCommand(list, NULL_RENDER_COPY_BUFFER_REGION, 8 * 5);
+	PutPointer(output, destination);
+	Put<uint64_t>(output, destinationOffset);
+	PutPointer(output, source);
+	Put<uint64_t>(output, sourceOffset);
+	Put<uint64_t>(output, size);
+}
+
+// transitions take 22 bytes and aliasing barriers 17
+static void Barriers(void* list, const RenderBarrier* barriers, uint32_t count) {
+	size_t size = 4;
+	for (uint32_t i = 0; i < count; ++i)
+		size += barriers[i].type == RENDER_BARRIER_ALIASING ? 1 + 16 : 1 + 8 + 12 + 1;
+
+	uint8_t* output = BeginCommand(list, NULL_RENDER_BARRIERS, size);
+	Put<uint32_t>(output, count);
+
+	for (uint32_t i = 0; i < count; ++i) {
+		const RenderBarrier& barrier = barriers[i];
+		Put<uint8_t>(output, (uint8_t)barrier.type);
+
+		if (barrier.type == RENDER_BARRIER_ALIASING) {
+			PutPointer(output, barrier.resourceBefore);
+			PutPointer(output, barrier.resource);
+			continue;
+		}
+
+		PutPointer(output, barrier.resource);
+		Put<uint32_t>(output, barrier.subresource);
+		Put<uint32_t>(output, barrier.stateBefore);
+		Put<uint32_t>(output, barrier.stateAfter);
+		Put<uint8_t>(output, (uint8_t)barrier.flag);
+	}
+}
+
+// device objects
+
+static bool CreateBuffer(void* context, RenderHeapType heapType, uint64_t size, uint32_t initialState, RenderBuffer& buffer) {
+	NullRenderDevice* nullDevice = static_cast<NullRenderDevice*>(context);
+	(void)initialState;
+
+	NullRenderResource* resource = new NullRenderResource;
+	resource->heapType = heapType;
+	resource->size = size;
+	resource->gpuAddress = nullDevice->nextGpuAddress;
+	resource->memory = heapType != RENDER_HEAP_DEFAULT ? new uint8_t[size] : nullptr;
+
+	nullDevice->nextGpuAddress += (size + nullRenderBufferAlignment - 1) & ~(nullRenderBufferAlignment - 1);
+	nullDevice->stats.bufferCount++;
+	nullDevice->stats.bufferBytes += size;
+
+	buffer.resource = resource;
+	buffer.offset = 0;
+	buffer.gpuAddress = resource->gpuAddress;
+	buffer.cpuAddress = resource->memory;
+	buffer.size = size;
+	buffer.backendData = nullptr;
+	return true;
+}
+
+static void DestroyBuffer(void* context, RenderBuffer& buffer) {
+	NullRenderDevice* nullDevice = static_cast<NullRenderDevice*>(context);
+	NullRenderResource* resource = static_cast<NullRenderResource*>(buffer.resource);
+
+	nullDevice->stats.bufferCount--;
+	nullDevice->stats.bufferBytes -= resource->size;
+
+	delete[] resource->memory;
+	delete resource;
+}
+
+static bool CreateCommandList(void* context, RenderCommandListType type, uint32_t allocatorCount, void*& list) {
+	NullRenderDevice* nullDevice = static_cast<NullRenderDevice*>(context);
+
+	NullRenderCommandList* nullList = new NullRenderCommandList;
+	nullList->type = type;
+	nullList->allocatorCount = allocatorCount;
+	nullList->recording = false;
+	nullList->stream.resize(nullRenderStreamReserve);
+	nullList->streamSize = 0;
+	memset(nullList->commandCounts, 0, sizeof(nullList->commandCounts));
+
+	nullDevice->stats.commandListCount++;
+
+	list = nullList;
+	return true;
+}
+
+static void DestroyCommandList(void* context, void* list) {
+	NullRenderDevice* nullDevice = static_cast<NullRenderDevice*>(context);
+	nullDevice->stats.commandListCount--;
+
+	delete static_cast<NullRenderCommandList*>(list);
+}
+
+static bool CreateQueue(void* context, RenderCommandListType type, void*& queue) {
+	NullRenderQueue* nullQueue = new NullRenderQueue;
+	nullQueue->nullDevice = static_cast<NullRenderDevice*>(context);
+	nullQueue->type = type;
+
+	queue = nullQueue;
+	return true;
+}
+
+static void DestroyQueue(void* context, void* queue) {
+	(void)context;
+	delete static_cast<NullRenderQueue*>(queue);
+}
+
+static bool CreateFence(void* context, uint64_t initialValue, void*& fence) {
+	(void)context;
+
+	NullRenderFence* nullFence = new NullRenderFence;
+	nullFence->value = initialValue;
+
+	fence = nullFence;
+	return true;
+}
+
+static void DestroyFence(void* context, void* fence) {
+	(void)context;
+	delete static_cast<NullRenderFence*>(fence);
+}
+
+// queues and fences
+
+// nothing runs, the lists only count as executed
+static void ExecuteCommandLists(void* queue, void* const* lists, uint32_t count) {
+	NullRenderStats& stats = static_cast<NullRenderQueue*>(queue)->nullDevice->stats;
+
+	stats.executeCount++;
+	stats.executedListCount += count;
+
+	for (uint32_t i = 0; i < count; ++i) {
+		const NullRenderCommandList* nullList = static_cast<const NullRenderCommandList*>(lists[i]);
+
+		for (uint32_t command = 0; command < NULL_RENDER_COMMAND_COUNT; ++command)
+			stats.commandCounts[command] += nullList->commandCounts[command];
+		stats.commandBytes += nullList->streamSize;
+	}
+}
+
+// everything before the signal is done right away
+static bool Signal(void* queue, void* fence, uint64_t value) {
+	static_cast<NullRenderQueue*>(queue)->nullDevice->stats.signalCount++;
+	static_cast<NullRenderFence*>(fence)->value = value;
+	return true;
+}
+
+static bool Wait(void* queue, void* fence, uint64_t value) {
+	(void)queue;
+	(void)fence;
+	(void)value;
+	return true;
+}
+
+static uint64_t GetCompletedValue(void* fence) {
+	return static_cast<NullRenderFence*>(fence)->value;
+}
+
+// a value nobody signaled yet would never be reached
+static bool WaitForValue(void* fence, uint64_t value) {
+	return static_cast<NullRenderFence*>(fence)->value >= value;
+}
+
+static const RenderDeviceFunctions nullRenderFunctions = {
+	CreateBuffer,
+	DestroyBuffer,
+	CreateCommandList,
+	DestroyCommandList,
+	CreateQueue,
+	DestroyQueue,
+	CreateFence,
+	DestroyFence,
+
+	ExecuteCommandLists,
+	Signal,
+	Wait,
+
+	GetCompletedValue,
+	WaitForValue,
+
+	Reset,
+	Close,
+
+	SetPipelineState,
+	SetRootSignature,
+	SetRootConstantBuffer,
+	SetRootShaderResource,
+	SetRootUnorderedAccess,
+	SetRootConstants,
+	SetRootDescriptorTable,
+	SetDescriptorHeap,
+
+	SetRenderTarget,
+	SetViewport,
+	SetScissorRect,
+	SetPrimitiveTopology,
+	SetVertexBuffer,
+	SetIndexBuffer,
+
+	ClearRenderTarget,
+	ClearDepth,
+
+	DrawIndexedInstanced,
+	Dispatch,
+	DispatchMesh,
+	ExecuteIndirect,
+	CopyBufferRegion,
+	Barriers,
+};
+
+void NullRenderDeviceInit(NullRenderDevice& nullDevice) {
+	RenderDeviceInit(nullDevice.device, &nullRenderFunctions, &nullDevice);
+	nullDevice.nextGpuAddress = nullRenderFirstGpuAddress;
+	memset(&nullDevice.stats, 0, sizeof(nullDevice.stats));
+}
+
+NullRenderCommandList* NullRenderGetCommandList(const RenderCommandList& list) {
+	return static_cast<NullRenderCommandList*>(list.list);
+}
+
+// replay
+
+struct StreamReader {
+	const uint8_t* position;
+	const uint8_t* end;
+	bool failed;
+};
+
+template <typename T>
+static T Get(StreamReader& reader) {
+	T value;
+	if ((size_t)(reader.end - reader.position) < sizeof(T)) {
+		reader.failed = true;
+		memset(&value, 0, sizeof(T));
+		return value;
+	}
+
+	memcpy(&value, reader.position, sizeof(T));
+	reader.position += sizeof(T);
+	return value;
+}
+
+static void* GetPointer(StreamReader& reader) {
+	return (void*)(uintptr_t)Get<uint64_t>(reader);
+}
+
+static RenderBindPoint GetBindPoint(StreamReader& reader) {
+	uint8_t bindPoint = Get<uint8_t>(reader);
+	if (bindPoint > RENDER_BIND_COMPUTE)
+		reader.failed = true;
+	return (RenderBindPoint)bindPoint;
+}
+
+static bool ReplayBarriers(StreamReader& reader, RenderCommandList& target) {
+	uint32_t count = Get<uint32_t>(reader);
+
+	// every barrier takes at least 17 bytes, so a count the stream cannot hold is caught before allocating
+	if (reader.failed || count > (size_t)(reader.end - reader.position) / 17)
+		return false;
+
+	std::vector<RenderBarrier> barriers(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		RenderBarrier& barrier = barriers[i];
+		memset(&barrier, 0, sizeof(barrier));
+
+		barrier.type = (RenderBarrierType)Get<uint8_t>(reader);
+		if (barrier.type == RENDER_BARRIER_ALIASING) {
+			barrier.resourceBefore = GetPointer(reader);
+			barrier.resource = GetPointer(reader);
+			continue;
+		}
+		if (barrier.type != RENDER_BARRIER_TRANSITION)
+			return false;
+
+		barrier.resource = GetPointer(reader);
+		barrier.subresource = Get<uint32_t>(reader);
+		barrier.stateBefore = Get<uint32_t>(reader);
+		barrier.stateAfter = Get<uint32_t>(reader);
+		barrier.flag = (ResourceBarrierFlag)Get<uint8_t>(reader);
+	}
+
+	if (reader.failed)
+		return false;
+
+	RenderCommandListBarriers(target, barriers.data(), count);
+	return true;
+}
+
+// decodes one command and records it, false at the first one that does not decode
+static bool ReplayCommand(StreamReader& reader, RenderCommandList& target) {
+	uint8_t command = Get<uint8_t>(reader);
+
+	switch (command) {
+	case NULL_RENDER_SET_PIPELINE_STATE: {
+		void* pipelineState = GetPointer(reader);
+		if (reader.failed)
+			return false;
+		RenderCommandListSetPipelineState(target, pipelineState);
+		return true;
+	}
+	case NULL_RENDER_SET_ROOT_SIGNATURE: {
+		RenderBindPoint bindPoint = GetBindPoint(reader);
+		void* rootSignature = GetPointer(reader);
+		if (reader.failed)
+			return false;
+		RenderCommandListSetRootSignature(target, bindPoint, rootSignature);
+		return true;
+	}
+	case NULL_RENDER_SET_ROOT_CONSTANT_BUFFER:
+	case NULL_RENDER_SET_ROOT_SHADER_RESOURCE:
+	case NULL_RENDER_SET_ROOT_UNORDERED_ACCESS:
+	case NULL_RENDER_SET_ROOT_DESCRIPTOR_TABLE: {
+		RenderBindPoint bindPoint = GetBindPoint(reader);
+		uint32_t index = Get<uint8_t>(reader);
+		uint64_t gpuAddress = Get<uint64_t>(reader);
+		if (reader.failed)
+			return false;
+
+		if (command == NULL_RENDER_SET_ROOT_CONSTANT_BUFFER) {
+			RenderCommandListSetRootConstantBuffer(target, bindPoint, index, gpuAddress);
+		}
+		else if (command == NULL_RENDER_SET_ROOT_SHADER_RESOURCE) {
+			RenderCommandListSetRootShaderResource(target, bindPoint, index, gpuAddress);
+		}
+		else if (command == NULL_RENDER_SET_ROOT_UNORDERED_ACCESS) {
+			RenderCommandListSetRootUnorderedAccess(target, bindPoint, index, gpuAddress);
+		}
+		else {
+			RenderDescriptor table = { 0, gpuAddress };
+			RenderCommandListSetRootDescriptorTable(target, bindPoint, index, table);
+		}
+		return true;
+	}
+	case NULL_RENDER_SET_ROOT_CONSTANTS: {
+		RenderBindPoint bindPoint = GetBindPoint(reader);
+		uint32_t index = Get<uint8_t>(reader);
+		uint32_t count = Get<uint8_t>(reader);
+		uint32_t offset = Get<uint8_t>(reader);
+		if (reader.failed || (size_t)(reader.end - reader.position) < count * 4)
+			return false;
+
+		uint32_t values[256];
+		memcpy(values, reader.position, count * 4);
+		reader.position += count * 4;
+
+		RenderCommandListSetRootConstants(target, bindPoint, index, count, values, offset);
+		return true;
+	}
+	case NULL_RENDER_SET_DESCRIPTOR_HEAP: {
+		void* heap = GetPointer(reader);
+		if (reader.failed)
+			return false;
+		RenderCommandListSetDescriptorHeap(target, heap);
+		return true;
+	}
+	case NULL_RENDER_SET_RENDER_TARGET: {
+		RenderDescriptor renderTarget = { Get<uint64_t>(reader), 0 };
+		RenderDescriptor depthStencil = { Get<uint64_t>(reader), 0 };
+		if (reader.failed)
+			return false;
+		RenderCommandListSetRenderTarget(target, renderTarget, depthStencil);
+		return true;
+	}
+	case NULL_RENDER_SET_VIEWPORT: {
+		RenderViewport viewport = Get<RenderViewport>(reader);
+		if (reader.failed)
+			return false;
+		RenderCommandListSetViewport(target, viewport);
+		return true;
+	}
+	case NULL_RENDER_SET_SCISSOR_RECT: {
+		RenderRect rect = Get<RenderRect>(reader);
+		if (reader.failed)
+			return false;
+		RenderCommandListSetScissorRect(target, rect);
+		return true;
+	}
+	case NULL_RENDER_SET_PRIMITIVE_TOPOLOGY: {
+		uint32_t topology = Get<uint8_t>(reader);
+		if (reader.failed)
+			return false;
+		RenderCommandListSetPrimitiveTopology(target, topology);
+		return true;
+	}
+	case NULL_RENDER_SET_VERTEX_BUFFER: {
+		RenderVertexBufferView view;
+		view.gpuAddress = Get<uint64_t>(reader);
+		view.size = Get<uint32_t>(reader);
+		view.stride = Get<uint32_t>(reader);
+		if (reader.failed)
+			return false;
+		RenderCommandListSetVertexBuffer(target, view);
+		return true;
+	}
+	case NULL_RENDER_SET_INDEX_BUFFER: {
+		RenderIndexBufferView view;
+		view.gpuAddress = Get<uint64_t>(reader);
+		view.size = Get<uint32_t>(reader);
+		view.format = Get<uint32_t>(reader);
+		if (reader.failed)
+			return false;
+		RenderCommandListSetIndexBuffer(target, view);
+		return true;
+	}
+	case NULL_RENDER_CLEAR_RENDER_TARGET: {
+		RenderDescriptor renderTarget = { Get<uint64_t>(reader), 0 };
+		float color[4];
+		for (int i = 0; i < 4; ++i)
+			color[i] = Get<float>(reader);
+		if (reader.failed)
+			return false;
+		RenderCommandListClearRenderTarget(target, renderTarget, color);
+		return true;
+	}
+	case NULL_RENDER_CLEAR_DEPTH: {
+		RenderDescriptor depthStencil = { Get<uint64_t>(reader), 0 };
+		float depth = Get<float>(reader);
+		if (reader.failed)
+			return false;
+		RenderCommandListClearDepth(target, depthStencil, depth);
+		return true;
+	}
+	case NULL_RENDER_DRAW_INDEXED_INSTANCED: {
+		uint32_t indexCount = Get<uint32_t>(reader);
+		uint32_t instanceCount = Get<uint32_t>(reader);
+		uint32_t startIndex = Get<uint32_t>(reader);
+		int32_t baseVertex = Get<int32_t>(reader);
+		uint32_t startInstance = Get<uint32_t>(reader);
+		if (reader.failed)
+			return false;
+		RenderCommandListDrawIndexedInstanced(target, indexCount, instanceCount, startIndex, baseVertex, startInstance);
+		return true;
+	}
+	case NULL_RENDER_DISPATCH:
+	case NULL_RENDER_DISPATCH_MESH: {
+		uint32_t x = Get<uint32_t>(reader);
+		uint32_t y = Get<uint32_t>(reader);
+		uint32_t z = Get<uint32_t>(reader);
+		if (reader.failed)
+			return false;
+
+		if (command == NULL_RENDER_DISPATCH)
+			RenderCommandListDispatch(target, x, y, z);
+		else
+			RenderCommandListDispatchMesh(target, x, y, z);
+		return true;
+	}
+	case NULL_RENDER_EXECUTE_INDIRECT: {
+		void* commandSignature = GetPointer(reader);
+		uint32_t maxCount = Get<uint32_t>(reader);
+		void* argumentResource = GetPointer(reader);
+		uint64_t argumentOffset = Get<uint64_t>(reader);
+		void* countResource = GetPointer(reader);
+		uint64_t countOffset = Get<uint64_t>(reader);
+		if (reader.failed)
+			return false;
+		RenderCommandListExecuteIndirect(target, commandSignature, maxCount, argumentResource, argumentOffset, countResource, countOffset);
+		return true;
+	}
+	case NULL_RENDER_COPY_BUFFER_REGION: {
+		void* destination = GetPointer(reader);
+		uint64_t destinationOffset = Get<uint64_t>(reader);
+		void* source = GetPointer(reader);
+		uint64_t sourceOffset = Get<uint64_t>(reader);
+		uint64_t size = Get<uint64_t>(reader);
+		if (reader.failed)
+			return false;
+		RenderCommandListCopyBufferRegion(target, destination, destinationOffset, source, sourceOffset, size);
+		return true;
+	}
+	case NULL_RENDER_BARRIERS:
+		return ReplayBarriers(reader, target);
+	}
+
+	return false;
+}
+
+bool NullRenderReplay(const uint8_t* stream, size_t size, RenderCommandList& target) {
+	StreamReader reader;
+	reader.position = stream;
+	reader.end = stream + size;
+	reader.failed = false;
+
+	while (reader.position < reader.end) {
+		if (!ReplayCommand(reader, target))
+			return false;
+	}
+
+	return true;
+}
+
+const char* NullRenderCommandName(uint32_t command) {
+	if (command >= NULL_RENDER_COMMAND_COUNT)
+		return "Unknown";
+	return commandNames[command];
+}
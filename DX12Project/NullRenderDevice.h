@@ -0,0 +1,88 @@
+#pragma once
+
+// render device backend without a gpu. command lists record into a compact byte stream, a one byte command followed
+// by its arguments packed without padding, queues only count what they execute, and fences complete as soon as
+// they are signaled. buffers get made up gpu addresses and real memory if the cpu can write them
+// building a frame against it costs what building it costs minus the driver, so frame construction can be measured
+// and checked on any machine, and a recorded stream can be replayed into another device's command list
+// no d3d12 dependency
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "RenderDevice.h"
+
+enum NullRenderCommand {
+	NULL_RENDER_SET_PIPELINE_STATE,
+	NULL_RENDER_SET_ROOT_SIGNATURE,
+	NULL_RENDER_SET_ROOT_CONSTANT_BUFFER,
+	NULL_RENDER_SET_ROOT_SHADER_RESOURCE,
+	NULL_RENDER_SET_ROOT_UNORDERED_ACCESS,
+	NULL_RENDER_SET_ROOT_CONSTANTS,
+	NULL_RENDER_SET_ROOT_DESCRIPTOR_TABLE,
+	NULL_RENDER_SET_DESCRIPTOR_HEAP,
+	NULL_RENDER_SET_RENDER_TARGET,
+	NULL_RENDER_SET_VIEWPORT,
+	NULL_RENDER_SET_SCISSOR_RECT,
+	NULL_RENDER_SET_PRIMITIVE_TOPOLOGY,
+	NULL_RENDER_SET_VERTEX_BUFFER,
+	NULL_RENDER_SET_INDEX_BUFFER,
+	NULL_RENDER_CLEAR_RENDER_TARGET,
+	NULL_RENDER_CLEAR_DEPTH,
+	NULL_RENDER_DRAW_INDEXED_INSTANCED,
+	NULL_RENDER_DISPATCH,
+	NULL_RENDER_DISPATCH_MESH,
+	NULL_RENDER_EXECUTE_INDIRECT,
+	NULL_RENDER_COPY_BUFFER_REGION,
+	NULL_RENDER_BARRIERS,
+	NULL_RENDER_COMMAND_COUNT,
+};
+
+struct NullRenderCommandList {
+	RenderCommandListType type;
+	uint32_t allocatorCount;
+	bool recording;
+
+	// the first streamSize bytes are the commands recorded since the last reset
+	// the memory is kept across resets like a command allocator's
+	std::vector<uint8_t> stream;
+	size_t streamSize;
+
+	uint32_t commandCounts[NULL_RENDER_COMMAND_COUNT];
+};
+
+struct NullRenderStats {
+	// commands of every executed list by NullRenderCommand, and the bytes they took
+	uint64_t commandCounts[NULL_RENDER_COMMAND_COUNT];
+	uint64_t commandBytes;
+
+	uint64_t executeCount;
+	uint64_t executedListCount;
+	uint64_t signalCount;
+
+	// objects that exist
+	uint64_t bufferCount;
+	uint64_t bufferBytes;
+	uint64_t commandListCount;
+};
+
+struct NullRenderDevice {
+	// what the frame building code uses, it points back at this so this has to stay where it is
+	RenderDevice device;
+
+	// buffers are placed one after another in 64 KB steps like placed resources
+	uint64_t nextGpuAddress;
+
+	NullRenderStats stats;
+};
+
+void NullRenderDeviceInit(NullRenderDevice& nullDevice);
+
+// the backend's list behind a command list of a null device
+NullRenderCommandList* NullRenderGetCommandList(const RenderCommandList& list);
+
+// false if the commands do not decode, what was decoded up to there has been recorded into target
+bool NullRenderReplay(const uint8_t* stream, size_t size, RenderCommandList& target);
+
+const char* NullRenderCommandName(uint32_t command);
@@ -0,0 +1,197 @@
+#include "PipelineCache.h"
+
+#define SAFE_RELEASE(x) if( x ) { x->Release(); x = NULL; }
+
+static bool ReadCacheFile(LPCWSTR filename, std::vector<uint8_t>& contents) {
+	HANDLE file = CreateFileW(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	bool succeeded = GetFileSizeEx(file, &fileSize) && fileSize.HighPart == 0 && fileSize.LowPart > 0;
+
+	if (succeeded) {
+		contents.resize(fileSize.LowPart);
+
+		DWORD bytesRead = 0;
+		succeeded = ReadFile(file, &contents[0], fileSize.LowPart, &bytesRead, NULL) && bytesRead == fileSize.LowPart;
+	}
+
+	CloseHandle(file);
+	return succeeded;
+}
+
+bool PipelineCacheInit(PipelineCache& cache, ID3D12Device* device, IDXGIAdapter1* adapter, LPCWSTR filename) {
+	HRESULT hr;
+
+	cache.device = device;
+	cache.library = nullptr;
+	cache.filename = filename;
+	cache.fileData.clear();
+	cache.dirty = false;
+	cache.hitCount = 0;
+	cache.missCount = 0;
+
+	DXGI_ADAPTER_DESC1 adapterDesc;
+	hr = adapter->GetDesc1(&adapterDesc);
+	if (FAILED(hr))
+		return false;
+
+	cache.header.vendorId = adapterDesc.VendorId;
+	cache.header.deviceId = adapterDesc.DeviceId;
+	cache.header.subSysId = adapterDesc.SubSysId;
+	cache.header.revision = adapterDesc.Revision;
+
+	// user mode driver version, if dxgi does not report it the driver still rejects blobs it cannot use
+	LARGE_INTEGER driverVersion;
+	if (SUCCEEDED(adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driverVersion)))
+		cache.header.driverVersion = (uint64_t)driverVersion.QuadPart;
+	else
+		cache.header.driverVersion = 0;
+
+	ID3D12Device1* device1;
+	if (FAILED(device->QueryInterface(IID_PPV_ARGS(&device1))))
+		return true;
+
+	std::vector<uint8_t> contents;
+	const uint8_t* blob = nullptr;
+	size_t blobSize = 0;
+
+	if (ReadCacheFile(filename, contents) && ReadPipelineCacheFile(&contents[0], contents.size(), cache.header, blob, blobSize)) {
+		// swapping keeps the buffer, so blob still points into it
+		cache.fileData.swap(contents);
+	}
+	else {
+		blob = nullptr;
+		blobSize = 0;
+	}
+
+	hr = device1->CreatePipelineLibrary(blob, blobSize, IID_PPV_ARGS(&cache.library));
+	if (FAILED(hr) && blobSize > 0) {
+		// the driver can still refuse the blob (D3D12_ERROR_DRIVER_VERSION_MISMATCH), start over empty
+		cache.fileData.clear();
+		hr = device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&cache.library));
+	}
+
+	device1->Release();
+
+	// E_NOTIMPL or DXGI_ERROR_UNSUPPORTED, the driver has no pipeline libraries
+	if (FAILED(hr))
+		cache.library = nullptr;
+
+	return true;
+}
+
+// looks the pipeline up by the hash of its description, otherwise creates and stores it
+// load(name) and create() are what differs between the kinds of pipelines
+template <typename LoadFunction, typename CreateFunction>
+static HRESULT LoadOrCreatePipeline(PipelineCache& cache, uint64_t hash, LoadFunction load, CreateFunction create, ID3D12PipelineState** pipelineState) {
+	HRESULT hr;
+
+	wchar_t name[17];
+	swprintf_s(name, L"%016llx", (unsigned long long)hash);
+
+	// E_INVALIDARG if the library has no pipeline with this name or its desc does not match
+	hr = load(name);
+	if (SUCCEEDED(hr)) {
+		cache.hitCount++;
+		return hr;
+	}
+
+	cache.missCount++;
+
+	hr = create();
+	if (FAILED(hr))
+		return hr;
+
+	// fails if the name is taken already, the pipeline still works then but is not cached
+	if (SUCCEEDED(cache.library->StorePipeline(name, *pipelineState)))
+		cache.dirty = true;
+
+	return hr;
+}
+
+HRESULT PipelineCacheCreateGraphicsPipeline(PipelineCache& cache, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash, ID3D12PipelineState** pipelineState) {
+	if (cache.library == nullptr)
+		return cache.device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(pipelineState));
+
+	return LoadOrCreatePipeline(cache, HashGraphicsPipelineDesc(desc, rootSignatureHash),
+		[&](LPCWSTR name) { return cache.library->LoadGraphicsPipeline(name, &desc, IID_PPV_ARGS(pipelineState)); },
+		[&]() { return cache.device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(pipelineState)); },
+		pipelineState);
+}
+
+HRESULT PipelineCacheCreateComputePipeline(PipelineCache& cache, const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash, ID3D12PipelineState** pipelineState) {
+	if (cache.library == nullptr)
+		return cache.device->CreateComputePipelineState(&desc, IID_PPV_ARGS(pipelineState));
+
+	return LoadOrCreatePipeline(cache, HashComputePipelineDesc(desc, rootSignatureHash),
+		[&](LPCWSTR name) { return cache.library->LoadComputePipeline(name, &desc, IID_PPV_ARGS(pipelineState)); },
+		[&]() { return cache.device->CreateComputePipelineState(&desc, IID_PPV_ARGS(pipelineState)); },
+		pipelineState);
+}
+
+HRESULT PipelineCacheCreateStreamPipeline(PipelineCache& cache, const D3D12_PIPELINE_STATE_STREAM_DESC& desc, uint64_t rootSignatureHash, ID3D12PipelineState** pipelineState) {
+	HRESULT hr;
+
+	ID3D12Device2* device2;
+	hr = cache.device->QueryInterface(IID_PPV_ARGS(&device2));
+	if (FAILED(hr))
+		return hr;
+
+	// only ID3D12PipelineLibrary1 loads pipelines from streams
+	uint64_t hash = HashPipelineStateStream(desc, rootSignatureHash);
+	ID3D12PipelineLibrary1* library1 = nullptr;
+	if (cache.library != nullptr && hash != 0 && FAILED(cache.library->QueryInterface(IID_PPV_ARGS(&library1))))
+		library1 = nullptr;
+
+	if (library1 == nullptr) {
+		hr = device2->CreatePipelineState(&desc, IID_PPV_ARGS(pipelineState));
+	}
+	else {
+		hr = LoadOrCreatePipeline(cache, hash,
+			[&](LPCWSTR name) { return library1->LoadPipeline(name, &desc, IID_PPV_ARGS(pipelineState)); },
+			[&]() { return device2->CreatePipelineState(&desc, IID_PPV_ARGS(pipelineState)); },
+			pipelineState);
+		library1->Release();
+	}
+
+	device2->Release();
+	return hr;
+}
+
+bool PipelineCacheSave(PipelineCache& cache) {
+	if (cache.library == nullptr || !cache.dirty)
+		return true;
+
+	std::vector<uint8_t> blob(cache.library->GetSerializedSize());
+	if (blob.empty() || FAILED(cache.library->Serialize(&blob[0], blob.size())))
+		return false;
+
+	std::vector<uint8_t> contents;
+	WritePipelineCacheFile(cache.header, &blob[0], blob.size(), contents);
+
+	// written next to the real file first, so a crash while saving does not leave a broken cache behind
+	std::wstring temporaryFilename = cache.filename + L".tmp";
+
+	HANDLE file = CreateFileW(temporaryFilename.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	DWORD bytesWritten = 0;
+	bool succeeded = WriteFile(file, &contents[0], (DWORD)contents.size(), &bytesWritten, NULL) && bytesWritten == contents.size();
+	CloseHandle(file);
+
+	if (!succeeded || !MoveFileExW(temporaryFilename.c_str(), cache.filename.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+		DeleteFileW(temporaryFilename.c_str());
+		return false;
+	}
+
+	cache.dirty = false;
+	return true;
+}
+
+void PipelineCacheShutdown(PipelineCache& cache) {
+	SAFE_RELEASE(cache.library);
+	cache.fileData.clear();
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+// pipeline states that survive restarts
+// pipelines are looked up in an ID3D12PipelineLibrary by a hash of their description, so a warm start skips
+// the driver's shader compilation. the library is saved together with the adapter and driver version it was
+// built with and thrown away when either changes
+// without pipeline library support in the driver, pipelines are just created every time
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#include <windows.h>
+#include <d3d12.h>
+#include <dxgi1_6.h>
+
+#include <string>
+#include <vector>
+
+#include "PipelineHash.h"
+
+struct PipelineCache {
+	ID3D12Device* device;
+	// null if the driver does not support pipeline libraries
+	ID3D12PipelineLibrary* library;
+	PipelineCacheHeader header;
+
+	// the library reads from the loaded blob for as long as it lives
+	std::vector<uint8_t> fileData;
+	std::wstring filename;
+
+	// pipelines were stored since the file was loaded
+	bool dirty;
+
+	int hitCount;
+	int missCount;
+};
+
+// never fails because of a missing, old or broken file, it just starts empty then
+bool PipelineCacheInit(PipelineCache& cache, ID3D12Device* device, IDXGIAdapter1* adapter, LPCWSTR filename);
+
+// rootSignatureHash is a hash of the serialized root signature of desc.pRootSignature
+HRESULT PipelineCacheCreateGraphicsPipeline(PipelineCache& cache, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash, ID3D12PipelineState** pipelineState);
+HRESULT PipelineCacheCreateComputePipeline(PipelineCache& cache, const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash, ID3D12PipelineState** pipelineState);
+
+// pipelines only a stream can describe, like mesh shader pipelines. needs ID3D12Device2, streams the hash cannot
+// parse are created without the cache
+HRESULT PipelineCacheCreateStreamPipeline(PipelineCache& cache, const D3D12_PIPELINE_STATE_STREAM_DESC& desc, uint64_t rootSignatureHash, ID3D12PipelineState** pipelineState);
+
+// writes the file if pipelines were added
+bool PipelineCacheSave(PipelineCache& cache);
+
+void PipelineCacheShutdown(PipelineCache& cache);
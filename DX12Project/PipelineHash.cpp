@@ -0,0 +1,346 @@
+#include "PipelineHash.h"
+
+#include "d3dx12.h"
+
+#include <cstring>
+
+const uint64_t fnvPrime = 1099511628211ull;
+
+const uint32_t pipelineCacheMagic = 0x434f5350; // "PSOC"
+// bump when the hashed fields or the file layout change, old files are thrown away then
+const uint32_t pipelineCacheVersion = 1;
+
+// magic, version, four ids, driver version, blob size and blob hash
+const size_t pipelineCacheHeaderSize = 4 * 6 + 8 * 3;
+
+uint64_t HashBytes(uint64_t hash, const void* data, size_t size) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= bytes[i];
+		hash *= fnvPrime;
+	}
+	return hash;
+}
+
+template <typename T>
+static uint64_t HashValue(uint64_t hash, T value) {
+	return HashBytes(hash, &value, sizeof(value));
+}
+
+static uint64_t HashString(uint64_t hash, const char* string) {
+	if (string == nullptr)
+		return HashValue(hash, (uint32_t)0);
+
+	// with the terminator, so "AB" "C" and "A" "BC" differ
+	return HashBytes(hash, string, strlen(string) + 1);
+}
+
+// every subobject is hashed with its type in front so equal values in different fields hash differently
+// structs with small members are hashed field by field, their padding is not initialized
+struct PipelineHasher : ID3DX12PipelineParserCallbacks {
+	uint64_t hash;
+	bool failed;
+
+	PipelineHasher(uint64_t rootSignatureHash) : hash(pipelineHashSeed), failed(false) {
+		Tag(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_ROOT_SIGNATURE);
+		hash = HashValue(hash, rootSignatureHash);
+	}
+
+	void Tag(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type) {
+		hash = HashValue(hash, (uint32_t)type);
+	}
+
+	void HashShader(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type, const D3D12_SHADER_BYTECODE& shader) {
+		Tag(type);
+		hash = HashValue(hash, (uint64_t)shader.BytecodeLength);
+		if (shader.BytecodeLength > 0 && shader.pShaderBytecode != nullptr)
+			hash = HashBytes(hash, shader.pShaderBytecode, shader.BytecodeLength);
+	}
+
+	void FlagsCb(D3D12_PIPELINE_STATE_FLAGS flags) override {
+		Tag(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_FLAGS);
+		hash = HashValue(hash, flags);
+	}
+
+	void NodeMaskCb(UINT nodeMask) override {
+		Tag(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_NODE_MASK);
+		hash = HashValue(hash, nodeMask);
+	}
+
+	void InputLayoutCb(const D3D12_INPUT_LAYOUT_DESC& inputLayout) override {
+		Tag(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_INPUT_LAYOUT);
+		hash = HashValue(hash, inputLayout.NumElements);
+
+		for (UINT i = 0; i < inputLayout.NumElements; ++i) {
+			const D3D12_INPUT_ELEMENT_DESC& element = inputLayout.pInputElementDescs[i];
+			hash = HashString(hash, element.SemanticName);
+			hash = HashValue(hash, element.SemanticIndex);
+			hash = HashValue(hash, element.Format);
+			hash = HashValue(hash, element.InputSlot);
+			hash = HashValue(hash, element.AlignedByteOffset);
+			hash = HashValue(hash, element.InputSlotClass);
+			hash = HashValue(hash, element.InstanceDataStepRate);
+		}
+	}
+
+	void IBStripCutValueCb(D3D12_INDEX_BUFFER_STRIP_CUT_VALUE value) override {
+		Tag(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_IB_STRIP_CUT_VALUE);
+		hash = HashValue(hash, value);
+	}
+
+	void PrimitiveTopologyTypeCb(D3D12_PRIMITIVE_TOPOLOGY_TYPE type) override {
+		Tag(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PRIMITIVE_TOPOLOGY);
+		hash = HashValue(hash, type);
+	}
+
+	void VSCb(const D3D12_SHADER_BYTECODE& shader) override { HashShader(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_VS, shader); }
+	void GSCb(const D3D12_SHADER_BYTECODE& shader) override { HashShader(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_GS, shader); }
+	void HSCb(const D3D12_SHADER_BYTECODE& shader) override { HashShader(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_HS, shader); }
+	void DSCb(const D3D12_SHADER_BYTECODE& shader) override { HashShader(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DS, shader); }
+	void PSCb(const D3D12_SHADER_BYTECODE& shader) override { HashShader(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PS, shader); }
+	void CSCb(const D3D12_SHADER_BYTECODE& shader) override { HashShader(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_CS, shader); }
+	void ASCb(const D3D12_SHADER_BYTECODE& shader) override { HashShader(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_AS, shader); }
+	void MSCb(const D3D12_SHADER_BYTECODE& shader) override { HashShader(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_MS, shader); }
+
+	void StreamOutputCb(const D3D12_STREAM_OUTPUT_DESC& streamOutput) override {
+		Tag(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_STREAM_OUTPUT);
+		hash = HashValue(hash, streamOutput.NumEntries);
+
+		for (UINT i = 0; i < streamOutput.NumEntries; ++i) {
+			const D3D12_SO_DECLARATION_ENTRY& entry = streamOutput.pSODeclaration[i];
+			hash = HashValue(hash, entry.Stream);
+			hash = HashString(hash, entry.SemanticName);
+			hash = HashValue(hash, entry.SemanticIndex);
+			hash = HashValue(hash, entry.StartComponent);
+			hash = HashValue(hash, entry.ComponentCount);
+			hash = HashValue(hash, entry.OutputSlot);
+		}
+
+		hash = HashValue(hash, streamOutput.NumStrides);
+		if (streamOutput.NumStrides > 0)
+			hash = HashBytes(hash, streamOutput.pBufferStrides, streamOutput.NumStrides * sizeof(UINT));
+		hash = HashValue(hash, streamOutput.RasterizedStream);
+	}
+
+	void BlendStateCb(const D3D12_BLEND_DESC& blend) override {
+		Tag(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_BLEND);
+		hash = HashValue(hash, blend.AlphaToCoverageEnable);
+		hash = HashValue(hash, blend.IndependentBlendEnable);
+
+		for (int i = 0; i < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i) {
+			const D3D12_RENDER_TARGET_BLEND_DESC& target = blend.RenderTarget[i];
+			hash = HashValue(hash, target.BlendEnable);
+			hash = HashValue(hash, target.LogicOpEnable);
+			hash = HashValue(hash, target.SrcBlend);
+			hash = HashValue(hash, target.DestBlend);
+			hash = HashValue(hash, target.BlendOp);
+			hash = HashValue(hash, target.SrcBlendAlpha);
+			hash = HashValue(hash, target.DestBlendAlpha);
+			hash = HashValue(hash, target.BlendOpAlpha);
+			hash = HashValue(hash, target.LogicOp);
+			hash = HashValue(hash, target.RenderTargetWriteMask);
+		}
+	}
+
+	// the old depth stencil desc is the new one without depth bounds, both hash the same
+	void DepthStencilStateCb(const D3D12_DEPTH_STENCIL_DESC& depthStencil) override {
+		DepthStencilState1Cb(CD3DX12_DEPTH_STENCIL_DESC1(depthStencil));
+	}
+
+	void DepthStencilState1Cb(const D3D12_DEPTH_STENCIL_DESC1& depthStencil) override {
+		Tag(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL1);
+		hash = HashValue(hash, depthStencil.DepthEnable);
+		hash = HashValue(hash, depthStencil.DepthWriteMask);
+		hash = HashValue(hash, depthStencil.DepthFunc);
+		hash = HashValue(hash, depthStencil.StencilEnable);
+		hash = HashValue(hash, depthStencil.StencilReadMask);
+		hash = HashValue(hash, depthStencil.StencilWriteMask);
+
+		const D3D12_DEPTH_STENCILOP_DESC* faces[] = { &depthStencil.FrontFace, &depthStencil.BackFace };
+		for (int i = 0; i < 2; ++i) {
+			hash = HashValue(hash, faces[i]->StencilFailOp);
+			hash = HashValue(hash, faces[i]->StencilDepthFailOp);
+			hash = HashValue(hash, faces[i]->StencilPassOp);
+			hash = HashValue(hash, faces[i]->StencilFunc);
+		}
+
+		hash = HashValue(hash, depthStencil.DepthBoundsTestEnable);
+	}
+
+	void DSVFormatCb(DXGI_FORMAT format) override {
+		Tag(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL_FORMAT);
+		hash = HashValue(hash, format);
+	}
+
+	void RasterizerStateCb(const D3D12_RASTERIZER_DESC& rasterizer) override {
+		Tag(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RASTERIZER);
+		hash = HashValue(hash, rasterizer.FillMode);
+		hash = HashValue(hash, rasterizer.CullMode);
+		hash = HashValue(hash, rasterizer.FrontCounterClockwise);
+		hash = HashValue(hash, rasterizer.DepthBias);
+		hash = HashValue(hash, rasterizer.DepthBiasClamp);
+		hash = HashValue(hash, rasterizer.SlopeScaledDepthBias);
+		hash = HashValue(hash, rasterizer.DepthClipEnable);
+		hash = HashValue(hash, rasterizer.MultisampleEnable);
+		hash = HashValue(hash, rasterizer.AntialiasedLineEnable);
+		hash = HashValue(hash, rasterizer.ForcedSampleCount);
+		hash = HashValue(hash, rasterizer.ConservativeRaster);
+	}
+
+	void RTVFormatsCb(const D3D12_RT_FORMAT_ARRAY& formats) override {
+		Tag(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RENDER_TARGET_FORMATS);
+		hash = HashValue(hash, formats.NumRenderTargets);
+
+		// formats past NumRenderTargets are ignored by the runtime
+		for (UINT i = 0; i < formats.NumRenderTargets && i < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i)
+			hash = HashValue(hash, formats.RTFormats[i]);
+	}
+
+	void SampleDescCb(const DXGI_SAMPLE_DESC& sampleDesc) override {
+		Tag(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_SAMPLE_DESC);
+		hash = HashValue(hash, sampleDesc.Count);
+		hash = HashValue(hash, sampleDesc.Quality);
+	}
+
+	void SampleMaskCb(UINT sampleMask) override {
+		Tag(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_SAMPLE_MASK);
+		hash = HashValue(hash, sampleMask);
+	}
+
+	void ViewInstancingCb(const D3D12_VIEW_INSTANCING_DESC& viewInstancing) override {
+		Tag(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_VIEW_INSTANCING);
+		hash = HashValue(hash, viewInstancing.ViewInstanceCount);
+
+		for (UINT i = 0; i < viewInstancing.ViewInstanceCount; ++i) {
+			hash = HashValue(hash, viewInstancing.pViewInstanceLocations[i].ViewportArrayIndex);
+			hash = HashValue(hash, viewInstancing.pViewInstanceLocations[i].RenderTargetArrayIndex);
+		}
+
+		hash = HashValue(hash, viewInstancing.Flags);
+	}
+
+	// root signature and cached pso are not part of the key, see the constructor
+
+	void ErrorBadInputParameter(UINT) override { failed = true; }
+	void ErrorDuplicateSubobject(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE) override { failed = true; }
+	void ErrorUnknownSubobject(UINT) override { failed = true; }
+};
+
+uint64_t HashGraphicsPipelineDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash) {
+	PipelineHasher hasher(rootSignatureHash);
+
+	hasher.VSCb(desc.VS);
+	hasher.PSCb(desc.PS);
+	hasher.DSCb(desc.DS);
+	hasher.HSCb(desc.HS);
+	hasher.GSCb(desc.GS);
+	hasher.StreamOutputCb(desc.StreamOutput);
+	hasher.BlendStateCb(desc.BlendState);
+	hasher.SampleMaskCb(desc.SampleMask);
+	hasher.RasterizerStateCb(desc.RasterizerState);
+	hasher.DepthStencilStateCb(desc.DepthStencilState);
+	hasher.InputLayoutCb(desc.InputLayout);
+	hasher.IBStripCutValueCb(desc.IBStripCutValue);
+	hasher.PrimitiveTopologyTypeCb(desc.PrimitiveTopologyType);
+
+	D3D12_RT_FORMAT_ARRAY formats = {};
+	formats.NumRenderTargets = desc.NumRenderTargets;
+	for (UINT i = 0; i < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i)
+		formats.RTFormats[i] = desc.RTVFormats[i];
+	hasher.RTVFormatsCb(formats);
+
+	hasher.DSVFormatCb(desc.DSVFormat);
+	hasher.SampleDescCb(desc.SampleDesc);
+	hasher.NodeMaskCb(desc.NodeMask);
+	hasher.FlagsCb(desc.Flags);
+
+	return hasher.hash;
+}
+
+uint64_t HashComputePipelineDesc(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash) {
+	PipelineHasher hasher(rootSignatureHash);
+
+	hasher.CSCb(desc.CS);
+	hasher.NodeMaskCb(desc.NodeMask);
+	hasher.FlagsCb(desc.Flags);
+
+	return hasher.hash;
+}
+
+uint64_t HashPipelineStateStream(const D3D12_PIPELINE_STATE_STREAM_DESC& desc, uint64_t rootSignatureHash) {
+	PipelineHasher hasher(rootSignatureHash);
+
+	if (FAILED(D3DX12ParsePipelineStream(desc, &hasher)) || hasher.failed)
+		return 0;
+
+	return hasher.hash;
+}
+
+static void WriteU32(uint8_t*& output, uint32_t value) {
+	for (int i = 0; i < 4; ++i)
+		*output++ = (uint8_t)(value >> (i * 8));
+}
+
+static void WriteU64(uint8_t*& output, uint64_t value) {
+	for (int i = 0; i < 8; ++i)
+		*output++ = (uint8_t)(value >> (i * 8));
+}
+
+static uint32_t ReadU32(const uint8_t*& input) {
+	uint32_t value = 0;
+	for (int i = 0; i < 4; ++i)
+		value |= (uint32_t)*input++ << (i * 8);
+	return value;
+}
+
+static uint64_t ReadU64(const uint8_t*& input) {
+	uint64_t value = 0;
+	for (int i = 0; i < 8; ++i)
+		value |= (uint64_t)*input++ << (i * 8);
+	return value;
+}
+
+void WritePipelineCacheFile(const PipelineCacheHeader& header, const void* blob, size_t blobSize, std::vector<uint8_t>& file) {
+	file.resize(pipelineCacheHeaderSize + blobSize);
+
+	uint8_t* output = &file[0];
+	WriteU32(output, pipelineCacheMagic);
+	WriteU32(output, pipelineCacheVersion);
+	WriteU32(output, header.vendorId);
+	WriteU32(output, header.deviceId);
+	WriteU32(output, header.subSysId);
+	WriteU32(output, header.revision);
+	WriteU64(output, header.driverVersion);
+	WriteU64(output, (uint64_t)blobSize);
+	// catches truncated or otherwise damaged files before the driver sees them
+	WriteU64(output, HashBytes(pipelineHashSeed, blob, blobSize));
+
+	if (blobSize > 0)
+		memcpy(output, blob, blobSize);
+}
+
+bool ReadPipelineCacheFile(const uint8_t* file, size_t fileSize, const PipelineCacheHeader& expected, const uint8_t*& blob, size_t& blobSize) {
+	if (fileSize < pipelineCacheHeaderSize)
+		return false;
+
+	const uint8_t* input = file;
+	if (ReadU32(input) != pipelineCacheMagic || ReadU32(input) != pipelineCacheVersion)
+		return false;
+
+	// a new driver or another gpu cannot use the old blobs
+	if (ReadU32(input) != expected.vendorId || ReadU32(input) != expected.deviceId ||
+		ReadU32(input) != expected.subSysId || ReadU32(input) != expected.revision ||
+		ReadU64(input) != expected.driverVersion)
+		return false;
+
+	uint64_t size = ReadU64(input);
+	uint64_t blobHash = ReadU64(input);
+
+	if (size != fileSize - pipelineCacheHeaderSize)
+		return false;
+
+	blob = input;
+	blobSize = (size_t)size;
+
+	return HashBytes(pipelineHashSeed, blob, blobSize) == blobHash;
+}
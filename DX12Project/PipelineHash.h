@@ -0,0 +1,40 @@
+#pragma once
+
+// hashes of pipeline state descriptions and the layout of the pipeline cache file
+// only uses d3d12 types and no windows calls, so it also builds against the directx headers on linux
+
+#include <d3d12.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// fnv-1a offset basis, start value of every hash
+const uint64_t pipelineHashSeed = 14695981039346656037ull;
+
+uint64_t HashBytes(uint64_t hash, const void* data, size_t size);
+
+// everything that changes the compiled pipeline: shader bytecode, input layout, fixed function state and formats
+// the root signature is a pointer, so the caller passes a hash of its serialized blob instead
+uint64_t HashGraphicsPipelineDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash);
+
+// the compute shader, node mask and flags
+uint64_t HashComputePipelineDesc(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash);
+
+// same for a pipeline state stream, returns 0 if the stream could not be parsed
+uint64_t HashPipelineStateStream(const D3D12_PIPELINE_STATE_STREAM_DESC& desc, uint64_t rootSignatureHash);
+
+// identifies the adapter and driver a cache was written with, blobs from a different one are useless
+struct PipelineCacheHeader {
+	uint32_t vendorId;
+	uint32_t deviceId;
+	uint32_t subSysId;
+	uint32_t revision;
+	uint64_t driverVersion;
+};
+
+// header followed by the serialized pipeline library
+void WritePipelineCacheFile(const PipelineCacheHeader& header, const void* blob, size_t blobSize, std::vector<uint8_t>& file);
+
+// points blob into file, returns false if the file is broken or was written for another adapter or driver
+bool ReadPipelineCacheFile(const uint8_t* file, size_t fileSize, const PipelineCacheHeader& expected, const uint8_t*& blob, size_t& blobSize);
@@ -1,6 +1,12 @@
-Texture2D t1 : register(t0);
+// every texture of the loader, the root signature binds the whole bindless region here
+Texture2D textures[] : register(t0, space1);
 SamplerState s1 : register(s0);
 
+cbuffer DrawTexture : register(b1)
+{
+    uint textureIndex;
+};
+
 struct VS_OUTPUT
 {
     float4 pos: SV_POSITION;
@@ -9,5 +15,6 @@ struct VS_OUTPUT
 
 float4 main(VS_OUTPUT input) : SV_TARGET
 {
-    return t1.Sample(s1, input.texCoord);
+    // same for the whole draw, so no NonUniformResourceIndex
+    return textures[textureIndex].Sample(s1, input.texCoord);
 }
\ No newline at end of file
@@ -0,0 +1,191 @@
+#include "Profiler.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// chrome sorts tracks by thread id, the gpu goes first
+const uint32_t profileGpuThreadId = 0;
+
+struct ProfileThreadBuffer {
+	ProfileEvent events[profileEventsPerThread];
+	// total events ever written, the owning thread is the only writer
+	std::atomic<uint64_t> writeCount;
+	uint32_t threadId;
+	char name[64];
+	ProfileThreadBuffer* next;
+};
+
+static std::mutex registryMutex;
+static ProfileThreadBuffer* registeredBuffers = nullptr;
+static uint32_t nextThreadId = profileGpuThreadId + 1;
+
+static thread_local ProfileThreadBuffer* threadBuffer = nullptr;
+static ProfileThreadBuffer* gpuBuffer = nullptr;
+
+static ProfileThreadBuffer* RegisterBuffer(uint32_t threadId, const char* name) {
+	ProfileThreadBuffer* buffer = new ProfileThreadBuffer;
+	buffer->writeCount.store(0, std::memory_order_relaxed);
+	buffer->threadId = threadId;
+	snprintf(buffer->name, sizeof(buffer->name), "%s", name);
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+	buffer->next = registeredBuffers;
+	registeredBuffers = buffer;
+	return buffer;
+}
+
+static ProfileThreadBuffer* GetThreadBuffer() {
+	if (threadBuffer == nullptr) {
+		uint32_t threadId;
+		{
+			std::lock_guard<std::mutex> lock(registryMutex);
+			threadId = nextThreadId++;
+		}
+
+		char name[64];
+		snprintf(name, sizeof(name), "Thread %u", threadId);
+		threadBuffer = RegisterBuffer(threadId, name);
+	}
+	return threadBuffer;
+}
+
+static void WriteEvent(ProfileThreadBuffer* buffer, const char* name, uint64_t startNanoseconds, uint64_t endNanoseconds) {
+	uint64_t index = buffer->writeCount.load(std::memory_order_relaxed);
+
+	ProfileEvent& event = buffer->events[index & (profileEventsPerThread - 1)];
+	event.name = name;
+	event.startNanoseconds = startNanoseconds;
+	event.endNanoseconds = endNanoseconds;
+
+	// publishes the event to the exporting thread
+	buffer->writeCount.store(index + 1, std::memory_order_release);
+}
+
+uint64_t ProfilerNow() {
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void ProfilerRecord(const char* name, uint64_t startNanoseconds, uint64_t endNanoseconds) {
+	WriteEvent(GetThreadBuffer(), name, startNanoseconds, endNanoseconds);
+}
+
+void ProfilerSetThreadName(const char* name) {
+	ProfileThreadBuffer* buffer = GetThreadBuffer();
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+	snprintf(buffer->name, sizeof(buffer->name), "%s", name);
+}
+
+void ProfilerRecordGpu(const char* name, uint64_t startNanoseconds, uint64_t endNanoseconds) {
+	if (gpuBuffer == nullptr)
+		gpuBuffer = RegisterBuffer(profileGpuThreadId, "GPU");
+
+	WriteEvent(gpuBuffer, name, startNanoseconds, endNanoseconds);
+}
+
+// copies the events that are still valid, the writer can lap the reader while copying
+static void CopyEvents(const ProfileThreadBuffer* buffer, std::vector<ProfileEvent>& events) {
+	uint64_t end = buffer->writeCount.load(std::memory_order_acquire);
+	uint64_t begin = end > profileEventsPerThread ? end - profileEventsPerThread : 0;
+
+	size_t first = events.size();
+	for (uint64_t i = begin; i < end; ++i)
+		events.push_back(buffer->events[i & (profileEventsPerThread - 1)]);
+
+	// anything the writer reached in the meantime may have been overwritten halfway through the copy
+	std::atomic_thread_fence(std::memory_order_acquire);
+	uint64_t written = buffer->writeCount.load(std::memory_order_relaxed);
+	if (written > profileEventsPerThread && written - profileEventsPerThread > begin) {
+		uint64_t overwritten = written - profileEventsPerThread - begin;
+		if (overwritten > end - begin)
+			overwritten = end - begin;
+		events.erase(events.begin() + first, events.begin() + first + (size_t)overwritten);
+	}
+}
+
+static void AppendJsonString(std::string& json, const char* text) {
+	json += '"';
+	for (const char* c = text; *c != '\0'; ++c) {
+		if (*c == '"' || *c == '\\') {
+			json += '\\';
+			json += *c;
+		}
+		else if ((unsigned char)*c < 0x20) {
+			json += ' ';
+		}
+		else {
+			json += *c;
+		}
+	}
+	json += '"';
+}
+
+bool ProfilerWriteChromeTrace(const char* filename) {
+	struct ThreadEvents {
+		uint32_t threadId;
+		std::string name;
+		std::vector<ProfileEvent> events;
+	};
+
+	std::vector<ThreadEvents> threads;
+	{
+		std::lock_guard<std::mutex> lock(registryMutex);
+		for (ProfileThreadBuffer* buffer = registeredBuffers; buffer != nullptr; buffer = buffer->next) {
+			threads.push_back(ThreadEvents());
+			threads.back().threadId = buffer->threadId;
+			threads.back().name = buffer->name;
+			CopyEvents(buffer, threads.back().events);
+		}
+	}
+
+	// timestamps relative to the earliest event, so they stay small enough for chrome's doubles
+	uint64_t baseNanoseconds = UINT64_MAX;
+	for (const ThreadEvents& thread : threads) {
+		for (const ProfileEvent& event : thread.events) {
+			if (event.startNanoseconds < baseNanoseconds)
+				baseNanoseconds = event.startNanoseconds;
+		}
+	}
+
+	std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+	char buffer[128];
+
+	for (const ThreadEvents& thread : threads) {
+		if (!first)
+			json += ",\n";
+		first = false;
+
+		snprintf(buffer, sizeof(buffer), "{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":", thread.threadId);
+		json += buffer;
+		AppendJsonString(json, thread.name.c_str());
+		json += "}}";
+
+		for (const ProfileEvent& event : thread.events) {
+			uint64_t duration = event.endNanoseconds > event.startNanoseconds ? event.endNanoseconds - event.startNanoseconds : 0;
+
+			// complete events, microseconds with nanosecond precision
+			json += ",\n{\"ph\":\"X\",\"pid\":1,";
+			snprintf(buffer, sizeof(buffer), "\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"name\":", thread.threadId,
+				(double)(event.startNanoseconds - baseNanoseconds) / 1000.0, (double)duration / 1000.0);
+			json += buffer;
+			AppendJsonString(json, event.name);
+			json += '}';
+		}
+	}
+
+	json += "\n]}\n";
+
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	if (!file)
+		return false;
+
+	file.write(json.data(), (std::streamsize)json.size());
+	return (bool)file;
+}
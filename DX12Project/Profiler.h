@@ -0,0 +1,55 @@
+#pragma once
+
+// cpu timing scopes written to per thread ring buffers, exported as chrome trace json (chrome://tracing or about:tracing)
+// PROFILE_SCOPE compiles to nothing unless ENABLE_PROFILING is defined
+// recording never locks, every thread only writes to its own buffer. the buffer is registered under a lock
+// the first time a thread records, and is never freed so events of finished threads can still be exported
+// no windows or d3d12 dependency, gpu timings are added through ProfilerRecordGpu
+
+#include <cstddef>
+#include <cstdint>
+
+// events kept per thread, older ones get overwritten. has to be a power of two
+const size_t profileEventsPerThread = 1 << 16;
+
+struct ProfileEvent {
+	// has to outlive the profiler, string literals only
+	const char* name;
+	uint64_t startNanoseconds;
+	uint64_t endNanoseconds;
+};
+
+// nanoseconds of std::chrono::steady_clock, which is the performance counter on windows
+uint64_t ProfilerNow();
+
+void ProfilerRecord(const char* name, uint64_t startNanoseconds, uint64_t endNanoseconds);
+
+// name shown for the calling thread's track, copied
+void ProfilerSetThreadName(const char* name);
+
+// gpu work goes on its own track, times have to be converted to the ProfilerNow clock already
+// only one thread may record gpu events
+void ProfilerRecordGpu(const char* name, uint64_t startNanoseconds, uint64_t endNanoseconds);
+
+// writes every event still in the buffers, returns false if the file could not be written
+// threads may keep recording, events they overwrite while the buffer is copied are left out
+bool ProfilerWriteChromeTrace(const char* filename);
+
+struct ProfileScope {
+	const char* name;
+	uint64_t startNanoseconds;
+
+	explicit ProfileScope(const char* name) : name(name), startNanoseconds(ProfilerNow()) {}
+	~ProfileScope() { ProfilerRecord(name, startNanoseconds, ProfilerNow()); }
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef ENABLE_PROFILING
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_THREAD_NAME(name) ProfilerSetThreadName(name)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_THREAD_NAME(name) ((void)0)
+#endif
@@ -0,0 +1,1074 @@
+#include "RenderCapture.h"
+
+#include <cstring>
+
+// D3D12_RESOURCE_STATE_COMMON, GENERIC_READ and COPY_DEST, what replayed buffers of each heap type start in
+const uint32_t captureStateCommon = 0x0;
+const uint32_t captureStateGenericRead = 0xac3;
+const uint32_t captureStateCopyDest = 0x400;
+
+// file
+
+template <typename T>
+static void Put(std::vector<uint8_t>& file, T value) {
+	size_t offset = file.size();
+	file.resize(offset + sizeof(T));
+	memcpy(&file[offset], &value, sizeof(T));
+}
+
+static void PutBytes(std::vector<uint8_t>& file, const std::vector<uint8_t>& bytes) {
+	file.insert(file.end(), bytes.begin(), bytes.end());
+}
+
+void RenderCaptureWrite(const RenderCapture& capture, std::vector<uint8_t>& file) {
+	file.clear();
+	Put<uint32_t>(file, renderCaptureMagic);
+	Put<uint32_t>(file, renderCaptureVersion);
+	Put<uint32_t>(file, (uint32_t)capture.buffers.size());
+	Put<uint32_t>(file, (uint32_t)capture.lists.size());
+	Put<uint32_t>(file, (uint32_t)capture.submitListCounts.size());
+
+	for (const RenderCaptureBuffer& buffer : capture.buffers) {
+		Put<uint64_t>(file, buffer.resource);
+		Put<uint64_t>(file, buffer.resourceOffset);
+		Put<uint64_t>(file, buffer.gpuAddress);
+		Put<uint64_t>(file, buffer.size);
+		Put<uint8_t>(file, (uint8_t)buffer.heapType);
+		Put<uint8_t>(file, buffer.contents.empty() ? 0 : 1);
+		PutBytes(file, buffer.contents);
+	}
+
+	for (const RenderCaptureList& list : capture.lists) {
+		Put<uint8_t>(file, (uint8_t)list.type);
+		Put<uint64_t>(file, list.stream.size());
+		PutBytes(file, list.stream);
+	}
+
+	for (uint32_t listCount : capture.submitListCounts)
+		Put<uint32_t>(file, listCount);
+}
+
+struct CaptureReader {
+	const uint8_t* position;
+	const uint8_t* end;
+	bool failed;
+};
+
+template <typename T>
+static T Get(CaptureReader& reader) {
+	T value;
+	if ((size_t)(reader.end - reader.position) < sizeof(T)) {
+		reader.failed = true;
+		memset(&value, 0, sizeof(T));
+		return value;
+	}
+
+	memcpy(&value, reader.position, sizeof(T));
+	reader.position += sizeof(T);
+	return value;
+}
+
+// sizes are checked against what is left before anything is allocated
+static bool GetBytes(CaptureReader& reader, uint64_t size, std::vector<uint8_t>& bytes) {
+	if (reader.failed || size > (uint64_t)(reader.end - reader.position)) {
+		reader.failed = true;
+		return false;
+	}
+
+	bytes.assign(reader.position, reader.position + size);
+	reader.position += size;
+	return true;
+}
+
+bool RenderCaptureRead(const uint8_t* file, size_t fileSize, RenderCapture& capture) {
+	CaptureReader reader;
+	reader.position = file;
+	reader.end = file + fileSize;
+	reader.failed = false;
+
+	uint32_t magic = Get<uint32_t>(reader);
+	uint32_t version = Get<uint32_t>(reader);
+	uint32_t bufferCount = Get<uint32_t>(reader);
+	uint32_t listCount = Get<uint32_t>(reader);
+	uint32_t submitCount = Get<uint32_t>(reader);
+	if (reader.failed || magic != renderCaptureMagic || version != renderCaptureVersion)
+		return false;
+
+	// every buffer takes at least 34 bytes, every list 9 and every submit 4
+	if ((uint64_t)bufferCount * 34 + (uint64_t)listCount * 9 + (uint64_t)submitCount * 4 > (uint64_t)(reader.end - reader.position))
+		return false;
+
+	capture.buffers.resize(bufferCount);
+	for (RenderCaptureBuffer& buffer : capture.buffers) {
+		buffer.resource = Get<uint64_t>(reader);
+		buffer.resourceOffset = Get<uint64_t>(reader);
+		buffer.gpuAddress = Get<uint64_t>(reader);
+		buffer.size = Get<uint64_t>(reader);
+		uint8_t heapType = Get<uint8_t>(reader);
+		uint8_t hasContents = Get<uint8_t>(reader);
+		if (reader.failed || heapType > RENDER_HEAP_READBACK || hasContents > 1 || buffer.size == 0)
+			return false;
+
+		buffer.heapType = (RenderHeapType)heapType;
+		buffer.contents.clear();
+		if (hasContents != 0 && !GetBytes(reader, buffer.size, buffer.contents))
+			return false;
+	}
+
+	capture.lists.resize(listCount);
+	for (RenderCaptureList& list : capture.lists) {
+		uint8_t type = Get<uint8_t>(reader);
+		uint64_t streamSize = Get<uint64_t>(reader);
+		if (reader.failed || type > RENDER_COMMAND_LIST_COPY || !GetBytes(reader, streamSize, list.stream))
+			return false;
+		list.type = (RenderCommandListType)type;
+	}
+
+	uint64_t submittedListCount = 0;
+	capture.submitListCounts.resize(submitCount);
+	for (uint32_t& count : capture.submitListCounts) {
+		count = Get<uint32_t>(reader);
+		submittedListCount += count;
+	}
+
+	return !reader.failed && reader.position == reader.end && submittedListCount == listCount;
+}
+
+// what the lists reference, while capturing and while replaying. captured streams are decoded into a visitor, which
+// notes the buffers they use and keeps the shadows up to date, or translates them and records them into a list
+
+struct CaptureVisitor {
+	// decoding executed lists, null while replaying
+	RenderCaptureDevice* captureDevice;
+
+	// replaying, what is recorded into
+	RenderCaptureReplay* replay;
+	RenderCommandList target;
+
+	// reused by every barrier command
+	std::vector<RenderBarrier> barriers;
+};
+
+static RenderCaptureTrackedBuffer* FindTrackedBuffer(RenderCaptureDevice& captureDevice, uint64_t gpuAddress) {
+	std::map<uint64_t, RenderCaptureTrackedBuffer>::iterator it = captureDevice.buffers.upper_bound(gpuAddress);
+	if (it == captureDevice.buffers.begin())
+		return nullptr;
+
+	--it;
+	if (gpuAddress - it->first >= it->second.size)
+		return nullptr;
+	return &it->second;
+}
+
+// the buffer at offset into resource, and where that is
+static RenderCaptureTrackedBuffer* FindTrackedResource(RenderCaptureDevice& captureDevice, const void* resource, uint64_t offset, uint64_t& gpuAddress) {
+	std::unordered_map<uint64_t, uint64_t>::const_iterator it = captureDevice.resourceAddresses.find((uint64_t)(uintptr_t)resource);
+	if (resource == nullptr || it == captureDevice.resourceAddresses.end())
+		return nullptr;
+
+	gpuAddress = it->second + offset;
+	return FindTrackedBuffer(captureDevice, gpuAddress);
+}
+
+// the first reference of a capture takes the buffer as it is now, before the list that references it changes it
+static void ReferenceBuffer(RenderCaptureDevice& captureDevice, RenderCaptureTrackedBuffer* buffer) {
+	if (!captureDevice.capturing || buffer == nullptr || buffer->captureId == captureDevice.captureId)
+		return;
+
+	buffer->captureId = captureDevice.captureId;
+
+	RenderCaptureBuffer captured;
+	captured.resource = buffer->resource;
+	captured.resourceOffset = buffer->resourceOffset;
+	captured.gpuAddress = buffer->gpuAddress;
+	captured.size = buffer->size;
+	captured.heapType = buffer->heapType;
+	if (buffer->heapType == RENDER_HEAP_UPLOAD && buffer->cpuAddress != nullptr)
+		captured.contents.assign(buffer->cpuAddress, buffer->cpuAddress + buffer->size);
+	else if (buffer->heapType == RENDER_HEAP_DEFAULT)
+		captured.contents = buffer->shadow;
+
+	captureDevice.capture.buffers.push_back(std::move(captured));
+	captureDevice.stats.capturedBufferCount++;
+}
+
+static void* MapPointer(CaptureVisitor& visitor, RenderCaptureObject object, void* value) {
+	RenderCaptureReplay* replay = visitor.replay;
+	if (replay == nullptr || value == nullptr || replay->mapObject == nullptr)
+		return value;
+
+	replay->mappedCounts[object]++;
+	return (void*)(uintptr_t)replay->mapObject(replay->mapContext, object, (uint64_t)(uintptr_t)value);
+}
+
+static uint64_t MapValue(CaptureVisitor& visitor, RenderCaptureObject object, uint64_t value) {
+	RenderCaptureReplay* replay = visitor.replay;
+	if (replay == nullptr || value == 0 || replay->mapObject == nullptr)
+		return value;
+
+	replay->mappedCounts[object]++;
+	return replay->mapObject(replay->mapContext, object, value);
+}
+
+// the captured buffer gpuAddress is in, or -1
+static int32_t FindCapturedBuffer(const RenderCaptureReplay& replay, uint64_t gpuAddress) {
+	std::map<uint64_t, uint32_t>::const_iterator it = replay.bufferAddresses.upper_bound(gpuAddress);
+	if (it == replay.bufferAddresses.begin())
+		return -1;
+
+	--it;
+	if (gpuAddress - it->first >= replay.capture->buffers[it->second].size)
+		return -1;
+	return (int32_t)it->second;
+}
+
+static uint64_t MapAddress(CaptureVisitor& visitor, uint64_t gpuAddress) {
+	if (gpuAddress == 0)
+		return 0;
+
+	if (visitor.captureDevice != nullptr) {
+		ReferenceBuffer(*visitor.captureDevice, FindTrackedBuffer(*visitor.captureDevice, gpuAddress));
+		return gpuAddress;
+	}
+
+	RenderCaptureReplay& replay = *visitor.replay;
+	int32_t index = FindCapturedBuffer(replay, gpuAddress);
+	if (index < 0)
+		return MapValue(visitor, RENDER_CAPTURE_GPU_ADDRESS, gpuAddress);
+
+	return replay.buffers[index].gpuAddress + (gpuAddress - replay.capture->buffers[index].gpuAddress);
+}
+
+// offset is into resource before and into the returned resource after
+static void* MapResource(CaptureVisitor& visitor, void* resource, uint64_t& offset) {
+	if (resource == nullptr)
+		return nullptr;
+
+	if (visitor.captureDevice != nullptr) {
+		uint64_t gpuAddress = 0;
+		RenderCaptureTrackedBuffer* buffer = FindTrackedResource(*visitor.captureDevice, resource, offset, gpuAddress);
+		ReferenceBuffer(*visitor.captureDevice, buffer);
+		return resource;
+	}
+
+	RenderCaptureReplay& replay = *visitor.replay;
+	std::unordered_map<uint64_t, uint64_t>::const_iterator it = replay.resourceAddresses.find((uint64_t)(uintptr_t)resource);
+	int32_t index = it != replay.resourceAddresses.end() ? FindCapturedBuffer(replay, it->second + offset) : -1;
+	if (index < 0)
+		return MapPointer(visitor, RENDER_CAPTURE_RESOURCE, resource);
+
+	const RenderBuffer& buffer = replay.buffers[index];
+	offset = buffer.offset + (it->second + offset - replay.capture->buffers[index].gpuAddress);
+	return buffer.resource;
+}
+
+static RenderDescriptor MapDescriptor(CaptureVisitor& visitor, RenderCaptureObject object, RenderDescriptor descriptor) {
+	if (object == RENDER_CAPTURE_DESCRIPTOR_TABLE)
+		descriptor.gpuHandle = MapValue(visitor, object, descriptor.gpuHandle);
+	else
+		descriptor.cpuHandle = MapValue(visitor, object, descriptor.cpuHandle);
+	return descriptor;
+}
+
+// a copy into a default heap buffer changes its shadow, what the copy does not reach of a buffer nothing was known
+// about reads as zeros
+static void ShadowCopy(RenderCaptureDevice& captureDevice, void* destination, uint64_t destinationOffset, void* source, uint64_t sourceOffset, uint64_t size) {
+	uint64_t destinationAddress = 0;
+	uint64_t sourceAddress = 0;
+	RenderCaptureTrackedBuffer* destinationBuffer = FindTrackedResource(captureDevice, destination, destinationOffset, destinationAddress);
+	RenderCaptureTrackedBuffer* sourceBuffer = FindTrackedResource(captureDevice, source, sourceOffset, sourceAddress);
+	if (destinationBuffer == nullptr || sourceBuffer == nullptr || destinationBuffer->heapType != RENDER_HEAP_DEFAULT)
+		return;
+
+	// offsets into the buffers themselves
+	uint64_t destinationInBuffer = destinationOffset - destinationBuffer->resourceOffset;
+	uint64_t sourceInBuffer = sourceOffset - sourceBuffer->resourceOffset;
+	if (size > destinationBuffer->size - destinationInBuffer || size > sourceBuffer->size - sourceInBuffer)
+		return;
+
+	const uint8_t* sourceBytes = nullptr;
+	if (sourceBuffer->heapType == RENDER_HEAP_UPLOAD)
+		sourceBytes = sourceBuffer->cpuAddress;
+	else if (sourceBuffer->heapType == RENDER_HEAP_DEFAULT && !sourceBuffer->shadow.empty())
+		sourceBytes = sourceBuffer->shadow.data();
+	if (sourceBytes == nullptr)
+		return;
+
+	if (destinationBuffer->shadow.empty())
+		destinationBuffer->shadow.resize((size_t)destinationBuffer->size, 0);
+
+	memmove(&destinationBuffer->shadow[(size_t)destinationInBuffer], sourceBytes + sourceInBuffer, (size_t)size);
+	captureDevice.stats.shadowedCopyCount++;
+}
+
+static void VisitSetPipelineState(void* list, void* pipelineState) {
+	CaptureVisitor& visitor = *static_cast<CaptureVisitor*>(list);
+	void* mapped = MapPointer(visitor, RENDER_CAPTURE_PIPELINE_STATE, pipelineState);
+	if (visitor.replay != nullptr)
+		RenderCommandListSetPipelineState(visitor.target, mapped);
+}
+
+static void VisitSetRootSignature(void* list, RenderBindPoint bindPoint, void* rootSignature) {
+	CaptureVisitor& visitor = *static_cast<CaptureVisitor*>(list);
+	void* mapped = MapPointer(visitor, RENDER_CAPTURE_ROOT_SIGNATURE, rootSignature);
+	if (visitor.replay != nullptr)
+		RenderCommandListSetRootSignature(visitor.target, bindPoint, mapped);
+}
+
+static void VisitSetRootConstantBuffer(void* list, RenderBindPoint bindPoint, uint32_t index, uint64_t gpuAddress) {
+	CaptureVisitor& visitor = *static_cast<CaptureVisitor*>(list);
+	uint64_t mapped = MapAddress(visitor, gpuAddress);
+	if (visitor.replay != nullptr)
+		RenderCommandListSetRootConstantBuffer(visitor.target, bindPoint, index, mapped);
+}
+
+static void VisitSetRootShaderResource(void* list, RenderBindPoint bindPoint, uint32_t index, uint64_t gpuAddress) {
+	CaptureVisitor& visitor = *static_cast<CaptureVisitor*>(list);
+	uint64_t mapped = MapAddress(visitor, gpuAddress);
+	if (visitor.replay != nullptr)
+		RenderCommandListSetRootShaderResource(visitor.target, bindPoint, index, mapped);
+}
+
+static void VisitSetRootUnorderedAccess(void* list, RenderBindPoint bindPoint, uint32_t index, uint64_t gpuAddress) {
+	CaptureVisitor& visitor = *static_cast<CaptureVisitor*>(list);
+	uint64_t mapped = MapAddress(visitor, gpuAddress);
+	if (visitor.replay != nullptr)
+		RenderCommandListSetRootUnorderedAccess(visitor.target, bindPoint, index, mapped);
+}
+
+static void VisitSetRootConstants(void* list, RenderBindPoint bindPoint, uint32_t index, uint32_t count, const void* data, uint32_t offset) {
+	CaptureVisitor& visitor = *static_cast<CaptureVisitor*>(list);
+	if (visitor.replay != nullptr)
+		RenderCommandListSetRootConstants(visitor.target, bindPoint, index, count, data, offset);
+}
+
+static void VisitSetRootDescriptorTable(void* list, RenderBindPoint bindPoint, uint32_t index, RenderDescriptor table) {
+	CaptureVisitor& visitor = *static_cast<CaptureVisitor*>(list);
+	RenderDescriptor mapped = MapDescriptor(visitor, RENDER_CAPTURE_DESCRIPTOR_TABLE, table);
+	if (visitor.replay != nullptr)
+		RenderCommandListSetRootDescriptorTable(visitor.target, bindPoint, index, mapped);
+}
+
+static void VisitSetDescriptorHeap(void* list, void* heap) {
+	CaptureVisitor& visitor = *static_cast<CaptureVisitor*>(list);
+	void* mapped = MapPointer(visitor, RENDER_CAPTURE_DESCRIPTOR_HEAP, heap);
+	if (visitor.replay != nullptr)
+		RenderCommandListSetDescriptorHeap(visitor.target, mapped);
+}
+
+static void VisitSetRenderTarget(void* list, RenderDescriptor renderTarget, RenderDescriptor depthStencil) {
+	CaptureVisitor& visitor = *static_cast<CaptureVisitor*>(list);
+	RenderDescriptor mappedTarget = MapDescriptor(visitor, RENDER_CAPTURE_RENDER_TARGET_VIEW, renderTarget);
+	RenderDescriptor mappedDepth = MapDescriptor(visitor, RENDER_CAPTURE_DEPTH_STENCIL_VIEW, depthStencil);
+	if (visitor.replay != nullptr)
+		RenderCommandListSetRenderTarget(visitor.target, mappedTarget, mappedDepth);
+}
+
+static void VisitSetViewport(void* list, const RenderViewport& viewport) {
+	CaptureVisitor& visitor = *static_cast<CaptureVisitor*>(list);
+	if (visitor.replay != nullptr)
+		RenderCommandListSetViewport(visitor.target, viewport);
+}
+
+static void VisitSetScissorRect(void* list, const RenderRect& rect) {
+	CaptureVisitor& visitor = *static_cast<CaptureVisitor*>(list);
+	if (visitor.replay != nullptr)
+		RenderCommandListSetScissorRect(visitor.target, rect);
+}
+
+static void VisitSetPrimitiveTopology(void* list, uint32_t topology) {
+	CaptureVisitor& visitor = *static_cast<CaptureVisitor*>(list);
+	if (visitor.replay != nullptr)
+		RenderCommandListSetPrimitiveTopology(visitor.target, topology);
+}
+
+static void VisitSetVertexBuffer(void* list, const RenderVertexBufferView& view) {
+	CaptureVisitor& visitor = *static_cast<CaptureVisitor*>(list);
+	RenderVertexBufferView mapped = view;
+	mapped.gpuAddress = MapAddress(visitor, view.gpuAddress);
+	if (visitor.replay != nullptr)
+		RenderCommandListSetVertexBuffer(visitor.target, mapped);
+}
+
+static void VisitSetIndexBuffer(void* list, const RenderIndexBufferView& view) {
+	CaptureVisitor& visitor = *static_cast<CaptureVisitor*>(list);
+	RenderIndexBufferView mapped = view;
+	mapped.gpuAddress = MapAddress(visitor, view.gpuAddress);
+	if (visitor.replay != nullptr)
+		RenderCommandListSetIndexBuffer(visitor.target, mapped);
+}
+
+static void VisitClearRenderTarget(void* list, RenderDescriptor renderTarget, const float color[4]) {
+	CaptureVisitor& visitor = *static_cast<CaptureVisitor*>(list);
+	RenderDescriptor mapped = MapDescriptor(visitor, RENDER_CAPTURE_RENDER_TARGET_VIEW, renderTarget);
+	if (visitor.replay != nullptr)
+		RenderCommandListClearRenderTarget(visitor.target, mapped, color);
+}
+
+static void VisitClearDepth(void* list, RenderDescriptor depthStencil, float depth) {
+	CaptureVisitor& visitor = *static_cast<CaptureVisitor*>(list);
+	RenderDescriptor mapped = MapDescriptor(visitor, RENDER_CAPTURE_DEPTH_STENCIL_VIEW, depthStencil);
+	if (visitor.replay != nullptr)
+		RenderCommandListClearDepth(visitor.target, mapped, depth);
+}
+
+static void VisitDrawIndexedInstanced(void* list, uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance) {
+	CaptureVisitor& visitor = *static_cast<CaptureVisitor*>(list);
+	if (visitor.replay != nullptr)
+		RenderCommandListDrawIndexedInstanced(visitor.target, indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+static void VisitDispatch(void* list, uint32_t x, uint32_t y, uint32_t z) {
+	CaptureVisitor& visitor = *static_cast<CaptureVisitor*>(list);
+	if (visitor.replay != nullptr)
+		RenderCommandListDispatch(visitor.target, x, y, z);
+}
+
+static void VisitDispatchMesh(void* list, uint32_t x, uint32_t y, uint32_t z) {
+	CaptureVisitor& visitor = *static_cast<CaptureVisitor*>(list);
+	if (visitor.replay != nullptr)
+		RenderCommandListDispatchMesh(visitor.target, x, y, z);
+}
+
+static void VisitExecuteIndirect(void* list, void* commandSignature, uint32_t maxCount, void* argumentResource, uint64_t argumentOffset, void* countResource, uint64_t countOffset) {
+	CaptureVisitor& visitor = *static_cast<CaptureVisitor*>(list);
+	void* mappedSignature = MapPointer(visitor, RENDER_CAPTURE_COMMAND_SIGNATURE, commandSignature);
+	void* mappedArguments = MapResource(visitor, argumentResource, argumentOffset);
+	void* mappedCount = MapResource(visitor, countResource, countOffset);
+	if (visitor.replay != nullptr)
+		RenderCommandListExecuteIndirect(visitor.target, mappedSignature, maxCount, mappedArguments, argumentOffset, mappedCount, countOffset);
+}
+
+static void VisitCopyBufferRegion(void* list, void* destination, uint64_t destinationOffset, void* source, uint64_t sourceOffset, uint64_t size) {
+	CaptureVisitor& visitor = *static_cast<CaptureVisitor*>(list);
+	uint64_t mappedDestinationOffset = destinationOffset;
+	uint64_t mappedSourceOffset = sourceOffset;
+	void* mappedDestination = MapResource(visitor, destination, mappedDestinationOffset);
+	void* mappedSource = MapResource(visitor, source, mappedSourceOffset);
+
+	// after both buffers were referenced, so the capture has them from before the copy
+	if (visitor.captureDevice != nullptr)
+		ShadowCopy(*visitor.captureDevice, destination, destinationOffset, source, sourceOffset, size);
+
+	if (visitor.replay != nullptr)
+		RenderCommandListCopyBufferRegion(visitor.target, mappedDestination, mappedDestinationOffset, mappedSource, mappedSourceOffset, size);
+}
+
+static void VisitBarriers(void* list, const RenderBarrier* barriers, uint32_t count) {
+	CaptureVisitor& visitor = *static_cast<CaptureVisitor*>(list);
+	visitor.barriers.assign(barriers, barriers + count);
+
+	for (RenderBarrier& barrier : visitor.barriers) {
+		uint64_t offset = 0;
+		barrier.resource = MapResource(visitor, barrier.resource, offset);
+		offset = 0;
+		barrier.resourceBefore = MapResource(visitor, barrier.resourceBefore, offset);
+	}
+
+	if (visitor.replay != nullptr)
+		RenderCommandListBarriers(visitor.target, visitor.barriers.data(), count);
+}
+
+// only the command list functions, nothing else is called through a visitor
+static const RenderDeviceFunctions captureVisitorFunctions = {
+	nullptr,
+	nullptr,
+	nullptr,
+	nullptr,
+	nullptr,
+	nullptr,
+	nullptr,
+	nullptr,
+
+	nullptr,
+	nullptr,
+	nullptr,
+
+	nullptr,
+	nullptr,
+
+	nullptr,
+	nullptr,
+
+	VisitSetPipelineState,
+	VisitSetRootSignature,
+	VisitSetRootConstantBuffer,
+	VisitSetRootShaderResource,
+	VisitSetRootUnorderedAccess,
+	VisitSetRootConstants,
+	VisitSetRootDescriptorTable,
+	VisitSetDescriptorHeap,
+
+	VisitSetRenderTarget,
+	VisitSetViewport,
+	VisitSetScissorRect,
+	VisitSetPrimitiveTopology,
+	VisitSetVertexBuffer,
+	VisitSetIndexBuffer,
+
+	VisitClearRenderTarget,
+	VisitClearDepth,
+
+	VisitDrawIndexedInstanced,
+	VisitDispatch,
+	VisitDispatchMesh,
+	VisitExecuteIndirect,
+	VisitCopyBufferRegion,
+	VisitBarriers,
+};
+
+// capture device, every call goes to the target and every command also to the recorder
+
+struct CaptureCommandList {
+	RenderCommandList target;
+	RenderCommandList recorder;
+	RenderCommandListType type;
+};
+
+struct CaptureQueue {
+	RenderCaptureDevice* captureDevice;
+	RenderQueue target;
+	// the target's lists of an execute call
+	std::vector<RenderCommandList> lists;
+};
+
+struct CaptureFence {
+	RenderFence target;
+};
+
+static void TrackBuffer(RenderCaptureDevice& captureDevice, uint64_t resource, uint64_t resourceOffset, uint64_t gpuAddress, uint64_t size, RenderHeapType heapType, const uint8_t* cpuAddress) {
+	if (size == 0)
+		return;
+
+	RenderCaptureTrackedBuffer& buffer = captureDevice.buffers[gpuAddress];
+	buffer.gpuAddress = gpuAddress;
+	buffer.resource = resource;
+	buffer.resourceOffset = resourceOffset;
+	buffer.size = size;
+	buffer.heapType = heapType;
+	buffer.cpuAddress = cpuAddress;
+	buffer.shadow.clear();
+	buffer.captureId = 0;
+
+	captureDevice.resourceAddresses[resource] = gpuAddress - resourceOffset;
+}
+
+static bool CreateBuffer(void* context, RenderHeapType heapType, uint64_t size, uint32_t initialState, RenderBuffer& buffer) {
+	RenderCaptureDevice* captureDevice = static_cast<RenderCaptureDevice*>(context);
+	if (!RenderDeviceCreateBuffer(*captureDevice->target, heapType, size, initialState, buffer))
+		return false;
+
+	TrackBuffer(*captureDevice, (uint64_t)(uintptr_t)buffer.resource, buffer.offset, buffer.gpuAddress, size, heapType, buffer.cpuAddress);
+	return true;
+}
+
+static void DestroyBuffer(void* context, RenderBuffer& buffer) {
+	RenderCaptureDevice* captureDevice = static_cast<RenderCaptureDevice*>(context);
+	RenderCaptureRemoveBuffer(*captureDevice, buffer.gpuAddress);
+	RenderDeviceDestroyBuffer(*captureDevice->target, buffer);
+}
+
+static bool CreateCommandList(void* context, RenderCommandListType type, uint32_t allocatorCount, void*& list) {
+	RenderCaptureDevice* captureDevice = static_cast<RenderCaptureDevice*>(context);
+
+	CaptureCommandList* captureList = new CaptureCommandList;
+	captureList->type = type;
+	if (!RenderDeviceCreateCommandList(*captureDevice->target, type, allocatorCount, captureList->target) ||
+		!RenderDeviceCreateCommandList(captureDevice->recorder.device, type, allocatorCount, captureList->recorder)) {
+		RenderDeviceDestroyCommandList(captureList->target);
+		delete captureList;
+		return false;
+	}
+
+	list = captureList;
+	return true;
+}
+
+static void DestroyCommandList(void* context, void* list) {
+	(void)context;
+	CaptureCommandList* captureList = static_cast<CaptureCommandList*>(list);
+	RenderDeviceDestroyCommandList(captureList->target);
+	RenderDeviceDestroyCommandList(captureList->recorder);
+	delete captureList;
+}
+
+static bool CreateQueue(void* context, RenderCommandListType type, void*& queue) {
+	RenderCaptureDevice* captureDevice = static_cast<RenderCaptureDevice*>(context);
+
+	CaptureQueue* captureQueue = new CaptureQueue;
+	captureQueue->captureDevice = captureDevice;
+	if (!RenderDeviceCreateQueue(*captureDevice->target, type, captureQueue->target)) {
+		delete captureQueue;
+		return false;
+	}
+
+	queue = captureQueue;
+	return true;
+}
+
+static void DestroyQueue(void* context, void* queue) {
+	(void)context;
+	CaptureQueue* captureQueue = static_cast<CaptureQueue*>(queue);
+	RenderDeviceDestroyQueue(captureQueue->target);
+	delete captureQueue;
+}
+
+static bool CreateFence(void* context, uint64_t initialValue, void*& fence) {
+	RenderCaptureDevice* captureDevice = static_cast<RenderCaptureDevice*>(context);
+
+	CaptureFence* captureFence = new CaptureFence;
+	if (!RenderDeviceCreateFence(*captureDevice->target, initialValue, captureFence->target)) {
+		delete captureFence;
+		return false;
+	}
+
+	fence = captureFence;
+	return true;
+}
+
+static void DestroyFence(void* context, void* fence) {
+	(void)context;
+	CaptureFence* captureFence = static_cast<CaptureFence*>(fence);
+	RenderDeviceDestroyFence(captureFence->target);
+	delete captureFence;
+}
+
+// lists with copies are decoded even when nothing is captured so the shadows stay up to date
+static void ExecuteCommandLists(void* queue, void* const* lists, uint32_t count) {
+	CaptureQueue* captureQueue = static_cast<CaptureQueue*>(queue);
+	RenderCaptureDevice& captureDevice = *captureQueue->captureDevice;
+
+	CaptureVisitor visitor;
+	visitor.captureDevice = &captureDevice;
+	visitor.replay = nullptr;
+	RenderCommandList scanList = { &captureDevice.scanner, &visitor };
+
+	uint32_t capturedCount = 0;
+	captureQueue->lists.resize(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		const CaptureCommandList* captureList = static_cast<const CaptureCommandList*>(lists[i]);
+		captureQueue->lists[i] = captureList->target;
+
+		const NullRenderCommandList* recorded = NullRenderGetCommandList(captureList->recorder);
+		if (!captureDevice.capturing && recorded->commandCounts[NULL_RENDER_COPY_BUFFER_REGION] == 0)
+			continue;
+
+		captureDevice.stats.scannedListCount++;
+		if (!NullRenderReplay(recorded->stream.data(), recorded->streamSize, scanList)) {
+			captureDevice.stats.failedScanCount++;
+			continue;
+		}
+
+		if (captureDevice.capturing) {
+			RenderCaptureList capturedList;
+			capturedList.type = captureList->type;
+			capturedList.stream.assign(recorded->stream.data(), recorded->stream.data() + recorded->streamSize);
+			captureDevice.capture.lists.push_back(std::move(capturedList));
+			captureDevice.stats.capturedListCount++;
+			capturedCount++;
+		}
+	}
+
+	if (capturedCount != 0)
+		captureDevice.capture.submitListCounts.push_back(capturedCount);
+
+	RenderQueueExecute(captureQueue->target, captureQueue->lists.data(), count);
+}
+
+static bool Signal(void* queue, void* fence, uint64_t value) {
+	return RenderQueueSignal(static_cast<CaptureQueue*>(queue)->target, static_cast<CaptureFence*>(fence)->target, value);
+}
+
+static bool Wait(void* queue, void* fence, uint64_t value) {
+	return RenderQueueWait(static_cast<CaptureQueue*>(queue)->target, static_cast<CaptureFence*>(fence)->target, value);
+}
+
+static uint64_t GetCompletedValue(void* fence) {
+	return RenderFenceGetCompletedValue(static_cast<CaptureFence*>(fence)->target);
+}
+
+static bool WaitForValue(void* fence, uint64_t value) {
+	return RenderFenceWait(static_cast<CaptureFence*>(fence)->target, value);
+}
+
+static bool Reset(void* list, uint32_t allocator, void* pipelineState) {
+	CaptureCommandList* captureList = static_cast<CaptureCommandList*>(list);
+	return RenderCommandListReset(captureList->target, allocator, pipelineState) && RenderCommandListReset(captureList->recorder, allocator, pipelineState);
+}
+
+static bool Close(void* list) {
+	CaptureCommandList* captureList = static_cast<CaptureCommandList*>(list);
+	bool targetClosed = RenderCommandListClose(captureList->target);
+	bool recorderClosed = RenderCommandListClose(captureList->recorder);
+	return targetClosed && recorderClosed;
+}
+
+static void SetPipelineState(void* list, void* pipelineState) {
+	CaptureCommandList* captureList = static_cast<CaptureCommandList*>(list);
+	RenderCommandListSetPipelineState(captureList->target, pipelineState);
+	RenderCommandListSetPipelineState(captureList->recorder, pipelineState);
+}
+
+static void SetRootSignature(void* list, RenderBindPoint bindPoint, void* rootSignature) {
+	CaptureCommandList* captureList = static_cast<CaptureCommandList*>(list);
+	RenderCommandListSetRootSignature(captureList->target, bindPoint, rootSignature);
+	RenderCommandListSetRootSignature(captureList->recorder, bindPoint, rootSignature);
+}
+
+static void SetRootConstantBuffer(void* list, RenderBindPoint bindPoint, uint32_t index, uint64_t gpuAddress) {
+	CaptureCommandList* captureList = static_cast<CaptureCommandList*>(list);
+	RenderCommandListSetRootConstantBuffer(captureList->target, bindPoint, index, gpuAddress);
+	RenderCommandListSetRootConstantBuffer(captureList->recorder, bindPoint, index, gpuAddress);
+}
+
+static void SetRootShaderResource(void* list, RenderBindPoint bindPoint, uint32_t index, uint64_t gpuAddress) {
+	CaptureCommandList* captureList = static_cast<CaptureCommandList*>(list);
+	RenderCommandListSetRootShaderResource(captureList->target, bindPoint, index, gpuAddress);
+	RenderCommandListSetRootShaderResource(captureList->recorder, bindPoint, index, gpuAddress);
+}
+
+static void SetRootUnorderedAccess(void* list, RenderBindPoint bindPoint, uint32_t index, uint64_t gpuAddress) {
+	CaptureCommandList* captureList = static_cast<CaptureCommandList*>(list);
+	RenderCommandListSetRootUnorderedAccess(captureList->target, bindPoint, index, gpuAddress);
+	RenderCommandListSetRootUnorderedAccess(captureList->recorder, bindPoint, index, gpuAddress);
+}
+
+static void SetRootConstants(void* list, RenderBindPoint bindPoint, uint32_t index, uint32_t count, const void* data, uint32_t offset) {
+	CaptureCommandList* captureList = static_cast<CaptureCommandList*>(list);
+	RenderCommandListSetRootConstants(captureList->target, bindPoint, index, count, data, offset);
+	RenderCommandListSetRootConstants(captureList->recorder, bindPoint, index, count, data, offset);
+}
+
+static void SetRootDescriptorTable(void* list, RenderBindPoint bindPoint, uint32_t index, RenderDescriptor table) {
+	CaptureCommandList* captureList = static_cast<CaptureCommandList*>(list);
+	RenderCommandListSetRootDescriptorTable(captureList->target, bindPoint, index, table);
+	RenderCommandListSetRootDescriptorTable(captureList->recorder, bindPoint, index, table);
+}
+
+static void SetDescriptorHeap(void* list, void* heap) {
+	CaptureCommandList* captureList = static_cast<CaptureCommandList*>(list);
+	RenderCommandListSetDescriptorHeap(captureList->target, heap);
+	RenderCommandListSetDescriptorHeap(captureList->recorder, heap);
+}
+
+static void SetRenderTarget(void* list, RenderDescriptor renderTarget, RenderDescriptor depthStencil) {
+	CaptureCommandList* captureList = static_cast<CaptureCommandList*>(list);
+	RenderCommandListSetRenderTarget(captureList->target, renderTarget, depthStencil);
+	RenderCommandListSetRenderTarget(captureList->recorder, renderTarget, depthStencil);
+}
+
+static void SetViewport(void* list, const RenderViewport& viewport) {
+	CaptureCommandList* captureList = static_cast<CaptureCommandList*>(list);
+	RenderCommandListSetViewport(captureList->target, viewport);
+	RenderCommandListSetViewport(captureList->recorder, viewport);
+}
+
+static void SetScissorRect(void* list, const RenderRect& rect) {
+	CaptureCommandList* captureList = static_cast<CaptureCommandList*>(list);
+	RenderCommandListSetScissorRect(captureList->target, rect);
+	RenderCommandListSetScissorRect(captureList->recorder, rect);
+}
+
+static void SetPrimitiveTopology(void* list, uint32_t topology) {
+	CaptureCommandList* captureList = static_cast<CaptureCommandList*>(list);
+	RenderCommandListSetPrimitiveTopology(captureList->target, topology);
+	RenderCommandListSetPrimitiveTopology(captureList->recorder, topology);
+}
+
+static void SetVertexBuffer(void* list, const RenderVertexBufferView& view) {
+	CaptureCommandList* captureList = static_cast<CaptureCommandList*>(list);
+	RenderCommandListSetVertexBuffer(captureList->target, view);
+	RenderCommandListSetVertexBuffer(captureList->recorder, view);
+}
+
+static void SetIndexBuffer(void* list, const RenderIndexBufferView& view) {
+	CaptureCommandList* captureList = static_cast<CaptureCommandList*>(list);
+	RenderCommandListSetIndexBuffer(captureList->target, view);
+	RenderCommandListSetIndexBuffer(captureList->recorder, view);
+}
+
+static void ClearRenderTarget(void* list, RenderDescriptor renderTarget, const float color[4]) {
+	CaptureCommandList* captureList = static_cast<CaptureCommandList*>(list);
+	RenderCommandListClearRenderTarget(captureList->target, renderTarget, color);
+	RenderCommandListClearRenderTarget(captureList->recorder, renderTarget, color);
+}
+
+static void ClearDepth(void* list, RenderDescriptor depthStencil, float depth) {
+	CaptureCommandList* captureList = static_cast<CaptureCommandList*>(list);
+	RenderCommandListClearDepth(captureList->target, depthStencil, depth);
+	RenderCommandListClearDepth(captureList->recorder, depthStencil, depth);
+}
+
+static void DrawIndexedInstanced(void* list, uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance) {
+	CaptureCommandList* captureList = static_cast<CaptureCommandList*>(list);
+	RenderCommandListDrawIndexedInstanced(captureList->target, indexCount, instanceCount, startIndex, baseVertex, startInstance);
+	RenderCommandListDrawIndexedInstanced(captureList->recorder, indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+static void Dispatch(void* list, uint32_t x, uint32_t y, uint32_t z) {
+	CaptureCommandList* captureList = static_cast<CaptureCommandList*>(list);
+	RenderCommandListDispatch(captureList->target, x, y, z);
+	RenderCommandListDispatch(captureList->recorder, x, y, z);
+}
+
+static void DispatchMesh(void* list, uint32_t x, uint32_t y, uint32_t z) {
+	CaptureCommandList* captureList = static_cast<CaptureCommandList*>(list);
+	RenderCommandListDispatchMesh(captureList->target, x, y, z);
+	RenderCommandListDispatchMesh(captureList->recorder, x, y, z);
+}
+
+static void ExecuteIndirect(void* list, void* commandSignature, uint32_t maxCount, void* argumentResource, uint64_t argumentOffset, void* countResource, uint64_t countOffset) {
+	CaptureCommandList* captureList = static_cast<CaptureCommandList*>(list);
+	RenderCommandListExecuteIndirect(captureList->target, commandSignature, maxCount, argumentResource, argumentOffset, countResource, countOffset);
+	RenderCommandListExecuteIndirect(captureList->recorder, commandSignature, maxCount, argumentResource, argumentOffset, countResource, countOffset);
+}
+
+static void CopyBufferRegion(void* list, void* destination, uint64_t destinationOffset, void* source, uint64_t sourceOffset, uint64_t size) {
+	CaptureCommandList* captureList = static_cast<CaptureCommandList*>(list);
+	RenderCommandListCopyBufferRegion(captureList->target, destination, destinationOffset, source, sourceOffset, size);
+	RenderCommandListCopyBufferRegion(captureList->recorder, destination, destinationOffset, source, sourceOffset, size);
+}
+
+static void Barriers(void* list, const RenderBarrier* barriers, uint32_t count) {
+	CaptureCommandList* captureList = static_cast<CaptureCommandList*>(list);
+	RenderCommandListBarriers(captureList->target, barriers, count);
+	RenderCommandListBarriers(captureList->recorder, barriers, count);
+}
+
+static const RenderDeviceFunctions captureRenderFunctions = {
+	CreateBuffer,
+	DestroyBuffer,
+	CreateCommandList,
+	DestroyCommandList,
+	CreateQueue,
+	DestroyQueue,
+	CreateFence,
+	DestroyFence,
+
+	ExecuteCommandLists,
+	Signal,
+	Wait,
+
+	GetCompletedValue,
+	WaitForValue,
+
+	Reset,
+	Close,
+
+	SetPipelineState,
+	SetRootSignature,
+	SetRootConstantBuffer,
+	SetRootShaderResource,
+	SetRootUnorderedAccess,
+	SetRootConstants,
+	SetRootDescriptorTable,
+	SetDescriptorHeap,
+
+	SetRenderTarget,
+	SetViewport,
+	SetScissorRect,
+	SetPrimitiveTopology,
+	SetVertexBuffer,
+	SetIndexBuffer,
+
+	ClearRenderTarget,
+	ClearDepth,
+
+	DrawIndexedInstanced,
+	Dispatch,
+	DispatchMesh,
+	ExecuteIndirect,
+	CopyBufferRegion,
+	Barriers,
+};
+
+void RenderCaptureDeviceInit(RenderCaptureDevice& captureDevice, RenderDevice& target) {
+	RenderDeviceInit(captureDevice.device, &captureRenderFunctions, &captureDevice);
+	captureDevice.target = &target;
+	NullRenderDeviceInit(captureDevice.recorder);
+	RenderDeviceInit(captureDevice.scanner, &captureVisitorFunctions, &captureDevice);
+
+	captureDevice.buffers.clear();
+	captureDevice.resourceAddresses.clear();
+	captureDevice.capturing = false;
+	captureDevice.captureId = 0;
+	captureDevice.capture = RenderCapture();
+	memset(&captureDevice.stats, 0, sizeof(captureDevice.stats));
+}
+
+bool RenderCaptureWrapQueue(RenderCaptureDevice& captureDevice, const RenderQueue& targetQueue, RenderQueue& queue) {
+	if (targetQueue.device != captureDevice.target)
+		return false;
+
+	CaptureQueue* captureQueue = new CaptureQueue;
+	captureQueue->captureDevice = &captureDevice;
+	captureQueue->target = targetQueue;
+
+	queue.device = &captureDevice.device;
+	queue.queue = captureQueue;
+	return true;
+}
+
+const RenderCommandList& RenderCaptureGetTargetCommandList(const RenderCommandList& list) {
+	if (list.device->functions != &captureRenderFunctions)
+		return list;
+	return static_cast<const CaptureCommandList*>(list.list)->target;
+}
+
+void RenderCaptureAddBuffer(RenderCaptureDevice& captureDevice, void* resource, uint64_t resourceOffset, uint64_t gpuAddress, uint64_t size, RenderHeapType heapType, const void* contents) {
+	TrackBuffer(captureDevice, (uint64_t)(uintptr_t)resource, resourceOffset, gpuAddress, size, heapType, nullptr);
+
+	std::map<uint64_t, RenderCaptureTrackedBuffer>::iterator it = captureDevice.buffers.find(gpuAddress);
+	if (contents != nullptr && it != captureDevice.buffers.end()) {
+		const uint8_t* bytes = static_cast<const uint8_t*>(contents);
+		if (heapType == RENDER_HEAP_DEFAULT)
+			it->second.shadow.assign(bytes, bytes + size);
+		else
+			it->second.cpuAddress = bytes;
+	}
+}
+
+void RenderCaptureRemoveBuffer(RenderCaptureDevice& captureDevice, uint64_t gpuAddress) {
+	captureDevice.buffers.erase(gpuAddress);
+}
+
+void RenderCaptureBegin(RenderCaptureDevice& captureDevice) {
+	captureDevice.capturing = true;
+	captureDevice.captureId++;
+	captureDevice.capture = RenderCapture();
+}
+
+void RenderCaptureEnd(RenderCaptureDevice& captureDevice, RenderCapture& capture) {
+	captureDevice.capturing = false;
+	capture = std::move(captureDevice.capture);
+	captureDevice.capture = RenderCapture();
+}
+
+// replay
+
+// the buffers are made, and filled where their contents were captured
+static bool CreateReplayBuffers(RenderCaptureReplay& replay, RenderQueue& queue, RenderFence& fence) {
+	const RenderCapture& capture = *replay.capture;
+	RenderDevice& device = *replay.device;
+
+	uint64_t stagingSize = 0;
+	for (const RenderCaptureBuffer& captured : capture.buffers) {
+		uint32_t initialState = captured.heapType == RENDER_HEAP_UPLOAD ? captureStateGenericRead : captured.heapType == RENDER_HEAP_READBACK ? captureStateCopyDest : captureStateCommon;
+
+		RenderBuffer buffer;
+		if (!RenderDeviceCreateBuffer(device, captured.heapType, captured.size, initialState, buffer))
+			return false;
+
+		uint32_t index = (uint32_t)replay.buffers.size();
+		replay.buffers.push_back(buffer);
+		replay.bufferAddresses[captured.gpuAddress] = index;
+		replay.resourceAddresses[captured.resource] = captured.gpuAddress - captured.resourceOffset;
+
+		if (captured.contents.empty())
+			continue;
+		if (captured.heapType == RENDER_HEAP_UPLOAD)
+			memcpy(buffer.cpuAddress, captured.contents.data(), (size_t)captured.size);
+		else if (captured.heapType == RENDER_HEAP_DEFAULT)
+			stagingSize += captured.size;
+	}
+
+	if (stagingSize == 0)
+		return true;
+
+	// the default heap contents go through one upload buffer and one list
+	RenderBuffer staging;
+	RenderCommandList list;
+	if (!RenderDeviceCreateBuffer(device, RENDER_HEAP_UPLOAD, stagingSize, captureStateGenericRead, staging))
+		return false;
+
+	bool succeeded = RenderDeviceCreateCommandList(device, RENDER_COMMAND_LIST_DIRECT, 1, list) && RenderCommandListReset(list, 0, nullptr);
+	if (succeeded) {
+		uint64_t stagingOffset = 0;
+		for (size_t i = 0; i < capture.buffers.size(); ++i) {
+			const RenderCaptureBuffer& captured = capture.buffers[i];
+			if (captured.heapType != RENDER_HEAP_DEFAULT || captured.contents.empty())
+				continue;
+
+			memcpy(staging.cpuAddress + stagingOffset, captured.contents.data(), (size_t)captured.size);
+			RenderCommandListCopyBufferRegion(list, replay.buffers[i].resource, replay.buffers[i].offset, staging.resource, staging.offset + stagingOffset, captured.size);
+			stagingOffset += captured.size;
+		}
+
+		uint64_t value = RenderFenceGetCompletedValue(fence) + 1;
+		succeeded = RenderCommandListClose(list);
+		if (succeeded) {
+			RenderQueueExecute(queue, &list, 1);
+			succeeded = RenderQueueSignal(queue, fence, value) && RenderFenceWait(fence, value);
+		}
+	}
+
+	RenderDeviceDestroyCommandList(list);
+	RenderDeviceDestroyBuffer(device, staging);
+	return succeeded;
+}
+
+bool RenderCaptureReplayInit(RenderCaptureReplay& replay, const RenderCapture& capture, RenderDevice& device, RenderQueue& queue, RenderFence& fence,
+	RenderCaptureMapFn mapObject, void* mapContext) {
+	replay.capture = &capture;
+	replay.device = &device;
+	replay.mapObject = mapObject;
+	replay.mapContext = mapContext;
+	replay.buffers.clear();
+	replay.bufferAddresses.clear();
+	replay.resourceAddresses.clear();
+	replay.lists.clear();
+	RenderDeviceInit(replay.translator, &captureVisitorFunctions, &replay);
+	memset(replay.mappedCounts, 0, sizeof(replay.mappedCounts));
+
+	if (!CreateReplayBuffers(replay, queue, fence))
+		return false;
+
+	replay.lists.resize(capture.lists.size());
+	for (size_t i = 0; i < capture.lists.size(); ++i) {
+		if (!RenderDeviceCreateCommandList(device, capture.lists[i].type, 1, replay.lists[i]))
+			return false;
+	}
+
+	return RenderCaptureReplayRecord(replay);
+}
+
+bool RenderCaptureReplayRecord(RenderCaptureReplay& replay) {
+	CaptureVisitor visitor;
+	visitor.captureDevice = nullptr;
+	visitor.replay = &replay;
+
+	for (size_t i = 0; i < replay.lists.size(); ++i) {
+		const RenderCaptureList& captured = replay.capture->lists[i];
+		if (!RenderCommandListReset(replay.lists[i], 0, nullptr))
+			return false;
+
+		visitor.target = replay.lists[i];
+		RenderCommandList translateList = { &replay.translator, &visitor };
+		bool decoded = NullRenderReplay(captured.stream.data(), captured.stream.size(), translateList);
+
+		if (!RenderCommandListClose(replay.lists[i]) || !decoded)
+			return false;
+	}
+
+	return true;
+}
+
+void RenderCaptureReplayExecute(RenderCaptureReplay& replay, RenderQueue& queue) {
+	size_t first = 0;
+	for (uint32_t count : replay.capture->submitListCounts) {
+		RenderQueueExecute(queue, &replay.lists[first], count);
+		first += count;
+	}
+}
+
+void RenderCaptureReplayDestroy(RenderCaptureReplay& replay) {
+	for (RenderCommandList& list : replay.lists)
+		RenderDeviceDestroyCommandList(list);
+	for (RenderBuffer& buffer : replay.buffers)
+		RenderDeviceDestroyBuffer(*replay.device, buffer);
+
+	replay.lists.clear();
+	replay.buffers.clear();
+	replay.bufferAddresses.clear();
+	replay.resourceAddresses.clear();
+}
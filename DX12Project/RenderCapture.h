@@ -0,0 +1,184 @@
+#pragma once
+
+// frame capture and replay
+// a capture device sits in front of another render device and forwards everything to it. its command lists also
+// record into the null device's byte stream, and between RenderCaptureBegin and RenderCaptureEnd every executed
+// list is kept along with the buffers its commands reference, as they were when the list was executed
+// buffers are what the device made and what was added with RenderCaptureAddBuffer. upload buffers are read from
+// their mapped memory, default heap buffers are shadowed: they start out with what they were added with (or
+// unknown) and the copies of every executed list are applied to the shadow. what shaders write is not known
+// a replay recreates the buffers on any device, translates resources and gpu addresses in the streams to the new
+// buffers, and everything else (pipelines, root signatures, descriptors) through a callback, then records the lists
+// once so they can be executed as often as needed. recording them again measures decoding on its own
+// no d3d12 dependency
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "NullRenderDevice.h"
+#include "RenderDevice.h"
+
+// "RCAP"
+const uint32_t renderCaptureMagic = 0x50414352;
+
+// bumped whenever the layout changes or the null device's stream does
+const uint32_t renderCaptureVersion = 1;
+
+struct RenderCaptureBuffer {
+	// what the frame knew the buffer as, copies and indirect arguments use the resource and the offset into it
+	uint64_t resource;
+	uint64_t resourceOffset;
+	uint64_t gpuAddress;
+	uint64_t size;
+	RenderHeapType heapType;
+	// size bytes, empty if what the buffer held is not known
+	std::vector<uint8_t> contents;
+};
+
+struct RenderCaptureList {
+	RenderCommandListType type;
+	// null device commands
+	std::vector<uint8_t> stream;
+};
+
+struct RenderCapture {
+	std::vector<RenderCaptureBuffer> buffers;
+	// every executed list in order
+	std::vector<RenderCaptureList> lists;
+	// how many of them every execute call took
+	std::vector<uint32_t> submitListCounts;
+};
+
+// the file is a header of counts followed by the buffers, the lists and the submits, packed without padding
+void RenderCaptureWrite(const RenderCapture& capture, std::vector<uint8_t>& file);
+
+// false if the file is not a capture of this version or does not hold what its header says
+bool RenderCaptureRead(const uint8_t* file, size_t fileSize, RenderCapture& capture);
+
+// capture
+
+// a buffer the capture device knows about, by gpu address
+struct RenderCaptureTrackedBuffer {
+	uint64_t gpuAddress;
+	uint64_t resource;
+	uint64_t resourceOffset;
+	uint64_t size;
+	RenderHeapType heapType;
+	// mapped memory of upload and readback buffers
+	const uint8_t* cpuAddress;
+	// default heap buffers once their contents are known, otherwise empty
+	std::vector<uint8_t> shadow;
+	// the device's captureId once the capture being made has it
+	uint32_t captureId;
+};
+
+struct RenderCaptureStats {
+	uint64_t capturedListCount;
+	uint64_t capturedBufferCount;
+	// executed lists that were scanned for copies to shadow buffers, and copies that hit one
+	uint64_t scannedListCount;
+	uint64_t shadowedCopyCount;
+	// lists whose stream did not decode, they are not in the capture
+	uint64_t failedScanCount;
+};
+
+struct RenderCaptureDevice {
+	// what the frame building code uses, it points back at this so this has to stay where it is
+	RenderDevice device;
+	// everything is forwarded to it
+	RenderDevice* target;
+
+	// records the command lists
+	NullRenderDevice recorder;
+	// what executed lists are decoded into to find what they reference
+	RenderDevice scanner;
+
+	std::map<uint64_t, RenderCaptureTrackedBuffer> buffers;
+	// gpu address of every resource's first byte, sub-allocated buffers share their resource
+	std::unordered_map<uint64_t, uint64_t> resourceAddresses;
+
+	bool capturing;
+	uint32_t captureId;
+	RenderCapture capture;
+
+	RenderCaptureStats stats;
+};
+
+void RenderCaptureDeviceInit(RenderCaptureDevice& captureDevice, RenderDevice& target);
+
+// a queue of the target device, made elsewhere, goes away with the returned queue
+bool RenderCaptureWrapQueue(RenderCaptureDevice& captureDevice, const RenderQueue& targetQueue, RenderQueue& queue);
+
+// the target's list behind a list of a capture device, any other list is returned as is
+const RenderCommandList& RenderCaptureGetTargetCommandList(const RenderCommandList& list);
+
+// a buffer the target device made without the capture device, it stays known until it is removed, which has to
+// happen before its memory is reused. contents is copied for default heap buffers and null if not known, for upload
+// buffers it is their mapped memory
+void RenderCaptureAddBuffer(RenderCaptureDevice& captureDevice, void* resource, uint64_t resourceOffset, uint64_t gpuAddress, uint64_t size, RenderHeapType heapType, const void* contents);
+void RenderCaptureRemoveBuffer(RenderCaptureDevice& captureDevice, uint64_t gpuAddress);
+
+// lists executed in between are captured, lists can be recorded before begin
+void RenderCaptureBegin(RenderCaptureDevice& captureDevice);
+void RenderCaptureEnd(RenderCaptureDevice& captureDevice, RenderCapture& capture);
+
+// replay
+
+// what a replay asks the callback to translate
+enum RenderCaptureObject {
+	RENDER_CAPTURE_PIPELINE_STATE,
+	RENDER_CAPTURE_ROOT_SIGNATURE,
+	RENDER_CAPTURE_DESCRIPTOR_HEAP,
+	RENDER_CAPTURE_COMMAND_SIGNATURE,
+	// resources and gpu addresses that are not in any captured buffer
+	RENDER_CAPTURE_RESOURCE,
+	RENDER_CAPTURE_GPU_ADDRESS,
+	// cpu handles
+	RENDER_CAPTURE_RENDER_TARGET_VIEW,
+	RENDER_CAPTURE_DEPTH_STENCIL_VIEW,
+	// gpu handles
+	RENDER_CAPTURE_DESCRIPTOR_TABLE,
+	RENDER_CAPTURE_OBJECT_COUNT,
+};
+
+// the value to record for a captured one, never called for 0
+typedef uint64_t (*RenderCaptureMapFn)(void* context, RenderCaptureObject object, uint64_t value);
+
+struct RenderCaptureReplay {
+	const RenderCapture* capture;
+	RenderDevice* device;
+	// null keeps the captured values
+	RenderCaptureMapFn mapObject;
+	void* mapContext;
+
+	// one per captured buffer
+	std::vector<RenderBuffer> buffers;
+	// captured buffer by gpu address, and the gpu address of every captured resource's first byte
+	std::map<uint64_t, uint32_t> bufferAddresses;
+	std::unordered_map<uint64_t, uint64_t> resourceAddresses;
+
+	// one per captured list, recorded and closed
+	std::vector<RenderCommandList> lists;
+	// what the translation does for the lists of one record, the device's list functions forward to lists
+	RenderDevice translator;
+
+	// values the callback was asked for, over every record
+	uint64_t mappedCounts[RENDER_CAPTURE_OBJECT_COUNT];
+};
+
+// makes the buffers and fills them, default heap buffers through a copy on queue that is waited for with fence
+// then records the lists. capture has to stay alive as long as the replay
+bool RenderCaptureReplayInit(RenderCaptureReplay& replay, const RenderCapture& capture, RenderDevice& device, RenderQueue& queue, RenderFence& fence,
+	RenderCaptureMapFn mapObject, void* mapContext);
+
+// decodes and records every list again, false if a stream does not decode
+bool RenderCaptureReplayRecord(RenderCaptureReplay& replay);
+
+// executes the lists the way they were submitted, what the lists changed in the buffers is not put back
+void RenderCaptureReplayExecute(RenderCaptureReplay& replay, RenderQueue& queue);
+
+// the gpu has to be done with the lists
+void RenderCaptureReplayDestroy(RenderCaptureReplay& replay);
@@ -0,0 +1,191 @@
+#include "RenderDevice.h"
+
+void RenderDeviceInit(RenderDevice& device, const RenderDeviceFunctions* functions, void* context) {
+	device.functions = functions;
+	device.context = context;
+}
+
+bool RenderDeviceCreateBuffer(RenderDevice& device, RenderHeapType heapType, uint64_t size, uint32_t initialState, RenderBuffer& buffer) {
+	return device.functions->createBuffer(device.context, heapType, size, initialState, buffer);
+}
+
+void RenderDeviceDestroyBuffer(RenderDevice& device, RenderBuffer& buffer) {
+	if (buffer.resource == nullptr)
+		return;
+
+	device.functions->destroyBuffer(device.context, buffer);
+	buffer.resource = nullptr;
+	buffer.cpuAddress = nullptr;
+	buffer.backendData = nullptr;
+}
+
+bool RenderDeviceCreateCommandList(RenderDevice& device, RenderCommandListType type, uint32_t allocatorCount, RenderCommandList& list) {
+	list.device = &device;
+	list.list = nullptr;
+	if (allocatorCount == 0 || allocatorCount > renderMaxAllocators)
+		return false;
+
+	return device.functions->createCommandList(device.context, type, allocatorCount, list.list);
+}
+
+void RenderDeviceDestroyCommandList(RenderCommandList& list) {
+	if (list.list == nullptr)
+		return;
+
+	list.device->functions->destroyCommandList(list.device->context, list.list);
+	list.list = nullptr;
+}
+
+bool RenderDeviceCreateQueue(RenderDevice& device, RenderCommandListType type, RenderQueue& queue) {
+	queue.device = &device;
+	queue.queue = nullptr;
+	return device.functions->createQueue(device.context, type, queue.queue);
+}
+
+void RenderDeviceDestroyQueue(RenderQueue& queue) {
+	if (queue.queue == nullptr)
+		return;
+
+	queue.device->functions->destroyQueue(queue.device->context, queue.queue);
+	queue.queue = nullptr;
+}
+
+bool RenderDeviceCreateFence(RenderDevice& device, uint64_t initialValue, RenderFence& fence) {
+	fence.device = &device;
+	fence.fence = nullptr;
+	return device.functions->createFence(device.context, initialValue, fence.fence);
+}
+
+void RenderDeviceDestroyFence(RenderFence& fence) {
+	if (fence.fence == nullptr)
+		return;
+
+	fence.device->functions->destroyFence(fence.device->context, fence.fence);
+	fence.fence = nullptr;
+}
+
+void RenderQueueExecute(RenderQueue& queue, const RenderCommandList* lists, uint32_t count) {
+	// a frame submits a handful of lists, larger submissions go in batches
+	const uint32_t batchSize = 16;
+	void* batch[batchSize];
+
+	for (uint32_t first = 0; first < count; first += batchSize) {
+		uint32_t batchCount = count - first < batchSize ? count - first : batchSize;
+		for (uint32_t i = 0; i < batchCount; ++i)
+			batch[i] = lists[first + i].list;
+
+		queue.device->functions->executeCommandLists(queue.queue, batch, batchCount);
+	}
+}
+
+bool RenderQueueSignal(RenderQueue& queue, RenderFence& fence, uint64_t value) {
+	return queue.device->functions->signal(queue.queue, fence.fence, value);
+}
+
+bool RenderQueueWait(RenderQueue& queue, RenderFence& fence, uint64_t value) {
+	return queue.device->functions->wait(queue.queue, fence.fence, value);
+}
+
+uint64_t RenderFenceGetCompletedValue(RenderFence& fence) {
+	return fence.device->functions->getCompletedValue(fence.fence);
+}
+
+bool RenderFenceWait(RenderFence& fence, uint64_t value) {
+	return fence.device->functions->waitForValue(fence.fence, value);
+}
+
+bool RenderCommandListReset(RenderCommandList& list, uint32_t allocator, void* pipelineState) {
+	return list.device->functions->reset(list.list, allocator, pipelineState);
+}
+
+bool RenderCommandListClose(RenderCommandList& list) {
+	return list.device->functions->close(list.list);
+}
+
+void RenderCommandListSetPipelineState(RenderCommandList& list, void* pipelineState) {
+	list.device->functions->setPipelineState(list.list, pipelineState);
+}
+
+void RenderCommandListSetRootSignature(RenderCommandList& list, RenderBindPoint bindPoint, void* rootSignature) {
+	list.device->functions->setRootSignature(list.list, bindPoint, rootSignature);
+}
+
+void RenderCommandListSetRootConstantBuffer(RenderCommandList& list, RenderBindPoint bindPoint, uint32_t index, uint64_t gpuAddress) {
+	list.device->functions->setRootConstantBuffer(list.list, bindPoint, index, gpuAddress);
+}
+
+void RenderCommandListSetRootShaderResource(RenderCommandList& list, RenderBindPoint bindPoint, uint32_t index, uint64_t gpuAddress) {
+	list.device->functions->setRootShaderResource(list.list, bindPoint, index, gpuAddress);
+}
+
+void RenderCommandListSetRootUnorderedAccess(RenderCommandList& list, RenderBindPoint bindPoint, uint32_t index, uint64_t gpuAddress) {
+	list.device->functions->setRootUnorderedAccess(list.list, bindPoint, index, gpuAddress);
+}
+
+void RenderCommandListSetRootConstants(RenderCommandList& list, RenderBindPoint bindPoint, uint32_t index, uint32_t count, const void* data, uint32_t offset) {
+	list.device->functions->setRootConstants(list.list, bindPoint, index, count, data, offset);
+}
+
+void RenderCommandListSetRootDescriptorTable(RenderCommandList& list, RenderBindPoint bindPoint, uint32_t index, RenderDescriptor table) {
+	list.device->functions->setRootDescriptorTable(list.list, bindPoint, index, table);
+}
+
+void RenderCommandListSetDescriptorHeap(RenderCommandList& list, void* heap) {
+	list.device->functions->setDescriptorHeap(list.list, heap);
+}
+
+void RenderCommandListSetRenderTarget(RenderCommandList& list, RenderDescriptor renderTarget, RenderDescriptor depthStencil) {
+	list.device->functions->setRenderTarget(list.list, renderTarget, depthStencil);
+}
+
+void RenderCommandListSetViewport(RenderCommandList& list, const RenderViewport& viewport) {
+	list.device->functions->setViewport(list.list, viewport);
+}
+
+void RenderCommandListSetScissorRect(RenderCommandList& list, const RenderRect& rect) {
+	list.device->functions->setScissorRect(list.list, rect);
+}
+
+void RenderCommandListSetPrimitiveTopology(RenderCommandList& list, uint32_t topology) {
+	list.device->functions->setPrimitiveTopology(list.list, topology);
+}
+
+void RenderCommandListSetVertexBuffer(RenderCommandList& list, const RenderVertexBufferView& view) {
+	list.device->functions->setVertexBuffer(list.list, view);
+}
+
+void RenderCommandListSetIndexBuffer(RenderCommandList& list, const RenderIndexBufferView& view) {
+	list.device->functions->setIndexBuffer(list.list, view);
+}
+
+void RenderCommandListClearRenderTarget(RenderCommandList& list, RenderDescriptor renderTarget, const float color[4]) {
+	list.device->functions->clearRenderTarget(list.list, renderTarget, color);
+}
+
+void RenderCommandListClearDepth(RenderCommandList& list, RenderDescriptor depthStencil, float depth) {
+	list.device->functions->clearDepth(list.list, depthStencil, depth);
+}
+
+void RenderCommandListDrawIndexedInstanced(RenderCommandList& list, uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance) {
+	list.device->functions->drawIndexedInstanced(list.list, indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+void RenderCommandListDispatch(RenderCommandList& list, uint32_t x, uint32_t y, uint32_t z) {
+	list.device->functions->dispatch(list.list, x, y, z);
+}
+
+void RenderCommandListDispatchMesh(RenderCommandList& list, uint32_t x, uint32_t y, uint32_t z) {
+	list.device->functions->dispatchMesh(list.list, x, y, z);
+}
+
+void RenderCommandListExecuteIndirect(RenderCommandList& list, void* commandSignature, uint32_t maxCount, void* argumentResource, uint64_t argumentOffset, void* countResource, uint64_t countOffset) {
+	list.device->functions->executeIndirect(list.list, commandSignature, maxCount, argumentResource, argumentOffset, countResource, countOffset);
+}
+
+void RenderCommandListCopyBufferRegion(RenderCommandList& list, void* destination, uint64_t destinationOffset, void* source, uint64_t sourceOffset, uint64_t size) {
+	list.device->functions->copyBufferRegion(list.list, destination, destinationOffset, source, sourceOffset, size);
+}
+
+void RenderCommandListBarriers(RenderCommandList& list, const RenderBarrier* barriers, uint32_t count) {
+	list.device->functions->barriers(list.list, barriers, count);
+}
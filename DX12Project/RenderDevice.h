@@ -0,0 +1,235 @@
+#pragma once
+
+// thin layer between the code that builds frames and the graphics api: resources, descriptors, command lists,
+// queues and fences. a device is a table of functions and the backend's data, so the same frame building code
+// records into d3d12 or into the null backend, which keeps the commands in memory and lets the cpu cost of a frame
+// be measured without a gpu
+// resources, pipelines, root signatures, command signatures and descriptor heaps are opaque pointers like in the
+// frame graph, and states, formats, flags and descriptor handles are the d3d12 values, so the d3d12 backend passes
+// everything straight through
+// objects are created through the device, recording into different command lists from different threads is fine,
+// everything else is not thread safe
+// no d3d12 dependency
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ResourceStateTracker.h"
+
+// command allocators a command list can cycle through, one per frame in flight
+const uint32_t renderMaxAllocators = 4;
+
+enum RenderHeapType {
+	RENDER_HEAP_DEFAULT,
+	RENDER_HEAP_UPLOAD,
+	RENDER_HEAP_READBACK,
+};
+
+enum RenderCommandListType {
+	RENDER_COMMAND_LIST_DIRECT,
+	RENDER_COMMAND_LIST_COMPUTE,
+	RENDER_COMMAND_LIST_COPY,
+};
+
+// which root signature root parameters are set on
+enum RenderBindPoint {
+	RENDER_BIND_GRAPHICS,
+	RENDER_BIND_COMPUTE,
+};
+
+enum RenderBarrierType {
+	RENDER_BARRIER_TRANSITION,
+	RENDER_BARRIER_ALIASING,
+};
+
+struct RenderBarrier {
+	RenderBarrierType type;
+	void* resource;
+	// aliasing only, null stands for whatever used the memory before
+	void* resourceBefore;
+	// transitions only
+	uint32_t subresource;
+	uint32_t stateBefore;
+	uint32_t stateAfter;
+	ResourceBarrierFlag flag;
+};
+
+struct RenderBuffer {
+	void* resource;
+	// where the buffer starts in resource, copies add it. 0 unless the backend sub-allocates buffers
+	uint64_t offset;
+	uint64_t gpuAddress;
+	// upload and readback buffers stay mapped for their whole lifetime, null for default heap buffers
+	uint8_t* cpuAddress;
+	uint64_t size;
+	// whatever the backend keeps for it (the heap allocation for d3d12)
+	void* backendData;
+};
+
+// a descriptor, the d3d12 cpu and shader visible handle values. either can be 0
+struct RenderDescriptor {
+	uint64_t cpuHandle;
+	uint64_t gpuHandle;
+};
+
+struct RenderViewport {
+	float x;
+	float y;
+	float width;
+	float height;
+	float minDepth;
+	float maxDepth;
+};
+
+struct RenderRect {
+	int32_t left;
+	int32_t top;
+	int32_t right;
+	int32_t bottom;
+};
+
+struct RenderVertexBufferView {
+	uint64_t gpuAddress;
+	uint32_t size;
+	uint32_t stride;
+};
+
+struct RenderIndexBufferView {
+	uint64_t gpuAddress;
+	uint32_t size;
+	// DXGI_FORMAT
+	uint32_t format;
+};
+
+struct RenderDevice;
+
+struct RenderCommandList {
+	RenderDevice* device;
+	void* list;
+};
+
+struct RenderQueue {
+	RenderDevice* device;
+	void* queue;
+};
+
+struct RenderFence {
+	RenderDevice* device;
+	void* fence;
+};
+
+// what a backend implements, list, queue and fence are the backend's pointers in the objects above
+// functions that return bool return false if the api call failed
+struct RenderDeviceFunctions {
+	bool (*createBuffer)(void* context, RenderHeapType heapType, uint64_t size, uint32_t initialState, RenderBuffer& buffer);
+	void (*destroyBuffer)(void* context, RenderBuffer& buffer);
+	bool (*createCommandList)(void* context, RenderCommandListType type, uint32_t allocatorCount, void*& list);
+	void (*destroyCommandList)(void* context, void* list);
+	bool (*createQueue)(void* context, RenderCommandListType type, void*& queue);
+	void (*destroyQueue)(void* context, void* queue);
+	bool (*createFence)(void* context, uint64_t initialValue, void*& fence);
+	void (*destroyFence)(void* context, void* fence);
+
+	void (*executeCommandLists)(void* queue, void* const* lists, uint32_t count);
+	bool (*signal)(void* queue, void* fence, uint64_t value);
+	// makes the queue wait for the fence, not the cpu
+	bool (*wait)(void* queue, void* fence, uint64_t value);
+
+	uint64_t (*getCompletedValue)(void* fence);
+	// blocks the cpu until the fence reaches value
+	bool (*waitForValue)(void* fence, uint64_t value);
+
+	bool (*reset)(void* list, uint32_t allocator, void* pipelineState);
+	bool (*close)(void* list);
+
+	void (*setPipelineState)(void* list, void* pipelineState);
+	void (*setRootSignature)(void* list, RenderBindPoint bindPoint, void* rootSignature);
+	void (*setRootConstantBuffer)(void* list, RenderBindPoint bindPoint, uint32_t index, uint64_t gpuAddress);
+	void (*setRootShaderResource)(void* list, RenderBindPoint bindPoint, uint32_t index, uint64_t gpuAddress);
+	void (*setRootUnorderedAccess)(void* list, RenderBindPoint bindPoint, uint32_t index, uint64_t gpuAddress);
+	void (*setRootConstants)(void* list, RenderBindPoint bindPoint, uint32_t index, uint32_t count, const void* data, uint32_t offset);
+	void (*setRootDescriptorTable)(void* list, RenderBindPoint bindPoint, uint32_t index, RenderDescriptor table);
+	void (*setDescriptorHeap)(void* list, void* heap);
+
+	// depthStencil can have a 0 cpu handle
+	void (*setRenderTarget)(void* list, RenderDescriptor renderTarget, RenderDescriptor depthStencil);
+	void (*setViewport)(void* list, const RenderViewport& viewport);
+	void (*setScissorRect)(void* list, const RenderRect& rect);
+	// D3D_PRIMITIVE_TOPOLOGY
+	void (*setPrimitiveTopology)(void* list, uint32_t topology);
+	void (*setVertexBuffer)(void* list, const RenderVertexBufferView& view);
+	void (*setIndexBuffer)(void* list, const RenderIndexBufferView& view);
+
+	void (*clearRenderTarget)(void* list, RenderDescriptor renderTarget, const float color[4]);
+	void (*clearDepth)(void* list, RenderDescriptor depthStencil, float depth);
+
+	void (*drawIndexedInstanced)(void* list, uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance);
+	void (*dispatch)(void* list, uint32_t x, uint32_t y, uint32_t z);
+	void (*dispatchMesh)(void* list, uint32_t x, uint32_t y, uint32_t z);
+	// countResource can be null
+	void (*executeIndirect)(void* list, void* commandSignature, uint32_t maxCount, void* argumentResource, uint64_t argumentOffset, void* countResource, uint64_t countOffset);
+	void (*copyBufferRegion)(void* list, void* destination, uint64_t destinationOffset, void* source, uint64_t sourceOffset, uint64_t size);
+	void (*barriers)(void* list, const RenderBarrier* barriers, uint32_t count);
+};
+
+struct RenderDevice {
+	const RenderDeviceFunctions* functions;
+	// the backend's device
+	void* context;
+};
+
+void RenderDeviceInit(RenderDevice& device, const RenderDeviceFunctions* functions, void* context);
+
+// device objects, destroy them only once the gpu is done with them
+bool RenderDeviceCreateBuffer(RenderDevice& device, RenderHeapType heapType, uint64_t size, uint32_t initialState, RenderBuffer& buffer);
+void RenderDeviceDestroyBuffer(RenderDevice& device, RenderBuffer& buffer);
+
+// lists are created closed, allocatorCount is at most renderMaxAllocators
+bool RenderDeviceCreateCommandList(RenderDevice& device, RenderCommandListType type, uint32_t allocatorCount, RenderCommandList& list);
+void RenderDeviceDestroyCommandList(RenderCommandList& list);
+
+bool RenderDeviceCreateQueue(RenderDevice& device, RenderCommandListType type, RenderQueue& queue);
+void RenderDeviceDestroyQueue(RenderQueue& queue);
+
+bool RenderDeviceCreateFence(RenderDevice& device, uint64_t initialValue, RenderFence& fence);
+void RenderDeviceDestroyFence(RenderFence& fence);
+
+// queues, every list has to be closed and belong to the queue's device
+void RenderQueueExecute(RenderQueue& queue, const RenderCommandList* lists, uint32_t count);
+bool RenderQueueSignal(RenderQueue& queue, RenderFence& fence, uint64_t value);
+bool RenderQueueWait(RenderQueue& queue, RenderFence& fence, uint64_t value);
+
+uint64_t RenderFenceGetCompletedValue(RenderFence& fence);
+bool RenderFenceWait(RenderFence& fence, uint64_t value);
+
+// resets the list's allocator and starts recording, the gpu has to be done with what the allocator recorded before
+bool RenderCommandListReset(RenderCommandList& list, uint32_t allocator, void* pipelineState);
+bool RenderCommandListClose(RenderCommandList& list);
+
+void RenderCommandListSetPipelineState(RenderCommandList& list, void* pipelineState);
+void RenderCommandListSetRootSignature(RenderCommandList& list, RenderBindPoint bindPoint, void* rootSignature);
+void RenderCommandListSetRootConstantBuffer(RenderCommandList& list, RenderBindPoint bindPoint, uint32_t index, uint64_t gpuAddress);
+void RenderCommandListSetRootShaderResource(RenderCommandList& list, RenderBindPoint bindPoint, uint32_t index, uint64_t gpuAddress);
+void RenderCommandListSetRootUnorderedAccess(RenderCommandList& list, RenderBindPoint bindPoint, uint32_t index, uint64_t gpuAddress);
+// count 32 bit values starting at offset of the root parameter
+void RenderCommandListSetRootConstants(RenderCommandList& list, RenderBindPoint bindPoint, uint32_t index, uint32_t count, const void* data, uint32_t offset);
+void RenderCommandListSetRootDescriptorTable(RenderCommandList& list, RenderBindPoint bindPoint, uint32_t index, RenderDescriptor table);
+void RenderCommandListSetDescriptorHeap(RenderCommandList& list, void* heap);
+
+void RenderCommandListSetRenderTarget(RenderCommandList& list, RenderDescriptor renderTarget, RenderDescriptor depthStencil);
+void RenderCommandListSetViewport(RenderCommandList& list, const RenderViewport& viewport);
+void RenderCommandListSetScissorRect(RenderCommandList& list, const RenderRect& rect);
+void RenderCommandListSetPrimitiveTopology(RenderCommandList& list, uint32_t topology);
+void RenderCommandListSetVertexBuffer(RenderCommandList& list, const RenderVertexBufferView& view);
+void RenderCommandListSetIndexBuffer(RenderCommandList& list, const RenderIndexBufferView& view);
+
+void RenderCommandListClearRenderTarget(RenderCommandList& list, RenderDescriptor renderTarget, const float color[4]);
+void RenderCommandListClearDepth(RenderCommandList& list, RenderDescriptor depthStencil, float depth);
+
+void RenderCommandListDrawIndexedInstanced(RenderCommandList& list, uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance);
+void RenderCommandListDispatch(RenderCommandList& list, uint32_t x, uint32_t y, uint32_t z);
+// only for devices and lists that support mesh shaders
+void RenderCommandListDispatchMesh(RenderCommandList& list, uint32_t x, uint32_t y, uint32_t z);
+void RenderCommandListExecuteIndirect(RenderCommandList& list, void* commandSignature, uint32_t maxCount, void* argumentResource, uint64_t argumentOffset, void* countResource, uint64_t countOffset);
+void RenderCommandListCopyBufferRegion(RenderCommandList& list, void* destination, uint64_t destinationOffset, void* source, uint64_t sourceOffset, uint64_t size);
+void RenderCommandListBarriers(RenderCommandList& list, const RenderBarrier* barriers, uint32_t count);
@@ -0,0 +1,265 @@
+#include "ResourceStateTracker.h"
+
+static bool IsReadState(const ResourceStateTracker& tracker, uint32_t state) {
+	return state != 0 && (state & ~tracker.readStates) == 0;
+}
+
+// false if the subresource is in a state that already does, otherwise target is the state to go to
+// exact asks for requested itself, not a combined read state that covers it
+static bool ResolveTransition(ResourceStateTracker& tracker, uint32_t current, uint32_t requested, bool exact, uint32_t& target) {
+	if (current == requested) {
+		++tracker.stats.skippedTransitionCount;
+		return false;
+	}
+
+	// reads can overlap, so the resource goes into both and later reads of either need no barrier
+	if (!exact && IsReadState(tracker, current) && IsReadState(tracker, requested)) {
+		if ((requested & ~current) == 0) {
+			++tracker.stats.skippedTransitionCount;
+			return false;
+		}
+		target = current | requested;
+		return true;
+	}
+
+	target = requested;
+	return true;
+}
+
+// merges with the last barrier queued for the resource if that one ends where this one starts
+static void QueueBarrier(ResourceStateTracker& tracker, void* resource, uint32_t subresource, uint32_t stateBefore, uint32_t stateAfter, ResourceBarrierFlag flag) {
+	if (flag == RESOURCE_BARRIER_FLAG_NONE) {
+		for (size_t i = tracker.pendingBarriers.size(); i-- > 0;) {
+			ResourceStateBarrier& previous = tracker.pendingBarriers[i];
+			if (previous.resource != resource)
+				continue;
+
+			if (previous.subresource == subresource && previous.flag == RESOURCE_BARRIER_FLAG_NONE && previous.stateAfter == stateBefore) {
+				if (previous.stateBefore == stateAfter) {
+					tracker.pendingBarriers.erase(tracker.pendingBarriers.begin() + i);
+					tracker.stats.mergedBarrierCount += 2;
+				}
+				else {
+					previous.stateAfter = stateAfter;
+					++tracker.stats.mergedBarrierCount;
+				}
+				return;
+			}
+
+			// anything else on the same resource has to stay in between
+			break;
+		}
+	}
+
+	ResourceStateBarrier barrier;
+	barrier.resource = resource;
+	barrier.subresource = subresource;
+	barrier.stateBefore = stateBefore;
+	barrier.stateAfter = stateAfter;
+	barrier.flag = flag;
+	tracker.pendingBarriers.push_back(barrier);
+}
+
+static void EndSplitTransition(ResourceStateTracker& tracker, size_t index) {
+	const SplitTransition& split = tracker.splitTransitions[index];
+	QueueBarrier(tracker, split.resource, split.subresource, split.stateBefore, split.stateAfter, RESOURCE_BARRIER_FLAG_END_ONLY);
+
+	tracker.splitTransitions.erase(tracker.splitTransitions.begin() + index);
+}
+
+static void EndSplitTransitionsOf(ResourceStateTracker& tracker, void* resource) {
+	for (size_t i = 0; i < tracker.splitTransitions.size();) {
+		if (tracker.splitTransitions[i].resource == resource)
+			EndSplitTransition(tracker, i);
+		else
+			++i;
+	}
+}
+
+// back to a single state once every subresource agrees again
+static void CollapseSubresourceStates(TrackedResource& tracked) {
+	for (uint32_t i = 1; i < tracked.subresourceCount; ++i) {
+		if (tracked.subresourceStates[i] != tracked.subresourceStates[0])
+			return;
+	}
+
+	tracked.uniform = true;
+	tracked.state = tracked.subresourceStates[0];
+	tracked.subresourceStates.clear();
+}
+
+void ResourceStateTrackerInit(ResourceStateTracker& tracker, uint32_t readStates) {
+	tracker.readStates = readStates;
+	tracker.resources.clear();
+	tracker.pendingBarriers.clear();
+	tracker.splitTransitions.clear();
+	tracker.stats = ResourceStateTrackerStats();
+}
+
+void ResourceStateTrackerRegister(ResourceStateTracker& tracker, void* resource, uint32_t subresourceCount, uint32_t initialState) {
+	TrackedResource& tracked = tracker.resources[resource];
+	tracked.subresourceCount = subresourceCount > 0 ? subresourceCount : 1;
+	tracked.uniform = true;
+	tracked.state = initialState;
+	tracked.subresourceStates.clear();
+}
+
+void ResourceStateTrackerUnregister(ResourceStateTracker& tracker, void* resource) {
+	tracker.resources.erase(resource);
+
+	for (size_t i = 0; i < tracker.pendingBarriers.size();) {
+		if (tracker.pendingBarriers[i].resource == resource)
+			tracker.pendingBarriers.erase(tracker.pendingBarriers.begin() + i);
+		else
+			++i;
+	}
+
+	for (size_t i = 0; i < tracker.splitTransitions.size();) {
+		if (tracker.splitTransitions[i].resource == resource)
+			tracker.splitTransitions.erase(tracker.splitTransitions.begin() + i);
+		else
+			++i;
+	}
+}
+
+static bool TransitionResource(ResourceStateTracker& tracker, void* resource, uint32_t subresource, uint32_t state, bool exact) {
+	auto found = tracker.resources.find(resource);
+	if (found == tracker.resources.end())
+		return false;
+
+	TrackedResource& tracked = found->second;
+	if (subresource != resourceStateAllSubresources && subresource >= tracked.subresourceCount)
+		return false;
+
+	++tracker.stats.requestedTransitionCount;
+	EndSplitTransitionsOf(tracker, resource);
+
+	// one subresource is the same as all of them
+	if (tracked.subresourceCount == 1)
+		subresource = resourceStateAllSubresources;
+
+	uint32_t target;
+
+	if (subresource == resourceStateAllSubresources) {
+		if (tracked.uniform) {
+			if (ResolveTransition(tracker, tracked.state, state, exact, target)) {
+				QueueBarrier(tracker, resource, resourceStateAllSubresources, tracked.state, target, RESOURCE_BARRIER_FLAG_NONE);
+				tracked.state = target;
+			}
+			return true;
+		}
+
+		for (uint32_t i = 0; i < tracked.subresourceCount; ++i) {
+			if (ResolveTransition(tracker, tracked.subresourceStates[i], state, exact, target)) {
+				QueueBarrier(tracker, resource, i, tracked.subresourceStates[i], target, RESOURCE_BARRIER_FLAG_NONE);
+				tracked.subresourceStates[i] = target;
+			}
+		}
+
+		CollapseSubresourceStates(tracked);
+		return true;
+	}
+
+	uint32_t current = tracked.uniform ? tracked.state : tracked.subresourceStates[subresource];
+	if (!ResolveTransition(tracker, current, state, exact, target))
+		return true;
+
+	if (tracked.uniform) {
+		tracked.uniform = false;
+		tracked.subresourceStates.assign(tracked.subresourceCount, tracked.state);
+	}
+
+	QueueBarrier(tracker, resource, subresource, current, target, RESOURCE_BARRIER_FLAG_NONE);
+	tracked.subresourceStates[subresource] = target;
+
+	CollapseSubresourceStates(tracked);
+	return true;
+}
+
+bool ResourceStateTrackerTransition(ResourceStateTracker& tracker, void* resource, uint32_t subresource, uint32_t state) {
+	return TransitionResource(tracker, resource, subresource, state, false);
+}
+
+bool ResourceStateTrackerRestore(ResourceStateTracker& tracker, void* resource, uint32_t state) {
+	return TransitionResource(tracker, resource, resourceStateAllSubresources, state, true);
+}
+
+bool ResourceStateTrackerBeginTransition(ResourceStateTracker& tracker, void* resource, uint32_t subresource, uint32_t state) {
+	auto found = tracker.resources.find(resource);
+	if (found == tracker.resources.end())
+		return false;
+
+	TrackedResource& tracked = found->second;
+	if (tracked.subresourceCount == 1)
+		subresource = resourceStateAllSubresources;
+
+	// a split barrier needs a single state to start from, subresources that disagree get a plain transition
+	if (subresource == resourceStateAllSubresources && !tracked.uniform)
+		return ResourceStateTrackerTransition(tracker, resource, subresource, state);
+
+	if (subresource != resourceStateAllSubresources && subresource >= tracked.subresourceCount)
+		return false;
+
+	++tracker.stats.requestedTransitionCount;
+	EndSplitTransitionsOf(tracker, resource);
+
+	uint32_t current = tracked.uniform ? tracked.state : tracked.subresourceStates[subresource];
+	uint32_t target;
+	if (!ResolveTransition(tracker, current, state, false, target))
+		return true;
+
+	QueueBarrier(tracker, resource, subresource, current, target, RESOURCE_BARRIER_FLAG_BEGIN_ONLY);
+
+	SplitTransition split;
+	split.resource = resource;
+	split.subresource = subresource;
+	split.stateBefore = current;
+	split.stateAfter = target;
+	tracker.splitTransitions.push_back(split);
+
+	// tracked as if it had ended already, anything that uses the resource ends it first
+	if (subresource == resourceStateAllSubresources) {
+		tracked.state = target;
+	}
+	else {
+		if (tracked.uniform) {
+			tracked.uniform = false;
+			tracked.subresourceStates.assign(tracked.subresourceCount, tracked.state);
+		}
+		tracked.subresourceStates[subresource] = target;
+		CollapseSubresourceStates(tracked);
+	}
+
+	return true;
+}
+
+void ResourceStateTrackerEndTransitions(ResourceStateTracker& tracker) {
+	while (!tracker.splitTransitions.empty())
+		EndSplitTransition(tracker, 0);
+}
+
+void ResourceStateTrackerFlush(ResourceStateTracker& tracker, ResourceBarrierFn recordBarriers, void* context) {
+	if (tracker.pendingBarriers.empty())
+		return;
+
+	recordBarriers(&tracker.pendingBarriers[0], (uint32_t)tracker.pendingBarriers.size(), context);
+
+	tracker.stats.barrierCount += tracker.pendingBarriers.size();
+	++tracker.stats.flushCount;
+	tracker.pendingBarriers.clear();
+}
+
+uint32_t ResourceStateTrackerGetState(const ResourceStateTracker& tracker, void* resource, uint32_t subresource) {
+	auto found = tracker.resources.find(resource);
+	if (found == tracker.resources.end())
+		return 0;
+
+	const TrackedResource& tracked = found->second;
+	if (tracked.uniform)
+		return tracked.state;
+
+	if (subresource == resourceStateAllSubresources || subresource >= tracked.subresourceCount)
+		subresource = 0;
+
+	return tracked.subresourceStates[subresource];
+}
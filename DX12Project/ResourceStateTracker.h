@@ -0,0 +1,107 @@
+#pragma once
+
+// keeps the state of every subresource of the resources it knows about, so barriers do not have to be written by hand
+// callers say which state a resource has to be in next, the tracker works out the transition and queues it,
+// and a flush hands everything queued to the command list in one ResourceBarrier call
+// a transition queued twice before a flush is merged into one (A to B then B to C becomes A to C, A to B to A
+// disappears), and a read state that already covers the requested one needs no barrier at all
+// split barriers let the gpu start a transition early and only wait for it where the result is needed
+//
+// states are the bits of D3D12_RESOURCE_STATES and resources are opaque pointers, so this has no d3d12 dependency
+// and the barriers can be checked against a recording callback instead of a command list
+// state is tracked in recording order, so lists that use the tracker have to be executed in the order their
+// barriers were flushed in. not thread safe
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// same as D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES
+const uint32_t resourceStateAllSubresources = 0xffffffff;
+
+// same as D3D12_RESOURCE_BARRIER_FLAGS
+enum ResourceBarrierFlag {
+	RESOURCE_BARRIER_FLAG_NONE = 0,
+	RESOURCE_BARRIER_FLAG_BEGIN_ONLY = 1,
+	RESOURCE_BARRIER_FLAG_END_ONLY = 2,
+};
+
+struct ResourceStateBarrier {
+	void* resource;
+	uint32_t subresource;
+	uint32_t stateBefore;
+	uint32_t stateAfter;
+	ResourceBarrierFlag flag;
+};
+
+// called once per flush with at least one barrier
+typedef void (*ResourceBarrierFn)(const ResourceStateBarrier* barriers, uint32_t count, void* context);
+
+struct TrackedResource {
+	uint32_t subresourceCount;
+	// every subresource is in state while uniform, otherwise they are in subresourceStates
+	bool uniform;
+	uint32_t state;
+	std::vector<uint32_t> subresourceStates;
+};
+
+// a split barrier that was begun and not ended yet
+struct SplitTransition {
+	void* resource;
+	uint32_t subresource;
+	uint32_t stateBefore;
+	uint32_t stateAfter;
+};
+
+struct ResourceStateTrackerStats {
+	// transitions asked for, barriers that reached a command list, and ResourceBarrier calls
+	uint64_t requestedTransitionCount;
+	uint64_t barrierCount;
+	uint64_t flushCount;
+	// requests that needed no barrier, and queued barriers that were merged away before a flush
+	uint64_t skippedTransitionCount;
+	uint64_t mergedBarrierCount;
+};
+
+struct ResourceStateTracker {
+	// states that only read, any mix of them can be combined in one state
+	uint32_t readStates;
+
+	std::unordered_map<void*, TrackedResource> resources;
+
+	// queued since the last flush, in order
+	std::vector<ResourceStateBarrier> pendingBarriers;
+	std::vector<SplitTransition> splitTransitions;
+
+	ResourceStateTrackerStats stats;
+};
+
+void ResourceStateTrackerInit(ResourceStateTracker& tracker, uint32_t readStates);
+
+// the resource has to be in initialState on the gpu when the next flushed barriers execute
+void ResourceStateTrackerRegister(ResourceStateTracker& tracker, void* resource, uint32_t subresourceCount, uint32_t initialState);
+
+// drops the resource and anything queued for it
+void ResourceStateTrackerUnregister(ResourceStateTracker& tracker, void* resource);
+
+// queues whatever is needed to get the subresource (or all of them) into state
+// ends a split transition of the resource first, returns false if the resource is not registered
+bool ResourceStateTrackerTransition(ResourceStateTracker& tracker, void* resource, uint32_t subresource, uint32_t state);
+
+// same for every subresource, but into exactly state, never a combined read state that covers it
+// for handing a resource back in the state it is expected in
+bool ResourceStateTrackerRestore(ResourceStateTracker& tracker, void* resource, uint32_t state);
+
+// queues the begin half of a split barrier, the resource cannot be used in either state until it is ended
+bool ResourceStateTrackerBeginTransition(ResourceStateTracker& tracker, void* resource, uint32_t subresource, uint32_t state);
+
+// queues the end half of every split barrier that was begun
+void ResourceStateTrackerEndTransitions(ResourceStateTracker& tracker);
+
+// hands every queued barrier to recordBarriers in one call, nothing happens if none are queued
+void ResourceStateTrackerFlush(ResourceStateTracker& tracker, ResourceBarrierFn recordBarriers, void* context);
+
+// state the subresource is in once the barriers queued so far executed, 0 (common) if the resource is unknown
+// for all subresources, the state of the first one
+uint32_t ResourceStateTrackerGetState(const ResourceStateTracker& tracker, void* resource, uint32_t subresource);
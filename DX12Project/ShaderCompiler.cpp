@@ -0,0 +1,104 @@
+#include "ShaderCompiler.h"
+
+#include <string>
+#include <vector>
+
+#define SAFE_RELEASE(x) if( x ) { x->Release(); x = NULL; }
+
+static std::wstring Widen(const char* text) {
+	int length = MultiByteToWideChar(CP_UTF8, 0, text, -1, NULL, 0);
+	if (length <= 1)
+		return std::wstring();
+
+	std::wstring wide(length - 1, L'\0');
+	MultiByteToWideChar(CP_UTF8, 0, text, -1, &wide[0], length);
+	return wide;
+}
+
+bool ShaderCompilerInit(ShaderCompiler& compiler) {
+	compiler.library = NULL;
+	compiler.utils = NULL;
+	compiler.compiler = NULL;
+	compiler.includeHandler = NULL;
+
+	compiler.library = LoadLibraryW(L"dxcompiler.dll");
+	if (compiler.library == NULL)
+		return false;
+
+	DxcCreateInstanceProc createInstance = (DxcCreateInstanceProc)GetProcAddress(compiler.library, "DxcCreateInstance");
+	if (createInstance == NULL ||
+		FAILED(createInstance(CLSID_DxcUtils, IID_PPV_ARGS(&compiler.utils))) ||
+		FAILED(createInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&compiler.compiler))) ||
+		FAILED(compiler.utils->CreateDefaultIncludeHandler(&compiler.includeHandler))) {
+		ShaderCompilerShutdown(compiler);
+		return false;
+	}
+
+	return true;
+}
+
+HRESULT ShaderCompilerCompileFromFile(ShaderCompiler& compiler, LPCWSTR filename, const D3D_SHADER_MACRO* defines, LPCWSTR entryPoint, LPCWSTR target,
+	IDxcBlob** code, IDxcBlob** errors) {
+	*code = NULL;
+	if (errors != NULL)
+		*errors = NULL;
+
+	IDxcBlobEncoding* source;
+	HRESULT hr = compiler.utils->LoadFile(filename, NULL, &source);
+	if (FAILED(hr))
+		return hr;
+
+	// kept alive until the compile is done, the arguments point into them
+	std::vector<std::wstring> defineArguments;
+	for (const D3D_SHADER_MACRO* define = defines; define != NULL && define->Name != NULL; ++define)
+		defineArguments.push_back(Widen(define->Name) + L"=" + Widen(define->Definition != NULL ? define->Definition : "1"));
+
+	std::vector<LPCWSTR> arguments = { filename, L"-E", entryPoint, L"-T", target, DXC_ARG_DEBUG, DXC_ARG_SKIP_OPTIMIZATIONS, L"-Qembed_debug" };
+	for (const std::wstring& define : defineArguments) {
+		arguments.push_back(L"-D");
+		arguments.push_back(define.c_str());
+	}
+
+	DxcBuffer sourceBuffer;
+	sourceBuffer.Ptr = source->GetBufferPointer();
+	sourceBuffer.Size = source->GetBufferSize();
+	sourceBuffer.Encoding = DXC_CP_ACP;
+
+	IDxcResult* result;
+	hr = compiler.compiler->Compile(&sourceBuffer, &arguments[0], (UINT32)arguments.size(), compiler.includeHandler, IID_PPV_ARGS(&result));
+	source->Release();
+	if (FAILED(hr))
+		return hr;
+
+	// warnings come back even when the compile worked
+	if (errors != NULL && result->HasOutput(DXC_OUT_ERRORS)) {
+		IDxcBlobUtf8* messages;
+		if (SUCCEEDED(result->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&messages), NULL))) {
+			if (messages->GetStringLength() > 0)
+				*errors = messages;
+			else
+				messages->Release();
+		}
+	}
+
+	HRESULT status;
+	hr = result->GetStatus(&status);
+	if (SUCCEEDED(hr))
+		hr = status;
+	if (SUCCEEDED(hr))
+		hr = result->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(code), NULL);
+
+	result->Release();
+	return hr;
+}
+
+void ShaderCompilerShutdown(ShaderCompiler& compiler) {
+	SAFE_RELEASE(compiler.includeHandler);
+	SAFE_RELEASE(compiler.compiler);
+	SAFE_RELEASE(compiler.utils);
+
+	if (compiler.library != NULL) {
+		FreeLibrary(compiler.library);
+		compiler.library = NULL;
+	}
+}
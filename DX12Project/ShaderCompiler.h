@@ -0,0 +1,30 @@
+#pragma once
+
+// shader model 6 compilation through dxcompiler.dll, d3dcompiler stops at 5.1 and mesh shaders need 6.5
+// the dll is loaded at runtime so the app still starts without it, only what needs shader model 6 is left out then
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#include <windows.h>
+#include <d3d12.h>
+#include <dxcapi.h>
+
+struct ShaderCompiler {
+	HMODULE library;
+	IDxcUtils* utils;
+	IDxcCompiler3* compiler;
+	IDxcIncludeHandler* includeHandler;
+};
+
+// false if dxcompiler.dll is missing or too old
+bool ShaderCompilerInit(ShaderCompiler& compiler);
+
+// like D3DCompileFromFile with D3D_COMPILE_STANDARD_FILE_INCLUDE, debug info and no optimization
+// defines end with a null name, errors is set to the compiler's messages if there are any
+HRESULT ShaderCompilerCompileFromFile(ShaderCompiler& compiler, LPCWSTR filename, const D3D_SHADER_MACRO* defines, LPCWSTR entryPoint, LPCWSTR target,
+	IDxcBlob** code, IDxcBlob** errors);
+
+// safe to call if init failed
+void ShaderCompilerShutdown(ShaderCompiler& compiler);
@@ -0,0 +1,696 @@
+#include "SoftwareRasterizer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SOFTWARE_RASTERIZER_SSE
+#endif
+
+// triangles per front end thread below which starting another thread is not worth it
+const uint64_t minTrianglesPerThread = 1024;
+
+// vertices are snapped to 1/16 of a pixel
+const int32_t subpixelScale = 16;
+const int32_t halfPixel = subpixelScale / 2;
+
+// edge functions start every block of pixels with a 64 bit value clamped to blockEdgeLimit and step through it
+// with 32 bits. the guard band keeps a step below 2^21 and the steps of a block below 2^25, so a clamped start
+// stays positive over the whole block and nothing overflows
+const int32_t blockSize = 8;
+const int64_t blockEdgeLimit = (int64_t)1 << 29;
+
+// pixels from the center of the viewport, beyond them triangles are clipped
+const float guardBand = (float)softwareMaxTargetSize;
+
+const int clipPlaneCount = 6;
+// a triangle clipped by every plane has at most this many corners
+const int maxClipVertices = 3 + clipPlaneCount;
+
+const uint32_t vertexCacheEmpty = 0xffffffff;
+
+static const uint32_t maskBitCounts[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+struct ClipVertex {
+	float position[4];
+	float varyings[softwareMaxVaryings];
+};
+
+// calls function(index) for every index below count, the calling thread takes the last one
+template <typename Function>
+static void ParallelFor(int count, Function function) {
+	std::vector<std::thread> threads;
+	for (int i = 0; i < count - 1; ++i)
+		threads.push_back(std::thread(function, i));
+
+	function(count - 1);
+
+	for (size_t t = 0; t < threads.size(); ++t)
+		threads[t].join();
+}
+
+// rounding towards negative infinity, pixel coordinates can be negative
+static int32_t FloorDivide(int32_t value, int32_t divisor) {
+	int32_t quotient = value / divisor;
+	return quotient * divisor > value ? quotient - 1 : quotient;
+}
+
+void SoftwareTextureInit(SoftwareTexture& texture, uint32_t width, uint32_t height) {
+	texture.width = width;
+	texture.height = height;
+	texture.pixels.assign((size_t)width * height, 0);
+}
+
+void SoftwareTextureClear(SoftwareTexture& texture, uint32_t color) {
+	std::fill(texture.pixels.begin(), texture.pixels.end(), color);
+}
+
+void SoftwareDepthBufferInit(SoftwareDepthBuffer& depthBuffer, uint32_t width, uint32_t height) {
+	depthBuffer.width = width;
+	depthBuffer.height = height;
+	depthBuffer.depth.assign((size_t)width * height, 1.0f);
+}
+
+void SoftwareDepthBufferClear(SoftwareDepthBuffer& depthBuffer, float depth) {
+	std::fill(depthBuffer.depth.begin(), depthBuffer.depth.end(), depth);
+}
+
+uint32_t SoftwarePackColor(const float color[4]) {
+	uint32_t packed = 0;
+	for (int i = 0; i < 4; ++i) {
+		float c = color[i] < 0.0f ? 0.0f : color[i] > 1.0f ? 1.0f : color[i];
+		packed |= (uint32_t)(c * 255.0f + 0.5f) << (i * 8);
+	}
+	return packed;
+}
+
+void SoftwareRasterizerInit(SoftwareRasterizer& rasterizer, int threadCount) {
+	rasterizer.threadCount = threadCount < 1 ? 1 : threadCount;
+	rasterizer.renderTarget = nullptr;
+	rasterizer.depthBuffer = nullptr;
+	rasterizer.targetWidth = 0;
+	rasterizer.targetHeight = 0;
+	rasterizer.tileCountX = 0;
+	rasterizer.tileCountY = 0;
+	rasterizer.draws.clear();
+	rasterizer.drawTriangles.clear();
+	rasterizer.frontEnds.clear();
+	rasterizer.frontEnds.resize(rasterizer.threadCount);
+	memset(&rasterizer.stats, 0, sizeof(rasterizer.stats));
+}
+
+void SoftwareRasterizerSetTargets(SoftwareRasterizer& rasterizer, SoftwareTexture* renderTarget, SoftwareDepthBuffer* depthBuffer) {
+	if (renderTarget == rasterizer.renderTarget && depthBuffer == rasterizer.depthBuffer)
+		return;
+
+	SoftwareRasterizerFlush(rasterizer);
+
+	rasterizer.renderTarget = renderTarget;
+	rasterizer.depthBuffer = depthBuffer;
+	rasterizer.targetWidth = renderTarget != nullptr ? renderTarget->width : depthBuffer != nullptr ? depthBuffer->width : 0;
+	rasterizer.targetHeight = renderTarget != nullptr ? renderTarget->height : depthBuffer != nullptr ? depthBuffer->height : 0;
+	rasterizer.tileCountX = (rasterizer.targetWidth + softwareTileSize - 1) / softwareTileSize;
+	rasterizer.tileCountY = (rasterizer.targetHeight + softwareTileSize - 1) / softwareTileSize;
+
+	for (SoftwareFrontEnd& frontEnd : rasterizer.frontEnds)
+		frontEnd.bins.resize(rasterizer.tileCountX * rasterizer.tileCountY);
+}
+
+void SoftwareRasterizerDraw(SoftwareRasterizer& rasterizer, const SoftwareDraw& draw) {
+	if (draw.pipeline == nullptr || rasterizer.targetWidth == 0 || rasterizer.targetHeight == 0)
+		return;
+	if (draw.indexCount < 3 || draw.instanceCount == 0 || !(draw.viewport.width > 0.0f) || !(draw.viewport.height > 0.0f))
+		return;
+
+	// the guard band only keeps the edge functions in range for viewports that fit it
+	const RenderViewport& viewport = draw.viewport;
+	float maxSize = (float)softwareMaxTargetSize;
+	if (viewport.width > maxSize || viewport.height > maxSize || fabsf(viewport.x) > maxSize || fabsf(viewport.y) > maxSize)
+		return;
+
+	if (rasterizer.drawTriangles.empty())
+		rasterizer.drawTriangles.push_back(0);
+
+	uint64_t triangleCount = (uint64_t)(draw.indexCount / 3) * draw.instanceCount;
+	rasterizer.draws.push_back(draw);
+	rasterizer.drawTriangles.push_back(rasterizer.drawTriangles.back() + triangleCount);
+}
+
+// front end
+
+// how far in front of a plane the position is, x and y are clipped against the guard band
+static float GetPlaneDistance(const ClipVertex& vertex, int plane, float guardX, float guardY) {
+	const float* p = vertex.position;
+	switch (plane) {
+	case 0: return p[2];
+	case 1: return p[3] - p[2];
+	case 2: return guardX * p[3] + p[0];
+	case 3: return guardX * p[3] - p[0];
+	case 4: return guardY * p[3] + p[1];
+	default: return guardY * p[3] - p[1];
+	}
+}
+
+// always from the vertex in front of the plane, so the neighbours of an edge get the same point
+static void LerpClipVertex(const ClipVertex& inside, const ClipVertex& outside, float t, uint32_t varyingCount, ClipVertex& output) {
+	for (int i = 0; i < 4; ++i)
+		output.position[i] = inside.position[i] + (outside.position[i] - inside.position[i]) * t;
+	for (uint32_t i = 0; i < varyingCount; ++i)
+		output.varyings[i] = inside.varyings[i] + (outside.varyings[i] - inside.varyings[i]) * t;
+}
+
+// sutherland hodgman against one plane, returns the corners left
+static int ClipPolygon(const ClipVertex* input, int count, int plane, float guardX, float guardY, uint32_t varyingCount, ClipVertex* output) {
+	int outputCount = 0;
+	for (int i = 0; i < count; ++i) {
+		const ClipVertex& a = input[i];
+		const ClipVertex& b = input[(i + 1) % count];
+		float distanceA = GetPlaneDistance(a, plane, guardX, guardY);
+		float distanceB = GetPlaneDistance(b, plane, guardX, guardY);
+
+		if (distanceA >= 0.0f)
+			output[outputCount++] = a;
+
+		if ((distanceA >= 0.0f) != (distanceB >= 0.0f)) {
+			if (distanceA >= 0.0f)
+				LerpClipVertex(a, b, distanceA / (distanceA - distanceB), varyingCount, output[outputCount++]);
+			else
+				LerpClipVertex(b, a, distanceB / (distanceB - distanceA), varyingCount, output[outputCount++]);
+		}
+	}
+	return outputCount;
+}
+
+// snaps, culls and sets up a triangle and adds it to the bins of the tiles its bounds touch
+static void SetupTriangle(SoftwareRasterizer& rasterizer, SoftwareFrontEnd& frontEnd, const SoftwareDraw& draw, uint32_t drawIndex, const ClipVertex* vertices[3]) {
+	const RenderViewport& viewport = draw.viewport;
+	const SoftwarePipeline& pipeline = *draw.pipeline;
+
+	int32_t x[3], y[3];
+	float depth[3], invW[3];
+	for (int i = 0; i < 3; ++i) {
+		const float* position = vertices[i]->position;
+		if (!(position[3] > 0.0f)) {
+			frontEnd.culledTriangleCount++;
+			return;
+		}
+
+		invW[i] = 1.0f / position[3];
+		float screenX = viewport.x + (position[0] * invW[i] * 0.5f + 0.5f) * viewport.width;
+		float screenY = viewport.y + (0.5f - position[1] * invW[i] * 0.5f) * viewport.height;
+		x[i] = (int32_t)floorf(screenX * subpixelScale + 0.5f);
+		y[i] = (int32_t)floorf(screenY * subpixelScale + 0.5f);
+		depth[i] = viewport.minDepth + position[2] * invW[i] * (viewport.maxDepth - viewport.minDepth);
+	}
+
+	// positive for clockwise triangles, y points down
+	int64_t area = (int64_t)(x[1] - x[0]) * (y[2] - y[0]) - (int64_t)(y[1] - y[0]) * (x[2] - x[0]);
+	if (area == 0 || (area < 0 && pipeline.cullMode == SOFTWARE_CULL_BACK) || (area > 0 && pipeline.cullMode == SOFTWARE_CULL_FRONT)) {
+		frontEnd.culledTriangleCount++;
+		return;
+	}
+
+	// counterclockwise triangles are turned around so every edge function is positive inside
+	int order[3] = { 0, 1, 2 };
+	if (area < 0) {
+		order[1] = 2;
+		order[2] = 1;
+		area = -area;
+	}
+
+	int32_t minX = std::min(x[0], std::min(x[1], x[2]));
+	int32_t minY = std::min(y[0], std::min(y[1], y[2]));
+	int32_t maxX = std::max(x[0], std::max(x[1], x[2]));
+	int32_t maxY = std::max(y[0], std::max(y[1], y[2]));
+
+	// pixels whose centers are within the bounds
+	SoftwareTriangle triangle;
+	triangle.minX = std::max(-FloorDivide(halfPixel - minX, subpixelScale), std::max(draw.scissorRect.left, 0));
+	triangle.minY = std::max(-FloorDivide(halfPixel - minY, subpixelScale), std::max(draw.scissorRect.top, 0));
+	triangle.maxX = std::min(FloorDivide(maxX - halfPixel, subpixelScale) + 1, std::min(draw.scissorRect.right, (int32_t)rasterizer.targetWidth));
+	triangle.maxY = std::min(FloorDivide(maxY - halfPixel, subpixelScale) + 1, std::min(draw.scissorRect.bottom, (int32_t)rasterizer.targetHeight));
+	if (triangle.minX >= triangle.maxX || triangle.minY >= triangle.maxY) {
+		frontEnd.culledTriangleCount++;
+		return;
+	}
+
+	// the edge opposite of vertex i, from vertex i + 1 to i + 2
+	for (int i = 0; i < 3; ++i) {
+		int a = order[(i + 1) % 3];
+		int b = order[(i + 2) % 3];
+		int32_t dx = x[b] - x[a];
+		int32_t dy = y[b] - y[a];
+		triangle.edgeA[i] = -dy;
+		triangle.edgeB[i] = dx;
+		triangle.edgeC[i] = -((int64_t)triangle.edgeA[i] * x[a] + (int64_t)triangle.edgeB[i] * y[a]);
+
+		// top and left edges own the pixel centers right on them, the others do not
+		bool topLeft = dy < 0 || (dy == 0 && dx > 0);
+		if (!topLeft)
+			triangle.edgeC[i] -= 1;
+	}
+
+	triangle.invArea = 1.0f / (float)area;
+	int v0 = order[0], v1 = order[1], v2 = order[2];
+	triangle.depth[0] = depth[v0];
+	triangle.depth[1] = depth[v1] - depth[v0];
+	triangle.depth[2] = depth[v2] - depth[v0];
+	triangle.invW[0] = invW[v0];
+	triangle.invW[1] = invW[v1] - invW[v0];
+	triangle.invW[2] = invW[v2] - invW[v0];
+	for (uint32_t j = 0; j < pipeline.varyingCount; ++j) {
+		float value0 = vertices[v0]->varyings[j] * invW[v0];
+		triangle.varyings[j][0] = value0;
+		triangle.varyings[j][1] = vertices[v1]->varyings[j] * invW[v1] - value0;
+		triangle.varyings[j][2] = vertices[v2]->varyings[j] * invW[v2] - value0;
+	}
+	triangle.draw = drawIndex;
+
+	uint32_t triangleIndex = (uint32_t)frontEnd.triangles.size();
+	frontEnd.triangles.push_back(triangle);
+
+	uint32_t firstTileX = triangle.minX / softwareTileSize;
+	uint32_t firstTileY = triangle.minY / softwareTileSize;
+	uint32_t lastTileX = (triangle.maxX - 1) / softwareTileSize;
+	uint32_t lastTileY = (triangle.maxY - 1) / softwareTileSize;
+	for (uint32_t tileY = firstTileY; tileY <= lastTileY; ++tileY) {
+		for (uint32_t tileX = firstTileX; tileX <= lastTileX; ++tileX)
+			frontEnd.bins[tileY * rasterizer.tileCountX + tileX].push_back(triangleIndex);
+	}
+}
+
+static uint32_t GetIndex(const SoftwareDraw& draw, uint32_t i) {
+	if (draw.indexSize == 2) {
+		uint16_t index;
+		memcpy(&index, draw.indices + (size_t)i * 2, 2);
+		return index;
+	}
+
+	uint32_t index;
+	memcpy(&index, draw.indices + (size_t)i * 4, 4);
+	return index;
+}
+
+// false if the vertex is outside of the vertex buffer
+static bool ShadeVertex(SoftwareFrontEnd& frontEnd, const SoftwareDraw& draw, uint32_t index, uint32_t instance, ClipVertex& output) {
+	int64_t vertex = (int64_t)index + draw.baseVertex;
+	if (vertex < 0 || vertex >= draw.vertexCount)
+		return false;
+
+	SoftwareVertexCacheEntry& entry = frontEnd.vertexCache[vertex % softwareVertexCacheSize];
+	if (entry.vertex != (uint32_t)vertex) {
+		entry.vertex = (uint32_t)vertex;
+		memset(entry.varyings, 0, sizeof(entry.varyings));
+		draw.pipeline->vertexShader(draw.vertices + (size_t)vertex * draw.vertexStride, instance, draw.pipeline->shaderData, draw.bindings, entry.position, entry.varyings);
+	}
+
+	memcpy(output.position, entry.position, sizeof(output.position));
+	memcpy(output.varyings, entry.varyings, sizeof(output.varyings));
+	return true;
+}
+
+static void ProcessTriangle(SoftwareRasterizer& rasterizer, SoftwareFrontEnd& frontEnd, const SoftwareDraw& draw, uint32_t drawIndex, const ClipVertex* corners[3]) {
+	float guardX = guardBand / (draw.viewport.width * 0.5f);
+	float guardY = guardBand / (draw.viewport.height * 0.5f);
+
+	uint32_t outsideAll = 0x3f, outsideAny = 0;
+	for (int i = 0; i < 3; ++i) {
+		uint32_t outside = 0;
+		for (int plane = 0; plane < clipPlaneCount; ++plane) {
+			if (GetPlaneDistance(*corners[i], plane, guardX, guardY) < 0.0f)
+				outside |= 1u << plane;
+		}
+		outsideAll &= outside;
+		outsideAny |= outside;
+	}
+
+	if (outsideAll != 0) {
+		frontEnd.culledTriangleCount++;
+		return;
+	}
+
+	if (outsideAny == 0) {
+		SetupTriangle(rasterizer, frontEnd, draw, drawIndex, corners);
+		return;
+	}
+
+	frontEnd.clippedTriangleCount++;
+
+	ClipVertex polygon[2][maxClipVertices];
+	int count = 3;
+	for (int i = 0; i < 3; ++i)
+		polygon[0][i] = *corners[i];
+
+	int current = 0;
+	for (int plane = 0; plane < clipPlaneCount && count >= 3; ++plane) {
+		if (!(outsideAny & (1u << plane)))
+			continue;
+		count = ClipPolygon(polygon[current], count, plane, guardX, guardY, draw.pipeline->varyingCount, polygon[1 - current]);
+		current = 1 - current;
+	}
+
+	// a fan keeps the winding
+	for (int i = 1; i + 1 < count; ++i) {
+		const ClipVertex* fan[3] = { &polygon[current][0], &polygon[current][i], &polygon[current][i + 1] };
+		SetupTriangle(rasterizer, frontEnd, draw, drawIndex, fan);
+	}
+}
+
+static void RunFrontEnd(SoftwareRasterizer& rasterizer, SoftwareFrontEnd& frontEnd, uint64_t first, uint64_t last) {
+	if (first >= last)
+		return;
+
+	const std::vector<uint64_t>& drawTriangles = rasterizer.drawTriangles;
+	uint32_t drawIndex = (uint32_t)(std::upper_bound(drawTriangles.begin(), drawTriangles.end(), first) - drawTriangles.begin()) - 1;
+
+	uint64_t triangle = first;
+	while (triangle < last) {
+		const SoftwareDraw& draw = rasterizer.draws[drawIndex];
+		uint32_t trianglesPerInstance = draw.indexCount / 3;
+		uint64_t drawLast = std::min(last, drawTriangles[drawIndex + 1]);
+		uint32_t cachedInstance = vertexCacheEmpty;
+
+		for (; triangle < drawLast; ++triangle) {
+			uint64_t local = triangle - drawTriangles[drawIndex];
+			uint32_t instance = draw.startInstance + (uint32_t)(local / trianglesPerInstance);
+			uint32_t firstIndex = (uint32_t)(local % trianglesPerInstance) * 3;
+
+			// cached vertices belong to one draw and instance
+			if (instance != cachedInstance) {
+				for (SoftwareVertexCacheEntry& entry : frontEnd.vertexCache)
+					entry.vertex = vertexCacheEmpty;
+				cachedInstance = instance;
+			}
+
+			ClipVertex corners[3];
+			bool valid = true;
+			for (int i = 0; i < 3 && valid; ++i)
+				valid = ShadeVertex(frontEnd, draw, GetIndex(draw, firstIndex + i), instance, corners[i]);
+
+			const ClipVertex* triangleCorners[3] = { &corners[0], &corners[1], &corners[2] };
+			if (!valid)
+				frontEnd.culledTriangleCount++;
+			else
+				ProcessTriangle(rasterizer, frontEnd, draw, drawIndex, triangleCorners);
+		}
+
+		drawIndex++;
+	}
+}
+
+// back end
+
+#ifdef SOFTWARE_RASTERIZER_SSE
+static __m128 Interpolate(const float plane[3], __m128 weight1, __m128 weight2) {
+	return _mm_add_ps(_mm_add_ps(_mm_set1_ps(plane[0]), _mm_mul_ps(weight1, _mm_set1_ps(plane[1]))), _mm_mul_ps(weight2, _mm_set1_ps(plane[2])));
+}
+
+// shades the pixels in mask of the four starting at x with the weights of vertices 1 and 2, returns how many passed
+// the depth test
+static uint32_t ShadeQuad(const SoftwareRasterizer& rasterizer, const SoftwareTriangle& triangle, const SoftwareDraw& draw, int32_t x, int32_t y, __m128 weight1, __m128 weight2, uint32_t mask) {
+	const SoftwarePipeline& pipeline = *draw.pipeline;
+
+	// the last quad of a row can stick out of the target
+	uint32_t laneCount = std::min<uint32_t>(4, rasterizer.targetWidth - x);
+	size_t pixel = (size_t)y * rasterizer.targetWidth + x;
+
+	SoftwareDepthBuffer* depthBuffer = rasterizer.depthBuffer;
+	if (depthBuffer != nullptr && (pipeline.depthTest || pipeline.depthWrite)) {
+		float minDepth = std::min(draw.viewport.minDepth, draw.viewport.maxDepth);
+		float maxDepth = std::max(draw.viewport.minDepth, draw.viewport.maxDepth);
+		__m128 depth = _mm_min_ps(_mm_max_ps(Interpolate(triangle.depth, weight1, weight2), _mm_set1_ps(minDepth)), _mm_set1_ps(maxDepth));
+
+		float* row = &depthBuffer->depth[pixel];
+		float stored[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		memcpy(stored, row, laneCount * sizeof(float));
+		__m128 storedDepth = _mm_loadu_ps(stored);
+
+		if (pipeline.depthTest)
+			mask &= (uint32_t)_mm_movemask_ps(_mm_cmplt_ps(depth, storedDepth));
+		if (mask == 0)
+			return 0;
+
+		if (pipeline.depthWrite) {
+			__m128 select = _mm_castsi128_ps(_mm_cmpgt_epi32(_mm_and_si128(_mm_set1_epi32((int)mask), _mm_set_epi32(8, 4, 2, 1)), _mm_setzero_si128()));
+			__m128 written = _mm_or_ps(_mm_and_ps(select, depth), _mm_andnot_ps(select, storedDepth));
+			if (laneCount == 4) {
+				_mm_storeu_ps(row, written);
+			}
+			else {
+				_mm_storeu_ps(stored, written);
+				memcpy(row, stored, laneCount * sizeof(float));
+			}
+		}
+	}
+
+	SoftwareTexture* renderTarget = rasterizer.renderTarget;
+	if (renderTarget != nullptr && pipeline.pixelShader != nullptr) {
+		// back from the values divided by w
+		__m128 w = _mm_div_ps(_mm_set1_ps(1.0f), Interpolate(triangle.invW, weight1, weight2));
+
+		SoftwarePixelQuad quad;
+		for (uint32_t j = 0; j < pipeline.varyingCount; ++j)
+			_mm_storeu_ps(quad.varyings[j], _mm_mul_ps(Interpolate(triangle.varyings[j], weight1, weight2), w));
+		quad.mask = mask;
+
+		uint32_t colors[4];
+		pipeline.pixelShader(quad, pipeline.shaderData, draw.bindings, colors);
+
+		uint32_t* row = &renderTarget->pixels[pixel];
+		if (mask == 0xf) {
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(row), _mm_loadu_si128(reinterpret_cast<const __m128i*>(colors)));
+		}
+		else {
+			for (uint32_t lane = 0; lane < laneCount; ++lane) {
+				if (mask & (1u << lane))
+					row[lane] = colors[lane];
+			}
+		}
+	}
+
+	return maskBitCounts[mask];
+}
+#else
+static float Interpolate(const float plane[3], float weight1, float weight2) {
+	return plane[0] + weight1 * plane[1] + weight2 * plane[2];
+}
+
+// the same as the sse version a lane at a time
+static uint32_t ShadeQuad(const SoftwareRasterizer& rasterizer, const SoftwareTriangle& triangle, const SoftwareDraw& draw, int32_t x, int32_t y, const float weight1[4], const float weight2[4], uint32_t mask) {
+	const SoftwarePipeline& pipeline = *draw.pipeline;
+
+	uint32_t laneCount = std::min<uint32_t>(4, rasterizer.targetWidth - x);
+	size_t pixel = (size_t)y * rasterizer.targetWidth + x;
+
+	SoftwareDepthBuffer* depthBuffer = rasterizer.depthBuffer;
+	if (depthBuffer != nullptr && (pipeline.depthTest || pipeline.depthWrite)) {
+		float minDepth = std::min(draw.viewport.minDepth, draw.viewport.maxDepth);
+		float maxDepth = std::max(draw.viewport.minDepth, draw.viewport.maxDepth);
+		float* row = &depthBuffer->depth[pixel];
+
+		for (uint32_t lane = 0; lane < laneCount; ++lane) {
+			if (!(mask & (1u << lane)))
+				continue;
+
+			float depth = std::min(std::max(Interpolate(triangle.depth, weight1[lane], weight2[lane]), minDepth), maxDepth);
+			if (pipeline.depthTest && !(depth < row[lane])) {
+				mask &= ~(1u << lane);
+				continue;
+			}
+			if (pipeline.depthWrite)
+				row[lane] = depth;
+		}
+
+		if (mask == 0)
+			return 0;
+	}
+
+	SoftwareTexture* renderTarget = rasterizer.renderTarget;
+	if (renderTarget != nullptr && pipeline.pixelShader != nullptr) {
+		SoftwarePixelQuad quad;
+		for (int lane = 0; lane < 4; ++lane) {
+			float w = 1.0f / Interpolate(triangle.invW, weight1[lane], weight2[lane]);
+			for (uint32_t j = 0; j < pipeline.varyingCount; ++j)
+				quad.varyings[j][lane] = Interpolate(triangle.varyings[j], weight1[lane], weight2[lane]) * w;
+		}
+		quad.mask = mask;
+
+		uint32_t colors[4];
+		pipeline.pixelShader(quad, pipeline.shaderData, draw.bindings, colors);
+
+		uint32_t* row = &renderTarget->pixels[pixel];
+		for (uint32_t lane = 0; lane < laneCount; ++lane) {
+			if (mask & (1u << lane))
+				row[lane] = colors[lane];
+		}
+	}
+
+	return maskBitCounts[mask];
+}
+#endif
+
+// the part of the triangle inside the tile, in blocks whose edge functions start from 64 bit values
+static uint64_t RasterizeTriangle(const SoftwareRasterizer& rasterizer, const SoftwareTriangle& triangle, int32_t tileX, int32_t tileY) {
+	const SoftwareDraw& draw = rasterizer.draws[triangle.draw];
+	int32_t minX = std::max(triangle.minX, tileX);
+	int32_t minY = std::max(triangle.minY, tileY);
+	int32_t maxX = std::min(triangle.maxX, tileX + (int32_t)softwareTileSize);
+	int32_t maxY = std::min(triangle.maxY, tileY + (int32_t)softwareTileSize);
+
+	// edge function steps of a pixel, and the same for the weights of vertices 1 and 2
+	int32_t stepX[3], stepY[3];
+	float weightStepX[3], weightStepY[3];
+	for (int i = 0; i < 3; ++i) {
+		stepX[i] = triangle.edgeA[i] * subpixelScale;
+		stepY[i] = triangle.edgeB[i] * subpixelScale;
+		weightStepX[i] = (float)stepX[i] * triangle.invArea;
+		weightStepY[i] = (float)stepY[i] * triangle.invArea;
+	}
+
+#ifdef SOFTWARE_RASTERIZER_SSE
+	__m128i laneSteps[3];
+	__m128 laneWeightSteps[3];
+	for (int i = 0; i < 3; ++i) {
+		laneSteps[i] = _mm_set_epi32(stepX[i] * 3, stepX[i] * 2, stepX[i], 0);
+		laneWeightSteps[i] = _mm_set_ps(weightStepX[i] * 3.0f, weightStepX[i] * 2.0f, weightStepX[i], 0.0f);
+	}
+#endif
+
+	uint64_t pixelCount = 0;
+	for (int32_t blockY = minY & ~(blockSize - 1); blockY < maxY; blockY += blockSize) {
+		for (int32_t blockX = minX & ~(blockSize - 1); blockX < maxX; blockX += blockSize) {
+			// the clamp only keeps coverage right, the weights start from the exact value
+			int32_t start[3];
+			float startWeight[3];
+			bool outside = false;
+			for (int i = 0; i < 3 && !outside; ++i) {
+				int64_t value = (int64_t)triangle.edgeA[i] * (blockX * subpixelScale + halfPixel) + (int64_t)triangle.edgeB[i] * (blockY * subpixelScale + halfPixel) + triangle.edgeC[i];
+				int64_t blockMax = value + (int64_t)std::max(stepX[i], 0) * (blockSize - 1) + (int64_t)std::max(stepY[i], 0) * (blockSize - 1);
+				outside = blockMax < 0;
+				start[i] = (int32_t)std::min(value, blockEdgeLimit);
+				startWeight[i] = (float)value * triangle.invArea;
+			}
+			if (outside)
+				continue;
+
+			int32_t rowFirst = std::max(blockY, minY);
+			int32_t rowLast = std::min(blockY + blockSize, maxY);
+			for (int32_t y = rowFirst; y < rowLast; ++y) {
+				for (int32_t quadX = blockX; quadX < blockX + blockSize; quadX += 4) {
+					if (quadX >= maxX || quadX + 4 <= minX)
+						continue;
+
+					uint32_t laneMask = 0;
+					for (int lane = 0; lane < 4; ++lane)
+						laneMask |= (uint32_t)(quadX + lane >= minX && quadX + lane < maxX) << lane;
+
+					int32_t base[3];
+					float baseWeight[3];
+					for (int i = 0; i < 3; ++i) {
+						base[i] = start[i] + stepY[i] * (y - blockY) + stepX[i] * (quadX - blockX);
+						baseWeight[i] = startWeight[i] + weightStepY[i] * (float)(y - blockY) + weightStepX[i] * (float)(quadX - blockX);
+					}
+
+#ifdef SOFTWARE_RASTERIZER_SSE
+					__m128i edge0 = _mm_add_epi32(_mm_set1_epi32(base[0]), laneSteps[0]);
+					__m128i edge1 = _mm_add_epi32(_mm_set1_epi32(base[1]), laneSteps[1]);
+					__m128i edge2 = _mm_add_epi32(_mm_set1_epi32(base[2]), laneSteps[2]);
+					// a sign bit in any edge function is a lane outside
+					uint32_t outsideLanes = (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_or_si128(edge0, _mm_or_si128(edge1, edge2))));
+					uint32_t mask = laneMask & ~outsideLanes;
+					if (mask == 0)
+						continue;
+
+					__m128 weight1 = _mm_add_ps(_mm_set1_ps(baseWeight[1]), laneWeightSteps[1]);
+					__m128 weight2 = _mm_add_ps(_mm_set1_ps(baseWeight[2]), laneWeightSteps[2]);
+#else
+					uint32_t outsideLanes = 0;
+					for (int lane = 0; lane < 4; ++lane) {
+						int32_t edge0 = base[0] + stepX[0] * lane;
+						int32_t edge1 = base[1] + stepX[1] * lane;
+						int32_t edge2 = base[2] + stepX[2] * lane;
+						outsideLanes |= (uint32_t)((edge0 | edge1 | edge2) < 0) << lane;
+					}
+					uint32_t mask = laneMask & ~outsideLanes;
+					if (mask == 0)
+						continue;
+
+					float weight1[4], weight2[4];
+					for (int lane = 0; lane < 4; ++lane) {
+						weight1[lane] = baseWeight[1] + weightStepX[1] * (float)lane;
+						weight2[lane] = baseWeight[2] + weightStepX[2] * (float)lane;
+					}
+#endif
+					pixelCount += ShadeQuad(rasterizer, triangle, draw, quadX, y, weight1, weight2, mask);
+				}
+			}
+		}
+	}
+	return pixelCount;
+}
+
+// takes tiles until there are none left, every tile walks the bins of the front ends in order
+static void RunBackEnd(const SoftwareRasterizer& rasterizer, int frontEndCount, std::atomic<uint32_t>& nextTile, uint64_t& pixelCount) {
+	uint32_t tileCount = rasterizer.tileCountX * rasterizer.tileCountY;
+	for (uint32_t tile = nextTile++; tile < tileCount; tile = nextTile++) {
+		int32_t tileX = (int32_t)((tile % rasterizer.tileCountX) * softwareTileSize);
+		int32_t tileY = (int32_t)((tile / rasterizer.tileCountX) * softwareTileSize);
+
+		for (int f = 0; f < frontEndCount; ++f) {
+			const SoftwareFrontEnd& frontEnd = rasterizer.frontEnds[f];
+			for (uint32_t triangle : frontEnd.bins[tile])
+				pixelCount += RasterizeTriangle(rasterizer, frontEnd.triangles[triangle], tileX, tileY);
+		}
+	}
+}
+
+void SoftwareRasterizerFlush(SoftwareRasterizer& rasterizer) {
+	if (rasterizer.draws.empty())
+		return;
+
+	uint64_t triangleCount = rasterizer.drawTriangles.back();
+	uint64_t frontEndCount = triangleCount / minTrianglesPerThread;
+	if (frontEndCount < 1)
+		frontEndCount = 1;
+	if (frontEndCount > (uint64_t)rasterizer.threadCount)
+		frontEndCount = rasterizer.threadCount;
+
+	// contiguous ranges, the bins of front end 0 hold the first triangles
+	ParallelFor((int)frontEndCount, [&rasterizer, triangleCount, frontEndCount](int t) {
+		RunFrontEnd(rasterizer, rasterizer.frontEnds[t], triangleCount * t / frontEndCount, triangleCount * (t + 1) / frontEndCount);
+	});
+
+	uint32_t tileCount = rasterizer.tileCountX * rasterizer.tileCountY;
+	int backEndCount = std::max(1, std::min(rasterizer.threadCount, (int)tileCount));
+	std::atomic<uint32_t> nextTile(0);
+	std::vector<uint64_t> pixelCounts(backEndCount, 0);
+	ParallelFor(backEndCount, [&rasterizer, frontEndCount, &nextTile, &pixelCounts](int t) {
+		RunBackEnd(rasterizer, (int)frontEndCount, nextTile, pixelCounts[t]);
+	});
+
+	SoftwareRasterizerStats& stats = rasterizer.stats;
+	stats.triangleCount += triangleCount;
+	stats.flushCount++;
+	for (uint64_t pixelCount : pixelCounts)
+		stats.pixelCount += pixelCount;
+
+	for (uint64_t f = 0; f < frontEndCount; ++f) {
+		SoftwareFrontEnd& frontEnd = rasterizer.frontEnds[f];
+		stats.culledTriangleCount += frontEnd.culledTriangleCount;
+		stats.clippedTriangleCount += frontEnd.clippedTriangleCount;
+		stats.setupTriangleCount += frontEnd.triangles.size();
+		frontEnd.culledTriangleCount = 0;
+		frontEnd.clippedTriangleCount = 0;
+
+		frontEnd.triangles.clear();
+		for (std::vector<uint32_t>& bin : frontEnd.bins)
+			bin.clear();
+	}
+
+	rasterizer.draws.clear();
+	rasterizer.drawTriangles.clear();
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+// tiled software rasterizer behind the software render device
+// draws are only collected until a flush. the flush first runs the front end, vertex shading, clipping, triangle
+// setup and binning, on up to threadCount threads that each take a contiguous range of the triangles and bin them
+// into bins of their own. then the back end rasterizes a tile per thread at a time and walks the bins of the front
+// end threads in order, so every pixel sees its triangles in submission order and the image is the same whatever
+// the thread count
+// coverage is exact: vertices are snapped to 1/16 of a pixel and the edge functions are integers with the d3d top
+// left rule, evaluated for four pixels at once. depth is a D32 buffer with a less test, colors are RGBA8
+// no d3d12 dependency
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "RenderDevice.h"
+
+// pixels, the back end works on a tile at a time
+const uint32_t softwareTileSize = 64;
+
+// largest render target and viewport, what is outside of the guard band around it is clipped
+const uint32_t softwareMaxTargetSize = 4096;
+
+// floats the vertex shader passes to the pixel shader
+const uint32_t softwareMaxVaryings = 4;
+
+// RGBA8 with r in the low byte, DXGI_FORMAT_R8G8B8A8_UNORM in memory
+struct SoftwareTexture {
+	uint32_t width;
+	uint32_t height;
+	std::vector<uint32_t> pixels;
+};
+
+struct SoftwareDepthBuffer {
+	uint32_t width;
+	uint32_t height;
+	std::vector<float> depth;
+};
+
+// one vertex in, the clip space position and the varyings out
+typedef void (*SoftwareVertexShaderFn)(const uint8_t* vertex, uint32_t instance, const void* shaderData, const void* bindings, float position[4], float varyings[softwareMaxVaryings]);
+
+// four pixels side by side, lanes not in mask are not written whatever the shader returns for them
+struct SoftwarePixelQuad {
+	float varyings[softwareMaxVaryings][4];
+	uint32_t mask;
+};
+
+typedef void (*SoftwarePixelShaderFn)(const SoftwarePixelQuad& quad, const void* shaderData, const void* bindings, uint32_t colors[4]);
+
+enum SoftwareCullMode {
+	SOFTWARE_CULL_NONE,
+	SOFTWARE_CULL_BACK,
+	SOFTWARE_CULL_FRONT,
+};
+
+// what a pipeline state object is for the software device, set it with RenderCommandListSetPipelineState
+struct SoftwarePipeline {
+	SoftwareVertexShaderFn vertexShader;
+	SoftwarePixelShaderFn pixelShader;
+	// what the shaders take from the pipeline, the vertex layout for the renderer's shaders
+	const void* shaderData;
+	uint32_t varyingCount;
+	// clockwise triangles are the front faces, like the d3d12 default
+	SoftwareCullMode cullMode;
+	// less
+	bool depthTest;
+	bool depthWrite;
+};
+
+struct SoftwareDraw {
+	const SoftwarePipeline* pipeline;
+	// handed to the shaders as is, has to stay valid until the flush like everything the draw points at
+	const void* bindings;
+
+	const uint8_t* vertices;
+	uint32_t vertexStride;
+	// triangles with a vertex past it are dropped
+	uint32_t vertexCount;
+
+	// starting with the draw's first index
+	const uint8_t* indices;
+	// 2 or 4 bytes
+	uint32_t indexSize;
+	uint32_t indexCount;
+	int32_t baseVertex;
+	uint32_t instanceCount;
+	uint32_t startInstance;
+
+	RenderViewport viewport;
+	RenderRect scissorRect;
+};
+
+// one triangle after setup, only the rasterizer uses it
+struct SoftwareTriangle {
+	// edge functions a * x + b * y + c of 1/16 pixel coordinates, at least 0 inside
+	// the edge opposite of vertex i comes first, c already has the top left rule's bias
+	int32_t edgeA[3];
+	int32_t edgeB[3];
+	int64_t edgeC[3];
+	// pixels clipped to the scissor rectangle and the target, max exclusive
+	int32_t minX;
+	int32_t minY;
+	int32_t maxX;
+	int32_t maxY;
+
+	// value at vertex 0 and the differences to vertices 1 and 2, the weights of 1 and 2 are edge functions * invArea
+	float invArea;
+	float depth[3];
+	float invW[3];
+	// divided by w for perspective correct interpolation
+	float varyings[softwareMaxVaryings][3];
+
+	uint32_t draw;
+};
+
+struct SoftwareVertexCacheEntry {
+	uint32_t vertex;
+	float position[4];
+	float varyings[softwareMaxVaryings];
+};
+
+// vertices a front end thread shaded lately, direct mapped by index like a post transform cache
+const uint32_t softwareVertexCacheSize = 32;
+
+struct SoftwareFrontEnd {
+	std::vector<SoftwareTriangle> triangles;
+	// triangles by tile
+	std::vector<std::vector<uint32_t>> bins;
+
+	SoftwareVertexCacheEntry vertexCache[softwareVertexCacheSize];
+
+	uint64_t culledTriangleCount;
+	uint64_t clippedTriangleCount;
+};
+
+struct SoftwareRasterizerStats {
+	// of every draw, instances included
+	uint64_t triangleCount;
+	// back facing, without area, outside of the view or between pixel centers
+	uint64_t culledTriangleCount;
+	// crossed the near or far plane or the guard band
+	uint64_t clippedTriangleCount;
+	// triangles that were set up, clipping can make more of one
+	uint64_t setupTriangleCount;
+	// pixels that passed the depth test and were shaded
+	uint64_t pixelCount;
+	uint64_t flushCount;
+};
+
+struct SoftwareRasterizer {
+	int threadCount;
+
+	SoftwareTexture* renderTarget;
+	SoftwareDepthBuffer* depthBuffer;
+	uint32_t targetWidth;
+	uint32_t targetHeight;
+	uint32_t tileCountX;
+	uint32_t tileCountY;
+
+	// since the last flush
+	std::vector<SoftwareDraw> draws;
+	// first triangle of every draw, and the total at the end
+	std::vector<uint64_t> drawTriangles;
+
+	// one per thread, a front end keeps its memory across flushes
+	std::vector<SoftwareFrontEnd> frontEnds;
+
+	SoftwareRasterizerStats stats;
+};
+
+void SoftwareTextureInit(SoftwareTexture& texture, uint32_t width, uint32_t height);
+void SoftwareTextureClear(SoftwareTexture& texture, uint32_t color);
+void SoftwareDepthBufferInit(SoftwareDepthBuffer& depthBuffer, uint32_t width, uint32_t height);
+void SoftwareDepthBufferClear(SoftwareDepthBuffer& depthBuffer, float depth);
+
+// what an RGBA8 target stores for a float color
+uint32_t SoftwarePackColor(const float color[4]);
+
+void SoftwareRasterizerInit(SoftwareRasterizer& rasterizer, int threadCount);
+
+// flushes what was drawn into the targets before, either target can be null but both have the same size
+void SoftwareRasterizerSetTargets(SoftwareRasterizer& rasterizer, SoftwareTexture* renderTarget, SoftwareDepthBuffer* depthBuffer);
+
+// dropped if it has no pipeline or there are no targets
+void SoftwareRasterizerDraw(SoftwareRasterizer& rasterizer, const SoftwareDraw& draw);
+
+// rasterizes everything drawn since the last flush, targets are only written here
+void SoftwareRasterizerFlush(SoftwareRasterizer& rasterizer);
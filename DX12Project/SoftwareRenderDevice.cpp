@@ -0,0 +1,435 @@
+#include "SoftwareRenderDevice.h"
+
+#include <cstring>
+
+struct SoftwareRenderBuffer {
+	uint64_t size;
+	uint8_t* memory;
+};
+
+struct SoftwareRenderFence {
+	uint64_t value;
+};
+
+static SoftwareRenderDevice* GetDevice(void* context) {
+	return static_cast<SoftwareRenderDevice*>(context);
+}
+
+// device objects
+
+// every heap is cpu memory, default heap buffers just do not hand it out
+static bool CreateBuffer(void* context, RenderHeapType heapType, uint64_t size, uint32_t initialState, RenderBuffer& buffer) {
+	(void)context;
+	(void)initialState;
+
+	SoftwareRenderBuffer* softwareBuffer = new SoftwareRenderBuffer;
+	softwareBuffer->size = size;
+	softwareBuffer->memory = new uint8_t[size]();
+
+	buffer.resource = softwareBuffer;
+	buffer.offset = 0;
+	buffer.gpuAddress = (uint64_t)(uintptr_t)softwareBuffer->memory;
+	buffer.cpuAddress = heapType != RENDER_HEAP_DEFAULT ? softwareBuffer->memory : nullptr;
+	buffer.size = size;
+	buffer.backendData = nullptr;
+	return true;
+}
+
+static void DestroyBuffer(void* context, RenderBuffer& buffer) {
+	(void)context;
+
+	SoftwareRenderBuffer* softwareBuffer = static_cast<SoftwareRenderBuffer*>(buffer.resource);
+	delete[] softwareBuffer->memory;
+	delete softwareBuffer;
+}
+
+// the recorder's lists
+static bool CreateCommandList(void* context, RenderCommandListType type, uint32_t allocatorCount, void*& list) {
+	RenderDevice& recorder = GetDevice(context)->recorder.device;
+	return recorder.functions->createCommandList(recorder.context, type, allocatorCount, list);
+}
+
+static void DestroyCommandList(void* context, void* list) {
+	RenderDevice& recorder = GetDevice(context)->recorder.device;
+	recorder.functions->destroyCommandList(recorder.context, list);
+}
+
+// there is only one thing that executes, every queue is the device
+static bool CreateQueue(void* context, RenderCommandListType type, void*& queue) {
+	(void)type;
+	queue = context;
+	return true;
+}
+
+static void DestroyQueue(void* context, void* queue) {
+	(void)context;
+	(void)queue;
+}
+
+static bool CreateFence(void* context, uint64_t initialValue, void*& fence) {
+	(void)context;
+
+	SoftwareRenderFence* softwareFence = new SoftwareRenderFence;
+	softwareFence->value = initialValue;
+
+	fence = softwareFence;
+	return true;
+}
+
+static void DestroyFence(void* context, void* fence) {
+	(void)context;
+	delete static_cast<SoftwareRenderFence*>(fence);
+}
+
+// execution, the executor's list is the device
+
+static void ResetState(SoftwareRenderDevice& softwareDevice) {
+	softwareDevice.pipeline = nullptr;
+	memset(&softwareDevice.bindings, 0, sizeof(softwareDevice.bindings));
+	softwareDevice.bindingsChanged = true;
+	memset(&softwareDevice.viewport, 0, sizeof(softwareDevice.viewport));
+	memset(&softwareDevice.scissorRect, 0, sizeof(softwareDevice.scissorRect));
+	softwareDevice.topology = 0;
+	memset(&softwareDevice.vertexBuffer, 0, sizeof(softwareDevice.vertexBuffer));
+	memset(&softwareDevice.indexBuffer, 0, sizeof(softwareDevice.indexBuffer));
+	memset(softwareDevice.rootConstantsShared, 0, sizeof(softwareDevice.rootConstantsShared));
+}
+
+// only the graphics bind point draws, compute arguments are dropped
+static bool IsGraphicsRoot(SoftwareRenderDevice& softwareDevice, RenderBindPoint bindPoint, uint32_t index) {
+	if (bindPoint != RENDER_BIND_GRAPHICS)
+		return false;
+
+	if (index >= softwareMaxRootParameters) {
+		softwareDevice.stats.unsupportedCommandCount++;
+		return false;
+	}
+	return true;
+}
+
+static void ExecuteSetPipelineState(void* list, void* pipelineState) {
+	GetDevice(list)->pipeline = static_cast<const SoftwarePipeline*>(pipelineState);
+}
+
+// a new root signature starts without arguments
+static void ExecuteSetRootSignature(void* list, RenderBindPoint bindPoint, void* rootSignature) {
+	SoftwareRenderDevice& softwareDevice = *GetDevice(list);
+	(void)rootSignature;
+	if (bindPoint != RENDER_BIND_GRAPHICS)
+		return;
+
+	memset(&softwareDevice.bindings, 0, sizeof(softwareDevice.bindings));
+	softwareDevice.bindingsChanged = true;
+}
+
+static void ExecuteSetRootBuffer(void* list, RenderBindPoint bindPoint, uint32_t index, uint64_t gpuAddress) {
+	SoftwareRenderDevice& softwareDevice = *GetDevice(list);
+	if (!IsGraphicsRoot(softwareDevice, bindPoint, index))
+		return;
+
+	softwareDevice.bindings.buffers[index] = reinterpret_cast<const uint8_t*>((uintptr_t)gpuAddress);
+	softwareDevice.bindingsChanged = true;
+}
+
+static void ExecuteSetRootConstants(void* list, RenderBindPoint bindPoint, uint32_t index, uint32_t count, const void* data, uint32_t offset) {
+	SoftwareRenderDevice& softwareDevice = *GetDevice(list);
+	if (!IsGraphicsRoot(softwareDevice, bindPoint, index))
+		return;
+
+	if (offset + count > softwareMaxRootConstants) {
+		softwareDevice.stats.unsupportedCommandCount++;
+		return;
+	}
+
+	// draws recorded before keep the values they were recorded with
+	const uint32_t*& constants = softwareDevice.bindings.constants[index];
+	if (constants == nullptr || softwareDevice.rootConstantsShared[index]) {
+		SoftwareRootConstants block;
+		memset(&block, 0, sizeof(block));
+		if (constants != nullptr)
+			memcpy(block.values, constants, sizeof(block.values));
+
+		softwareDevice.rootConstants.push_back(block);
+		constants = softwareDevice.rootConstants.back().values;
+		softwareDevice.rootConstantsShared[index] = false;
+	}
+
+	memcpy(const_cast<uint32_t*>(constants) + offset, data, count * 4);
+	softwareDevice.bindingsChanged = true;
+}
+
+static void ExecuteSetRootDescriptorTable(void* list, RenderBindPoint bindPoint, uint32_t index, RenderDescriptor table) {
+	SoftwareRenderDevice& softwareDevice = *GetDevice(list);
+	if (!IsGraphicsRoot(softwareDevice, bindPoint, index))
+		return;
+
+	softwareDevice.bindings.tables[index] = reinterpret_cast<const SoftwareTexture* const*>((uintptr_t)table.gpuHandle);
+	softwareDevice.bindingsChanged = true;
+}
+
+static void ExecuteSetDescriptorHeap(void* list, void* heap) {
+	(void)list;
+	(void)heap;
+}
+
+// the rasterizer flushes what was drawn into the targets before
+static void ExecuteSetRenderTarget(void* list, RenderDescriptor renderTarget, RenderDescriptor depthStencil) {
+	SoftwareRenderDevice& softwareDevice = *GetDevice(list);
+	SoftwareTexture* texture = reinterpret_cast<SoftwareTexture*>((uintptr_t)renderTarget.cpuHandle);
+	SoftwareDepthBuffer* depthBuffer = reinterpret_cast<SoftwareDepthBuffer*>((uintptr_t)depthStencil.cpuHandle);
+
+	if (texture != nullptr && depthBuffer != nullptr && (texture->width != depthBuffer->width || texture->height != depthBuffer->height)) {
+		softwareDevice.stats.unsupportedCommandCount++;
+		depthBuffer = nullptr;
+	}
+
+	SoftwareRasterizerSetTargets(softwareDevice.rasterizer, texture, depthBuffer);
+}
+
+static void ExecuteSetViewport(void* list, const RenderViewport& viewport) {
+	GetDevice(list)->viewport = viewport;
+}
+
+static void ExecuteSetScissorRect(void* list, const RenderRect& rect) {
+	GetDevice(list)->scissorRect = rect;
+}
+
+static void ExecuteSetPrimitiveTopology(void* list, uint32_t topology) {
+	GetDevice(list)->topology = topology;
+}
+
+static void ExecuteSetVertexBuffer(void* list, const RenderVertexBufferView& view) {
+	GetDevice(list)->vertexBuffer = view;
+}
+
+static void ExecuteSetIndexBuffer(void* list, const RenderIndexBufferView& view) {
+	GetDevice(list)->indexBuffer = view;
+}
+
+// draws recorded before the clear are rasterized first
+static void ExecuteClearRenderTarget(void* list, RenderDescriptor renderTarget, const float color[4]) {
+	SoftwareRenderDevice& softwareDevice = *GetDevice(list);
+	SoftwareTexture* texture = reinterpret_cast<SoftwareTexture*>((uintptr_t)renderTarget.cpuHandle);
+	if (texture == nullptr)
+		return;
+
+	SoftwareRasterizerFlush(softwareDevice.rasterizer);
+	SoftwareTextureClear(*texture, SoftwarePackColor(color));
+}
+
+static void ExecuteClearDepth(void* list, RenderDescriptor depthStencil, float depth) {
+	SoftwareRenderDevice& softwareDevice = *GetDevice(list);
+	SoftwareDepthBuffer* depthBuffer = reinterpret_cast<SoftwareDepthBuffer*>((uintptr_t)depthStencil.cpuHandle);
+	if (depthBuffer == nullptr)
+		return;
+
+	SoftwareRasterizerFlush(softwareDevice.rasterizer);
+	SoftwareDepthBufferClear(*depthBuffer, depth);
+}
+
+static void ExecuteDrawIndexedInstanced(void* list, uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance) {
+	SoftwareRenderDevice& softwareDevice = *GetDevice(list);
+	SoftwareRenderStats& stats = softwareDevice.stats;
+
+	uint32_t indexFormat = softwareDevice.indexBuffer.format;
+	if (softwareDevice.topology != softwareTopologyTriangleList || (indexFormat != softwareIndexFormat16 && indexFormat != softwareIndexFormat32)) {
+		stats.unsupportedCommandCount++;
+		return;
+	}
+
+	const RenderVertexBufferView& vertexBuffer = softwareDevice.vertexBuffer;
+	const RenderIndexBufferView& indexBuffer = softwareDevice.indexBuffer;
+	uint32_t indexSize = indexFormat == softwareIndexFormat16 ? 2 : 4;
+	if (softwareDevice.pipeline == nullptr || vertexBuffer.gpuAddress == 0 || vertexBuffer.stride == 0 || indexBuffer.gpuAddress == 0 ||
+		((uint64_t)startIndex + indexCount) * indexSize > indexBuffer.size) {
+		stats.invalidDrawCount++;
+		return;
+	}
+
+	// the bindings are copied once for the draws that share them
+	if (softwareDevice.bindingsChanged || softwareDevice.drawBindings.empty()) {
+		softwareDevice.drawBindings.push_back(softwareDevice.bindings);
+		for (uint32_t i = 0; i < softwareMaxRootParameters; ++i)
+			softwareDevice.rootConstantsShared[i] = true;
+		softwareDevice.bindingsChanged = false;
+	}
+
+	SoftwareDraw draw;
+	draw.pipeline = softwareDevice.pipeline;
+	draw.bindings = &softwareDevice.drawBindings.back();
+	draw.vertices = reinterpret_cast<const uint8_t*>((uintptr_t)vertexBuffer.gpuAddress);
+	draw.vertexStride = vertexBuffer.stride;
+	draw.vertexCount = vertexBuffer.size / vertexBuffer.stride;
+	draw.indices = reinterpret_cast<const uint8_t*>((uintptr_t)indexBuffer.gpuAddress) + (size_t)startIndex * indexSize;
+	draw.indexSize = indexSize;
+	draw.indexCount = indexCount;
+	draw.baseVertex = baseVertex;
+	draw.instanceCount = instanceCount;
+	draw.startInstance = startInstance;
+	draw.viewport = softwareDevice.viewport;
+	draw.scissorRect = softwareDevice.scissorRect;
+
+	SoftwareRasterizerDraw(softwareDevice.rasterizer, draw);
+	stats.drawCount++;
+}
+
+static void ExecuteDispatch(void* list, uint32_t x, uint32_t y, uint32_t z) {
+	(void)x;
+	(void)y;
+	(void)z;
+	GetDevice(list)->stats.unsupportedCommandCount++;
+}
+
+static void ExecuteExecuteIndirect(void* list, void* commandSignature, uint32_t maxCount, void* argumentResource, uint64_t argumentOffset, void* countResource, uint64_t countOffset) {
+	(void)commandSignature;
+	(void)maxCount;
+	(void)argumentResource;
+	(void)argumentOffset;
+	(void)countResource;
+	(void)countOffset;
+	GetDevice(list)->stats.unsupportedCommandCount++;
+}
+
+// draws recorded before the copy read what was there before it
+static void ExecuteCopyBufferRegion(void* list, void* destination, uint64_t destinationOffset, void* source, uint64_t sourceOffset, uint64_t size) {
+	SoftwareRenderDevice& softwareDevice = *GetDevice(list);
+	SoftwareRenderBuffer* destinationBuffer = static_cast<SoftwareRenderBuffer*>(destination);
+	SoftwareRenderBuffer* sourceBuffer = static_cast<SoftwareRenderBuffer*>(source);
+
+	if (destinationOffset > destinationBuffer->size || size > destinationBuffer->size - destinationOffset ||
+		sourceOffset > sourceBuffer->size || size > sourceBuffer->size - sourceOffset) {
+		softwareDevice.stats.unsupportedCommandCount++;
+		return;
+	}
+
+	SoftwareRasterizerFlush(softwareDevice.rasterizer);
+	memmove(destinationBuffer->memory + destinationOffset, sourceBuffer->memory + sourceOffset, (size_t)size);
+}
+
+// everything runs in order on the cpu
+static void ExecuteBarriers(void* list, const RenderBarrier* barriers, uint32_t count) {
+	(void)list;
+	(void)barriers;
+	(void)count;
+}
+
+// only the command list functions, a replay calls nothing else
+static const RenderDeviceFunctions softwareExecuteFunctions = {
+	nullptr,
+	nullptr,
+	nullptr,
+	nullptr,
+	nullptr,
+	nullptr,
+	nullptr,
+	nullptr,
+
+	nullptr,
+	nullptr,
+	nullptr,
+
+	nullptr,
+	nullptr,
+
+	nullptr,
+	nullptr,
+
+	ExecuteSetPipelineState,
+	ExecuteSetRootSignature,
+	ExecuteSetRootBuffer,
+	ExecuteSetRootBuffer,
+	ExecuteSetRootBuffer,
+	ExecuteSetRootConstants,
+	ExecuteSetRootDescriptorTable,
+	ExecuteSetDescriptorHeap,
+
+	ExecuteSetRenderTarget,
+	ExecuteSetViewport,
+	ExecuteSetScissorRect,
+	ExecuteSetPrimitiveTopology,
+	ExecuteSetVertexBuffer,
+	ExecuteSetIndexBuffer,
+
+	ExecuteClearRenderTarget,
+	ExecuteClearDepth,
+
+	ExecuteDrawIndexedInstanced,
+	ExecuteDispatch,
+	ExecuteDispatch,
+	ExecuteExecuteIndirect,
+	ExecuteCopyBufferRegion,
+	ExecuteBarriers,
+};
+
+// queues and fences
+
+// every list starts without state like a d3d12 list, the draws are rasterized before returning
+static void ExecuteCommandLists(void* queue, void* const* lists, uint32_t count) {
+	SoftwareRenderDevice& softwareDevice = *GetDevice(queue);
+	RenderCommandList target = { &softwareDevice.executor, &softwareDevice };
+
+	for (uint32_t i = 0; i < count; ++i) {
+		const NullRenderCommandList* nullList = static_cast<const NullRenderCommandList*>(lists[i]);
+
+		ResetState(softwareDevice);
+		if (!NullRenderReplay(nullList->stream.data(), nullList->streamSize, target))
+			softwareDevice.stats.failedReplayCount++;
+		softwareDevice.stats.executedListCount++;
+	}
+
+	SoftwareRasterizerFlush(softwareDevice.rasterizer);
+	softwareDevice.drawBindings.clear();
+	softwareDevice.rootConstants.clear();
+}
+
+// execute already finished everything
+static bool Signal(void* queue, void* fence, uint64_t value) {
+	(void)queue;
+	static_cast<SoftwareRenderFence*>(fence)->value = value;
+	return true;
+}
+
+static bool Wait(void* queue, void* fence, uint64_t value) {
+	(void)queue;
+	(void)fence;
+	(void)value;
+	return true;
+}
+
+static uint64_t GetCompletedValue(void* fence) {
+	return static_cast<SoftwareRenderFence*>(fence)->value;
+}
+
+static bool WaitForValue(void* fence, uint64_t value) {
+	return static_cast<SoftwareRenderFence*>(fence)->value >= value;
+}
+
+void SoftwareRenderDeviceInit(SoftwareRenderDevice& softwareDevice, int threadCount) {
+	NullRenderDeviceInit(softwareDevice.recorder);
+
+	// recording is the null device's, everything else is replaced
+	RenderDeviceFunctions& functions = softwareDevice.functions;
+	functions = *softwareDevice.recorder.device.functions;
+	functions.createBuffer = CreateBuffer;
+	functions.destroyBuffer = DestroyBuffer;
+	functions.createCommandList = CreateCommandList;
+	functions.destroyCommandList = DestroyCommandList;
+	functions.createQueue = CreateQueue;
+	functions.destroyQueue = DestroyQueue;
+	functions.createFence = CreateFence;
+	functions.destroyFence = DestroyFence;
+	functions.executeCommandLists = ExecuteCommandLists;
+	functions.signal = Signal;
+	functions.wait = Wait;
+	functions.getCompletedValue = GetCompletedValue;
+	functions.waitForValue = WaitForValue;
+
+	RenderDeviceInit(softwareDevice.device, &softwareDevice.functions, &softwareDevice);
+	RenderDeviceInit(softwareDevice.executor, &softwareExecuteFunctions, &softwareDevice);
+
+	SoftwareRasterizerInit(softwareDevice.rasterizer, threadCount);
+	ResetState(softwareDevice);
+	softwareDevice.drawBindings.clear();
+	softwareDevice.rootConstants.clear();
+	memset(&softwareDevice.stats, 0, sizeof(softwareDevice.stats));
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+// render device backend that draws with the software rasterizer
+// command lists are the null device's, they record into its byte stream. executing them replays the stream into
+// the rasterizer on the calling thread, which keeps what the lists bind and turns every draw into a SoftwareDraw,
+// and flushes at the end, so the targets hold the image once execute returns and fences are done when signaled
+// resources are plain memory and a gpu address is a pointer into it. pipeline states are SoftwarePipeline, render
+// target and depth stencil cpu handles are SoftwareTexture and SoftwareDepthBuffer pointers, and a descriptor
+// table's gpu handle points at an array of const SoftwareTexture pointers
+// only triangle lists with 16 or 32 bit indices are drawn, dispatches and indirect execution are counted and skipped
+// no d3d12 dependency
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+#include "NullRenderDevice.h"
+#include "RenderDevice.h"
+#include "SoftwareRasterizer.h"
+
+// root parameters a root signature can have for the software device, and 32 bit constants per parameter
+const uint32_t softwareMaxRootParameters = 16;
+const uint32_t softwareMaxRootConstants = 16;
+
+// D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST, DXGI_FORMAT_R16_UINT and DXGI_FORMAT_R32_UINT
+const uint32_t softwareTopologyTriangleList = 4;
+const uint32_t softwareIndexFormat16 = 57;
+const uint32_t softwareIndexFormat32 = 42;
+
+// what the graphics root parameters point at when a draw is recorded, the bindings the shaders get
+struct SoftwareRenderBindings {
+	// root constant buffer, shader resource and unordered access views
+	const uint8_t* buffers[softwareMaxRootParameters];
+	const uint32_t* constants[softwareMaxRootParameters];
+	const SoftwareTexture* const* tables[softwareMaxRootParameters];
+};
+
+struct SoftwareRootConstants {
+	uint32_t values[softwareMaxRootConstants];
+};
+
+struct SoftwareRenderStats {
+	uint64_t executedListCount;
+	uint64_t drawCount;
+	// commands the rasterizer cannot run, or arguments it does not take
+	uint64_t unsupportedCommandCount;
+	// draws without a pipeline, vertex or index buffer, or with indices past the index buffer
+	uint64_t invalidDrawCount;
+	// false streams, nothing after the bad command ran
+	uint64_t failedReplayCount;
+};
+
+struct SoftwareRenderDevice {
+	// what the frame building code uses, it points back at this so this has to stay where it is
+	RenderDevice device;
+	RenderDeviceFunctions functions;
+
+	// records the command lists
+	NullRenderDevice recorder;
+	// what the lists are replayed into, its functions run the commands
+	RenderDevice executor;
+
+	SoftwareRasterizer rasterizer;
+
+	// state while a list is executed
+	const SoftwarePipeline* pipeline;
+	SoftwareRenderBindings bindings;
+	bool bindingsChanged;
+	RenderViewport viewport;
+	RenderRect scissorRect;
+	uint32_t topology;
+	RenderVertexBufferView vertexBuffer;
+	RenderIndexBufferView indexBuffer;
+
+	// a copy of the bindings for every draw that changed them, and the root constants they point at
+	// both only grow until the flush at the end of execute, a deque does not move what it holds
+	std::deque<SoftwareRenderBindings> drawBindings;
+	std::deque<SoftwareRootConstants> rootConstants;
+	// constants that a copy of the bindings points at are copied before they change
+	bool rootConstantsShared[softwareMaxRootParameters];
+
+	SoftwareRenderStats stats;
+};
+
+void SoftwareRenderDeviceInit(SoftwareRenderDevice& softwareDevice, int threadCount);
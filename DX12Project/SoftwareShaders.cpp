@@ -0,0 +1,109 @@
+#include "SoftwareShaders.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "SoftwareRenderDevice.h"
+
+// like UnpackSnorm16 and UnpackUnorm16 in VertexInput.hlsli
+static float UnpackSnorm16(const uint8_t* source) {
+	int16_t value;
+	memcpy(&value, source, 2);
+	float unpacked = (float)value / 32767.0f;
+	return unpacked < -1.0f ? -1.0f : unpacked;
+}
+
+static float UnpackUnorm16(const uint8_t* source) {
+	uint16_t value;
+	memcpy(&value, source, 2);
+	return (float)value / 65535.0f;
+}
+
+void SoftwareSceneVertexShader(const uint8_t* vertex, uint32_t instance, const void* shaderData, const void* bindings, float position[4], float varyings[softwareMaxVaryings]) {
+	const VertexLayout& layout = *static_cast<const VertexLayout*>(shaderData);
+	const SoftwareRenderBindings& softwareBindings = *static_cast<const SoftwareRenderBindings*>(bindings);
+	(void)instance;
+
+	// input assembler
+	float objectPosition[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+	uint32_t texCoordOffset;
+	if (layout.position == VERTEX_POSITION_FORMAT_FLOAT3) {
+		memcpy(objectPosition, vertex, sizeof(float) * 3);
+		texCoordOffset = 12;
+	}
+	else {
+		for (int i = 0; i < 3; ++i)
+			objectPosition[i] = layout.position == VERTEX_POSITION_FORMAT_SNORM16 ? UnpackSnorm16(vertex + i * 2) : UnpackUnorm16(vertex + i * 2);
+		texCoordOffset = 8;
+	}
+
+	const uint8_t* texCoord = vertex + texCoordOffset;
+	if (layout.texCoord == VERTEX_TEXCOORD_FORMAT_FLOAT2) {
+		memcpy(varyings, texCoord, sizeof(float) * 2);
+	}
+	else {
+		for (int i = 0; i < 2; ++i) {
+			uint16_t value;
+			memcpy(&value, texCoord + i * 2, 2);
+			varyings[i] = layout.texCoord == VERTEX_TEXCOORD_FORMAT_HALF2 ? HalfToFloat(value) : UnpackUnorm16(texCoord + i * 2);
+		}
+	}
+
+	// GetObjectPosition
+	const uint32_t* dequantization = softwareBindings.constants[softwareSceneDequantizationParameter];
+	if (layout.position != VERTEX_POSITION_FORMAT_FLOAT3 && dequantization != nullptr) {
+		float constants[8];
+		memcpy(constants, dequantization, sizeof(constants));
+		for (int i = 0; i < 3; ++i)
+			objectPosition[i] = objectPosition[i] * constants[i] + constants[4 + i];
+	}
+
+	// mul(position, wvpMat) with the transposed matrix the constant buffer holds, a row per clip space component
+	const uint8_t* constantBuffer = softwareBindings.buffers[softwareSceneConstantBufferParameter];
+	if (constantBuffer == nullptr) {
+		memset(position, 0, sizeof(float) * 4);
+		return;
+	}
+
+	float matrix[16];
+	memcpy(matrix, constantBuffer, sizeof(matrix));
+	for (int row = 0; row < 4; ++row) {
+		const float* m = &matrix[row * 4];
+		position[row] = m[0] * objectPosition[0] + m[1] * objectPosition[1] + m[2] * objectPosition[2] + m[3] * objectPosition[3];
+	}
+}
+
+void SoftwareScenePixelShader(const SoftwarePixelQuad& quad, const void* shaderData, const void* bindings, uint32_t colors[4]) {
+	const SoftwareRenderBindings& softwareBindings = *static_cast<const SoftwareRenderBindings*>(bindings);
+	(void)shaderData;
+
+	const SoftwareTexture* texture = nullptr;
+	const SoftwareTexture* const* table = softwareBindings.tables[softwareSceneTextureTableParameter];
+	const uint32_t* textureIndex = softwareBindings.constants[softwareSceneTextureIndexParameter];
+	if (table != nullptr && textureIndex != nullptr)
+		texture = table[*textureIndex];
+
+	for (int lane = 0; lane < 4; ++lane) {
+		colors[lane] = 0;
+		if (texture == nullptr || !(quad.mask & (1u << lane)))
+			continue;
+
+		// border addressing, outside of [0, 1) is the border color
+		float u = floorf(quad.varyings[0][lane] * (float)texture->width);
+		float v = floorf(quad.varyings[1][lane] * (float)texture->height);
+		if (!(u >= 0.0f && u < (float)texture->width && v >= 0.0f && v < (float)texture->height))
+			continue;
+
+		colors[lane] = texture->pixels[(size_t)v * texture->width + (size_t)u];
+	}
+}
+
+void SoftwareScenePipelineInit(SoftwarePipeline& pipeline, const VertexLayout* layout) {
+	pipeline.vertexShader = SoftwareSceneVertexShader;
+	pipeline.pixelShader = SoftwareScenePixelShader;
+	pipeline.shaderData = layout;
+	pipeline.varyingCount = 2;
+	pipeline.cullMode = SOFTWARE_CULL_BACK;
+	pipeline.depthTest = true;
+	pipeline.depthWrite = true;
+}
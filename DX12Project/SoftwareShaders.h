@@ -0,0 +1,27 @@
+#pragma once
+
+// the renderer's VertexShader.hlsl and PixelShader.hlsl for the software render device
+// the vertex shader also does what the input assembler does for the layouts of VertexLayout.h, the pipeline's
+// shader data is the layout. the root parameters are the renderer's: the object's constant buffer at 0, the texture
+// table at 1, the texture index at 3 and the dequantization constants at 4
+// the pixel shader samples the nearest texel of the top mip with a transparent black border, the renderer's sampler
+// only does the same when it magnifies
+// no d3d12 dependency
+
+#include <cstddef>
+#include <cstdint>
+
+#include "SoftwareRasterizer.h"
+#include "VertexLayout.h"
+
+const uint32_t softwareSceneConstantBufferParameter = 0;
+const uint32_t softwareSceneTextureTableParameter = 1;
+const uint32_t softwareSceneTextureIndexParameter = 3;
+const uint32_t softwareSceneDequantizationParameter = 4;
+
+// the bindings are SoftwareRenderBindings, position and texture coordinate out
+void SoftwareSceneVertexShader(const uint8_t* vertex, uint32_t instance, const void* shaderData, const void* bindings, float position[4], float varyings[softwareMaxVaryings]);
+void SoftwareScenePixelShader(const SoftwarePixelQuad& quad, const void* shaderData, const void* bindings, uint32_t colors[4]);
+
+// the renderer's pipeline state, back faces culled and depth tested and written, layout has to outlive it
+void SoftwareScenePipelineInit(SoftwarePipeline& pipeline, const VertexLayout* layout);
@@ -0,0 +1,532 @@
+#include "TextureLoader.h"
+
+#include "d3dx12.h"
+#include "ImageLoader.h"
+#include "Profiler.h"
+
+#define SAFE_RELEASE(x) if( x ) { x->Release(); x = NULL; }
+
+static void WaitForUploadFence(TextureLoader& loader, UINT64 value) {
+	if (loader.uploadFence->GetCompletedValue() >= value)
+		return;
+
+	if (SUCCEEDED(loader.uploadFence->SetEventOnCompletion(value, loader.uploadFenceEvent)))
+		WaitForSingleObject(loader.uploadFenceEvent, INFINITE);
+}
+
+// upload thread only
+static void ReleaseFinishedUploadBatches(TextureLoader& loader) {
+	UINT64 completedValue = loader.uploadFence->GetCompletedValue();
+
+	size_t count = 0;
+	while (count < loader.uploadBatches.size() && loader.uploadBatches[count].fenceValue <= completedValue) {
+		for (size_t i = 0; i < loader.uploadBatches[count].uploadHeaps.size(); ++i)
+			GpuHeapAllocatorFree(*loader.heapAllocator, loader.uploadBatches[count].uploadHeaps[i]);
+		++count;
+	}
+
+	loader.uploadBatches.erase(loader.uploadBatches.begin(), loader.uploadBatches.begin() + count);
+}
+
+// writes every subresource into the arena allocation and records the copies out of it
+static void RecordArenaTextureCopies(TextureLoader& loader, ID3D12Resource* texture, const D3D12_SUBRESOURCE_DATA* subresources, UINT subresourceCount, const UploadArenaAllocation& allocation) {
+	D3D12_RESOURCE_DESC desc = texture->GetDesc();
+	ID3D12Resource* uploadBuffer = static_cast<ID3D12Resource*>(loader.uploadArena->userData);
+
+	std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layouts(subresourceCount);
+	std::vector<UINT> rowCounts(subresourceCount);
+	std::vector<UINT64> rowSizes(subresourceCount);
+	// footprint offsets start at the allocation, so they are relative to the whole upload buffer
+	loader.device->GetCopyableFootprints(&desc, 0, subresourceCount, allocation.offset, &layouts[0], &rowCounts[0], &rowSizes[0], nullptr);
+
+	for (UINT i = 0; i < subresourceCount; ++i) {
+		D3D12_MEMCPY_DEST destination;
+		destination.pData = loader.uploadArena->cpuAddress + layouts[i].Offset;
+		destination.RowPitch = layouts[i].Footprint.RowPitch;
+		destination.SlicePitch = (SIZE_T)layouts[i].Footprint.RowPitch * rowCounts[i];
+		MemcpySubresource(&destination, &subresources[i], (SIZE_T)rowSizes[i], rowCounts[i], layouts[i].Footprint.Depth);
+
+		CD3DX12_TEXTURE_COPY_LOCATION copyDestination(texture, i);
+		CD3DX12_TEXTURE_COPY_LOCATION copySource(uploadBuffer, layouts[i]);
+		loader.uploadCommandList->CopyTextureRegion(&copyDestination, 0, 0, 0, &copySource, nullptr);
+	}
+}
+
+// places the texture in a default heap block and records the copy of every subresource
+// staging space comes from the upload arena, textures that do not fit get an upload buffer of their own in uploadHeap
+static bool RecordTextureUpload(TextureLoader& loader, const D3D12_RESOURCE_DESC& desc, const D3D12_SUBRESOURCE_DATA* subresources, UINT subresourceCount, GpuAllocation& texture, UploadArenaAllocation& allocation, bool& allocated, GpuAllocation& uploadHeap) {
+	HRESULT hr;
+
+	allocated = false;
+	uploadHeap = GpuAllocation();
+
+	// the copy queue only uses resources in the common state, the copy promotes it to copy dest
+	hr = GpuHeapAllocatorCreateResource(*loader.heapAllocator, D3D12_HEAP_TYPE_DEFAULT, desc, D3D12_RESOURCE_STATE_COMMON, nullptr, texture);
+	if (FAILED(hr))
+		return false;
+
+	texture.resource->SetName(L"Texture Buffer Resource Heap");
+
+	// texture upload heap must be 256 byte aligned per row, every mip gets its own 512 byte aligned footprint
+	UINT64 uploadSize = GetRequiredIntermediateSize(texture.resource, 0, subresourceCount);
+
+	allocated = UploadArenaAllocate(*loader.uploadArena, uploadSize, UploadArenaTextureAlignment, allocation);
+	if (!allocated && loader.uploadFenceValue > 0) {
+		// the arena is full of earlier batches, their copies are short compared to decoding
+		WaitForUploadFence(loader, loader.uploadFenceValue);
+		allocated = UploadArenaAllocate(*loader.uploadArena, uploadSize, UploadArenaTextureAlignment, allocation);
+	}
+
+	if (allocated) {
+		RecordArenaTextureCopies(loader, texture.resource, subresources, subresourceCount, allocation);
+		return true;
+	}
+
+	hr = GpuHeapAllocatorCreateBuffer(*loader.heapAllocator, D3D12_HEAP_TYPE_UPLOAD, uploadSize, D3D12_RESOURCE_STATE_GENERIC_READ, uploadHeap);
+	if (FAILED(hr)) {
+		GpuHeapAllocatorFree(*loader.heapAllocator, texture);
+		return false;
+	}
+
+	uploadHeap.resource->SetName(L"Texture Buffer Upload Resource Heap");
+
+	// all mips in one go
+	UpdateSubresources(loader.uploadCommandList, texture.resource, uploadHeap.resource, 0, 0, subresourceCount, subresources);
+	return true;
+}
+
+// hands the staging space of a submitted batch back to the arena, reused once fenceValue is reached
+static void ReleaseArenaAllocations(TextureLoader& loader, const std::vector<UploadArenaAllocation>& allocations, UINT64 fenceValue) {
+	// a failed signal means the device is gone, nothing will read the memory anymore
+	void* fence = fenceValue != 0 ? loader.uploadFence : nullptr;
+
+	for (size_t i = 0; i < allocations.size(); ++i)
+		UploadArenaRelease(*loader.uploadArena, allocations[i], fence, fenceValue);
+}
+
+// resets the next upload context, waiting for the batch that used it last
+static bool BeginUploadBatch(TextureLoader& loader) {
+	int context = loader.uploadContextIndex;
+	WaitForUploadFence(loader, loader.uploadContextFenceValues[context]);
+
+	if (FAILED(loader.uploadCommandAllocators[context]->Reset()))
+		return false;
+
+	return SUCCEEDED(loader.uploadCommandList->Reset(loader.uploadCommandAllocators[context], nullptr));
+}
+
+// submits the recorded copies and returns the fence value that marks them done
+static UINT64 SubmitUploadBatch(TextureLoader& loader) {
+	loader.uploadCommandList->Close();
+
+	ID3D12CommandList* ppCommandLists[] = { loader.uploadCommandList };
+	loader.commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+
+	UINT64 value = loader.uploadFenceValue + 1;
+	if (FAILED(loader.commandQueue->Signal(loader.uploadFence, value)))
+		return 0;
+
+	loader.uploadFenceValue = value;
+	loader.uploadContextFenceValues[loader.uploadContextIndex] = value;
+	loader.uploadContextIndex = (loader.uploadContextIndex + 1) % textureUploadContextCount;
+	return value;
+}
+
+// same name with a .dds extension, written by the asset tool
+static std::wstring GetCookedTexturePath(const std::wstring& filename) {
+	size_t dot = filename.find_last_of(L'.');
+	size_t separator = filename.find_last_of(L"/\\");
+
+	if (dot == std::wstring::npos || (separator != std::wstring::npos && dot < separator))
+		return filename + L".dds";
+
+	return filename.substr(0, dot) + L".dds";
+}
+
+static void DecodeThreadProc(TextureLoader* loader) {
+	PROFILE_THREAD_NAME("Texture Decode Thread");
+
+	while (true) {
+		int texture;
+		{
+			std::unique_lock<std::mutex> lock(loader->mutex);
+			loader->decodeCondition.wait(lock, [loader] { return loader->exiting || !loader->decodeQueue.empty(); });
+			if (loader->exiting)
+				break;
+
+			texture = loader->decodeQueue.front();
+			loader->decodeQueue.pop_front();
+		}
+
+		PROFILE_SCOPE("DecodeTexture");
+
+		TextureEntry& entry = loader->textures[texture];
+
+		// block compressed with all its mips already, nothing left to do on the cpu
+		if (LoadDdsImageFromFile(entry.ddsImage, entry.desc, entry.subresources, GetCookedTexturePath(entry.filename).c_str())) {
+			entry.state = TEXTURE_STATE_DECODED;
+
+			std::lock_guard<std::mutex> lock(loader->mutex);
+			loader->uploadQueue.push_back(texture);
+			loader->uploadCondition.notify_one();
+			continue;
+		}
+
+		int imageSize = LoadImageDataFromFile(&entry.imageData, entry.desc, entry.filename.c_str(), entry.imageBytesPerRow);
+		if (imageSize <= 0) {
+			entry.state = TEXTURE_STATE_FAILED;
+			continue;
+		}
+
+		// 8 bit color images get a full mip chain, anything else keeps its single level
+		if (entry.desc.Format == DXGI_FORMAT_R8G8B8A8_UNORM || entry.desc.Format == DXGI_FORMAT_B8G8R8A8_UNORM) {
+			// image files hold srgb encoded color, filter it in linear space
+			GenerateMipChain(entry.imageData, (uint32_t)entry.desc.Width, entry.desc.Height, entry.imageBytesPerRow, MIP_FILTER_TRIANGLE, true, loader->mipThreadCount,
+				MIP_GENERATE_SIMD, entry.mips);
+
+			free(entry.imageData);
+			entry.imageData = nullptr;
+
+			entry.desc.MipLevels = (UINT16)entry.mips.levels.size();
+			entry.subresources.resize(entry.mips.levels.size());
+			for (size_t i = 0; i < entry.mips.levels.size(); ++i) {
+				const MipLevel& level = entry.mips.levels[i];
+				entry.subresources[i].pData = &entry.mips.data[level.offset];
+				entry.subresources[i].RowPitch = level.rowPitch;
+				entry.subresources[i].SlicePitch = level.rowPitch * level.height;
+			}
+		}
+		else {
+			D3D12_SUBRESOURCE_DATA textureData = {};
+			textureData.pData = entry.imageData;
+			textureData.RowPitch = entry.imageBytesPerRow;
+			textureData.SlicePitch = entry.imageBytesPerRow * entry.desc.Height;
+			entry.subresources.assign(1, textureData);
+		}
+
+		entry.state = TEXTURE_STATE_DECODED;
+
+		std::lock_guard<std::mutex> lock(loader->mutex);
+		loader->uploadQueue.push_back(texture);
+		loader->uploadCondition.notify_one();
+	}
+}
+
+static void UploadThreadProc(TextureLoader* loader) {
+	std::vector<int> batch;
+	std::vector<UploadArenaAllocation> arenaAllocations;
+
+	PROFILE_THREAD_NAME("Texture Upload Thread");
+
+	while (true) {
+		batch.clear();
+		{
+			std::unique_lock<std::mutex> lock(loader->mutex);
+			loader->uploadCondition.wait(lock, [loader] { return loader->exiting || !loader->uploadQueue.empty(); });
+			if (loader->exiting)
+				break;
+
+			// take whatever has been decoded so far
+			while (!loader->uploadQueue.empty() && batch.size() < maxTexturesPerUploadBatch) {
+				batch.push_back(loader->uploadQueue.front());
+				loader->uploadQueue.pop_front();
+			}
+		}
+
+		PROFILE_SCOPE("UploadTextureBatch");
+
+		ReleaseFinishedUploadBatches(*loader);
+
+		if (!BeginUploadBatch(*loader)) {
+			for (size_t i = 0; i < batch.size(); ++i)
+				loader->textures[batch[i]].state = TEXTURE_STATE_FAILED;
+			continue;
+		}
+
+		TextureUploadBatch uploadBatch;
+		arenaAllocations.clear();
+
+		for (size_t i = 0; i < batch.size(); ++i) {
+			TextureEntry& entry = loader->textures[batch[i]];
+
+			UploadArenaAllocation allocation;
+			bool allocated;
+			GpuAllocation uploadHeap;
+			bool recorded = RecordTextureUpload(*loader, entry.desc, &entry.subresources[0], (UINT)entry.subresources.size(), entry.texture, allocation, allocated, uploadHeap);
+
+			// the upload buffer has its own copy now
+			free(entry.imageData);
+			entry.imageData = nullptr;
+			entry.mips = MipChain();
+			entry.ddsImage = DdsImage();
+			entry.subresources.clear();
+
+			if (!recorded) {
+				entry.state = TEXTURE_STATE_FAILED;
+				continue;
+			}
+
+			if (allocated)
+				arenaAllocations.push_back(allocation);
+			else
+				uploadBatch.uploadHeaps.push_back(uploadHeap);
+		}
+
+		// no transitions, copy lists cannot move textures into shader states. TextureLoaderUpdate does that on the graphics queue
+
+		uploadBatch.fenceValue = SubmitUploadBatch(*loader);
+		loader->uploadBatches.push_back(uploadBatch);
+		ReleaseArenaAllocations(*loader, arenaAllocations, uploadBatch.fenceValue);
+
+		std::lock_guard<std::mutex> lock(loader->mutex);
+		for (size_t i = 0; i < batch.size(); ++i) {
+			TextureEntry& entry = loader->textures[batch[i]];
+			if (entry.state == TEXTURE_STATE_FAILED)
+				continue;
+
+			if (uploadBatch.fenceValue == 0) {
+				entry.state = TEXTURE_STATE_FAILED;
+				continue;
+			}
+
+			entry.uploadFenceValue = uploadBatch.fenceValue;
+			entry.state = TEXTURE_STATE_UPLOADING;
+			loader->pendingTextures.push_back(batch[i]);
+		}
+	}
+}
+
+static void CreateTextureView(TextureLoader& loader, ID3D12Resource* texture, uint32_t descriptorIndex) {
+	D3D12_RESOURCE_DESC desc = texture->GetDesc();
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	// 1 to 1 mapping
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Format = desc.Format;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Texture2D.MipLevels = desc.MipLevels;
+
+	loader.device->CreateShaderResourceView(texture, &srvDesc, GpuDescriptorHeapGetBindlessCpuHandle(*loader.descriptorHeap, descriptorIndex));
+}
+
+bool TextureLoaderInit(TextureLoader& loader, ID3D12Device* device, ID3D12CommandQueue* commandQueue, GpuDescriptorHeap* descriptorHeap, int textureCapacity, int decodeThreadCount, UploadArena* uploadArena, GpuHeapAllocator* heapAllocator, ResourceStateTracker* resourceStates) {
+	HRESULT hr;
+
+	loader.device = device;
+	loader.commandQueue = commandQueue;
+	loader.descriptorHeap = descriptorHeap;
+	loader.uploadArena = uploadArena;
+	loader.heapAllocator = heapAllocator;
+	loader.resourceStates = resourceStates;
+
+	loader.textures = new TextureEntry[textureCapacity];
+	loader.textureCapacity = textureCapacity;
+	loader.textureCount = 0;
+	loader.exiting = false;
+
+	for (int i = 0; i < textureUploadContextCount; ++i) {
+		hr = device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&loader.uploadCommandAllocators[i]));
+		if (FAILED(hr))
+			return false;
+		loader.uploadContextFenceValues[i] = 0;
+	}
+	loader.uploadContextIndex = 0;
+
+	hr = device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, loader.uploadCommandAllocators[0], NULL, IID_PPV_ARGS(&loader.uploadCommandList));
+	if (FAILED(hr))
+		return false;
+	loader.uploadCommandList->Close();
+
+	hr = device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&loader.uploadFence));
+	if (FAILED(hr))
+		return false;
+	loader.uploadFenceValue = 0;
+
+	loader.uploadFenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	if (loader.uploadFenceEvent == nullptr)
+		return false;
+
+	// 1x1 grey placeholder, uploaded right away so it can be drawn from the first frame
+	const UINT32 placeholderPixel = 0xff808080;
+	D3D12_RESOURCE_DESC placeholderDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, 1, 1, 1, 1);
+
+	if (!BeginUploadBatch(loader))
+		return false;
+
+	D3D12_SUBRESOURCE_DATA placeholderData = {};
+	placeholderData.pData = &placeholderPixel;
+	placeholderData.RowPitch = sizeof(placeholderPixel);
+	placeholderData.SlicePitch = sizeof(placeholderPixel);
+
+	UploadArenaAllocation placeholderAllocation;
+	bool placeholderAllocated;
+	GpuAllocation placeholderUploadHeap;
+	if (!RecordTextureUpload(loader, placeholderDesc, &placeholderData, 1, loader.placeholderTexture, placeholderAllocation, placeholderAllocated, placeholderUploadHeap))
+		return false;
+
+	UINT64 placeholderFenceValue = SubmitUploadBatch(loader);
+	if (placeholderFenceValue != 0)
+		WaitForUploadFence(loader, placeholderFenceValue);
+	GpuHeapAllocatorFree(*heapAllocator, placeholderUploadHeap);
+	if (placeholderAllocated)
+		ReleaseArenaAllocations(loader, std::vector<UploadArenaAllocation>(1, placeholderAllocation), placeholderFenceValue);
+
+	if (placeholderFenceValue == 0)
+		return false;
+
+	if (!GpuDescriptorHeapAllocateBindless(*descriptorHeap, loader.placeholderDescriptorIndex))
+		return false;
+
+	CreateTextureView(loader, loader.placeholderTexture.resource, loader.placeholderDescriptorIndex);
+	loader.placeholderTransitioned = false;
+
+	// split the cores that are left over by the decode threads between them for mip generation
+	loader.mipThreadCount = (int)std::thread::hardware_concurrency() / decodeThreadCount;
+	if (loader.mipThreadCount < 1)
+		loader.mipThreadCount = 1;
+
+	for (int i = 0; i < decodeThreadCount; ++i)
+		loader.decodeThreads.push_back(std::thread(DecodeThreadProc, &loader));
+	loader.uploadThread = std::thread(UploadThreadProc, &loader);
+
+	return true;
+}
+
+int TextureLoaderRequest(TextureLoader& loader, LPCWSTR filename) {
+	if (loader.textureCount >= loader.textureCapacity)
+		return -1;
+
+	int texture = loader.textureCount++;
+
+	TextureEntry& entry = loader.textures[texture];
+	entry.filename = filename;
+	entry.state = TEXTURE_STATE_QUEUED;
+	entry.imageData = nullptr;
+	entry.imageBytesPerRow = 0;
+	entry.desc = {};
+	entry.mips = MipChain();
+	entry.ddsImage = DdsImage();
+	entry.subresources.clear();
+	entry.texture = GpuAllocation();
+	entry.descriptorIndex = 0;
+	entry.uploadFenceValue = 0;
+
+	std::lock_guard<std::mutex> lock(loader.mutex);
+	loader.decodeQueue.push_back(texture);
+	loader.decodeCondition.notify_one();
+
+	return texture;
+}
+
+void TextureLoaderUpdate(TextureLoader& loader, ID3D12CommandQueue* graphicsQueue) {
+	UINT64 completedValue = loader.uploadFence->GetCompletedValue();
+	UINT64 waitValue = 0;
+
+	// uploaded before the first frame, but still in the state the copy queue left it in
+	if (!loader.placeholderTransitioned) {
+		ResourceStateTrackerRegister(*loader.resourceStates, loader.placeholderTexture.resource, 1, D3D12_RESOURCE_STATE_COMMON);
+		ResourceStateTrackerBeginTransition(*loader.resourceStates, loader.placeholderTexture.resource, resourceStateAllSubresources, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		loader.placeholderTransitioned = true;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(loader.mutex);
+
+		for (size_t i = 0; i < loader.pendingTextures.size();) {
+			TextureEntry& entry = loader.textures[loader.pendingTextures[i]];
+
+			// only textures the cpu has seen finish, so the frame never waits for a copy in progress
+			if (entry.uploadFenceValue > completedValue) {
+				++i;
+				continue;
+			}
+
+			if (entry.uploadFenceValue > waitValue)
+				waitValue = entry.uploadFenceValue;
+
+			ResourceStateTrackerRegister(*loader.resourceStates, entry.texture.resource, entry.desc.MipLevels, D3D12_RESOURCE_STATE_COMMON);
+			ResourceStateTrackerBeginTransition(*loader.resourceStates, entry.texture.resource, resourceStateAllSubresources, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+			// a fresh descriptor, nothing in flight reads it. without one the texture keeps showing the placeholder
+			if (GpuDescriptorHeapAllocateBindless(*loader.descriptorHeap, entry.descriptorIndex)) {
+				CreateTextureView(loader, entry.texture.resource, entry.descriptorIndex);
+				entry.state = TEXTURE_STATE_READY;
+			}
+			else {
+				entry.state = TEXTURE_STATE_FAILED;
+			}
+
+			loader.pendingTextures[i] = loader.pendingTextures.back();
+			loader.pendingTextures.pop_back();
+		}
+	}
+
+	// orders the graphics queue after the copies on the gpu as well, the fence has passed so this never stalls
+	if (waitValue > 0)
+		graphicsQueue->Wait(loader.uploadFence, waitValue);
+}
+
+bool TextureLoaderIsReady(TextureLoader& loader, int texture) {
+	if (texture < 0 || texture >= loader.textureCount)
+		return false;
+
+	return loader.textures[texture].state == TEXTURE_STATE_READY;
+}
+
+uint32_t TextureLoaderGetDescriptorIndex(TextureLoader& loader, int texture) {
+	if (TextureLoaderIsReady(loader, texture))
+		return loader.textures[texture].descriptorIndex;
+
+	return loader.placeholderDescriptorIndex;
+}
+
+void TextureLoaderShutdown(TextureLoader& loader) {
+	{
+		std::lock_guard<std::mutex> lock(loader.mutex);
+		loader.exiting = true;
+	}
+	loader.decodeCondition.notify_all();
+	loader.uploadCondition.notify_all();
+
+	for (size_t i = 0; i < loader.decodeThreads.size(); ++i)
+		loader.decodeThreads[i].join();
+	loader.decodeThreads.clear();
+
+	if (loader.uploadThread.joinable())
+		loader.uploadThread.join();
+
+	// last batches might still be copying
+	if (loader.uploadFence != nullptr)
+		WaitForUploadFence(loader, loader.uploadFenceValue);
+
+	for (size_t i = 0; i < loader.uploadBatches.size(); ++i) {
+		for (size_t j = 0; j < loader.uploadBatches[i].uploadHeaps.size(); ++j)
+			GpuHeapAllocatorFree(*loader.heapAllocator, loader.uploadBatches[i].uploadHeaps[j]);
+	}
+	loader.uploadBatches.clear();
+
+	for (int i = 0; i < loader.textureCount; ++i) {
+		free(loader.textures[i].imageData);
+		if (loader.textures[i].texture.resource != nullptr)
+			ResourceStateTrackerUnregister(*loader.resourceStates, loader.textures[i].texture.resource);
+		if (loader.textures[i].state == TEXTURE_STATE_READY)
+			GpuDescriptorHeapFreeBindless(*loader.descriptorHeap, loader.textures[i].descriptorIndex, 0);
+		GpuHeapAllocatorFree(*loader.heapAllocator, loader.textures[i].texture);
+	}
+
+	delete[] loader.textures;
+	loader.textures = nullptr;
+	loader.textureCount = 0;
+
+	if (loader.placeholderTexture.resource != nullptr)
+		ResourceStateTrackerUnregister(*loader.resourceStates, loader.placeholderTexture.resource);
+	GpuHeapAllocatorFree(*loader.heapAllocator, loader.placeholderTexture);
+	SAFE_RELEASE(loader.uploadCommandList);
+	for (int i = 0; i < textureUploadContextCount; ++i)
+		SAFE_RELEASE(loader.uploadCommandAllocators[i]);
+	SAFE_RELEASE(loader.uploadFence);
+
+	if (loader.uploadFenceEvent != nullptr)
+		CloseHandle(loader.uploadFenceEvent);
+	loader.uploadFenceEvent = nullptr;
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+// loads textures in the background
+// files are decoded on a pool of threads, a cooked .dds next to an image is used instead of the image, then an upload thread copies them to the gpu in batches
+// copies run on a copy queue, so streaming overlaps with rendering. the graphics queue waits on the upload fence and
+// moves finished textures into the shader resource state itself, since copy lists cannot
+// until its upload has finished on the gpu, a texture handle gives out a placeholder texture instead
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#include <windows.h>
+#include <d3d12.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "DdsFile.h"
+#include "DescriptorHeap.h"
+#include "GpuHeapAllocator.h"
+#include "MipGenerator.h"
+#include "ResourceStateTracker.h"
+#include "UploadArena.h"
+
+enum TextureState {
+	TEXTURE_STATE_QUEUED,
+	TEXTURE_STATE_DECODED,
+	// copy submitted, waiting for the upload fence
+	TEXTURE_STATE_UPLOADING,
+	TEXTURE_STATE_READY,
+	TEXTURE_STATE_FAILED,
+};
+
+struct TextureEntry {
+	std::wstring filename;
+	std::atomic<int> state;
+
+	// written by a decode thread, freed by the upload thread
+	BYTE* imageData;
+	int imageBytesPerRow;
+	D3D12_RESOURCE_DESC desc;
+	// generated mips or a cooked dds file, subresources point into these or into imageData
+	MipChain mips;
+	DdsImage ddsImage;
+	std::vector<D3D12_SUBRESOURCE_DATA> subresources;
+
+	// placed in a default heap block
+	GpuAllocation texture;
+	// bindless index of its view, only valid once ready
+	uint32_t descriptorIndex;
+	// fence value of the batch that uploaded this texture
+	UINT64 uploadFenceValue;
+};
+
+// own upload buffers of one submitted batch, for textures that did not fit into the upload arena
+// released once the batch is done
+struct TextureUploadBatch {
+	UINT64 fenceValue;
+	std::vector<GpuAllocation> uploadHeaps;
+};
+
+// the upload thread alternates between these so it can record while the last batch executes
+const int textureUploadContextCount = 2;
+
+// textures per ExecuteCommandLists on the upload thread
+const size_t maxTexturesPerUploadBatch = 32;
+
+struct TextureLoader {
+	ID3D12Device* device;
+	ID3D12CommandQueue* commandQueue;
+
+	// every view is in the bindless region, a texture gets its descriptor once its upload is done
+	GpuDescriptorHeap* descriptorHeap;
+	uint32_t placeholderDescriptorIndex;
+
+	GpuAllocation placeholderTexture;
+	// its first transition is queued by the first TextureLoaderUpdate
+	bool placeholderTransitioned;
+
+	// staging memory of every upload, userData is the upload buffer
+	UploadArena* uploadArena;
+	// every texture and fallback upload buffer is placed through this
+	GpuHeapAllocator* heapAllocator;
+	// render thread's, textures are registered once their upload has finished
+	ResourceStateTracker* resourceStates;
+
+	TextureEntry* textures;
+	int textureCapacity;
+	int textureCount;
+
+	std::mutex mutex;
+	std::condition_variable decodeCondition;
+	std::condition_variable uploadCondition;
+	std::deque<int> decodeQueue;
+	std::deque<int> uploadQueue;
+	bool exiting;
+
+	std::vector<std::thread> decodeThreads;
+	std::thread uploadThread;
+	// threads each decode thread may use for the rows of one mip chain
+	int mipThreadCount;
+
+	ID3D12CommandAllocator* uploadCommandAllocators[textureUploadContextCount];
+	UINT64 uploadContextFenceValues[textureUploadContextCount];
+	int uploadContextIndex;
+	ID3D12GraphicsCommandList* uploadCommandList;
+
+	// only the upload thread signals this fence
+	ID3D12Fence* uploadFence;
+	UINT64 uploadFenceValue;
+	HANDLE uploadFenceEvent;
+
+	// only touched by the upload thread
+	std::vector<TextureUploadBatch> uploadBatches;
+
+	// uploaded textures the render thread has not created a view for yet, protected by mutex
+	std::vector<int> pendingTextures;
+};
+
+// commandQueue is a copy queue, descriptorHeap, uploadArena, heapAllocator and resourceStates are shared with the caller
+// and have to outlive the loader
+// creates the placeholder texture and waits for its upload
+bool TextureLoaderInit(TextureLoader& loader, ID3D12Device* device, ID3D12CommandQueue* commandQueue, GpuDescriptorHeap* descriptorHeap, int textureCapacity, int decodeThreadCount, UploadArena* uploadArena, GpuHeapAllocator* heapAllocator, ResourceStateTracker* resourceStates);
+
+// render thread only, returns a handle or -1 if the loader is full
+int TextureLoaderRequest(TextureLoader& loader, LPCWSTR filename);
+
+// render thread, once per frame, before the next command list for graphicsQueue is recorded
+// creates bindless views for every texture whose upload has finished and begins split transitions of them to the
+// pixel shader state in resourceStates. they have to be ended and flushed before anything samples the textures
+// graphicsQueue is made to wait for the copies
+void TextureLoaderUpdate(TextureLoader& loader, ID3D12CommandQueue* graphicsQueue);
+
+bool TextureLoaderIsReady(TextureLoader& loader, int texture);
+
+// bindless index of the texture, or of the placeholder while it is still loading
+uint32_t TextureLoaderGetDescriptorIndex(TextureLoader& loader, int texture);
+
+// stops the threads and releases every texture, the gpu must not use them anymore
+void TextureLoaderShutdown(TextureLoader& loader);
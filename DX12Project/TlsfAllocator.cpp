@@ -0,0 +1,354 @@
+#include "TlsfAllocator.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// value != 0
+static uint32_t FindLowestBit(uint64_t value) {
+#if defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index;
+	_BitScanForward64(&index, value);
+	return index;
+#elif defined(__GNUC__)
+	return (uint32_t)__builtin_ctzll(value);
+#else
+	uint32_t index = 0;
+	while ((value & 1) == 0) {
+		value >>= 1;
+		++index;
+	}
+	return index;
+#endif
+}
+
+// value != 0
+static uint32_t FindHighestBit(uint64_t value) {
+#if defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index;
+	_BitScanReverse64(&index, value);
+	return index;
+#elif defined(__GNUC__)
+	return 63 - (uint32_t)__builtin_clzll(value);
+#else
+	uint32_t index = 0;
+	while (value >>= 1)
+		++index;
+	return index;
+#endif
+}
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// size class a free block of this size is kept in
+static void MappingInsert(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel) {
+	if (size < tlsfSecondLevelCount) {
+		// small sizes get a class each
+		firstLevel = 0;
+		secondLevel = (uint32_t)size;
+		return;
+	}
+
+	uint32_t log = FindHighestBit(size);
+	firstLevel = log - tlsfSecondLevelBits + 1;
+	secondLevel = (uint32_t)(size >> (log - tlsfSecondLevelBits)) - tlsfSecondLevelCount;
+}
+
+// first size class whose blocks are all at least size bytes
+static void MappingSearch(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel) {
+	if (size >= tlsfSecondLevelCount)
+		size += (1ull << (FindHighestBit(size) - tlsfSecondLevelBits)) - 1;
+
+	MappingInsert(size, firstLevel, secondLevel);
+}
+
+static uint32_t CreateBlock(TlsfAllocator& allocator) {
+	if (!allocator.unusedBlocks.empty()) {
+		uint32_t index = allocator.unusedBlocks.back();
+		allocator.unusedBlocks.pop_back();
+		return index;
+	}
+
+	allocator.blocks.push_back(TlsfBlock());
+	return (uint32_t)allocator.blocks.size() - 1;
+}
+
+static void DestroyBlock(TlsfAllocator& allocator, uint32_t index) {
+	allocator.unusedBlocks.push_back(index);
+}
+
+static void InsertFreeBlock(TlsfAllocator& allocator, uint32_t index) {
+	TlsfBlock& block = allocator.blocks[index];
+
+	uint32_t firstLevel;
+	uint32_t secondLevel;
+	MappingInsert(block.size, firstLevel, secondLevel);
+
+	uint32_t head = allocator.freeLists[firstLevel][secondLevel];
+	block.free = true;
+	block.prevFree = tlsfInvalidBlock;
+	block.nextFree = head;
+	if (head != tlsfInvalidBlock)
+		allocator.blocks[head].prevFree = index;
+
+	allocator.freeLists[firstLevel][secondLevel] = index;
+	allocator.firstLevelMap |= 1ull << firstLevel;
+	allocator.secondLevelMaps[firstLevel] |= 1u << secondLevel;
+}
+
+static void RemoveFreeBlock(TlsfAllocator& allocator, uint32_t index) {
+	TlsfBlock& block = allocator.blocks[index];
+
+	uint32_t firstLevel;
+	uint32_t secondLevel;
+	MappingInsert(block.size, firstLevel, secondLevel);
+
+	if (block.prevFree != tlsfInvalidBlock)
+		allocator.blocks[block.prevFree].nextFree = block.nextFree;
+	else
+		allocator.freeLists[firstLevel][secondLevel] = block.nextFree;
+
+	if (block.nextFree != tlsfInvalidBlock)
+		allocator.blocks[block.nextFree].prevFree = block.prevFree;
+
+	if (allocator.freeLists[firstLevel][secondLevel] == tlsfInvalidBlock) {
+		allocator.secondLevelMaps[firstLevel] &= ~(1u << secondLevel);
+		if (allocator.secondLevelMaps[firstLevel] == 0)
+			allocator.firstLevelMap &= ~(1ull << firstLevel);
+	}
+
+	block.free = false;
+}
+
+// a free block of at least size bytes, or tlsfInvalidBlock
+static uint32_t FindFreeBlock(const TlsfAllocator& allocator, uint64_t size) {
+	uint32_t firstLevel;
+	uint32_t secondLevel;
+	MappingSearch(size, firstLevel, secondLevel);
+	if (firstLevel >= tlsfFirstLevelCount)
+		return tlsfInvalidBlock;
+
+	uint32_t secondLevelMap = allocator.secondLevelMaps[firstLevel] & (~0u << secondLevel);
+	if (secondLevelMap == 0) {
+		uint64_t firstLevelMap = firstLevel + 1 < 64 ? allocator.firstLevelMap & (~0ull << (firstLevel + 1)) : 0;
+		if (firstLevelMap == 0)
+			return tlsfInvalidBlock;
+
+		firstLevel = FindLowestBit(firstLevelMap);
+		secondLevelMap = allocator.secondLevelMaps[firstLevel];
+	}
+
+	return allocator.freeLists[firstLevel][FindLowestBit(secondLevelMap)];
+}
+
+// splits the first size bytes off a block that is not in a free list, the rest becomes a free block
+static void SplitBlock(TlsfAllocator& allocator, uint32_t index, uint64_t size) {
+	uint32_t rest = CreateBlock(allocator);
+	// CreateBlock can move the records
+	TlsfBlock& block = allocator.blocks[index];
+	TlsfBlock& restBlock = allocator.blocks[rest];
+
+	restBlock.offset = block.offset + size;
+	restBlock.size = block.size - size;
+	restBlock.prevPhysical = index;
+	restBlock.nextPhysical = block.nextPhysical;
+	if (block.nextPhysical != tlsfInvalidBlock)
+		allocator.blocks[block.nextPhysical].prevPhysical = rest;
+
+	block.size = size;
+	block.nextPhysical = rest;
+
+	InsertFreeBlock(allocator, rest);
+}
+
+// merges next into index, next goes away
+static void MergeWithNext(TlsfAllocator& allocator, uint32_t index) {
+	TlsfBlock& block = allocator.blocks[index];
+	uint32_t next = block.nextPhysical;
+	TlsfBlock& nextBlock = allocator.blocks[next];
+
+	block.size += nextBlock.size;
+	block.nextPhysical = nextBlock.nextPhysical;
+	if (nextBlock.nextPhysical != tlsfInvalidBlock)
+		allocator.blocks[nextBlock.nextPhysical].prevPhysical = index;
+
+	DestroyBlock(allocator, next);
+}
+
+void TlsfInit(TlsfAllocator& allocator, uint64_t size) {
+	allocator.size = size;
+	allocator.blocks.clear();
+	allocator.unusedBlocks.clear();
+	allocator.firstLevelMap = 0;
+	allocator.usedBytes = 0;
+	allocator.allocationCount = 0;
+
+	for (uint32_t i = 0; i < tlsfFirstLevelCount; ++i) {
+		allocator.secondLevelMaps[i] = 0;
+		for (uint32_t j = 0; j < tlsfSecondLevelCount; ++j)
+			allocator.freeLists[i][j] = tlsfInvalidBlock;
+	}
+
+	allocator.firstBlock = CreateBlock(allocator);
+	TlsfBlock& block = allocator.blocks[allocator.firstBlock];
+	block.offset = 0;
+	block.size = size;
+	block.prevPhysical = tlsfInvalidBlock;
+	block.nextPhysical = tlsfInvalidBlock;
+
+	if (size > 0)
+		InsertFreeBlock(allocator, allocator.firstBlock);
+	else
+		block.free = false;
+}
+
+bool TlsfAllocate(TlsfAllocator& allocator, uint64_t size, uint64_t alignment, TlsfAllocation& allocation) {
+	if (size == 0 || size > allocator.size || alignment == 0 || (alignment & (alignment - 1)) != 0)
+		return false;
+
+	// blocks are usually aligned already since every size is, only search for room to spare if that fails
+	uint32_t index = FindFreeBlock(allocator, size);
+	if (index == tlsfInvalidBlock || allocator.blocks[index].offset % alignment != 0) {
+		if (alignment > 1)
+			index = FindFreeBlock(allocator, size + alignment - 1);
+		if (index == tlsfInvalidBlock)
+			return false;
+	}
+
+	RemoveFreeBlock(allocator, index);
+
+	uint64_t padding = AlignUp(allocator.blocks[index].offset, alignment) - allocator.blocks[index].offset;
+	if (padding > 0) {
+		// the padding stays behind as a free block, the previous block is in use so there is nothing to merge with
+		SplitBlock(allocator, index, padding);
+
+		uint32_t paddingBlock = index;
+		index = allocator.blocks[paddingBlock].nextPhysical;
+		RemoveFreeBlock(allocator, index);
+		InsertFreeBlock(allocator, paddingBlock);
+	}
+
+	if (allocator.blocks[index].size > size)
+		SplitBlock(allocator, index, size);
+
+	allocator.usedBytes += size;
+	++allocator.allocationCount;
+
+	allocation.offset = allocator.blocks[index].offset;
+	allocation.size = size;
+	allocation.block = index;
+	return true;
+}
+
+void TlsfFree(TlsfAllocator& allocator, uint32_t index) {
+	if (index >= allocator.blocks.size() || allocator.blocks[index].free)
+		return;
+
+	allocator.usedBytes -= allocator.blocks[index].size;
+	--allocator.allocationCount;
+
+	uint32_t next = allocator.blocks[index].nextPhysical;
+	if (next != tlsfInvalidBlock && allocator.blocks[next].free) {
+		RemoveFreeBlock(allocator, next);
+		MergeWithNext(allocator, index);
+	}
+
+	uint32_t prev = allocator.blocks[index].prevPhysical;
+	if (prev != tlsfInvalidBlock && allocator.blocks[prev].free) {
+		RemoveFreeBlock(allocator, prev);
+		MergeWithNext(allocator, prev);
+		index = prev;
+	}
+
+	InsertFreeBlock(allocator, index);
+}
+
+bool TlsfIsEmpty(const TlsfAllocator& allocator) {
+	return allocator.allocationCount == 0;
+}
+
+TlsfStats TlsfGetStats(const TlsfAllocator& allocator) {
+	TlsfStats stats = {};
+	stats.size = allocator.size;
+	stats.usedBytes = allocator.usedBytes;
+	stats.allocationCount = allocator.allocationCount;
+
+	for (uint32_t index = allocator.firstBlock; index != tlsfInvalidBlock; index = allocator.blocks[index].nextPhysical) {
+		const TlsfBlock& block = allocator.blocks[index];
+		if (!block.free)
+			continue;
+
+		stats.freeBytes += block.size;
+		++stats.freeBlockCount;
+		if (block.size > stats.largestFreeBlock)
+			stats.largestFreeBlock = block.size;
+	}
+
+	stats.fragmentation = stats.freeBytes > 0 ? 1.0 - (double)stats.largestFreeBlock / (double)stats.freeBytes : 0.0;
+	return stats;
+}
+
+bool TlsfValidate(const TlsfAllocator& allocator) {
+	uint64_t offset = 0;
+	uint64_t usedBytes = 0;
+	uint32_t usedCount = 0;
+	uint32_t freeCount = 0;
+	uint32_t prev = tlsfInvalidBlock;
+
+	for (uint32_t index = allocator.firstBlock; index != tlsfInvalidBlock; index = allocator.blocks[index].nextPhysical) {
+		const TlsfBlock& block = allocator.blocks[index];
+
+		if (block.offset != offset || block.prevPhysical != prev || block.size == 0)
+			return false;
+
+		if (block.free) {
+			if (prev != tlsfInvalidBlock && allocator.blocks[prev].free)
+				return false;
+			++freeCount;
+		}
+		else {
+			usedBytes += block.size;
+			++usedCount;
+		}
+
+		offset += block.size;
+		prev = index;
+	}
+
+	if (offset != allocator.size || usedBytes != allocator.usedBytes || usedCount != allocator.allocationCount)
+		return false;
+
+	// every free block is in the list of its size class, and the maps say which lists are not empty
+	uint32_t listedCount = 0;
+	for (uint32_t firstLevel = 0; firstLevel < tlsfFirstLevelCount; ++firstLevel) {
+		bool firstLevelSet = (allocator.firstLevelMap >> firstLevel) & 1;
+		if (firstLevelSet != (allocator.secondLevelMaps[firstLevel] != 0))
+			return false;
+
+		for (uint32_t secondLevel = 0; secondLevel < tlsfSecondLevelCount; ++secondLevel) {
+			uint32_t head = allocator.freeLists[firstLevel][secondLevel];
+			bool secondLevelSet = (allocator.secondLevelMaps[firstLevel] >> secondLevel) & 1;
+			if (secondLevelSet != (head != tlsfInvalidBlock))
+				return false;
+
+			uint32_t prevFree = tlsfInvalidBlock;
+			for (uint32_t index = head; index != tlsfInvalidBlock; index = allocator.blocks[index].nextFree) {
+				const TlsfBlock& block = allocator.blocks[index];
+
+				uint32_t blockFirstLevel;
+				uint32_t blockSecondLevel;
+				MappingInsert(block.size, blockFirstLevel, blockSecondLevel);
+				if (!block.free || block.prevFree != prevFree || blockFirstLevel != firstLevel || blockSecondLevel != secondLevel)
+					return false;
+
+				if (++listedCount > freeCount)
+					return false;
+				prevFree = index;
+			}
+		}
+	}
+
+	return listedCount == freeCount;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+// two level segregated fit allocator over an abstract range of bytes [0, size)
+// it only hands out offsets and keeps its bookkeeping on the cpu, so the range can be gpu memory (an ID3D12Heap,
+// or a buffer resource that is shared by many small buffers). allocating and freeing are O(1): free blocks are
+// kept in size classes, a power of two split into tlsfSecondLevelCount linear steps, found with two bit scans
+// neighbouring free blocks are merged right away
+// no d3d12 dependency and not thread safe
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+const uint32_t tlsfSecondLevelBits = 5;
+const uint32_t tlsfSecondLevelCount = 1 << tlsfSecondLevelBits;
+const uint32_t tlsfFirstLevelCount = 64 - tlsfSecondLevelBits + 1;
+
+const uint32_t tlsfInvalidBlock = 0xffffffff;
+
+struct TlsfBlock {
+	uint64_t offset;
+	uint64_t size;
+	// neighbours in memory
+	uint32_t prevPhysical;
+	uint32_t nextPhysical;
+	// neighbours in the free list of the size class, only while free
+	uint32_t prevFree;
+	uint32_t nextFree;
+	bool free;
+};
+
+struct TlsfAllocation {
+	uint64_t offset;
+	uint64_t size;
+	// handle for TlsfFree
+	uint32_t block;
+};
+
+struct TlsfStats {
+	uint64_t size;
+	uint64_t usedBytes;
+	uint64_t freeBytes;
+	uint64_t largestFreeBlock;
+	uint32_t freeBlockCount;
+	uint32_t allocationCount;
+	// 1 - largest free block / free bytes, 0 when all free memory is one block
+	double fragmentation;
+};
+
+struct TlsfAllocator {
+	uint64_t size;
+
+	// block records, indices stay valid while the block exists
+	std::vector<TlsfBlock> blocks;
+	std::vector<uint32_t> unusedBlocks;
+	// block at offset 0
+	uint32_t firstBlock;
+
+	// bit per first level with any free block, and per second level of each first level
+	uint64_t firstLevelMap;
+	uint32_t secondLevelMaps[tlsfFirstLevelCount];
+	uint32_t freeLists[tlsfFirstLevelCount][tlsfSecondLevelCount];
+
+	uint64_t usedBytes;
+	uint32_t allocationCount;
+};
+
+void TlsfInit(TlsfAllocator& allocator, uint64_t size);
+
+// alignment has to be a power of two, returns false if no free block is large enough
+bool TlsfAllocate(TlsfAllocator& allocator, uint64_t size, uint64_t alignment, TlsfAllocation& allocation);
+
+void TlsfFree(TlsfAllocator& allocator, uint32_t block);
+
+bool TlsfIsEmpty(const TlsfAllocator& allocator);
+
+// walks every block, not meant for every frame
+TlsfStats TlsfGetStats(const TlsfAllocator& allocator);
+
+// checks that blocks cover the range without gaps, no two free blocks are neighbours and the size class maps
+// match the free lists. slow, for tests
+bool TlsfValidate(const TlsfAllocator& allocator);
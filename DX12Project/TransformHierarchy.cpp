@@ -0,0 +1,209 @@
+#include "TransformHierarchy.h"
+
+using namespace DirectX;
+
+void TransformHierarchyInit(TransformHierarchy& hierarchy, size_t reserveCount) {
+	size_t paddedCount = (reserveCount + 3) & ~size_t(3);
+
+	hierarchy.parents.clear();
+	hierarchy.parents.reserve(reserveCount);
+
+	std::vector<float>* components[] = {
+		&hierarchy.positionX, &hierarchy.positionY, &hierarchy.positionZ,
+		&hierarchy.rotationX, &hierarchy.rotationY, &hierarchy.rotationZ, &hierarchy.rotationW,
+		&hierarchy.scaleX, &hierarchy.scaleY, &hierarchy.scaleZ,
+	};
+	for (size_t i = 0; i < sizeof(components) / sizeof(components[0]); ++i) {
+		components[i]->clear();
+		components[i]->reserve(paddedCount);
+	}
+
+	hierarchy.localMats.clear();
+	hierarchy.localMats.reserve(paddedCount);
+	hierarchy.worldMats.clear();
+	hierarchy.worldMats.reserve(reserveCount);
+	hierarchy.dirty.clear();
+	hierarchy.dirty.reserve(paddedCount);
+	hierarchy.updated.clear();
+	hierarchy.updated.reserve(reserveCount);
+
+	hierarchy.nodeCount = 0;
+	hierarchy.lastUpdatedCount = 0;
+}
+
+int TransformHierarchyAddNode(TransformHierarchy& hierarchy, int parent, FXMVECTOR position, FXMVECTOR rotation, FXMVECTOR scale) {
+	int node = (int)hierarchy.nodeCount;
+
+	// children always come after their parents
+	if (parent >= node)
+		return -1;
+
+	hierarchy.nodeCount++;
+
+	// keep the component arrays a multiple of four, padding nodes are identity and never dirty
+	size_t paddedCount = (hierarchy.nodeCount + 3) & ~size_t(3);
+	if (hierarchy.positionX.size() < paddedCount) {
+		hierarchy.positionX.resize(paddedCount, 0.0f);
+		hierarchy.positionY.resize(paddedCount, 0.0f);
+		hierarchy.positionZ.resize(paddedCount, 0.0f);
+		hierarchy.rotationX.resize(paddedCount, 0.0f);
+		hierarchy.rotationY.resize(paddedCount, 0.0f);
+		hierarchy.rotationZ.resize(paddedCount, 0.0f);
+		hierarchy.rotationW.resize(paddedCount, 1.0f);
+		hierarchy.scaleX.resize(paddedCount, 1.0f);
+		hierarchy.scaleY.resize(paddedCount, 1.0f);
+		hierarchy.scaleZ.resize(paddedCount, 1.0f);
+		hierarchy.localMats.resize(paddedCount);
+		hierarchy.dirty.resize(paddedCount, 0);
+	}
+
+	hierarchy.parents.push_back(parent);
+	hierarchy.worldMats.push_back(XMFLOAT4X4());
+	hierarchy.updated.push_back(0);
+
+	TransformHierarchySetPosition(hierarchy, node, position);
+	TransformHierarchySetRotation(hierarchy, node, rotation);
+	TransformHierarchySetScale(hierarchy, node, scale);
+
+	return node;
+}
+
+void TransformHierarchySetPosition(TransformHierarchy& hierarchy, int node, FXMVECTOR position) {
+	hierarchy.positionX[node] = XMVectorGetX(position);
+	hierarchy.positionY[node] = XMVectorGetY(position);
+	hierarchy.positionZ[node] = XMVectorGetZ(position);
+	hierarchy.dirty[node] = 1;
+}
+
+void TransformHierarchySetRotation(TransformHierarchy& hierarchy, int node, FXMVECTOR rotation) {
+	hierarchy.rotationX[node] = XMVectorGetX(rotation);
+	hierarchy.rotationY[node] = XMVectorGetY(rotation);
+	hierarchy.rotationZ[node] = XMVectorGetZ(rotation);
+	hierarchy.rotationW[node] = XMVectorGetW(rotation);
+	hierarchy.dirty[node] = 1;
+}
+
+void TransformHierarchySetScale(TransformHierarchy& hierarchy, int node, FXMVECTOR scale) {
+	hierarchy.scaleX[node] = XMVectorGetX(scale);
+	hierarchy.scaleY[node] = XMVectorGetY(scale);
+	hierarchy.scaleZ[node] = XMVectorGetZ(scale);
+	hierarchy.dirty[node] = 1;
+}
+
+XMVECTOR TransformHierarchyGetRotation(const TransformHierarchy& hierarchy, int node) {
+	return XMVectorSet(hierarchy.rotationX[node], hierarchy.rotationY[node], hierarchy.rotationZ[node], hierarchy.rotationW[node]);
+}
+
+static XMVECTOR LoadComponent4(const std::vector<float>& component, size_t first) {
+	return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&component[first]));
+}
+
+// builds the local matrices of the four nodes starting at first
+// every register holds one matrix element for four nodes, so this is the same amount of work as one matrix
+static void ComputeLocalMatrices4(TransformHierarchy& hierarchy, size_t first) {
+	XMVECTOR qx = LoadComponent4(hierarchy.rotationX, first);
+	XMVECTOR qy = LoadComponent4(hierarchy.rotationY, first);
+	XMVECTOR qz = LoadComponent4(hierarchy.rotationZ, first);
+	XMVECTOR qw = LoadComponent4(hierarchy.rotationW, first);
+
+	XMVECTOR sx = LoadComponent4(hierarchy.scaleX, first);
+	XMVECTOR sy = LoadComponent4(hierarchy.scaleY, first);
+	XMVECTOR sz = LoadComponent4(hierarchy.scaleZ, first);
+
+	XMVECTOR one = XMVectorSplatOne();
+	XMVECTOR two = XMVectorReplicate(2.0f);
+
+	XMVECTOR xx = qx * qx;
+	XMVECTOR yy = qy * qy;
+	XMVECTOR zz = qz * qz;
+	XMVECTOR xy = qx * qy;
+	XMVECTOR xz = qx * qz;
+	XMVECTOR yz = qy * qz;
+	XMVECTOR wx = qw * qx;
+	XMVECTOR wy = qw * qy;
+	XMVECTOR wz = qw * qz;
+
+	// same layout as XMMatrixRotationQuaternion, rows scaled by the node's scale
+	XMVECTOR m00 = sx * (one - two * (yy + zz));
+	XMVECTOR m01 = sx * (two * (xy + wz));
+	XMVECTOR m02 = sx * (two * (xz - wy));
+
+	XMVECTOR m10 = sy * (two * (xy - wz));
+	XMVECTOR m11 = sy * (one - two * (xx + zz));
+	XMVECTOR m12 = sy * (two * (yz + wx));
+
+	XMVECTOR m20 = sz * (two * (xz + wy));
+	XMVECTOR m21 = sz * (two * (yz - wx));
+	XMVECTOR m22 = sz * (one - two * (xx + yy));
+
+	XMVECTOR zero = XMVectorZero();
+
+	// transposing turns "one element of four nodes" into "one row of each node"
+	XMMATRIX row0 = XMMatrixTranspose(XMMATRIX(m00, m01, m02, zero));
+	XMMATRIX row1 = XMMatrixTranspose(XMMATRIX(m10, m11, m12, zero));
+	XMMATRIX row2 = XMMatrixTranspose(XMMATRIX(m20, m21, m22, zero));
+	XMMATRIX row3 = XMMatrixTranspose(XMMATRIX(
+		LoadComponent4(hierarchy.positionX, first),
+		LoadComponent4(hierarchy.positionY, first),
+		LoadComponent4(hierarchy.positionZ, first),
+		one));
+
+	for (size_t i = 0; i < 4; ++i)
+		XMStoreFloat4x4(&hierarchy.localMats[first + i], XMMATRIX(row0.r[i], row1.r[i], row2.r[i], row3.r[i]));
+}
+
+void TransformHierarchyUpdate(TransformHierarchy& hierarchy) {
+	size_t nodeCount = hierarchy.nodeCount;
+	size_t paddedCount = (nodeCount + 3) & ~size_t(3);
+
+	// local matrices, four nodes at a time
+	for (size_t first = 0; first < paddedCount; first += 4) {
+		const uint8_t* dirty = &hierarchy.dirty[first];
+		if (dirty[0] | dirty[1] | dirty[2] | dirty[3])
+			ComputeLocalMatrices4(hierarchy, first);
+	}
+
+	// world matrices, parents are updated before their children since they come first
+	size_t updatedCount = 0;
+	for (size_t i = 0; i < nodeCount; ++i) {
+		int parent = hierarchy.parents[i];
+
+		uint8_t changed = hierarchy.dirty[i] | (parent >= 0 ? hierarchy.updated[parent] : 0);
+		hierarchy.updated[i] = changed;
+		if (!changed)
+			continue;
+
+		XMMATRIX worldMat = XMLoadFloat4x4(&hierarchy.localMats[i]);
+		if (parent >= 0)
+			worldMat = worldMat * XMLoadFloat4x4(&hierarchy.worldMats[parent]);
+
+		XMStoreFloat4x4(&hierarchy.worldMats[i], worldMat);
+		++updatedCount;
+	}
+
+	for (size_t i = 0; i < nodeCount; ++i)
+		hierarchy.dirty[i] = 0;
+
+	hierarchy.lastUpdatedCount = updatedCount;
+}
+
+void TransformHierarchyWriteWVP(const TransformHierarchy& hierarchy, size_t first, size_t count, FXMMATRIX viewProjMat, void* destination, size_t stride) {
+	uint8_t* output = static_cast<uint8_t*>(destination);
+
+	for (size_t i = first; i < first + count; ++i) {
+		// transposed because DirectX math library is row major, not column major
+		XMMATRIX wvpMat = XMMatrixTranspose(XMLoadFloat4x4(&hierarchy.worldMats[i]) * viewProjMat);
+		XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(output), wvpMat);
+		output += stride;
+	}
+}
+
+void TransformHierarchyWriteWVPList(const TransformHierarchy& hierarchy, const uint32_t* nodes, size_t count, FXMMATRIX viewProjMat, void* destination, size_t stride) {
+	uint8_t* output = static_cast<uint8_t*>(destination);
+
+	for (size_t i = 0; i < count; ++i) {
+		XMMATRIX wvpMat = XMMatrixTranspose(XMLoadFloat4x4(&hierarchy.worldMats[nodes[i]]) * viewProjMat);
+		XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(output), wvpMat);
+		output += stride;
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+// scene transforms stored as structure of arrays
+// parents are always stored before their children, so one pass in order updates the whole hierarchy
+// only nodes whose local transform changed (and everything below them) are recomputed
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <DirectXMath.h>
+
+struct TransformHierarchy {
+	// -1 for root nodes
+	std::vector<int> parents;
+
+	// local transform, one array per component so four nodes can be loaded into one register
+	// arrays are padded to a multiple of four
+	std::vector<float> positionX, positionY, positionZ;
+	std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+	std::vector<float> scaleX, scaleY, scaleZ;
+
+	// scale * rotation * translation
+	std::vector<DirectX::XMFLOAT4X4> localMats;
+	// local * parent world
+	std::vector<DirectX::XMFLOAT4X4> worldMats;
+
+	// local transform changed since the last update
+	std::vector<uint8_t> dirty;
+	// world matrix changed in the last update
+	std::vector<uint8_t> updated;
+
+	size_t nodeCount;
+	size_t lastUpdatedCount;
+};
+
+void TransformHierarchyInit(TransformHierarchy& hierarchy, size_t reserveCount);
+
+// parent has to be -1 or an already added node, returns the new node index
+int TransformHierarchyAddNode(TransformHierarchy& hierarchy, int parent, DirectX::FXMVECTOR position, DirectX::FXMVECTOR rotation, DirectX::FXMVECTOR scale);
+
+void TransformHierarchySetPosition(TransformHierarchy& hierarchy, int node, DirectX::FXMVECTOR position);
+// rotation is a quaternion
+void TransformHierarchySetRotation(TransformHierarchy& hierarchy, int node, DirectX::FXMVECTOR rotation);
+void TransformHierarchySetScale(TransformHierarchy& hierarchy, int node, DirectX::FXMVECTOR scale);
+
+DirectX::XMVECTOR TransformHierarchyGetRotation(const TransformHierarchy& hierarchy, int node);
+
+// recomputes local matrices of dirty nodes and world matrices of their subtrees
+void TransformHierarchyUpdate(TransformHierarchy& hierarchy);
+
+// writes transpose(world * viewProj) for count nodes starting at first, one matrix every stride bytes
+// destination is usually mapped upload memory, so it is only written to and in order
+void TransformHierarchyWriteWVP(const TransformHierarchy& hierarchy, size_t first, size_t count, DirectX::FXMMATRIX viewProjMat, void* destination, size_t stride);
+
+// same for the nodes in the list, in list order
+void TransformHierarchyWriteWVPList(const TransformHierarchy& hierarchy, const uint32_t* nodes, size_t count, DirectX::FXMMATRIX viewProjMat, void* destination, size_t stride);
@@ -0,0 +1,148 @@
+#include "UploadArena.h"
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static bool IsRecordFinished(const UploadArena& arena, const UploadArenaRecord& record) {
+	if (!record.released)
+		return false;
+
+	return record.fence == nullptr || arena.fenceCompleted(record.fence) >= record.fenceValue;
+}
+
+// mutex has to be held
+static void ReclaimLocked(UploadArena& arena) {
+	while (!arena.records.empty() && IsRecordFinished(arena, arena.records.front())) {
+		const UploadArenaRecord& record = arena.records.front();
+		arena.tail = record.end;
+		arena.paddingBytes -= record.padding;
+
+		arena.records.pop_front();
+		++arena.firstRecordId;
+	}
+
+	// nothing live, start over at the front of the buffer so large allocations do not have to wrap
+	if (arena.records.empty()) {
+		arena.head = AlignUp(arena.head, arena.capacity);
+		arena.tail = arena.head;
+	}
+}
+
+bool UploadArenaInit(UploadArena& arena, uint8_t* cpuAddress, uint64_t capacity, void* userData, UploadArenaFenceCompletedFn fenceCompleted) {
+	if (capacity == 0 || capacity % UploadArenaCapacityGranularity != 0)
+		return false;
+
+	arena.cpuAddress = cpuAddress;
+	arena.capacity = capacity;
+	arena.userData = userData;
+	arena.fenceCompleted = fenceCompleted;
+
+	arena.head = 0;
+	arena.tail = 0;
+	arena.records.clear();
+	arena.firstRecordId = 0;
+	arena.paddingBytes = 0;
+
+	arena.stats = UploadArenaStats();
+	arena.stats.capacity = capacity;
+	return true;
+}
+
+bool UploadArenaAllocate(UploadArena& arena, uint64_t size, uint64_t alignment, UploadArenaAllocation& allocation) {
+	std::lock_guard<std::mutex> lock(arena.mutex);
+
+	if (size == 0 || size > arena.capacity || alignment == 0 || alignment > UploadArenaCapacityGranularity || (alignment & (alignment - 1)) != 0) {
+		++arena.stats.failedAllocationCount;
+		return false;
+	}
+
+	ReclaimLocked(arena);
+
+	uint64_t begin = AlignUp(arena.head, alignment);
+
+	// allocations never straddle the end of the buffer, the rest of it is skipped instead
+	if (begin % arena.capacity + size > arena.capacity)
+		begin = AlignUp(arena.head, arena.capacity);
+
+	uint64_t end = begin + size;
+	if (end - arena.tail > arena.capacity) {
+		++arena.stats.failedAllocationCount;
+		return false;
+	}
+
+	UploadArenaRecord record;
+	record.begin = arena.head;
+	record.end = end;
+	record.padding = begin - arena.head;
+	record.released = false;
+	record.fence = nullptr;
+	record.fenceValue = 0;
+
+	allocation.offset = begin % arena.capacity;
+	allocation.cpuAddress = arena.cpuAddress + allocation.offset;
+	allocation.size = size;
+	allocation.id = arena.firstRecordId + arena.records.size();
+
+	arena.records.push_back(record);
+	arena.head = end;
+	arena.paddingBytes += record.padding;
+
+	++arena.stats.allocationCount;
+	arena.stats.allocatedBytes += size;
+	if (arena.head - arena.tail > arena.stats.peakUsedBytes)
+		arena.stats.peakUsedBytes = arena.head - arena.tail;
+
+	return true;
+}
+
+void UploadArenaRelease(UploadArena& arena, const UploadArenaAllocation& allocation, void* fence, uint64_t fenceValue) {
+	std::lock_guard<std::mutex> lock(arena.mutex);
+
+	// ids below firstRecordId were reclaimed already, so a record can only be released once
+	if (allocation.id < arena.firstRecordId || allocation.id - arena.firstRecordId >= arena.records.size())
+		return;
+
+	UploadArenaRecord& record = arena.records[(size_t)(allocation.id - arena.firstRecordId)];
+	record.released = true;
+	record.fence = fence;
+	record.fenceValue = fenceValue;
+}
+
+void UploadArenaReclaim(UploadArena& arena) {
+	std::lock_guard<std::mutex> lock(arena.mutex);
+	ReclaimLocked(arena);
+}
+
+UploadArenaStats UploadArenaGetStats(UploadArena& arena) {
+	std::lock_guard<std::mutex> lock(arena.mutex);
+
+	UploadArenaStats stats = arena.stats;
+	stats.usedBytes = arena.head - arena.tail;
+	stats.paddingBytes = arena.paddingBytes;
+
+	// whatever is finished after the first live allocation cannot be reused until that one is
+	stats.blockedBytes = 0;
+	bool blocked = false;
+	for (const UploadArenaRecord& record : arena.records) {
+		if (!IsRecordFinished(arena, record))
+			blocked = true;
+		else if (blocked)
+			stats.blockedBytes += record.end - record.begin - record.padding;
+	}
+
+	stats.fragmentation = stats.usedBytes > 0 ? (double)(stats.paddingBytes + stats.blockedBytes) / (double)stats.usedBytes : 0.0;
+	return stats;
+}
+
+void UploadArenaDestroy(UploadArena& arena) {
+	std::lock_guard<std::mutex> lock(arena.mutex);
+
+	arena.records.clear();
+	arena.cpuAddress = nullptr;
+	arena.userData = nullptr;
+	arena.capacity = 0;
+	arena.head = 0;
+	arena.tail = 0;
+	arena.paddingBytes = 0;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+// one large persistently mapped upload buffer that every staging copy is sub-allocated from
+// allocations are handed out in ring order. once the copy reading an allocation has been submitted it is released
+// together with the fence value that marks the copy done, and the space is reused when that fence has passed.
+// allocations are released on their own, so users on different queues and threads can share the arena
+// the buffer and the fences are opaque pointers here so this file does not depend on d3d12
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+// D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, every subresource footprint has to start on it
+const uint64_t UploadArenaTextureAlignment = 512;
+
+// buffer copies can start anywhere, 256 keeps them on the same boundary as constant buffers
+const uint64_t UploadArenaBufferAlignment = 256;
+
+// the capacity has to be a multiple of this so every alignment survives wrapping around
+const uint64_t UploadArenaCapacityGranularity = 64 * 1024;
+
+// value the fence has reached so far (ID3D12Fence::GetCompletedValue)
+typedef uint64_t (*UploadArenaFenceCompletedFn)(void* fence);
+
+struct UploadArenaAllocation {
+	uint8_t* cpuAddress;
+	// from the start of the upload buffer
+	uint64_t offset;
+	uint64_t size;
+	uint64_t id;
+};
+
+struct UploadArenaStats {
+	uint64_t capacity;
+	// from the oldest live allocation to the newest, padding included
+	uint64_t usedBytes;
+	uint64_t peakUsedBytes;
+	// skipped for alignment or at the end of the buffer when wrapping
+	uint64_t paddingBytes;
+	// released and finished on the gpu, but stuck behind an older allocation that is still in use
+	uint64_t blockedBytes;
+	// (padding + blocked) / used, the part of the used range that holds no live data
+	double fragmentation;
+
+	uint64_t allocationCount;
+	uint64_t failedAllocationCount;
+	uint64_t allocatedBytes;
+};
+
+struct UploadArenaRecord {
+	// virtual offsets, which only ever grow. the physical offset is modulo the capacity
+	uint64_t begin;
+	uint64_t end;
+	uint64_t padding;
+	bool released;
+	void* fence;
+	uint64_t fenceValue;
+};
+
+struct UploadArena {
+	uint8_t* cpuAddress;
+	uint64_t capacity;
+	// whatever owns the memory (the upload resource for d3d12)
+	void* userData;
+	UploadArenaFenceCompletedFn fenceCompleted;
+
+	std::mutex mutex;
+
+	uint64_t head;
+	uint64_t tail;
+	// live allocations in allocation order, the first one has id firstRecordId
+	std::deque<UploadArenaRecord> records;
+	uint64_t firstRecordId;
+
+	uint64_t paddingBytes;
+	UploadArenaStats stats;
+};
+
+// the caller keeps buffer mapped at cpuAddress for as long as the arena lives
+// returns false if capacity is not a multiple of UploadArenaCapacityGranularity
+bool UploadArenaInit(UploadArena& arena, uint8_t* cpuAddress, uint64_t capacity, void* userData, UploadArenaFenceCompletedFn fenceCompleted);
+
+// alignment has to be a power of two no larger than UploadArenaCapacityGranularity
+// reclaims finished allocations first, returns false if there is still no room
+bool UploadArenaAllocate(UploadArena& arena, uint64_t size, uint64_t alignment, UploadArenaAllocation& allocation);
+
+// the space can be reused once fence has reached fenceValue, a null fence frees it right away
+void UploadArenaRelease(UploadArena& arena, const UploadArenaAllocation& allocation, void* fence, uint64_t fenceValue);
+
+// frees released allocations whose fence has passed, up to the oldest one still in use
+void UploadArenaReclaim(UploadArena& arena);
+
+UploadArenaStats UploadArenaGetStats(UploadArena& arena);
+
+// every allocation has to be released and finished
+void UploadArenaDestroy(UploadArena& arena);
@@ -0,0 +1,134 @@
+// vertex input for every layout a mesh can be cooked with, the defines come from GetVertexLayoutDefines
+// the input assembler already turns snorm, unorm and half elements into floats, what is left is done here
+
+#ifndef POSITION_QUANTIZED
+#define POSITION_QUANTIZED 0
+#endif
+
+// 0 none, 1 float, 2 octahedral
+#ifndef NORMAL_FORMAT
+#define NORMAL_FORMAT 0
+#endif
+
+#ifndef TANGENT_FORMAT
+#define TANGENT_FORMAT 0
+#endif
+
+// VertexPositionFormat and VertexTexCoordFormat, only LoadVertexInput reads them
+#ifndef POSITION_FORMAT
+#define POSITION_FORMAT 0
+#endif
+
+#ifndef TEXCOORD_FORMAT
+#define TEXCOORD_FORMAT 0
+#endif
+
+// bytes of every element, the same as GetVertexLayoutElements lays them out
+#define POSITION_SIZE (POSITION_FORMAT == 0 ? 12 : 8)
+#define TEXCOORD_SIZE (TEXCOORD_FORMAT == 0 ? 8 : 4)
+#define NORMAL_SIZE (NORMAL_FORMAT == 0 ? 0 : NORMAL_FORMAT == 1 ? 12 : 4)
+#define TANGENT_SIZE (TANGENT_FORMAT == 0 ? 0 : TANGENT_FORMAT == 1 ? 16 : 8)
+#define VERTEX_STRIDE (POSITION_SIZE + TEXCOORD_SIZE + NORMAL_SIZE + TANGENT_SIZE)
+
+struct VS_INPUT
+{
+    float3 pos : POSITION;
+    float2 texCoord : TEXCOORD;
+#if NORMAL_FORMAT == 1
+    float3 normal : NORMAL;
+#elif NORMAL_FORMAT == 2
+    float2 normal : NORMAL;
+#endif
+#if TANGENT_FORMAT != 0
+    float4 tangent : TANGENT;
+#endif
+};
+
+#if POSITION_QUANTIZED
+// per mesh, see QuantizedVertices
+cbuffer MeshDequantization : register(b2)
+{
+    float4 positionScale;
+    float4 positionOffset;
+};
+#endif
+
+float2 UnpackSnorm16(uint packed)
+{
+    return max(float2(int2(packed << 16, packed) >> 16) / 32767.0f, -1.0f);
+}
+
+float2 UnpackUnorm16(uint packed)
+{
+    return float2(packed & 0xffff, packed >> 16) / 65535.0f;
+}
+
+// what the input assembler would have made of vertex index, for shaders without one (mesh shaders)
+// only position and texture coordinate, the pixel shader does not need more yet
+VS_INPUT LoadVertexInput(ByteAddressBuffer buffer, uint index)
+{
+    VS_INPUT input = (VS_INPUT)0;
+    uint address = index * VERTEX_STRIDE;
+
+#if POSITION_FORMAT == 0
+    input.pos = asfloat(buffer.Load3(address));
+#elif POSITION_FORMAT == 1
+    uint2 position = buffer.Load2(address);
+    input.pos = float3(UnpackSnorm16(position.x), UnpackSnorm16(position.y).x);
+#else
+    uint2 position = buffer.Load2(address);
+    input.pos = float3(UnpackUnorm16(position.x), UnpackUnorm16(position.y).x);
+#endif
+
+#if TEXCOORD_FORMAT == 0
+    input.texCoord = asfloat(buffer.Load2(address + POSITION_SIZE));
+#elif TEXCOORD_FORMAT == 1
+    uint texCoord = buffer.Load(address + POSITION_SIZE);
+    input.texCoord = f16tof32(uint2(texCoord, texCoord >> 16));
+#else
+    input.texCoord = UnpackUnorm16(buffer.Load(address + POSITION_SIZE));
+#endif
+
+    return input;
+}
+
+float4 GetObjectPosition(VS_INPUT input)
+{
+#if POSITION_QUANTIZED
+    return float4(input.pos * positionScale.xyz + positionOffset.xyz, 1.0f);
+#else
+    return float4(input.pos, 1.0f);
+#endif
+}
+
+// same as DecodeOctahedral
+float3 DecodeOctahedral(float2 encoded)
+{
+    float3 direction = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+    if (direction.z < 0.0f)
+        direction.xy = (1.0f - abs(direction.yx)) * (direction.xy >= 0.0f ? 1.0f : -1.0f);
+    return normalize(direction);
+}
+
+#if NORMAL_FORMAT != 0
+float3 GetObjectNormal(VS_INPUT input)
+{
+#if NORMAL_FORMAT == 2
+    return DecodeOctahedral(input.normal);
+#else
+    return input.normal;
+#endif
+}
+#endif
+
+#if TANGENT_FORMAT != 0
+// w is the sign of the bitangent
+float4 GetObjectTangent(VS_INPUT input)
+{
+#if TANGENT_FORMAT == 2
+    return float4(DecodeOctahedral(input.tangent.xy), input.tangent.z);
+#else
+    return input.tangent;
+#endif
+}
+#endif
@@ -0,0 +1,484 @@
+#include "VertexLayout.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static uint32_t GetElementFormatSize(VertexElementFormat format) {
+	switch (format) {
+	case VERTEX_ELEMENT_FORMAT_R32G32B32A32_FLOAT: return 16;
+	case VERTEX_ELEMENT_FORMAT_R32G32B32_FLOAT: return 12;
+	case VERTEX_ELEMENT_FORMAT_R16G16B16A16_UNORM: return 8;
+	case VERTEX_ELEMENT_FORMAT_R16G16B16A16_SNORM: return 8;
+	case VERTEX_ELEMENT_FORMAT_R32G32_FLOAT: return 8;
+	case VERTEX_ELEMENT_FORMAT_R16G16_FLOAT: return 4;
+	case VERTEX_ELEMENT_FORMAT_R16G16_UNORM: return 4;
+	case VERTEX_ELEMENT_FORMAT_R16G16_SNORM: return 4;
+	default: return 0;
+	}
+}
+
+static bool GetPositionElementFormat(uint32_t format, VertexElementFormat& elementFormat) {
+	switch (format) {
+	case VERTEX_POSITION_FORMAT_FLOAT3: elementFormat = VERTEX_ELEMENT_FORMAT_R32G32B32_FLOAT; return true;
+	case VERTEX_POSITION_FORMAT_SNORM16: elementFormat = VERTEX_ELEMENT_FORMAT_R16G16B16A16_SNORM; return true;
+	case VERTEX_POSITION_FORMAT_UNORM16: elementFormat = VERTEX_ELEMENT_FORMAT_R16G16B16A16_UNORM; return true;
+	default: return false;
+	}
+}
+
+static bool GetTexCoordElementFormat(uint32_t format, VertexElementFormat& elementFormat) {
+	switch (format) {
+	case VERTEX_TEXCOORD_FORMAT_FLOAT2: elementFormat = VERTEX_ELEMENT_FORMAT_R32G32_FLOAT; return true;
+	case VERTEX_TEXCOORD_FORMAT_HALF2: elementFormat = VERTEX_ELEMENT_FORMAT_R16G16_FLOAT; return true;
+	case VERTEX_TEXCOORD_FORMAT_UNORM16: elementFormat = VERTEX_ELEMENT_FORMAT_R16G16_UNORM; return true;
+	default: return false;
+	}
+}
+
+// false for VERTEX_DIRECTION_FORMAT_NONE too, the element is left out then
+static bool GetDirectionElementFormat(uint32_t format, bool tangent, VertexElementFormat& elementFormat) {
+	switch (format) {
+	case VERTEX_DIRECTION_FORMAT_FLOAT:
+		elementFormat = tangent ? VERTEX_ELEMENT_FORMAT_R32G32B32A32_FLOAT : VERTEX_ELEMENT_FORMAT_R32G32B32_FLOAT;
+		return true;
+	case VERTEX_DIRECTION_FORMAT_OCTAHEDRAL_SNORM16:
+		elementFormat = tangent ? VERTEX_ELEMENT_FORMAT_R16G16B16A16_SNORM : VERTEX_ELEMENT_FORMAT_R16G16_SNORM;
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool IsValidLayout(const VertexLayout& layout) {
+	return layout.position < VERTEX_POSITION_FORMAT_COUNT && layout.texCoord < VERTEX_TEXCOORD_FORMAT_COUNT &&
+		layout.normal < VERTEX_DIRECTION_FORMAT_COUNT && layout.tangent < VERTEX_DIRECTION_FORMAT_COUNT;
+}
+
+uint32_t GetVertexLayoutStride(const VertexLayout& layout) {
+	if (!IsValidLayout(layout))
+		return 0;
+
+	VertexLayoutElement elements[vertexLayoutMaxElements];
+	uint32_t elementCount = GetVertexLayoutElements(layout, elements);
+	const VertexLayoutElement& last = elements[elementCount - 1];
+	return last.offset + GetElementFormatSize(last.format);
+}
+
+uint32_t GetVertexLayoutElements(const VertexLayout& layout, VertexLayoutElement elements[vertexLayoutMaxElements]) {
+	uint32_t count = 0;
+	uint32_t offset = 0;
+	VertexElementFormat format;
+
+	if (GetPositionElementFormat(layout.position, format)) {
+		elements[count++] = { "POSITION", format, offset };
+		offset += GetElementFormatSize(format);
+	}
+	if (GetTexCoordElementFormat(layout.texCoord, format)) {
+		elements[count++] = { "TEXCOORD", format, offset };
+		offset += GetElementFormatSize(format);
+	}
+	if (GetDirectionElementFormat(layout.normal, false, format)) {
+		elements[count++] = { "NORMAL", format, offset };
+		offset += GetElementFormatSize(format);
+	}
+	if (GetDirectionElementFormat(layout.tangent, true, format)) {
+		elements[count++] = { "TANGENT", format, offset };
+		offset += GetElementFormatSize(format);
+	}
+
+	return count;
+}
+
+void GetVertexLayoutDefines(const VertexLayout& layout, VertexLayoutDefine defines[vertexLayoutDefineCount]) {
+	static const char* const values[] = { "0", "1", "2" };
+
+	defines[0].name = "POSITION_QUANTIZED";
+	defines[0].value = values[layout.position != VERTEX_POSITION_FORMAT_FLOAT3 ? 1 : 0];
+	defines[1].name = "NORMAL_FORMAT";
+	defines[1].value = values[std::min<uint32_t>(layout.normal, 2)];
+	defines[2].name = "TANGENT_FORMAT";
+	defines[2].value = values[std::min<uint32_t>(layout.tangent, 2)];
+	// only shaders that decode vertices themselves need these, the input assembler knows the rest
+	defines[3].name = "POSITION_FORMAT";
+	defines[3].value = values[std::min<uint32_t>(layout.position, 2)];
+	defines[4].name = "TEXCOORD_FORMAT";
+	defines[4].value = values[std::min<uint32_t>(layout.texCoord, 2)];
+}
+
+static const float* GetSourceAttribute(const VertexSource& source, uint32_t index, uint32_t offset) {
+	return reinterpret_cast<const float*>(static_cast<const uint8_t*>(source.data) + (size_t)index * source.stride + offset);
+}
+
+VertexLayout ChooseVertexLayout(const VertexSource& source, VertexPositionFormat positionFormat) {
+	VertexLayout layout;
+	layout.position = (uint8_t)positionFormat;
+	layout.texCoord = VERTEX_TEXCOORD_FORMAT_FLOAT2;
+	layout.normal = source.normalOffset != vertexAttributeMissing ? VERTEX_DIRECTION_FORMAT_OCTAHEDRAL_SNORM16 : VERTEX_DIRECTION_FORMAT_NONE;
+	layout.tangent = source.tangentOffset != vertexAttributeMissing ? VERTEX_DIRECTION_FORMAT_OCTAHEDRAL_SNORM16 : VERTEX_DIRECTION_FORMAT_NONE;
+
+	if (source.texCoordOffset == vertexAttributeMissing)
+		return layout;
+
+	bool normalized = true;
+	float halfError = 0.0f;
+	for (uint32_t i = 0; i < source.vertexCount; ++i) {
+		const float* texCoord = GetSourceAttribute(source, i, source.texCoordOffset);
+		for (int j = 0; j < 2; ++j) {
+			if (!(texCoord[j] >= 0.0f && texCoord[j] <= 1.0f))
+				normalized = false;
+			halfError = std::max(halfError, fabsf(HalfToFloat(FloatToHalf(texCoord[j])) - texCoord[j]));
+		}
+	}
+
+	// unorm is exact to 1/131070 over [0, 1], which half floats only are below 1/16
+	if (normalized)
+		layout.texCoord = VERTEX_TEXCOORD_FORMAT_UNORM16;
+	else if (halfError <= vertexTexCoordMaxError)
+		layout.texCoord = VERTEX_TEXCOORD_FORMAT_HALF2;
+	return layout;
+}
+
+static int16_t QuantizeSnorm16(float value) {
+	return (int16_t)lroundf(std::max(-1.0f, std::min(1.0f, value)) * 32767.0f);
+}
+
+static uint16_t QuantizeUnorm16(float value) {
+	return (uint16_t)lroundf(std::max(0.0f, std::min(1.0f, value)) * 65535.0f);
+}
+
+// the input assembler's conversions
+static float DequantizeSnorm16(int16_t value) {
+	return std::max(-1.0f, value / 32767.0f);
+}
+
+static float DequantizeUnorm16(uint16_t value) {
+	return value / 65535.0f;
+}
+
+bool QuantizeVertices(const VertexSource& source, const VertexLayout& layout, QuantizedVertices& vertices) {
+	uint32_t stride = GetVertexLayoutStride(layout);
+	if (stride == 0 || source.positionOffset == vertexAttributeMissing)
+		return false;
+	if ((layout.normal != VERTEX_DIRECTION_FORMAT_NONE && source.normalOffset == vertexAttributeMissing) ||
+		(layout.tangent != VERTEX_DIRECTION_FORMAT_NONE && source.tangentOffset == vertexAttributeMissing))
+		return false;
+
+	vertices.layout = layout;
+	vertices.stride = stride;
+	vertices.vertexCount = source.vertexCount;
+
+	for (uint32_t i = 0; i < source.vertexCount; ++i) {
+		const float* position = GetSourceAttribute(source, i, source.positionOffset);
+		for (int j = 0; j < 3; ++j) {
+			if (!std::isfinite(position[j]))
+				return false;
+			if (i == 0 || position[j] < vertices.boundsMin[j])
+				vertices.boundsMin[j] = position[j];
+			if (i == 0 || position[j] > vertices.boundsMax[j])
+				vertices.boundsMax[j] = position[j];
+		}
+	}
+
+	// snorm covers the bounds from their center, unorm from their minimum
+	for (int j = 0; j < 3; ++j) {
+		float extent = source.vertexCount > 0 ? vertices.boundsMax[j] - vertices.boundsMin[j] : 0.0f;
+		if (source.vertexCount == 0)
+			vertices.boundsMin[j] = vertices.boundsMax[j] = 0.0f;
+
+		if (layout.position == VERTEX_POSITION_FORMAT_SNORM16) {
+			vertices.positionScale[j] = extent * 0.5f;
+			vertices.positionOffset[j] = vertices.boundsMin[j] + extent * 0.5f;
+		}
+		else if (layout.position == VERTEX_POSITION_FORMAT_UNORM16) {
+			vertices.positionScale[j] = extent;
+			vertices.positionOffset[j] = vertices.boundsMin[j];
+		}
+		else {
+			vertices.positionScale[j] = 1.0f;
+			vertices.positionOffset[j] = 0.0f;
+		}
+	}
+
+	VertexLayoutElement elements[vertexLayoutMaxElements];
+	uint32_t elementCount = GetVertexLayoutElements(layout, elements);
+
+	vertices.data.assign((size_t)source.vertexCount * stride, 0);
+	for (uint32_t i = 0; i < source.vertexCount; ++i) {
+		uint8_t* vertex = &vertices.data[(size_t)i * stride];
+
+		for (uint32_t e = 0; e < elementCount; ++e) {
+			const VertexLayoutElement& element = elements[e];
+			uint8_t* destination = vertex + element.offset;
+
+			if (strcmp(element.semanticName, "POSITION") == 0) {
+				const float* position = GetSourceAttribute(source, i, source.positionOffset);
+				if (layout.position == VERTEX_POSITION_FORMAT_FLOAT3) {
+					memcpy(destination, position, sizeof(float) * 3);
+					continue;
+				}
+
+				bool snorm = layout.position == VERTEX_POSITION_FORMAT_SNORM16;
+				for (int j = 0; j < 4; ++j) {
+					// a flat axis has no extent to divide by, every position sits on the offset
+					float value = 1.0f;
+					if (j < 3)
+						value = vertices.positionScale[j] > 0.0f ? (position[j] - vertices.positionOffset[j]) / vertices.positionScale[j] : 0.0f;
+
+					if (snorm) {
+						int16_t quantized = QuantizeSnorm16(value);
+						memcpy(destination + j * 2, &quantized, 2);
+					}
+					else {
+						uint16_t quantized = QuantizeUnorm16(value);
+						memcpy(destination + j * 2, &quantized, 2);
+					}
+				}
+			}
+			else if (strcmp(element.semanticName, "TEXCOORD") == 0) {
+				float texCoord[2] = {};
+				if (source.texCoordOffset != vertexAttributeMissing)
+					memcpy(texCoord, GetSourceAttribute(source, i, source.texCoordOffset), sizeof(texCoord));
+
+				for (int j = 0; j < 2; ++j) {
+					if (layout.texCoord == VERTEX_TEXCOORD_FORMAT_FLOAT2) {
+						memcpy(destination + j * 4, &texCoord[j], 4);
+						continue;
+					}
+
+					uint16_t quantized;
+					if (layout.texCoord == VERTEX_TEXCOORD_FORMAT_UNORM16) {
+						if (!(texCoord[j] >= 0.0f && texCoord[j] <= 1.0f))
+							return false;
+						quantized = QuantizeUnorm16(texCoord[j]);
+					}
+					else {
+						quantized = FloatToHalf(texCoord[j]);
+						if ((quantized & 0x7c00) == 0x7c00)
+							return false;
+					}
+					memcpy(destination + j * 2, &quantized, 2);
+				}
+			}
+			else {
+				bool tangent = strcmp(element.semanticName, "TANGENT") == 0;
+				const float* direction = GetSourceAttribute(source, i, tangent ? source.tangentOffset : source.normalOffset);
+				uint32_t format = tangent ? layout.tangent : layout.normal;
+
+				if (format == VERTEX_DIRECTION_FORMAT_FLOAT) {
+					memcpy(destination, direction, sizeof(float) * (tangent ? 4 : 3));
+					continue;
+				}
+
+				int16_t encoded[4] = {};
+				EncodeOctahedral(direction, encoded);
+				if (tangent)
+					encoded[2] = direction[3] < 0.0f ? -32767 : 32767;
+				memcpy(destination, encoded, tangent ? 8 : 4);
+			}
+		}
+	}
+
+	return true;
+}
+
+void DequantizeVertex(const QuantizedVertices& vertices, uint32_t index, float position[3], float texCoord[2], float normal[3], float tangent[4]) {
+	const VertexLayout& layout = vertices.layout;
+	VertexLayoutElement elements[vertexLayoutMaxElements];
+	uint32_t elementCount = GetVertexLayoutElements(layout, elements);
+	const uint8_t* vertex = &vertices.data[(size_t)index * vertices.stride];
+
+	for (uint32_t e = 0; e < elementCount; ++e) {
+		const VertexLayoutElement& element = elements[e];
+		const uint8_t* source = vertex + element.offset;
+
+		if (strcmp(element.semanticName, "POSITION") == 0) {
+			if (layout.position == VERTEX_POSITION_FORMAT_FLOAT3) {
+				memcpy(position, source, sizeof(float) * 3);
+				continue;
+			}
+
+			for (int j = 0; j < 3; ++j) {
+				float value;
+				if (layout.position == VERTEX_POSITION_FORMAT_SNORM16) {
+					int16_t quantized;
+					memcpy(&quantized, source + j * 2, 2);
+					value = DequantizeSnorm16(quantized);
+				}
+				else {
+					uint16_t quantized;
+					memcpy(&quantized, source + j * 2, 2);
+					value = DequantizeUnorm16(quantized);
+				}
+				position[j] = value * vertices.positionScale[j] + vertices.positionOffset[j];
+			}
+		}
+		else if (strcmp(element.semanticName, "TEXCOORD") == 0) {
+			for (int j = 0; j < 2; ++j) {
+				if (layout.texCoord == VERTEX_TEXCOORD_FORMAT_FLOAT2) {
+					memcpy(&texCoord[j], source + j * 4, 4);
+					continue;
+				}
+
+				uint16_t quantized;
+				memcpy(&quantized, source + j * 2, 2);
+				texCoord[j] = layout.texCoord == VERTEX_TEXCOORD_FORMAT_UNORM16 ? DequantizeUnorm16(quantized) : HalfToFloat(quantized);
+			}
+		}
+		else {
+			bool isTangent = strcmp(element.semanticName, "TANGENT") == 0;
+			float* direction = isTangent ? tangent : normal;
+			uint32_t format = isTangent ? layout.tangent : layout.normal;
+
+			if (format == VERTEX_DIRECTION_FORMAT_FLOAT) {
+				memcpy(direction, source, sizeof(float) * (isTangent ? 4 : 3));
+				continue;
+			}
+
+			int16_t encoded[3];
+			memcpy(encoded, source, isTangent ? 6 : 4);
+			DecodeOctahedral(encoded, direction);
+			if (isTangent)
+				direction[3] = DequantizeSnorm16(encoded[2]);
+		}
+	}
+}
+
+void GetPositionErrorBound(const QuantizedVertices& vertices, float bound[3]) {
+	for (int j = 0; j < 3; ++j) {
+		if (vertices.layout.position == VERTEX_POSITION_FORMAT_SNORM16)
+			bound[j] = vertices.positionScale[j] / 32767.0f * 0.5f;
+		else if (vertices.layout.position == VERTEX_POSITION_FORMAT_UNORM16)
+			bound[j] = vertices.positionScale[j] / 65535.0f * 0.5f;
+		else
+			bound[j] = 0.0f;
+	}
+}
+
+static float SignNotZero(float value) {
+	return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+// projects onto the octahedron and folds the lower half over the upper, both in [-1, 1]
+static void ProjectOctahedral(const float direction[3], float& u, float& v) {
+	float length = fabsf(direction[0]) + fabsf(direction[1]) + fabsf(direction[2]);
+	u = length > 0.0f ? direction[0] / length : 0.0f;
+	v = length > 0.0f ? direction[1] / length : 0.0f;
+
+	if (direction[2] < 0.0f) {
+		float foldedU = (1.0f - fabsf(v)) * SignNotZero(u);
+		float foldedV = (1.0f - fabsf(u)) * SignNotZero(v);
+		u = foldedU;
+		v = foldedV;
+	}
+}
+
+void EncodeOctahedral(const float direction[3], int16_t encoded[2]) {
+	float u, v;
+	ProjectOctahedral(direction, u, v);
+
+	// rounding each component on its own is not the closest direction, so the four around it are tried
+	float scaledU = std::max(-1.0f, std::min(1.0f, u)) * 32767.0f;
+	float scaledV = std::max(-1.0f, std::min(1.0f, v)) * 32767.0f;
+	float length = sqrtf(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+	float inverseLength = length > 0.0f ? 1.0f / length : 0.0f;
+	// by distance, a dot product this close to 1 has too few bits left to tell the candidates apart
+	float bestDistance = INFINITY;
+
+	for (int i = 0; i < 4; ++i) {
+		int16_t candidate[2] = {
+			(int16_t)((i & 1) ? ceilf(scaledU) : floorf(scaledU)),
+			(int16_t)((i & 2) ? ceilf(scaledV) : floorf(scaledV)),
+		};
+
+		float decoded[3];
+		DecodeOctahedral(candidate, decoded);
+
+		float distance = 0.0f;
+		for (int j = 0; j < 3; ++j)
+			distance += (decoded[j] - direction[j] * inverseLength) * (decoded[j] - direction[j] * inverseLength);
+		if (distance < bestDistance) {
+			bestDistance = distance;
+			encoded[0] = candidate[0];
+			encoded[1] = candidate[1];
+		}
+	}
+}
+
+void DecodeOctahedral(const int16_t encoded[2], float direction[3]) {
+	float u = DequantizeSnorm16(encoded[0]);
+	float v = DequantizeSnorm16(encoded[1]);
+	float z = 1.0f - fabsf(u) - fabsf(v);
+
+	if (z < 0.0f) {
+		float unfoldedU = (1.0f - fabsf(v)) * SignNotZero(u);
+		float unfoldedV = (1.0f - fabsf(u)) * SignNotZero(v);
+		u = unfoldedU;
+		v = unfoldedV;
+	}
+
+	float length = sqrtf(u * u + v * v + z * z);
+	direction[0] = u / length;
+	direction[1] = v / length;
+	direction[2] = z / length;
+}
+
+uint16_t FloatToHalf(float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+	uint32_t exponent = (bits >> 23) & 0xff;
+	uint32_t mantissa = bits & 0x7fffff;
+
+	// infinity stays infinity, nan stays nan
+	if (exponent == 0xff)
+		return sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0);
+
+	int halfExponent = (int)exponent - 127 + 15;
+	if (halfExponent >= 31)
+		return sign | 0x7c00;
+
+	// subnormal, the implicit one becomes part of the mantissa
+	if (halfExponent <= 0) {
+		if (halfExponent < -10)
+			return sign;
+
+		mantissa |= 0x800000;
+		uint32_t shift = (uint32_t)(14 - halfExponent);
+		uint32_t half = mantissa >> shift;
+		uint32_t remainder = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half & 1)))
+			++half;
+		return sign | (uint16_t)half;
+	}
+
+	// a carry out of the mantissa moves into the exponent, up to infinity, which is the right result
+	uint32_t half = ((uint32_t)halfExponent << 10) | (mantissa >> 13);
+	uint32_t remainder = mantissa & 0x1fff;
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+		++half;
+	return sign | (uint16_t)half;
+}
+
+float HalfToFloat(uint16_t half) {
+	uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+	uint32_t exponent = (half >> 10) & 0x1f;
+	uint32_t mantissa = half & 0x3ff;
+
+	if (exponent == 0) {
+		float value = ldexpf((float)mantissa, -24);
+		return sign ? -value : value;
+	}
+
+	uint32_t bits;
+	if (exponent == 31)
+		bits = sign | 0x7f800000 | (mantissa << 13);
+	else
+		bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+// compressed vertex formats, and the input layouts and shader defines that go with them
+// positions are 16 bit normalized integers over the mesh bounds, the shader scales them back with per mesh
+// dequantization constants. texture coordinates are half floats or 16 bit unorm, whichever is exact enough.
+// normals and tangents are octahedral, two 16 bit components for a direction
+// everything the input assembler can convert on its own is left to it, so the shader only has to know what
+// the assembler cannot: the dequantization and the octahedral decoding
+// no d3d12 dependency, formats have the same values as DXGI_FORMAT so they can be cast to it
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// every attribute has its own, the DXGI_FORMAT an element gets follows from it
+enum VertexPositionFormat {
+	VERTEX_POSITION_FORMAT_FLOAT3 = 0,
+	// over [boundsMin, boundsMax] mapped to [-1, 1], stored as four components so w reads as 1
+	VERTEX_POSITION_FORMAT_SNORM16 = 1,
+	// over [boundsMin, boundsMax] mapped to [0, 1], w reads as 1 too
+	VERTEX_POSITION_FORMAT_UNORM16 = 2,
+	VERTEX_POSITION_FORMAT_COUNT,
+};
+
+enum VertexTexCoordFormat {
+	VERTEX_TEXCOORD_FORMAT_FLOAT2 = 0,
+	VERTEX_TEXCOORD_FORMAT_HALF2 = 1,
+	// only for coordinates in [0, 1]
+	VERTEX_TEXCOORD_FORMAT_UNORM16 = 2,
+	VERTEX_TEXCOORD_FORMAT_COUNT,
+};
+
+// for normals, and for tangents with the bitangent sign as a fourth component
+enum VertexDirectionFormat {
+	VERTEX_DIRECTION_FORMAT_NONE = 0,
+	VERTEX_DIRECTION_FORMAT_FLOAT = 1,
+	// normals are two components, tangents four with the sign in z
+	VERTEX_DIRECTION_FORMAT_OCTAHEDRAL_SNORM16 = 2,
+	VERTEX_DIRECTION_FORMAT_COUNT,
+};
+
+// same values as DXGI_FORMAT so they can be cast to it
+enum VertexElementFormat {
+	VERTEX_ELEMENT_FORMAT_R32G32B32A32_FLOAT = 2,
+	VERTEX_ELEMENT_FORMAT_R32G32B32_FLOAT = 6,
+	VERTEX_ELEMENT_FORMAT_R16G16B16A16_UNORM = 11,
+	VERTEX_ELEMENT_FORMAT_R16G16B16A16_SNORM = 13,
+	VERTEX_ELEMENT_FORMAT_R32G32_FLOAT = 16,
+	VERTEX_ELEMENT_FORMAT_R16G16_FLOAT = 34,
+	VERTEX_ELEMENT_FORMAT_R16G16_UNORM = 35,
+	VERTEX_ELEMENT_FORMAT_R16G16_SNORM = 37,
+};
+
+// what ChooseVertexLayout accepts for texture coordinates, a quarter texel of a 512 texture
+const float vertexTexCoordMaxError = 1.0f / 2048.0f;
+
+// position, texture coordinate, normal, tangent
+const uint32_t vertexLayoutMaxElements = 4;
+
+// POSITION_QUANTIZED, NORMAL_FORMAT, TANGENT_FORMAT, POSITION_FORMAT, TEXCOORD_FORMAT
+const uint32_t vertexLayoutDefineCount = 5;
+
+// 4 bytes, stored as is in mesh files
+struct VertexLayout {
+	uint8_t position;
+	uint8_t texCoord;
+	uint8_t normal;
+	uint8_t tangent;
+};
+
+// one D3D12_INPUT_ELEMENT_DESC, always slot 0 and per vertex
+struct VertexLayoutElement {
+	const char* semanticName;
+	VertexElementFormat format;
+	uint32_t offset;
+};
+
+// one D3D_SHADER_MACRO, the strings are static
+struct VertexLayoutDefine {
+	const char* name;
+	const char* value;
+};
+
+// float attributes of vertices in memory, attributes a mesh does not have are vertexAttributeMissing
+// positions are three floats, texture coordinates two, normals three and tangents four with the bitangent sign in w
+const uint32_t vertexAttributeMissing = 0xffffffff;
+
+struct VertexSource {
+	const void* data;
+	uint32_t vertexCount;
+	uint32_t stride;
+	uint32_t positionOffset;
+	uint32_t texCoordOffset;
+	uint32_t normalOffset;
+	uint32_t tangentOffset;
+};
+
+// position = quantized * positionScale + positionOffset, what the shader does with POSITION_QUANTIZED
+struct QuantizedVertices {
+	VertexLayout layout;
+	uint32_t stride;
+	uint32_t vertexCount;
+	float positionScale[3];
+	float positionOffset[3];
+	float boundsMin[3];
+	float boundsMax[3];
+	std::vector<uint8_t> data;
+};
+
+// 0 if any attribute has a format this file does not know
+uint32_t GetVertexLayoutStride(const VertexLayout& layout);
+
+// in the order they are stored, returns how many of elements were written
+uint32_t GetVertexLayoutElements(const VertexLayout& layout, VertexLayoutElement elements[vertexLayoutMaxElements]);
+
+// the shader permutation that reads the layout, every define is always there
+void GetVertexLayoutDefines(const VertexLayout& layout, VertexLayoutDefine defines[vertexLayoutDefineCount]);
+
+// the smallest layout that stays within the error bounds of its formats, with the given position format
+// texture coordinates are unorm if they are all in [0, 1] and half floats if those are exact enough, float otherwise
+// directions the source has become octahedral
+VertexLayout ChooseVertexLayout(const VertexSource& source, VertexPositionFormat positionFormat);
+
+// false if the layout needs an attribute the source does not have or a value does not fit its format
+bool QuantizeVertices(const VertexSource& source, const VertexLayout& layout, QuantizedVertices& vertices);
+
+// what the input assembler and the shader make of vertex index, outputs of missing attributes are left alone
+void DequantizeVertex(const QuantizedVertices& vertices, uint32_t index, float position[3], float texCoord[2], float normal[3], float tangent[4]);
+
+// half of a quantization step of the position format, the most a position can be off per axis
+void GetPositionErrorBound(const QuantizedVertices& vertices, float bound[3]);
+
+// unit vectors to and from two snorm components
+void EncodeOctahedral(const float direction[3], int16_t encoded[2]);
+void DecodeOctahedral(const int16_t encoded[2], float direction[3]);
+
+// round to nearest even, values out of range become infinity
+uint16_t FloatToHalf(float value);
+float HalfToFloat(uint16_t half);
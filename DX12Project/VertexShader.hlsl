@@ -1,8 +1,4 @@
-struct VS_INPUT
-{
-    float4 pos : POSITION;
-    float4 texCoord: TEXCOORD;
-};
+#include "VertexInput.hlsli"
 
 struct VS_OUTPUT
 {
@@ -18,7 +14,7 @@ cbuffer ConstantBuffer : register(b0)
 VS_OUTPUT main(VS_INPUT input)
 {
     VS_OUTPUT output;
-    output.pos = mul(input.pos, wvpMat);
-    output.texCoord = input.texCoord;
+    output.pos = mul(GetObjectPosition(input), wvpMat);
+    output.texCoord = float4(input.texCoord, 0.0f, 0.0f);
     return output;
 }
\ No newline at end of file
@@ -1,127 +1,5 @@
 #include "stdafx.h"
 
-struct Vertex {
-	Vertex(float x, float y, float z, float u, float v) : pos(x, y, z), texCoord(u, v) {}
-	DirectX::XMFLOAT3 pos;
-	DirectX::XMFLOAT2 texCoord;
-};
-
-int LoadImageDataFromFile(BYTE** imageData, D3D12_RESOURCE_DESC& resourceDescription, LPCWSTR filename, int& bytesPerRow) {
-	HRESULT hr;
-
-	// use wic factory to create bitmap decoders
-	static IWICImagingFactory* wicFactory;
-
-	IWICBitmapDecoder* wicDecoder = NULL;
-	IWICBitmapFrameDecode* wicFrame = NULL;
-	IWICFormatConverter* wicConverter = NULL;
-
-	bool imageConverted = false;
-
-	if (wicFactory == NULL)
-	{
-		// initialize Com library which contains functions for creation of com applications
-		// parameter must be null
-		CoInitialize(NULL);
-
-		hr = CoCreateInstance(CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&wicFactory));
-		if (FAILED(hr))
-			return 0;
-	}
-
-	hr = wicFactory->CreateDecoderFromFilename(filename, NULL, GENERIC_READ, WICDecodeMetadataCacheOnLoad, &wicDecoder); 
-	if (FAILED(hr))
-		return 0;
-
-	// get first frame since some files may be gifs
-	hr = wicDecoder->GetFrame(0, &wicFrame);
-	if (FAILED(hr))
-		return 0;
-
-	WICPixelFormatGUID pixelFormat;
-	hr = wicFrame->GetPixelFormat(&pixelFormat);
-	if (FAILED(hr))
-		return 0;
-
-	UINT textureWidth, textureHeight;
-	hr = wicFrame->GetSize(&textureWidth, &textureHeight);
-	if (FAILED(hr))
-		return 0;
-
-	// checks for DXGI format compatibility
-	DXGI_FORMAT dxgiFormat = GetDXGIFormatFromWICFormat(pixelFormat);
-
-	// if not compatible
-	if (dxgiFormat == DXGI_FORMAT_UNKNOWN)
-	{
-		// get dxgi compatible wic format
-		WICPixelFormatGUID convertToPixelFormat = GetConvertToWICFormat(pixelFormat);
-
-		// if can't then return
-		if (convertToPixelFormat == GUID_WICPixelFormatDontCare)
-			return 0;
-
-		dxgiFormat = GetDXGIFormatFromWICFormat(convertToPixelFormat);
-
-		hr = wicFactory->CreateFormatConverter(&wicConverter);
-		if (FAILED(hr))
-			return 0;
-
-		BOOL canConvert = FALSE;
-		hr = wicConverter->CanConvert(pixelFormat, convertToPixelFormat, &canConvert);
-		if (FAILED(hr))
-			return 0;
-
-		hr = wicConverter->Initialize(wicFrame, convertToPixelFormat, WICBitmapDitherTypeErrorDiffusion, 0, 0, WICBitmapPaletteTypeCustom);
-		if (FAILED(hr))
-			return 0;
-
-		imageConverted = true;
-	}
-
-	int bitsPerPixel = GetDXGIFormatBitsPerPixel(dxgiFormat);
-	bytesPerRow = (textureWidth * bitsPerPixel) / 8;
-	// image size in bytes
-	int imageSize = bytesPerRow * textureHeight;
-
-	*imageData = (BYTE*)malloc(imageSize);
-
-	// copy image data into allocated memory
-	if (imageConverted) {
-		// if converted, then use the wic converter
-		hr = wicConverter->CopyPixels(0, bytesPerRow, imageSize, *imageData);
-		if (FAILED(hr))
-			return 0;
-	}
-	else {
-		// if not converted then copy straight from frame
-		hr = wicFrame->CopyPixels(0, bytesPerRow, imageSize, *imageData);
-		if (FAILED(hr))
-			return 0;
-	}
-
-	resourceDescription = {};
-	// type of resource
-	resourceDescription.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-	// zero is automatic alignment, but should be explicitly set for better mapping to heaps
-	resourceDescription.Alignment = 0;
-	resourceDescription.Width = textureWidth;
-	resourceDescription.Height = textureHeight;
-	// one image, also not a 3d image
-	resourceDescription.DepthOrArraySize = 1;
-	// no mipmaps
-	resourceDescription.MipLevels = 1;
-	// previously converted to dxgi format
-	resourceDescription.Format = dxgiFormat;
-	resourceDescription.SampleDesc.Count = 1;
-	resourceDescription.SampleDesc.Quality = 0;
-	// driver chooses the most efficient pixel layout (linear vs swizzle)
-	resourceDescription.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
-	resourceDescription.Flags = D3D12_RESOURCE_FLAG_NONE;
-
-	return imageSize;
-}
-
 bool InitializeWindow(HINSTANCE hInstance, int ShowWnd, bool fullscreen) {
 	if (fullscreen) {
 		// monitor handler
@@ -201,8 +79,14 @@ void mainloop() {
 			DispatchMessage(&msg);
 		}
 		else {
+			if (renderModeSwitchRequested) {
+				renderModeSwitchRequested = false;
+				SwitchRenderMode();
+			}
+
 			Update();
 			Render();
+			ReportFrameStats();
 		}
 	}
 }
@@ -216,6 +100,22 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
 				DestroyWindow(hwnd);
 			}
 		}
+#ifdef ENABLE_PROFILING
+		if (wParam == VK_F12) {
+			if (ProfilerWriteChromeTrace(profileTraceFilename))
+				printf("wrote %s\n", profileTraceFilename);
+			else
+				printf("could not write %s\n", profileTraceFilename);
+		}
+#endif
+		if (wParam == VK_F9)
+			renderModeSwitchRequested = true;
+		if (wParam == VK_F11) {
+			if (FrameCapture)
+				frameCaptureRequested = true;
+			else
+				printf("frame capture is off, FrameCapture has to be set before starting\n");
+		}
 		return 0;
 	case WM_DESTROY:
 		Running = false;
@@ -278,6 +178,9 @@ bool InitD3D() {
 	if (FAILED(hr))
 		return false;
 
+	if (!PipelineCacheInit(pipelineCache, device, adapter, pipelineCacheFilename))
+		return false;
+
 	D3D12_COMMAND_QUEUE_DESC cqDesc = {};
 	cqDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
 	cqDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
@@ -286,6 +189,36 @@ bool InitD3D() {
 	if (FAILED(hr))
 		return false;
 
+	D3D12_COMMAND_QUEUE_DESC copyQueueDesc = {};
+	copyQueueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+	copyQueueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+
+	hr = device->CreateCommandQueue(&copyQueueDesc, IID_PPV_ARGS(&copyQueue));
+	if (FAILED(hr))
+		return false;
+	copyQueue->SetName(L"Copy Queue");
+
+	GpuHeapAllocatorInit(gpuHeapAllocator, device);
+
+	D3D12RenderDeviceInit(renderDevice, device, &gpuHeapAllocator);
+	if (!D3D12RenderWrapQueue(renderDevice, commandQueue, graphicsQueue))
+		return false;
+
+	frameDevice = &renderDevice.device;
+	if (FrameCapture) {
+		RenderQueue d3dGraphicsQueue = graphicsQueue;
+		RenderCaptureDeviceInit(frameCapture, renderDevice.device);
+		if (!RenderCaptureWrapQueue(frameCapture, d3dGraphicsQueue, graphicsQueue))
+			return false;
+		frameDevice = &frameCapture.device;
+	}
+	frameCaptureRequested = false;
+
+#ifdef ENABLE_PROFILING
+	if (!GpuProfilerInit(gpuProfiler, device, commandQueue, maxFramesInFlight))
+		return false;
+#endif
+
 	DXGI_MODE_DESC backBufferDesc = {};
 	backBufferDesc.Width = Width;
 	backBufferDesc.Height = Height;
@@ -317,65 +250,73 @@ bool InitD3D() {
 	// setting initial frame index
 	frameIndex = swapChain->GetCurrentBackBufferIndex();
 
-	D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc = {};
-	rtvHeapDesc.NumDescriptors = frameBufferCount;
-	rtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
-	rtvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-	hr = device->CreateDescriptorHeap(&rtvHeapDesc, IID_PPV_ARGS(&rtvDescriptorHeap));
-	if (FAILED(hr))
+	if (!CpuDescriptorHeapInit(rtvDescriptorHeap, device, D3D12_DESCRIPTOR_HEAP_TYPE_RTV, cpuDescriptorHeapDefaultPageSize))
 		return false;
 
-	// descriptor sizes vary from device to device
-	rtvDescriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
-
-	// get "pointer" to first rtv in list
-	CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(rtvDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
-
 	for (int i = 0; i < frameBufferCount; ++i) {
 		hr = swapChain->GetBuffer(i, IID_PPV_ARGS(&renderTargets[i]));
 		if (FAILED(hr))
 			return false;
 
-		device->CreateRenderTargetView(renderTargets[i], nullptr, rtvHandle);
-		// moves handle along ("increments")
-		rtvHandle.Offset(1, rtvDescriptorSize);
-	}
-
-	for (int i = 0; i < frameBufferCount; ++i) {
-		hr = device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&commandAllocator[i]));
-		if (FAILED(hr))
+		if (!CpuDescriptorHeapAllocate(rtvDescriptorHeap, renderTargetViews[i]))
 			return false;
+
+		device->CreateRenderTargetView(renderTargets[i], nullptr, renderTargetViews[i].cpuHandle);
 	}
 
-	hr = device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, commandAllocator[0], NULL, IID_PPV_ARGS(&commandList));
+	// depth read is a read state that can be combined with the others as well
+	ResourceStateTrackerInit(resourceStates, D3D12_RESOURCE_STATE_GENERIC_READ | D3D12_RESOURCE_STATE_DEPTH_READ);
+
+	if (!RenderDeviceCreateCommandList(*frameDevice, RENDER_COMMAND_LIST_DIRECT, maxFramesInFlight, commandList))
+		return false;
+
+	// lists are created closed, this one records the startup work right away and is closed after it
+	if (!RenderCommandListReset(commandList, 0, nullptr))
+		return false;
+
+	hr = device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&copyCommandAllocator));
 	if (FAILED(hr))
 		return false;
 
-	// when command lists are created, they are created in the recording state, so they must be closed
-	// close later after recording
-	//commandList->Close();
+	// records the startup uploads right away, closed once they are in
+	hr = device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, copyCommandAllocator, NULL, IID_PPV_ARGS(&copyCommandList));
+	if (FAILED(hr))
+		return false;
 
-	for (int i = 0; i < frameBufferCount; i++) {
-		// fence initial value is 0
-		hr = device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence[i]));
-		if (FAILED(hr))
-			return false;
+	hr = device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&copyFence));
+	if (FAILED(hr))
+		return false;
+	copyFenceValue = 0;
 
-		fenceValue[i] = 0;
-	}
+	// fence initial value is 0
+	if (!RenderDeviceCreateFence(*frameDevice, 0, fence))
+		return false;
+
+	fenceValue = 0;
+	for (int i = 0; i < maxFramesInFlight; ++i)
+		frameFenceValues[i] = 0;
+	frameContextIndex = 0;
+
+	QueryPerformanceFrequency(&performanceFrequency);
+	QueryPerformanceCounter(&statsStartTime);
+
+	if (!InitRecordThreads())
+		return false;
 
-	fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-	if (fenceEvent == nullptr)
+	// vertex, index and texture uploads are staged here instead of in an upload heap each
+	if (!InitUploadArena())
 		return false;
 
 	// create root parameters before adding them into the root signature
 	
+	// the whole bindless region as one unbounded texture array, in its own register space so it cannot overlap
+	// anything else. unbounded ranges need resource binding tier 2
 	D3D12_DESCRIPTOR_RANGE descriptorTableRanges[1];
 	descriptorTableRanges[0].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-	descriptorTableRanges[0].NumDescriptors = 1;
+	descriptorTableRanges[0].NumDescriptors = UINT_MAX;
 	descriptorTableRanges[0].BaseShaderRegister = 0;
-	descriptorTableRanges[0].RegisterSpace = 0;
-	descriptorTableRanges[0].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+	descriptorTableRanges[0].RegisterSpace = 1;
+	descriptorTableRanges[0].OffsetInDescriptorsFromTableStart = 0;
 
 	D3D12_ROOT_DESCRIPTOR_TABLE descriptorTable;
 	descriptorTable.NumDescriptorRanges = _countof(descriptorTableRanges);
@@ -390,7 +331,30 @@ bool InitD3D() {
 	rootCBVDescriptor.RegisterSpace = 0;
 	rootCBVDescriptor.ShaderRegister = 0;
 
-	D3D12_ROOT_PARAMETER rootParameters[2];
+	// per-instance data is read straight from the upload heap, no descriptor needed
+	D3D12_ROOT_DESCRIPTOR rootInstanceSRVDescriptor;
+	rootInstanceSRVDescriptor.RegisterSpace = 0;
+	rootInstanceSRVDescriptor.ShaderRegister = 1;
+
+	// index of the texture to sample into the bindless table
+	D3D12_ROOT_CONSTANTS rootTextureIndexConstant;
+	rootTextureIndexConstant.ShaderRegister = 1;
+	rootTextureIndexConstant.RegisterSpace = 0;
+	rootTextureIndexConstant.Num32BitValues = 1;
+
+	// scale and offset that turn quantized positions back into object space, a float4 each
+	D3D12_ROOT_CONSTANTS rootDequantizationConstants;
+	rootDequantizationConstants.ShaderRegister = 2;
+	rootDequantizationConstants.RegisterSpace = 0;
+	rootDequantizationConstants.Num32BitValues = _countof(cubeDequantization);
+
+	// object of a gpu driven draw, the command signature sets it for every draw
+	D3D12_ROOT_CONSTANTS rootObjectIndexConstant;
+	rootObjectIndexConstant.ShaderRegister = 3;
+	rootObjectIndexConstant.RegisterSpace = 0;
+	rootObjectIndexConstant.Num32BitValues = 1;
+
+	D3D12_ROOT_PARAMETER rootParameters[6];
 	rootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
 	rootParameters[0].Descriptor = rootCBVDescriptor;
 	rootParameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
@@ -398,12 +362,28 @@ bool InitD3D() {
 	rootParameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
 	rootParameters[1].DescriptorTable = descriptorTable;
 	rootParameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+	rootParameters[2].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+	rootParameters[2].Descriptor = rootInstanceSRVDescriptor;
+	rootParameters[2].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+
+	rootParameters[3].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+	rootParameters[3].Constants = rootTextureIndexConstant;
+	rootParameters[3].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+	rootParameters[4].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+	rootParameters[4].Constants = rootDequantizationConstants;
+	rootParameters[4].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+
+	rootParameters[5].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+	rootParameters[5].Constants = rootObjectIndexConstant;
+	rootParameters[5].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
 	
 	// static samplers are more performant, but cannot be changed
 	// only here to make code easy
 	D3D12_STATIC_SAMPLER_DESC sampler = {};
-	// point sampler
-	sampler.Filter = D3D12_FILTER_MIN_MAG_MIP_POINT;
+	// textures have a full mip chain now, blend between mips and minify linearly, keep magnification sharp
+	sampler.Filter = D3D12_FILTER_MIN_LINEAR_MAG_POINT_MIP_LINEAR;
 	// set to border color below
 	sampler.AddressU = D3D12_TEXTURE_ADDRESS_MODE_BORDER;
 	sampler.AddressV = D3D12_TEXTURE_ADDRESS_MODE_BORDER;
@@ -437,12 +417,161 @@ bool InitD3D() {
 	if (FAILED(hr))
 		return false;
 
+	// part of the pipeline cache key, the root signature object itself is only a pointer
+	uint64_t rootSignatureHash = HashBytes(pipelineHashSeed, signature->GetBufferPointer(), signature->GetBufferSize());
+
+	// the cube is cooked by AssetTool, its sections are copied from the mapped file straight into upload memory
+	MappedFile meshFile;
+	if (!MappedFileOpen(meshFile, L"cube.mesh")) {
+		Running = false;
+		return false;
+	}
+
+	MeshView cubeMesh;
+	if (!ReadMeshFile(meshFile.data, meshFile.size, cubeMesh)) {
+		MappedFileClose(meshFile);
+		Running = false;
+		return false;
+	}
+
+	int vBufferSize = (int)cubeMesh.vertexDataSize;
+
+	// default heap, which is memory in gpu that only gpu has access to
+	// sub-allocated from a buffer page, which stays in the common state the copy queue needs
+	hr = GpuHeapAllocatorCreateBuffer(gpuHeapAllocator, D3D12_HEAP_TYPE_DEFAULT, vBufferSize, D3D12_RESOURCE_STATE_COMMON, vertexBuffer);
+	if (FAILED(hr)) {
+		MappedFileClose(meshFile);
+		Running = false;
+		return false;
+	}
+
+	// staging copy in the upload arena, which cpu can write to and gpu can read from
+	UploadArenaAllocation vBufferUpload;
+	if (!UploadArenaAllocate(uploadArena, vBufferSize, UploadArenaBufferAlignment, vBufferUpload)) {
+		MappedFileClose(meshFile);
+		Running = false;
+		return false;
+	}
+
+	memcpy(vBufferUpload.cpuAddress, cubeMesh.vertices, vBufferSize);
+
+	// copy the vertices from the upload arena to the default heap
+	copyCommandList->CopyBufferRegion(vertexBuffer.resource, vertexBuffer.offset, static_cast<ID3D12Resource*>(uploadArena.userData), vBufferUpload.offset, vBufferSize);
+
+	// the copy queue is not recorded through the render device, so captures are told what the mesh buffers hold
+	if (FrameCapture)
+		RenderCaptureAddBuffer(frameCapture, vertexBuffer.resource, vertexBuffer.offset, vertexBuffer.gpuAddress, vBufferSize, RENDER_HEAP_DEFAULT, cubeMesh.vertices);
+
+	int iBufferSize = (int)cubeMesh.indexDataSize;
+
+	numCubeIndices = cubeMesh.header->indexCount;
+
+	hr = GpuHeapAllocatorCreateBuffer(gpuHeapAllocator, D3D12_HEAP_TYPE_DEFAULT, iBufferSize, D3D12_RESOURCE_STATE_COMMON, indexBuffer);
+	if (FAILED(hr)) {
+		MappedFileClose(meshFile);
+		Running = false;
+		return false;
+	}
+
+	UploadArenaAllocation iBufferUpload;
+	if (!UploadArenaAllocate(uploadArena, iBufferSize, UploadArenaBufferAlignment, iBufferUpload)) {
+		MappedFileClose(meshFile);
+		Running = false;
+		return false;
+	}
+
+	memcpy(iBufferUpload.cpuAddress, cubeMesh.indices, iBufferSize);
+
+	copyCommandList->CopyBufferRegion(indexBuffer.resource, indexBuffer.offset, static_cast<ID3D12Resource*>(uploadArena.userData), iBufferUpload.offset, iBufferSize);
+
+	if (FrameCapture)
+		RenderCaptureAddBuffer(frameCapture, indexBuffer.resource, indexBuffer.offset, indexBuffer.gpuAddress, iBufferSize, RENDER_HEAP_DEFAULT, cubeMesh.indices);
+
+	// the cpu culls with the meshlet bounds, the mesh shader reads the other three sections
+	UINT meshletCount = cubeMesh.header->meshletCount;
+	cubeMeshlets.assign(cubeMesh.meshlets, cubeMesh.meshlets + meshletCount);
+	cubeMeshletBounds.assign(cubeMesh.meshletBounds, cubeMesh.meshletBounds + meshletCount);
+
+	// sections start on 256 bytes like constant buffers, more than root shader resource views need
+	UINT64 meshletVertexStart = (meshletCount * sizeof(Meshlet) + 255) & ~255;
+	UINT64 meshletTriangleStart = meshletVertexStart + ((cubeMesh.header->meshletVertexCount * sizeof(uint32_t) + 255) & ~255);
+	UINT64 meshletBufferSize = meshletTriangleStart + cubeMesh.header->meshletTriangleCount * sizeof(uint32_t);
+
+	hr = GpuHeapAllocatorCreateBuffer(gpuHeapAllocator, D3D12_HEAP_TYPE_DEFAULT, meshletBufferSize, D3D12_RESOURCE_STATE_COMMON, meshletBuffer);
+	if (FAILED(hr)) {
+		MappedFileClose(meshFile);
+		Running = false;
+		return false;
+	}
+
+	UploadArenaAllocation meshletUpload;
+	if (!UploadArenaAllocate(uploadArena, meshletBufferSize, UploadArenaBufferAlignment, meshletUpload)) {
+		MappedFileClose(meshFile);
+		Running = false;
+		return false;
+	}
+
+	UINT8* meshletStaging = static_cast<UINT8*>(meshletUpload.cpuAddress);
+	memcpy(meshletStaging, cubeMesh.meshlets, meshletCount * sizeof(Meshlet));
+	memcpy(meshletStaging + meshletVertexStart, cubeMesh.meshletVertices, cubeMesh.header->meshletVertexCount * sizeof(uint32_t));
+	memcpy(meshletStaging + meshletTriangleStart, cubeMesh.meshletTriangles, cubeMesh.header->meshletTriangleCount * sizeof(uint32_t));
+
+	copyCommandList->CopyBufferRegion(meshletBuffer.resource, meshletBuffer.offset, static_cast<ID3D12Resource*>(uploadArena.userData), meshletUpload.offset, meshletBufferSize);
+
+	if (FrameCapture)
+		RenderCaptureAddBuffer(frameCapture, meshletBuffer.resource, meshletBuffer.offset, meshletBuffer.gpuAddress, meshletBufferSize, RENDER_HEAP_DEFAULT, meshletStaging);
+
+	meshletAddress = meshletBuffer.gpuAddress;
+	meshletVertexAddress = meshletBuffer.gpuAddress + meshletVertexStart;
+	meshletTriangleAddress = meshletBuffer.gpuAddress + meshletTriangleStart;
+
+	// only the header is used from here on, it is small enough to keep around
+	MeshFileHeader cubeMeshHeader = *cubeMesh.header;
+	MappedFileClose(meshFile);
+
+	for (int i = 0; i < 3; ++i) {
+		cubeDequantization[i] = cubeMeshHeader.positionScale[i];
+		cubeDequantization[4 + i] = cubeMeshHeader.positionOffset[i];
+		cubeBoundsMin[i] = cubeMeshHeader.boundsMin[i];
+		cubeBoundsMax[i] = cubeMeshHeader.boundsMax[i];
+	}
+
+	copyCommandList->Close();
+	ID3D12CommandList* ppCopyCommandLists[] = { copyCommandList };
+	copyQueue->ExecuteCommandLists(_countof(ppCopyCommandLists), ppCopyCommandLists);
+
+	hr = copyQueue->Signal(copyFence, ++copyFenceValue);
+	if (FAILED(hr)) {
+		Running = false;
+		return false;
+	}
+
+	// the graphics queue holds off until the copies have landed, the cpu does not wait for them
+	hr = commandQueue->Wait(copyFence, copyFenceValue);
+	if (FAILED(hr)) {
+		Running = false;
+		return false;
+	}
+
+	// no transitions, the buffers live in a shared buffer page that is never moved out of the common state
+	// buffers are promoted to vertex, index or shader resource state on first use and decay back at the end of each list
+
+	// the vertex shaders are compiled for the layout the mesh was cooked with, VertexInput.hlsli reads the defines
+	VertexLayoutDefine layoutDefines[vertexLayoutDefineCount];
+	GetVertexLayoutDefines(cubeMeshHeader.vertexLayout, layoutDefines);
+
+	D3D_SHADER_MACRO vertexShaderDefines[vertexLayoutDefineCount + 1] = {};
+	for (uint32_t i = 0; i < vertexLayoutDefineCount; ++i) {
+		vertexShaderDefines[i].Name = layoutDefines[i].name;
+		vertexShaderDefines[i].Definition = layoutDefines[i].value;
+	}
+
 	// blobs store data of arbitrary length
 	// this blob stores the vertex shader bytecode
 	ID3DBlob* vertexShader;
 	// blob to see error if there is one
 	ID3DBlob* errorBuffer;
-	hr = D3DCompileFromFile(L"VertexShader.hlsl", nullptr, nullptr, "main", "vs_5_0", D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION, 0, &vertexShader, &errorBuffer);
+	hr = D3DCompileFromFile(L"VertexShader.hlsl", vertexShaderDefines, D3D_COMPILE_STANDARD_FILE_INCLUDE, "main", "vs_5_0", D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION, 0, &vertexShader, &errorBuffer);
 	if (FAILED(hr)) {
 		OutputDebugStringA((char*)errorBuffer->GetBufferPointer());
 		return false;
@@ -453,7 +582,7 @@ bool InitD3D() {
 	vertexShaderBytecode.pShaderBytecode = vertexShader->GetBufferPointer();
 
 	ID3DBlob* pixelShader;
-	hr = D3DCompileFromFile(L"PixelShader.hlsl", nullptr, nullptr, "main", "ps_5_0", D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION, 0, &pixelShader, &errorBuffer);
+	hr = D3DCompileFromFile(L"PixelShader.hlsl", nullptr, nullptr, "main", "ps_5_1", D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION, 0, &pixelShader, &errorBuffer);
 	if (FAILED(hr)) {
 		OutputDebugStringA((char*)errorBuffer->GetBufferPointer());
 		return false;
@@ -463,16 +592,17 @@ bool InitD3D() {
 	pixelShaderBytecode.BytecodeLength = pixelShader->GetBufferSize();
 	pixelShaderBytecode.pShaderBytecode = pixelShader->GetBufferPointer();
 
-	// this includes information such as position, uv coords
-	D3D12_INPUT_ELEMENT_DESC inputLayout[] =
-	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
-	};
+	// this includes information such as position, uv coords, in the formats the mesh was cooked with
+	VertexLayoutElement layoutElements[vertexLayoutMaxElements];
+	uint32_t layoutElementCount = GetVertexLayoutElements(cubeMeshHeader.vertexLayout, layoutElements);
+
+	D3D12_INPUT_ELEMENT_DESC inputLayout[vertexLayoutMaxElements];
+	for (uint32_t i = 0; i < layoutElementCount; ++i)
+		inputLayout[i] = { layoutElements[i].semanticName, 0, (DXGI_FORMAT)layoutElements[i].format, 0, layoutElements[i].offset, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 };
 
 	D3D12_INPUT_LAYOUT_DESC inputLayoutDesc = {};
 
-	inputLayoutDesc.NumElements = sizeof(inputLayout) / sizeof(D3D12_INPUT_ELEMENT_DESC);
+	inputLayoutDesc.NumElements = layoutElementCount;
 	inputLayoutDesc.pInputElementDescs = inputLayout;
 
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
@@ -490,317 +620,125 @@ bool InitD3D() {
 	psoDesc.NumRenderTargets = 1;
 	psoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
 
-	hr = device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pipelineStateObject));
+	hr = PipelineCacheCreateGraphicsPipeline(pipelineCache, psoDesc, rootSignatureHash, &pipelineStateObject);
 	if (FAILED(hr))
 		return false;
 
-	Vertex vList[] = {
-		// front face
-		{ -0.5f,  0.5f, -0.5f, 0.0f, 0.0f },
-		{  0.5f, -0.5f, -0.5f, 1.0f, 1.0f },
-		{ -0.5f, -0.5f, -0.5f, 0.0f, 1.0f },
-		{  0.5f,  0.5f, -0.5f, 1.0f, 0.0f },
-
-		// right side face
-		{  0.5f, -0.5f, -0.5f, 0.0f, 1.0f },
-		{  0.5f,  0.5f,  0.5f, 1.0f, 0.0f },
-		{  0.5f, -0.5f,  0.5f, 1.0f, 1.0f },
-		{  0.5f,  0.5f, -0.5f, 0.0f, 0.0f },
-
-		// left side face
-		{ -0.5f,  0.5f,  0.5f, 0.0f, 0.0f },
-		{ -0.5f, -0.5f, -0.5f, 1.0f, 1.0f },
-		{ -0.5f, -0.5f,  0.5f, 0.0f, 1.0f },
-		{ -0.5f,  0.5f, -0.5f, 1.0f, 0.0f },
-
-		// back face
-		{  0.5f,  0.5f,  0.5f, 0.0f, 0.0f },
-		{ -0.5f, -0.5f,  0.5f, 1.0f, 1.0f },
-		{  0.5f, -0.5f,  0.5f, 0.0f, 1.0f },
-		{ -0.5f,  0.5f,  0.5f, 1.0f, 0.0f },
-
-		// top face
-		{ -0.5f,  0.5f, -0.5f, 0.0f, 1.0f },
-		{  0.5f,  0.5f,  0.5f, 1.0f, 0.0f },
-		{  0.5f,  0.5f, -0.5f, 1.0f, 1.0f },
-		{ -0.5f,  0.5f,  0.5f, 0.0f, 0.0f },
-
-		// bottom face
-		{  0.5f, -0.5f,  0.5f, 0.0f, 0.0f },
-		{ -0.5f, -0.5f, -0.5f, 1.0f, 1.0f },
-		{  0.5f, -0.5f, -0.5f, 0.0f, 1.0f },
-		{ -0.5f, -0.5f,  0.5f, 1.0f, 0.0f },
-	};
-
-	int vBufferSize = sizeof(vList);
-
-	// create default heap, which is memory in gpu that only gpu has access to
-	device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(vBufferSize),
-		// copy dest since data will be copied from the upload heap to the default heap
-		D3D12_RESOURCE_STATE_COPY_DEST,
-		nullptr,
-		IID_PPV_ARGS(&vertexBuffer)
-	);
-
-	vertexBuffer->SetName(L"Vertex Buffer Resource Heap");
-
-	// create upload heap which uploads data to gpu which cpu can write to and gpu can read from
-	ID3D12Resource* vBufferUploadHeap;
-	device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(vBufferSize),
-		// set as read because gpu will read from the buffer
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(&vBufferUploadHeap)
-	);
-
-	vBufferUploadHeap->SetName(L"Vertex Buffer Upload Resource Heap");
-
-	// buffer contains one subresource
-	D3D12_SUBRESOURCE_DATA vertexData = {};
-	vertexData.pData = reinterpret_cast<BYTE*>(vList);
-	// because the array is 1D, the row pitch is the same as the slicepitch
-	// slicepitch is only different in 2D arrays
-	vertexData.RowPitch = vBufferSize;
-	vertexData.SlicePitch = vBufferSize;
-
-	// update subresources in the vertexBuffer using the data in vBufferUploadHeap
-	UpdateSubresources(commandList, vertexBuffer, vBufferUploadHeap, 0, 0, 1, &vertexData);
-
-	// transition vertex buffer data to vertex buffer state (it started in copy destination state above)
-	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(vertexBuffer, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER));
-
-	// index list
-	DWORD iList[] = {
-		0, 1, 2,
-		0, 3, 1,
-
-		4, 5, 6, 
-		4, 7, 5, 
-
-		8, 9, 10, 
-		8, 11, 9,
-
-		12, 13, 14,
-		12, 15, 13,
-
-		16, 17, 18,
-		16, 19, 17,
-
-		20, 21, 22,
-		20, 23, 21,
-	};
-
-	int iBufferSize = sizeof(iList);
-
-	numCubeIndices = sizeof(iList) / sizeof(DWORD);
-
-	device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(iBufferSize),
-		D3D12_RESOURCE_STATE_COPY_DEST,
-		nullptr,
-		IID_PPV_ARGS(&indexBuffer)
-	);
-
-	indexBuffer->SetName(L"Index Buffer Resource Heap");
-
-	ID3D12Resource* iBufferUploadHeap;
-	device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(vBufferSize),
-		// set as read because gpu will read from the buffer
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(&iBufferUploadHeap)
-	);
-
-	iBufferUploadHeap->SetName(L"Index Buffer Upload Resource Heap");
-
-	D3D12_SUBRESOURCE_DATA indexData = {};
-	indexData.pData = reinterpret_cast<BYTE*>(iList);
-	indexData.RowPitch = iBufferSize;
-	indexData.SlicePitch = iBufferSize;
-
-	UpdateSubresources(commandList, indexBuffer, iBufferUploadHeap, 0, 0, 1, &indexData);
-
-	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(indexBuffer, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER));
-
-	// create depth/stencil buffer
-	// Depth Stencil View
-	D3D12_DESCRIPTOR_HEAP_DESC dsvHeapDesc = {};
-	dsvHeapDesc.NumDescriptors = 1;
-	dsvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
-	dsvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-	hr = device->CreateDescriptorHeap(&dsvHeapDesc, IID_PPV_ARGS(&dsDescriptorHeap));
-	if (FAILED(hr))
-		Running = false;
-
-	D3D12_DEPTH_STENCIL_VIEW_DESC depthStencilDesc = {};
-	depthStencilDesc.Format = DXGI_FORMAT_D32_FLOAT;
-	depthStencilDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
-	depthStencilDesc.Flags = D3D12_DSV_FLAG_NONE;
-
-	D3D12_CLEAR_VALUE depthOptimizedClearValue = {};
-	depthOptimizedClearValue.Format = DXGI_FORMAT_D32_FLOAT;
-	depthOptimizedClearValue.DepthStencil.Depth = 1.0f;
-	depthOptimizedClearValue.DepthStencil.Stencil = 0;
-
-	device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_D32_FLOAT, Width, Height, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL),
-		D3D12_RESOURCE_STATE_DEPTH_WRITE,
-		&depthOptimizedClearValue,
-		IID_PPV_ARGS(&depthStencilBuffer)
-	);
+	// same state, but the vertex shader reads its matrix from the instance buffer
+	ID3DBlob* instancedVertexShader;
+	hr = D3DCompileFromFile(L"InstancedVertexShader.hlsl", vertexShaderDefines, D3D_COMPILE_STANDARD_FILE_INCLUDE, "main", "vs_5_0", D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION, 0, &instancedVertexShader, &errorBuffer);
+	if (FAILED(hr)) {
+		OutputDebugStringA((char*)errorBuffer->GetBufferPointer());
+		return false;
+	}
 
-	dsDescriptorHeap->SetName(L"Depth/Stencil Resource Heap");
+	psoDesc.VS.BytecodeLength = instancedVertexShader->GetBufferSize();
+	psoDesc.VS.pShaderBytecode = instancedVertexShader->GetBufferPointer();
 
-	device->CreateDepthStencilView(depthStencilBuffer, &depthStencilDesc, dsDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
+	hr = PipelineCacheCreateGraphicsPipeline(pipelineCache, psoDesc, rootSignatureHash, &instancedPipelineStateObject);
+	if (FAILED(hr))
+		return false;
 
+	// without mesh shaders, visible meshlets are drawn straight from the index buffer with arguments culling wrote
+	D3D12_INDIRECT_ARGUMENT_DESC meshletArgument = {};
+	meshletArgument.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
 
-	for (int i = 0; i < frameBufferCount; ++i) {
-		hr = device->CreateCommittedResource(
-			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-			D3D12_HEAP_FLAG_NONE,
-			&CD3DX12_RESOURCE_DESC::Buffer(1024 * 64), // 64 KB multiple
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS(&constantBufferUploadHeaps[i])
-		);
-		constantBufferUploadHeaps[i]->SetName(L"Constant Buffer Upload Resource Heap");
-	
-		// for previous color data
-		/*
-		D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
-		cbvDesc.BufferLocation = constantBufferUploadHeaps[i]->GetGPUVirtualAddress();
-		cbvDesc.SizeInBytes = (sizeof(ConstantBuffer) + 255) & ~255; // has to be 256 byte aligned?
-		device->CreateConstantBufferView(&cbvDesc, mainDescriptorHeap[i]->GetCPUDescriptorHandleForHeapStart());
-		
-		ZeroMemory(&cbColorMultiplierData, sizeof(cbColorMultiplierData));
-		*/
+	D3D12_COMMAND_SIGNATURE_DESC meshletSignatureDesc = {};
+	meshletSignatureDesc.ByteStride = sizeof(MeshletDrawArguments);
+	meshletSignatureDesc.NumArgumentDescs = 1;
+	meshletSignatureDesc.pArgumentDescs = &meshletArgument;
 
-		ZeroMemory(&cbPerObject, sizeof(cbPerObject));
+	// no root signature, the arguments do not change root parameters
+	hr = device->CreateCommandSignature(&meshletSignatureDesc, nullptr, IID_PPV_ARGS(&meshletCommandSignature));
+	if (FAILED(hr))
+		return false;
 
-		// cpu will not read from constant buffer
-		CD3DX12_RANGE readRange(0, 0);
-		/*
-		hr = constantBufferUploadHeaps[i]->Map(0, &readRange, reinterpret_cast<void**>(&cbColorMultiplierGPUAddress[i]));
-		memcpy(cbColorMultiplierGPUAddress[i], &cbColorMultiplierData, sizeof(cbColorMultiplierData));
-		*/
-		hr = constantBufferUploadHeaps[i]->Map(0, &readRange, reinterpret_cast<void**>(&cbvGPUAddress[i]));
+	// the fallback is always there, so not getting mesh shaders is not an error
+	if (!CreateMeshletPipeline(psoDesc, vertexShaderDefines)) {
+		SAFE_RELEASE(meshletPipelineStateObject);
+		SAFE_RELEASE(meshletRootSignature);
+		ShaderCompilerShutdown(shaderCompiler);
+	}
 
-		// remember 256 bit alignments
-		memcpy(cbvGPUAddress[i], &cbPerObject, sizeof(cbPerObject));
-		memcpy(cbvGPUAddress[i] + ConstantBufferPerObjectAlignedSize, &cbPerObject, sizeof(cbPerObject));
+	// compute shaders and ExecuteIndirect are on every d3d12 device, so this one has no fallback
+	// made whatever the mode is, F9 can switch to it later
+	if (!CreateGpuDrivenPipeline(psoDesc, vertexShaderDefines, rootSignatureHash) || !CreateGpuSceneBuffers()) {
+		Running = false;
+		return false;
 	}
 
-	D3D12_RESOURCE_DESC textureDesc;
-	int imageBytesPerRow;
-	BYTE* imageData;
-	int imageSize = LoadImageDataFromFile(&imageData, textureDesc, L"smile.jpg", imageBytesPerRow);
+	// new pipelines are written right away, a failed save only costs the next start its warm cache
+	PipelineCacheSave(pipelineCache);
 
-	if (imageSize <= 0) {
+	// create depth/stencil buffer
+	// Depth Stencil View
+	if (!CpuDescriptorHeapInit(dsDescriptorHeap, device, D3D12_DESCRIPTOR_HEAP_TYPE_DSV, cpuDescriptorHeapDefaultPageSize) || !CpuDescriptorHeapAllocate(dsDescriptorHeap, depthStencilView)) {
 		Running = false;
 		return false;
 	}
 
-	hr = device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-		D3D12_HEAP_FLAG_NONE,
-		&textureDesc,
-		D3D12_RESOURCE_STATE_COPY_DEST,
-		nullptr,
-		IID_PPV_ARGS(&textureBuffer)
-	);
-	if (FAILED(hr)) {
+	// the frame graph decides where the depth buffer goes and which state it is created in
+	if (!BuildFrameGraph() || !CreateFrameGraphTransients()) {
 		Running = false;
 		return false;
 	}
-	textureBuffer->SetName(L"Texture Buffer Resource Heap");
+	CreateDepthStencilView();
 
-	UINT64 textureUploadBufferSize;
-	// texture upload heap must be 256 byte aligned
-	device->GetCopyableFootprints(&textureDesc, 0, 1, 0, nullptr, nullptr, nullptr, &textureUploadBufferSize);
+	// constant buffers are allocated every frame from upload heap pages
+	FrameAllocatorInit(frameAllocator, FrameAllocatorDefaultPageSize, CreateUploadPage, DestroyUploadPage, frameDevice);
 
-	hr = device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(textureUploadBufferSize),
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(&textureBufferUploadHeap)
-	);
-	if (FAILED(hr)) {
+	// shader visible heap, the texture loader puts the placeholder and every streamed texture in its bindless region
+	if (!GpuDescriptorHeapInit(mainDescriptorHeap, device, bindlessDescriptorCount, transientDescriptorCount)) {
 		Running = false;
 		return false;
 	}
-	textureBufferUploadHeap->SetName(L"Texture Buffer Upload Resource Heap");
-
-	D3D12_SUBRESOURCE_DATA textureData = {};
-	textureData.pData = &imageData[0];
-	textureData.RowPitch = imageBytesPerRow;
-	textureData.SlicePitch = imageBytesPerRow * textureDesc.Height;
-
-	UpdateSubresources(commandList, textureBuffer, textureBufferUploadHeap, 0, 0, 1, &textureData);
 
-	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(textureBuffer, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+	// images are decoded and uploaded in the background, the first frames draw with the placeholder
+	int decodeThreadCount = (int)std::thread::hardware_concurrency() - 1;
+	if (decodeThreadCount < 1)
+		decodeThreadCount = 1;
+	if (decodeThreadCount > maxTextureDecodeThreads)
+		decodeThreadCount = maxTextureDecodeThreads;
 
-	// descriptor heaps
-		D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
-		heapDesc.NumDescriptors = 1;
-		heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-		heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-		hr = device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&mainDescriptorHeap));
-		if (FAILED(hr))
-			Running = false;
+	if (!TextureLoaderInit(textureLoader, device, copyQueue, &mainDescriptorHeap, maxStreamedTextures, decodeThreadCount, &uploadArena, &gpuHeapAllocator, &resourceStates)) {
+		Running = false;
+		return false;
+	}
 
-		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-		// 1 to 1 mapping
-		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-		srvDesc.Format = textureDesc.Format;
-		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-		srvDesc.Texture2D.MipLevels = 1;
-		device->CreateShaderResourceView(textureBuffer, &srvDesc, mainDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
+	smileTexture = TextureLoaderRequest(textureLoader, L"smile.jpg");
+	sceneTextureIndex = TextureLoaderGetDescriptorIndex(textureLoader, smileTexture);
 
 	// execute command list
-	commandList->Close();
-	ID3D12CommandList* ppCommandLists[] = { commandList };
-	commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+	RenderCommandListClose(commandList);
+	RenderQueueExecute(graphicsQueue, &commandList, 1);
 
-	// increment fence value to ensure data is uploaded before drawing
-	fenceValue[frameIndex]++;
-	hr = commandQueue->Signal(fence[frameIndex], fenceValue[frameIndex]);
-	if (FAILED(hr)) {
+	// the first frame reuses this allocator, so it waits for the uploads to finish
+	frameFenceValues[frameContextIndex] = SignalQueue();
+	if (frameFenceValues[frameContextIndex] == 0) {
 		Running = false;
 		return false;
 	}
 
-	delete imageData;
+	// staging space of the vertex and index buffers is free again once the copies are done
+	UploadArenaRelease(uploadArena, vBufferUpload, copyFence, copyFenceValue);
+	UploadArenaRelease(uploadArena, iBufferUpload, copyFence, copyFenceValue);
+	UploadArenaRelease(uploadArena, meshletUpload, copyFence, copyFenceValue);
 
-	vertexBufferView.BufferLocation = vertexBuffer->GetGPUVirtualAddress();
+	vertexBufferView.gpuAddress = vertexBuffer.gpuAddress;
 	// stride is the total size of an array slot (can be bigger than an array element, which means extra space between elements)
-	vertexBufferView.StrideInBytes = sizeof(Vertex);
-	vertexBufferView.SizeInBytes = vBufferSize;
+	vertexBufferView.stride = cubeMeshHeader.vertexStride;
+	vertexBufferView.size = vBufferSize;
 
-	indexBufferView.BufferLocation = indexBuffer->GetGPUVirtualAddress();
-	indexBufferView.Format = DXGI_FORMAT_R32_UINT;
-	indexBufferView.SizeInBytes = iBufferSize;
+	indexBufferView.gpuAddress = indexBuffer.gpuAddress;
+	indexBufferView.format = cubeMeshHeader.indexFormat;
+	indexBufferView.size = iBufferSize;
 
-	viewport.TopLeftX = 0;
-	viewport.TopLeftY = 0;
-	viewport.Width = Width;
-	viewport.Height = Height;
-	viewport.MinDepth = 0.0f;
-	viewport.MaxDepth = 1.0f;
+	viewport.x = 0;
+	viewport.y = 0;
+	viewport.width = (float)Width;
+	viewport.height = (float)Height;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
 
 	scissorRect.left = 0;
 	scissorRect.top = 0;
@@ -821,204 +759,1342 @@ bool InitD3D() {
 	tmpMat = DirectX::XMMatrixLookAtLH(cPos, cTarg, cUp);
 	DirectX::XMStoreFloat4x4(&cameraViewMat, tmpMat);
 
-	cube1Position = DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
-	DirectX::XMVECTOR posVec = XMLoadFloat4(&cube1Position);
+	// cube 2 is a child of cube 1, so it follows cube 1's rotation
+	// props are small static cubes laid out in a grid below the two cubes
+	TransformHierarchyInit(sceneTransforms, sceneNodeCount);
+
+	DirectX::XMVECTOR identityRotation = DirectX::XMQuaternionIdentity();
+
+	cube1Node = TransformHierarchyAddNode(sceneTransforms, -1, DirectX::XMVectorZero(), identityRotation, DirectX::XMVectorSplatOne());
+	cube2Node = TransformHierarchyAddNode(sceneTransforms, cube1Node, DirectX::XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f), identityRotation, DirectX::XMVectorReplicate(0.5f));
 
-	tmpMat = DirectX::XMMatrixTranslationFromVector(posVec);
-	DirectX::XMStoreFloat4x4(&cube1RotMat, DirectX::XMMatrixIdentity());
-	DirectX::XMStoreFloat4x4(&cube1WorldMat, tmpMat);
+	for (int z = 0; z < propGridWidth; ++z) {
+		for (int x = 0; x < propGridWidth; ++x) {
+			float propX = (x - propGridWidth * 0.5f) * propSpacing;
+			float propZ = z * propSpacing;
 
-	cube2PositionOffset = DirectX::XMFLOAT4(1.0f, 0.0f, 0.0f, 0.0f);
-	posVec = DirectX::XMLoadFloat4(&cube2PositionOffset) + DirectX::XMLoadFloat4(&cube1Position);
+			TransformHierarchyAddNode(sceneTransforms, -1, DirectX::XMVectorSet(propX, -1.0f, propZ, 0.0f), identityRotation, DirectX::XMVectorReplicate(0.2f));
+		}
+	}
 
-	tmpMat = DirectX::XMMatrixTranslationFromVector(posVec);
-	DirectX::XMStoreFloat4x4(&cube2RotMat, DirectX::XMMatrixIdentity());
-	DirectX::XMStoreFloat4x4(&cube2WorldMat, tmpMat);
+	// the hierarchy is built around the starting positions, so the world matrices have to exist first
+	TransformHierarchyUpdate(sceneTransforms);
+	BuildSceneBvh();
 
 	return true;
 }
 
-// update game logic
-void Update() {
-	DirectX::XMFLOAT4 upVector = DirectX::XMFLOAT4(0.0f, 1.0f, 0.0f, 0.0f);
-	DirectX::XMVECTOR rotAxis = DirectX::XMLoadFloat4(&upVector);
+// every node is drawn with the cube mesh, so its box is the cube's box in world space
+void BuildSceneBvh() {
+	UINT count = (UINT)sceneTransforms.nodeCount;
+	std::vector<float> boundsMin(count * 3);
+	std::vector<float> boundsMax(count * 3);
+	for (UINT i = 0; i < count; ++i)
+		TransformBounds(&sceneTransforms.worldMats[i].m[0][0], cubeBoundsMin, cubeBoundsMax, &boundsMin[i * 3], &boundsMax[i * 3]);
 
-	DirectX::XMMATRIX rotMat = DirectX::XMLoadFloat4x4(&cube1RotMat) * DirectX::XMMatrixRotationAxis(rotAxis, 0.0001f);
-	DirectX::XMStoreFloat4x4(&cube1RotMat, rotMat);
+	CullingBvhBuild(sceneBvh, &boundsMin[0], &boundsMax[0], count);
+	visibleNodes.resize(count);
+}
 
-	DirectX::XMMATRIX translationMat = DirectX::XMMatrixTranslationFromVector(XMLoadFloat4(&cube1Position));
-	DirectX::XMMATRIX worldMat = rotMat * translationMat;
-	DirectX::XMStoreFloat4x4(&cube1WorldMat, worldMat);
+// only nodes whose world matrix changed in the last update get a new box
+void RefitSceneBvh() {
+	PROFILE_SCOPE("RefitSceneBvh");
 
-	DirectX::XMMATRIX viewMat = DirectX::XMLoadFloat4x4(&cameraViewMat);
-	DirectX::XMMATRIX projMat = DirectX::XMLoadFloat4x4(&cameraProjMat);
-	DirectX::XMMATRIX wvpMat = DirectX::XMLoadFloat4x4(&cube1WorldMat) * viewMat * projMat;
-	// transposed because DirectX math library is row major, not column major
-	DirectX::XMMATRIX transposed = DirectX::XMMatrixTranspose(wvpMat);
-	DirectX::XMStoreFloat4x4(&cbPerObject.wvpMat, transposed);
+	UINT count = (UINT)sceneTransforms.nodeCount;
+	for (UINT i = 0; i < count; ++i) {
+		if (!sceneTransforms.updated[i])
+			continue;
 
-	memcpy(cbvGPUAddress[frameIndex], &cbPerObject, sizeof(cbPerObject));
+		float boundsMin[3], boundsMax[3];
+		TransformBounds(&sceneTransforms.worldMats[i].m[0][0], cubeBoundsMin, cubeBoundsMax, boundsMin, boundsMax);
+		CullingBvhSetBounds(sceneBvh, i, boundsMin, boundsMax);
+	}
+
+	CullingBvhRefit(sceneBvh);
+}
 
-	// cube 2
-	DirectX::XMStoreFloat4x4(&cube2RotMat, rotMat);
-	DirectX::XMMATRIX translationOffsetMat = DirectX::XMMatrixTranslationFromVector(DirectX::XMLoadFloat4(&cube2PositionOffset));
+// world space planes of the camera, for the cpu and the gpu culling alike
+void GetCameraFrustum(DirectX::FXMMATRIX viewProjMat, CullingFrustum& frustum) {
+	// the same matrix the shaders get, which has clip space positions in its rows
+	DirectX::XMFLOAT4X4 clipFromWorld;
+	DirectX::XMStoreFloat4x4(&clipFromWorld, DirectX::XMMatrixTranspose(viewProjMat));
 
-	DirectX::XMMATRIX scaleMat = DirectX::XMMatrixScaling(0.5f, 0.5f, 0.5f);
-	worldMat = scaleMat * translationOffsetMat * rotMat * translationMat;
+	CullingFrustumInit(frustum, &clipFromWorld.m[0][0]);
+}
 
-	wvpMat = XMLoadFloat4x4(&cube2WorldMat) * viewMat * projMat; 
-	transposed = XMMatrixTranspose(wvpMat);
-	XMStoreFloat4x4(&cbPerObject.wvpMat, transposed);
+// fills visibleNodes with the nodes inside the camera frustum and returns how many
+UINT CullScene(DirectX::FXMMATRIX viewProjMat) {
+	PROFILE_SCOPE("CullScene");
 
-	memcpy(cbvGPUAddress[frameIndex] + ConstantBufferPerObjectAlignedSize, &cbPerObject, sizeof(cbPerObject));
+	CullingFrustum frustum;
+	GetCameraFrustum(viewProjMat, frustum);
 
-	XMStoreFloat4x4(&cube2WorldMat, worldMat);
+	return CullingBvhCull(sceneBvh, frustum, &visibleNodes[0]);
 }
 
-void UpdatePipeline() {
+// the scene pipeline's state with a mesh shader instead of the input assembler and vertex shader
+bool CreateMeshletPipeline(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& psoDesc, const D3D_SHADER_MACRO* defines) {
 	HRESULT hr;
 
-	WaitForPreviousFrame();
+	D3D12_FEATURE_DATA_D3D12_OPTIONS7 options7 = {};
+	hr = device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS7, &options7, sizeof(options7));
+	if (FAILED(hr) || options7.MeshShaderTier == D3D12_MESH_SHADER_TIER_NOT_SUPPORTED)
+		return false;
 
-	hr = commandAllocator[frameIndex]->Reset();
-	if (FAILED(hr))
-		Running = false;
+	if (!ShaderCompilerInit(shaderCompiler))
+		return false;
 
-	// resetting allows commands to start being recorded
-	hr = commandList->Reset(commandAllocator[frameIndex], pipelineStateObject);
+	// the pixel shader is compiled again, dxil and dxbc shaders cannot be mixed in one pipeline
+	IDxcBlob* meshShader;
+	IDxcBlob* pixelShader;
+	IDxcBlob* errorBuffer;
+	hr = ShaderCompilerCompileFromFile(shaderCompiler, L"MeshletMeshShader.hlsl", defines, L"main", L"ms_6_5", &meshShader, &errorBuffer);
+	if (errorBuffer != nullptr) {
+		OutputDebugStringA((char*)errorBuffer->GetBufferPointer());
+		errorBuffer->Release();
+	}
 	if (FAILED(hr))
-		Running = false;
-
-	// recording commands
-	// note that doing something bad during recording does not stop program from running (dx12)
-
-	// resource barrier changes the resource state to a render target state in order to change the 
-	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(renderTargets[frameIndex], D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
+		return false;
 
-	CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(rtvDescriptorHeap->GetCPUDescriptorHandleForHeapStart(), frameIndex, rtvDescriptorSize);
+	hr = ShaderCompilerCompileFromFile(shaderCompiler, L"PixelShader.hlsl", nullptr, L"main", L"ps_6_5", &pixelShader, &errorBuffer);
+	if (errorBuffer != nullptr) {
+		OutputDebugStringA((char*)errorBuffer->GetBufferPointer());
+		errorBuffer->Release();
+	}
+	if (FAILED(hr)) {
+		meshShader->Release();
+		return false;
+	}
 
-	CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle(dsDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
+	// same slots as rootSignature for what both have, so the draw state is set the same way
+	D3D12_DESCRIPTOR_RANGE bindlessRange = {};
+	bindlessRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+	bindlessRange.NumDescriptors = UINT_MAX;
+	bindlessRange.BaseShaderRegister = 0;
+	bindlessRange.RegisterSpace = 1;
+	bindlessRange.OffsetInDescriptorsFromTableStart = 0;
+
+	CD3DX12_ROOT_PARAMETER rootParameters[9];
+	rootParameters[0].InitAsConstantBufferView(0, 0, D3D12_SHADER_VISIBILITY_MESH);
+	rootParameters[1].InitAsDescriptorTable(1, &bindlessRange, D3D12_SHADER_VISIBILITY_PIXEL);
+	// meshlets, t2
+	rootParameters[2].InitAsShaderResourceView(2, 0, D3D12_SHADER_VISIBILITY_MESH);
+	rootParameters[3].InitAsConstants(1, 1, 0, D3D12_SHADER_VISIBILITY_PIXEL);
+	rootParameters[4].InitAsConstants(_countof(cubeDequantization), 2, 0, D3D12_SHADER_VISIBILITY_MESH);
+	// vertices, meshlet vertices, meshlet triangles and the visible meshlets of the draw, t3 to t6
+	for (UINT i = 0; i < 4; ++i)
+		rootParameters[5 + i].InitAsShaderResourceView(3 + i, 0, D3D12_SHADER_VISIBILITY_MESH);
+
+	D3D12_STATIC_SAMPLER_DESC sampler = CD3DX12_STATIC_SAMPLER_DESC(0, D3D12_FILTER_MIN_LINEAR_MAG_POINT_MIP_LINEAR,
+		D3D12_TEXTURE_ADDRESS_MODE_BORDER, D3D12_TEXTURE_ADDRESS_MODE_BORDER, D3D12_TEXTURE_ADDRESS_MODE_BORDER,
+		0.0f, 0, D3D12_COMPARISON_FUNC_NEVER, D3D12_STATIC_BORDER_COLOR_TRANSPARENT_BLACK, 0.0f, D3D12_FLOAT32_MAX, D3D12_SHADER_VISIBILITY_PIXEL);
 
-	// Output Merger
-	commandList->OMSetRenderTargets(1, &rtvHandle, FALSE, &dsvHandle);
+	CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc;
+	rootSignatureDesc.Init(_countof(rootParameters), rootParameters, 1, &sampler,
+		D3D12_ROOT_SIGNATURE_FLAG_DENY_VERTEX_SHADER_ROOT_ACCESS |
+		D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
+		D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
+		D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS |
+		D3D12_ROOT_SIGNATURE_FLAG_DENY_AMPLIFICATION_SHADER_ROOT_ACCESS);
 
-	const float clearColor[] = { 0.0f, 0.2f, 0.4f, 1.0f };
-	commandList->ClearRenderTargetView(rtvHandle, clearColor, 0, nullptr);
+	ID3DBlob* signature;
+	uint64_t meshletRootSignatureHash = 0;
+	hr = D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signature, nullptr);
+	if (SUCCEEDED(hr)) {
+		meshletRootSignatureHash = HashBytes(pipelineHashSeed, signature->GetBufferPointer(), signature->GetBufferSize());
+		hr = device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&meshletRootSignature));
+		signature->Release();
+	}
 
-	// clear depth buffer from last frame
-	commandList->ClearDepthStencilView(dsDescriptorHeap->GetCPUDescriptorHandleForHeapStart(), D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+	if (SUCCEEDED(hr)) {
+		D3DX12_MESH_SHADER_PIPELINE_STATE_DESC meshDesc = {};
+		meshDesc.pRootSignature = meshletRootSignature;
+		meshDesc.MS = { meshShader->GetBufferPointer(), meshShader->GetBufferSize() };
+		meshDesc.PS = { pixelShader->GetBufferPointer(), pixelShader->GetBufferSize() };
+		meshDesc.BlendState = psoDesc.BlendState;
+		meshDesc.SampleMask = psoDesc.SampleMask;
+		meshDesc.RasterizerState = psoDesc.RasterizerState;
+		meshDesc.DepthStencilState = psoDesc.DepthStencilState;
+		meshDesc.PrimitiveTopologyType = psoDesc.PrimitiveTopologyType;
+		meshDesc.NumRenderTargets = psoDesc.NumRenderTargets;
+		meshDesc.RTVFormats[0] = psoDesc.RTVFormats[0];
+		meshDesc.DSVFormat = psoDesc.DSVFormat;
+		meshDesc.SampleDesc = psoDesc.SampleDesc;
+
+		CD3DX12_PIPELINE_MESH_STATE_STREAM meshStream(meshDesc);
+		D3D12_PIPELINE_STATE_STREAM_DESC streamDesc = { sizeof(meshStream), &meshStream };
+		hr = PipelineCacheCreateStreamPipeline(pipelineCache, streamDesc, meshletRootSignatureHash, &meshletPipelineStateObject);
+	}
 
-	// draw triangles
-	commandList->SetGraphicsRootSignature(rootSignature);
+	meshShader->Release();
+	pixelShader->Release();
+	return SUCCEEDED(hr);
+}
 
-	ID3D12DescriptorHeap* descriptorHeaps[] = { mainDescriptorHeap };
-	commandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
+bool UseMeshShaders() {
+	return MeshletRendering && !InstancedRendering && !GpuDrivenRendering && meshletPipelineStateObject != nullptr;
+}
 
-	commandList->SetGraphicsRootDescriptorTable(1, mainDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
+// from the mode that is on to the next one in the order stdafx.h lists them
+// the frame graph only has the upload and cull passes with gpu driven rendering, so it is built again
+void SwitchRenderMode() {
+	WaitForGpuIdle();
+	DestroyFrameGraphTransients();
+
+	const char* name;
+	if (GpuDrivenRendering) {
+		GpuDrivenRendering = false;
+		InstancedRendering = true;
+		name = "instanced";
+	}
+	else if (InstancedRendering) {
+		InstancedRendering = false;
+		MeshletRendering = true;
+		name = UseMeshShaders() ? "meshlets through the mesh shader" : "meshlets through ExecuteIndirect";
+	}
+	else if (MeshletRendering) {
+		MeshletRendering = false;
+		name = "a draw per cube";
+	}
+	else {
+		GpuDrivenRendering = true;
+		name = "gpu driven";
+	}
 
-	commandList->RSSetViewports(1, &viewport);
-	commandList->RSSetScissorRects(1, &scissorRect);
-	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-	commandList->IASetVertexBuffers(0, 1, &vertexBufferView);
-	commandList->IASetIndexBuffer(&indexBufferView);
+	// neither side keeps up what only the other one uses: the scene buffer is not uploaded while the cpu culls
+	// and the bvh is not refit while the gpu does
+	sceneObjectsUploaded = false;
+	BuildSceneBvh();
 
-	// draw cube 1
-	commandList->SetGraphicsRootConstantBufferView(0, constantBufferUploadHeaps[frameIndex]->GetGPUVirtualAddress());
+	// nothing recorded for the old mode may be drawn in the new one
+	drawConstantBuffers.clear();
+	meshletDraws.clear();
+	instanceCount = 0;
 
-	commandList->DrawIndexedInstanced(numCubeIndices, 1, 0, 0, 0);
+	if (!BuildFrameGraph() || !CreateFrameGraphTransients()) {
+		Running = false;
+		return;
+	}
 
-	// draw cube 2
-	commandList->SetGraphicsRootConstantBufferView(0, constantBufferUploadHeaps[frameIndex]->GetGPUVirtualAddress() + ConstantBufferPerObjectAlignedSize);
+	// the depth buffer was placed again, the old view points at a released resource
+	CreateDepthStencilView();
 
-	commandList->DrawIndexedInstanced(numCubeIndices, 1, 0, 0, 0);
+	printf("render mode: %s\n", name);
+}
 
-	// transition back
-	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(renderTargets[frameIndex], D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
+// the culling shader and its root signature, the scene pipeline with a vertex shader that reads the scene buffer,
+// and the command signature the culling shader writes commands for
+bool CreateGpuDrivenPipeline(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& psoDesc, const D3D_SHADER_MACRO* defines, uint64_t rootSignatureHash) {
+	HRESULT hr;
 
-	hr = commandList->Close();
+	ID3DBlob* cullShader;
+	ID3DBlob* errorBuffer;
+	hr = D3DCompileFromFile(L"IndirectCullComputeShader.hlsl", nullptr, nullptr, "main", "cs_5_0", D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION, 0, &cullShader, &errorBuffer);
+	if (FAILED(hr)) {
+		OutputDebugStringA((char*)errorBuffer->GetBufferPointer());
+		return false;
+	}
+
+	// constants, objects, commands and the count, all root descriptors
+	CD3DX12_ROOT_PARAMETER cullParameters[4];
+	cullParameters[0].InitAsConstantBufferView(0);
+	cullParameters[1].InitAsShaderResourceView(0);
+	cullParameters[2].InitAsUnorderedAccessView(0);
+	cullParameters[3].InitAsUnorderedAccessView(1);
+
+	CD3DX12_ROOT_SIGNATURE_DESC cullSignatureDesc;
+	cullSignatureDesc.Init(_countof(cullParameters), cullParameters);
+
+	ID3DBlob* signature;
+	uint64_t cullRootSignatureHash = 0;
+	hr = D3D12SerializeRootSignature(&cullSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signature, nullptr);
+	if (SUCCEEDED(hr)) {
+		cullRootSignatureHash = HashBytes(pipelineHashSeed, signature->GetBufferPointer(), signature->GetBufferSize());
+		hr = device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&cullRootSignature));
+		signature->Release();
+	}
+
+	if (SUCCEEDED(hr)) {
+		D3D12_COMPUTE_PIPELINE_STATE_DESC cullDesc = {};
+		cullDesc.pRootSignature = cullRootSignature;
+		cullDesc.CS = { cullShader->GetBufferPointer(), cullShader->GetBufferSize() };
+		hr = PipelineCacheCreateComputePipeline(pipelineCache, cullDesc, cullRootSignatureHash, &cullPipelineStateObject);
+	}
+	cullShader->Release();
 	if (FAILED(hr))
+		return false;
+
+	ID3DBlob* indirectVertexShader;
+	hr = D3DCompileFromFile(L"IndirectVertexShader.hlsl", defines, D3D_COMPILE_STANDARD_FILE_INCLUDE, "main", "vs_5_0", D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION, 0, &indirectVertexShader, &errorBuffer);
+	if (FAILED(hr)) {
+		OutputDebugStringA((char*)errorBuffer->GetBufferPointer());
+		return false;
+	}
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC indirectDesc = psoDesc;
+	indirectDesc.VS.BytecodeLength = indirectVertexShader->GetBufferSize();
+	indirectDesc.VS.pShaderBytecode = indirectVertexShader->GetBufferPointer();
+
+	hr = PipelineCacheCreateGraphicsPipeline(pipelineCache, indirectDesc, rootSignatureHash, &indirectPipelineStateObject);
+	indirectVertexShader->Release();
+	if (FAILED(hr))
+		return false;
+
+	// same layout as GpuDrawCommand
+	D3D12_INDIRECT_ARGUMENT_DESC indirectArguments[2] = {};
+	indirectArguments[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+	indirectArguments[0].Constant.RootParameterIndex = 5;
+	indirectArguments[0].Constant.DestOffsetIn32BitValues = 0;
+	indirectArguments[0].Constant.Num32BitValuesToSet = 1;
+	indirectArguments[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+	D3D12_COMMAND_SIGNATURE_DESC indirectSignatureDesc = {};
+	indirectSignatureDesc.ByteStride = sizeof(GpuDrawCommand);
+	indirectSignatureDesc.NumArgumentDescs = _countof(indirectArguments);
+	indirectSignatureDesc.pArgumentDescs = indirectArguments;
+
+	// it changes a root argument, so it needs the root signature the draws use
+	hr = device->CreateCommandSignature(&indirectSignatureDesc, rootSignature, IID_PPV_ARGS(&indirectCommandSignature));
+	return SUCCEEDED(hr);
+}
+
+// room for every node of the scene, placed so they can be transitioned
+bool CreateGpuSceneBuffers() {
+	HRESULT hr = GpuHeapAllocatorCreateResource(gpuHeapAllocator, D3D12_HEAP_TYPE_DEFAULT, CD3DX12_RESOURCE_DESC::Buffer(sceneNodeCount * sizeof(GpuSceneObject)),
+		D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, nullptr, sceneObjectBuffer);
+	if (FAILED(hr))
+		return false;
+	sceneObjectBuffer.resource->SetName(L"Scene Object Buffer");
+
+	// the count is bound as a root unordered access view of its own, which only needs 4 byte alignment
+	drawCountOffset = sceneNodeCount * sizeof(GpuDrawCommand);
+	hr = GpuHeapAllocatorCreateResource(gpuHeapAllocator, D3D12_HEAP_TYPE_DEFAULT, CD3DX12_RESOURCE_DESC::Buffer(drawCountOffset + sizeof(UINT), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
+		D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, nullptr, drawCommandBuffer);
+	if (FAILED(hr))
+		return false;
+	drawCommandBuffer.resource->SetName(L"Draw Command Buffer");
+
+	// both are only written by copies and the cull pass, captures shadow the copies
+	if (FrameCapture) {
+		RenderCaptureAddBuffer(frameCapture, sceneObjectBuffer.resource, sceneObjectBuffer.offset, sceneObjectBuffer.gpuAddress, sceneObjectBuffer.size, RENDER_HEAP_DEFAULT, nullptr);
+		RenderCaptureAddBuffer(frameCapture, drawCommandBuffer.resource, drawCommandBuffer.offset, drawCommandBuffer.gpuAddress, drawCommandBuffer.size, RENDER_HEAP_DEFAULT, nullptr);
+	}
+
+	sceneObjectsUploaded = false;
+	return true;
+}
+
+// stages the objects whose world matrix changed, runs of neighbouring ones are copied together
+// the rest is constants, what the cpu does no longer depends on how much of the scene is visible
+bool UpdateGpuScene(DirectX::FXMMATRIX viewProjMat) {
+	PROFILE_SCOPE("UpdateGpuScene");
+
+	sceneObjectCopies.clear();
+
+	UINT count = (UINT)sceneTransforms.nodeCount;
+	UINT stagedCount = sceneObjectsUploaded ? (UINT)sceneTransforms.lastUpdatedCount : count;
+	if (stagedCount > 0) {
+		FrameAllocation objectAllocation;
+		if (!FrameAllocatorAllocate(frameAllocator, stagedCount * sizeof(GpuSceneObject), FrameAllocatorDefaultAlignment, objectAllocation))
+			return false;
+
+		RenderBuffer* page = static_cast<RenderBuffer*>(objectAllocation.userData);
+		GpuSceneObject* staged = static_cast<GpuSceneObject*>(objectAllocation.cpuAddress);
+		UINT64 sourceOffset = page->offset + objectAllocation.offset;
+
+		UINT written = 0;
+		for (UINT i = 0; i < count; ++i) {
+			if (sceneObjectsUploaded && !sceneTransforms.updated[i])
+				continue;
+
+			GpuSceneObjectInit(staged[written++], &sceneTransforms.worldMats[i].m[0][0], cubeBoundsMin, cubeBoundsMax);
+
+			// grows the last copy if the node right before this one was staged too
+			UINT64 destinationOffset = i * sizeof(GpuSceneObject);
+			if (!sceneObjectCopies.empty()) {
+				BufferCopy& last = sceneObjectCopies.back();
+				if (last.destinationOffset + last.size == destinationOffset) {
+					last.size += sizeof(GpuSceneObject);
+					continue;
+				}
+			}
+
+			BufferCopy copy;
+			copy.source = page->resource;
+			copy.sourceOffset = sourceOffset + (written - 1) * sizeof(GpuSceneObject);
+			copy.destinationOffset = destinationOffset;
+			copy.size = sizeof(GpuSceneObject);
+			sceneObjectCopies.push_back(copy);
+		}
+	}
+	sceneObjectsUploaded = true;
+
+	FrameAllocation cullAllocation;
+	if (!FrameAllocatorAllocate(frameAllocator, sizeof(GpuCullConstants), FrameAllocatorDefaultAlignment, cullAllocation))
+		return false;
+
+	CullingFrustum frustum;
+	GetCameraFrustum(viewProjMat, frustum);
+	GpuCullConstantsInit(*static_cast<GpuCullConstants*>(cullAllocation.cpuAddress), frustum, count, numCubeIndices);
+	cullConstantsAddress = cullAllocation.gpuAddress;
+
+	// the vertex shader puts the object's world matrix in front of this itself
+	FrameAllocation sceneAllocation;
+	if (!FrameAllocatorAllocate(frameAllocator, sizeof(DirectX::XMFLOAT4X4), FrameAllocatorDefaultAlignment, sceneAllocation))
+		return false;
+
+	DirectX::XMStoreFloat4x4(static_cast<DirectX::XMFLOAT4X4*>(sceneAllocation.cpuAddress), DirectX::XMMatrixTranspose(viewProjMat));
+	sceneConstantsAddress = sceneAllocation.gpuAddress;
+
+	FrameAllocation countAllocation;
+	if (!FrameAllocatorAllocate(frameAllocator, sizeof(UINT), FrameAllocatorDefaultAlignment, countAllocation))
+		return false;
+
+	*static_cast<UINT*>(countAllocation.cpuAddress) = 0;
+	RenderBuffer* countPage = static_cast<RenderBuffer*>(countAllocation.userData);
+	drawCountReset.source = countPage->resource;
+	drawCountReset.sourceOffset = countPage->offset + countAllocation.offset;
+	drawCountReset.destinationOffset = drawCountOffset;
+	drawCountReset.size = sizeof(UINT);
+	return true;
+}
+
+// update game logic
+void Update() {
+	PROFILE_SCOPE("Update");
+
+	// rotate cube 1, its children are updated with it
+	DirectX::XMVECTOR rotAxis = DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+	DirectX::XMVECTOR rotation = DirectX::XMQuaternionMultiply(TransformHierarchyGetRotation(sceneTransforms, cube1Node), DirectX::XMQuaternionRotationAxis(rotAxis, 0.0001f));
+	TransformHierarchySetRotation(sceneTransforms, cube1Node, DirectX::XMQuaternionNormalize(rotation));
+
+	// only the moved subtree is recomputed, the props stay as they are
+	TransformHierarchyUpdate(sceneTransforms);
+
+	DirectX::XMMATRIX viewMat = DirectX::XMLoadFloat4x4(&cameraViewMat);
+	DirectX::XMMATRIX projMat = DirectX::XMLoadFloat4x4(&cameraProjMat);
+	DirectX::XMMATRIX viewProjMat = viewMat * projMat;
+
+	// last frame's draws point into frame allocator pages that may already be reused
+	drawConstantBuffers.clear();
+	meshletDraws.clear();
+	instanceCount = 0;
+
+	// the gpu culls and draws by itself, it only needs the objects that moved
+	if (GpuDrivenRendering) {
+		if (!UpdateGpuScene(viewProjMat))
+			Running = false;
+		return;
+	}
+
+	RefitSceneBvh();
+
+	// every node is drawn with the cube mesh, but only the ones in view get constants and draws
+	UINT count = CullScene(viewProjMat);
+	if (count == 0)
+		return;
+
+	if (InstancedRendering) {
+		// every cube shares the same mesh, so one structured buffer holds all of them
+		FrameAllocation instanceAllocation;
+		if (!FrameAllocatorAllocate(frameAllocator, count * sizeof(InstanceData), FrameAllocatorDefaultAlignment, instanceAllocation)) {
+			Running = false;
+			return;
+		}
+
+		TransformHierarchyWriteWVPList(sceneTransforms, &visibleNodes[0], count, viewProjMat, instanceAllocation.cpuAddress, sizeof(InstanceData));
+
+		instanceBufferAddress = instanceAllocation.gpuAddress;
+		instanceCount = count;
+		return;
+	}
+
+	// one constant buffer and one draw per cube
+	// all of them come from one allocation so the matrices are written in order
+	FrameAllocation cbAllocation;
+	if (!FrameAllocatorAllocate(frameAllocator, count * ConstantBufferPerObjectAlignedSize, FrameAllocatorDefaultAlignment, cbAllocation)) {
+		Running = false;
+		return;
+	}
+
+	TransformHierarchyWriteWVPList(sceneTransforms, &visibleNodes[0], count, viewProjMat, cbAllocation.cpuAddress, ConstantBufferPerObjectAlignedSize);
+
+	if (!MeshletRendering) {
+		for (UINT i = 0; i < count; ++i)
+			drawConstantBuffers.push_back(cbAllocation.gpuAddress + i * ConstantBufferPerObjectAlignedSize);
+		return;
+	}
+
+	CullSceneMeshlets(viewProjMat, cbAllocation.gpuAddress, count);
+}
+
+// culls the cube's meshlets for every visible object, objects with nothing left are not drawn at all
+// culling is in object space, the bounds are only transformed into the frustum planes and the eye
+void CullSceneMeshlets(DirectX::FXMMATRIX viewProjMat, D3D12_GPU_VIRTUAL_ADDRESS constantBuffers, UINT count) {
+	PROFILE_SCOPE("CullSceneMeshlets");
+
+	meshletDraws.clear();
+
+	bool meshShaders = UseMeshShaders();
+	UINT meshletCount = (UINT)cubeMeshlets.size();
+	meshletDrawArguments.resize((meshletCount + 1) / 2);
+	visibleMeshlets.resize(meshletCount);
+
+	// the most an object can need, neighbouring visible meshlets are merged into one indirect draw
+	UINT64 drawSize = meshShaders ? meshletCount * sizeof(uint32_t) : meshletDrawArguments.size() * sizeof(MeshletDrawArguments);
+
+	FrameAllocation drawAllocation;
+	if (!FrameAllocatorAllocate(frameAllocator, count * drawSize, FrameAllocatorDefaultAlignment, drawAllocation)) {
 		Running = false;
+		return;
+	}
+
+	UINT64 written = 0;
+	for (UINT i = 0; i < count; ++i) {
+		// the same matrix the shaders get, which has clip space positions in its rows
+		DirectX::XMFLOAT4X4 clipFromObject;
+		DirectX::XMStoreFloat4x4(&clipFromObject, DirectX::XMMatrixTranspose(DirectX::XMLoadFloat4x4(&sceneTransforms.worldMats[visibleNodes[i]]) * viewProjMat));
+
+		MeshletCullContext cullContext;
+		MeshletCullContextInit(cullContext, &clipFromObject.m[0][0]);
+
+		UINT visibleCount;
+		const void* result;
+		size_t resultSize;
+		if (meshShaders) {
+			visibleCount = CullMeshlets(cullContext, &cubeMeshletBounds[0], meshletCount, &visibleMeshlets[0]);
+			result = &visibleMeshlets[0];
+			resultSize = visibleCount * sizeof(uint32_t);
+		}
+		else {
+			visibleCount = CullMeshletsToDrawArguments(cullContext, &cubeMeshlets[0], &cubeMeshletBounds[0], meshletCount, &meshletDrawArguments[0]);
+			result = &meshletDrawArguments[0];
+			resultSize = visibleCount * sizeof(MeshletDrawArguments);
+		}
+
+		if (visibleCount == 0)
+			continue;
+
+		UINT64 offset = written * drawSize;
+		memcpy(static_cast<UINT8*>(drawAllocation.cpuAddress) + offset, result, resultSize);
+
+		RenderBuffer* page = static_cast<RenderBuffer*>(drawAllocation.userData);
+		MeshletDraw draw;
+		draw.resource = page->resource;
+		draw.offset = page->offset + drawAllocation.offset + offset;
+		draw.gpuAddress = drawAllocation.gpuAddress + offset;
+		draw.count = visibleCount;
+		meshletDraws.push_back(draw);
+
+		drawConstantBuffers.push_back(constantBuffers + i * ConstantBufferPerObjectAlignedSize);
+		++written;
+	}
+}
+
+// render targets, root arguments and input assembler state are not inherited between command lists
+// so every list that draws has to set them itself
+void RecordDrawState(RenderCommandList& list) {
+	// Output Merger
+	RenderDescriptor renderTarget = { renderTargetViews[frameIndex].cpuHandle.ptr, 0 };
+	RenderDescriptor depthStencil = { depthStencilView.cpuHandle.ptr, 0 };
+	RenderCommandListSetRenderTarget(list, renderTarget, depthStencil);
+
+	// no input assembler, the mesh shader reads the vertices and meshlets itself
+	bool meshShaders = UseMeshShaders();
+	if (meshShaders) {
+		RenderCommandListSetPipelineState(list, meshletPipelineStateObject);
+		RenderCommandListSetRootSignature(list, RENDER_BIND_GRAPHICS, meshletRootSignature);
+		RenderCommandListSetRootShaderResource(list, RENDER_BIND_GRAPHICS, 2, meshletAddress);
+		RenderCommandListSetRootShaderResource(list, RENDER_BIND_GRAPHICS, 5, vertexBuffer.gpuAddress);
+		RenderCommandListSetRootShaderResource(list, RENDER_BIND_GRAPHICS, 6, meshletVertexAddress);
+		RenderCommandListSetRootShaderResource(list, RENDER_BIND_GRAPHICS, 7, meshletTriangleAddress);
+	}
+	else {
+		RenderCommandListSetRootSignature(list, RENDER_BIND_GRAPHICS, rootSignature);
+	}
+
+	RenderCommandListSetDescriptorHeap(list, mainDescriptorHeap.heap);
+
+	// every texture at once, draws only pick an index
+	RenderDescriptor textures = { 0, GpuDescriptorHeapGetBindlessTable(mainDescriptorHeap).ptr };
+	RenderCommandListSetRootDescriptorTable(list, RENDER_BIND_GRAPHICS, 1, textures);
+	RenderCommandListSetRootConstants(list, RENDER_BIND_GRAPHICS, 3, 1, &sceneTextureIndex, 0);
+	RenderCommandListSetRootConstants(list, RENDER_BIND_GRAPHICS, 4, _countof(cubeDequantization), cubeDequantization, 0);
+
+	RenderCommandListSetViewport(list, viewport);
+	RenderCommandListSetScissorRect(list, scissorRect);
+	if (meshShaders)
+		return;
+
+	RenderCommandListSetPrimitiveTopology(list, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	RenderCommandListSetVertexBuffer(list, vertexBufferView);
+	RenderCommandListSetIndexBuffer(list, indexBufferView);
+}
+
+// one draw per constant buffer written in Update, from first up to (not including) last
+// with meshlet rendering, each draws only the meshlets culling left of its object
+void RecordDraws(RenderCommandList& list, size_t first, size_t last) {
+	if (UseMeshShaders()) {
+		// a group per visible meshlet
+		for (size_t i = first; i < last; ++i) {
+			RenderCommandListSetRootConstantBuffer(list, RENDER_BIND_GRAPHICS, 0, drawConstantBuffers[i]);
+			RenderCommandListSetRootShaderResource(list, RENDER_BIND_GRAPHICS, 8, meshletDraws[i].gpuAddress);
+			RenderCommandListDispatchMesh(list, meshletDraws[i].count, 1, 1);
+		}
+		return;
+	}
+
+	for (size_t i = first; i < last; ++i) {
+		RenderCommandListSetRootConstantBuffer(list, RENDER_BIND_GRAPHICS, 0, drawConstantBuffers[i]);
+
+		if (MeshletRendering)
+			RenderCommandListExecuteIndirect(list, meshletCommandSignature, meshletDraws[i].count, meshletDraws[i].resource, meshletDraws[i].offset, nullptr, 0);
+		else
+			RenderCommandListDrawIndexedInstanced(list, numCubeIndices, 1, 0, 0, 0);
+	}
+}
+
+// every cube in a single draw, the vertex shader looks up its matrix with SV_InstanceID
+void RecordInstancedDraw(RenderCommandList& list) {
+	if (instanceCount == 0)
+		return;
+
+	RenderCommandListSetPipelineState(list, instancedPipelineStateObject);
+	RenderCommandListSetRootShaderResource(list, RENDER_BIND_GRAPHICS, 2, instanceBufferAddress);
+
+	RenderCommandListDrawIndexedInstanced(list, numCubeIndices, instanceCount, 0, 0, 0);
+}
+
+// as many draws as the cull pass wrote, the gpu reads the count
+void RecordIndirectDraws(RenderCommandList& list) {
+	RenderCommandListSetPipelineState(list, indirectPipelineStateObject);
+	RenderCommandListSetRootConstantBuffer(list, RENDER_BIND_GRAPHICS, 0, sceneConstantsAddress);
+	RenderCommandListSetRootShaderResource(list, RENDER_BIND_GRAPHICS, 2, sceneObjectBuffer.gpuAddress);
+
+	RenderCommandListExecuteIndirect(list, indirectCommandSignature, (UINT)sceneTransforms.nodeCount, drawCommandBuffer.resource, 0, drawCommandBuffer.resource, drawCountOffset);
+}
+
+// records the draws assigned to one worker into its own command list
+void RecordWorkerCommandList(int threadIndex) {
+	RenderCommandList& list = recordCommandLists[threadIndex];
+
+	if (!RenderCommandListReset(list, frameContextIndex, pipelineStateObject))
+		Running = false;
+
+	PROFILE_SCOPE("RecordWorkerCommandList");
+
+	RecordDrawState(list);
+	RecordDraws(list, recordJobs[threadIndex].firstDraw, recordJobs[threadIndex].lastDraw);
+
+	if (!RenderCommandListClose(list))
+		Running = false;
+}
+
+DWORD WINAPI RecordThreadProc(LPVOID parameter) {
+	int threadIndex = (int)(INT_PTR)parameter;
+
+	PROFILE_THREAD_NAME("Record Thread");
+
+	while (true) {
+		WaitForSingleObject(recordBeginEvents[threadIndex], INFINITE);
+
+		if (recordThreadsExit)
+			break;
+
+		RecordWorkerCommandList(threadIndex);
+
+		SetEvent(recordDoneEvents[threadIndex]);
+	}
+
+	return 0;
+}
+
+bool InitRecordThreads() {
+	// lists are created closed, workers reset them every frame
+	for (int t = 0; t < recordThreadCount; ++t) {
+		if (!RenderDeviceCreateCommandList(*frameDevice, RENDER_COMMAND_LIST_DIRECT, maxFramesInFlight, recordCommandLists[t]))
+			return false;
+	}
+
+	if (!RenderDeviceCreateCommandList(*frameDevice, RENDER_COMMAND_LIST_DIRECT, maxFramesInFlight, presentCommandList))
+		return false;
+
+	recordThreadsExit = false;
+
+	for (int t = 0; t < recordThreadCount; ++t) {
+		// auto reset events, one wake up per frame
+		recordBeginEvents[t] = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+		recordDoneEvents[t] = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+		if (recordBeginEvents[t] == nullptr || recordDoneEvents[t] == nullptr)
+			return false;
+
+		recordThreads[t] = CreateThread(nullptr, 0, RecordThreadProc, (LPVOID)(INT_PTR)t, 0, nullptr);
+		if (recordThreads[t] == nullptr)
+			return false;
+	}
+
+	return true;
+}
+
+void ShutdownRecordThreads() {
+	recordThreadsExit = true;
+
+	for (int t = 0; t < recordThreadCount; ++t) {
+		if (recordThreads[t] == nullptr)
+			continue;
+
+		SetEvent(recordBeginEvents[t]);
+		WaitForSingleObject(recordThreads[t], INFINITE);
+		CloseHandle(recordThreads[t]);
+		recordThreads[t] = nullptr;
+	}
+
+	for (int t = 0; t < recordThreadCount; ++t) {
+		if (recordBeginEvents[t] != nullptr)
+			CloseHandle(recordBeginEvents[t]);
+		if (recordDoneEvents[t] != nullptr)
+			CloseHandle(recordDoneEvents[t]);
+		recordBeginEvents[t] = nullptr;
+		recordDoneEvents[t] = nullptr;
+
+		RenderDeviceDestroyCommandList(recordCommandLists[t]);
+	}
+
+	RenderDeviceDestroyCommandList(presentCommandList);
+}
+
+void UpdatePipeline() {
+	PROFILE_SCOPE("UpdatePipeline");
+
+	WaitForPreviousFrame();
+
+	// timestamps of the frame that last used this context are ready now
+	PROFILE_GPU_BEGIN_FRAME(gpuProfiler, frameContextIndex);
+
+	// constant buffers and descriptors of every frame the gpu has finished can be reused
+	UINT64 completedFenceValue = RenderFenceGetCompletedValue(fence);
+	FrameAllocatorReclaim(frameAllocator, completedFenceValue);
+	GpuDescriptorHeapReclaim(mainDescriptorHeap, completedFenceValue);
+
+	// resetting allows commands to start being recorded
+	if (!RenderCommandListReset(commandList, frameContextIndex, pipelineStateObject))
+		Running = false;
+
+	// recording commands
+	// note that doing something bad during recording does not stop program from running (dx12)
+
+	// switch over to textures whose upload finished, their transitions begin here and end right before the draws
+	TextureLoaderUpdate(textureLoader, commandQueue);
+	sceneTextureIndex = TextureLoaderGetDescriptorIndex(textureLoader, smileTexture);
+
+	PROFILE_GPU_BEGIN(gpuProfiler, GetD3D12CommandList(commandList), frameScope, "Frame");
+
+	// begin halves of the texture transitions, the scene pass ends them
+	ResourceStateTrackerFlush(resourceStates, RecordResourceBarriers, &commandList);
+
+	// every back buffer is in the present state between frames, so the compiled barriers fit all of them
+	FrameGraphSetResource(frameGraph, backBufferHandle, renderTargets[frameIndex]);
+
+	// the scene pass switches to presentCommandList if it hands the draws to the workers
+	recordThreadsInUse = 0;
+	RenderCommandList* lastList = static_cast<RenderCommandList*>(FrameGraphExecute(frameGraph, RecordFrameGraphBarriers, &commandList));
+
+	PROFILE_GPU_END(gpuProfiler, GetD3D12CommandList(*lastList), frameScope);
+	PROFILE_GPU_END_FRAME(gpuProfiler, GetD3D12CommandList(*lastList));
+
+	if (!RenderCommandListClose(*lastList))
+		Running = false;
+
+	if (recordThreadsInUse == 0) {
+		submitCommandLists[0] = commandList;
+		submitCommandListCount = 1;
+		return;
+	}
+
+	{
+		PROFILE_SCOPE("WaitForRecordThreads");
+		WaitForMultipleObjects(recordThreadsInUse, recordDoneEvents, TRUE, INFINITE);
+	}
+
+	submitCommandListCount = 0;
+	submitCommandLists[submitCommandListCount++] = commandList;
+	for (int t = 0; t < recordThreadsInUse; ++t)
+		submitCommandLists[submitCommandListCount++] = recordCommandLists[t];
+	submitCommandLists[submitCommandListCount++] = presentCommandList;
+}
+
+// frame graph passes, context.commandList is commandList unless a pass before switched it
+
+void ExecuteClearPass(FrameGraphPassContext& context) {
+	RenderCommandList& list = *static_cast<RenderCommandList*>(context.commandList);
+
+	PROFILE_GPU_BEGIN(gpuProfiler, GetD3D12CommandList(list), clearScope, "Clear");
+
+	const float clearColor[] = { 0.0f, 0.2f, 0.4f, 1.0f };
+	RenderDescriptor renderTarget = { renderTargetViews[frameIndex].cpuHandle.ptr, 0 };
+	RenderCommandListClearRenderTarget(list, renderTarget, clearColor);
+
+	// the depth buffer is transient, clearing it also initializes it after whatever it is aliased with
+	RenderDescriptor depthStencil = { depthStencilView.cpuHandle.ptr, 0 };
+	RenderCommandListClearDepth(list, depthStencil, 1.0f);
+
+	PROFILE_GPU_END(gpuProfiler, GetD3D12CommandList(list), clearScope);
+}
+
+// the objects that moved into the scene buffer, and a zero into the draw count
+void ExecuteSceneUploadPass(FrameGraphPassContext& context) {
+	RenderCommandList& list = *static_cast<RenderCommandList*>(context.commandList);
+
+	for (const BufferCopy& copy : sceneObjectCopies)
+		RenderCommandListCopyBufferRegion(list, sceneObjectBuffer.resource, copy.destinationOffset, copy.source, copy.sourceOffset, copy.size);
+
+	RenderCommandListCopyBufferRegion(list, drawCommandBuffer.resource, drawCountReset.destinationOffset, drawCountReset.source, drawCountReset.sourceOffset, drawCountReset.size);
+}
+
+// a thread per object, each visible one appends its draw
+void ExecuteCullPass(FrameGraphPassContext& context) {
+	RenderCommandList& list = *static_cast<RenderCommandList*>(context.commandList);
+
+	PROFILE_GPU_BEGIN(gpuProfiler, GetD3D12CommandList(list), cullScope, "Cull");
+
+	RenderCommandListSetRootSignature(list, RENDER_BIND_COMPUTE, cullRootSignature);
+	RenderCommandListSetPipelineState(list, cullPipelineStateObject);
+	RenderCommandListSetRootConstantBuffer(list, RENDER_BIND_COMPUTE, 0, cullConstantsAddress);
+	RenderCommandListSetRootShaderResource(list, RENDER_BIND_COMPUTE, 1, sceneObjectBuffer.gpuAddress);
+	RenderCommandListSetRootUnorderedAccess(list, RENDER_BIND_COMPUTE, 2, drawCommandBuffer.gpuAddress);
+	RenderCommandListSetRootUnorderedAccess(list, RENDER_BIND_COMPUTE, 3, drawCommandBuffer.gpuAddress + drawCountOffset);
+
+	UINT count = (UINT)sceneTransforms.nodeCount;
+	RenderCommandListDispatch(list, (count + gpuCullGroupSize - 1) / gpuCullGroupSize, 1, 1);
+
+	PROFILE_GPU_END(gpuProfiler, GetD3D12CommandList(list), cullScope);
+}
+
+void ExecuteScenePass(FrameGraphPassContext& context) {
+	RenderCommandList& list = *static_cast<RenderCommandList*>(context.commandList);
+
+	// the clears overlap with the texture transitions, the draws cannot
+	ResourceStateTrackerEndTransitions(resourceStates);
+	ResourceStateTrackerFlush(resourceStates, RecordResourceBarriers, &list);
+
+	// the worker lists run between the end of commandList and presentCommandList, so the scope spans both
+	PROFILE_GPU_BEGIN(gpuProfiler, GetD3D12CommandList(list), drawScope, "Draw");
+
+	size_t drawCount = drawConstantBuffers.size();
+
+	// only spread the draws out if every thread gets enough work to be worth waking it up
+	// gpu driven and instanced rendering record a single draw, so they always stay on the main list
+	int threadCount = 1;
+	if (MultithreadedRecording && !GpuDrivenRendering && !InstancedRendering) {
+		threadCount = (int)((drawCount + minDrawsPerRecordThread - 1) / minDrawsPerRecordThread);
+		if (threadCount > recordThreadCount)
+			threadCount = recordThreadCount;
+	}
+
+	if (threadCount <= 1) {
+		// draw triangles
+		RecordDrawState(list);
+		if (GpuDrivenRendering)
+			RecordIndirectDraws(list);
+		else if (InstancedRendering)
+			RecordInstancedDraw(list);
+		else
+			RecordDraws(list, 0, drawCount);
+
+		PROFILE_GPU_END(gpuProfiler, GetD3D12CommandList(list), drawScope);
+		return;
+	}
+
+	if (!RenderCommandListClose(list))
+		Running = false;
+
+	// contiguous ranges keep the submission order the same as the single threaded path
+	for (int t = 0; t < threadCount; ++t) {
+		recordJobs[t].firstDraw = drawCount * t / threadCount;
+		recordJobs[t].lastDraw = drawCount * (t + 1) / threadCount;
+		SetEvent(recordBeginEvents[t]);
+	}
+	recordThreadsInUse = threadCount;
+
+	// main thread records the barriers after the scene while the workers are busy
+	if (!RenderCommandListReset(presentCommandList, frameContextIndex, nullptr))
+		Running = false;
+
+	PROFILE_GPU_END(gpuProfiler, GetD3D12CommandList(presentCommandList), drawScope);
+
+	context.commandList = &presentCommandList;
 }
 
 void Render() {
 	HRESULT hr;
 
+	// everything this frame executes goes into the capture
+	bool capturing = frameCaptureRequested;
+	if (capturing) {
+		frameCaptureRequested = false;
+		RenderCaptureBegin(frameCapture);
+	}
+
 	// sends commands to command queue
 	UpdatePipeline();
 
-	// if multithreaded, one command list per thread
-	ID3D12CommandList* ppCommandLists[] = { commandList };
+	// one command list per recording thread, executed in order in a single call
+	{
+		PROFILE_SCOPE("ExecuteCommandLists");
+		RenderQueueExecute(graphicsQueue, submitCommandLists, submitCommandListCount);
+	}
 
-	commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+	if (capturing)
+		WriteFrameCapture();
 
-	// sets fence and signals fence event so that when coming back to the frame buffer, we can see whether or not GPU has finished executing list
-	// since signal command would have executed and fence would be set to the value
-	hr = commandQueue->Signal(fence[frameIndex], fenceValue[frameIndex]);
-	if (FAILED(hr))
+	// signals the fence once the gpu has executed this frame's lists
+	// when this frame context comes around again, we can see whether or not GPU has finished executing them
+	frameFenceValues[frameContextIndex] = SignalQueue();
+	if (frameFenceValues[frameContextIndex] == 0)
 		Running = false;
 
+	// constant buffers written this frame stay untouched until this frame is done
+	FrameAllocatorFinishFrame(frameAllocator, frameFenceValues[frameContextIndex]);
+	GpuDescriptorHeapFinishFrame(mainDescriptorHeap, frameFenceValues[frameContextIndex]);
+
+	frameContextIndex = (frameContextIndex + 1) % maxFramesInFlight;
+
 	// present back buffer
-	hr = swapChain->Present(0, 0);
+	{
+		PROFILE_SCOPE("Present");
+		hr = swapChain->Present(0, 0);
+	}
 	if (FAILED(hr))
 		Running = false;
 }
 
 void Cleanup() {
 	// finish going through frames
-	for (int i = 0; i < frameBufferCount; ++i) {
-		frameIndex = i;
-		WaitForPreviousFrame();
-	}
+	WaitForGpuIdle();
+
+	ShutdownRecordThreads();
+
+	TextureLoaderShutdown(textureLoader);
+
+	ShutdownUploadArena();
+
+	PipelineCacheShutdown(pipelineCache);
+
+	GpuProfilerShutdown(gpuProfiler);
 
 	BOOL fs = false;
 	if (swapChain->GetFullscreenState(&fs, NULL))
 		swapChain->SetFullscreenState(false, NULL);
 
-	SAFE_RELEASE(device);
 	SAFE_RELEASE(swapChain);
+	RenderDeviceDestroyQueue(graphicsQueue);
 	SAFE_RELEASE(commandQueue);
-	SAFE_RELEASE(rtvDescriptorHeap);
-	SAFE_RELEASE(commandList);
+	SAFE_RELEASE(copyQueue);
+	SAFE_RELEASE(copyCommandList);
+	SAFE_RELEASE(copyCommandAllocator);
+	SAFE_RELEASE(copyFence);
+	CpuDescriptorHeapShutdown(rtvDescriptorHeap);
+	CpuDescriptorHeapShutdown(dsDescriptorHeap);
+	GpuDescriptorHeapShutdown(mainDescriptorHeap);
+	RenderDeviceDestroyCommandList(commandList);
+
+	RenderDeviceDestroyFence(fence);
 
 	for (int i = 0; i < frameBufferCount; ++i) {
 		SAFE_RELEASE(renderTargets[i]);
-		SAFE_RELEASE(commandAllocator[i]);
-		SAFE_RELEASE(fence[i]);
-
-		SAFE_RELEASE(mainDescriptorHeap);
-		//SAFE_RELEASE(constantBufferUploadHeap[i]);
-	
-		SAFE_RELEASE(constantBufferUploadHeaps[i]);
-		
 	}
 
+	FrameAllocatorDestroy(frameAllocator);
+
 	SAFE_RELEASE(pipelineStateObject);
+	SAFE_RELEASE(instancedPipelineStateObject);
 	SAFE_RELEASE(rootSignature);
-	SAFE_RELEASE(vertexBuffer);
+	SAFE_RELEASE(meshletPipelineStateObject);
+	SAFE_RELEASE(meshletRootSignature);
+	SAFE_RELEASE(meshletCommandSignature);
+	ShaderCompilerShutdown(shaderCompiler);
+	SAFE_RELEASE(indirectPipelineStateObject);
+	SAFE_RELEASE(indirectCommandSignature);
+	SAFE_RELEASE(cullPipelineStateObject);
+	SAFE_RELEASE(cullRootSignature);
+
+	if (FrameCapture) {
+		const GpuAllocation* capturedBuffers[] = { &vertexBuffer, &indexBuffer, &meshletBuffer, &sceneObjectBuffer, &drawCommandBuffer };
+		for (const GpuAllocation* buffer : capturedBuffers) {
+			if (buffer->resource != nullptr)
+				RenderCaptureRemoveBuffer(frameCapture, buffer->gpuAddress);
+		}
+	}
+
+	GpuHeapAllocatorFree(gpuHeapAllocator, vertexBuffer);
+	GpuHeapAllocatorFree(gpuHeapAllocator, indexBuffer);
+	GpuHeapAllocatorFree(gpuHeapAllocator, meshletBuffer);
+	GpuHeapAllocatorFree(gpuHeapAllocator, sceneObjectBuffer);
+	GpuHeapAllocatorFree(gpuHeapAllocator, drawCommandBuffer);
+	DestroyFrameGraphTransients();
 
-	SAFE_RELEASE(indexBuffer);
+	ResourceStateTrackerStats barrierStats = resourceStates.stats;
+	printf("barriers: %llu transitions requested, %llu barriers in %llu calls, %llu skipped, %llu merged\n",
+		barrierStats.requestedTransitionCount, barrierStats.barrierCount, barrierStats.flushCount,
+		barrierStats.skippedTransitionCount, barrierStats.mergedBarrierCount);
+
+	GpuHeapAllocatorStats heapStats = GpuHeapAllocatorGetStats(gpuHeapAllocator);
+	if (heapStats.placedResourceCount + heapStats.subAllocatedBufferCount != 0)
+		printf("gpu heaps: %llu placed resources and %llu buffers were not freed\n", heapStats.placedResourceCount, heapStats.subAllocatedBufferCount);
+
+	GpuHeapAllocatorShutdown(gpuHeapAllocator);
+
+	SAFE_RELEASE(device);
+}
+
+ID3D12GraphicsCommandList* GetD3D12CommandList(const RenderCommandList& list) {
+	return D3D12RenderGetCommandList(RenderCaptureGetTargetCommandList(list));
+}
+
+void WriteFrameCapture() {
+	RenderCapture capture;
+	RenderCaptureEnd(frameCapture, capture);
+
+	std::vector<uint8_t> file;
+	RenderCaptureWrite(capture, file);
+
+	std::ofstream output(frameCaptureFilename, std::ios::binary | std::ios::trunc);
+	if (output)
+		output.write(reinterpret_cast<const char*>(file.data()), (std::streamsize)file.size());
+
+	if (output)
+		printf("wrote %s, %zu lists and %zu buffers in %zu bytes\n", frameCaptureFilename, capture.lists.size(), capture.buffers.size(), file.size());
+	else
+		printf("could not write %s\n", frameCaptureFilename);
 }
 
 void WaitForPreviousFrame() {
-	HRESULT hr;
+	PROFILE_SCOPE("WaitForPreviousFrame");
 
 	frameIndex = swapChain->GetCurrentBackBufferIndex();
 
-	// if wanted fence value is less than the current fence value
-	if (fence[frameIndex]->GetCompletedValue() < fenceValue[frameIndex]) {
-		// set fence event that will be triggered once the value of the first parameter is met
-		hr = fence[frameIndex]->SetEventOnCompletion(fenceValue[frameIndex], fenceEvent);
+	// allocators of this frame context can only be reset once the frame that used them last is done
+	frameStallMilliseconds = WaitForFenceValue(frameFenceValues[frameContextIndex]);
+
+	statsStallMilliseconds += frameStallMilliseconds;
+}
+
+// signals the next fence value on the queue, returns 0 on failure
+UINT64 SignalQueue() {
+	UINT64 value = fenceValue + 1;
+
+	if (!RenderQueueSignal(graphicsQueue, fence, value))
+		return 0;
+
+	fenceValue = value;
+	return value;
+}
+
+// waits until the fence reaches value and returns how long the cpu was blocked in milliseconds
+// spins for a short while first since the gpu is often just about done
+double WaitForFenceValue(UINT64 value) {
+	if (RenderFenceGetCompletedValue(fence) >= value)
+		return 0.0;
+
+	LARGE_INTEGER start, now;
+	QueryPerformanceCounter(&start);
+
+	LONGLONG spinTicks = (LONGLONG)(performanceFrequency.QuadPart * fenceSpinMicroseconds / 1000000.0);
+
+	do {
+		YieldProcessor();
+		QueryPerformanceCounter(&now);
+
+		if (RenderFenceGetCompletedValue(fence) >= value)
+			return (now.QuadPart - start.QuadPart) * 1000.0 / performanceFrequency.QuadPart;
+	} while (now.QuadPart - start.QuadPart < spinTicks);
+
+	// sleeps on an event that is triggered once the fence reaches value
+	if (!RenderFenceWait(fence, value)) {
+		Running = false;
+		return 0.0;
+	}
+
+	QueryPerformanceCounter(&now);
+	return (now.QuadPart - start.QuadPart) * 1000.0 / performanceFrequency.QuadPart;
+}
+
+// waits for everything submitted so far
+void WaitForGpuIdle() {
+	if (graphicsQueue.queue == nullptr || fence.fence == nullptr)
+		return;
+
+	UINT64 value = SignalQueue();
+	if (value != 0)
+		WaitForFenceValue(value);
+}
+
+// shows frame time and how much of it the cpu spent waiting for the gpu in the window title
+void ReportFrameStats() {
+	statsFrameCount++;
+
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+
+	double elapsedMilliseconds = (now.QuadPart - statsStartTime.QuadPart) * 1000.0 / performanceFrequency.QuadPart;
+	if (elapsedMilliseconds < 1000.0)
+		return;
+
+	wchar_t title[256];
+	swprintf_s(title, L"%ls - %.2f ms/frame, %.2f ms gpu wait, %d frames in flight",
+		WindowTitle,
+		elapsedMilliseconds / statsFrameCount,
+		statsStallMilliseconds / statsFrameCount,
+		maxFramesInFlight);
+	SetWindowText(hwnd, title);
+
+	statsStallMilliseconds = 0.0;
+	statsFrameCount = 0;
+	statsStartTime = now;
+}
+
+// places a persistently mapped upload buffer for the frame allocator, context is the gpu heap allocator
+bool CreateUploadPage(uint64_t size, FrameAllocatorPage& page, void* context) {
+	RenderDevice* uploadDevice = static_cast<RenderDevice*>(context);
+	RenderBuffer* uploadBuffer = new RenderBuffer;
+
+	// cpu will not read from constant buffer
+	// upload buffers stay mapped for their whole lifetime
+	if (!RenderDeviceCreateBuffer(*uploadDevice, RENDER_HEAP_UPLOAD, size, D3D12_RESOURCE_STATE_GENERIC_READ, *uploadBuffer)) {
+		delete uploadBuffer;
+		return false;
+	}
+
+	static_cast<ID3D12Resource*>(uploadBuffer->resource)->SetName(L"Constant Buffer Upload Resource Heap");
+
+	page.cpuAddress = uploadBuffer->cpuAddress;
+	page.gpuAddress = uploadBuffer->gpuAddress;
+	page.userData = uploadBuffer;
+	return true;
+}
+
+void DestroyUploadPage(FrameAllocatorPage& page, void* context) {
+	RenderDevice* uploadDevice = static_cast<RenderDevice*>(context);
+	RenderBuffer* uploadBuffer = static_cast<RenderBuffer*>(page.userData);
+
+	RenderDeviceDestroyBuffer(*uploadDevice, *uploadBuffer);
+	delete uploadBuffer;
+	page.userData = nullptr;
+}
+
+void RecordResourceBarriers(const ResourceStateBarrier* barriers, uint32_t count, void* context) {
+	RenderCommandList* list = static_cast<RenderCommandList*>(context);
+
+	resourceBarriers.resize(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		RenderBarrier& barrier = resourceBarriers[i];
+		barrier.type = RENDER_BARRIER_TRANSITION;
+		barrier.resource = barriers[i].resource;
+		barrier.resourceBefore = nullptr;
+		barrier.subresource = barriers[i].subresource;
+		barrier.stateBefore = barriers[i].stateBefore;
+		barrier.stateAfter = barriers[i].stateAfter;
+		barrier.flag = barriers[i].flag;
+	}
+
+	RenderCommandListBarriers(*list, resourceBarriers.data(), count);
+}
+
+// size and alignment come from the device, so they match what CreatePlacedResource expects
+static FrameGraphResourceDesc GetTransientTextureDesc(UINT width, UINT height, DXGI_FORMAT format, D3D12_RESOURCE_FLAGS flags) {
+	FrameGraphResourceDesc desc = {};
+	desc.width = width;
+	desc.height = height;
+	desc.format = format;
+	desc.flags = flags;
+
+	D3D12_RESOURCE_ALLOCATION_INFO info = device->GetResourceAllocationInfo(0, 1, &CD3DX12_RESOURCE_DESC::Tex2D(format, width, height, 1, 1, 1, 0, flags));
+	desc.size = info.SizeInBytes;
+	desc.alignment = info.Alignment;
+	return desc;
+}
+
+// clear the back buffer, then draw the scene into it, culled on the gpu first if it draws by itself
+// new passes only declare what they read and write, the barriers and the memory of transients follow from that
+bool BuildFrameGraph() {
+	FrameGraphReset(frameGraph);
+
+	backBufferHandle = FrameGraphImport(frameGraph, "Back Buffer", renderTargets[frameIndex], D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_PRESENT);
+	depthStencilHandle = FrameGraphCreate(frameGraph, "Depth", GetTransientTextureDesc(Width, Height, DXGI_FORMAT_D32_FLOAT, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL));
+
+	uint32_t clearPass = FrameGraphAddPass(frameGraph, "Clear", FRAME_GRAPH_PASS_FLAG_NONE, ExecuteClearPass, nullptr);
+	uint32_t backBuffer = FrameGraphWrite(frameGraph, clearPass, backBufferHandle, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	uint32_t depth = FrameGraphWrite(frameGraph, clearPass, depthStencilHandle, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+	uint32_t scenePass = FrameGraphAddPass(frameGraph, "Scene", FRAME_GRAPH_PASS_FLAG_NONE, ExecuteScenePass, nullptr);
+	FrameGraphWrite(frameGraph, scenePass, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	FrameGraphWrite(frameGraph, scenePass, depth, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+	// gpu driven, the moved objects are uploaded and the draw count reset, then the objects are culled into draws
+	if (GpuDrivenRendering) {
+		sceneObjectHandle = FrameGraphImport(frameGraph, "Scene Objects", sceneObjectBuffer.resource, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+		drawCommandHandle = FrameGraphImport(frameGraph, "Draw Commands", drawCommandBuffer.resource, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+
+		uint32_t uploadPass = FrameGraphAddPass(frameGraph, "Scene Upload", FRAME_GRAPH_PASS_FLAG_NONE, ExecuteSceneUploadPass, nullptr);
+		uint32_t sceneObjects = FrameGraphWrite(frameGraph, uploadPass, sceneObjectHandle, D3D12_RESOURCE_STATE_COPY_DEST);
+		uint32_t drawCommands = FrameGraphWrite(frameGraph, uploadPass, drawCommandHandle, D3D12_RESOURCE_STATE_COPY_DEST);
+
+		uint32_t cullPass = FrameGraphAddPass(frameGraph, "Cull", FRAME_GRAPH_PASS_FLAG_NONE, ExecuteCullPass, nullptr);
+		FrameGraphRead(frameGraph, cullPass, sceneObjects, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+		drawCommands = FrameGraphWrite(frameGraph, cullPass, drawCommands, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+		FrameGraphRead(frameGraph, scenePass, sceneObjects, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+		FrameGraphRead(frameGraph, scenePass, drawCommands, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+	}
+
+	return FrameGraphCompile(frameGraph, D3D12_RESOURCE_STATE_GENERIC_READ | D3D12_RESOURCE_STATE_DEPTH_READ);
+}
+
+// places every transient a pass that runs uses, in the state compile says it is first used in
+// the graph's transients are render targets and depth buffers, so they share one render target heap range
+bool CreateFrameGraphTransients() {
+	if (frameGraph.transientHeapSize == 0)
+		return true;
+
+	HRESULT hr = GpuHeapAllocatorAllocateMemory(gpuHeapAllocator, D3D12_HEAP_TYPE_DEFAULT, GPU_HEAP_CATEGORY_RENDER_TARGET, frameGraph.transientHeapSize, frameGraph.transientHeapAlignment, frameGraphMemory);
+	if (FAILED(hr))
+		return false;
+
+	for (size_t i = 0; i < frameGraph.resources.size(); ++i) {
+		FrameGraphResource& resource = frameGraph.resources[i];
+		if (resource.imported || resource.firstUse == frameGraphInvalid)
+			continue;
+
+		DXGI_FORMAT format = (DXGI_FORMAT)resource.desc.format;
+		D3D12_RESOURCE_FLAGS flags = (D3D12_RESOURCE_FLAGS)resource.desc.flags;
+
+		// clears with the same values are fast
+		D3D12_CLEAR_VALUE clearValue = {};
+		clearValue.Format = format;
+		if (flags & D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL) {
+			clearValue.DepthStencil.Depth = 1.0f;
+			clearValue.DepthStencil.Stencil = 0;
+		}
+		bool hasClearValue = (flags & (D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL | D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET)) != 0;
+
+		ID3D12Resource* placed;
+		hr = device->CreatePlacedResource(
+			frameGraphMemory.block->heap,
+			frameGraphMemory.offset + resource.heapOffset,
+			&CD3DX12_RESOURCE_DESC::Tex2D(format, resource.desc.width, resource.desc.height, 1, 1, 1, 0, flags),
+			(D3D12_RESOURCE_STATES)resource.initialState,
+			hasClearValue ? &clearValue : nullptr,
+			IID_PPV_ARGS(&placed));
 		if (FAILED(hr))
-			Running = false;
+			return false;
+
+		resource.resource = placed;
+	}
+
+	return true;
+}
+
+// gpu has to be idle
+// the view of the frame graph's depth buffer, again every time the transients are created
+void CreateDepthStencilView() {
+	depthStencilBuffer = static_cast<ID3D12Resource*>(FrameGraphGetResource(frameGraph, depthStencilHandle));
+	depthStencilBuffer->SetName(L"Depth/Stencil Resource Heap");
+
+	D3D12_DEPTH_STENCIL_VIEW_DESC depthStencilDesc = {};
+	depthStencilDesc.Format = DXGI_FORMAT_D32_FLOAT;
+	depthStencilDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
+	depthStencilDesc.Flags = D3D12_DSV_FLAG_NONE;
+
+	device->CreateDepthStencilView(depthStencilBuffer, &depthStencilDesc, depthStencilView.cpuHandle);
+}
+
+void DestroyFrameGraphTransients() {
+	for (size_t i = 0; i < frameGraph.resources.size(); ++i) {
+		FrameGraphResource& resource = frameGraph.resources[i];
+		if (!resource.imported && resource.resource != nullptr) {
+			static_cast<ID3D12Resource*>(resource.resource)->Release();
+			resource.resource = nullptr;
+		}
+	}
+
+	GpuHeapAllocatorFree(gpuHeapAllocator, frameGraphMemory);
+}
+
+void RecordFrameGraphBarriers(const FrameGraph& graph, const FrameGraphBarrier* barriers, uint32_t count, void* commandList) {
+	RenderCommandList* list = static_cast<RenderCommandList*>(commandList);
+
+	resourceBarriers.resize(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		const FrameGraphBarrier& barrier = barriers[i];
+		RenderBarrier& renderBarrier = resourceBarriers[i];
+		renderBarrier.resource = graph.resources[barrier.resource].resource;
+
+		if (barrier.type == FRAME_GRAPH_BARRIER_ALIASING) {
+			// null stands for whatever used the memory before
+			renderBarrier.type = RENDER_BARRIER_ALIASING;
+			renderBarrier.resourceBefore = barrier.resourceBefore != frameGraphInvalid ? graph.resources[barrier.resourceBefore].resource : nullptr;
+			continue;
+		}
+
+		renderBarrier.type = RENDER_BARRIER_TRANSITION;
+		renderBarrier.resourceBefore = nullptr;
+		renderBarrier.subresource = barrier.subresource;
+		renderBarrier.stateBefore = barrier.stateBefore;
+		renderBarrier.stateAfter = barrier.stateAfter;
+		renderBarrier.flag = barrier.flag;
+	}
+
+	RenderCommandListBarriers(*list, resourceBarriers.data(), count);
+}
+
+// creates the upload buffer every staging copy is sub-allocated from, mapped for its whole lifetime
+bool InitUploadArena() {
+	// set as read because gpu will read from the buffer
+	HRESULT hr = GpuHeapAllocatorCreateBuffer(gpuHeapAllocator, D3D12_HEAP_TYPE_UPLOAD, uploadArenaSize, D3D12_RESOURCE_STATE_GENERIC_READ, uploadArenaBuffer);
+	if (FAILED(hr))
+		return false;
+
+	ID3D12Resource* uploadBuffer = uploadArenaBuffer.resource;
+	uploadBuffer->SetName(L"Upload Arena Resource Heap");
 
-		// wait until fence has triggered event
-		WaitForSingleObject(fenceEvent, INFINITE);
+	// cpu never reads staging memory
+	uint8_t* cpuAddress;
+	CD3DX12_RANGE readRange(0, 0);
+	hr = uploadBuffer->Map(0, &readRange, reinterpret_cast<void**>(&cpuAddress));
+	if (FAILED(hr)) {
+		GpuHeapAllocatorFree(gpuHeapAllocator, uploadArenaBuffer);
+		return false;
+	}
+
+	if (!UploadArenaInit(uploadArena, cpuAddress, uploadArenaSize, uploadBuffer, GetFenceCompletedValue)) {
+		GpuHeapAllocatorFree(gpuHeapAllocator, uploadArenaBuffer);
+		return false;
 	}
 
-	++fenceValue[frameIndex];
+	return true;
+}
+
+// every upload has to be finished on the gpu
+void ShutdownUploadArena() {
+	if (uploadArenaBuffer.resource == nullptr)
+		return;
+
+	UploadArenaStats stats = UploadArenaGetStats(uploadArena);
+	printf("upload arena: %llu allocations, %llu failed, peak %.1f MB of %.1f MB\n",
+		stats.allocationCount, stats.failedAllocationCount,
+		stats.peakUsedBytes / (1024.0 * 1024.0), stats.capacity / (1024.0 * 1024.0));
+
+	UploadArenaDestroy(uploadArena);
+	GpuHeapAllocatorFree(gpuHeapAllocator, uploadArenaBuffer);
+}
+
+uint64_t GetFenceCompletedValue(void* fence) {
+	return static_cast<ID3D12Fence*>(fence)->GetCompletedValue();
 }
 
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nShowCmd) {
+	PROFILE_THREAD_NAME("Main Thread");
+
 	if (!InitializeWindow(hInstance, nShowCmd, FullScreen)) {
 		MessageBox(0, L"Window Initialization - Failed", L"Error", MB_OK);
 		return 1;
@@ -1032,105 +2108,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 
 	mainloop();
 
-	WaitForPreviousFrame();
-
-	CloseHandle(fenceEvent);
-
 	Cleanup();
 	
 	return 0;
 }
-
-
-// image conversion functions
-DXGI_FORMAT GetDXGIFormatFromWICFormat(WICPixelFormatGUID& wicFormatGUID)
-{
-	if (wicFormatGUID == GUID_WICPixelFormat128bppRGBAFloat) return DXGI_FORMAT_R32G32B32A32_FLOAT;
-	else if (wicFormatGUID == GUID_WICPixelFormat64bppRGBAHalf) return DXGI_FORMAT_R16G16B16A16_FLOAT;
-	else if (wicFormatGUID == GUID_WICPixelFormat64bppRGBA) return DXGI_FORMAT_R16G16B16A16_UNORM;
-	else if (wicFormatGUID == GUID_WICPixelFormat32bppRGBA) return DXGI_FORMAT_R8G8B8A8_UNORM;
-	else if (wicFormatGUID == GUID_WICPixelFormat32bppBGRA) return DXGI_FORMAT_B8G8R8A8_UNORM;
-	else if (wicFormatGUID == GUID_WICPixelFormat32bppBGR) return DXGI_FORMAT_B8G8R8X8_UNORM;
-	else if (wicFormatGUID == GUID_WICPixelFormat32bppRGBA1010102XR) return DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM;
-
-	else if (wicFormatGUID == GUID_WICPixelFormat32bppRGBA1010102) return DXGI_FORMAT_R10G10B10A2_UNORM;
-	else if (wicFormatGUID == GUID_WICPixelFormat16bppBGRA5551) return DXGI_FORMAT_B5G5R5A1_UNORM;
-	else if (wicFormatGUID == GUID_WICPixelFormat16bppBGR565) return DXGI_FORMAT_B5G6R5_UNORM;
-	else if (wicFormatGUID == GUID_WICPixelFormat32bppGrayFloat) return DXGI_FORMAT_R32_FLOAT;
-	else if (wicFormatGUID == GUID_WICPixelFormat16bppGrayHalf) return DXGI_FORMAT_R16_FLOAT;
-	else if (wicFormatGUID == GUID_WICPixelFormat16bppGray) return DXGI_FORMAT_R16_UNORM;
-	else if (wicFormatGUID == GUID_WICPixelFormat8bppGray) return DXGI_FORMAT_R8_UNORM;
-	else if (wicFormatGUID == GUID_WICPixelFormat8bppAlpha) return DXGI_FORMAT_A8_UNORM;
-
-	else return DXGI_FORMAT_UNKNOWN;
-}
-
-// get a dxgi compatible wic format from another wic format
-WICPixelFormatGUID GetConvertToWICFormat(WICPixelFormatGUID& wicFormatGUID)
-{
-	if (wicFormatGUID == GUID_WICPixelFormatBlackWhite) return GUID_WICPixelFormat8bppGray;
-	else if (wicFormatGUID == GUID_WICPixelFormat1bppIndexed) return GUID_WICPixelFormat32bppRGBA;
-	else if (wicFormatGUID == GUID_WICPixelFormat2bppIndexed) return GUID_WICPixelFormat32bppRGBA;
-	else if (wicFormatGUID == GUID_WICPixelFormat4bppIndexed) return GUID_WICPixelFormat32bppRGBA;
-	else if (wicFormatGUID == GUID_WICPixelFormat8bppIndexed) return GUID_WICPixelFormat32bppRGBA;
-	else if (wicFormatGUID == GUID_WICPixelFormat2bppGray) return GUID_WICPixelFormat8bppGray;
-	else if (wicFormatGUID == GUID_WICPixelFormat4bppGray) return GUID_WICPixelFormat8bppGray;
-	else if (wicFormatGUID == GUID_WICPixelFormat16bppGrayFixedPoint) return GUID_WICPixelFormat16bppGrayHalf;
-	else if (wicFormatGUID == GUID_WICPixelFormat32bppGrayFixedPoint) return GUID_WICPixelFormat32bppGrayFloat;
-	else if (wicFormatGUID == GUID_WICPixelFormat16bppBGR555) return GUID_WICPixelFormat16bppBGRA5551;
-	else if (wicFormatGUID == GUID_WICPixelFormat32bppBGR101010) return GUID_WICPixelFormat32bppRGBA1010102;
-	else if (wicFormatGUID == GUID_WICPixelFormat24bppBGR) return GUID_WICPixelFormat32bppRGBA;
-	else if (wicFormatGUID == GUID_WICPixelFormat24bppRGB) return GUID_WICPixelFormat32bppRGBA;
-	else if (wicFormatGUID == GUID_WICPixelFormat32bppPBGRA) return GUID_WICPixelFormat32bppRGBA;
-	else if (wicFormatGUID == GUID_WICPixelFormat32bppPRGBA) return GUID_WICPixelFormat32bppRGBA;
-	else if (wicFormatGUID == GUID_WICPixelFormat48bppRGB) return GUID_WICPixelFormat64bppRGBA;
-	else if (wicFormatGUID == GUID_WICPixelFormat48bppBGR) return GUID_WICPixelFormat64bppRGBA;
-	else if (wicFormatGUID == GUID_WICPixelFormat64bppBGRA) return GUID_WICPixelFormat64bppRGBA;
-	else if (wicFormatGUID == GUID_WICPixelFormat64bppPRGBA) return GUID_WICPixelFormat64bppRGBA;
-	else if (wicFormatGUID == GUID_WICPixelFormat64bppPBGRA) return GUID_WICPixelFormat64bppRGBA;
-	else if (wicFormatGUID == GUID_WICPixelFormat48bppRGBFixedPoint) return GUID_WICPixelFormat64bppRGBAHalf;
-	else if (wicFormatGUID == GUID_WICPixelFormat48bppBGRFixedPoint) return GUID_WICPixelFormat64bppRGBAHalf;
-	else if (wicFormatGUID == GUID_WICPixelFormat64bppRGBAFixedPoint) return GUID_WICPixelFormat64bppRGBAHalf;
-	else if (wicFormatGUID == GUID_WICPixelFormat64bppBGRAFixedPoint) return GUID_WICPixelFormat64bppRGBAHalf;
-	else if (wicFormatGUID == GUID_WICPixelFormat64bppRGBFixedPoint) return GUID_WICPixelFormat64bppRGBAHalf;
-	else if (wicFormatGUID == GUID_WICPixelFormat64bppRGBHalf) return GUID_WICPixelFormat64bppRGBAHalf;
-	else if (wicFormatGUID == GUID_WICPixelFormat48bppRGBHalf) return GUID_WICPixelFormat64bppRGBAHalf;
-	else if (wicFormatGUID == GUID_WICPixelFormat128bppPRGBAFloat) return GUID_WICPixelFormat128bppRGBAFloat;
-	else if (wicFormatGUID == GUID_WICPixelFormat128bppRGBFloat) return GUID_WICPixelFormat128bppRGBAFloat;
-	else if (wicFormatGUID == GUID_WICPixelFormat128bppRGBAFixedPoint) return GUID_WICPixelFormat128bppRGBAFloat;
-	else if (wicFormatGUID == GUID_WICPixelFormat128bppRGBFixedPoint) return GUID_WICPixelFormat128bppRGBAFloat;
-	else if (wicFormatGUID == GUID_WICPixelFormat32bppRGBE) return GUID_WICPixelFormat128bppRGBAFloat;
-	else if (wicFormatGUID == GUID_WICPixelFormat32bppCMYK) return GUID_WICPixelFormat32bppRGBA;
-	else if (wicFormatGUID == GUID_WICPixelFormat64bppCMYK) return GUID_WICPixelFormat64bppRGBA;
-	else if (wicFormatGUID == GUID_WICPixelFormat40bppCMYKAlpha) return GUID_WICPixelFormat64bppRGBA;
-	else if (wicFormatGUID == GUID_WICPixelFormat80bppCMYKAlpha) return GUID_WICPixelFormat64bppRGBA;
-
-#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8) || defined(_WIN7_PLATFORM_UPDATE)
-	else if (wicFormatGUID == GUID_WICPixelFormat32bppRGB) return GUID_WICPixelFormat32bppRGBA;
-	else if (wicFormatGUID == GUID_WICPixelFormat64bppRGB) return GUID_WICPixelFormat64bppRGBA;
-	else if (wicFormatGUID == GUID_WICPixelFormat64bppPRGBAHalf) return GUID_WICPixelFormat64bppRGBAHalf;
-#endif
-
-	else return GUID_WICPixelFormatDontCare;
-}
-
-// get the number of bits per pixel for a dxgi format
-int GetDXGIFormatBitsPerPixel(DXGI_FORMAT& dxgiFormat)
-{
-	if (dxgiFormat == DXGI_FORMAT_R32G32B32A32_FLOAT) return 128;
-	else if (dxgiFormat == DXGI_FORMAT_R16G16B16A16_FLOAT) return 64;
-	else if (dxgiFormat == DXGI_FORMAT_R16G16B16A16_UNORM) return 64;
-	else if (dxgiFormat == DXGI_FORMAT_R8G8B8A8_UNORM) return 32;
-	else if (dxgiFormat == DXGI_FORMAT_B8G8R8A8_UNORM) return 32;
-	else if (dxgiFormat == DXGI_FORMAT_B8G8R8X8_UNORM) return 32;
-	else if (dxgiFormat == DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM) return 32;
-
-	else if (dxgiFormat == DXGI_FORMAT_R10G10B10A2_UNORM) return 32;
-	else if (dxgiFormat == DXGI_FORMAT_B5G5R5A1_UNORM) return 16;
-	else if (dxgiFormat == DXGI_FORMAT_B5G6R5_UNORM) return 16;
-	else if (dxgiFormat == DXGI_FORMAT_R32_FLOAT) return 32;
-	else if (dxgiFormat == DXGI_FORMAT_R16_FLOAT) return 16;
-	else if (dxgiFormat == DXGI_FORMAT_R16_UNORM) return 16;
-	else if (dxgiFormat == DXGI_FORMAT_R8_UNORM) return 8;
-	else if (dxgiFormat == DXGI_FORMAT_A8_UNORM) return 8;
-}
\ No newline at end of file
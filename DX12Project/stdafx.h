@@ -21,6 +21,32 @@
 // this file has helper functions
 #include "d3dx12.h"
 
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+#include "CullingBvh.h"
+#include "D3D12RenderDevice.h"
+#include "DescriptorHeap.h"
+#include "FrameAllocator.h"
+#include "FrameGraph.h"
+#include "GpuCulling.h"
+#include "GpuHeapAllocator.h"
+#include "GpuProfiler.h"
+#include "ImageLoader.h"
+#include "MappedFile.h"
+#include "MeshFile.h"
+#include "Meshlet.h"
+#include "PipelineCache.h"
+#include "Profiler.h"
+#include "RenderCapture.h"
+#include "ResourceStateTracker.h"
+#include "ShaderCompiler.h"
+#include "TextureLoader.h"
+#include "TransformHierarchy.h"
+#include "UploadArena.h"
+#include "VertexLayout.h"
+
 using namespace DirectX;
 
 // window handle
@@ -32,6 +58,27 @@ bool FullScreen = false;
 
 bool Running = true;
 
+// how the scene is drawn, the first of these that is set wins and the ones after it are not used:
+//   GpuDrivenRendering  the scene lives in a gpu buffer, a compute pass culls it into indirect draws and one
+//                       ExecuteIndirect draws them, the cpu only uploads what moved
+//   InstancedRendering  the cpu culls the scene with the bvh and draws every visible cube with one instanced draw
+//   MeshletRendering    the cpu culls the scene with the bvh, then the meshlets of every visible cube, and draws what
+//                       is left through the mesh shader if the device has them, with ExecuteIndirect otherwise
+//   none of them        the cpu culls the scene with the bvh and draws every visible cube on its own
+// F9 steps through the four in this order while running, starting from the one set here
+bool GpuDrivenRendering = false;
+bool InstancedRendering = false;
+bool MeshletRendering = true;
+
+// records draws on worker threads, each with its own command list. only the last two modes have a draw per cube
+// to spread over them, the first two record a single draw
+bool MultithreadedRecording = true;
+
+// frames are built through a capture device in front of the d3d12 one, so F11 can write out what the next frame
+// executes. off unless a capture is wanted: the device has to see every frame from the start to know what the
+// buffers hold, so it records every list a second time into memory whether or not a capture is made
+bool FrameCapture = false;
+
 // app name
 // Long Pointer to a Const TCHAR STRing
 LPCTSTR WindowName = L"WindowApp";
@@ -51,6 +98,10 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
 const int frameBufferCount = 3;
 
+// frames the cpu can record ahead of the gpu
+// independent from the swap chain, lower means less latency and higher means more cpu/gpu overlap
+const int maxFramesInFlight = 2;
+
 ID3D12Device* device;
 
 // used to switch between render buffers
@@ -58,29 +109,99 @@ IDXGISwapChain3* swapChain;
 
 ID3D12CommandQueue* commandQueue;
 
-ID3D12DescriptorHeap* rtvDescriptorHeap;
+// frames are built through the render device, so the same code can run against the null device off windows
+// the swap chain, profiler and texture loader still take d3d12 objects, so the graphics queue is made here and
+// wrapped
+D3D12RenderDevice renderDevice;
+RenderQueue graphicsQueue;
+
+// what frames are built with, frameCapture's device in front of renderDevice with FrameCapture
+RenderCaptureDevice frameCapture;
+RenderDevice* frameDevice;
+
+// buffers and textures are placed into a few large heaps instead of each getting a committed resource
+GpuHeapAllocator gpuHeapAllocator;
+
+// uploads run on their own queue so they can overlap with rendering
+// the graphics queue waits on the copy fences before it uses what was copied and does the state transitions
+ID3D12CommandQueue* copyQueue;
+
+// startup uploads (vertex and index buffers), textures stream through the texture loader's own list and fence
+ID3D12CommandAllocator* copyCommandAllocator;
+ID3D12GraphicsCommandList* copyCommandList;
+ID3D12Fence* copyFence;
+UINT64 copyFenceValue;
+
+// staging heap, the views are read when commands that use them are recorded
+CpuDescriptorHeap rtvDescriptorHeap;
+CpuDescriptor renderTargetViews[frameBufferCount];
 
 ID3D12Resource* renderTargets[frameBufferCount];
 
-// have enough allocators for buffer * threads
-// currently only one thread, but should work on multithreading in the near future
-ID3D12CommandAllocator* commandAllocator[frameBufferCount];
+// has an allocator per frame in flight
+// main thread records clears and barriers, draws can be recorded on worker threads (see below)
+RenderCommandList commandList;
+
+// worker threads that record draws in parallel
+const int recordThreadCount = 4;
+
+// a thread is only woken up if it gets at least this many draws
+const size_t minDrawsPerRecordThread = 64;
+
+// every worker list has an allocator per frame since the previous frames might still be executing
+RenderCommandList recordCommandLists[recordThreadCount];
+
+// range of drawConstantBuffers a worker records this frame
+struct RecordJob {
+    size_t firstDraw;
+    size_t lastDraw;
+};
+
+RecordJob recordJobs[recordThreadCount];
+
+HANDLE recordThreads[recordThreadCount];
+// main thread signals begin, worker signals done once its list is closed
+HANDLE recordBeginEvents[recordThreadCount];
+HANDLE recordDoneEvents[recordThreadCount];
+volatile bool recordThreadsExit;
+
+// draw threads the scene pass woke up this frame, 0 if it recorded the draws itself
+int recordThreadsInUse;
+
+// takes the barriers after the scene pass (back buffer to present) while the worker lists are recorded
+RenderCommandList presentCommandList;
+
+// lists to execute this frame, in submission order (main, workers, present)
+RenderCommandList submitCommandLists[recordThreadCount + 2];
+UINT submitCommandListCount;
 
-ID3D12GraphicsCommandList* commandList;
+// one fence for the queue, every signal uses the next value so it only ever goes up
+RenderFence fence;
 
-// should have as many as allocators (buffer * threads)
-// locked until command list is executed
-ID3D12Fence* fence[frameBufferCount];
+// last value signaled on the queue
+UINT64 fenceValue;
 
-HANDLE fenceEvent;
+// fence value that marks the end of the last frame that used each frame context
+UINT64 frameFenceValues[maxFramesInFlight];
 
-// incremented every frame
-UINT64 fenceValue[frameBufferCount];
+// frame context (allocators) being recorded, cycles through maxFramesInFlight
+int frameContextIndex;
 
 // current render target view
 int frameIndex;
 
-int rtvDescriptorSize;
+// spin for this long before sleeping on the fence event, waking up from an event is slow
+const double fenceSpinMicroseconds = 50.0;
+
+LARGE_INTEGER performanceFrequency;
+
+// time the cpu spent waiting for the gpu before recording the last frame
+double frameStallMilliseconds;
+
+// accumulated since the window title was last updated
+double statsStallMilliseconds;
+int statsFrameCount;
+LARGE_INTEGER statsStartTime;
 
 bool InitD3D();
 
@@ -94,50 +215,131 @@ void Cleanup();
 
 void WaitForPreviousFrame();
 
+UINT64 SignalQueue();
+
+double WaitForFenceValue(UINT64 value);
+
+void WaitForGpuIdle();
+
+void ReportFrameStats();
+
+bool InitRecordThreads();
+
+void ShutdownRecordThreads();
+
 #define SAFE_RELEASE(x) if( x ) { x->Release(); x = NULL; }
 
+// pipeline states are loaded from here on a warm start instead of compiled by the driver
+PipelineCache pipelineCache;
+
+// next to the executable
+LPCWSTR pipelineCacheFilename = L"pso_cache.bin";
+
+// timestamps around the passes of every frame, only recorded with ENABLE_PROFILING
+GpuProfiler gpuProfiler;
+
+// F12 writes the recorded cpu and gpu timings here, open it in chrome://tracing
+const char* profileTraceFilename = "trace.json";
+
+// F11 captures the next frame into it when FrameCapture is set, AssetTool replay reads it
+const char* frameCaptureFilename = "frame.rcap";
+bool frameCaptureRequested;
+
+// the d3d12 list behind a list of frameDevice, for the gpu profiler
+ID3D12GraphicsCommandList* GetD3D12CommandList(const RenderCommandList& list);
+void WriteFrameCapture();
+
 // PSO
 ID3D12PipelineState* pipelineStateObject;
 
+// same as above, vertex shader reads from the instance buffer
+ID3D12PipelineState* instancedPipelineStateObject;
+
+// draws visible meshlets with a mesh shader, null if the device or dxcompiler.dll cannot do mesh shaders
+// its root signature has the parameters of rootSignature in the same slots, plus the meshlet buffers
+ID3D12PipelineState* meshletPipelineStateObject;
+ID3D12RootSignature* meshletRootSignature;
+
+// shader model 6, only there for the mesh shader
+ShaderCompiler shaderCompiler;
+
+bool CreateMeshletPipeline(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& psoDesc, const D3D_SHADER_MACRO* defines);
+
+// meshlets are drawn by the mesh shader this frame
+bool UseMeshShaders();
+
+// F9 asks for the next render mode, it is switched to before the next frame is built
+bool renderModeSwitchRequested;
+void SwitchRenderMode();
+
 // this contains data for shaders to access
 ID3D12RootSignature* rootSignature;
 
 // area of render target drawn on
 //viewport stretches from -1 to 1 vertically and horizontally
-D3D12_VIEWPORT viewport;
+RenderViewport viewport;
 
 // area to draw in, rest of the area will be "scissored" out
-D3D12_RECT scissorRect;
+RenderRect scissorRect;
 
 // buffer in GPU memory that contains vertex data for tris
-ID3D12Resource* vertexBuffer;
+// small enough to share a buffer page with the index buffer, so it has an offset into the page resource
+GpuAllocation vertexBuffer;
 
 // contains pointer to vertex data in GPU, total size of buffer, and size of each element
-D3D12_VERTEX_BUFFER_VIEW vertexBufferView;
+RenderVertexBufferView vertexBufferView;
 
 // default buffer to write index data for triangles
-ID3D12Resource* indexBuffer;
+GpuAllocation indexBuffer;
 
 // holds information on index buffer
-D3D12_INDEX_BUFFER_VIEW indexBufferView;
+RenderIndexBufferView indexBufferView;
 
 // 24 bits for depth, 8 for stencil
+// transient resource of the frame graph, placed in frameGraphMemory
 ID3D12Resource* depthStencilBuffer;
 
-ID3D12DescriptorHeap* dsDescriptorHeap;
+CpuDescriptorHeap dsDescriptorHeap;
+CpuDescriptor depthStencilView;
 
-struct ConstantBuffer {
-    // direct x math float 4
-    DirectX::XMFLOAT4 colorMultiplier;
-};
+// passes of a frame, built and compiled once in InitD3D
+FrameGraph frameGraph;
+
+// imported, swapped for the current back buffer every frame
+uint32_t backBufferHandle;
+uint32_t depthStencilHandle;
+
+// transient resources of the frame graph are placed here, at the offsets compile picked
+GpuAllocation frameGraphMemory;
+
+bool BuildFrameGraph();
+bool CreateFrameGraphTransients();
+void CreateDepthStencilView();
+void DestroyFrameGraphTransients();
+void ExecuteClearPass(FrameGraphPassContext& context);
+void ExecuteScenePass(FrameGraphPassContext& context);
+void RecordFrameGraphBarriers(const FrameGraph& graph, const FrameGraphBarrier* barriers, uint32_t count, void* commandList);
+
+// states of every texture, barriers are queued here and flushed in batches. the render targets and the depth
+// buffer belong to the frame graph
+// only the main thread records barriers, and lists are submitted in the order they were flushed into
+ResourceStateTracker resourceStates;
 
-ID3D12DescriptorHeap* mainDescriptorHeap;
-ID3D12Resource* constantBufferUploadHeap[frameBufferCount];
+// reused by every flush
+std::vector<RenderBarrier> resourceBarriers;
 
-// only used to change color of rectangle, actual data
-ConstantBuffer cbColorMultiplierData;
+// context is the command list the barriers are recorded into
+void RecordResourceBarriers(const ResourceStateBarrier* barriers, uint32_t count, void* context);
 
-UINT8* cbColorMultiplierGPUAddress[frameBufferCount];
+// the only shader visible heap, bound once per command list
+// textures are looked up by index in its bindless region, which the pixel shader sees as one unbounded array
+GpuDescriptorHeap mainDescriptorHeap;
+
+// views that live as long as their resource
+const uint32_t bindlessDescriptorCount = 4096;
+
+// tables that only live for one frame, enough for every frame in flight
+const uint32_t transientDescriptorCount = 1024;
 
 // new constant buffer for worldviewprojection matrix
 struct ConstantBufferPerObject {
@@ -146,19 +348,41 @@ struct ConstantBufferPerObject {
 
 // remember that sizeof is bytes
 // remember that there needs to be 255 bytes offset between constantbuffers
-// 16 + 255, then bitwise and ...1100000000
+// 64 + 255, then bitwise and ...1100000000
 // this comes out to be 256
 // alternatively the size can be figured out by modulus, but this method is faster for large objects
-int ConstantBufferPerObjectAlignedSize = (sizeof(ConstantBufferPerObject) + 255) & ~255;
+const UINT ConstantBufferPerObjectAlignedSize = (sizeof(ConstantBufferPerObject) + 255) & ~255;
+
+// per-instance data in a structured buffer, matches InstancedVertexShader.hlsl
+struct InstanceData {
+    DirectX::XMFLOAT4X4 wvpMat;
+};
+
+// instance buffer written in Update, lives in the frame allocator like the constant buffers
+D3D12_GPU_VIRTUAL_ADDRESS instanceBufferAddress;
+UINT instanceCount;
+
+// hands out 256 byte aligned constant buffers from upload heap pages
+// a page is reused once the frames that wrote to it are finished on the gpu
+FrameAllocator frameAllocator;
+
+// one constant buffer per draw, filled in Update and bound in UpdatePipeline
+std::vector<D3D12_GPU_VIRTUAL_ADDRESS> drawConstantBuffers;
+
+bool CreateUploadPage(uint64_t size, FrameAllocatorPage& page, void* context);
+void DestroyUploadPage(FrameAllocatorPage& page, void* context);
 
-// actual data sent to gpu
-ConstantBufferPerObject cbPerObject;
+// staging memory of every upload (vertex and index buffers, textures), shared with the texture loader
+// userData is the persistently mapped upload buffer
+UploadArena uploadArena;
+GpuAllocation uploadArenaBuffer;
 
-// memory on gpu
-ID3D12Resource* constantBufferUploadHeaps[frameBufferCount];
+// textures bigger than this get a dedicated upload buffer instead
+const uint64_t uploadArenaSize = 64 * 1024 * 1024;
 
-// pointer to each cb resource heaps
-UINT8* cbvGPUAddress[frameBufferCount];
+bool InitUploadArena();
+void ShutdownUploadArena();
+uint64_t GetFenceCompletedValue(void* fence);
 
 DirectX::XMFLOAT4X4 cameraProjMat;
 DirectX::XMFLOAT4X4 cameraViewMat;
@@ -167,25 +391,125 @@ DirectX::XMFLOAT4 cameraPosition;
 DirectX::XMFLOAT4 cameraTarget;
 DirectX::XMFLOAT4 cameraUp;
 
-// cube 1
-DirectX::XMFLOAT4X4 cube1WorldMat;
-DirectX::XMFLOAT4X4 cube1RotMat;
-DirectX::XMFLOAT4 cube1Position;
+// world transforms of every object in the scene, parents before children
+TransformHierarchy sceneTransforms;
 
-// cube 2
-DirectX::XMFLOAT4X4 cube2WorldMat;
-DirectX::XMFLOAT4X4 cube2RotMat;
-DirectX::XMFLOAT4 cube2PositionOffset;
+int cube1Node;
+// child of cube 1
+int cube2Node;
+
+// static props drawn with the same cube mesh
+const int propGridWidth = 100;
+const float propSpacing = 0.5f;
+
+// the two cubes and the props
+const int sceneNodeCount = 2 + propGridWidth * propGridWidth;
 
 int numCubeIndices;
 
-// resource heap of texture
-ID3D12Resource* textureBuffer;
+// positionScale and positionOffset of the cube mesh as two float4, root parameter 4
+float cubeDequantization[8];
+
+// object space box of the cube mesh
+float cubeBoundsMin[3];
+float cubeBoundsMax[3];
+
+// world space boxes of every node, refitted for the nodes that moved
+CullingBvh sceneBvh;
+
+// nodes that survived frustum culling this frame, only these are drawn
+std::vector<uint32_t> visibleNodes;
+
+void BuildSceneBvh();
+void RefitSceneBvh();
+void GetCameraFrustum(DirectX::FXMMATRIX viewProjMat, CullingFrustum& frustum);
+UINT CullScene(DirectX::FXMMATRIX viewProjMat);
+
+// the cube's meshlets, culled on the cpu every frame
+std::vector<Meshlet> cubeMeshlets;
+std::vector<MeshletBounds> cubeMeshletBounds;
+
+// meshlets, meshlet vertices and meshlet triangles of the cube for the mesh shader, one section each
+GpuAllocation meshletBuffer;
+D3D12_GPU_VIRTUAL_ADDRESS meshletAddress;
+D3D12_GPU_VIRTUAL_ADDRESS meshletVertexAddress;
+D3D12_GPU_VIRTUAL_ADDRESS meshletTriangleAddress;
+
+// what culling left of a cube, in the frame allocator
+// indirect draw arguments without mesh shaders, indices of the visible meshlets with them
+struct MeshletDraw {
+    void* resource;
+    UINT64 offset;
+    D3D12_GPU_VIRTUAL_ADDRESS gpuAddress;
+    UINT count;
+};
+
+// next to drawConstantBuffers, cubes without anything visible are left out of both
+std::vector<MeshletDraw> meshletDraws;
+
+// count nodes from visibleNodes, their constant buffers are in the same order
+void CullSceneMeshlets(DirectX::FXMMATRIX viewProjMat, D3D12_GPU_VIRTUAL_ADDRESS constantBuffers, UINT count);
+
+// culling writes here and the result is copied to upload memory, which is slow to read back from
+std::vector<MeshletDrawArguments> meshletDrawArguments;
+std::vector<uint32_t> visibleMeshlets;
+
+// one DrawIndexedInstanced per argument, the constant buffer is set before each ExecuteIndirect
+ID3D12CommandSignature* meshletCommandSignature;
+
+// a GpuSceneObject per node, in node order
+GpuAllocation sceneObjectBuffer;
+// a GpuDrawCommand per node, then the count the culling shader increments
+GpuAllocation drawCommandBuffer;
+UINT64 drawCountOffset;
+
+// imported into the frame graph, the upload pass writes them before the cull pass and the scene pass
+uint32_t sceneObjectHandle;
+uint32_t drawCommandHandle;
+
+// the objects of sceneObjectBuffer that moved, staged in the frame allocator
+struct BufferCopy {
+    void* source;
+    UINT64 sourceOffset;
+    UINT64 destinationOffset;
+    UINT64 size;
+};
+
+std::vector<BufferCopy> sceneObjectCopies;
+// a zero for the draw count, copied before every cull
+BufferCopy drawCountReset;
+// everything is uploaded the first frame and the first after switching to gpu driven rendering, only what moved
+// after that
+bool sceneObjectsUploaded;
+
+// GpuCullConstants for the cull pass, the transposed view projection for the vertex shader
+D3D12_GPU_VIRTUAL_ADDRESS cullConstantsAddress;
+D3D12_GPU_VIRTUAL_ADDRESS sceneConstantsAddress;
+
+ID3D12RootSignature* cullRootSignature;
+ID3D12PipelineState* cullPipelineStateObject;
+// same state as pipelineStateObject, the vertex shader reads the object's matrix from the scene buffer
+ID3D12PipelineState* indirectPipelineStateObject;
+// the object index root constant and a DrawIndexedInstanced per command
+ID3D12CommandSignature* indirectCommandSignature;
+
+bool CreateGpuDrivenPipeline(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& psoDesc, const D3D_SHADER_MACRO* defines, uint64_t rootSignatureHash);
+bool CreateGpuSceneBuffers();
+bool UpdateGpuScene(DirectX::FXMMATRIX viewProjMat);
+void ExecuteSceneUploadPass(FrameGraphPassContext& context);
+void ExecuteCullPass(FrameGraphPassContext& context);
+void RecordIndirectDraws(RenderCommandList& list);
+
+// decodes and uploads textures on background threads
+TextureLoader textureLoader;
+
+// textures that can be streamed in, each gets a bindless descriptor once it is ready
+const int maxStreamedTextures = 256;
 
-int LoadImageDataFromFile(BYTE** imageData, D3D12_RESOURCE_DESC& resourceDescription, LPCWSTR filename, int& bytesPerRow);
+const int maxTextureDecodeThreads = 8;
 
-DXGI_FORMAT  GetDXGIFormatFromWICFormat(WICPixelFormatGUID& wicFormatGUID);
-WICPixelFormatGUID GetConvertToWICFormat(WICPixelFormatGUID& wicFormatGUID);
-int GetDXGIFormatBitsPerPixel(DXGI_FORMAT& dxgiFormat);
+// texture handle, not usable until the loader says it is ready
+int smileTexture;
 
-ID3D12Resource* textureBufferUploadHeap;
+// bindless index of the smile texture once loaded, of the placeholder until then
+uint32_t sceneTextureIndex;